@@ -0,0 +1,161 @@
+// Compara os kernels especializados por template (encoder_kernels.h) com
+// uma implementação equivalente de despacho em tempo de execução: chamada
+// virtual por linha e testes de protocolo/profundidade por pixel.
+//
+//   ./bench_encoder_kernels [largura] [altura] [repetições]
+
+#include "protocols/encoder_kernels.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+
+using namespace all_press::protocols;
+
+namespace {
+
+// Linha de base: o protocolo e a profundidade são decididos em cada pixel
+class DynamicRowEncoder {
+public:
+    virtual ~DynamicRowEncoder() = default;
+    virtual void encode_row(const uint8_t* row, int width, std::vector<uint8_t>& out) = 0;
+};
+
+class DynamicEncoder : public DynamicRowEncoder {
+public:
+    DynamicEncoder(RasterProtocol protocol, int bpp) : protocol_(protocol), bpp_(bpp) {}
+
+    void encode_row(const uint8_t* row, int width, std::vector<uint8_t>& out) override {
+        std::vector<uint8_t> packed;
+        size_t samples = static_cast<size_t>(width) * (bpp_ == 24 ? 3 : 1);
+        if (bpp_ == 1) {
+            packed.assign((static_cast<size_t>(width) + 7) / 8, 0);
+            for (int x = 0; x < width; ++x) {
+                bool ink = row[x] < 128;
+                bool bit = (protocol_ == RasterProtocol::RTL) ? ink : !ink;
+                if (bit) {
+                    packed[x / 8] |= static_cast<uint8_t>(0x80 >> (x % 8));
+                }
+            }
+        } else {
+            for (size_t i = 0; i < samples; ++i) {
+                packed.push_back(row[i]);
+            }
+        }
+        std::vector<uint8_t> compressed(packbits_bound(packed.size()));
+        size_t n = packbits_encode(packed.data(), packed.size(), compressed.data());
+        if (protocol_ == RasterProtocol::RTL) {
+            std::string prefix = "\x1B*b" + std::to_string(n) + "W";
+            out.insert(out.end(), prefix.begin(), prefix.end());
+        }
+        out.insert(out.end(), compressed.begin(), compressed.begin() + n);
+    }
+
+private:
+    RasterProtocol protocol_;
+    int bpp_;
+};
+
+void append_pe_dynamic(std::string& out, long long value, bool seven_bit) {
+    unsigned long long folded = (value < 0)
+        ? ((static_cast<unsigned long long>(-value) << 1) | 1u)
+        : (static_cast<unsigned long long>(value) << 1);
+    unsigned base = seven_bit ? 32u : 64u;
+    while (folded >= base) {
+        out += static_cast<char>(63 + (folded % base));
+        folded /= base;
+    }
+    out += static_cast<char>((seven_bit ? 95u : 191u) + folded);
+}
+
+template <typename Fn>
+double time_ms(int repeats, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(elapsed).count() / repeats;
+}
+
+void report(const char* name, double baseline_ms, double kernel_ms) {
+    std::cout << name << ": dinâmico " << baseline_ms << " ms, template "
+              << kernel_ms << " ms (" << (baseline_ms / kernel_ms) << "x)\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 9933;    // A0 a 300 dpi
+    int height = argc > 2 ? std::atoi(argv[2]) : 2048;
+    int repeats = argc > 3 ? std::atoi(argv[3]) : 5;
+
+    // Desenho técnico sintético: fundo branco, linhas e áreas preenchidas
+    std::mt19937 rng(42);
+    std::vector<uint8_t> gray(static_cast<size_t>(width) * height, 0xFF);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            if (y % 97 < 2 || x % 211 < 2 || (x / 512 + y / 512) % 7 == 0) {
+                gray[static_cast<size_t>(y) * width + x] = static_cast<uint8_t>(rng() % 96);
+            }
+        }
+    }
+    std::vector<uint8_t> rgb(gray.size() * 3);
+    for (size_t i = 0; i < gray.size(); ++i) {
+        rgb[i * 3] = rgb[i * 3 + 1] = rgb[i * 3 + 2] = gray[i];
+    }
+
+    std::vector<uint8_t> out;
+    out.reserve(rgb.size());
+
+    std::unique_ptr<DynamicRowEncoder> rtl(new DynamicEncoder(RasterProtocol::RTL, 1));
+    double base = time_ms(repeats, [&] {
+        out.clear();
+        for (int y = 0; y < height; ++y) {
+            rtl->encode_row(gray.data() + static_cast<size_t>(y) * width, width, out);
+        }
+    });
+    double kern = time_ms(repeats, [&] {
+        out.clear();
+        encode_raster_rows<RasterProtocol::RTL, 1>(gray.data(), width, height, out);
+    });
+    report("RTL 1 bit      ", base, kern);
+
+    std::unique_ptr<DynamicRowEncoder> ps(new DynamicEncoder(RasterProtocol::POSTSCRIPT, 24));
+    base = time_ms(repeats, [&] {
+        out.clear();
+        for (int y = 0; y < height; ++y) {
+            ps->encode_row(rgb.data() + static_cast<size_t>(y) * width * 3, width, out);
+        }
+    });
+    kern = time_ms(repeats, [&] {
+        out.clear();
+        encode_raster_rows<RasterProtocol::POSTSCRIPT, 24>(rgb.data(), width, height, out);
+    });
+    report("PostScript RGB ", base, kern);
+
+    // Coordenadas PE: deltas curtos típicos de hachuras
+    std::vector<long long> coords(4000000);
+    for (auto& c : coords) {
+        c = static_cast<long long>(rng() % 4001) - 2000;
+    }
+    std::string text;
+    text.reserve(coords.size() * 3);
+    bool seven_bit = argc > 4;
+    base = time_ms(repeats, [&] {
+        text.clear();
+        for (long long c : coords) append_pe_dynamic(text, c, seven_bit);
+    });
+    kern = time_ms(repeats, [&] {
+        text.clear();
+        if (seven_bit) {
+            for (long long c : coords) PECoordinateEmitter<true>::append(text, c);
+        } else {
+            for (long long c : coords) PECoordinateEmitter<false>::append(text, c);
+        }
+    });
+    report("Coordenadas PE ", base, kern);
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+// Vazão do meio-tom (raster/halftone.h) em Gpixel/s: limiar fixo escalar
+// como linha de base, matrizes ordenadas SIMD e difusão de erro em frente
+// de onda com o número de threads dado.
+//
+//   ./bench_halftone [largura] [altura] [repetições] [threads]
+
+#include "raster/halftone.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace all_press::raster;
+
+namespace {
+
+template <typename Fn>
+double time_ms(int repeats, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < repeats; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::milli>(elapsed).count() / repeats;
+}
+
+void report(const char* name, double ms, double pixels) {
+    std::cout << name << ": " << ms << " ms, " << (pixels / ms / 1e6) << " Gpixel/s\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int width = argc > 1 ? std::atoi(argv[1]) : 9933;    // A0 a 300 dpi
+    int height = argc > 2 ? std::atoi(argv[2]) : 2048;
+    int repeats = argc > 3 ? std::atoi(argv[3]) : 5;
+    unsigned threads = argc > 4 ? static_cast<unsigned>(std::atoi(argv[4])) : 0;
+
+    // Degradês e ruído: o pior caso para o meio-tom
+    std::mt19937 rng(42);
+    std::vector<uint8_t> gray(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            gray[static_cast<size_t>(y) * width + x] =
+                static_cast<uint8_t>((x * 255 / width + rng() % 32) & 0xFF);
+        }
+    }
+    std::vector<uint8_t> packed(packed_row_bytes(width) * height);
+    const double pixels = static_cast<double>(width) * height;
+
+    double ms = time_ms(repeats, [&] {
+        const size_t row_bytes = packed_row_bytes(width);
+        for (int y = 0; y < height; ++y) {
+            const uint8_t* row = gray.data() + static_cast<size_t>(y) * width;
+            uint8_t* out = packed.data() + y * row_bytes;
+            for (size_t b = 0; b < row_bytes; ++b) out[b] = 0;
+            for (int x = 0; x < width; ++x) {
+                if (row[x] < 128) out[x / 8] |= static_cast<uint8_t>(0x80 >> (x % 8));
+            }
+        }
+    });
+    report("Limiar escalar  ", ms, pixels);
+
+    struct Case { const char* name; HalftoneMethod method; };
+    const Case cases[] = {
+        {"Bayer 8x8       ", HalftoneMethod::BAYER},
+        {"Blue noise 64x64", HalftoneMethod::BLUE_NOISE},
+        {"Floyd-Steinberg ", HalftoneMethod::FLOYD_STEINBERG},
+        {"Jarvis          ", HalftoneMethod::JARVIS},
+    };
+    for (const auto& c : cases) {
+        HalftoneOptions options;
+        options.method = c.method;
+        options.threads = threads;
+        Halftoner halftoner(options);
+        ms = time_ms(repeats, [&] {
+            halftoner.process(gray.data(), width, height, width, packed.data());
+        });
+        report(c.name, ms, pixels);
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace AllPress {
+
+struct ConversionCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t stores = 0;
+    size_t evictions = 0;
+    size_t entries = 0;
+    uint64_t bytes = 0;
+};
+
+// Resultados de conversão em disco, endereçados pelo conteúdo da entrada e
+// pelas opções que mudam a saída: reimprimir o mesmo documento (ou outro
+// upload com os mesmos bytes) não converte nem codifica de novo. Entradas
+// são imutáveis: publicadas por cópia num temporário renomeado para o nome
+// final, e lidas por cópia a partir de um descritor aberto, então uma
+// remoção pela política LRU não afeta quem está lendo. O tamanho total fica
+// abaixo de max_bytes; a ordem LRU sobrevive a reinícios pelo mtime.
+class ConversionCache {
+public:
+    // Cache do processo em cache.directory, limitado a cache.max_mb
+    // (0 desliga)
+    static ConversionCache& instance();
+
+    ConversionCache(const std::string& root_dir, uint64_t max_bytes);
+
+    ConversionCache(const ConversionCache&) = delete;
+    ConversionCache& operator=(const ConversionCache&) = delete;
+
+    bool enabled() const { return max_bytes_ > 0; }
+
+    // SHA-256 do conteúdo em hexadecimal, memorizado por dispositivo, inode,
+    // tamanho e mtime; vazio se o arquivo não abrir
+    std::string content_hash(const std::string& path);
+
+    // Chave de uma entrada: SHA-256 das partes (tipo de saída, hash do
+    // conteúdo, opções normalizadas)
+    static std::string make_key(const std::vector<std::string>& parts);
+
+    // Copia a entrada para destination (arquivo do chamador, pode ser
+    // alterado); meta recebe os metadados publicados com ela. false se não
+    // houver entrada.
+    bool fetch(const std::string& key, const std::string& destination, std::string* meta = nullptr);
+
+    // Publica uma cópia de source; entradas maiores que o limite não entram
+    bool publish(const std::string& key, const std::string& source, const std::string& meta = "");
+
+    ConversionCacheStats stats() const;
+    void clear();
+
+private:
+    struct Entry {
+        uint64_t bytes = 0;
+        std::list<std::string>::iterator lru;
+    };
+
+    struct HashMemo {
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        uint64_t size = 0;
+        int64_t mtime = 0;
+        std::string hash;
+    };
+
+    std::string entry_path(const std::string& key) const;
+    void load_index();
+    void remove_locked(const std::string& key);      // Com mutex_
+    void evict_locked();                              // Com mutex_
+
+    std::string root_dir_;
+    uint64_t max_bytes_ = 0;
+    mutable std::mutex mutex_;
+    std::list<std::string> lru_;                      // Mais recente na frente
+    std::unordered_map<std::string, Entry> entries_;
+    std::unordered_map<std::string, HashMemo> hashes_;
+    ConversionCacheStats stats_;
+    uint64_t next_temp_ = 0;
+};
+
+} // namespace AllPress
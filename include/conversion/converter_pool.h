@@ -0,0 +1,163 @@
+#pragma once
+
+#include "utils/subprocess.h"
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace AllPress {
+
+// Conversores externos chamados pelo FileProcessor
+enum class ConverterTool {
+    Pandoc,
+    LibreOffice,
+    ImageMagick,
+    Inkscape,
+    Ghostscript,
+    OdaConverter
+};
+
+constexpr size_t CONVERTER_TOOL_COUNT = 6;
+
+// Nome usado nas chaves de configuração (conversion.<nome>.*) e nos logs
+const char* converter_tool_name(ConverterTool tool);
+
+struct ConverterLimits {
+    int max_workers = 0;        // Conversões simultâneas; 0 = padrão da ferramenta
+    int recycle_after = 0;      // Jobs por worker antes de reiniciar o listener; 0 = nunca
+    int start_timeout_s = 30;   // Espera pelo listener que ainda está subindo
+    int timeout_s = 300;        // Tempo de parede por execução; 0 = sem limite
+    int cpu_limit_s = 0;        // RLIMIT_CPU por execução; 0 = sem limite
+    int memory_limit_mb = 0;    // RLIMIT_AS por execução; 0 = sem limite
+};
+
+struct ConverterPoolStats {
+    size_t conversions = 0;
+    size_t failures = 0;
+    size_t waits = 0;           // Checkouts que esperaram por um worker livre
+    size_t warm = 0;            // Conversões atendidas por um listener já no ar
+    size_t recycled = 0;        // Listeners reiniciados (limite de jobs, falha ou processo morto)
+    int workers = 0;
+    int busy = 0;
+};
+
+class ConverterPool;
+
+// Worker emprestado do pool; devolvido no destrutor
+class ConverterLease {
+public:
+    ConverterLease() = default;
+    ~ConverterLease();
+
+    ConverterLease(ConverterLease&& other) noexcept;
+    ConverterLease& operator=(ConverterLease&& other) noexcept;
+    ConverterLease(const ConverterLease&) = delete;
+    ConverterLease& operator=(const ConverterLease&) = delete;
+
+    explicit operator bool() const { return worker_ != nullptr; }
+
+    // Diretório exclusivo do worker, esvaziado a cada empréstimo: saídas
+    // com o mesmo nome de conversões simultâneas não colidem
+    const std::string& work_dir() const;
+
+    // Executa a ferramenta (args[0] é o executável, procurado no PATH) com
+    // os limites de tempo, CPU e memória da ferramenta; falhas vão para
+    // o log. No LibreOffice o perfil do worker é acrescentado, e a conversão
+    // vai para o listener dele quando está no ar. Com input/output o
+    // stdin/stdout da ferramenta vêm e vão por pipe, sem arquivo temporário.
+    Utils::SubprocessResult run(const std::vector<std::string>& args,
+                                const Utils::Subprocess::Source& input = nullptr,
+                                const Utils::Subprocess::Sink& output = nullptr);
+
+    // A conversão vai para um listener do LibreOffice já no ar
+    bool warm() const;
+
+    // Saída ausente ou inválida: o listener do worker é parado na hora (a
+    // próxima run() sobe uma instância a frio) e reiniciado na devolução
+    void mark_failed();
+
+    void release();
+
+private:
+    friend class ConverterPool;
+
+    struct Worker;
+
+    ConverterLease(ConverterPool* pool, Worker* worker) : pool_(pool), worker_(worker) {}
+
+    ConverterPool* pool_ = nullptr;
+    Worker* worker_ = nullptr;
+    bool failed_ = false;
+};
+
+// Pool de workers por ferramenta, com limite de conversões simultâneas e
+// fila FIFO. Cada worker tem diretório próprio; os do LibreOffice têm perfil
+// próprio (instâncias com perfis diferentes rodam em paralelo) e um listener
+// headless residente que recebe as conversões sem pagar a partida, checado
+// a cada empréstimo e reiniciado após recycle_after jobs ou falha.
+class ConverterPool {
+public:
+    // Pool do processo, com limites de Config: o FileProcessor é criado por
+    // requisição, os workers não
+    static ConverterPool& instance();
+
+    explicit ConverterPool(const std::string& root_dir);
+    ~ConverterPool();
+
+    ConverterPool(const ConverterPool&) = delete;
+    ConverterPool& operator=(const ConverterPool&) = delete;
+
+    // Vale para workers criados depois; o limite de simultâneas, na hora
+    void configure(ConverterTool tool, const ConverterLimits& limits);
+    ConverterLimits limits(ConverterTool tool) const;
+
+    // Sobe até count listeners do LibreOffice (se instalado) antes do
+    // primeiro job; devolve quantos foram iniciados
+    int warm_up(int count);
+
+    // Bloqueia enquanto a ferramenta estiver no limite
+    ConverterLease checkout(ConverterTool tool);
+
+    ConverterPoolStats stats(ConverterTool tool) const;
+
+    // Encerra os listeners; checkouts seguintes voltam a criá-los
+    void shutdown();
+
+private:
+    friend class ConverterLease;
+    using Worker = ConverterLease::Worker;
+
+    struct Lane {
+        ConverterLimits limits;
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::vector<Worker*> idle;
+        std::deque<uint64_t> queue;      // Tickets dos checkouts em espera
+        uint64_t next_ticket = 0;
+        int busy = 0;
+        ConverterPoolStats stats;
+    };
+
+    Lane& lane(ConverterTool tool) { return lanes_[static_cast<size_t>(tool)]; }
+    const Lane& lane(ConverterTool tool) const { return lanes_[static_cast<size_t>(tool)]; }
+
+    Worker* create_worker(Lane& l, ConverterTool tool);   // Com mutex_
+    void give_back(Worker* worker, bool failed);
+    bool start_listener(Worker& worker);
+    void stop_listener(Worker& worker);
+    bool listener_alive(Worker& worker);
+    bool listener_ready(const Worker& worker) const;
+    void wait_until_ready(Worker& worker);
+
+    std::string root_dir_;
+    std::string libreoffice_;            // Executável encontrado no PATH; vazio = ausente
+    mutable std::mutex mutex_;
+    std::condition_variable available_;
+    std::array<Lane, CONVERTER_TOOL_COUNT> lanes_;
+};
+
+} // namespace AllPress
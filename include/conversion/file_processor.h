@@ -1,10 +1,10 @@
 #pragma once
 
+#include <array>
 #include <string>
 #include <vector>
 #include <memory>
 #include <future>
-#include <mutex>
 
 namespace AllPress {
 
@@ -29,6 +29,13 @@ struct FileInfo {
     std::string dimensions; // "width x height"
     int dpi;
     bool has_color;
+
+    // Pré-análise de tinta: cobertura média C, M, Y, K (0..1) do documento,
+    // com erro máximo da amostragem, e área impressa de uma cópia
+    bool coverage_measured = false;
+    std::array<double, 4> ink_coverage{};
+    double coverage_error = 0.0;
+    double area_m2 = 0.0;
 };
 
 struct ConversionOptions {
@@ -50,6 +57,11 @@ public:
     FileInfo analyze_file(const std::string& file_path);
     FileType detect_file_type(const std::string& file_path);
     std::string detect_mime_type(const std::string& file_path);
+
+    // Custo de tinta e mídia a partir da pré-análise (0 se não medida).
+    // Preços em Config: cost.ink_ml_per_m2, cost.ink_price_per_ml,
+    // cost.black_ink_price_per_ml, cost.media_price_per_m2
+    double estimate_cost(const FileInfo& info, int copies = 1) const;
     
     // Conversão
     std::future<std::string> convert_to_pdf_async(const std::string& input_path,
@@ -70,7 +82,13 @@ public:
     std::string convert_design_to_pdf(const std::string& input_path,
                                      const ConversionOptions& options);
 
-    // Otimização
+    // Reduz imagens Netpbm para max_width/max_height (limites rígidos) e para
+    // target_dpi; devolve o caminho da cópia reduzida ou o original
+    std::string downsample_image(const std::string& input_path,
+                                 const ConversionOptions& options);
+
+    // Otimização (Ghostscript, perfil /printer); resultado em cache pelo
+    // conteúdo, o original volta se o Ghostscript falhar
     std::string optimize_pdf_for_printing(const std::string& pdf_path,
                                           const ConversionOptions& options);
     
@@ -79,8 +97,10 @@ public:
                                       int width = 200, int height = 200);
 
 private:
+    void measure_ink_coverage(FileInfo& info);
+    std::string compress_pdf(const std::string& pdf_path);
+
     std::string temp_dir_;
-    std::mutex conversion_mutex_;
 };
 
 } // namespace AllPress
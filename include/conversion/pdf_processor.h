@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace AllPress {
+
+struct PdfPageInfo {
+    double width_pt = 0.0;      // MediaBox (× UserUnit), antes da rotação
+    double height_pt = 0.0;
+    int rotate = 0;             // 0, 90, 180 ou 270
+    bool color = false;         // Espaço de cor colorido declarado nos recursos
+};
+
+struct PdfStructure {
+    std::string version;                    // Do cabeçalho, ex.: "1.7"
+    int page_count = 0;
+    std::vector<PdfPageInfo> pages;
+    std::vector<std::string> color_spaces;  // Famílias declaradas, sem repetição
+    bool uses_color = false;                // Alguma página com cor declarada
+    bool encrypted = false;
+    bool repaired = false;                  // xref inválida: objetos achados por varredura
+};
+
+// Estrutura de um PDF sem interpretar conteúdo: o arquivo é mapeado em
+// memória, a xref (tabela clássica, xref stream e object streams, com as
+// revisões de /Prev) é lida sob demanda e só a árvore de páginas e os
+// recursos são visitados. Espaços de cor vêm dos recursos das páginas,
+// imagens, formulários, shadings e padrões; cores definidas direto no
+// conteúdo (rg, k) não são vistas. Recursos compartilhados são analisados
+// uma vez. Devolve false (com a causa em error) se o arquivo não abrir ou
+// não tiver árvore de páginas legível.
+bool read_pdf_structure(const std::string& path, PdfStructure& structure,
+                        std::string* error = nullptr);
+
+} // namespace AllPress
@@ -6,6 +6,10 @@
 #include <memory>
 #include <mutex>
 #include <chrono>
+#include "raster/calibration.h"
+#include "raster/color_convert.h"
+#include "raster/icc_catalog.h"
+#include "raster/icc_profile.h"
 
 namespace AllPress::Color {
 
@@ -23,14 +27,20 @@ struct ColorProfile {
     std::string device_class; // "input", "display", "output"
     std::string color_space; // "RGB", "CMYK", "Lab"
     bool is_default = false;
+    // Parsed ICC data; null for uncalibrated device spaces
+    std::shared_ptr<const all_press::raster::IccProfile> icc;
 };
 
 struct CalibrationData {
     std::string printer_name;
     std::chrono::system_clock::time_point calibrated_at;
+    // Per-channel tone adjustments: "<channel>" is a gain, "<channel>_gamma"
+    // and "<channel>_offset" override the curve (channels: gray, red, green,
+    // blue, cyan, magenta, yellow, black)
     std::unordered_map<std::string, double> color_corrections;
     double gamma = 1.0;
     bool is_valid = true;
+    uint64_t version = 0; // Bumped on every recalibration
 };
 
 class ColorManager {
@@ -51,7 +61,12 @@ public:
                              const std::string& output_path,
                              const std::string& source_profile,
                              const std::string& target_profile,
-                             RenderingIntent intent = RenderingIntent::Perceptual);
+                             RenderingIntent intent = RenderingIntent::Perceptual,
+                             const std::string& calibrate_for = "");
+    
+    // GCR and total ink limit used for RGB -> CMYK separations
+    void set_cmyk_separation(const all_press::raster::CmykSeparation& separation);
+    all_press::raster::CmykSeparation get_cmyk_separation();
     
     // PDF color management
     bool apply_color_profile_to_pdf(const std::string& pdf_path,
@@ -61,7 +76,12 @@ public:
     // Printer calibration
     bool calibrate_printer(const std::string& printer_name,
                           const std::string& test_pattern_path = "");
+    bool set_printer_calibration(const CalibrationData& calibration);
     CalibrationData get_printer_calibration(const std::string& printer_name);
+    // Compiled curves for the raster pipeline; jobs keep the snapshot they
+    // took while a recalibration swaps in a new version
+    std::shared_ptr<const all_press::raster::CalibrationLut> get_calibration_lut(
+        const std::string& printer_name);
     bool apply_calibration(const std::string& printer_name,
                           const std::string& document_path);
     
@@ -78,11 +98,18 @@ private:
     bool load_system_profiles();
     std::string get_profiles_directory();
     bool validate_profile(const std::string& file_path);
+    std::shared_ptr<const all_press::raster::IccProfile> resolve_icc(const ColorProfile& profile);
+    
+    // System profiles, parsed on first use
+    std::shared_ptr<all_press::raster::IccCatalog> catalog_;
     
     std::unordered_map<std::string, ColorProfile> profiles_;
     std::unordered_map<std::string, CalibrationData> calibrations_;
+    std::unordered_map<std::string, std::shared_ptr<const all_press::raster::CalibrationLut>> calibration_luts_;
     std::unordered_map<std::string, std::string> printer_profiles_;
     
+    all_press::raster::CmykSeparation separation_;
+    
     std::string default_input_profile_;
     std::string profiles_dir_;
     std::mutex profiles_mutex_;
@@ -10,6 +10,8 @@
 #include <optional>
 #include "printer_manager.h"
 #include "protocols/plotter_protocol_base.h"
+#include "protocols/protocol_pool.h"
+#include "protocols/plot_time.h"
 
 namespace AllPress {
 
@@ -39,6 +41,25 @@ struct PrintJob {
     size_t file_size = 0;
     int estimated_pages = 0;
     double estimated_cost = 0.0;
+    // Economia do corte de branco em rolo, preenchida ao converter
+    int blank_pages_skipped = 0;
+    double media_saved_mm = 0.0;
+    double plot_time_saved_s = 0.0;
+    // Nesting em rolo: job que abriu o grupo (0 = plotado sozinho) e posição
+    // da página no rolo
+    int nest_id = 0;
+    double nest_x_mm = 0.0;
+    double nest_y_mm = 0.0;
+    bool nest_rotated = false;
+    // Tempo de plotagem: previsão calibrada, saída bruta do modelo (base da
+    // calibração) e o tempo real medido
+    double predicted_plot_s = 0.0;
+    double plot_model_s = 0.0;
+    double actual_plot_s = 0.0;
+    // Transmissão: bytes da saída convertida confirmados pelo dispositivo e,
+    // num retry retomado por faixa, quantos não precisaram ser reenviados
+    uint64_t bytes_acknowledged = 0;
+    uint64_t bytes_resumed = 0;
 };
 
 class JobQueue {
@@ -72,16 +93,20 @@ public:
     void start();
     void stop();
     
-    void set_printer_manager(PrinterManager* manager) { printer_manager_ = manager; }
+    void set_printer_manager(PrinterManager* manager);
 
 private:
     // 🆕 Estrutura de contexto para processamento com protocolo
     struct ProcessingContext {
         int job_id;
         PrintJob job;
-        std::unique_ptr<all_press::protocols::PlotterProtocolBase> protocol_handler;
+        all_press::protocols::ProtocolLease protocol_handler;  // Devolvido ao pool no fim
         std::string target_protocol;
         all_press::protocols::PlotterCapabilities target_capabilities;
+        bool roll_media = false;  // Mídia em rolo: comprimento de página variável
+        std::string model_key;    // Modelo para velocidades e calibração
+        all_press::protocols::PlotSpeeds speeds;
+        std::string quirks;       // Quirks do modelo serializados (mudam os bytes gerados)
     };
     
     void worker_thread();
@@ -95,6 +120,28 @@ private:
     // 🆕 Pre-flight checks
     bool validate_job_compatibility(const PrintJob& job);
     
+    // Nesting em rolo: retira da fila os jobs pendentes compatíveis com o
+    // primeiro (mesmo plotter e opções, dentro da janela de tempo) e os plota
+    // juntos numa única codificação
+    std::vector<std::shared_ptr<PrintJob>> collect_nest_group(const std::shared_ptr<PrintJob>& first);
+    void process_nested_jobs(const std::vector<std::shared_ptr<PrintJob>>& jobs);
+    
+    // Previsão do tempo de plotagem a partir do arquivo do job (HPGL ou
+    // Netpbm); refinada depois da conversão e calibrada pelos tempos reais
+    void predict_plot_time(PrintJob& job);
+    void record_plot_time(int job_id, const std::string& model_key, double model_s, double actual_s);
+    
+    // Plots entregues ao spooler aguardando a duração real no dispositivo;
+    // consultados pelos workers entre um job e outro
+    struct PendingPlotTime {
+        int job_id;
+        int cups_job_id;
+        std::string model_key;
+        double model_s;
+        std::chrono::steady_clock::time_point submitted;
+    };
+    void poll_plot_times();
+    
     std::queue<std::shared_ptr<PrintJob>> job_queue_;
     std::unordered_map<int, std::shared_ptr<PrintJob>> jobs_map_;
     std::mutex queue_mutex_;
@@ -111,10 +158,16 @@ private:
     
     PrinterManager* printer_manager_;
     
-    // 🆕 Cache de protocolos
-    std::map<std::string, std::unique_ptr<all_press::protocols::PlotterProtocolBase>> 
-        protocol_cache_;
-    std::mutex protocol_cache_mutex_;
+    // 🆕 Pool de handlers de protocolo, por (vendor, modelo, protocolo)
+    std::shared_ptr<all_press::protocols::ProtocolHandlerPool> protocol_pool_;
+    
+    all_press::protocols::PlotTimeCalibration plot_calibration_;
+    std::vector<PendingPlotTime> pending_plot_times_;
+    std::chrono::steady_clock::time_point next_plot_poll_;
+    std::mutex plot_times_mutex_;
+    
+    // Empresta o handler do plotter de destino para um job
+    ProcessingContext make_processing_context(const PrintJob& job);
 };
 
 } // namespace AllPress
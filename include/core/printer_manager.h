@@ -1,7 +1,9 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <mutex>
 #include <future>
@@ -10,6 +12,7 @@
 #include <atomic>
 #include <thread>
 #include "protocols/plotter_protocol_base.h"
+#include "protocols/protocol_pool.h"
 
 #ifdef __APPLE__
 #include <cups/cups.h>
@@ -39,12 +42,13 @@ struct PrintOptions {
     int quality = 3; // 1-5 scale
     std::string orientation = "portrait";
     bool collate = true;
+    bool trim_whitespace = true; // Rolo: remove páginas em branco e o branco final
 };
 
 class PrinterManager {
 public:
     PrinterManager();
-    ~PrinterManager();
+    virtual ~PrinterManager();
     
     // Descoberta assíncrona de impressoras
     std::future<std::vector<PrinterInfo>> discover_printers_async();
@@ -63,9 +67,22 @@ public:
     void stop_status_monitoring();
     void register_status_callback(std::function<void(const PrinterInfo&)> callback);
     
-    // Impressão
-    int submit_print_job(const std::string& printer, const std::string& file_path,
+    // Impressão. Os métodos usados pela JobQueue são virtuais para que os
+    // testes substituam o spooler.
+    virtual int submit_print_job(const std::string& printer, const std::string& file_path,
                         const PrintOptions& options);
+    
+    // Saída já no formato do dispositivo, enviada sem filtro (raw) a partir
+    // de offset no arquivo, precedida de prefix. progress recebe o offset do
+    // arquivo até onde o spooler já aceitou os dados; retornar false cancela
+    // o envio. Retorna o id do job CUPS ou -1.
+    virtual int submit_raw_job(const std::string& printer, const std::string& file_path,
+                               uint64_t offset, const std::vector<uint8_t>& prefix,
+                               const PrintOptions& options,
+                               const std::function<bool(uint64_t)>& progress);
+    // Duração do job no dispositivo (time-at-completed menos
+    // time-at-processing); vazio enquanto ele não termina
+    virtual std::optional<double> get_job_plot_seconds(int job_id);
     bool cancel_job(int job_id);
     bool pause_job(int job_id);
     bool resume_job(int job_id);
@@ -95,18 +112,26 @@ public:
         const PrintOptions& options);
     
     // Obter informações de compatibilidade
-    PrinterAdvancedInfo get_plotter_info(const std::string& printer_uri);
+    virtual PrinterAdvancedInfo get_plotter_info(const std::string& printer_uri);
     
     // Selecionar protocolo automaticamente
-    std::string select_best_protocol(
+    virtual std::string select_best_protocol(
         const std::string& printer_uri,
         const PrintOptions& options);
     
     // Detectar se é um plotter
-    bool is_plotter(const std::string& printer_uri);
+    virtual bool is_plotter(const std::string& printer_uri);
     
     // Extrair vendor de um modelo
     all_press::protocols::PlotterVendor detect_plotter_vendor(const std::string& make_model);
+    
+    // Recarrega plotter_specs.json se mudou, invalidando caches derivados
+    bool reload_plotter_specs_if_changed();
+    
+    // Pool de handlers compartilhado com a JobQueue
+    std::shared_ptr<all_press::protocols::ProtocolHandlerPool> protocol_pool() const {
+        return protocol_pool_;
+    }
 
 private:
     void update_printer_status();
@@ -122,6 +147,9 @@ private:
     std::map<std::string, PrinterAdvancedInfo> plotter_cache_;
     std::mutex plotter_cache_mutex_;
     
+    std::shared_ptr<all_press::protocols::ProtocolHandlerPool> protocol_pool_ =
+        std::make_shared<all_press::protocols::ProtocolHandlerPool>();
+    
 #if defined(__APPLE__) || defined(__linux__)
     cups_dest_t* cups_dests_ = nullptr;
     int num_cups_dests_ = 0;
@@ -1,9 +1,12 @@
 #pragma once
 
 #include "plotter_protocol_base.h"
+#include "plot_time.h"
 #include <map>
 #include <vector>
 #include <algorithm>
+#include <memory>
+#include <string_view>
 
 namespace all_press {
 namespace protocols {
@@ -16,13 +19,20 @@ struct CompatibilityInfo {
     std::vector<std::string> fallback_protocols;
     bool requires_preprocessing;
     std::map<std::string, std::string> quirks;  // Known issues and workarounds
+    bool roll_media = true;  // Alimentação por rolo (media.roll_support)
+    PlotSpeeds speeds = {};  // Previsão de tempo de plotagem
 };
 
+// Índice compacto (vocabulário internado + trie de tokens) construído a
+// partir do plotter_specs.json ou da tabela embutida
+class CompatibilityIndex;
+
 class CompatibilityMatrix {
 private:
+    // Usada enquanto nenhum plotter_specs.json foi carregado
     static const std::map<std::string, CompatibilityInfo> COMPATIBILITY_DB;
 
-    static std::string get_key(PlotterVendor vendor, const std::string& model);
+    static std::shared_ptr<const CompatibilityIndex> snapshot();
 
 public:
     static bool is_compatible(
@@ -43,6 +53,23 @@ public:
         const std::string& model);
 
     static std::vector<CompatibilityInfo> get_all_plotters();
+
+    // Busca por make_model do CUPS ("HP DesignJet T1200 PS3") ou pelo nome
+    // do modelo; tokens normalizados, maior prefixo de modelo conhecido.
+    // Não aloca; nullptr se nenhum modelo casar. GENERIC busca em todos os
+    // vendors.
+    static std::shared_ptr<const CompatibilityInfo> find(
+        PlotterVendor vendor,
+        std::string_view make_model);
+
+    // Carrega plotter_specs.json e troca o índice atomicamente; em caso de
+    // erro lança std::runtime_error e mantém o índice atual
+    static void load_from_file(const std::string& path);
+
+    // Recarrega se o arquivo carregado mudou (mtime/tamanho)
+    static bool reload_if_changed();
+
+    static std::string loaded_file();
 };
 
 }  // namespace protocols
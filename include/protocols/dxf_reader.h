@@ -0,0 +1,53 @@
+#pragma once
+
+#include "protocols/vector_path.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace all_press {
+namespace protocols {
+
+struct DxfReadOptions {
+    double chord_tolerance_mm = 0.02;   // Desvio máximo de arcos, círculos e elipses
+    double unit_mm = 0.0;               // 0 = $INSUNITS do arquivo (mm se ausente)
+    unsigned threads = 0;               // 0 = hardware_concurrency
+    size_t chunk_entities = 2048;       // Entidades de ENTITIES por tarefa
+    size_t max_points = 20000000;       // Pontos e INSERTs depois de expandir os blocos
+};
+
+// Desenho pronto para HPGLGenerator::generate_vector_page: traços em
+// unidades de plotter com a extensão começando em (0, 0) e pena pela cor ACI
+// (7 = pena 1, vermelho = 2, verde = 3, amarelo = 4, azul = 5, magenta = 6,
+// ciano = 7)
+struct DxfDrawing {
+    std::vector<Polyline> strokes;
+    double width_mm = 0.0;
+    double height_mm = 0.0;
+    size_t entities = 0;       // Entidades desenhadas (blocos expandidos contam uma vez por INSERT)
+    size_t skipped = 0;        // Em camadas desligadas ou congeladas, ou invisíveis
+    size_t unsupported = 0;    // HATCH, SPLINE, SOLID, 3D, blocos inexistentes...
+
+    bool empty() const { return strokes.empty(); }
+};
+
+// DXF ASCII: LINE, LWPOLYLINE, POLYLINE/VERTEX (2D, com bulge), ARC, CIRCLE,
+// ELLIPSE, TEXT/ATTRIB/MTEXT em fonte de traço, INSERT e DIMENSION (blocos
+// aninhados) e cor/visibilidade por camada. Uma passada sequencial só
+// localiza seções, camadas e blocos; blocos e faixas de ENTITIES são
+// interpretados em paralelo e juntados na ordem do arquivo. Lança
+// std::runtime_error para DXF binário ou malformado, ou se os blocos
+// aninhados expandirem além de max_points (poucos KB de INSERTs em cadeia
+// podem gerar bilhões de traços).
+DxfDrawing read_dxf(const uint8_t* data, size_t size, const DxfReadOptions& options = {});
+
+// Arquivo mapeado em memória: nada além dos traços é copiado
+DxfDrawing read_dxf_file(const std::string& path, const DxfReadOptions& options = {});
+
+// Programa HPGL/2 completo (IN, traços, PU e SP0), para reaproveitar o
+// interpretador HPGL em prévias e PDF
+std::vector<uint8_t> dxf_to_hpgl(const DxfDrawing& drawing);
+
+}  // namespace protocols
+}  // namespace all_press
@@ -0,0 +1,330 @@
+#pragma once
+
+#include "raster/color_convert.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Kernels por linha dos geradores de protocolo. Protocolo e profundidade de
+// bits são parâmetros de template: o gerador escolhe a especialização uma
+// vez por página e o laço interno roda sem chamadas virtuais nem testes de
+// protocolo/vendor. Apenas PlotterProtocolBase continua dinâmico.
+
+namespace all_press {
+namespace protocols {
+
+enum class RasterProtocol {
+    RTL,         // HP RTL (raster dentro de HPGL/2)
+    POSTSCRIPT   // image + RunLengthDecode
+};
+
+template <RasterProtocol P>
+struct RasterProtocolTraits;
+
+template <>
+struct RasterProtocolTraits<RasterProtocol::RTL> {
+    static constexpr bool INK_IS_ONE = true;  // bit 1 = tinta
+
+    // ESC*b#W precede cada linha; linha vazia vira ESC*b0W
+    static void frame_row(std::vector<uint8_t>& out, const uint8_t* data, size_t size) {
+        char prefix[24];
+        int n = std::snprintf(prefix, sizeof(prefix), "\x1B*b%zuW", size);
+        out.insert(out.end(), prefix, prefix + n);
+        out.insert(out.end(), data, data + size);
+    }
+};
+
+template <>
+struct RasterProtocolTraits<RasterProtocol::POSTSCRIPT> {
+    static constexpr bool INK_IS_ONE = false;  // DeviceGray: 0 = preto
+
+    // Fluxo contínuo do filtro RunLengthDecode
+    static void frame_row(std::vector<uint8_t>& out, const uint8_t* data, size_t size) {
+        out.insert(out.end(), data, data + size);
+    }
+};
+
+// Empacotamento de uma linha de entrada (gray 8 bits ou RGB 8 bits) para a
+// profundidade do dispositivo
+template <int BitsPerPixel, bool InkIsOne>
+struct RowPacker;
+
+template <bool InkIsOne>
+struct RowPacker<1, InkIsOne> {
+    static constexpr int INPUT_CHANNELS = 1;
+
+    static size_t packed_size(int width) { return (static_cast<size_t>(width) + 7) / 8; }
+
+    // Limiar fixo; o meio-tom fica em um estágio anterior
+    static void pack(const uint8_t* gray, int width, uint8_t* out) {
+        const size_t full = static_cast<size_t>(width) / 8;
+        for (size_t b = 0; b < full; ++b) {
+            const uint8_t* p = gray + b * 8;
+            uint8_t bits = static_cast<uint8_t>(
+                ((p[0] < 128) << 7) | ((p[1] < 128) << 6) |
+                ((p[2] < 128) << 5) | ((p[3] < 128) << 4) |
+                ((p[4] < 128) << 3) | ((p[5] < 128) << 2) |
+                ((p[6] < 128) << 1) | (p[7] < 128));
+            out[b] = InkIsOne ? bits : static_cast<uint8_t>(~bits);
+        }
+        int rest = width - static_cast<int>(full * 8);
+        if (rest > 0) {
+            uint8_t bits = 0;
+            for (int i = 0; i < rest; ++i) {
+                bits |= static_cast<uint8_t>((gray[full * 8 + i] < 128) << (7 - i));
+            }
+            // Bits de preenchimento sempre sem tinta
+            uint8_t pad_mask = static_cast<uint8_t>(0xFF << (8 - rest));
+            out[full] = InkIsOne ? bits : static_cast<uint8_t>(~bits & pad_mask) |
+                                           static_cast<uint8_t>(~pad_mask);
+        }
+    }
+
+    static bool is_blank(const uint8_t* gray, int width) {
+        for (int i = 0; i < width; ++i) {
+            if (gray[i] < 128) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+template <bool InkIsOne>
+struct RowPacker<8, InkIsOne> {
+    static constexpr int INPUT_CHANNELS = 1;
+
+    static size_t packed_size(int width) { return static_cast<size_t>(width); }
+
+    static void pack(const uint8_t* gray, int width, uint8_t* out) {
+        std::memcpy(out, gray, static_cast<size_t>(width));
+    }
+
+    static bool is_blank(const uint8_t* gray, int width) {
+        for (int i = 0; i < width; ++i) {
+            if (gray[i] != 0xFF) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+template <bool InkIsOne>
+struct RowPacker<24, InkIsOne> {
+    static constexpr int INPUT_CHANNELS = 3;
+
+    static size_t packed_size(int width) { return static_cast<size_t>(width) * 3; }
+
+    static void pack(const uint8_t* rgb, int width, uint8_t* out) {
+        std::memcpy(out, rgb, static_cast<size_t>(width) * 3);
+    }
+
+    static bool is_blank(const uint8_t* rgb, int width) {
+        for (int i = 0; i < width * 3; ++i) {
+            if (rgb[i] != 0xFF) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+template <bool InkIsOne>
+struct RowPacker<32, InkIsOne> {
+    static constexpr int INPUT_CHANNELS = 4;
+
+    static size_t packed_size(int width) { return static_cast<size_t>(width) * 4; }
+
+    static void pack(const uint8_t* cmyk, int width, uint8_t* out) {
+        std::memcpy(out, cmyk, static_cast<size_t>(width) * 4);
+    }
+
+    static bool is_blank(const uint8_t* cmyk, int width) {
+        for (int i = 0; i < width * 4; ++i) {
+            if (cmyk[i] != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// PackBits (TIFF modo 2 / RunLengthDecode do PostScript):
+// 0..127 = copiar n+1 bytes, 129..255 = repetir o próximo byte 257-n vezes.
+// out precisa de no mínimo size + size/128 + 1 bytes.
+inline size_t packbits_encode(const uint8_t* in, size_t size, uint8_t* out) {
+    size_t i = 0;
+    size_t o = 0;
+    while (i < size) {
+        size_t run = 1;
+        while (i + run < size && run < 128 && in[i + run] == in[i]) {
+            ++run;
+        }
+        if (run >= 2) {
+            out[o++] = static_cast<uint8_t>(257 - run);
+            out[o++] = in[i];
+            i += run;
+            continue;
+        }
+
+        // Literal até o início da próxima repetição de 3+ bytes
+        size_t start = i;
+        ++i;
+        while (i < size && i - start < 128) {
+            if (i + 2 < size && in[i] == in[i + 1] && in[i] == in[i + 2]) {
+                break;
+            }
+            ++i;
+        }
+        size_t count = i - start;
+        out[o++] = static_cast<uint8_t>(count - 1);
+        std::memcpy(out + o, in + start, count);
+        o += count;
+    }
+    return o;
+}
+
+inline size_t packbits_bound(size_t size) {
+    return size + size / 128 + 2;
+}
+
+// Buffers de uma codificação; um handler pode mantê-los entre páginas e
+// jobs para que só a primeira página de cada largura aloque
+struct RowScratch {
+    std::vector<uint8_t> packed;
+    std::vector<uint8_t> compressed;
+    std::vector<uint8_t> gray;
+};
+
+// Codificador de linhas especializado por protocolo e profundidade de bits.
+// Mantém os buffers entre linhas: nenhuma alocação no laço interno.
+template <RasterProtocol P, int BitsPerPixel>
+class RasterRowEncoder {
+public:
+    using Traits = RasterProtocolTraits<P>;
+    using Packer = RowPacker<BitsPerPixel, Traits::INK_IS_ONE>;
+
+    explicit RasterRowEncoder(int width)
+        : RasterRowEncoder(width, owned_) {
+    }
+
+    RasterRowEncoder(int width, RowScratch& scratch)
+        : width_(width),
+          packed_(scratch.packed),
+          compressed_(scratch.compressed) {
+        packed_.resize(Packer::packed_size(width));
+        compressed_.resize(packbits_bound(Packer::packed_size(width)));
+    }
+
+    RasterRowEncoder(const RasterRowEncoder&) = delete;
+    RasterRowEncoder& operator=(const RasterRowEncoder&) = delete;
+
+    static constexpr int input_channels() { return Packer::INPUT_CHANNELS; }
+
+    bool is_blank(const uint8_t* row) const { return Packer::is_blank(row, width_); }
+
+    void encode_row(const uint8_t* row, std::vector<uint8_t>& out) {
+        if (P == RasterProtocol::RTL && Packer::is_blank(row, width_)) {
+            Traits::frame_row(out, nullptr, 0);
+            return;
+        }
+        encode_inked_row(row, out);
+    }
+
+    // Sem o teste de linha vazia (quem chama já sabe que há tinta)
+    void encode_inked_row(const uint8_t* row, std::vector<uint8_t>& out) {
+        Packer::pack(row, width_, packed_.data());
+        size_t n = packbits_encode(packed_.data(), packed_.size(), compressed_.data());
+        Traits::frame_row(out, compressed_.data(), n);
+    }
+
+    // Linha de 1 bit já empacotada por um estágio de meio-tom (bit 1 = tinta)
+    void encode_packed_row(const uint8_t* packed, std::vector<uint8_t>& out) {
+        static_assert(BitsPerPixel == 1, "Packed rows are 1 bit per pixel");
+        const size_t size = Packer::packed_size(width_);
+        const uint8_t* row = packed;
+        if (!Traits::INK_IS_ONE) {
+            for (size_t i = 0; i < size; ++i) {
+                packed_[i] = static_cast<uint8_t>(~packed[i]);
+            }
+            row = packed_.data();
+        }
+        size_t n = packbits_encode(row, size, compressed_.data());
+        Traits::frame_row(out, compressed_.data(), n);
+    }
+
+    static bool packed_is_blank(const uint8_t* packed, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            if (packed[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    RowScratch owned_;
+    int width_;
+    std::vector<uint8_t>& packed_;
+    std::vector<uint8_t>& compressed_;
+};
+
+// Codifica todas as linhas de um raster contíguo
+template <RasterProtocol P, int BitsPerPixel>
+void encode_raster_rows(const uint8_t* data, int width, int height,
+                        std::vector<uint8_t>& out, RowScratch& scratch) {
+    RasterRowEncoder<P, BitsPerPixel> encoder(width, scratch);
+    const size_t stride = static_cast<size_t>(width) * encoder.input_channels();
+    for (int y = 0; y < height; ++y) {
+        encoder.encode_row(data + static_cast<size_t>(y) * stride, out);
+    }
+}
+
+template <RasterProtocol P, int BitsPerPixel>
+void encode_raster_rows(const uint8_t* data, int width, int height,
+                        std::vector<uint8_t>& out) {
+    RowScratch scratch;
+    encode_raster_rows<P, BitsPerPixel>(data, width, height, out, scratch);
+}
+
+// Luma inteira (BT.601) de uma linha RGB; kernel SIMD de raster/color_convert.h
+inline void rgb_row_to_gray(const uint8_t* rgb, int width, uint8_t* gray) {
+    raster::rgb_to_gray8(rgb, width, gray);
+}
+
+// Emissores de coordenadas para os traços HPGL
+struct AsciiCoordinateEmitter {
+    static void append(std::string& out, long long value) {
+        char buffer[24];
+        int n = std::snprintf(buffer, sizeof(buffer), "%lld", value);
+        out.append(buffer, static_cast<size_t>(n));
+    }
+};
+
+// Número PE: bit de sinal no LSB, dígitos base 64 (ou 32) do menos para o
+// mais significativo. Dígitos intermediários começam em 63; o terminador em
+// 191 para base 64 ou 95 para base 32.
+template <bool SevenBit>
+struct PECoordinateEmitter {
+    static constexpr unsigned BASE = SevenBit ? 32u : 64u;
+    static constexpr unsigned TERMINATOR = SevenBit ? 95u : 191u;
+
+    static void append(std::string& out, long long value) {
+        unsigned long long folded = (value < 0)
+            ? ((static_cast<unsigned long long>(-value) << 1) | 1u)
+            : (static_cast<unsigned long long>(value) << 1);
+
+        while (folded >= BASE) {
+            out += static_cast<char>(63 + (folded % BASE));
+            folded /= BASE;
+        }
+        out += static_cast<char>(TERMINATOR + folded);
+    }
+};
+
+}  // namespace protocols
+}  // namespace all_press
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "plotter_protocol_base.h"
+#include "vector_path.h"
+#include "stroke_optimizer.h"
+#include "encoder_kernels.h"
+#include "raster/halftone.h"
 #include <sstream>
 #include <cmath>
 
@@ -11,6 +15,26 @@ class HPGLGenerator : public PlotterProtocolBase {
 private:
     PlotterCapabilities capabilities_;
     bool use_hpgl2_;  // true para HPGL2, false para HPGL
+
+    // Polyline Encoded (PE): coordenadas relativas em base 64/32
+    bool use_polyline_encoding_ = false;
+    int pe_fraction_bits_ = 0;     // Bits fracionários das coordenadas
+    bool pe_seven_bit_ = false;    // Base 32 para canais de 7 bits
+
+    // Reordenação de traços para reduzir deslocamento com caneta levantada
+    bool optimize_strokes_ = true;
+    StrokeOptimizerOptions stroke_options_;
+    StrokeOptimizationReport last_stroke_report_;
+
+    // Buffers de linha reaproveitados entre páginas e jobs (pool)
+    RowScratch scratch_;
+
+    // Meio-tom de raster contínuo para a saída RTL de 1 bit
+    raster::HalftoneOptions halftone_;
+    std::vector<uint8_t> halftone_rows_;
+
+    // Retomada de raster por faixa (quirk rtl_band_resume)
+    bool band_resume_ = false;
     
     // Mapeamento de tamanho de papel HPGL
     std::map<MediaSize, std::string> media_size_map_ = {
@@ -31,6 +55,11 @@ private:
         {1200, 1200}
     };
 
+    void append_rtl_raster_begin(std::vector<uint8_t>& out,
+                                 int width, int height, int dpi) const;
+    void append_rtl_raster_end(std::vector<uint8_t>& out) const;
+    void append_rtl_skip(std::vector<uint8_t>& out, int rows) const;
+
 public:
     HPGLGenerator(bool use_hpgl2 = true);
 
@@ -46,8 +75,31 @@ public:
         int height,
         int dpi) override;
 
+    std::vector<uint8_t> generate_raster_page(
+        const raster::TiledRaster& page,
+        int dpi) override;
+
+    // Um ponto de retomada por faixa de tile_size linhas (saltos em branco
+    // que cruzam faixas não são partidos)
+    std::vector<uint8_t> generate_raster_page(
+        const raster::TiledRaster& page,
+        int dpi,
+        std::vector<BandCheckpoint>& checkpoints) override;
+
     std::vector<uint8_t> generate_footer() override;
 
+    // Gera os traços vetoriais da página (PU/PD ASCII ou PE)
+    std::vector<uint8_t> generate_vector_page(const std::vector<Polyline>& strokes);
+
+    void set_polyline_encoding(bool enabled, int fraction_bits = 0, bool seven_bit = false);
+    bool polyline_encoding_enabled() const { return use_polyline_encoding_; }
+
+    void set_halftone(const raster::HalftoneOptions& options) { halftone_ = options; }
+    const raster::HalftoneOptions& halftone() const { return halftone_; }
+
+    void set_stroke_optimization(bool enabled, const StrokeOptimizerOptions& options = {});
+    const StrokeOptimizationReport& last_stroke_report() const { return last_stroke_report_; }
+
     bool validate_media_size(MediaSize size) const override;
     bool validate_resolution(int dpi) const override;
     bool validate_color_mode(ColorMode mode) const override;
@@ -59,6 +111,17 @@ public:
         const std::vector<uint8_t>& data) override;
 
     bool needs_preprocessing() const override;
+
+    // Quirk rtl_band_resume: o raster RTL pode ser reaberto com a altura
+    // restante e continuado da faixa seguinte à última confirmada
+    bool supports_band_resume() const override { return band_resume_; }
+    std::vector<uint8_t> generate_resume_prefix(
+        const std::vector<uint8_t>& header,
+        const BandCheckpoint& checkpoint,
+        int dpi) override;
+
+    void apply_quirks(const std::map<std::string, std::string>& quirks) override;
+    void prepare_for_reuse() override;
 };
 
 }  // namespace protocols
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "protocols/vector_path.h"
+#include "raster/path_fill.h"
+#include "raster/tiled_raster.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace all_press {
+namespace protocols {
+
+// Item da display list, em unidades de plotter (y para cima) e na ordem de
+// desenho: o traço de uma polilinha ou um polígono preenchido
+struct HpglShape {
+    bool fill = false;
+    bool even_odd = true;                        // Regra de FP (par-ímpar é o padrão)
+    std::vector<std::vector<PlotPoint>> paths;   // Traço: uma polilinha; área: contornos
+    double width_mm = 0.0;                       // Largura da pena no traço
+    std::array<uint8_t, 3> rgb = {0, 0, 0};
+};
+
+struct HpglDisplayList {
+    std::vector<HpglShape> shapes;
+    // Extensão do desenho, incluindo meia largura de pena
+    double min_x = 0.0;
+    double min_y = 0.0;
+    double max_x = 0.0;
+    double max_y = 0.0;
+    size_t commands = 0;
+    size_t unsupported = 0;   // Reconhecidos mas não desenhados (LB, hachuras, RO)
+    size_t unknown = 0;       // Mnemônicos que não são HPGL/HPGL2
+
+    bool empty() const { return shapes.empty(); }
+    bool has_color() const;
+    // Recalcula a extensão a partir das formas
+    void update_bounds();
+    double width_mm() const { return (max_x - min_x) / PLOTTER_UNITS_PER_MM; }
+    double height_mm() const { return (max_y - min_y) / PLOTTER_UNITS_PER_MM; }
+};
+
+// Interpretador HPGL/HPGL2 em fluxo: PU/PD/PA/PR, PE, CI, AA/AR, EA/ER,
+// RA/RR, EW/WG, PM/FP/EP, SP/PW/PC/CR/WU, IP/SC e IN/DF. Textos de LB são
+// pulados e sequências PCL/RTL ignoradas; tipos de linha e hachuras saem
+// sólidos.
+class HpglInterpreter {
+public:
+    HpglInterpreter();
+
+    // Entrada em pedaços de qualquer tamanho; um comando partido entre dois
+    // pedaços espera pelo seguinte
+    void feed(const uint8_t* data, size_t size);
+
+    // Interpreta o que restou e devolve a display list; o interpretador
+    // volta ao estado inicial
+    HpglDisplayList finish();
+
+private:
+    struct Pen {
+        double width_mm;
+        std::array<uint8_t, 3> rgb;
+    };
+
+    std::vector<uint8_t> pending_;
+    HpglDisplayList list_;
+
+    // Estado gráfico
+    double x_ = 0.0;
+    double y_ = 0.0;
+    bool pen_down_ = false;
+    bool absolute_ = true;
+    int pen_ = 1;
+    std::map<int, Pen> pens_;                   // Só as penas alteradas por PW/PC
+    double default_width_mm_ = 0.35;
+    bool relative_width_ = false;               // WU1
+    std::array<double, 6> color_range_ = {0, 255, 0, 255, 0, 255};
+    uint8_t label_terminator_ = 0x03;
+
+    // Escala: plotter = offset + usuário * scale
+    PlotPoint p1_ = {0.0, 0.0};
+    PlotPoint p2_ = {10160.0, 7840.0};
+    std::vector<double> scaling_;               // Parâmetros do último SC
+    bool scaled_ = false;
+    double scale_x_ = 1.0;
+    double scale_y_ = 1.0;
+    double offset_x_ = 0.0;
+    double offset_y_ = 0.0;
+
+    std::vector<PlotPoint> stroke_;             // Polilinha em curso
+    bool polygon_mode_ = false;                 // PM0 .. PM2
+    std::vector<std::vector<PlotPoint>> polygon_;
+
+    size_t parse(const uint8_t* data, size_t size, bool final);
+    void execute(char a, char b, const std::vector<double>& params);
+    void polyline_encoded(const uint8_t* data, size_t size, size_t i);
+
+    void reset();
+    void update_scaling();
+    Pen& pen(int number);
+    PlotPoint to_plotter(double ux, double uy) const;
+
+    void move_to(double px, double py);
+    void flush_stroke();
+    void add_stroke(std::vector<PlotPoint> points);
+    void add_fill(std::vector<std::vector<PlotPoint>> contours, bool even_odd);
+    std::vector<PlotPoint> arc_points(double cx, double cy, double radius, double start_deg,
+                                      double sweep_deg, double chord_deg) const;
+};
+
+HpglDisplayList parse_hpgl(const uint8_t* data, size_t size);
+
+// Traços para HPGLGenerator::generate_vector_page: cada polilinha e contorno
+// de área (fechado) com a pena da paleta padrão mais próxima da cor. Áreas
+// saem só como contorno; formas brancas são omitidas.
+std::vector<Polyline> pen_strokes(const HpglDisplayList& list);
+
+// Lê o arquivo em blocos. Lança std::runtime_error se não abrir.
+HpglDisplayList parse_hpgl_file(const std::string& path);
+
+struct HpglRenderOptions {
+    int dpi = 100;
+    // Se > 0, a resolução é escolhida para o desenho caber em
+    // fit_width x fit_height pixels
+    int fit_width = 0;
+    int fit_height = 0;
+    double margin_mm = 0.0;
+    bool include_origin = false;    // Página a partir de (0, 0) do plotter, não da extensão
+    double min_stroke_px = 1.0;     // Traços finos continuam visíveis em prévias
+    raster::PixelFormat format = raster::PixelFormat::RGB8;
+    raster::PathRasterOptions raster;
+};
+
+// Rasteriza a display list com anti-aliasing. Lança std::invalid_argument
+// se ela estiver vazia.
+raster::TiledRaster render_hpgl(const HpglDisplayList& list, const HpglRenderOptions& options = {});
+
+// PDF vetorial de uma página do tamanho do desenho mais a margem. Lança
+// std::invalid_argument se a lista estiver vazia e std::runtime_error em
+// erro de escrita.
+void write_hpgl_pdf(const HpglDisplayList& list, const std::string& path, double margin_mm = 0.0);
+
+}  // namespace protocols
+}  // namespace all_press
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+namespace all_press {
+namespace protocols {
+namespace hpgl {
+
+// Leitura de baixo nível de programas HPGL/HPGL2, comum ao interpretador e à
+// previsão de tempo de plotagem
+
+constexpr uint8_t ESC = 0x1B;
+constexpr uint8_t ETX = 0x03;
+
+inline bool is_number_start(uint8_t c) {
+    return std::isdigit(c) || c == '-' || c == '+' || c == '.';
+}
+
+inline bool is_separator(uint8_t c) {
+    return c == ',' || c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Número decimal ASCII a partir de i; i para no primeiro caractere que não
+// faz parte dele
+inline double parse_decimal(const uint8_t* data, size_t size, size_t& i) {
+    char buffer[32];
+    size_t n = 0;
+    while (i < size && n + 1 < sizeof(buffer) && is_number_start(data[i])) {
+        buffer[n++] = static_cast<char>(data[i++]);
+    }
+    while (i < size && is_number_start(data[i])) ++i;  // Dígitos além da precisão útil
+    buffer[n] = '\0';
+    return std::strtod(buffer, nullptr);
+}
+
+inline std::vector<double> parse_parameters(const uint8_t* data, size_t size, size_t& i) {
+    std::vector<double> values;
+    while (i < size) {
+        const uint8_t c = data[i];
+        if (is_separator(c)) {
+            ++i;
+        } else if (is_number_start(c)) {
+            values.push_back(parse_decimal(data, size, i));
+        } else {
+            break;
+        }
+    }
+    return values;
+}
+
+// Sequência PCL/RTL: ESC, caractere de parâmetro, grupo e pares valor +
+// letra (minúscula continua, maiúscula termina); W/w traz dados binários.
+// Devolve a posição seguinte, que passa de size se os dados binários não
+// couberem no trecho.
+inline size_t skip_escape(const uint8_t* data, size_t size, size_t i) {
+    size_t j = i + 1;
+    if (j >= size) {
+        return j;
+    }
+    if (data[j] < 0x21 || data[j] > 0x2F) {
+        return j + 1;
+    }
+    ++j;
+    if (j < size && data[j] >= 0x60 && data[j] <= 0x7E) {
+        ++j;
+    }
+    while (j < size) {
+        double value = 0.0;
+        if (is_number_start(data[j])) {
+            value = parse_decimal(data, size, j);
+        }
+        if (j >= size) {
+            return size + 1;
+        }
+        const uint8_t terminator = data[j++];
+        if (terminator == 'W' || terminator == 'w') {
+            j += static_cast<size_t>(std::max(0.0, value));
+        }
+        if (terminator < 0x60 || terminator > 0x7E) {
+            return j;
+        }
+    }
+    return std::max(j, size + 1);
+}
+
+// Número PE (ver PECoordinateEmitter): dígitos do menos significativo, sinal
+// no bit 0
+inline bool decode_pe_number(const uint8_t* data, size_t size, size_t& i, bool seven_bit,
+                             long long& value) {
+    const unsigned base = seven_bit ? 32u : 64u;
+    const unsigned terminator = seven_bit ? 95u : 191u;
+    unsigned long long folded = 0;
+    unsigned long long scale = 1;
+    while (i < size) {
+        const unsigned c = data[i];
+        if (c >= terminator && c < terminator + base) {
+            ++i;
+            folded += (c - terminator) * scale;
+            value = (folded & 1u) ? -static_cast<long long>(folded >> 1)
+                                  : static_cast<long long>(folded >> 1);
+            return true;
+        }
+        if (c < 63 || c >= 63 + base) {
+            return false;
+        }
+        ++i;
+        folded += (c - 63) * scale;
+        scale *= base;
+    }
+    return false;
+}
+
+}  // namespace hpgl
+}  // namespace protocols
+}  // namespace all_press
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "plotter_protocol_base.h"
+#include <cstdint>
+
+namespace all_press {
+namespace protocols {
+
+// Handler para plotters com interpretador PDF nativo: o documento original
+// é enviado sem rasterização nem re-codificação, opcionalmente envolto em
+// um job ticket PJL.
+class PDFPassthroughGenerator : public PlotterProtocolBase {
+private:
+    PlotterCapabilities capabilities_;
+    PlotterVendor target_vendor_;
+    bool use_pjl_;  // Envolver o PDF em comandos PJL (UEL + @PJL ... )
+
+    // Atributos extras do job ticket (@PJL SET CHAVE=VALOR)
+    std::map<std::string, std::string> job_ticket_;
+
+    // Nomes PJL de tamanho de papel
+    std::map<MediaSize, std::string> pjl_paper_map_ = {
+        {MediaSize::A0, "A0"},
+        {MediaSize::A1, "A1"},
+        {MediaSize::A2, "A2"},
+        {MediaSize::A3, "A3"},
+        {MediaSize::A4, "A4"},
+        {MediaSize::LETTER, "LETTER"},
+        {MediaSize::LEGAL, "LEGAL"},
+        {MediaSize::TABLOID, "LEDGER"}
+    };
+
+public:
+    explicit PDFPassthroughGenerator(PlotterVendor vendor, bool use_pjl = true);
+
+    // Job ticket
+    void set_job_ticket_attribute(const std::string& key, const std::string& value);
+    void clear_job_ticket();
+
+    std::vector<uint8_t> generate_header(
+        const PlotterCapabilities& caps,
+        MediaSize media_size,
+        ColorMode color_mode,
+        int dpi) override;
+
+    // Em modo passthrough a "página" é o próprio documento PDF; lança
+    // std::invalid_argument sem a assinatura %PDF-
+    std::vector<uint8_t> generate_page(
+        const std::vector<uint8_t>& raster_data,
+        int width,
+        int height,
+        int dpi) override;
+
+    std::vector<uint8_t> generate_footer() override;
+
+    bool validate_media_size(MediaSize size) const override;
+    bool validate_resolution(int dpi) const override;
+    bool validate_color_mode(ColorMode mode) const override;
+
+    std::string get_protocol_name() const override;
+    PlotterCapabilities get_capabilities() const override;
+
+    std::vector<uint8_t> optimize_for_vendor(
+        const std::vector<uint8_t>& data) override;
+
+    bool needs_preprocessing() const override;
+    bool supports_passthrough() const override;
+    void apply_quirks(const std::map<std::string, std::string>& quirks) override;
+    void prepare_for_reuse() override;
+
+    // Envia o arquivo para out_fd sem cópia em espaço de usuário
+    // (sendfile no Linux, read/write como fallback). Retorna bytes enviados.
+    // Destino não bloqueante é esperado com poll. Lança std::runtime_error se
+    // o arquivo não tiver a assinatura %PDF- ou acabar antes do tamanho
+    // visto na abertura.
+    static uint64_t stream_file(const std::string& path, int out_fd);
+
+    // Escreve o buffer inteiro em out_fd, tratando escritas parciais
+    static void write_all(int out_fd, const std::vector<uint8_t>& data);
+};
+
+}  // namespace protocols
+}  // namespace all_press
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "raster/tiled_raster.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace all_press {
+namespace protocols {
+
+// Velocidades de um modelo: speed_reference (por tipo de cabeça) do
+// plotter_specs.json, sobrescrito pelo bloco speed do modelo
+struct PlotSpeeds {
+    double pen_down_mm_s = 300.0;
+    double pen_up_mm_s = 600.0;
+    double command_s = 0.0005;      // Custo fixo por comando (interpretação, aceleração)
+    double pen_change_s = 0.0;
+    double print_mm_s = 20.0;       // Avanço da mídia imprimindo em uma passada
+    double feed_mm_s = 120.0;       // Avanço sem tinta
+    double ink_s_per_m2 = 15.0;     // Secagem por m² de tinta
+    double job_overhead_s = 25.0;   // Carga, cabeçalho e corte
+    std::vector<int> passes = {1, 2, 4, 6, 8};   // Por qualidade 1-5
+
+    int passes_for_quality(int quality) const;
+};
+
+// Percurso de um programa HPGL/HPGL2 em mm. Entende PU/PD/PA/PR, PE
+// (polyline encoded), CI, AA/AR, EA/ER/RA/RR, SP e IN; textos de LB são
+// pulados e sequências PCL/RTL (com dados binários de ESC*b#W) ignoradas.
+struct HpglPlotStats {
+    double pen_down_mm = 0.0;
+    double pen_up_mm = 0.0;
+    size_t commands = 0;
+    size_t pen_lifts = 0;      // Trechos com caneta abaixada
+    size_t pen_changes = 0;
+};
+
+HpglPlotStats analyze_hpgl(const uint8_t* data, size_t size);
+
+// Página raster como o dispositivo a percorre: linhas com tinta a
+// print_mm_s / passadas, linhas em branco no avanço livre
+struct RasterPlotStats {
+    double media_length_mm = 0.0;
+    double inked_length_mm = 0.0;
+    double ink_area_m2 = 0.0;      // Área de pixels com tinta (amostrada)
+    int passes = 1;
+};
+
+// Tiles em branco não são decodificados; a área com tinta é contada em uma
+// linha a cada dpi/100 para não custar uma passada inteira sobre os pixels
+RasterPlotStats analyze_raster(const raster::TiledRaster& page, int dpi, int passes,
+                               int tolerance = 8);
+
+RasterPlotStats& operator+=(RasterPlotStats& total, const RasterPlotStats& page);
+
+double predict_plot_seconds(const HpglPlotStats& stats, const PlotSpeeds& speeds);
+double predict_plot_seconds(const RasterPlotStats& stats, const PlotSpeeds& speeds);
+
+// Correção por modelo aprendida dos tempos reais: real ≈ k · previsto, por
+// mínimos quadrados com esquecimento exponencial (deriva de cabeça,
+// firmware). Thread-safe; persistida em JSON.
+class PlotTimeCalibration {
+public:
+    explicit PlotTimeCalibration(double forgetting = 0.95);
+
+    void observe(const std::string& model, double predicted_s, double actual_s);
+
+    // 1.0 até haver observações; limitado a [0.1, 10]
+    double factor(const std::string& model) const;
+    double calibrate(const std::string& model, double predicted_s) const;
+    size_t observations(const std::string& model) const;
+
+    // Lançam std::runtime_error em erro de leitura, escrita ou formato
+    void load(const std::string& path);
+    void save(const std::string& path) const;
+
+private:
+    struct Fit {
+        double sum_xy = 0.0;
+        double sum_xx = 0.0;
+        size_t count = 0;
+    };
+
+    double forgetting_;
+    mutable std::mutex mutex_;
+    std::map<std::string, Fit> fits_;
+};
+
+}  // namespace protocols
+}  // namespace all_press
@@ -4,6 +4,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include "raster/tiled_raster.h"
 
 namespace all_press {
 namespace protocols {
@@ -42,6 +43,15 @@ struct PlotterCapabilities {
     std::map<std::string, std::string> custom_attributes;
 };
 
+// Início de uma faixa no fluxo codificado de uma página: a transmissão pode
+// recomeçar daqui sem recodificar nada do que veio antes
+struct BandCheckpoint {
+    int row = 0;            // Primeira linha da faixa
+    int page_width = 0;
+    int page_height = 0;
+    size_t offset = 0;      // Byte no fluxo onde a faixa começa
+};
+
 class PlotterProtocolBase {
 public:
     virtual ~PlotterProtocolBase() = default;
@@ -59,6 +69,25 @@ public:
         int height,
         int dpi) = 0;
 
+    // Página em tiles; a implementação padrão achata o raster e delega a
+    // generate_page. Geradores que consomem faixas sobrescrevem.
+    virtual std::vector<uint8_t> generate_raster_page(
+        const raster::TiledRaster& page,
+        int dpi) {
+        return generate_page(page.to_buffer(), page.width(), page.height(), dpi);
+    }
+
+    // Como a anterior, acrescentando a checkpoints um ponto de retomada por
+    // faixa (offsets relativos ao vetor devolvido). A implementação padrão
+    // só marca o início da página.
+    virtual std::vector<uint8_t> generate_raster_page(
+        const raster::TiledRaster& page,
+        int dpi,
+        std::vector<BandCheckpoint>& checkpoints) {
+        checkpoints.push_back(BandCheckpoint{0, page.width(), page.height(), 0});
+        return generate_raster_page(page, dpi);
+    }
+
     virtual std::vector<uint8_t> generate_footer() = 0;
 
     // Validação de compatibilidade
@@ -70,11 +99,36 @@ public:
     virtual std::string get_protocol_name() const = 0;
     virtual PlotterCapabilities get_capabilities() const = 0;
 
-    // Otimizações específicas
+    // Otimizações específicas; aplicada a cada pedaço da saída (header,
+    // cada página, footer), não ao fluxo inteiro
     virtual std::vector<uint8_t> optimize_for_vendor(
         const std::vector<uint8_t>& data) = 0;
 
     virtual bool needs_preprocessing() const = 0;
+
+    // Protocolos que aceitam o documento original sem conversão
+    virtual bool supports_passthrough() const { return false; }
+
+    // Dispositivo que mantém a página parcial depois de uma falha e aceita
+    // continuar a partir de uma faixa: a retransmissão envia
+    // generate_resume_prefix seguido dos bytes a partir de checkpoint.offset.
+    // O dispositivo pode ter sido reiniciado, então o prefixo começa pelo
+    // header do job (o que generate_header devolveu).
+    virtual bool supports_band_resume() const { return false; }
+
+    virtual std::vector<uint8_t> generate_resume_prefix(
+        const std::vector<uint8_t>& header,
+        const BandCheckpoint& /*checkpoint*/,
+        int /*dpi*/) {
+        return header;
+    }
+
+    // Ajustes por modelo vindos de CompatibilityMatrix::get_quirks
+    virtual void apply_quirks(const std::map<std::string, std::string>& /*quirks*/) {}
+
+    // Chamado ao devolver o handler ao pool: limpa estado do job anterior,
+    // mantendo tabelas, quirks e buffers de rascunho
+    virtual void prepare_for_reuse() {}
 };
 
 }  // namespace protocols
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "plotter_protocol_base.h"
+#include "encoder_kernels.h"
 #include <sstream>
 
 namespace all_press {
@@ -10,6 +11,8 @@ class PostScriptGenerator : public PlotterProtocolBase {
 private:
     PlotterCapabilities capabilities_;
     PlotterVendor target_vendor_;
+    ColorMode color_mode_ = ColorMode::MONOCHROME;  // Definido em generate_header
+    RowScratch scratch_;  // Reaproveitado entre páginas e jobs (pool)
     
     // Mapeamento de tamanho em PostScript (em pontos)
     std::map<MediaSize, std::pair<float, float>> media_dimensions_ = {
@@ -23,6 +26,10 @@ private:
         {MediaSize::TABLOID, {792, 1224}}
     };
 
+    // gsave, escala em pontos e dicionário de image com RunLengthDecode
+    void append_image_prologue(std::vector<uint8_t>& out, int width, int height,
+                               int dpi, int components) const;
+
 public:
     PostScriptGenerator(PlotterVendor vendor);
 
@@ -38,6 +45,10 @@ public:
         int height,
         int dpi) override;
 
+    std::vector<uint8_t> generate_raster_page(
+        const raster::TiledRaster& page,
+        int dpi) override;
+
     std::vector<uint8_t> generate_footer() override;
 
     bool validate_media_size(MediaSize size) const override;
@@ -51,6 +62,7 @@ public:
         const std::vector<uint8_t>& data) override;
 
     bool needs_preprocessing() const override;
+    void prepare_for_reuse() override;
 };
 
 }  // namespace protocols
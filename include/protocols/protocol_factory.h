@@ -3,6 +3,7 @@
 #include "plotter_protocol_base.h"
 #include "hpgl_generator.h"
 #include "postscript_generator.h"
+#include "pdf_passthrough.h"
 #include "compatibility_matrix.h"
 #include <memory>
 #include <stdexcept>
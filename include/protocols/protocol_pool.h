@@ -0,0 +1,127 @@
+#pragma once
+
+#include "plotter_protocol_base.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace all_press {
+namespace protocols {
+
+class ProtocolHandlerPool;
+
+// Handler emprestado do pool; devolvido automaticamente no destrutor
+class ProtocolLease {
+public:
+    ProtocolLease() = default;
+    ~ProtocolLease();
+
+    ProtocolLease(ProtocolLease&& other) noexcept;
+    ProtocolLease& operator=(ProtocolLease&& other) noexcept;
+    ProtocolLease(const ProtocolLease&) = delete;
+    ProtocolLease& operator=(const ProtocolLease&) = delete;
+
+    PlotterProtocolBase* get() const { return handler_.get(); }
+    PlotterProtocolBase* operator->() const { return handler_.get(); }
+    PlotterProtocolBase& operator*() const { return *handler_; }
+    explicit operator bool() const { return handler_ != nullptr; }
+
+    // Devolve o handler antes do fim do escopo
+    void release();
+
+private:
+    friend class ProtocolHandlerPool;
+
+    using FreeList = std::vector<std::unique_ptr<PlotterProtocolBase>>;
+
+    ProtocolLease(ProtocolHandlerPool* pool, FreeList* slot,
+                  std::unique_ptr<PlotterProtocolBase> handler, size_t generation)
+        : pool_(pool), slot_(slot), handler_(std::move(handler)), generation_(generation) {}
+
+    ProtocolHandlerPool* pool_ = nullptr;
+    FreeList* slot_ = nullptr;  // Lista livre da chave, estável no std::map
+    std::unique_ptr<PlotterProtocolBase> handler_;
+    size_t generation_ = 0;     // Geração do pool quando o handler foi criado
+};
+
+struct ProtocolPoolStats {
+    size_t checkouts = 0;
+    size_t reused = 0;       // Checkouts atendidos sem construir handler
+    size_t created = 0;
+    size_t idle = 0;
+};
+
+// Pool thread-safe de handlers por (vendor, modelo, protocolo). Um handler
+// emprestado mantém tabelas, quirks e buffers de rascunho entre jobs; um
+// checkout de chave já vista não aloca. O pool deve viver mais que os
+// leases emitidos.
+class ProtocolHandlerPool {
+public:
+    explicit ProtocolHandlerPool(size_t max_idle_per_key = 8);
+
+    // Protocolo recomendado pela CompatibilityMatrix, com quirks do modelo
+    ProtocolLease checkout(PlotterVendor vendor, std::string_view model);
+
+    // Protocolo explícito (ex: fallback), com quirks do modelo
+    ProtocolLease checkout(PlotterVendor vendor, std::string_view model,
+                           std::string_view protocol);
+
+    // Descarta handlers ociosos (ex: após recarregar a matriz). Handlers
+    // emprestados antes disso são descartados na devolução.
+    void clear();
+
+    ProtocolPoolStats stats() const;
+
+private:
+    friend class ProtocolLease;
+
+    struct Key {
+        PlotterVendor vendor;
+        std::string model;
+        std::string protocol;  // Vazio = protocolo recomendado
+    };
+
+    struct KeyView {
+        PlotterVendor vendor;
+        std::string_view model;
+        std::string_view protocol;
+    };
+
+    // Comparação heterogênea: busca por string_view sem construir Key
+    struct KeyLess {
+        using is_transparent = void;
+
+        template <typename A, typename B>
+        bool operator()(const A& a, const B& b) const {
+            if (a.vendor != b.vendor) {
+                return a.vendor < b.vendor;
+            }
+            int cmp = view(a.model).compare(view(b.model));
+            if (cmp != 0) {
+                return cmp < 0;
+            }
+            return view(a.protocol) < view(b.protocol);
+        }
+
+        static std::string_view view(const std::string& s) { return s; }
+        static std::string_view view(std::string_view s) { return s; }
+    };
+
+    void give_back(ProtocolLease::FreeList* slot,
+                   std::unique_ptr<PlotterProtocolBase> handler, size_t generation);
+
+    size_t max_idle_per_key_;
+    mutable std::mutex mutex_;
+    size_t generation_ = 0;   // Incrementada em clear(); protegida por mutex_
+    std::map<Key, ProtocolLease::FreeList, KeyLess> free_lists_;
+
+    std::atomic<size_t> checkouts_{0};
+    std::atomic<size_t> reused_{0};
+    std::atomic<size_t> created_{0};
+};
+
+}  // namespace protocols
+}  // namespace all_press
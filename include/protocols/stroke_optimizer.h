@@ -0,0 +1,62 @@
+#pragma once
+
+#include "vector_path.h"
+#include <chrono>
+#include <cstddef>
+
+namespace all_press {
+namespace protocols {
+
+struct StrokeOptimizerOptions {
+    // Extremidades mais próximas que isso são consideradas contíguas
+    double merge_tolerance = 0.5;        // unidades de plotter
+    // Desvio máximo para remover um ponto intermediário colinear
+    double collinear_tolerance = 0.25;   // unidades de plotter
+    // Permite desenhar um traço no sentido inverso (desligar para cortadoras)
+    bool allow_reversal = true;
+    // Vizinhança de cada traço avaliada pelo 2-opt
+    size_t two_opt_window = 32;
+    size_t two_opt_passes = 2;
+    std::chrono::milliseconds time_budget{2000};
+
+    // Parâmetros para estimativa de tempo de plotagem
+    double pen_down_speed_mm_s = 400.0;
+    double pen_up_speed_mm_s = 800.0;
+    double pen_lift_time_s = 0.02;       // por subida/descida de caneta
+};
+
+struct StrokeOptimizationReport {
+    size_t strokes_before = 0;
+    size_t strokes_after = 0;
+    size_t segments_before = 0;
+    size_t segments_after = 0;
+    double pen_up_mm_before = 0.0;
+    double pen_up_mm_after = 0.0;
+    double pen_down_mm = 0.0;
+    double estimated_seconds_before = 0.0;
+    double estimated_seconds_after = 0.0;
+    bool time_budget_exhausted = false;
+};
+
+// Reordena e inverte traços para minimizar o deslocamento com a caneta
+// levantada (vizinho mais próximo sobre grade espacial + 2-opt), une
+// traços contíguos e colineares e descarta movimentos de comprimento zero.
+class StrokeOptimizer {
+public:
+    explicit StrokeOptimizer(StrokeOptimizerOptions options = {});
+
+    StrokeOptimizationReport optimize(std::vector<Polyline>& strokes) const;
+
+    // Deslocamento com caneta levantada partindo da origem (unidades de plotter)
+    static double pen_up_distance(const std::vector<Polyline>& strokes);
+    static double pen_down_distance(const std::vector<Polyline>& strokes);
+
+private:
+    StrokeOptimizerOptions options_;
+
+    double estimate_seconds(double pen_down_units, double pen_up_units,
+                            size_t strokes) const;
+};
+
+}  // namespace protocols
+}  // namespace all_press
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "protocols/hpgl_interpreter.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace all_press {
+namespace protocols {
+
+struct SvgReadOptions {
+    double tolerance_mm = 0.02;   // Desvio máximo ao achatar curvas e arcos
+};
+
+// SVG achatado na mesma display list do HPGL (unidades de plotter, y para
+// cima): render_hpgl rasteriza com anti-aliasing, write_hpgl_pdf gera PDF e
+// pen_strokes dá os traços para o HPGLGenerator. Lê path (todos os
+// comandos), rect, circle, ellipse, line, polyline e polygon com transform,
+// fill/stroke/stroke-width/fill-rule/opacidade por atributo ou style e
+// herança por <g>. width/height/viewBox definem o tamanho em mm (px a 96 dpi).
+// text, image, use e gradientes contam em unsupported (gradiente sai cinza);
+// elementos desconhecidos em unknown. Lança std::runtime_error se não houver
+// elemento <svg>.
+HpglDisplayList read_svg(const uint8_t* data, size_t size, const SvgReadOptions& options = {});
+
+// Lança std::runtime_error se o arquivo não abrir
+HpglDisplayList read_svg_file(const std::string& path, const SvgReadOptions& options = {});
+
+}  // namespace protocols
+}  // namespace all_press
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+
+namespace all_press {
+namespace protocols {
+
+// Unidades de plotter HPGL: 1 unidade = 0.025 mm
+constexpr double PLOTTER_UNITS_PER_MM = 40.0;
+
+struct PlotPoint {
+    double x;  // em unidades de plotter
+    double y;
+};
+
+// Traço contínuo com a caneta abaixada
+struct Polyline {
+    std::vector<PlotPoint> points;
+    int pen = 1;
+};
+
+}  // namespace protocols
+}  // namespace all_press
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "tiled_raster.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace all_press {
+namespace raster {
+
+enum class ToneChannel {
+    GRAY,
+    RED,
+    GREEN,
+    BLUE,
+    CYAN,
+    MAGENTA,
+    YELLOW,
+    BLACK
+};
+
+constexpr int TONE_CHANNELS = 8;
+
+// "gray", "red", "green", "blue", "cyan", "magenta", "yellow", "black"
+const char* tone_channel_name(ToneChannel channel);
+ToneChannel parse_tone_channel(const std::string& name);  // Lança std::invalid_argument
+
+// Curva de tom sobre o valor de código normalizado x em [0, 1]:
+// y = offset + gain * x^gamma, saturado em [0, 1]
+struct ToneCurve {
+    double gamma = 1.0;
+    double gain = 1.0;
+    double offset = 0.0;
+
+    bool is_identity() const { return gamma == 1.0 && gain == 1.0 && offset == 0.0; }
+};
+
+using ToneCurves = std::array<ToneCurve, TONE_CHANNELS>;
+
+// Curvas de calibração de uma impressora compiladas em tabelas 1D por canal
+// (256 entradas para 8 bits, 65536 para 16 bits). Imutável: recalibrar gera
+// uma nova instância com versão maior, e quem está no meio de um job segue
+// com a que já tem.
+class CalibrationLut {
+public:
+    static std::shared_ptr<const CalibrationLut> build(const ToneCurves& curves,
+                                                       uint64_t version = 0);
+
+    uint64_t version() const { return version_; }
+    const ToneCurve& curve(ToneChannel channel) const;
+
+    const uint8_t* table8(ToneChannel channel) const;
+    // nullptr para canais identidade
+    const uint16_t* table16(ToneChannel channel) const;
+
+    bool is_identity(PixelFormat format) const;
+    // Não-decrescente: permite dobrar a curva em limiares de meio-tom
+    bool is_monotonic(ToneChannel channel) const;
+    // Pixel sem tinta continua sem tinta (blank_byte)
+    bool preserves_blank(PixelFormat format) const;
+
+    // Pixels entrelaçados no formato dado, no lugar. Canais do formato:
+    // GRAY8 -> gray; RGB8 -> red, green, blue; CMYK8 -> cyan, magenta, yellow, black
+    void apply(uint8_t* pixels, PixelFormat format, size_t count) const;
+    void apply16(uint16_t* samples, PixelFormat format, size_t count) const;
+
+private:
+    CalibrationLut() = default;
+
+    uint64_t version_ = 0;
+    ToneCurves curves_;
+    std::vector<uint8_t> tables8_;                     // TONE_CHANNELS x 256
+    std::array<std::vector<uint16_t>, TONE_CHANNELS> tables16_;
+};
+
+// Canais de tom de cada formato de pixel, na ordem das amostras
+int tone_channels(PixelFormat format, ToneChannel* channels);
+
+// Kernel de linha com uma tabela: data[i] = table[data[i]].
+// AVX2/SSSE3 (pshufb em 16 subtabelas) ou NEON (tbl/tbx), com fallback escalar.
+void apply_lut8(const uint8_t* table, uint8_t* data, size_t count);
+
+}  // namespace raster
+}  // namespace all_press
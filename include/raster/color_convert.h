@@ -0,0 +1,74 @@
+#pragma once
+
+#include "calibration.h"
+#include "tiled_raster.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace all_press {
+namespace raster {
+
+// Separação RGB -> CMYK
+struct CmykSeparation {
+    // GCR: porcentagem do componente cinza (min de C, M, Y) trocada por K
+    int black_generation = 100;
+    // TAC: cobertura total de tinta em % (100..400); C, M e Y são reduzidos
+    // proporcionalmente, K é preservado
+    int total_ink_limit = 300;
+};
+
+// Kernels de linha. Usam SIMD (SSSE3/SSE2 ou NEON) quando disponível e têm
+// resultado idêntico às versões escalares de reference::.
+void rgb_to_gray8(const uint8_t* rgb, int width, uint8_t* gray);
+void rgb_to_gray16(const uint16_t* rgb, int width, uint16_t* gray);
+void rgb_to_cmyk8(const uint8_t* rgb, int width, uint8_t* cmyk,
+                  const CmykSeparation& separation = {});
+void cmyk_to_rgb8(const uint8_t* cmyk, int width, uint8_t* rgb);
+
+// Implementações escalares de referência (validação e benchmarks)
+namespace reference {
+void rgb_to_gray8(const uint8_t* rgb, int width, uint8_t* gray);
+void rgb_to_gray16(const uint16_t* rgb, int width, uint16_t* gray);
+void rgb_to_cmyk8(const uint8_t* rgb, int width, uint8_t* cmyk,
+                  const CmykSeparation& separation = {});
+void cmyk_to_rgb8(const uint8_t* cmyk, int width, uint8_t* rgb);
+}  // namespace reference
+
+struct ColorConvertOptions {
+    CmykSeparation separation;
+    unsigned threads = 0;   // Threads por faixa; 0 = hardware
+    int band_rows = 64;     // Linhas por faixa de buffers contíguos
+    // Curvas da impressora aplicadas a cada linha convertida, enquanto ela
+    // ainda está no cache (nullptr = sem calibração)
+    std::shared_ptr<const CalibrationLut> calibration;
+};
+
+// Conversão entre os formatos de PixelFormat, em paralelo por faixas.
+// CMYK -> RGB é uma aproximação sem perfil, para pré-visualização.
+class ColorConverter {
+public:
+    explicit ColorConverter(ColorConvertOptions options = {});
+
+    const ColorConvertOptions& options() const { return options_; }
+
+    void convert_row(const uint8_t* src, PixelFormat from,
+                     uint8_t* dst, PixelFormat to, int width) const;
+
+    // Buffers contíguos sem padding
+    void convert(const uint8_t* src, PixelFormat from,
+                 uint8_t* dst, PixelFormat to, int width, int height) const;
+
+    // Nova página no formato pedido, com o mesmo tile_size da origem
+    TiledRaster convert(const TiledRaster& page, PixelFormat to,
+                        TiledRasterOptions options = {}) const;
+
+private:
+    ColorConvertOptions options_;
+
+    unsigned thread_count(int bands) const;
+    const CalibrationLut* active_calibration(PixelFormat to) const;
+};
+
+}  // namespace raster
+}  // namespace all_press
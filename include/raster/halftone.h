@@ -0,0 +1,81 @@
+#pragma once
+
+#include "calibration.h"
+#include "tiled_raster.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace all_press {
+namespace raster {
+
+enum class HalftoneMethod {
+    THRESHOLD,        // Limiar fixo em 128
+    BAYER,            // Ordenado, matriz de Bayer 8x8
+    BLUE_NOISE,       // Ordenado, máscara blue-noise 64x64 (void-and-cluster)
+    FLOYD_STEINBERG,  // Difusão de erro
+    JARVIS            // Difusão de erro Jarvis-Judice-Ninke
+};
+
+// "bayer", "blue_noise", "floyd_steinberg", "jarvis", "threshold"
+HalftoneMethod parse_halftone_method(const std::string& name);
+
+struct HalftoneOptions {
+    HalftoneMethod method = HalftoneMethod::BLUE_NOISE;
+    // Threads da difusão de erro (frente de onda por linhas); 0 = hardware
+    unsigned threads = 0;
+    // Curva de cinza da impressora. Em matrizes ordenadas, curvas monotônicas
+    // que preservam o branco são dobradas nos limiares (custo zero por pixel);
+    // nos demais casos a tabela é consultada pixel a pixel na mesma passada.
+    std::shared_ptr<const CalibrationLut> calibration;
+};
+
+// Linha de 1 bit empacotada, MSB primeiro, bit 1 = tinta (mesma convenção
+// do HP RTL). Bits de preenchimento do último byte são sempre 0.
+inline size_t packed_row_bytes(int width) {
+    return (static_cast<size_t>(width) + 7) / 8;
+}
+
+// Recebe as linhas em ordem de y
+using PackedRowSink = std::function<void(int y, const uint8_t* packed)>;
+
+// Meio-tom de páginas em tons de cinza para dispositivos bilevel.
+// Matrizes ordenadas usam SIMD (AVX2/SSE2/NEON, com fallback escalar);
+// a difusão de erro processa linhas em paralelo em frente de onda, com
+// resultado idêntico ao sequencial.
+class Halftoner {
+public:
+    explicit Halftoner(HalftoneOptions options = {});
+
+    HalftoneMethod method() const { return options_.method; }
+
+    // Página GRAY8 inteira, faixa a faixa
+    void process(const TiledRaster& page, const PackedRowSink& sink) const;
+
+    // Buffer contíguo GRAY8; out recebe height * packed_row_bytes(width)
+    void process(const uint8_t* gray, int width, int height, size_t stride,
+                 uint8_t* out) const;
+
+    // Uma linha com matriz ordenada (ou limiar); y seleciona a linha da matriz
+    void ordered_row(const uint8_t* gray, int width, int y, uint8_t* out) const;
+
+private:
+    HalftoneOptions options_;
+    int matrix_size_ = 0;             // Período da matriz (potência de 2)
+    int period_ = 0;                  // Linha de limiar replicada até múltiplo de 32
+    std::vector<uint8_t> thresholds_; // matrix_size_ linhas de period_ bytes
+    const uint8_t* tone_ = nullptr;   // Tabela de cinza não dobrada nos limiares
+    bool blank_stays_blank_ = true;   // Branco (255) continua sem tinta
+
+    bool is_ordered() const;
+    void ordered_span(const uint8_t* gray, int width, const uint8_t* t, uint8_t* out) const;
+    void diffuse(const uint8_t* gray, int width, int rows, size_t stride,
+                 int first_row, std::vector<int32_t>& errors, int ring,
+                 uint8_t* out) const;
+};
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "icc_profile.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace all_press {
+namespace raster {
+
+// Arquivo mapeado em memória, somente leitura
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path);  // Lança std::runtime_error
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<uint8_t> fallback_;   // Plataformas sem mmap
+};
+
+struct IccCatalogEntry {
+    std::string path;
+    std::string name;        // Nome do arquivo sem extensão
+    uint64_t file_size = 0;
+    int64_t mtime_ns = 0;
+    IccProfileInfo info;
+};
+
+struct IccCatalogOptions {
+    std::string index_path;  // Índice persistido entre execuções; vazio = sem índice
+    unsigned threads = 0;    // Threads na varredura; 0 = hardware
+};
+
+struct IccCatalogScanStats {
+    size_t files = 0;        // Arquivos .icc/.icm encontrados
+    size_t parsed = 0;       // Cabeçalhos lidos nesta varredura
+    size_t reused = 0;       // Entradas do índice com mesmo tamanho e mtime
+    size_t invalid = 0;
+};
+
+// Catálogo de perfis ICC de diretórios do sistema. A varredura é paralela e
+// lê só cabeçalho, tabela de tags e descrição de cada arquivo (via mmap);
+// as tabelas de cor são interpretadas no primeiro profile(). Arquivos sem
+// mudança de tamanho/mtime vêm do índice persistido, sem serem abertos.
+class IccCatalog {
+public:
+    explicit IccCatalog(IccCatalogOptions options = {});
+
+    // Varre os diretórios recursivamente e substitui o conteúdo do catálogo.
+    // Em nomes repetidos vale o primeiro diretório da lista.
+    IccCatalogScanStats scan(const std::vector<std::string>& directories);
+
+    std::vector<IccCatalogEntry> entries() const;
+    size_t size() const;
+
+    // Busca por nome ou caminho
+    bool find(const std::string& name, IccCatalogEntry& entry) const;
+
+    // Perfil completo, interpretado na primeira chamada e mantido em cache.
+    // Lança std::runtime_error se o perfil não existe ou é inválido.
+    std::shared_ptr<const IccProfile> profile(const std::string& name) const;
+
+    // Cabeçalho e tabela de tags de um arquivo; lança std::runtime_error
+    static IccCatalogEntry inspect_file(const std::string& path);
+
+private:
+    struct Slot {
+        IccCatalogEntry entry;
+        std::once_flag parsed;
+        std::shared_ptr<const IccProfile> profile;
+    };
+
+    IccCatalogOptions options_;
+    mutable std::mutex mutex_;
+    std::map<std::string, std::shared_ptr<Slot>> by_path_;
+    std::unordered_map<std::string, std::string> by_name_;
+
+    std::shared_ptr<Slot> slot(const std::string& name) const;
+    std::unordered_map<std::string, IccCatalogEntry> load_index() const;
+    void save_index(const std::vector<IccCatalogEntry>& entries) const;
+};
+
+}  // namespace raster
+}  // namespace all_press
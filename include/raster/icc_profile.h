@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace all_press {
+namespace raster {
+
+enum class IccColorSpace {
+    GRAY,
+    RGB,
+    CMYK,
+    LAB,
+    XYZ,
+    OTHER
+};
+
+// Mesmos valores do campo de intenção do cabeçalho ICC
+enum class RenderingIntent {
+    PERCEPTUAL = 0,
+    RELATIVE_COLORIMETRIC = 1,
+    SATURATION = 2,
+    ABSOLUTE_COLORIMETRIC = 3
+};
+
+int icc_channels(IccColorSpace space);
+const char* icc_color_space_name(IccColorSpace space);  // "GRAY", "RGB", "CMYK", "Lab", "XYZ"
+
+struct IccHeader {
+    uint32_t size = 0;
+    int version_major = 0;
+    int version_minor = 0;
+    std::string device_class;    // "mntr", "prtr", "scnr", "spac", ...
+    IccColorSpace color_space = IccColorSpace::OTHER;
+    IccColorSpace pcs = IccColorSpace::XYZ;
+    RenderingIntent intent = RenderingIntent::PERCEPTUAL;
+};
+
+// Resumo lido só do cabeçalho, da tabela de tags e da descrição
+struct IccProfileInfo {
+    IccHeader header;
+    std::string description;
+    uint32_t tag_count = 0;
+};
+
+// Perfil ICC v2/v4 de dispositivo: matriz/TRC (RGB), TRC cinza ou tabelas
+// AToB/BToA (lut8, lut16, lutAtoB, lutBtoA). A avaliação é em double e serve
+// para compilar transformações (IccTransform); não é usada por pixel.
+class IccProfile {
+public:
+    ~IccProfile();
+
+    // Lançam std::runtime_error para perfis inválidos ou não suportados
+    static std::shared_ptr<const IccProfile> parse(const uint8_t* data, size_t size);
+    static std::shared_ptr<const IccProfile> load(const std::string& path);
+
+    // Valida cabeçalho e tabela de tags sem interpretar as tabelas de cor
+    static IccProfileInfo inspect(const uint8_t* data, size_t size);
+
+    // Perfis embutidos (sem arquivo)
+    static std::shared_ptr<const IccProfile> srgb();
+    static std::shared_ptr<const IccProfile> gray(double gamma = 2.2);
+
+    const IccHeader& header() const { return header_; }
+    IccColorSpace color_space() const { return header_.color_space; }
+    int channels() const { return icc_channels(header_.color_space); }
+    const std::string& description() const { return description_; }
+
+    // Identidade do conteúdo (FNV-1a dos bytes); chave do cache de transformações
+    uint64_t id() const { return id_; }
+
+    bool is_matrix_trc() const { return !trc_.empty(); }
+    bool can_output() const;
+
+    // Valores de dispositivo em [0, 1]; o PCS é sempre XYZ relativo a D50
+    // (Y = 1 no branco), convertido de/para Lab quando o perfil usa Lab
+    void to_pcs(const double* device, double* xyz, RenderingIntent intent) const;
+    void from_pcs(const double* xyz, double* device, RenderingIntent intent) const;
+
+    struct Curve;
+    struct Pipeline;
+
+private:
+    IccProfile();
+
+    IccHeader header_;
+    std::string description_;
+    uint64_t id_ = 0;
+    double white_point_[3] = {0.9642, 1.0, 0.8249};
+
+    // Matriz/TRC: colunas rXYZ, gXYZ, bXYZ e a inversa; cinza usa só trc_[0]
+    std::vector<Curve> trc_;
+    double matrix_[9] = {};
+    double inverse_[9] = {};
+
+    // AToB0..2 e BToA0..2 (intenção perceptual, colorimétrica, saturação)
+    std::unique_ptr<Pipeline> a2b_[3];
+    std::unique_ptr<Pipeline> b2a_[3];
+
+    const Pipeline* select(const std::unique_ptr<Pipeline> (&tables)[3],
+                           RenderingIntent intent) const;
+    void parse_tags(const uint8_t* data, size_t size);
+    void finish_matrix();
+};
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "calibration.h"
+#include "icc_profile.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace all_press {
+namespace raster {
+
+struct IccTransformOptions {
+    int grid_points = 33;   // Nós por eixo para entrada RGB; CMYK usa no máximo 17
+    unsigned threads = 0;   // Threads na compilação e em apply(); 0 = hardware
+    int band_rows = 64;     // Linhas por faixa em apply() de imagens
+};
+
+// Transformação (origem, destino, intenção) compilada numa grade 3D/4D de
+// floats, aplicada por interpolação tetraédrica com SIMD (SSE2 ou NEON) sobre
+// os canais de saída. Entrada de 1 canal usa uma tabela exata de 256 entradas.
+// Pixels de 8 bits, entrelaçados.
+class IccTransform {
+public:
+    // Lança std::invalid_argument para combinações não suportadas
+    static std::shared_ptr<const IccTransform> build(const IccProfile& source,
+                                                     const IccProfile& target,
+                                                     RenderingIntent intent,
+                                                     IccTransformOptions options = {});
+
+    int input_channels() const { return inputs_; }
+    int output_channels() const { return outputs_; }
+    int grid_points() const { return grid_; }
+
+    void apply(const uint8_t* in, uint8_t* out, size_t pixels) const;
+
+    // Imagem contígua sem padding, em paralelo por faixas. A calibração, se
+    // houver, é aplicada a cada linha logo após a transformação.
+    void apply(const uint8_t* in, uint8_t* out, int width, int height,
+               const CalibrationLut* calibration = nullptr) const;
+
+private:
+    IccTransform() = default;
+
+    int inputs_ = 0;
+    int outputs_ = 0;
+    int grid_ = 0;
+    IccTransformOptions options_;
+
+    // Nós com 4 floats (saída em 0..255, canais excedentes zerados)
+    std::vector<float> nodes_;
+    // Por valor de entrada: nó inferior e fração até o próximo
+    int index_[256] = {};
+    float fraction_[256] = {};
+    // Entrada de 1 canal: saída direta
+    std::vector<uint8_t> table_;
+
+    unsigned thread_count(int jobs) const;
+    void apply3(const uint8_t* in, uint8_t* out, size_t pixels) const;
+    void apply4(const uint8_t* in, uint8_t* out, size_t pixels) const;
+};
+
+// Cache LRU de transformações compiladas, chaveado pelo conteúdo dos perfis
+// (IccProfile::id), intenção e tamanho da grade. A compilação acontece fora
+// do lock; pedidos simultâneos da mesma chave esperam uma única compilação.
+class IccTransformCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t builds = 0;
+    };
+
+    explicit IccTransformCache(size_t capacity = 32);
+
+    static IccTransformCache& instance();
+
+    std::shared_ptr<const IccTransform> get(const IccProfile& source,
+                                            const IccProfile& target,
+                                            RenderingIntent intent,
+                                            IccTransformOptions options = {});
+
+    Stats stats() const;
+    size_t size() const;
+    void clear();
+
+private:
+    using Key = std::tuple<uint64_t, uint64_t, int, int>;
+
+    struct Entry {
+        Key key;
+        std::once_flag built;
+        std::shared_ptr<const IccTransform> transform;
+    };
+    using EntryList = std::list<std::shared_ptr<Entry>>;
+
+    size_t capacity_;
+    mutable std::mutex mutex_;
+    EntryList lru_;   // Mais recente na frente
+    std::map<Key, EntryList::iterator> index_;
+    Stats stats_;
+};
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "tiled_raster.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace all_press {
+namespace raster {
+
+// Imagem contígua em memória. Com 16 bits as amostras são uint16_t na ordem
+// de bytes nativa.
+struct Image {
+    int width = 0;
+    int height = 0;
+    PixelFormat format = PixelFormat::GRAY8;
+    int bit_depth = 8;             // 8 ou 16
+    std::vector<uint8_t> data;
+
+    size_t row_bytes() const {
+        return static_cast<size_t>(width) * bytes_per_pixel(format) * (bit_depth / 8);
+    }
+    const uint16_t* samples16() const { return reinterpret_cast<const uint16_t*>(data.data()); }
+    uint16_t* samples16() { return reinterpret_cast<uint16_t*>(data.data()); }
+};
+
+// Cabeçalho Netpbm: dimensões, formato e deslocamento dos pixels no arquivo
+struct PnmHeader {
+    int width = 0;
+    int height = 0;
+    PixelFormat format = PixelFormat::GRAY8;
+    int bit_depth = 8;
+    size_t data_offset = 0;
+};
+
+// Só o cabeçalho, sem ler os pixels. Lança std::runtime_error em erro.
+PnmHeader read_pnm_header(const std::string& path);
+
+// Netpbm binário: PGM (P5), PPM (P6) e PAM (P7, TUPLTYPE GRAYSCALE, RGB ou
+// CMYK), 8 ou 16 bits por amostra. Lança std::runtime_error em erro.
+Image read_pnm(const std::string& path);
+
+// Várias imagens concatenadas no mesmo arquivo (páginas), como permite o
+// formato Netpbm
+std::vector<Image> read_pnm_pages(const std::string& path);
+
+// Páginas de um arquivo Netpbm lidas em sequência, sem carregar o arquivo:
+// só as linhas pedidas passam pela memória, já em 8 bits. Lança
+// std::runtime_error em erro.
+class PnmPageReader {
+public:
+    explicit PnmPageReader(const std::string& path);
+
+    // Avança para a próxima página, pulando as linhas não lidas da atual;
+    // false no fim do arquivo
+    bool next_page();
+    const PnmHeader& header() const { return header_; }
+    int rows_read() const { return rows_read_; }
+
+    // Próximas rows linhas da página atual, width * bytes_per_pixel bytes
+    // cada (16 bits pelo byte mais significativo)
+    void read_rows(uint8_t* dst, int rows);
+
+    // Restante da página atual como imagem de 8 bits
+    Image read_page();
+
+private:
+    std::string path_;
+    std::ifstream in_;
+    PnmHeader header_;
+    bool in_page_ = false;
+    int rows_read_ = 0;
+    std::vector<uint8_t> wide_;     // Linhas de 16 bits antes da redução
+};
+
+// 16 bits -> 8 bits pelo byte mais significativo; 8 bits volta como está
+Image to_8bit(const Image& image);
+
+// CMYK sai como PAM; cinza e RGB como PGM/PPM
+void write_pnm(const std::string& path, const Image& image);
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "color_convert.h"
+#include "image_io.h"
+#include "tiled_raster.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace all_press {
+namespace raster {
+
+struct InkCoverageOptions {
+    // Erro máximo da cobertura média de cada canal (fração de 0 a 1) e a
+    // probabilidade de a estimativa ficar dentro dele
+    double max_error = 0.01;
+    double confidence = 0.99;
+    // Pixel colorido: max - min de R, G, B (ou de C, M, Y) acima disto
+    int chroma_threshold = 24;
+    // Fração de amostras coloridas a partir da qual a página é colorida
+    double min_color_fraction = 0.0;
+    CmykSeparation separation;   // RGB -> tinta
+    uint64_t seed = 0x2545F4914F6CDD1DULL;
+};
+
+// Resultado da pré-análise. Canais sempre em termos de tinta C, M, Y, K:
+// RGB passa pela separação, cinza vira só K.
+struct InkCoverage {
+    PixelFormat format = PixelFormat::GRAY8;
+    int width = 0;
+    int height = 0;
+    uint64_t samples = 0;
+    bool exhaustive = false;     // Todos os pixels visitados (erro zero)
+
+    std::array<std::array<uint64_t, 256>, 4> histogram{};
+    std::array<double, 4> coverage{};   // Tinta média por canal, 0..1
+    // Meia largura do intervalo de confiança de cada média (cobertura e
+    // fração colorida), pela desigualdade de Hoeffding
+    double error_bound = 0.0;
+    double confidence = 0.0;
+
+    double color_fraction = 0.0;
+    bool has_color = false;
+
+    uint64_t pixels() const { return static_cast<uint64_t>(width) * height; }
+    double total_coverage() const { return coverage[0] + coverage[1] + coverage[2] + coverage[3]; }
+};
+
+// Estimativa de cobertura de tinta e cor/monocromático por amostragem
+// estratificada: a imagem é dividida em n células de mesma área e cada uma
+// contribui um pixel sorteado. As amostras são independentes e limitadas, e
+// com n >= ln(2 / (1 - confidence)) / (2 * max_error^2) o erro de cada média
+// fica dentro de max_error com a confiança pedida, qualquer que seja o
+// tamanho da folha (~26 mil amostras no padrão). Imagens com até n pixels
+// são lidas inteiras. Detalhes coloridos menores que uma célula são
+// detectados com probabilidade proporcional à área que ocupam.
+class InkCoverageAnalyzer {
+public:
+    explicit InkCoverageAnalyzer(InkCoverageOptions options = {});
+
+    const InkCoverageOptions& options() const { return options_; }
+    uint64_t sample_size() const { return sample_size_; }
+
+    InkCoverage analyze(const uint8_t* data, int width, int height, size_t stride,
+                        PixelFormat format) const;
+    InkCoverage analyze(const Image& image) const;
+
+    // Netpbm mapeado em memória: só as páginas das linhas sorteadas são
+    // lidas do disco. Lança std::runtime_error em erro.
+    InkCoverage analyze_file(const std::string& path) const;
+
+private:
+    InkCoverageOptions options_;
+    uint64_t sample_size_ = 0;
+
+    InkCoverage sample(int width, int height, PixelFormat format, int sample_bytes,
+                       int msb, const uint8_t* base, size_t stride) const;
+};
+
+// Páginas de um documento: médias ponderadas pela área em pixels, erro e
+// confiança da página menos precisa
+InkCoverage merge_coverage(const std::vector<InkCoverage>& pages);
+
+// Consumo por m² com 100% de cobertura e preço de cada tinta C, M, Y, K
+struct InkCostModel {
+    std::array<double, 4> ml_per_m2 = {{8.0, 8.0, 8.0, 8.0}};
+    std::array<double, 4> price_per_ml = {{0.30, 0.30, 0.30, 0.25}};
+    double media_price_per_m2 = 1.50;
+};
+
+struct InkCostEstimate {
+    std::array<double, 4> ink_ml{};
+    double ink_cost = 0.0;
+    double media_cost = 0.0;
+    double total = 0.0;
+    double margin = 0.0;   // +/- do custo de tinta vindo do erro da amostragem
+};
+
+InkCostEstimate estimate_ink_cost(const InkCoverage& coverage, double area_m2,
+                                  int copies = 1, const InkCostModel& model = {});
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "image_io.h"
+#include "tiled_raster.h"
+#include <string>
+#include <vector>
+
+namespace all_press {
+namespace raster {
+
+// Página a encaixar no rolo, em pixels; id é devolvido na posição
+struct NestItem {
+    int id = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Posição no rolo; width/height já na orientação colocada
+struct NestPlacement {
+    int id = 0;
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    bool rotated = false;   // Girada 90° no sentido horário
+};
+
+struct NestOptions {
+    int gap = 0;                  // Calha entre páginas (marcas de corte e rótulos)
+    bool allow_rotation = true;
+};
+
+struct NestLayout {
+    int roll_width = 0;
+    int length = 0;                       // Linhas de rolo usadas, com a calha final
+    std::vector<NestPlacement> placements;
+    std::vector<int> rejected;            // Ids que não cabem na largura do rolo
+};
+
+// Skyline bottom-left: páginas em ordem decrescente de altura, cada uma no
+// segmento do horizonte que deixa o topo mais baixo (empate: mais à
+// esquerda), nas duas orientações se permitido. O(n·s) por página, com s
+// segmentos no horizonte.
+NestLayout pack_skyline(const std::vector<NestItem>& items, int roll_width,
+                        const NestOptions& options = {});
+
+struct NestComposeOptions {
+    int mark_length = 0;          // Marcas de corte nos cantos; 0 = sem marcas
+    int label_scale = 0;          // Pixels por ponto da fonte 3x5; 0 = sem rótulos
+    TiledRasterOptions raster;
+};
+
+// Monta o rolo linha a linha (TiledRasterWriter), sem buffer da folha
+// inteira: images[id] é a página de cada posição, todas de 8 bits no formato
+// dado. labels[id], se houver, é escrito na calha abaixo da página para
+// identificar o job. Lança std::invalid_argument se uma página não casar.
+TiledRaster compose_nest(const NestLayout& layout, const std::vector<const Image*>& images,
+                         PixelFormat format, const std::vector<std::string>& labels = {},
+                         const NestComposeOptions& options = {});
+
+// Mesmo rolo a partir de páginas em tiles, lidas faixa a faixa; só as
+// giradas são montadas num buffer contíguo, enquanto estão na linha atual
+TiledRaster compose_nest(const NestLayout& layout, const std::vector<const TiledRaster*>& pages,
+                         PixelFormat format, const std::vector<std::string>& labels = {},
+                         const NestComposeOptions& options = {});
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "tiled_raster.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace all_press {
+namespace raster {
+
+// Ponto em pixels; y cresce para baixo
+struct FillPoint {
+    double x;
+    double y;
+};
+
+enum class FillRule {
+    NON_ZERO,
+    EVEN_ODD
+};
+
+// Área a pintar: contornos fechados implicitamente e cor no formato do
+// raster de destino (bytes_per_pixel componentes)
+struct FillPath {
+    std::vector<std::vector<FillPoint>> contours;
+    FillRule rule = FillRule::NON_ZERO;
+    std::array<uint8_t, 4> color = {0, 0, 0, 0};
+};
+
+struct PathRasterOptions {
+    int subsamples = 4;          // Sub-linhas por linha de pixel (anti-aliasing vertical)
+    TiledRasterOptions raster;
+};
+
+// Contornos do traço de uma polilinha de largura width (pixels), com juntas
+// e pontas redondas e todos na mesma orientação: preenchidos com NON_ZERO
+// dão a união. Um ponto isolado vira um disco.
+void stroke_polyline(const std::vector<FillPoint>& points, double width,
+                     std::vector<std::vector<FillPoint>>& contours);
+
+// Pinta os paths na ordem dada sobre fundo sem tinta, linha a linha por
+// varredura: cobertura horizontal exata e subsamples sub-linhas por pixel.
+// Além do raster, a memória é proporcional às arestas, não à página.
+// Lança std::invalid_argument para dimensões inválidas.
+TiledRaster fill_paths(const std::vector<FillPath>& paths, int width, int height,
+                       PixelFormat format, const PathRasterOptions& options = {});
+
+}  // namespace raster
+}  // namespace all_press
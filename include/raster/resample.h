@@ -0,0 +1,87 @@
+#pragma once
+
+#include "image_io.h"
+#include "tiled_raster.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace all_press {
+namespace raster {
+
+enum class ResampleFilter {
+    BOX,        // Média de área: conserva a tinta de linhas finas
+    LANCZOS3    // sinc janelado, raio 3: mais nitidez em tons contínuos
+};
+
+struct ResampleOptions {
+    ResampleFilter filter = ResampleFilter::LANCZOS3;
+    unsigned threads = 0;   // Threads por faixa; 0 = hardware
+    int band_rows = 64;     // Linhas de saída por faixa
+};
+
+// Reamostragem separável de pixels de 8 bits entrelaçados (GRAY8, RGB8,
+// CMYK8). Os pesos de cada coluna e linha de saída são calculados uma vez em
+// ponto fixo de 14 bits; a passada horizontal (SSE2/NEON, RGB expandido para
+// 4 bytes) gera só as linhas de origem que a faixa usa, e a vertical
+// combina linhas inteiras com SIMD. Faixas rodam em paralelo.
+class Resampler {
+public:
+    // Lança std::invalid_argument para tamanhos não positivos
+    Resampler(int src_width, int src_height, int dst_width, int dst_height,
+              PixelFormat format, ResampleOptions options = {});
+
+    int src_width() const { return src_width_; }
+    int src_height() const { return src_height_; }
+    int dst_width() const { return dst_width_; }
+    int dst_height() const { return dst_height_; }
+
+    void process(const uint8_t* src, size_t src_stride, uint8_t* dst, size_t dst_stride) const;
+
+    // Versão em fluxo: lê as linhas de origem em ordem, só as que cada faixa
+    // de saída precisa, e entrega as linhas de saída em ordem. Guarda apenas
+    // a janela do filtro, nunca a imagem inteira. Mesmo resultado de process.
+    using RowReader = std::function<void(uint8_t* dst, int rows)>;
+    using RowSink = std::function<void(const uint8_t* row)>;
+    void process_rows(const RowReader& read, const RowSink& emit) const;
+
+    // Contribuições de um eixo: para cada saída, `taps` pesos a partir de
+    // start, que nunca passam da borda da origem
+    struct Axis {
+        int taps = 0;
+        std::vector<int> start;
+        std::vector<int16_t> weights;   // taps por saída, soma 1 << 14
+    };
+
+private:
+    int src_width_;
+    int src_height_;
+    int dst_width_;
+    int dst_height_;
+    PixelFormat format_;
+    ResampleOptions options_;
+    Axis horizontal_;
+    Axis vertical_;
+
+    void horizontal_row(const uint8_t* src, uint8_t* dst, std::vector<uint8_t>& scratch) const;
+    void vertical_row(const uint8_t* rows, size_t row_bytes, int first, uint8_t* dst, int y) const;
+};
+
+// Imagem de 8 bits; lança std::invalid_argument para 16 bits
+Image resample(const Image& image, int width, int height, ResampleOptions options = {});
+
+struct DownsampleLimits {
+    int max_width = 0;         // 0 = sem limite
+    int max_height = 0;
+    // Reduções menores que isto não compensam a perda de nitidez do filtro
+    double min_factor = 1.25;
+};
+
+// Maior tamanho que cabe nos limites mantendo a proporção. Nunca amplia:
+// false quando a imagem já cabe ou a redução seria menor que min_factor.
+bool plan_downsample(int width, int height, const DownsampleLimits& limits,
+                     int& out_width, int& out_height);
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace all_press {
+namespace raster {
+
+enum class PixelFormat {
+    GRAY8,   // 1 byte, 0 = preto
+    RGB8,    // 3 bytes
+    CMYK8    // 4 bytes, 0 = sem tinta
+};
+
+inline int bytes_per_pixel(PixelFormat format) {
+    switch (format) {
+        case PixelFormat::GRAY8: return 1;
+        case PixelFormat::RGB8:  return 3;
+        case PixelFormat::CMYK8: return 4;
+    }
+    return 1;
+}
+
+// Valor de byte de um pixel sem tinta
+inline uint8_t blank_byte(PixelFormat format) {
+    return format == PixelFormat::CMYK8 ? 0x00 : 0xFF;
+}
+
+enum class TileCompression {
+    NONE,
+    ZLIB     // Ignorado se o build não tiver zlib
+};
+
+struct TiledRasterOptions {
+    int tile_size = 256;
+    TileCompression compression = TileCompression::ZLIB;
+    // Tiles com tinta ficam descomprimidos até este total; acima disso cada
+    // banda gravada é comprimida (tiles frios)
+    size_t hot_bytes_budget = 64u * 1024 * 1024;
+    int compression_level = 1;
+};
+
+struct TiledRasterStats {
+    size_t tiles = 0;
+    size_t blank_tiles = 0;
+    size_t raw_tiles = 0;
+    size_t compressed_tiles = 0;
+    size_t raw_bytes = 0;
+    size_t compressed_bytes = 0;
+
+    size_t stored_bytes() const { return raw_bytes + compressed_bytes; }
+};
+
+// Faixa de linhas de altura tile_size (a última pode ser menor) decodificada
+// em um buffer contíguo. tile_blank[tx] indica tiles sem tinta na faixa, para
+// que consumidores pulem trechos inteiros.
+struct RowBand {
+    int index = 0;
+    int y = 0;
+    int rows = 0;
+    int width = 0;
+    size_t stride = 0;           // Bytes por linha
+    const uint8_t* data = nullptr;
+    std::vector<bool> tile_blank;
+
+    const uint8_t* row(int i) const { return data + static_cast<size_t>(i) * stride; }
+    bool all_blank() const;
+
+    std::vector<uint8_t> storage;  // Dono de data, reaproveitado entre faixas
+};
+
+// Raster de página em tiles: tiles sem tinta não ocupam memória e tiles frios
+// podem ser comprimidos. A memória de pico acompanha a cobertura de tinta, não
+// a área do papel. Escrita e leitura são feitas por faixas de tiles; leituras
+// const de faixas diferentes podem rodar em paralelo.
+class TiledRaster {
+public:
+    TiledRaster(int width, int height, PixelFormat format,
+                TiledRasterOptions options = {});
+
+    // Copia um buffer contíguo (linhas sem padding)
+    static TiledRaster from_buffer(const uint8_t* data, int width, int height,
+                                   PixelFormat format, TiledRasterOptions options = {});
+
+    int width() const { return width_; }
+    int height() const { return height_; }
+    PixelFormat format() const { return format_; }
+    int bytes_per_pixel() const { return bpp_; }
+    size_t row_bytes() const { return static_cast<size_t>(width_) * bpp_; }
+    int tile_size() const { return options_.tile_size; }
+    int tiles_x() const { return tiles_x_; }
+    int band_count() const { return tiles_y_; }
+    int band_height(int band) const;
+
+    // Grava a faixa inteira (band_height(band) linhas com o stride dado)
+    void write_band(int band, const uint8_t* data, size_t stride);
+
+    // Decodifica uma faixa; band.storage é reaproveitado entre chamadas
+    void read_band(int band, RowBand& out) const;
+
+    // Percorre as faixas em ordem; fn retorna false para parar
+    void for_each_band(const std::function<bool(const RowBand&)>& fn) const;
+
+    // Linhas arbitrárias (ex: reamostragem); out recebe rows * row_bytes()
+    void read_rows(int y, int rows, uint8_t* out) const;
+
+    bool tile_is_blank(int tx, int ty) const;
+    std::vector<uint8_t> to_buffer() const;
+    TiledRasterStats stats() const;
+
+    // false quando compilado sem zlib: tiles frios ficam sempre crus
+    static bool compression_available();
+
+private:
+    enum class TileState : uint8_t { BLANK, RAW, COMPRESSED };
+
+    struct Tile {
+        TileState state = TileState::BLANK;
+        std::vector<uint8_t> data;
+    };
+
+    int width_;
+    int height_;
+    PixelFormat format_;
+    int bpp_;
+    TiledRasterOptions options_;
+    int tiles_x_;
+    int tiles_y_;
+    std::vector<Tile> tiles_;
+    std::vector<uint8_t> blank_row_;  // Uma linha de tile sem tinta
+    size_t raw_bytes_ = 0;
+
+    int tile_width(int tx) const;
+    void store_tile(Tile& tile, std::vector<uint8_t>&& pixels, bool compress);
+    void decode_tile(const Tile& tile, size_t expected, uint8_t* out) const;
+};
+
+// Acumula linhas vindas de um produtor sequencial e grava cada faixa
+// completa; só uma faixa descomprimida fica em memória
+class TiledRasterWriter {
+public:
+    explicit TiledRasterWriter(TiledRaster& raster);
+
+    void append_row(const uint8_t* row);
+    // Grava a faixa parcial; linhas não escritas ficam sem tinta
+    void finish();
+
+    int rows_written() const { return next_row_; }
+
+private:
+    TiledRaster& raster_;
+    std::vector<uint8_t> band_;
+    int next_row_ = 0;
+    int band_rows_ = 0;
+};
+
+}  // namespace raster
+}  // namespace all_press
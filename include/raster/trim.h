@@ -0,0 +1,48 @@
+#pragma once
+
+#include "tiled_raster.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace all_press {
+namespace raster {
+
+// Linha com tinta: alguma amostra se afasta do branco do formato
+// (blank_byte) mais que tolerance níveis. SSE2/NEON com fallback escalar.
+bool row_has_ink(const uint8_t* row, size_t bytes, PixelFormat format, int tolerance);
+
+// Primeira e última linha com tinta; blank quando não há nenhuma
+struct InkExtent {
+    bool blank = true;
+    int first_row = 0;
+    int last_row = -1;
+};
+
+InkExtent find_ink_extent(const uint8_t* data, int width, int height, size_t stride,
+                          PixelFormat format, int tolerance);
+
+// Tiles em branco são pulados sem decodificar; as faixas são lidas das
+// bordas para dentro e a busca para na primeira linha com tinta
+InkExtent find_ink_extent(const TiledRaster& page, int tolerance);
+
+struct TrimOptions {
+    int tolerance = 8;           // Desvio do branco ainda considerado papel (sujeira, ruído de scan)
+    int margin_rows = 0;         // Linhas brancas mantidas depois da última linha com tinta
+    bool trim_leading = false;   // Também remove o branco antes da primeira linha com tinta
+};
+
+// Linhas que sobram de uma página depois do corte
+struct TrimPlan {
+    bool blank = false;
+    int first_row = 0;
+    int rows = 0;
+    int removed_rows = 0;
+};
+
+TrimPlan plan_trim(const InkExtent& extent, int height, const TrimOptions& options);
+
+// Cópia das linhas [first_row, first_row + rows), com o mesmo tile_size
+TiledRaster crop_rows(const TiledRaster& page, int first_row, int rows);
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace AllPress::Utils {
+
+struct SubprocessOptions {
+    std::string working_dir;                        // Vazio = diretório atual
+    std::chrono::milliseconds timeout{0};           // Tempo de parede; 0 = sem limite
+    std::chrono::milliseconds kill_grace{2000};     // Entre SIGTERM e SIGKILL no timeout
+    int cpu_limit_s = 0;                            // RLIMIT_CPU; 0 = sem limite
+    size_t memory_limit_mb = 0;                     // RLIMIT_AS; 0 = sem limite
+    size_t error_tail_bytes = 4096;                 // Final do stderr guardado no resultado
+};
+
+struct SubprocessResult {
+    int exit_code = -1;             // -1 se não rodou ou terminou por sinal
+    int term_signal = 0;
+    int spawn_error = 0;            // errno do exec (ex.: ENOENT)
+    bool timed_out = false;
+    bool cpu_limit_hit = false;
+    double wall_seconds = 0.0;
+    double cpu_seconds = 0.0;       // Usuário + sistema do processo
+    std::string error_output;       // Final do stderr
+
+    bool ok() const { return exit_code == 0; }
+
+    // Resumo para log: código de saída, sinal, timeout ou erro do exec
+    std::string describe() const;
+};
+
+// Processos externos sem /bin/sh: argv vai direto ao execve, o filho sai de
+// vfork (sem copiar o espaço de endereços do servidor), em grupo de
+// processos próprio, com limites de CPU e memória aplicados antes do exec.
+// No timeout o grupo inteiro recebe SIGTERM e, após kill_grace, SIGKILL;
+// descendentes que sobrevivem ao líder também são mortos.
+class Subprocess {
+public:
+    // Preenche até size bytes do stdin do filho; 0 = fim da entrada
+    using Source = std::function<size_t(char* buffer, size_t size)>;
+    // Recebe o stdout do filho em pedaços; false fecha o pipe (o filho
+    // recebe SIGPIPE na próxima escrita)
+    using Sink = std::function<bool(const char* data, size_t size)>;
+
+    // Sem input, o stdin do filho é /dev/null; sem output, o stdout é
+    // descartado. argv[0] sem '/' é procurado no PATH.
+    static SubprocessResult run(const std::vector<std::string>& argv,
+                                const SubprocessOptions& options = {},
+                                const Source& input = nullptr,
+                                const Sink& output = nullptr);
+
+    // Processo residente com stdio em /dev/null, em grupo próprio (o pid é o
+    // id do grupo); -1 em erro. Encerrado com terminate_group.
+    static pid_t spawn_background(const std::vector<std::string>& argv,
+                                  const SubprocessOptions& options = {});
+
+    // SIGTERM ao grupo, espera até grace pelo líder, SIGKILL no grupo e
+    // recolhe o líder
+    static void terminate_group(pid_t pid, std::chrono::milliseconds grace);
+
+    // Caminho absoluto do executável no PATH; vazio se não houver
+    static std::string find_executable(const std::string& name);
+};
+
+} // namespace AllPress::Utils
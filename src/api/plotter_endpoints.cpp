@@ -269,6 +269,9 @@ std::string handle_auto_print(
             if (opts.contains("quality")) {
                 options.quality = opts["quality"].get<int>();
             }
+            if (opts.contains("trim_whitespace")) {
+                options.trim_whitespace = opts["trim_whitespace"].get<bool>();
+            }
         }
         
         // Selecionar protocolo automaticamente
@@ -228,6 +228,18 @@ private:
           new_job.file_size = Utils::FileUtils::get_file_size(temp_file);
           new_job.estimated_pages = 1;
 
+          // Pré-análise: páginas, cor/monocromático e custo sem render completo
+          FileProcessor preflight;
+          FileInfo file_info = preflight.analyze_file(temp_file);
+          new_job.estimated_pages = file_info.estimated_pages;
+          if (file_info.coverage_measured) {
+            new_job.estimated_cost =
+                preflight.estimate_cost(file_info, new_job.options.copies);
+            if (!file_info.has_color) {
+              new_job.options.color_mode = "monochrome";
+            }
+          }
+
           int job_id = job_queue_->add_job(new_job);
 
           if (job_id > 0) {
@@ -360,7 +372,15 @@ private:
         auto &job = job_opt.value();
         json j = {{"id", job.job_id},
                   {"status", "processing"}, // Simplify
-                  {"fileName", job.original_filename}};
+                  {"fileName", job.original_filename},
+                  {"blankPagesSkipped", job.blank_pages_skipped},
+                  {"mediaSavedMm", job.media_saved_mm},
+                  {"plotTimeSavedSeconds", job.plot_time_saved_s},
+                  {"nestId", job.nest_id},
+                  {"predictedPlotSeconds", job.predicted_plot_s},
+                  {"actualPlotSeconds", job.actual_plot_s},
+                  {"bytesAcknowledged", job.bytes_acknowledged},
+                  {"bytesResumed", job.bytes_resumed}};
         return crow::response(j.dump());
       }
       return crow::response(404);
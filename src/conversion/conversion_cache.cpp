@@ -0,0 +1,399 @@
+#include "conversion/conversion_cache.h"
+#include "utils/config.h"
+#include "utils/file_utils.h"
+#include "utils/logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+#include <fcntl.h>
+#include <openssl/evp.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace AllPress {
+
+namespace {
+
+constexpr size_t COPY_CHUNK = 1 << 20;
+constexpr size_t MAX_HASH_MEMO = 4096;
+constexpr uint64_t BYTES_PER_MB = 1024 * 1024;
+constexpr const char* KEY_VERSION = "all_press-cache 1";
+constexpr const char* META_SUFFIX = ".meta";
+
+std::string to_hex(const unsigned char* digest, unsigned int size) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(size * 2);
+    for (unsigned int i = 0; i < size; ++i) {
+        hex += digits[digest[i] >> 4];
+        hex += digits[digest[i] & 0x0f];
+    }
+    return hex;
+}
+
+int64_t mtime_ns(const struct stat& st) {
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+bool write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t n = ::write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// copy_file_range copia dentro do kernel (reflink em btrfs/XFS); entre
+// sistemas de arquivos diferentes cai para read/write
+bool copy_fd(int in_fd, int out_fd) {
+    bool in_kernel = true;
+    while (in_kernel) {
+        const ssize_t n = ::copy_file_range(in_fd, nullptr, out_fd, nullptr, COPY_CHUNK * 64, 0);
+        if (n == 0) {
+            return true;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EXDEV && errno != ENOSYS && errno != EINVAL && errno != EOPNOTSUPP) {
+                return false;
+            }
+            in_kernel = false;
+        }
+    }
+    std::vector<char> buffer(COPY_CHUNK);
+    while (true) {
+        const ssize_t n = ::read(in_fd, buffer.data(), buffer.size());
+        if (n == 0) {
+            return true;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        if (!write_all(out_fd, buffer.data(), static_cast<size_t>(n))) {
+            return false;
+        }
+    }
+}
+
+// Cópia em <destino>.part renomeada: o destino nunca fica pela metade
+bool copy_to_path(int in_fd, const std::string& destination) {
+    const std::string part = destination + ".part";
+    const int out_fd = ::open(part.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out_fd < 0) {
+        return false;
+    }
+    const bool copied = copy_fd(in_fd, out_fd);
+    const bool closed = ::close(out_fd) == 0;
+    if (!copied || !closed || std::rename(part.c_str(), destination.c_str()) != 0) {
+        std::remove(part.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool write_text(const std::string& path, const std::string& text) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    const bool written = write_all(fd, text.data(), text.size());
+    return ::close(fd) == 0 && written;
+}
+
+}  // namespace
+
+ConversionCache& ConversionCache::instance() {
+    Utils::Config& config = Utils::Config::instance();
+    static ConversionCache cache(
+        config.get_string("cache.directory", Utils::FileUtils::get_temp_directory() + "/all_press/cache"),
+        static_cast<uint64_t>(std::max(0, config.get_int("cache.max_mb", 2048))) * BYTES_PER_MB);
+    return cache;
+}
+
+ConversionCache::ConversionCache(const std::string& root_dir, uint64_t max_bytes)
+    : root_dir_(root_dir), max_bytes_(max_bytes) {
+    if (enabled()) {
+        Utils::FileUtils::create_directories(root_dir_ + "/tmp");
+        load_index();
+    }
+}
+
+std::string ConversionCache::entry_path(const std::string& key) const {
+    return root_dir_ + "/" + key.substr(0, 2) + "/" + key;
+}
+
+// Entradas existentes em ordem de último uso (mtime); temporários de
+// publicações interrompidas e metadados sem dados são descartados
+void ConversionCache::load_index() {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::remove_all(root_dir_ + "/tmp", ec);
+    fs::create_directories(root_dir_ + "/tmp", ec);
+
+    struct Found {
+        int64_t mtime;
+        std::string key;
+        uint64_t bytes;
+    };
+    std::vector<Found> found;
+    for (fs::directory_iterator dir(root_dir_, ec), end; !ec && dir != end; dir.increment(ec)) {
+        const std::string shard = dir->path().filename().string();
+        if (shard.size() != 2 || !dir->is_directory(ec)) {
+            continue;
+        }
+        std::error_code shard_ec;
+        for (fs::directory_iterator file(dir->path(), shard_ec), file_end; !shard_ec && file != file_end;
+             file.increment(shard_ec)) {
+            const std::string name = file->path().filename().string();
+            const std::string path = file->path().string();
+            const bool is_meta = name.size() > 5 && name.compare(name.size() - 5, 5, META_SUFFIX) == 0;
+            struct stat st;
+            if (is_meta) {
+                if (::access(path.substr(0, path.size() - 5).c_str(), F_OK) != 0) {
+                    std::remove(path.c_str());
+                }
+                continue;
+            }
+            if (name.compare(0, 2, shard) != 0 || ::stat(path.c_str(), &st) != 0 || st.st_size == 0) {
+                std::remove(path.c_str());   // Parciais (.part) ou vazias
+                continue;
+            }
+            struct stat meta_st;
+            uint64_t bytes = static_cast<uint64_t>(st.st_size);
+            if (::stat((path + META_SUFFIX).c_str(), &meta_st) == 0) {
+                bytes += static_cast<uint64_t>(meta_st.st_size);
+            }
+            found.push_back({mtime_ns(st), name, bytes});
+        }
+    }
+    std::sort(found.begin(), found.end(),
+              [](const Found& a, const Found& b) { return a.mtime < b.mtime; });
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& item : found) {
+        lru_.push_front(item.key);
+        entries_[item.key] = Entry{item.bytes, lru_.begin()};
+        stats_.bytes += item.bytes;
+    }
+    evict_locked();
+    if (!entries_.empty()) {
+        LOG_INFO("Conversion cache: " + std::to_string(entries_.size()) + " entries, " +
+                 std::to_string(stats_.bytes / BYTES_PER_MB) + " MB in " + root_dir_);
+    }
+}
+
+std::string ConversionCache::content_hash(const std::string& path) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        return "";
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = hashes_.find(path);
+        if (it != hashes_.end() && it->second.device == st.st_dev && it->second.inode == st.st_ino &&
+            it->second.size == static_cast<uint64_t>(st.st_size) && it->second.mtime == mtime_ns(st)) {
+            return it->second.hash;
+        }
+    }
+
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return "";
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    EVP_MD_CTX* ctx = EVP_MD_CTX_new();
+    bool ok = ctx && EVP_DigestInit_ex(ctx, EVP_sha256(), nullptr) == 1;
+    std::vector<char> buffer(COPY_CHUNK);
+    while (ok) {
+        const ssize_t n = ::read(fd, buffer.data(), buffer.size());
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            ok = errno == EINTR;
+            continue;
+        }
+        ok = EVP_DigestUpdate(ctx, buffer.data(), static_cast<size_t>(n)) == 1;
+    }
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+    ok = ok && EVP_DigestFinal_ex(ctx, digest, &digest_size) == 1;
+    EVP_MD_CTX_free(ctx);
+    ::close(fd);
+    if (!ok) {
+        return "";
+    }
+
+    HashMemo memo;
+    memo.device = st.st_dev;
+    memo.inode = st.st_ino;
+    memo.size = static_cast<uint64_t>(st.st_size);
+    memo.mtime = mtime_ns(st);
+    memo.hash = to_hex(digest, digest_size);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (hashes_.size() >= MAX_HASH_MEMO) {
+        hashes_.clear();
+    }
+    hashes_[path] = memo;
+    return memo.hash;
+}
+
+std::string ConversionCache::make_key(const std::vector<std::string>& parts) {
+    // Cada parte com o tamanho na frente: partes diferentes nunca se juntam
+    // na mesma sequência de bytes
+    std::string material = KEY_VERSION;
+    for (const auto& part : parts) {
+        material += "\n" + std::to_string(part.size()) + ":" + part;
+    }
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size = 0;
+    if (EVP_Digest(material.data(), material.size(), digest, &digest_size, EVP_sha256(), nullptr) != 1) {
+        return "";
+    }
+    return to_hex(digest, digest_size);
+}
+
+bool ConversionCache::fetch(const std::string& key, const std::string& destination, std::string* meta) {
+    if (!enabled() || key.empty()) {
+        return false;
+    }
+    const std::string path = entry_path(key);
+    int fd = -1;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            ++stats_.misses;
+            return false;
+        }
+        // Aberto com o mutex: uma remoção depois disso não afeta a leitura
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            remove_locked(key);
+            ++stats_.misses;
+            return false;
+        }
+        if (meta) {
+            *meta = Utils::FileUtils::read_file(path + META_SUFFIX);
+        }
+        lru_.splice(lru_.begin(), lru_, it->second.lru);
+        ++stats_.hits;
+    }
+    ::futimens(fd, nullptr);   // Ordem LRU para o próximo início
+    const bool copied = copy_to_path(fd, destination);
+    ::close(fd);
+    if (!copied) {
+        LOG_WARNING("Conversion cache: failed to copy entry " + key + " to " + destination);
+    }
+    return copied;
+}
+
+bool ConversionCache::publish(const std::string& key, const std::string& source, const std::string& meta) {
+    if (!enabled() || key.empty()) {
+        return false;
+    }
+    struct stat st;
+    if (::stat(source.c_str(), &st) != 0 || st.st_size == 0 ||
+        static_cast<uint64_t>(st.st_size) + meta.size() > max_bytes_) {
+        return false;
+    }
+    const std::string path = entry_path(key);
+    std::string temp;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            return true;
+        }
+        temp = root_dir_ + "/tmp/" + key + "." + std::to_string(::getpid()) + "." +
+               std::to_string(next_temp_++);
+    }
+
+    Utils::FileUtils::create_directories(root_dir_ + "/" + key.substr(0, 2));
+    const int in_fd = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    const int out_fd = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    bool ok = in_fd >= 0 && out_fd >= 0 && copy_fd(in_fd, out_fd);
+    if (in_fd >= 0) {
+        ::close(in_fd);
+    }
+    if (out_fd >= 0) {
+        ok = ::close(out_fd) == 0 && ok;
+    }
+    // Metadados antes dos dados: quem encontra a entrada encontra os dois
+    if (ok && !meta.empty()) {
+        const std::string meta_temp = temp + META_SUFFIX;
+        ok = write_text(meta_temp, meta) && std::rename(meta_temp.c_str(), (path + META_SUFFIX).c_str()) == 0;
+        if (!ok) {
+            std::remove(meta_temp.c_str());
+        }
+    }
+    ok = ok && std::rename(temp.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        std::remove(temp.c_str());
+        LOG_WARNING("Conversion cache: failed to publish " + source);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.find(key) == entries_.end()) {
+        const uint64_t bytes = static_cast<uint64_t>(st.st_size) + meta.size();
+        lru_.push_front(key);
+        entries_[key] = Entry{bytes, lru_.begin()};
+        stats_.bytes += bytes;
+        ++stats_.stores;
+        evict_locked();
+    }
+    return true;
+}
+
+void ConversionCache::remove_locked(const std::string& key) {
+    auto it = entries_.find(key);
+    if (it == entries_.end()) {
+        return;
+    }
+    const std::string path = entry_path(key);
+    std::remove(path.c_str());
+    std::remove((path + META_SUFFIX).c_str());
+    stats_.bytes -= std::min(stats_.bytes, it->second.bytes);
+    lru_.erase(it->second.lru);
+    entries_.erase(it);
+}
+
+void ConversionCache::evict_locked() {
+    while (stats_.bytes > max_bytes_ && !lru_.empty()) {
+        remove_locked(lru_.back());
+        ++stats_.evictions;
+    }
+}
+
+ConversionCacheStats ConversionCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ConversionCacheStats stats = stats_;
+    stats.entries = entries_.size();
+    return stats;
+}
+
+void ConversionCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    while (!lru_.empty()) {
+        remove_locked(lru_.back());
+    }
+    hashes_.clear();
+}
+
+} // namespace AllPress
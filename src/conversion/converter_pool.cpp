@@ -0,0 +1,460 @@
+#include "conversion/converter_pool.h"
+#include "utils/config.h"
+#include "utils/file_utils.h"
+#include "utils/logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace AllPress {
+
+namespace {
+
+constexpr auto READY_POLL = std::chrono::milliseconds(100);
+constexpr auto STOP_GRACE = std::chrono::seconds(3);
+constexpr auto RUN_KILL_GRACE = std::chrono::seconds(2);
+constexpr int LIBREOFFICE_RECYCLE_AFTER = 200;
+constexpr int ODA_TIMEOUT_S = 600;
+constexpr int DEFAULT_MEMORY_LIMIT_MB = 4096;
+
+// LibreOffice, ImageMagick e Inkscape já usam mais de um núcleo por
+// conversão; Pandoc e Ghostscript, um
+ConverterLimits default_limits(ConverterTool tool) {
+    const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    ConverterLimits limits;
+    switch (tool) {
+        case ConverterTool::Pandoc:
+        case ConverterTool::Ghostscript:
+            limits.max_workers = cores;
+            break;
+        case ConverterTool::LibreOffice:
+            limits.max_workers = std::max(1, cores / 2);
+            limits.recycle_after = LIBREOFFICE_RECYCLE_AFTER;
+            break;
+        case ConverterTool::ImageMagick:
+        case ConverterTool::Inkscape:
+            limits.max_workers = std::max(1, cores / 2);
+            break;
+        case ConverterTool::OdaConverter:
+            limits.max_workers = 1;
+            limits.timeout_s = ODA_TIMEOUT_S;
+            break;
+    }
+    // LibreOffice (JVM e pools do allocator) e Pandoc (RTS do GHC) reservam
+    // muito mais espaço de endereços do que usam: RLIMIT_AS só nos demais
+    if (tool != ConverterTool::LibreOffice && tool != ConverterTool::Pandoc) {
+        limits.memory_limit_mb = DEFAULT_MEMORY_LIMIT_MB;
+    }
+    return limits;
+}
+
+void reset_directory(const std::string& dir) {
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+    std::filesystem::create_directories(dir, ec);
+}
+
+}  // namespace
+
+struct ConverterLease::Worker {
+    ConverterTool tool;
+    int id = 0;
+    std::string work_dir;
+    std::string profile_dir;        // LibreOffice: perfil exclusivo do worker
+    std::string pipe_name;          // LibreOffice: pipe UNO do listener
+    pid_t listener = -1;            // Líder do grupo de processos do listener
+    bool ready = false;
+    int jobs = 0;                   // Desde a partida do listener
+};
+
+const char* converter_tool_name(ConverterTool tool) {
+    switch (tool) {
+        case ConverterTool::Pandoc:       return "pandoc";
+        case ConverterTool::LibreOffice:  return "libreoffice";
+        case ConverterTool::ImageMagick:  return "imagemagick";
+        case ConverterTool::Inkscape:     return "inkscape";
+        case ConverterTool::Ghostscript:  return "ghostscript";
+        case ConverterTool::OdaConverter: return "oda";
+    }
+    return "unknown";
+}
+
+ConverterLease::~ConverterLease() {
+    release();
+}
+
+ConverterLease::ConverterLease(ConverterLease&& other) noexcept
+    : pool_(other.pool_), worker_(other.worker_), failed_(other.failed_) {
+    other.pool_ = nullptr;
+    other.worker_ = nullptr;
+}
+
+ConverterLease& ConverterLease::operator=(ConverterLease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = other.pool_;
+        worker_ = other.worker_;
+        failed_ = other.failed_;
+        other.pool_ = nullptr;
+        other.worker_ = nullptr;
+    }
+    return *this;
+}
+
+const std::string& ConverterLease::work_dir() const {
+    static const std::string empty;
+    return worker_ ? worker_->work_dir : empty;
+}
+
+bool ConverterLease::warm() const {
+    return worker_ && worker_->listener > 0 && worker_->ready;
+}
+
+Utils::SubprocessResult ConverterLease::run(const std::vector<std::string>& args,
+                                            const Utils::Subprocess::Source& input,
+                                            const Utils::Subprocess::Sink& output) {
+    Utils::SubprocessResult result;
+    if (!worker_ || args.empty()) {
+        result.spawn_error = EINVAL;
+        return result;
+    }
+    std::vector<std::string> argv = args;
+    if (worker_->tool == ConverterTool::LibreOffice) {
+        if (!pool_->libreoffice_.empty()) {
+            argv[0] = pool_->libreoffice_;
+        }
+        argv.insert(argv.begin() + 1, "-env:UserInstallation=file://" + worker_->profile_dir);
+    }
+
+    const ConverterLimits limits = pool_->limits(worker_->tool);
+    Utils::SubprocessOptions options;
+    options.timeout = std::chrono::seconds(limits.timeout_s);
+    options.kill_grace = RUN_KILL_GRACE;
+    options.cpu_limit_s = limits.cpu_limit_s;
+    options.memory_limit_mb = static_cast<size_t>(std::max(0, limits.memory_limit_mb));
+
+    result = Utils::Subprocess::run(argv, options, input, output);
+    if (!result.ok()) {
+        LOG_WARNING(std::string(converter_tool_name(worker_->tool)) + " (" + args[0] + ") failed: " +
+                    result.describe());
+    }
+    return result;
+}
+
+void ConverterLease::mark_failed() {
+    failed_ = true;
+    if (worker_ && worker_->listener > 0) {
+        pool_->stop_listener(*worker_);
+    }
+}
+
+void ConverterLease::release() {
+    if (pool_ && worker_) {
+        pool_->give_back(worker_, failed_);
+    }
+    pool_ = nullptr;
+    worker_ = nullptr;
+    failed_ = false;
+}
+
+ConverterPool& ConverterPool::instance() {
+    static ConverterPool pool(Utils::FileUtils::get_temp_directory() + "/all_press/workers");
+    static const bool configured = [] {
+        Utils::Config& config = Utils::Config::instance();
+        for (size_t i = 0; i < CONVERTER_TOOL_COUNT; ++i) {
+            const auto tool = static_cast<ConverterTool>(i);
+            const std::string prefix = std::string("conversion.") + converter_tool_name(tool) + ".";
+            ConverterLimits limits = pool.limits(tool);
+            limits.max_workers = config.get_int(prefix + "max_workers", limits.max_workers);
+            limits.recycle_after = config.get_int(prefix + "recycle_after", limits.recycle_after);
+            limits.start_timeout_s = config.get_int(prefix + "start_timeout_s", limits.start_timeout_s);
+            limits.timeout_s = config.get_int(prefix + "timeout_s", limits.timeout_s);
+            limits.cpu_limit_s = config.get_int(prefix + "cpu_limit_s", limits.cpu_limit_s);
+            limits.memory_limit_mb = config.get_int(prefix + "memory_limit_mb", limits.memory_limit_mb);
+            pool.configure(tool, limits);
+        }
+        return true;
+    }();
+    (void)configured;
+    return pool;
+}
+
+ConverterPool::ConverterPool(const std::string& root_dir)
+    : root_dir_(root_dir) {
+    Utils::FileUtils::create_directories(root_dir_);
+    libreoffice_ = Utils::Subprocess::find_executable("libreoffice");
+    if (libreoffice_.empty()) {
+        libreoffice_ = Utils::Subprocess::find_executable("soffice");
+    }
+    for (size_t i = 0; i < CONVERTER_TOOL_COUNT; ++i) {
+        lanes_[i].limits = default_limits(static_cast<ConverterTool>(i));
+    }
+}
+
+ConverterPool::~ConverterPool() {
+    shutdown();
+}
+
+void ConverterPool::configure(ConverterTool tool, const ConverterLimits& limits) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Lane& l = lane(tool);
+        const ConverterLimits defaults = default_limits(tool);
+        l.limits = limits;
+        if (l.limits.max_workers <= 0) {
+            l.limits.max_workers = defaults.max_workers;
+        }
+    }
+    available_.notify_all();
+}
+
+ConverterLimits ConverterPool::limits(ConverterTool tool) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lane(tool).limits;
+}
+
+int ConverterPool::warm_up(int count) {
+    if (libreoffice_.empty() || count <= 0) {
+        return 0;
+    }
+    // Workers tirados da lista livre enquanto o listener sobe
+    std::vector<Worker*> starting;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Lane& l = lane(ConverterTool::LibreOffice);
+        const int target = std::min(count, l.limits.max_workers);
+        while (static_cast<int>(l.workers.size()) < target) {
+            l.idle.push_back(create_worker(l, ConverterTool::LibreOffice));
+        }
+        for (auto it = l.idle.begin(); it != l.idle.end() && static_cast<int>(starting.size()) < target;) {
+            if ((*it)->listener <= 0) {
+                starting.push_back(*it);
+                it = l.idle.erase(it);
+                ++l.busy;
+            } else {
+                ++it;
+            }
+        }
+    }
+    int started = 0;
+    for (Worker* worker : starting) {
+        started += start_listener(*worker) ? 1 : 0;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Lane& l = lane(ConverterTool::LibreOffice);
+        for (Worker* worker : starting) {
+            --l.busy;
+            l.idle.push_back(worker);
+        }
+    }
+    available_.notify_all();
+    LOG_INFO("Started " + std::to_string(started) + " LibreOffice listener(s) for document conversion");
+    return started;
+}
+
+ConverterPool::Worker* ConverterPool::create_worker(Lane& l, ConverterTool tool) {
+    auto worker = std::make_unique<Worker>();
+    worker->tool = tool;
+    worker->id = static_cast<int>(l.workers.size());
+    const std::string dir = root_dir_ + "/" + converter_tool_name(tool) + "_" + std::to_string(worker->id);
+    worker->work_dir = dir + "/work";
+    worker->profile_dir = dir + "/profile";
+    worker->pipe_name = "all_press_" + std::to_string(::getpid()) + "_" + std::to_string(worker->id);
+    l.workers.push_back(std::move(worker));
+    return l.workers.back().get();
+}
+
+ConverterLease ConverterPool::checkout(ConverterTool tool) {
+    Worker* worker = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Lane& l = lane(tool);
+        const uint64_t ticket = l.next_ticket++;
+        l.queue.push_back(ticket);
+        auto can_go = [&] {
+            return l.queue.front() == ticket && l.busy < l.limits.max_workers &&
+                   (!l.idle.empty() || static_cast<int>(l.workers.size()) < l.limits.max_workers);
+        };
+        if (!can_go()) {
+            ++l.stats.waits;
+            available_.wait(lock, can_go);
+        }
+        l.queue.pop_front();
+
+        if (!l.idle.empty()) {
+            // Preferência pelo worker com listener pronto
+            auto it = std::find_if(l.idle.rbegin(), l.idle.rend(),
+                                   [](const Worker* w) { return w->listener > 0; });
+            auto chosen = it == l.idle.rend() ? l.idle.end() - 1 : std::prev(it.base());
+            worker = *chosen;
+            l.idle.erase(chosen);
+        } else {
+            worker = create_worker(l, tool);
+        }
+        ++l.busy;
+    }
+    available_.notify_all();
+
+    // Checagem de saúde fora do mutex: o worker é exclusivo deste checkout
+    reset_directory(worker->work_dir);
+    if (tool == ConverterTool::LibreOffice && worker->listener > 0) {
+        if (!listener_alive(*worker)) {
+            LOG_WARNING("LibreOffice listener " + std::to_string(worker->id) +
+                        " died; converting cold and restarting it");
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++lane(tool).stats.recycled;
+        } else {
+            wait_until_ready(*worker);
+        }
+    }
+    if (worker->listener > 0 && worker->ready) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++lane(tool).stats.warm;
+    }
+    return ConverterLease(this, worker);
+}
+
+void ConverterPool::give_back(Worker* worker, bool failed) {
+    const ConverterTool tool = worker->tool;
+    ++worker->jobs;
+    bool recycled = false;
+    if (tool == ConverterTool::LibreOffice && !libreoffice_.empty()) {
+        const int recycle_after = limits(tool).recycle_after;
+        if (worker->listener > 0 && recycle_after > 0 && worker->jobs >= recycle_after) {
+            stop_listener(*worker);
+            recycled = true;
+        }
+        if (failed) {
+            // Perfil pode ter ficado inconsistente: recriado na próxima partida
+            std::error_code ec;
+            std::filesystem::remove_all(worker->profile_dir, ec);
+            recycled = true;
+        }
+        if (worker->listener <= 0) {
+            start_listener(*worker);
+        }
+    }
+    reset_directory(worker->work_dir);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Lane& l = lane(tool);
+        ++l.stats.conversions;
+        if (failed) {
+            ++l.stats.failures;
+        }
+        if (recycled) {
+            ++l.stats.recycled;
+        }
+        --l.busy;
+        l.idle.push_back(worker);
+    }
+    available_.notify_all();
+}
+
+bool ConverterPool::start_listener(Worker& worker) {
+    Utils::FileUtils::create_directories(worker.profile_dir);
+    const std::vector<std::string> args = {
+        libreoffice_, "--headless", "--invisible", "--nologo", "--norestore", "--nodefault",
+        "--nolockcheck", "-env:UserInstallation=file://" + worker.profile_dir,
+        "--accept=pipe,name=" + worker.pipe_name + ";urp;"};
+    Utils::SubprocessOptions options;
+    options.memory_limit_mb = static_cast<size_t>(std::max(0, limits(worker.tool).memory_limit_mb));
+    const pid_t pid = Utils::Subprocess::spawn_background(args, options);
+    if (pid < 0) {
+        LOG_WARNING("Failed to start LibreOffice listener: " + std::string(std::strerror(errno)));
+        return false;
+    }
+    worker.listener = pid;
+    worker.ready = false;
+    worker.jobs = 0;
+    return true;
+}
+
+void ConverterPool::stop_listener(Worker& worker) {
+    if (worker.listener <= 0) {
+        return;
+    }
+    // Grupo próprio: os processos filhos do listener também são encerrados
+    Utils::Subprocess::terminate_group(worker.listener, STOP_GRACE);
+    worker.listener = -1;
+    worker.ready = false;
+}
+
+bool ConverterPool::listener_alive(Worker& worker) {
+    if (worker.listener <= 0) {
+        return false;
+    }
+    int status = 0;
+    if (::waitpid(worker.listener, &status, WNOHANG) == 0) {
+        return true;
+    }
+    ::kill(-worker.listener, SIGKILL);
+    worker.listener = -1;
+    worker.ready = false;
+    return false;
+}
+
+// O pipe UNO de --accept só aparece quando a instância terminou de subir
+bool ConverterPool::listener_ready(const Worker& worker) const {
+    const std::string name = "OSL_PIPE_" + std::to_string(::getuid()) + "_" + worker.pipe_name;
+    return ::access(("/tmp/" + name).c_str(), F_OK) == 0 ||
+           ::access(("/var/tmp/" + name).c_str(), F_OK) == 0;
+}
+
+void ConverterPool::wait_until_ready(Worker& worker) {
+    if (worker.ready) {
+        return;
+    }
+    const auto deadline = std::chrono::steady_clock::now() +
+                          std::chrono::seconds(limits(worker.tool).start_timeout_s);
+    while (listener_alive(worker)) {
+        if (listener_ready(worker)) {
+            worker.ready = true;
+            return;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            LOG_WARNING("LibreOffice listener " + std::to_string(worker.id) +
+                        " did not start in time; converting cold");
+            stop_listener(worker);
+            return;
+        }
+        std::this_thread::sleep_for(READY_POLL);
+    }
+}
+
+ConverterPoolStats ConverterPool::stats(ConverterTool tool) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Lane& l = lane(tool);
+    ConverterPoolStats stats = l.stats;
+    stats.workers = static_cast<int>(l.workers.size());
+    stats.busy = l.busy;
+    return stats;
+}
+
+void ConverterPool::shutdown() {
+    std::vector<Worker*> running;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& worker : lane(ConverterTool::LibreOffice).workers) {
+            if (worker->listener > 0) {
+                running.push_back(worker.get());
+            }
+        }
+    }
+    for (Worker* worker : running) {
+        ::kill(-worker->listener, SIGTERM);
+    }
+    for (Worker* worker : running) {
+        stop_listener(*worker);
+    }
+}
+
+} // namespace AllPress
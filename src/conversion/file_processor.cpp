@@ -1,12 +1,258 @@
 #include "conversion/file_processor.h"
+#include "conversion/conversion_cache.h"
+#include "conversion/converter_pool.h"
+#include "conversion/pdf_processor.h"
 #include "utils/logger.h"
 #include "utils/file_utils.h"
+#include "utils/config.h"
+#include "protocols/dxf_reader.h"
+#include "protocols/hpgl_interpreter.h"
+#include "protocols/svg_reader.h"
+#include "raster/image_io.h"
+#include "raster/ink_coverage.h"
+#include "raster/resample.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <fstream>
 #include <cstdlib>
 #include <filesystem>
+#include <functional>
 
 namespace AllPress {
 
+namespace {
+
+namespace raster = all_press::raster;
+namespace protocols = all_press::protocols;
+
+// Resolução da prévia de PDF na pré-análise: A0 vira ~660x930 pixels
+constexpr int PREFLIGHT_DPI = 20;
+constexpr double METERS_PER_INCH = 0.0254;
+constexpr double POINTS_PER_INCH = 72.0;
+// Netpbm não guarda resolução: mesma suposição de analyze_file
+constexpr int RASTER_SOURCE_DPI = 300;
+
+std::atomic<unsigned> output_counter{0};
+
+bool is_netpbm(const std::string& ext) {
+    return ext == ".pnm" || ext == ".pgm" || ext == ".ppm" || ext == ".pam";
+}
+
+bool is_hpgl_file(const std::string& ext) {
+    return ext == ".plt" || ext == ".hpgl";
+}
+
+// Vetores lidos aqui mesmo, sem conversor externo
+bool is_native_vector(const std::string& ext) {
+    return is_hpgl_file(ext) || ext == ".dxf" || ext == ".svg";
+}
+
+// Avisos de validação: comandos que o interpretador não desenha ou não
+// reconhece mudam o resultado em relação ao plotter
+void log_hpgl_validation(const std::string& path, const protocols::HpglDisplayList& drawing) {
+    if (drawing.unknown > 0) {
+        LOG_WARNING("HPGL file has " + std::to_string(drawing.unknown) +
+                    " unknown commands: " + path);
+    }
+    if (drawing.unsupported > 0) {
+        LOG_WARNING("HPGL file has " + std::to_string(drawing.unsupported) +
+                    " commands drawn approximately or skipped (labels, fill types): " + path);
+    }
+    if (drawing.empty()) {
+        LOG_WARNING("HPGL file draws nothing: " + path);
+    }
+}
+
+// Display list de HPGL, SVG ou DXF (traços DXF passam pelo HPGLGenerator e
+// voltam pelo interpretador). Lança std::runtime_error em erro de leitura.
+protocols::HpglDisplayList load_vector_drawing(const std::string& path, const std::string& ext) {
+    if (is_hpgl_file(ext)) {
+        protocols::HpglDisplayList drawing = protocols::parse_hpgl_file(path);
+        log_hpgl_validation(path, drawing);
+        return drawing;
+    }
+    if (ext == ".svg") {
+        protocols::HpglDisplayList drawing = protocols::read_svg_file(path);
+        if (drawing.unsupported > 0) {
+            LOG_WARNING("SVG file has " + std::to_string(drawing.unsupported) +
+                        " elements drawn approximately or skipped (text, images, gradients, clipping): " + path);
+        }
+        if (drawing.unknown > 0) {
+            LOG_WARNING("SVG file has " + std::to_string(drawing.unknown) + " unknown elements: " + path);
+        }
+        if (drawing.empty()) {
+            LOG_WARNING("SVG file draws nothing: " + path);
+        }
+        return drawing;
+    }
+    const protocols::DxfDrawing dxf = protocols::read_dxf_file(path);
+    if (dxf.unsupported > 0) {
+        LOG_WARNING("DXF file has " + std::to_string(dxf.unsupported) +
+                    " entities that are not drawn (hatches, splines, missing blocks): " + path);
+    }
+    if (dxf.empty()) {
+        LOG_WARNING("DXF file draws nothing: " + path);
+        return protocols::HpglDisplayList{};
+    }
+    const std::vector<uint8_t> program = protocols::dxf_to_hpgl(dxf);
+    return protocols::parse_hpgl(program.data(), program.size());
+}
+
+// Saída única em temp_dir: conversões simultâneas de arquivos com o mesmo
+// nome não se sobrescrevem
+std::string unique_output_path(const std::string& dir, const std::string& base_name,
+                               const std::string& extension = ".pdf") {
+    return dir + "/" + base_name + "_" + std::to_string(output_counter.fetch_add(1)) + extension;
+}
+
+// Roda a ferramenta no worker e publica produced (relativo ao diretório do
+// worker) em output_path. Se o listener do LibreOffice falhar, a conversão
+// é repetida a frio antes de desistir.
+bool run_converter(ConverterLease& lease, const std::vector<std::string>& args,
+                   const std::string& produced, const std::string& output_path) {
+    const std::string produced_path = lease.work_dir() + "/" + produced;
+    bool ok = lease.run(args).ok();
+    if ((!ok || !std::filesystem::exists(produced_path)) && lease.warm()) {
+        lease.mark_failed();
+        ok = lease.run(args).ok();
+    }
+    if (!ok || !std::filesystem::exists(produced_path)) {
+        lease.mark_failed();
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(produced_path, output_path, ec);
+    if (ec) {
+        ec.clear();
+        std::filesystem::copy_file(produced_path, output_path,
+                                   std::filesystem::copy_options::overwrite_existing, ec);
+    }
+    return !ec;
+}
+
+// Sequência de PPM binários (P6, maxval 255) lida aos pedaços do stdout do
+// Ghostscript; cada página completa vai para on_page
+class PpmPageStream {
+public:
+    using PageHandler = std::function<void(const uint8_t* pixels, int width, int height)>;
+
+    explicit PpmPageStream(PageHandler on_page) : on_page_(std::move(on_page)) {}
+
+    // false se o fluxo não for PPM
+    bool feed(const char* data, size_t size) {
+        buffer_.insert(buffer_.end(), data, data + size);
+        while (true) {
+            if (page_bytes_ == 0) {
+                const int parsed = parse_header();
+                if (parsed <= 0) {
+                    return parsed == 0;
+                }
+            }
+            if (buffer_.size() < header_bytes_ + page_bytes_) {
+                return true;
+            }
+            on_page_(buffer_.data() + header_bytes_, width_, height_);
+            buffer_.erase(buffer_.begin(), buffer_.begin() + header_bytes_ + page_bytes_);
+            page_bytes_ = 0;
+        }
+    }
+
+    // Sobrou página pela metade: saída truncada
+    bool complete() const { return buffer_.empty(); }
+
+private:
+    // 1 = cabeçalho lido, 0 = faltam bytes, -1 = inválido
+    int parse_header() {
+        size_t pos = 0;
+        auto next_number = [&](long& value) {
+            while (pos < buffer_.size()) {
+                if (buffer_[pos] == '#') {
+                    while (pos < buffer_.size() && buffer_[pos] != '\n') {
+                        ++pos;
+                    }
+                } else if (std::isspace(buffer_[pos])) {
+                    ++pos;
+                } else {
+                    break;
+                }
+            }
+            value = 0;
+            const size_t start = pos;
+            while (pos < buffer_.size() && std::isdigit(buffer_[pos]) && value < 1000000) {
+                value = value * 10 + (buffer_[pos++] - '0');
+            }
+            if (pos == buffer_.size()) {
+                return 0;
+            }
+            return pos > start && std::isspace(buffer_[pos]) ? 1 : -1;
+        };
+        if (buffer_.size() < 3) {
+            return buffer_.empty() || buffer_[0] == 'P' ? 0 : -1;
+        }
+        if (buffer_[0] != 'P' || buffer_[1] != '6') {
+            return -1;
+        }
+        pos = 2;
+        long width = 0;
+        long height = 0;
+        long maxval = 0;
+        for (long* value : {&width, &height, &maxval}) {
+            const int status = next_number(*value);
+            if (status <= 0) {
+                return status;
+            }
+        }
+        if (width <= 0 || height <= 0 || maxval != 255) {
+            return -1;
+        }
+        width_ = static_cast<int>(width);
+        height_ = static_cast<int>(height);
+        header_bytes_ = pos + 1;
+        page_bytes_ = static_cast<size_t>(width) * static_cast<size_t>(height) * 3;
+        return 1;
+    }
+
+    PageHandler on_page_;
+    std::vector<uint8_t> buffer_;
+    size_t header_bytes_ = 0;
+    size_t page_bytes_ = 0;
+    int width_ = 0;
+    int height_ = 0;
+};
+
+// Opções que mudam a saída, normalizadas para a chave do cache: caixa e
+// espaços do perfil e do formato, e limites negativos, não geram entradas
+// diferentes
+std::string normalized_options(const std::string& ext, const ConversionOptions& options) {
+    auto trimmed = [](std::string text, bool upper) {
+        const size_t first = text.find_first_not_of(" \t");
+        const size_t last = text.find_last_not_of(" \t");
+        text = first == std::string::npos ? "" : text.substr(first, last - first + 1);
+        std::transform(text.begin(), text.end(), text.begin(), [upper](unsigned char c) {
+            return static_cast<char>(upper ? std::toupper(c) : std::tolower(c));
+        });
+        return text;
+    };
+    std::string ext_lower = ext;
+    std::transform(ext_lower.begin(), ext_lower.end(), ext_lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return "ext=" + ext_lower +
+           " dpi=" + std::to_string(std::max(0, options.target_dpi)) +
+           " compress=" + (options.compress ? "1" : "0") +
+           " profile=" + trimmed(options.color_profile, false) +
+           " transparency=" + (options.preserve_transparency ? "1" : "0") +
+           " format=" + trimmed(options.output_format, true) +
+           " max=" + std::to_string(std::max(0, options.max_width)) + "x" +
+           std::to_string(std::max(0, options.max_height));
+}
+
+double area_m2(int width, int height, int dpi) {
+    return (width * METERS_PER_INCH / dpi) * (height * METERS_PER_INCH / dpi);
+}
+
+}  // namespace
+
 FileProcessor::FileProcessor() {
     temp_dir_ = Utils::FileUtils::get_temp_directory() + "/all_press";
     Utils::FileUtils::create_directories(temp_dir_);
@@ -25,10 +271,167 @@ FileInfo FileProcessor::analyze_file(const std::string& file_path) {
     info.has_color = true;
     info.estimated_pages = 1;
     
+    if (info.type == FileType::PDF) {
+        // Estrutura lida direto do arquivo: páginas, tamanhos e cor declarada
+        // em milissegundos; a prévia abaixo refina cor e cobertura
+        PdfStructure structure;
+        std::string error;
+        if (read_pdf_structure(file_path, structure, &error)) {
+            const PdfPageInfo& first = structure.pages.front();
+            const bool turned = first.rotate == 90 || first.rotate == 270;
+            const double width_in = (turned ? first.height_pt : first.width_pt) / POINTS_PER_INCH;
+            const double height_in = (turned ? first.width_pt : first.height_pt) / POINTS_PER_INCH;
+            info.dimensions = std::to_string(static_cast<int>(width_in * info.dpi)) + " x " +
+                              std::to_string(static_cast<int>(height_in * info.dpi));
+            info.area_m2 = 0.0;
+            for (const auto& page : structure.pages) {
+                info.area_m2 += (page.width_pt / POINTS_PER_INCH * METERS_PER_INCH) *
+                                (page.height_pt / POINTS_PER_INCH * METERS_PER_INCH);
+            }
+            info.estimated_pages = structure.page_count;
+            info.has_color = structure.uses_color;
+        } else {
+            LOG_WARNING("PDF structure unreadable for " + file_path + ": " + error);
+        }
+    }
+    
+    measure_ink_coverage(info);
+    
     LOG_INFO("Analyzed file: " + file_path + " (" + std::to_string(info.size_bytes) + " bytes)");
     return info;
 }
 
+void FileProcessor::measure_ink_coverage(FileInfo& info) {
+    const std::string ext = Utils::FileUtils::get_file_extension(info.file_path);
+    const raster::InkCoverageAnalyzer analyzer;
+    
+    try {
+        if (is_netpbm(ext)) {
+            // Raster pronto: amostrado direto do arquivo mapeado
+            raster::InkCoverage coverage = analyzer.analyze_file(info.file_path);
+            info.dimensions = std::to_string(coverage.width) + " x " + std::to_string(coverage.height);
+            info.area_m2 = area_m2(coverage.width, coverage.height, info.dpi);
+            info.has_color = coverage.has_color;
+            info.ink_coverage = coverage.coverage;
+            info.coverage_error = coverage.error_bound;
+            info.coverage_measured = true;
+        } else if (is_native_vector(ext)) {
+            // Vetor interpretado aqui mesmo: extensão exata e cobertura da
+            // prévia em PREFLIGHT_DPI, com traços na largura real da pena
+            const protocols::HpglDisplayList drawing = load_vector_drawing(info.file_path, ext);
+            if (!drawing.empty()) {
+                protocols::HpglRenderOptions render;
+                render.dpi = PREFLIGHT_DPI;
+                render.min_stroke_px = 0.0;
+                render.format = raster::PixelFormat::RGB8;
+                const raster::TiledRaster page = protocols::render_hpgl(drawing, render);
+                const std::vector<uint8_t> pixels = page.to_buffer();
+                const raster::InkCoverage coverage = analyzer.analyze(
+                    pixels.data(), page.width(), page.height(), page.row_bytes(), page.format());
+                const double mm_per_inch = METERS_PER_INCH * 1000.0;
+                info.dimensions = std::to_string(static_cast<int>(drawing.width_mm() / mm_per_inch * info.dpi)) +
+                                  " x " +
+                                  std::to_string(static_cast<int>(drawing.height_mm() / mm_per_inch * info.dpi));
+                info.area_m2 = drawing.width_mm() * drawing.height_mm() / 1e6;
+                info.has_color = drawing.has_color();
+                info.ink_coverage = coverage.coverage;
+                info.coverage_error = coverage.error_bound;
+                info.coverage_measured = true;
+            }
+        } else if (info.type == FileType::PDF) {
+            // Prévia de baixa resolução, sem render completo: o Ghostscript
+            // escreve as páginas no stdout e cada uma é analisada assim que
+            // chega, sem arquivos temporários. Roda no upload, então no
+            // máximo preflight.max_pages páginas: documentos maiores são
+            // amostrados a passo fixo, uma página por -dFirstPage/-dLastPage
+            const int max_pages = std::max(1, Utils::Config::instance().get_int("preflight.max_pages", 8));
+            std::vector<int> sampled;
+            if (info.estimated_pages > max_pages) {
+                for (int i = 0; i < max_pages; ++i) {
+                    sampled.push_back(1 + static_cast<int>(static_cast<int64_t>(i) * info.estimated_pages / max_pages));
+                }
+            }
+            
+            std::vector<raster::InkCoverage> coverages;
+            double area = 0.0;
+            PpmPageStream pages([&](const uint8_t* pixels, int width, int height) {
+                coverages.push_back(analyzer.analyze(pixels, width, height, static_cast<size_t>(width) * 3,
+                                                     raster::PixelFormat::RGB8));
+                area += area_m2(width, height, PREFLIGHT_DPI);
+            });
+            auto render = [&](ConverterLease& lease, int first, int last) {
+                return lease.run(
+                    {"gs", "-q", "-dSAFER", "-dBATCH", "-dNOPAUSE", "-sDEVICE=ppmraw",
+                     "-r" + std::to_string(PREFLIGHT_DPI), "-dFirstPage=" + std::to_string(first),
+                     "-dLastPage=" + std::to_string(last), "-sstdout=%stderr", "-sOutputFile=-",
+                     info.file_path},
+                    nullptr, [&](const char* data, size_t size) { return pages.feed(data, size); }).ok();
+            };
+            ConverterLease lease = ConverterPool::instance().checkout(ConverterTool::Ghostscript);
+            bool ok = true;
+            if (sampled.empty()) {
+                ok = render(lease, 1, max_pages);
+            }
+            for (size_t i = 0; ok && i < sampled.size(); ++i) {
+                ok = render(lease, sampled[i], sampled[i]);
+            }
+            lease.release();
+            
+            if (ok && pages.complete() && !coverages.empty()) {
+                const raster::InkCoverage document = raster::merge_coverage(coverages);
+                const int scale = info.dpi / PREFLIGHT_DPI;
+                info.dimensions = std::to_string(coverages.front().width * scale) + " x " +
+                                  std::to_string(coverages.front().height * scale);
+                if (sampled.empty()) {
+                    // Render contínuo (parado no limite se a estrutura
+                    // não foi lida); amostrado, páginas e área ficam as da
+                    // estrutura
+                    info.estimated_pages = static_cast<int>(coverages.size());
+                    info.area_m2 = area;
+                }
+                info.has_color = document.has_color;
+                info.ink_coverage = document.coverage;
+                info.coverage_error = document.error_bound;
+                info.coverage_measured = true;
+            } else {
+                LOG_WARNING("PDF preflight render failed: " + info.file_path);
+            }
+        }
+    } catch (const std::exception& e) {
+        LOG_WARNING("Ink coverage analysis failed for " + info.file_path + ": " + e.what());
+    }
+    
+    if (info.coverage_measured) {
+        LOG_DEBUG("Ink coverage " + info.file_path +
+                  ": C=" + std::to_string(info.ink_coverage[0]) +
+                  " M=" + std::to_string(info.ink_coverage[1]) +
+                  " Y=" + std::to_string(info.ink_coverage[2]) +
+                  " K=" + std::to_string(info.ink_coverage[3]) +
+                  " (+/-" + std::to_string(info.coverage_error) + ")" +
+                  (info.has_color ? " color" : " mono"));
+    }
+}
+
+double FileProcessor::estimate_cost(const FileInfo& info, int copies) const {
+    if (!info.coverage_measured) {
+        return 0.0;
+    }
+    
+    Utils::Config& config = Utils::Config::instance();
+    raster::InkCostModel model;
+    const double ml_per_m2 = config.get_double("cost.ink_ml_per_m2", model.ml_per_m2[0]);
+    const double price_per_ml = config.get_double("cost.ink_price_per_ml", model.price_per_ml[0]);
+    model.ml_per_m2.fill(ml_per_m2);
+    model.price_per_ml = {{price_per_ml, price_per_ml, price_per_ml,
+                           config.get_double("cost.black_ink_price_per_ml", model.price_per_ml[3])}};
+    model.media_price_per_m2 = config.get_double("cost.media_price_per_m2", model.media_price_per_m2);
+    
+    raster::InkCoverage coverage;
+    coverage.coverage = info.ink_coverage;
+    coverage.error_bound = info.coverage_error;
+    return raster::estimate_ink_cost(coverage, info.area_m2, copies, model).total;
+}
+
 FileType FileProcessor::detect_file_type(const std::string& file_path) {
     std::string ext = Utils::FileUtils::get_file_extension(file_path);
 
@@ -77,6 +480,24 @@ std::string FileProcessor::convert_to_pdf(const std::string& input_path,
     
     LOG_INFO("Converting file to PDF: " + input_path);
     
+    // Mesmo conteúdo com as mesmas opções: resultado de uma conversão
+    // anterior. PDF passa por optimize_pdf_for_printing, que tem cache próprio.
+    ConversionCache& cache = ConversionCache::instance();
+    std::string cache_key;
+    if (cache.enabled() && type != FileType::PDF && type != FileType::Unknown) {
+        const std::string hash = cache.content_hash(input_path);
+        if (!hash.empty()) {
+            cache_key = ConversionCache::make_key(
+                {"pdf", hash, normalized_options(Utils::FileUtils::get_file_extension(input_path), options)});
+            const std::string filename = Utils::FileUtils::get_filename(input_path);
+            const std::string cached = unique_output_path(temp_dir_, filename.substr(0, filename.find_last_of('.')));
+            if (cache.fetch(cache_key, cached)) {
+                LOG_INFO("Conversion cache hit: " + input_path + " -> " + cached);
+                return cached;
+            }
+        }
+    }
+    
     std::string output_path;
     
     switch (type) {
@@ -97,6 +518,7 @@ std::string FileProcessor::convert_to_pdf(const std::string& input_path,
             break;
 
         case FileType::CAD:
+        case FileType::SVG:
             output_path = convert_cad_to_pdf(input_path, options);
             break;
 
@@ -115,130 +537,209 @@ std::string FileProcessor::convert_to_pdf(const std::string& input_path,
             break;
     }
     
+    if (!cache_key.empty() && output_path != input_path) {
+        cache.publish(cache_key, output_path);
+    }
     return output_path;
 }
 
 std::string FileProcessor::convert_image_to_pdf(const std::string& input_path, 
                                                const ConversionOptions& options) {
-    std::lock_guard<std::mutex> lock(conversion_mutex_);
-    
-    std::string output_path = temp_dir_ + "/" + 
-                             Utils::FileUtils::get_filename(input_path) + ".pdf";
+    std::string output_path = unique_output_path(temp_dir_, Utils::FileUtils::get_filename(input_path));
     
     LOG_INFO("Converting image to PDF: " + input_path + " -> " + output_path);
     
+    const std::string source = downsample_image(input_path, options);
+    
     // Implementation would use ImageMagick or similar:
-    // system(("convert " + input_path + " " + output_path).c_str());
+    // system(("convert " + source + " " + output_path).c_str());
     
     // For now, just copy the file (stub implementation)
-    Utils::FileUtils::copy_file(input_path, output_path);
+    Utils::FileUtils::copy_file(source, output_path);
+    if (source != input_path) {
+        Utils::FileUtils::remove_file(source);
+    }
     
     return output_path;
 }
 
+std::string FileProcessor::downsample_image(const std::string& input_path,
+                                            const ConversionOptions& options) {
+    if (!is_netpbm(Utils::FileUtils::get_file_extension(input_path))) {
+        return input_path;
+    }
+    
+    try {
+        const raster::PnmHeader header = raster::read_pnm_header(input_path);
+        int width = header.width;
+        int height = header.height;
+        
+        // Resolução acima da pedida não aparece na impressão: só reduz quando
+        // o ganho passa do limiar do plano (limite flexível)
+        if (options.target_dpi > 0 && options.target_dpi < RASTER_SOURCE_DPI) {
+            raster::DownsampleLimits by_dpi;
+            by_dpi.max_width = std::max(1, header.width * options.target_dpi / RASTER_SOURCE_DPI);
+            by_dpi.max_height = std::max(1, header.height * options.target_dpi / RASTER_SOURCE_DPI);
+            raster::plan_downsample(header.width, header.height, by_dpi, width, height);
+        }
+        // max_width/max_height são obrigatórios
+        raster::DownsampleLimits hard;
+        hard.max_width = options.max_width;
+        hard.max_height = options.max_height;
+        hard.min_factor = 1.0;
+        raster::plan_downsample(width, height, hard, width, height);
+        
+        if (width == header.width && height == header.height) {
+            return input_path;
+        }
+        
+        const raster::Image image = raster::to_8bit(raster::read_pnm(input_path));
+        const std::string filename = Utils::FileUtils::get_filename(input_path);
+        const size_t dot = filename.find_last_of('.');
+        const std::string output_path = unique_output_path(
+            temp_dir_, "downsampled_" + filename.substr(0, dot),
+            dot == std::string::npos ? "" : filename.substr(dot));
+        raster::write_pnm(output_path, raster::resample(image, width, height));
+        
+        LOG_INFO("Downsampled " + input_path + " from " + std::to_string(header.width) + "x" +
+                 std::to_string(header.height) + " to " + std::to_string(width) + "x" +
+                 std::to_string(height));
+        return output_path;
+    } catch (const std::exception& e) {
+        LOG_WARNING("Image downsampling failed for " + input_path + ": " + e.what());
+        return input_path;
+    }
+}
+
 std::string FileProcessor::convert_office_to_pdf(const std::string& input_path,
                                                 const ConversionOptions& options) {
-    std::lock_guard<std::mutex> lock(conversion_mutex_);
-
     std::string filename = Utils::FileUtils::get_filename(input_path);
     std::string base_name = filename.substr(0, filename.find_last_of('.'));
-    std::string output_path = temp_dir_ + "/" + base_name + ".pdf";
+    std::string output_path = unique_output_path(temp_dir_, base_name);
+    const std::string produced = base_name + ".pdf";
 
     LOG_INFO("Converting Office document to PDF: " + input_path + " -> " + output_path);
 
-    // Try Pandoc first (preferred method for .docx files)
-    std::string pandoc_cmd = "pandoc \"" + input_path + "\" -o \"" + output_path + "\" 2>&1";
-
-    int result = system(pandoc_cmd.c_str());
-
-    if (result == 0 && std::filesystem::exists(output_path)) {
-        LOG_INFO("Successfully converted document using Pandoc");
-
-        // Apply optimization if requested
-        if (options.compress) {
-            output_path = optimize_pdf_for_printing(output_path, options);
+    ConverterPool& pool = ConverterPool::instance();
+    bool converted = false;
+    {
+        // Try Pandoc first (preferred method for .docx files)
+        ConverterLease lease = pool.checkout(ConverterTool::Pandoc);
+        if (run_converter(lease, {"pandoc", input_path, "-o", lease.work_dir() + "/" + produced},
+                          produced, output_path)) {
+            LOG_INFO("Successfully converted document using Pandoc");
+            converted = true;
         }
-
-        return output_path;
     }
 
-    // Fallback: Try LibreOffice (if available)
-    std::string libreoffice_cmd = "libreoffice --headless --convert-to pdf --outdir \"" +
-                                 temp_dir_ + "\" \"" + input_path + "\" 2>&1";
-
-    result = system(libreoffice_cmd.c_str());
-
-    // LibreOffice creates files with the same base name but .pdf extension
-    std::string lo_output_path = temp_dir_ + "/" + base_name + ".pdf";
-
-    if (result == 0 && std::filesystem::exists(lo_output_path)) {
-        LOG_INFO("Successfully converted document using LibreOffice");
-
-        // Apply optimization if requested
-        if (options.compress) {
-            lo_output_path = optimize_pdf_for_printing(lo_output_path, options);
+    if (!converted) {
+        // Fallback: LibreOffice, pelo listener residente do worker quando no ar
+        ConverterLease lease = pool.checkout(ConverterTool::LibreOffice);
+        const bool warm = lease.warm();
+        if (run_converter(lease, {"libreoffice", "--headless", "--convert-to", "pdf", "--outdir",
+                                  lease.work_dir(), input_path},
+                          produced, output_path)) {
+            LOG_INFO(std::string("Successfully converted document using LibreOffice") +
+                     (warm ? " (warm listener)" : ""));
+            converted = true;
         }
+    }
 
-        return lo_output_path;
+    if (!converted) {
+        LOG_ERROR("Failed to convert Office document to PDF: " + input_path);
+        return input_path; // Return original file if conversion fails
     }
 
-    LOG_ERROR("Failed to convert Office document to PDF: " + input_path);
-    return input_path; // Return original file if conversion fails
+    // Apply optimization if requested; o resultado final já vai para o cache
+    // em convert_to_pdf
+    if (options.compress) {
+        output_path = compress_pdf(output_path);
+    }
+    return output_path;
 }
 
 std::string FileProcessor::convert_cad_to_pdf(const std::string& input_path,
                                                const ConversionOptions& options) {
-    std::lock_guard<std::mutex> lock(conversion_mutex_);
-
     std::string filename = Utils::FileUtils::get_filename(input_path);
     std::string base_name = filename.substr(0, filename.find_last_of('.'));
-    std::string output_path = temp_dir_ + "/" + base_name + ".pdf";
+    std::string output_path = unique_output_path(temp_dir_, base_name);
     std::string ext = Utils::FileUtils::get_file_extension(input_path);
 
     LOG_INFO("Converting CAD file to PDF: " + input_path + " -> " + output_path);
 
+    ConverterPool& pool = ConverterPool::instance();
+
     // Different approaches based on CAD file type
-    if (ext == ".dwg" || ext == ".dxf") {
-        // Try using ODA File Converter if available (commercial)
-        std::string oda_cmd = "ODAFileConverter \"" + temp_dir_ + "\" \"" +
-                              Utils::FileUtils::get_directory(input_path) +
-                              "\" \"ACAD2018\" \"PDF\" \"0\" \"0\"";
-        int result = system(oda_cmd.c_str());
-
-        if (result == 0 && std::filesystem::exists(output_path)) {
-            LOG_INFO("Successfully converted CAD file using ODA File Converter");
-            return output_path;
+    if (ext == ".dxf") {
+        // Leitura própria direto para PDF vetorial; conversores externos só
+        // se o desenho não sair
+        try {
+            const protocols::HpglDisplayList drawing = load_vector_drawing(input_path, ext);
+            if (!drawing.empty()) {
+                protocols::write_hpgl_pdf(drawing, output_path);
+                LOG_INFO("Converted DXF to vector PDF (" + std::to_string(drawing.shapes.size()) +
+                         " shapes)");
+                return output_path;
+            }
+        } catch (const std::exception& e) {
+            LOG_WARNING("Native DXF conversion failed for " + input_path + ": " + e.what());
         }
+    }
 
-        // Fallback: Try using LibreOffice with Draw
-        std::string lo_cmd = "libreoffice --headless --convert-to pdf --outdir \"" +
-                            temp_dir_ + "\" \"" + input_path + "\" 2>&1";
-        result = system(lo_cmd.c_str());
-
-        if (result == 0 && std::filesystem::exists(output_path)) {
-            LOG_INFO("Successfully converted CAD file using LibreOffice Draw");
-            return output_path;
+    if (ext == ".dwg") {
+        // ODA File Converter converte pastas inteiras e só grava DWG/DXF: o
+        // arquivo vai sozinho para a pasta do worker, volta como DXF e segue
+        // pela leitura própria
+        ConverterLease lease = pool.checkout(ConverterTool::OdaConverter);
+        const std::string in_dir = lease.work_dir() + "/in";
+        const std::string out_dir = lease.work_dir() + "/out";
+        Utils::FileUtils::create_directories(in_dir);
+        Utils::FileUtils::create_directories(out_dir);
+        std::error_code ec;
+        std::filesystem::create_hard_link(input_path, in_dir + "/" + filename, ec);
+        if (ec) {
+            Utils::FileUtils::copy_file(input_path, in_dir + "/" + filename);
+        }
+        const std::string dxf_path = out_dir + "/" + base_name + ".dxf";
+        if (lease.run({"ODAFileConverter", in_dir, out_dir, "ACAD2018", "DXF", "0", "1", filename}).ok() &&
+            std::filesystem::exists(dxf_path)) {
+            try {
+                const protocols::HpglDisplayList drawing = load_vector_drawing(dxf_path, ".dxf");
+                if (!drawing.empty()) {
+                    protocols::write_hpgl_pdf(drawing, output_path);
+                    LOG_INFO("Successfully converted CAD file using ODA File Converter");
+                    return output_path;
+                }
+            } catch (const std::exception& e) {
+                LOG_WARNING("DXF from ODA File Converter failed for " + input_path + ": " + e.what());
+            }
         }
+        lease.mark_failed();
     }
-    else if (ext == ".svg") {
-        // SVG to PDF using ImageMagick
-        std::string convert_cmd = "magick convert \"" + input_path + "\" \"" + output_path + "\" 2>&1";
-        int result = system(convert_cmd.c_str());
 
-        if (result == 0 && std::filesystem::exists(output_path)) {
-            LOG_INFO("Successfully converted SVG to PDF using ImageMagick");
+    if (ext == ".dwg" || ext == ".dxf") {
+        // Fallback: Try using LibreOffice with Draw
+        ConverterLease lease = pool.checkout(ConverterTool::LibreOffice);
+        if (run_converter(lease, {"libreoffice", "--headless", "--convert-to", "pdf", "--outdir",
+                                  lease.work_dir(), input_path},
+                          base_name + ".pdf", output_path)) {
+            LOG_INFO("Successfully converted CAD file using LibreOffice Draw");
             return output_path;
         }
     }
-    else if (ext == ".hpgl" || ext == ".plt") {
-        // HPGL/PLT files - try using Ghostscript
-        std::string gs_cmd = "gs -sDEVICE=pdfwrite -sOutputFile=\"" + output_path +
-                            "\" -dBATCH -dNOPAUSE \"" + input_path + "\" 2>&1";
-        int result = system(gs_cmd.c_str());
-
-        if (result == 0 && std::filesystem::exists(output_path)) {
-            LOG_INFO("Successfully converted HPGL/PLT to PDF using Ghostscript");
-            return output_path;
+    else if (is_hpgl_file(ext) || ext == ".svg") {
+        // HPGL/PLT e SVG: leitura própria gera PDF vetorial (Ghostscript não
+        // lê HPGL e o SVG continua vetorial, sem rasterizar)
+        try {
+            const protocols::HpglDisplayList drawing = load_vector_drawing(input_path, ext);
+            if (!drawing.empty()) {
+                protocols::write_hpgl_pdf(drawing, output_path);
+                LOG_INFO("Converted " + ext.substr(1) + " to vector PDF (" +
+                         std::to_string(drawing.shapes.size()) + " shapes)");
+                return output_path;
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR("Vector conversion failed for " + input_path + ": " + e.what());
         }
     }
 
@@ -248,22 +749,25 @@ std::string FileProcessor::convert_cad_to_pdf(const std::string& input_path,
 
 std::string FileProcessor::convert_design_to_pdf(const std::string& input_path,
                                                  const ConversionOptions& options) {
-    std::lock_guard<std::mutex> lock(conversion_mutex_);
-
     std::string filename = Utils::FileUtils::get_filename(input_path);
     std::string base_name = filename.substr(0, filename.find_last_of('.'));
-    std::string output_path = temp_dir_ + "/" + base_name + ".pdf";
+    std::string output_path = unique_output_path(temp_dir_, base_name);
     std::string ext = Utils::FileUtils::get_file_extension(input_path);
+    const std::string produced = base_name + ".pdf";
 
     LOG_INFO("Converting Design file to PDF: " + input_path + " -> " + output_path);
 
+    ConverterPool& pool = ConverterPool::instance();
+    auto with_magick = [&]() {
+        ConverterLease lease = pool.checkout(ConverterTool::ImageMagick);
+        return run_converter(lease, {"magick", input_path, lease.work_dir() + "/" + produced},
+                             produced, output_path);
+    };
+
     // Try different approaches based on file type
     if (ext == ".psd") {
         // PSD to PDF using ImageMagick
-        std::string convert_cmd = "magick convert \"" + input_path + "\" \"" + output_path + "\" 2>&1";
-        int result = system(convert_cmd.c_str());
-
-        if (result == 0 && std::filesystem::exists(output_path)) {
+        if (with_magick()) {
             LOG_INFO("Successfully converted PSD to PDF using ImageMagick");
             return output_path;
         }
@@ -271,50 +775,44 @@ std::string FileProcessor::convert_design_to_pdf(const std::string& input_path,
     else if (ext == ".ai") {
         // AI files - try multiple methods
         // 1. Try ImageMagick first (if AI is saved with PDF compatibility)
-        std::string convert_cmd = "magick convert \"" + input_path + "\" \"" + output_path + "\" 2>&1";
-        int result = system(convert_cmd.c_str());
-
-        if (result == 0 && std::filesystem::exists(output_path)) {
+        if (with_magick()) {
             LOG_INFO("Successfully converted AI to PDF using ImageMagick");
             return output_path;
         }
 
-        // 2. Try using Inkscape if available (not installed in this case)
-        std::string inkscape_cmd = "inkscape --export-pdf=\"" + output_path + "\" \"" + input_path + "\" 2>&1";
-        result = system(inkscape_cmd.c_str());
-
-        if (result == 0 && std::filesystem::exists(output_path)) {
+        // 2. Try using Inkscape if available
+        ConverterLease lease = pool.checkout(ConverterTool::Inkscape);
+        if (run_converter(lease, {"inkscape", "--export-filename=" + lease.work_dir() + "/" + produced,
+                                  input_path},
+                          produced, output_path)) {
             LOG_INFO("Successfully converted AI to PDF using Inkscape");
             return output_path;
         }
     }
     else if (ext == ".eps") {
         // EPS to PDF using Ghostscript
-        std::string gs_cmd = "gs -dNOPAUSE -dBATCH -sDEVICE=pdfwrite -sOutputFile=\"" +
-                            output_path + "\" \"" + input_path + "\" 2>&1";
-        int result = system(gs_cmd.c_str());
-
-        if (result == 0 && std::filesystem::exists(output_path)) {
-            LOG_INFO("Successfully converted EPS to PDF using Ghostscript");
-            return output_path;
+        {
+            ConverterLease lease = pool.checkout(ConverterTool::Ghostscript);
+            if (run_converter(lease, {"gs", "-q", "-dSAFER", "-dNOPAUSE", "-dBATCH", "-sDEVICE=pdfwrite",
+                                      "-sOutputFile=" + lease.work_dir() + "/" + produced, input_path},
+                              produced, output_path)) {
+                LOG_INFO("Successfully converted EPS to PDF using Ghostscript");
+                return output_path;
+            }
         }
 
         // Fallback: Try ImageMagick
-        std::string convert_cmd = "magick convert \"" + input_path + "\" \"" + output_path + "\" 2>&1";
-        result = system(convert_cmd.c_str());
-
-        if (result == 0 && std::filesystem::exists(output_path)) {
+        if (with_magick()) {
             LOG_INFO("Successfully converted EPS to PDF using ImageMagick");
             return output_path;
         }
     }
     else if (ext == ".cdr") {
         // CorelDRAW files - try using LibreOffice
-        std::string lo_cmd = "libreoffice --headless --convert-to pdf --outdir \"" +
-                            temp_dir_ + "\" \"" + input_path + "\" 2>&1";
-        int result = system(lo_cmd.c_str());
-
-        if (result == 0 && std::filesystem::exists(output_path)) {
+        ConverterLease lease = pool.checkout(ConverterTool::LibreOffice);
+        if (run_converter(lease, {"libreoffice", "--headless", "--convert-to", "pdf", "--outdir",
+                                  lease.work_dir(), input_path},
+                          produced, output_path)) {
             LOG_INFO("Successfully converted CDR to PDF using LibreOffice");
             return output_path;
         }
@@ -326,15 +824,44 @@ std::string FileProcessor::convert_design_to_pdf(const std::string& input_path,
 
 std::string FileProcessor::optimize_pdf_for_printing(const std::string& pdf_path,
                                                     const ConversionOptions& options) {
-    std::string output_path = temp_dir_ + "/optimized_" + 
-                             Utils::FileUtils::get_filename(pdf_path);
-    
+    // A otimização não depende das opções: só o conteúdo entra na chave
+    ConversionCache& cache = ConversionCache::instance();
+    const std::string hash = cache.enabled() ? cache.content_hash(pdf_path) : "";
+    const std::string cache_key = hash.empty() ? "" : ConversionCache::make_key({"optimized-pdf", hash});
+    if (!cache_key.empty()) {
+        const std::string filename = Utils::FileUtils::get_filename(pdf_path);
+        const std::string cached = unique_output_path(
+            temp_dir_, filename.substr(0, filename.find_last_of('.')) + "_optimized");
+        if (cache.fetch(cache_key, cached)) {
+            LOG_INFO("Conversion cache hit: optimized " + pdf_path + " -> " + cached);
+            return cached;
+        }
+    }
+
+    const std::string output_path = compress_pdf(pdf_path);
+    if (!cache_key.empty() && output_path != pdf_path) {
+        cache.publish(cache_key, output_path);
+    }
+    return output_path;
+}
+
+std::string FileProcessor::compress_pdf(const std::string& pdf_path) {
+    const std::string filename = Utils::FileUtils::get_filename(pdf_path);
+    const std::string base_name = filename.substr(0, filename.find_last_of('.')) + "_optimized";
+    const std::string output_path = unique_output_path(temp_dir_, base_name);
+    const std::string produced = base_name + ".pdf";
+
     LOG_INFO("Optimizing PDF for printing: " + pdf_path);
-    
-    // Implementation would use Ghostscript:
-    // gs -sDEVICE=pdfwrite -dCompatibilityLevel=1.4 -dPDFSETTINGS=/printer ...
-    
-    Utils::FileUtils::copy_file(pdf_path, output_path);
+
+    ConverterLease lease = ConverterPool::instance().checkout(ConverterTool::Ghostscript);
+    if (!run_converter(lease, {"gs", "-q", "-dSAFER", "-dBATCH", "-dNOPAUSE", "-sDEVICE=pdfwrite",
+                               "-dCompatibilityLevel=1.4", "-dPDFSETTINGS=/printer",
+                               "-sOutputFile=" + lease.work_dir() + "/" + produced, pdf_path},
+                       produced, output_path)) {
+        // Sem Ghostscript o original segue como está, sem cópia
+        LOG_WARNING("PDF optimization failed, using original: " + pdf_path);
+        return pdf_path;
+    }
     return output_path;
 }
 
@@ -345,6 +872,32 @@ std::string FileProcessor::generate_preview_image(const std::string& file_path,
     
     LOG_INFO("Generating preview: " + file_path);
     
+    const std::string ext = Utils::FileUtils::get_file_extension(file_path);
+    if (is_native_vector(ext)) {
+        // Rasterizado com anti-aliasing para caber em width x height
+        output_path = temp_dir_ + "/preview_" + Utils::FileUtils::get_filename(file_path) + ".ppm";
+        try {
+            const protocols::HpglDisplayList drawing = load_vector_drawing(file_path, ext);
+            if (drawing.empty()) {
+                return "";
+            }
+            protocols::HpglRenderOptions render;
+            render.fit_width = width;
+            render.fit_height = height;
+            const raster::TiledRaster page = protocols::render_hpgl(drawing, render);
+            raster::Image image;
+            image.width = page.width();
+            image.height = page.height();
+            image.format = page.format();
+            image.data = page.to_buffer();
+            raster::write_pnm(output_path, image);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Vector preview failed for " + file_path + ": " + e.what());
+            return "";
+        }
+        return output_path;
+    }
+    
     // Implementation would use ImageMagick or Poppler
     
     return output_path;
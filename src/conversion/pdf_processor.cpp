@@ -1,9 +1,1185 @@
-#include "conversion/file_processor.h"
+#include "conversion/pdf_processor.h"
+#include "raster/icc_catalog.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#ifdef ALL_PRESS_HAVE_ZLIB
+#include <zlib.h>
+#endif
 
-// PDF processor implementation
-// This file would contain PDF-specific processing using Poppler
 namespace AllPress {
 
-// Stub for PDF processing functions
+namespace {
+
+namespace raster = all_press::raster;
+
+constexpr int MAX_NESTING = 64;             // Arrays e dicionários aninhados
+constexpr int MAX_DEPTH = 64;               // Árvore de páginas, formulários, padrões
+constexpr int MAX_RESOLVE_DEPTH = 32;       // Referências dentro de referências
+constexpr size_t STARTXREF_WINDOW = 4096;
+constexpr size_t MAX_DECODED_BYTES = size_t(256) << 20;
+constexpr double LETTER_WIDTH_PT = 612.0;
+constexpr double LETTER_HEIGHT_PT = 792.0;
+
+bool is_space(uint8_t c) {
+    return c == 0 || c == 9 || c == 10 || c == 12 || c == 13 || c == 32;
+}
+
+bool is_delimiter(uint8_t c) {
+    return c == '(' || c == ')' || c == '<' || c == '>' || c == '[' || c == ']' ||
+           c == '{' || c == '}' || c == '/' || c == '%';
+}
+
+bool is_regular(uint8_t c) {
+    return !is_space(c) && !is_delimiter(c);
+}
+
+bool is_digit(uint8_t c) {
+    return c >= '0' && c <= '9';
+}
+
+[[noreturn]] void fail(const std::string& message) {
+    throw std::runtime_error(message);
+}
+
+// Objeto PDF; strings não guardam o conteúdo (nada aqui precisa dele).
+// Streams só existem como objetos indiretos do arquivo: os dados ficam no
+// mapeamento, a partir de stream_start.
+struct Object {
+    enum class Type : uint8_t { Null, Boolean, Number, String, Name, Array, Dictionary, Reference, Stream };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    bool integer = false;
+    double number = 0.0;
+    int num = 0;                        // Reference
+    int gen = 0;
+    std::string name;
+    std::vector<Object> items;          // Elementos do array; valores do dicionário
+    std::vector<std::string> keys;      // Chaves do dicionário (também do stream)
+    size_t stream_start = 0;
+
+    bool is(Type t) const { return type == t; }
+    bool is_name(const char* value) const { return type == Type::Name && name == value; }
+    bool has_dictionary() const { return type == Type::Dictionary || type == Type::Stream; }
+
+    const Object* get(const char* key) const {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (keys[i] == key) {
+                return &items[i];
+            }
+        }
+        return nullptr;
+    }
+};
+
+class Lexer {
+public:
+    Lexer(const uint8_t* data, size_t size, size_t pos) : data_(data), size_(size), pos_(std::min(pos, size)) {}
+
+    size_t pos() const { return pos_; }
+    void seek(size_t pos) { pos_ = std::min(pos, size_); }
+    bool at_end() { skip_space(); return pos_ >= size_; }
+
+    void skip_space() {
+        while (pos_ < size_) {
+            const uint8_t c = data_[pos_];
+            if (is_space(c)) {
+                ++pos_;
+            } else if (c == '%') {
+                while (pos_ < size_ && data_[pos_] != '\n' && data_[pos_] != '\r') {
+                    ++pos_;
+                }
+            } else {
+                break;
+            }
+        }
+    }
+
+    // Palavra regular seguinte igual a word: consumida
+    bool keyword(const char* word) {
+        skip_space();
+        const size_t length = std::strlen(word);
+        if (pos_ + length > size_ || std::memcmp(data_ + pos_, word, length) != 0 ||
+            (pos_ + length < size_ && is_regular(data_[pos_ + length]))) {
+            return false;
+        }
+        pos_ += length;
+        return true;
+    }
+
+    // Inteiro sem sinal seguinte: consumido
+    bool unsigned_integer(uint64_t& value) {
+        skip_space();
+        size_t end = pos_;
+        value = 0;
+        while (end < size_ && is_digit(data_[end]) && end - pos_ < 19) {
+            value = value * 10 + (data_[end] - '0');
+            ++end;
+        }
+        if (end == pos_ || (end < size_ && is_regular(data_[end]))) {
+            return false;
+        }
+        pos_ = end;
+        return true;
+    }
+
+    Object parse(int depth = 0) {
+        if (depth > MAX_NESTING) {
+            fail("PDF objects nested too deeply");
+        }
+        skip_space();
+        if (pos_ >= size_) {
+            fail("unexpected end of PDF data");
+        }
+        Object object;
+        const uint8_t c = data_[pos_];
+        if (c == '/') {
+            object.type = Object::Type::Name;
+            object.name = read_name();
+        } else if (c == '(') {
+            skip_literal_string();
+            object.type = Object::Type::String;
+        } else if (c == '<' && pos_ + 1 < size_ && data_[pos_ + 1] == '<') {
+            pos_ += 2;
+            object.type = Object::Type::Dictionary;
+            while (true) {
+                skip_space();
+                if (pos_ + 1 < size_ && data_[pos_] == '>' && data_[pos_ + 1] == '>') {
+                    pos_ += 2;
+                    break;
+                }
+                if (pos_ >= size_ || data_[pos_] != '/') {
+                    fail("malformed PDF dictionary");
+                }
+                object.keys.push_back(read_name());
+                object.items.push_back(parse(depth + 1));
+            }
+        } else if (c == '<') {
+            const void* end = std::memchr(data_ + pos_, '>', size_ - pos_);
+            if (!end) {
+                fail("unterminated PDF hex string");
+            }
+            pos_ = static_cast<size_t>(static_cast<const uint8_t*>(end) - data_) + 1;
+            object.type = Object::Type::String;
+        } else if (c == '[') {
+            ++pos_;
+            object.type = Object::Type::Array;
+            while (true) {
+                skip_space();
+                if (pos_ < size_ && data_[pos_] == ']') {
+                    ++pos_;
+                    break;
+                }
+                object.items.push_back(parse(depth + 1));
+            }
+        } else if (is_digit(c) || c == '+' || c == '-' || c == '.') {
+            parse_number(object);
+        } else if (is_regular(c)) {
+            const size_t start = pos_;
+            while (pos_ < size_ && is_regular(data_[pos_])) {
+                ++pos_;
+            }
+            const std::string word(reinterpret_cast<const char*>(data_ + start), pos_ - start);
+            if (word == "true" || word == "false") {
+                object.type = Object::Type::Boolean;
+                object.boolean = word == "true";
+            } else if (word != "null") {
+                pos_ = start;
+                fail("unexpected PDF keyword '" + word + "'");
+            }
+        } else {
+            fail("unexpected PDF delimiter");
+        }
+        return object;
+    }
+
+private:
+    std::string read_name() {
+        ++pos_;   // '/'
+        std::string name;
+        while (pos_ < size_ && is_regular(data_[pos_])) {
+            const uint8_t c = data_[pos_++];
+            if (c == '#' && pos_ + 1 < size_ && std::isxdigit(data_[pos_]) && std::isxdigit(data_[pos_ + 1])) {
+                const char hex[3] = {static_cast<char>(data_[pos_]), static_cast<char>(data_[pos_ + 1]), 0};
+                name += static_cast<char>(std::strtol(hex, nullptr, 16));
+                pos_ += 2;
+            } else {
+                name += static_cast<char>(c);
+            }
+        }
+        return name;
+    }
+
+    void skip_literal_string() {
+        int open = 0;
+        while (pos_ < size_) {
+            const uint8_t c = data_[pos_++];
+            if (c == '\\') {
+                ++pos_;
+            } else if (c == '(') {
+                ++open;
+            } else if (c == ')' && --open == 0) {
+                return;
+            }
+        }
+        fail("unterminated PDF string");
+    }
+
+    // Inteiro seguido de "gen R" vira referência
+    void parse_number(Object& object) {
+        const size_t start = pos_;
+        while (pos_ < size_ && is_regular(data_[pos_])) {
+            ++pos_;
+        }
+        char text[64];
+        const size_t length = std::min(pos_ - start, sizeof(text) - 1);
+        std::memcpy(text, data_ + start, length);
+        text[length] = 0;
+        object.type = Object::Type::Number;
+        object.number = std::strtod(text, nullptr);
+        object.integer = std::strchr(text, '.') == nullptr;
+        if (!object.integer || object.number < 0 || text[0] == '+' || text[0] == '-') {
+            return;
+        }
+        const size_t after = pos_;
+        uint64_t gen = 0;
+        if (unsigned_integer(gen) && keyword("R")) {
+            object.type = Object::Type::Reference;
+            object.num = static_cast<int>(object.number);
+            object.gen = static_cast<int>(gen);
+            return;
+        }
+        pos_ = after;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+};
+
+const uint8_t* find_bytes(const uint8_t* begin, const uint8_t* end, const char* needle) {
+    const size_t length = std::strlen(needle);
+    if (static_cast<size_t>(end - begin) < length) {
+        return nullptr;
+    }
+    const void* found = ::memmem(begin, static_cast<size_t>(end - begin), needle, length);
+    return static_cast<const uint8_t*>(found);
+}
+
+// Desfaz o preditor PNG (Predictor >= 10) linha a linha
+std::vector<uint8_t> undo_png_predictor(const std::vector<uint8_t>& data, int columns, int colors, int bits) {
+    const size_t bpp = std::max<size_t>(1, static_cast<size_t>(colors) * bits / 8);
+    const size_t row_bytes = (static_cast<size_t>(columns) * colors * bits + 7) / 8;
+    std::vector<uint8_t> out;
+    out.reserve(data.size());
+    std::vector<uint8_t> previous(row_bytes, 0);
+    std::vector<uint8_t> row(row_bytes);
+    for (size_t pos = 0; pos + 1 + row_bytes <= data.size(); pos += 1 + row_bytes) {
+        const uint8_t filter = data[pos];
+        const uint8_t* in = data.data() + pos + 1;
+        for (size_t i = 0; i < row_bytes; ++i) {
+            const int left = i >= bpp ? row[i - bpp] : 0;
+            const int up = previous[i];
+            const int up_left = i >= bpp ? previous[i - bpp] : 0;
+            int predicted = 0;
+            switch (filter) {
+                case 1: predicted = left; break;
+                case 2: predicted = up; break;
+                case 3: predicted = (left + up) / 2; break;
+                case 4: {
+                    const int p = left + up - up_left;
+                    const int pa = std::abs(p - left);
+                    const int pb = std::abs(p - up);
+                    const int pc = std::abs(p - up_left);
+                    predicted = pa <= pb && pa <= pc ? left : (pb <= pc ? up : up_left);
+                    break;
+                }
+                default: break;
+            }
+            row[i] = static_cast<uint8_t>(in[i] + predicted);
+        }
+        out.insert(out.end(), row.begin(), row.end());
+        previous.swap(row);
+    }
+    return out;
+}
+
+std::vector<uint8_t> inflate_bytes(const uint8_t* data, size_t size) {
+#ifdef ALL_PRESS_HAVE_ZLIB
+    std::vector<uint8_t> out(std::max<size_t>(size * 4, 4096));
+    z_stream stream = {};
+    if (inflateInit(&stream) != Z_OK) {
+        fail("zlib initialization failed");
+    }
+    stream.next_in = const_cast<Bytef*>(data);
+    stream.avail_in = static_cast<uInt>(size);
+    int status = Z_OK;
+    while (status != Z_STREAM_END) {
+        if (stream.total_out == out.size()) {
+            if (out.size() >= MAX_DECODED_BYTES) {
+                inflateEnd(&stream);
+                fail("PDF stream too large");
+            }
+            out.resize(out.size() * 2);
+        }
+        stream.next_out = out.data() + stream.total_out;
+        stream.avail_out = static_cast<uInt>(out.size() - stream.total_out);
+        status = inflate(&stream, Z_NO_FLUSH);
+        // Streams truncados são comuns: vale o que foi descomprimido
+        if (status != Z_OK && status != Z_STREAM_END) {
+            break;
+        }
+        if (status == Z_OK && stream.avail_in == 0 && stream.avail_out > 0) {
+            break;
+        }
+    }
+    out.resize(stream.total_out);
+    inflateEnd(&stream);
+    return out;
+#else
+    (void)data;
+    (void)size;
+    fail("compressed PDF structure requires zlib");
+#endif
+}
+
+// Entrada da xref: tipo 0 livre, 1 no arquivo (offset), 2 em object stream
+// (número do stream, índice)
+struct XrefEntry {
+    int type = 0;
+    uint64_t field1 = 0;
+    uint64_t field2 = 0;
+};
+
+// Subseção: entradas first..first+count-1. Na tabela clássica offset aponta
+// para a primeira entrada no arquivo; no xref stream é a linha inicial.
+struct XrefSubsection {
+    int first = 0;
+    int count = 0;
+    size_t offset = 0;
+};
+
+struct XrefSection {
+    bool classic = true;
+    size_t stride = 20;                 // Bytes por entrada da tabela clássica
+    std::vector<XrefSubsection> subsections;
+    std::vector<uint8_t> rows;          // xref stream decodificado
+    int widths[3] = {1, 0, 0};
+};
+
+struct ObjectStream {
+    std::vector<uint8_t> data;
+    size_t first = 0;
+    std::vector<std::pair<int, size_t>> offsets;   // (número, offset a partir de first)
+};
+
+class Reader {
+public:
+    explicit Reader(const std::string& path) : file_(path), data_(file_.data()), size_(file_.size()) {}
+
+    void open(PdfStructure& structure) {
+        const uint8_t* header = find_bytes(data_, data_ + std::min<size_t>(size_, 1024), "%PDF-");
+        if (!header) {
+            fail("not a PDF file");
+        }
+        const uint8_t* version = header + 5;
+        while (version < data_ + size_ && (is_digit(*version) || *version == '.') &&
+               structure.version.size() < 8) {
+            structure.version += static_cast<char>(*version++);
+        }
+        try {
+            load_xref();
+        } catch (const std::exception&) {
+            repair();
+        }
+        if (!trailer_.get("Root")) {
+            repair();
+        }
+        structure.encrypted = trailer_.get("Encrypt") != nullptr;
+        structure.repaired = repaired_;
+    }
+
+    bool repaired() const { return repaired_; }
+    const Object& trailer() const { return trailer_; }
+
+    Object resolve(const Object& object) {
+        Object current = object;
+        for (int depth = 0; current.is(Object::Type::Reference); ++depth) {
+            if (depth >= MAX_RESOLVE_DEPTH) {
+                fail("PDF reference chain too long");
+            }
+            current = load(current.num);
+        }
+        return current;
+    }
+
+    // Valor numérico (resolvendo referência); fallback se não for número
+    double number(const Object* object, double fallback) {
+        if (!object) {
+            return fallback;
+        }
+        const Object value = resolve(*object);
+        return value.is(Object::Type::Number) ? value.number : fallback;
+    }
+
+    Object load(int num) {
+        if (++load_depth_ > MAX_RESOLVE_DEPTH) {
+            --load_depth_;
+            fail("PDF object references nested too deeply");
+        }
+        struct DepthGuard {
+            int& depth;
+            ~DepthGuard() { --depth; }
+        } guard{load_depth_};
+
+        if (!repaired_) {
+            XrefEntry entry;
+            if (find_entry(num, entry)) {
+                if (entry.type == 1) {
+                    try {
+                        return parse_indirect(static_cast<size_t>(entry.field1), num);
+                    } catch (const std::exception&) {
+                        // Offset errado: procura pela varredura
+                    }
+                } else if (entry.type == 2) {
+                    return load_compressed(static_cast<int>(entry.field1), static_cast<size_t>(entry.field2), num);
+                }
+            }
+        }
+        build_scan_index();
+        auto it = scan_index_.find(num);
+        if (it != scan_index_.end()) {
+            return parse_indirect(it->second, num);
+        }
+        auto compressed = scan_compressed_.find(num);
+        if (compressed != scan_compressed_.end()) {
+            return load_compressed(compressed->second, SIZE_MAX, num);
+        }
+        return Object{};
+    }
+
+    std::vector<uint8_t> decode(const Object& stream) {
+        const uint8_t* begin = data_ + stream.stream_start;
+        size_t length = static_cast<size_t>(std::max(0.0, number(stream.get("Length"), -1.0)));
+        const uint8_t* end_marker = nullptr;
+        if (stream.stream_start + length > size_ ||
+            !(end_marker = find_bytes(begin + length, data_ + std::min(size_, stream.stream_start + length + 32),
+                                      "endstream"))) {
+            // /Length ausente ou errado: até o endstream
+            end_marker = find_bytes(begin, data_ + size_, "endstream");
+            if (!end_marker) {
+                fail("PDF stream without endstream");
+            }
+            length = static_cast<size_t>(end_marker - begin);
+            while (length > 0 && (begin[length - 1] == '\n' || begin[length - 1] == '\r')) {
+                --length;
+            }
+        }
+
+        std::vector<std::string> filters;
+        Object parms;
+        if (const Object* filter = stream.get("Filter")) {
+            const Object value = resolve(*filter);
+            if (value.is(Object::Type::Name)) {
+                filters.push_back(value.name);
+            } else if (value.is(Object::Type::Array)) {
+                for (const auto& item : value.items) {
+                    filters.push_back(resolve(item).name);
+                }
+            }
+        }
+        if (const Object* decode_parms = stream.get("DecodeParms")) {
+            parms = resolve(*decode_parms);
+            if (parms.is(Object::Type::Array)) {
+                parms = parms.items.empty() ? Object{} : resolve(parms.items.back());
+            }
+        }
+
+        std::vector<uint8_t> data(begin, begin + length);
+        for (const auto& filter : filters) {
+            if (filter == "FlateDecode" || filter == "Fl") {
+                data = inflate_bytes(data.data(), data.size());
+            } else {
+                fail("unsupported PDF filter " + filter + " in structure stream");
+            }
+        }
+        const int predictor = static_cast<int>(number(parms.get("Predictor"), 1));
+        if (predictor >= 10) {
+            data = undo_png_predictor(data, static_cast<int>(number(parms.get("Columns"), 1)),
+                                      static_cast<int>(number(parms.get("Colors"), 1)),
+                                      static_cast<int>(number(parms.get("BitsPerComponent"), 8)));
+        } else if (predictor != 1) {
+            fail("unsupported PDF predictor " + std::to_string(predictor));
+        }
+        return data;
+    }
+
+private:
+    size_t find_startxref() const {
+        const size_t window = std::min(size_, STARTXREF_WINDOW);
+        const uint8_t* begin = data_ + size_ - window;
+        const uint8_t* found = nullptr;
+        for (const uint8_t* p = begin; (p = find_bytes(p, data_ + size_, "startxref")); ++p) {
+            found = p;
+        }
+        if (!found) {
+            fail("startxref not found");
+        }
+        Lexer lexer(data_, size_, static_cast<size_t>(found - data_) + 9);
+        uint64_t offset = 0;
+        if (!lexer.unsigned_integer(offset) || offset >= size_) {
+            fail("invalid startxref");
+        }
+        return static_cast<size_t>(offset);
+    }
+
+    // Revisões da mais nova para a mais antiga, seguindo /Prev
+    void load_xref() {
+        std::unordered_set<size_t> seen;
+        size_t offset = find_startxref();
+        bool newest = true;
+        while (seen.insert(offset).second) {
+            Object section_trailer = read_section(offset);
+            if (newest) {
+                trailer_ = section_trailer;
+                newest = false;
+            }
+            const Object* prev = section_trailer.get("Prev");
+            if (!prev || !prev->is(Object::Type::Number) || prev->number < 0 || prev->number >= size_) {
+                break;
+            }
+            offset = static_cast<size_t>(prev->number);
+        }
+    }
+
+    Object read_section(size_t offset) {
+        Lexer lexer(data_, size_, offset);
+        if (!lexer.keyword("xref")) {
+            return read_xref_stream(offset);
+        }
+        XrefSection section;
+        while (!lexer.keyword("trailer")) {
+            uint64_t first = 0;
+            uint64_t count = 0;
+            if (!lexer.unsigned_integer(first) || !lexer.unsigned_integer(count)) {
+                fail("malformed xref table");
+            }
+            lexer.skip_space();
+            const size_t start = lexer.pos();
+            if (count > 0) {
+                // 20 bytes pela norma; alguns geradores usam fim de linha de 1 byte
+                if (start + 18 > size_ || (data_[start + 17] != 'n' && data_[start + 17] != 'f')) {
+                    fail("malformed xref entry");
+                }
+                size_t next = start + 18;
+                while (next < size_ && next < start + 21 && is_space(data_[next])) {
+                    ++next;
+                }
+                section.stride = next - start;
+            }
+            if (start + count * section.stride > size_ + 2) {
+                fail("xref table past end of file");
+            }
+            section.subsections.push_back({static_cast<int>(first), static_cast<int>(count), start});
+            lexer.seek(start + count * section.stride);
+        }
+        Object trailer = lexer.parse();
+        if (!trailer.is(Object::Type::Dictionary)) {
+            fail("malformed trailer");
+        }
+        sections_.push_back(std::move(section));
+        // Arquivo híbrido: objetos em object streams listados num xref stream à parte
+        if (const Object* stream = trailer.get("XRefStm")) {
+            if (stream->is(Object::Type::Number) && stream->number >= 0 && stream->number < size_) {
+                try {
+                    read_xref_stream(static_cast<size_t>(stream->number));
+                } catch (const std::exception&) {
+                }
+            }
+        }
+        return trailer;
+    }
+
+    Object read_xref_stream(size_t offset) {
+        Object stream = parse_indirect(offset, -1);
+        if (!stream.is(Object::Type::Stream) || !stream.get("Type") || !stream.get("Type")->is_name("XRef")) {
+            fail("xref stream expected at startxref");
+        }
+        XrefSection section;
+        section.classic = false;
+        const Object* widths = stream.get("W");
+        if (!widths || !widths->is(Object::Type::Array) || widths->items.size() < 3) {
+            fail("xref stream without /W");
+        }
+        int row_bytes = 0;
+        for (int i = 0; i < 3; ++i) {
+            section.widths[i] = static_cast<int>(widths->items[i].number);
+            if (section.widths[i] < 0 || section.widths[i] > 8) {
+                fail("invalid xref stream /W");
+            }
+            row_bytes += section.widths[i];
+        }
+        if (row_bytes == 0) {
+            fail("invalid xref stream /W");
+        }
+        section.rows = decode(stream);
+        const size_t rows = section.rows.size() / static_cast<size_t>(row_bytes);
+
+        std::vector<int> index;
+        if (const Object* ranges = stream.get("Index")) {
+            for (const auto& item : ranges->items) {
+                index.push_back(static_cast<int>(item.number));
+            }
+        } else {
+            index = {0, static_cast<int>(number(stream.get("Size"), 0))};
+        }
+        size_t row = 0;
+        for (size_t i = 0; i + 1 < index.size() && row < rows; i += 2) {
+            const int count = static_cast<int>(std::min<size_t>(std::max(0, index[i + 1]), rows - row));
+            section.subsections.push_back({index[i], count, row});
+            row += static_cast<size_t>(count);
+        }
+        sections_.push_back(std::move(section));
+        return stream;
+    }
+
+    // Entradas livres seguem para revisões anteriores
+    bool find_entry(int num, XrefEntry& entry) const {
+        for (const auto& section : sections_) {
+            for (const auto& sub : section.subsections) {
+                if (num < sub.first || num >= sub.first + sub.count) {
+                    continue;
+                }
+                const size_t index = static_cast<size_t>(num - sub.first);
+                if (section.classic) {
+                    const uint8_t* p = data_ + sub.offset + index * section.stride;
+                    if (p + 18 > data_ + size_) {
+                        continue;
+                    }
+                    uint64_t offset = 0;
+                    for (int i = 0; i < 10; ++i) {
+                        offset = offset * 10 + (p[i] - '0');
+                    }
+                    entry.type = p[17] == 'n' ? 1 : 0;
+                    entry.field1 = offset;
+                    entry.field2 = 0;
+                } else {
+                    const int row_bytes = section.widths[0] + section.widths[1] + section.widths[2];
+                    const uint8_t* p = section.rows.data() + (sub.offset + index) * row_bytes;
+                    uint64_t fields[3] = {1, 0, 0};
+                    for (int f = 0; f < 3; ++f) {
+                        if (section.widths[f] == 0) {
+                            continue;
+                        }
+                        fields[f] = 0;
+                        for (int b = 0; b < section.widths[f]; ++b) {
+                            fields[f] = (fields[f] << 8) | *p++;
+                        }
+                    }
+                    entry.type = static_cast<int>(fields[0]);
+                    entry.field1 = fields[1];
+                    entry.field2 = fields[2];
+                }
+                if (entry.type == 1 || entry.type == 2) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // "num gen obj <objeto> [stream]"; expected_num < 0 aceita qualquer número
+    Object parse_indirect(size_t offset, int expected_num) {
+        Lexer lexer(data_, size_, offset);
+        uint64_t num = 0;
+        uint64_t gen = 0;
+        if (!lexer.unsigned_integer(num) || !lexer.unsigned_integer(gen) || !lexer.keyword("obj") ||
+            (expected_num >= 0 && num != static_cast<uint64_t>(expected_num))) {
+            fail("PDF object " + std::to_string(expected_num) + " not found at offset " + std::to_string(offset));
+        }
+        Object object = lexer.parse();
+        if (object.is(Object::Type::Dictionary) && lexer.keyword("stream")) {
+            size_t start = lexer.pos();
+            if (start < size_ && data_[start] == '\r') {
+                ++start;
+            }
+            if (start < size_ && data_[start] == '\n') {
+                ++start;
+            }
+            object.type = Object::Type::Stream;
+            object.stream_start = start;
+        }
+        return object;
+    }
+
+    const ObjectStream& object_stream(int num) {
+        auto found = object_streams_.find(num);
+        if (found != object_streams_.end()) {
+            return *found->second;
+        }
+        auto stream = std::make_unique<ObjectStream>();
+        const Object object = load(num);
+        if (!object.is(Object::Type::Stream)) {
+            fail("object stream " + std::to_string(num) + " not found");
+        }
+        stream->data = decode(object);
+        stream->first = static_cast<size_t>(std::max(0.0, number(object.get("First"), 0)));
+        const int count = static_cast<int>(number(object.get("N"), 0));
+        Lexer lexer(stream->data.data(), stream->data.size(), 0);
+        for (int i = 0; i < count; ++i) {
+            uint64_t object_num = 0;
+            uint64_t offset = 0;
+            if (!lexer.unsigned_integer(object_num) || !lexer.unsigned_integer(offset)) {
+                break;
+            }
+            stream->offsets.emplace_back(static_cast<int>(object_num), static_cast<size_t>(offset));
+        }
+        return *object_streams_.emplace(num, std::move(stream)).first->second;
+    }
+
+    Object load_compressed(int stream_num, size_t index, int num) {
+        const ObjectStream& stream = object_stream(stream_num);
+        size_t offset = SIZE_MAX;
+        if (index < stream.offsets.size() && stream.offsets[index].first == num) {
+            offset = stream.offsets[index].second;
+        } else {
+            for (const auto& entry : stream.offsets) {
+                if (entry.first == num) {
+                    offset = entry.second;
+                }
+            }
+        }
+        if (offset == SIZE_MAX) {
+            return Object{};
+        }
+        Lexer lexer(stream.data.data(), stream.data.size(), stream.first + offset);
+        return lexer.parse();
+    }
+
+    // Índice de objetos por varredura do arquivo: xref ausente ou com
+    // offsets errados (a última definição de cada número vale)
+    void build_scan_index() {
+        if (scanned_) {
+            return;
+        }
+        scanned_ = true;
+        const uint8_t* end = data_ + size_;
+        for (const uint8_t* p = data_; (p = find_bytes(p, end, "obj")); p += 3) {
+            if ((p + 3 < end && is_regular(p[3])) || p == data_) {
+                continue;
+            }
+            // Volta sobre "num gen "
+            const uint8_t* q = p;
+            while (q > data_ && is_space(q[-1])) --q;
+            const uint8_t* gen_end = q;
+            while (q > data_ && is_digit(q[-1])) --q;
+            if (q == gen_end) continue;
+            const uint8_t* gen_start = q;
+            while (q > data_ && is_space(q[-1])) --q;
+            if (q == gen_start) continue;
+            const uint8_t* num_end = q;
+            while (q > data_ && is_digit(q[-1])) --q;
+            if (q == num_end || (q > data_ && is_regular(q[-1]))) continue;
+            const int num = std::atoi(std::string(reinterpret_cast<const char*>(q), num_end - q).c_str());
+            scan_index_[num] = static_cast<size_t>(q - data_);
+        }
+        // Objetos dentro de object streams achados na varredura
+        std::vector<std::pair<int, size_t>> streams(scan_index_.begin(), scan_index_.end());
+        for (const auto& candidate : streams) {
+            try {
+                const Object object = parse_indirect(candidate.second, candidate.first);
+                if (object.is(Object::Type::Stream) && object.get("Type") && object.get("Type")->is_name("ObjStm")) {
+                    for (const auto& entry : object_stream(candidate.first).offsets) {
+                        if (!scan_index_.count(entry.first)) {
+                            scan_compressed_[entry.first] = candidate.first;
+                        }
+                    }
+                }
+            } catch (const std::exception&) {
+            }
+        }
+    }
+
+    // Sem xref utilizável: objetos pela varredura e trailer do último
+    // dicionário "trailer" (ou do último xref stream, ou do catálogo achado)
+    void repair() {
+        repaired_ = true;
+        build_scan_index();
+        trailer_ = Object{};
+        const uint8_t* end = data_ + size_;
+        for (const uint8_t* p = data_; (p = find_bytes(p, end, "trailer")); p += 7) {
+            try {
+                Lexer lexer(data_, size_, static_cast<size_t>(p - data_) + 7);
+                Object candidate = lexer.parse();
+                if (candidate.is(Object::Type::Dictionary) && candidate.get("Root")) {
+                    trailer_ = candidate;
+                }
+            } catch (const std::exception&) {
+            }
+        }
+        if (trailer_.get("Root")) {
+            return;
+        }
+        for (const auto& entry : scan_index_) {
+            try {
+                const Object object = parse_indirect(entry.second, entry.first);
+                const Object* type = object.get("Type");
+                if (type && (type->is_name("Catalog") || (type->is_name("XRef") && object.get("Root")))) {
+                    Object root;
+                    if (type->is_name("Catalog")) {
+                        root.type = Object::Type::Reference;
+                        root.num = entry.first;
+                    } else {
+                        root = *object.get("Root");
+                    }
+                    trailer_ = Object{};
+                    trailer_.type = Object::Type::Dictionary;
+                    trailer_.keys.push_back("Root");
+                    trailer_.items.push_back(root);
+                    return;
+                }
+            } catch (const std::exception&) {
+            }
+        }
+        fail("PDF has no readable catalog");
+    }
+
+    raster::MappedFile file_;
+    const uint8_t* data_;
+    size_t size_;
+    std::vector<XrefSection> sections_;
+    Object trailer_;
+    bool repaired_ = false;
+    bool scanned_ = false;
+    int load_depth_ = 0;
+    std::unordered_map<int, size_t> scan_index_;
+    std::unordered_map<int, int> scan_compressed_;
+    std::unordered_map<int, std::unique_ptr<ObjectStream>> object_streams_;
+};
+
+// Espaços de cor declarados nos recursos. Objetos indiretos já vistos
+// (recursos, imagens, formulários compartilhados entre páginas) vêm do cache.
+class ColorScanner {
+public:
+    ColorScanner(Reader& reader, std::vector<std::string>& families) : reader_(reader), families_(families) {}
+
+    bool resources(const Object& value, int depth) {
+        return cached(value, depth, [this](const Object& dict, int d) {
+            bool color = false;
+            if (const Object* spaces = dict.get("ColorSpace")) {
+                const Object entries = reader_.resolve(*spaces);
+                for (const auto& space : entries.items) {
+                    color |= color_space(space, d + 1);
+                }
+            }
+            if (const Object* xobjects = dict.get("XObject")) {
+                const Object entries = reader_.resolve(*xobjects);
+                for (const auto& xobject : entries.items) {
+                    color |= this->xobject(xobject, d + 1);
+                }
+            }
+            if (const Object* shadings = dict.get("Shading")) {
+                const Object entries = reader_.resolve(*shadings);
+                for (const auto& entry : entries.items) {
+                    color |= shading(entry, d + 1);
+                }
+            }
+            if (const Object* patterns = dict.get("Pattern")) {
+                const Object entries = reader_.resolve(*patterns);
+                for (const auto& entry : entries.items) {
+                    color |= pattern(entry, d + 1);
+                }
+            }
+            return color;
+        });
+    }
+
+    // Grupo de transparência da página ou do formulário
+    bool group(const Object* value, int depth) {
+        if (!value) {
+            return false;
+        }
+        const Object dict = reader_.resolve(*value);
+        const Object* space = dict.get("CS");
+        return space && color_space(*space, depth + 1);
+    }
+
+private:
+    template <typename Analyze>
+    bool cached(const Object& value, int depth, Analyze analyze) {
+        if (depth > MAX_DEPTH) {
+            return false;
+        }
+        if (value.is(Object::Type::Reference)) {
+            auto it = cache_.find(value.num);
+            if (it != cache_.end()) {
+                return it->second;
+            }
+            cache_[value.num] = false;   // Ciclo: conta como sem cor
+        }
+        const Object resolved = reader_.resolve(value);
+        const bool color = analyze(resolved, depth);
+        if (value.is(Object::Type::Reference)) {
+            cache_[value.num] = color;
+        }
+        return color;
+    }
+
+    bool xobject(const Object& value, int depth) {
+        return cached(value, depth, [this](const Object& object, int d) {
+            const Object* subtype = object.get("Subtype");
+            if (!subtype) {
+                return false;
+            }
+            if (subtype->is_name("Image")) {
+                const Object* mask = object.get("ImageMask");
+                if (mask && mask->boolean) {
+                    return false;   // Máscara pinta com a cor corrente
+                }
+                if (const Object* space = object.get("ColorSpace")) {
+                    return color_space(*space, d + 1);
+                }
+                // JPEG 2000 traz o espaço de cor no próprio código
+                record("JPXDecode");
+                return true;
+            }
+            if (subtype->is_name("Form")) {
+                bool color = group(object.get("Group"), d);
+                if (const Object* inner = object.get("Resources")) {
+                    color |= resources(*inner, d + 1);
+                }
+                return color;
+            }
+            return false;
+        });
+    }
+
+    bool shading(const Object& value, int depth) {
+        return cached(value, depth, [this](const Object& object, int d) {
+            const Object* space = object.get("ColorSpace");
+            return space && color_space(*space, d + 1);
+        });
+    }
+
+    bool pattern(const Object& value, int depth) {
+        return cached(value, depth, [this](const Object& object, int d) {
+            if (const Object* inner = object.get("Shading")) {
+                return shading(*inner, d + 1);
+            }
+            const Object* inner = object.get("Resources");
+            return inner && resources(*inner, d + 1);
+        });
+    }
+
+    bool color_space(const Object& value, int depth) {
+        return cached(value, depth, [this](const Object& space, int d) {
+            if (space.is(Object::Type::Name)) {
+                return device_space(space.name);
+            }
+            if (!space.is(Object::Type::Array) || space.items.empty()) {
+                return false;
+            }
+            const std::string family = reader_.resolve(space.items[0]).name;
+            if (family == "ICCBased" && space.items.size() > 1) {
+                record(family);
+                const Object profile = reader_.resolve(space.items[1]);
+                return reader_.number(profile.get("N"), 3) >= 3;
+            }
+            if ((family == "Indexed" || family == "I") && space.items.size() > 1) {
+                record("Indexed");
+                return color_space(space.items[1], d + 1);
+            }
+            if (family == "Pattern") {
+                record(family);
+                return space.items.size() > 1 && color_space(space.items[1], d + 1);
+            }
+            if (family == "Separation" && space.items.size() > 1) {
+                record(family);
+                return !neutral_colorant(reader_.resolve(space.items[1]).name);
+            }
+            if (family == "DeviceN" && space.items.size() > 1) {
+                record(family);
+                const Object names = reader_.resolve(space.items[1]);
+                for (const auto& name : names.items) {
+                    if (!neutral_colorant(reader_.resolve(name).name)) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            if (family == "CalGray") {
+                record(family);
+                return false;
+            }
+            if (family == "CalRGB" || family == "Lab") {
+                record(family);
+                return true;
+            }
+            return device_space(family);
+        });
+    }
+
+    bool device_space(const std::string& name) {
+        if (name == "DeviceGray" || name == "G") {
+            record("DeviceGray");
+            return false;
+        }
+        if (name == "DeviceRGB" || name == "RGB") {
+            record("DeviceRGB");
+            return true;
+        }
+        if (name == "DeviceCMYK" || name == "CMYK") {
+            record("DeviceCMYK");
+            return true;
+        }
+        return false;
+    }
+
+    // Corantes que não trazem cor: preto, registro (All) e nenhum
+    static bool neutral_colorant(const std::string& name) {
+        return name == "Black" || name == "All" || name == "None";
+    }
+
+    void record(const std::string& family) {
+        if (std::find(families_.begin(), families_.end(), family) == families_.end()) {
+            families_.push_back(family);
+        }
+    }
+
+    Reader& reader_;
+    std::vector<std::string>& families_;
+    std::unordered_map<int, bool> cache_;
+};
+
+// Atributos herdados pela árvore de páginas
+struct Inherited {
+    Object media_box;
+    Object resources;
+    Object rotate;
+};
+
+void read_media_box(Reader& reader, const Object& value, PdfPageInfo& page) {
+    const Object box = reader.resolve(value);
+    if (box.is(Object::Type::Array) && box.items.size() >= 4) {
+        double v[4];
+        for (int i = 0; i < 4; ++i) {
+            v[i] = reader.number(&box.items[i], 0.0);
+        }
+        page.width_pt = std::fabs(v[2] - v[0]);
+        page.height_pt = std::fabs(v[3] - v[1]);
+    }
+    if (page.width_pt <= 0.0 || page.height_pt <= 0.0) {
+        page.width_pt = LETTER_WIDTH_PT;
+        page.height_pt = LETTER_HEIGHT_PT;
+    }
+}
+
+void walk_pages(Reader& reader, const Object& root, PdfStructure& structure) {
+    ColorScanner colors(reader, structure.color_spaces);
+    struct Pending {
+        Object node;
+        std::shared_ptr<const Inherited> inherited;
+        int depth;
+    };
+    std::vector<Pending> stack;
+    stack.push_back({root, std::make_shared<Inherited>(), 0});
+    std::unordered_set<int> visited;
+
+    while (!stack.empty()) {
+        Pending pending = std::move(stack.back());
+        stack.pop_back();
+        if (pending.node.is(Object::Type::Reference) && !visited.insert(pending.node.num).second) {
+            continue;   // Árvore com ciclo ou página repetida
+        }
+        if (pending.depth > MAX_DEPTH) {
+            continue;
+        }
+        Object node;
+        try {
+            node = reader.resolve(pending.node);
+        } catch (const std::exception&) {
+            continue;   // Nó ilegível: as demais páginas ainda contam
+        }
+        if (!node.is(Object::Type::Dictionary)) {
+            continue;
+        }
+
+        auto inherited = pending.inherited;
+        const Object* media_box = node.get("MediaBox");
+        const Object* resources = node.get("Resources");
+        const Object* rotate = node.get("Rotate");
+        if (media_box || resources || rotate) {
+            auto own = std::make_shared<Inherited>(*inherited);
+            if (media_box) own->media_box = *media_box;
+            if (resources) own->resources = *resources;
+            if (rotate) own->rotate = *rotate;
+            inherited = own;
+        }
+
+        const Object* kids = node.get("Kids");
+        const Object* type = node.get("Type");
+        if (kids && !(type && type->is_name("Page"))) {
+            const Object list = reader.resolve(*kids);
+            for (auto it = list.items.rbegin(); it != list.items.rend(); ++it) {
+                stack.push_back({*it, inherited, pending.depth + 1});
+            }
+            continue;
+        }
+
+        PdfPageInfo page;
+        read_media_box(reader, inherited->media_box, page);
+        const double user_unit = reader.number(node.get("UserUnit"), 1.0);
+        if (user_unit > 0.0) {
+            page.width_pt *= user_unit;
+            page.height_pt *= user_unit;
+        }
+        const int rotation = static_cast<int>(std::lround(reader.number(&inherited->rotate, 0.0) / 90.0)) * 90;
+        page.rotate = ((rotation % 360) + 360) % 360;
+        try {
+            page.color = colors.group(node.get("Group"), 0);
+            if (!inherited->resources.is(Object::Type::Null)) {
+                page.color |= colors.resources(inherited->resources, 0);
+            }
+        } catch (const std::exception&) {
+            page.color = true;   // Recursos ilegíveis: supõe cor
+        }
+        structure.uses_color |= page.color;
+        structure.pages.push_back(page);
+    }
+    structure.page_count = static_cast<int>(structure.pages.size());
+}
+
+}  // namespace
+
+bool read_pdf_structure(const std::string& path, PdfStructure& structure, std::string* error) {
+    structure = PdfStructure{};
+    try {
+        Reader reader(path);
+        reader.open(structure);
+        const Object catalog = reader.resolve(*reader.trailer().get("Root"));
+        const Object* pages = catalog.get("Pages");
+        if (!pages) {
+            fail("PDF catalog has no page tree");
+        }
+        walk_pages(reader, *pages, structure);
+        if (structure.page_count == 0) {
+            fail("PDF page tree has no readable pages");
+        }
+        structure.repaired = reader.repaired();
+        return true;
+    } catch (const std::exception& e) {
+        if (error) {
+            *error = e.what();
+        }
+        return false;
+    }
+}
 
 } // namespace AllPress
@@ -1,11 +1,64 @@
 #include "core/color_manager.h"
+#include "conversion/converter_pool.h"
 #include "utils/logger.h"
 #include "utils/file_utils.h"
+#include "raster/color_convert.h"
+#include "raster/image_io.h"
+#include "raster/icc_transform.h"
 #include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
 
 namespace AllPress {
 namespace Color {
 
+namespace raster = all_press::raster;
+
+namespace {
+
+raster::RenderingIntent to_icc_intent(RenderingIntent intent) {
+    switch (intent) {
+        case RenderingIntent::RelativeColorimetric: return raster::RenderingIntent::RELATIVE_COLORIMETRIC;
+        case RenderingIntent::Saturation: return raster::RenderingIntent::SATURATION;
+        case RenderingIntent::AbsoluteColorimetric: return raster::RenderingIntent::ABSOLUTE_COLORIMETRIC;
+        case RenderingIntent::Perceptual: break;
+    }
+    return raster::RenderingIntent::PERCEPTUAL;
+}
+
+std::string device_class_name(const std::string& signature) {
+    if (signature == "scnr") return "input";
+    if (signature == "mntr") return "display";
+    if (signature == "prtr") return "output";
+    if (signature == "spac") return "colorspace";
+    return signature;
+}
+
+raster::PixelFormat format_for_channels(int channels) {
+    switch (channels) {
+        case 1: return raster::PixelFormat::GRAY8;
+        case 4: return raster::PixelFormat::CMYK8;
+        default: return raster::PixelFormat::RGB8;
+    }
+}
+
+// Conversions run on 8-bit samples
+void reduce_to_8bit(raster::Image& image) {
+    if (image.bit_depth != 16) {
+        return;
+    }
+    std::vector<uint8_t> reduced(image.data.size() / 2);
+    const uint16_t* samples = image.samples16();
+    for (size_t i = 0; i < reduced.size(); ++i) {
+        reduced[i] = static_cast<uint8_t>((samples[i] * 255u + 32767u) / 65535u);
+    }
+    image.data.swap(reduced);
+    image.bit_depth = 8;
+}
+
+} // namespace
+
 ColorManager::ColorManager() {
     profiles_dir_ = "/usr/share/color/icc";
 }
@@ -34,15 +87,22 @@ bool ColorManager::load_profile(const std::string& file_path, const std::string&
         return false;
     }
     
-    std::lock_guard<std::mutex> lock(profiles_mutex_);
-    
     ColorProfile profile;
     profile.name = name.empty() ? Utils::FileUtils::get_filename(file_path) : name;
     profile.file_path = file_path;
-    profile.description = "Custom color profile";
-    profile.device_class = "output";
-    profile.color_space = "RGB";
     
+    try {
+        profile.icc = raster::IccProfile::load(file_path);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to parse color profile " + file_path + ": " + e.what());
+        return false;
+    }
+    profile.description = profile.icc->description().empty() ? "Custom color profile"
+                                                              : profile.icc->description();
+    profile.device_class = device_class_name(profile.icc->header().device_class);
+    profile.color_space = raster::icc_color_space_name(profile.icc->color_space());
+    
+    std::lock_guard<std::mutex> lock(profiles_mutex_);
     profiles_[profile.name] = profile;
     
     LOG_INFO("Loaded color profile: " + profile.name);
@@ -85,17 +145,154 @@ bool ColorManager::convert_image_colors(const std::string& input_path,
                                        const std::string& output_path,
                                        const std::string& source_profile,
                                        const std::string& target_profile,
-                                       RenderingIntent intent) {
+                                       RenderingIntent intent,
+                                       const std::string& calibrate_for) {
     LOG_INFO("Converting image colors from " + source_profile + " to " + target_profile);
-    // Implementation would use ImageMagick or LittleCMS
+    
+    // Printer curves are applied to each converted row in the same pass
+    std::shared_ptr<const raster::CalibrationLut> calibration;
+    if (!calibrate_for.empty()) {
+        calibration = get_calibration_lut(calibrate_for);
+    }
+    
+    ColorProfile source;
+    ColorProfile target;
+    {
+        std::lock_guard<std::mutex> lock(profiles_mutex_);
+        auto it = profiles_.find(target_profile);
+        if (it == profiles_.end()) {
+            LOG_ERROR("Unknown target color profile: " + target_profile);
+            return false;
+        }
+        target = it->second;
+        it = profiles_.find(source_profile);
+        if (it != profiles_.end()) {
+            source = it->second;
+        }
+    }
+    
+    try {
+        raster::Image image = raster::read_pnm(input_path);
+        raster::Image output;
+        output.width = image.width;
+        output.height = image.height;
+        
+        source.icc = resolve_icc(source);
+        target.icc = resolve_icc(target);
+        if (source.icc && target.icc) {
+            // ICC path: compiled (source, target, intent) grid, cached across jobs
+            if (raster::bytes_per_pixel(image.format) != source.icc->channels()) {
+                LOG_ERROR("Image " + input_path + " does not match source profile " + source_profile);
+                return false;
+            }
+            reduce_to_8bit(image);
+            auto transform = raster::IccTransformCache::instance().get(
+                *source.icc, *target.icc, to_icc_intent(intent));
+            output.format = format_for_channels(transform->output_channels());
+            output.data.resize(output.row_bytes() * output.height);
+            transform->apply(image.data.data(), output.data.data(), image.width, image.height,
+                             calibration.get());
+            raster::write_pnm(output_path, output);
+            return true;
+        }
+        
+        // Device-space conversion when either side has no ICC data; the
+        // rendering intent does not apply here
+        if (target.color_space == "CMYK") {
+            output.format = raster::PixelFormat::CMYK8;
+        } else if (target.color_space == "GRAY" || target.color_space == "Gray") {
+            output.format = raster::PixelFormat::GRAY8;
+        } else if (target.color_space == "RGB") {
+            output.format = raster::PixelFormat::RGB8;
+        } else {
+            LOG_ERROR("Unsupported target color space: " + target.color_space);
+            return false;
+        }
+        
+        if (image.bit_depth == 16 && image.format == raster::PixelFormat::RGB8 &&
+            output.format == raster::PixelFormat::GRAY8) {
+            // 16-bit gray keeps the full precision
+            output.bit_depth = 16;
+            output.data.resize(output.row_bytes() * output.height);
+            raster::rgb_to_gray16(image.samples16(), image.width * image.height,
+                                  output.samples16());
+            if (calibration) {
+                calibration->apply16(output.samples16(), output.format,
+                                     static_cast<size_t>(image.width) * image.height);
+            }
+        } else {
+            reduce_to_8bit(image);
+            raster::ColorConvertOptions options;
+            options.separation = get_cmyk_separation();
+            options.calibration = calibration;
+            output.data.resize(output.row_bytes() * output.height);
+            raster::ColorConverter(options).convert(image.data.data(), image.format,
+                                                    output.data.data(), output.format,
+                                                    image.width, image.height);
+        }
+        
+        raster::write_pnm(output_path, output);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Color conversion failed for " + input_path + ": " + e.what());
+        return false;
+    }
+    
     return true;
 }
 
+void ColorManager::set_cmyk_separation(const raster::CmykSeparation& separation) {
+    std::lock_guard<std::mutex> lock(profiles_mutex_);
+    separation_ = separation;
+    LOG_INFO("CMYK separation set: GCR " + std::to_string(separation.black_generation) +
+             "%, ink limit " + std::to_string(separation.total_ink_limit) + "%");
+}
+
+raster::CmykSeparation ColorManager::get_cmyk_separation() {
+    std::lock_guard<std::mutex> lock(profiles_mutex_);
+    return separation_;
+}
+
 bool ColorManager::apply_color_profile_to_pdf(const std::string& pdf_path,
                                              const std::string& output_path,
                                              const std::string& target_profile) {
     LOG_INFO("Applying color profile to PDF: " + target_profile);
-    // Implementation would use Poppler or Ghostscript
+    
+    ColorProfile target = get_profile(target_profile);
+    if (target.name.empty()) {
+        LOG_ERROR("Unknown target color profile: " + target_profile);
+        return false;
+    }
+    
+    std::string strategy;
+    if (target.color_space == "CMYK") {
+        strategy = "CMYK";
+    } else if (target.color_space == "GRAY" || target.color_space == "Gray") {
+        strategy = "Gray";
+    } else if (target.color_space == "RGB") {
+        strategy = "RGB";
+    } else {
+        LOG_ERROR("Unsupported target color space: " + target.color_space);
+        return false;
+    }
+    
+    // Ghostscript converts every object; the output profile is embedded as
+    // the document's output intent when the target has an ICC file
+    std::vector<std::string> gs_args = {"gs", "-q", "-dSAFER", "-dBATCH", "-dNOPAUSE", "-sDEVICE=pdfwrite",
+                                        "-sColorConversionStrategy=" + strategy,
+                                        "-sProcessColorModel=Device" + strategy};
+    if (!target.file_path.empty()) {
+        gs_args.push_back("-sOutputICCProfile=" + target.file_path);
+    }
+    gs_args.push_back("-sOutputFile=" + output_path);
+    gs_args.push_back(pdf_path);
+    
+    ConverterLease lease = ConverterPool::instance().checkout(ConverterTool::Ghostscript);
+    const bool converted = lease.run(gs_args).ok();
+    lease.release();
+    if (!converted || !std::filesystem::exists(output_path)) {
+        LOG_ERROR("Ghostscript color conversion failed for " + pdf_path);
+        return false;
+    }
     return true;
 }
 
@@ -109,9 +306,62 @@ bool ColorManager::calibrate_printer(const std::string& printer_name,
     calibration.gamma = 1.0;
     calibration.is_valid = true;
     
+    return set_printer_calibration(calibration);
+}
+
+bool ColorManager::set_printer_calibration(const CalibrationData& calibration) {
+    raster::ToneCurves curves;
+    for (auto& curve : curves) {
+        curve.gamma = calibration.gamma;
+    }
+    for (const auto& correction : calibration.color_corrections) {
+        std::string channel = correction.first;
+        double* field = nullptr;
+        size_t split = channel.rfind('_');
+        std::string suffix = split == std::string::npos ? "" : channel.substr(split + 1);
+        if (suffix == "gamma" || suffix == "offset") {
+            channel = channel.substr(0, split);
+        }
+        try {
+            raster::ToneCurve& curve = curves[static_cast<int>(raster::parse_tone_channel(channel))];
+            field = suffix == "gamma" ? &curve.gamma : suffix == "offset" ? &curve.offset : &curve.gain;
+        } catch (const std::invalid_argument&) {
+            LOG_WARNING("Ignoring unknown color correction: " + correction.first);
+            continue;
+        }
+        *field = correction.second;
+    }
+    
+    CalibrationData stored = calibration;
+    uint64_t version = 1;
+    {
+        std::lock_guard<std::mutex> lock(profiles_mutex_);
+        auto it = calibrations_.find(calibration.printer_name);
+        if (it != calibrations_.end()) {
+            version = it->second.version + 1;
+        }
+    }
+    
+    // Tables are compiled outside the lock; running jobs keep their snapshot
+    std::shared_ptr<const raster::CalibrationLut> lut;
+    try {
+        lut = raster::CalibrationLut::build(curves, version);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Invalid calibration for " + calibration.printer_name + ": " + e.what());
+        return false;
+    }
+    stored.version = version;
+    
     std::lock_guard<std::mutex> lock(profiles_mutex_);
-    calibrations_[printer_name] = calibration;
+    auto it = calibrations_.find(calibration.printer_name);
+    if (it != calibrations_.end() && it->second.version >= version) {
+        LOG_WARNING("Concurrent recalibration of " + calibration.printer_name + " superseded");
+        return false;
+    }
+    calibrations_[calibration.printer_name] = stored;
+    calibration_luts_[calibration.printer_name] = lut;
     
+    LOG_INFO("Calibration v" + std::to_string(version) + " active for " + calibration.printer_name);
     return true;
 }
 
@@ -125,9 +375,44 @@ CalibrationData ColorManager::get_printer_calibration(const std::string& printer
     return CalibrationData();
 }
 
+std::shared_ptr<const raster::CalibrationLut> ColorManager::get_calibration_lut(
+    const std::string& printer_name) {
+    std::lock_guard<std::mutex> lock(profiles_mutex_);
+    
+    auto it = calibration_luts_.find(printer_name);
+    if (it != calibration_luts_.end()) {
+        return it->second;
+    }
+    return nullptr;
+}
+
 bool ColorManager::apply_calibration(const std::string& printer_name,
                                     const std::string& document_path) {
     LOG_INFO("Applying calibration for printer: " + printer_name);
+    
+    auto lut = get_calibration_lut(printer_name);
+    if (!lut) {
+        LOG_WARNING("No calibration for printer: " + printer_name);
+        return false;
+    }
+    
+    // Raster documents only; vector input is calibrated when it is rasterized
+    try {
+        raster::Image image = raster::read_pnm(document_path);
+        if (lut->is_identity(image.format)) {
+            return true;
+        }
+        const size_t pixels = static_cast<size_t>(image.width) * image.height;
+        if (image.bit_depth == 16) {
+            lut->apply16(image.samples16(), image.format, pixels);
+        } else {
+            lut->apply(image.data.data(), image.format, pixels);
+        }
+        raster::write_pnm(document_path, image);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Calibration failed for " + document_path + ": " + e.what());
+        return false;
+    }
     return true;
 }
 
@@ -163,35 +448,119 @@ bool ColorManager::install_standard_profiles() {
     srgb.device_class = "output";
     srgb.color_space = "RGB";
     srgb.is_default = true;
+    srgb.icc = raster::IccProfile::srgb();
+    
+    // Uncalibrated device spaces, used as conversion targets
+    ColorProfile gray;
+    gray.name = "DeviceGray";
+    gray.description = "Device gray";
+    gray.device_class = "output";
+    gray.color_space = "GRAY";
+    
+    ColorProfile cmyk;
+    cmyk.name = "DeviceCMYK";
+    cmyk.description = "Device CMYK with GCR and ink limit";
+    cmyk.device_class = "output";
+    cmyk.color_space = "CMYK";
     
     std::lock_guard<std::mutex> lock(profiles_mutex_);
     profiles_["sRGB"] = srgb;
+    profiles_[gray.name] = gray;
+    profiles_[cmyk.name] = cmyk;
     
     return true;
 }
 
 bool ColorManager::load_system_profiles() {
-    // Load profiles from system directory
-    if (!Utils::FileUtils::directory_exists(profiles_dir_)) {
+    std::vector<std::string> directories;
+    std::vector<std::string> candidates = {profiles_dir_, "/usr/local/share/color/icc"};
+    if (const char* home = getenv("HOME")) {
+        candidates.push_back(std::string(home) + "/.local/share/icc");
+        candidates.push_back(std::string(home) + "/.color/icc");
+    }
+    for (const auto& dir : candidates) {
+        if (Utils::FileUtils::directory_exists(dir)) {
+            directories.push_back(dir);
+        }
+    }
+    if (directories.empty()) {
         return false;
     }
     
-    // Implementation would scan directory for .icc and .icm files
+    // Only headers are read here; the index skips files unchanged since the last run
+    raster::IccCatalogOptions options;
+    options.index_path = Utils::FileUtils::get_temp_directory() + "/all_press/icc_index.tsv";
+    auto catalog = std::make_shared<raster::IccCatalog>(options);
+    
+    auto start = std::chrono::steady_clock::now();
+    raster::IccCatalogScanStats stats = catalog->scan(directories);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    
+    std::lock_guard<std::mutex> lock(profiles_mutex_);
+    for (const auto& entry : catalog->entries()) {
+        if (profiles_.count(entry.name)) {
+            continue;
+        }
+        ColorProfile profile;
+        profile.name = entry.name;
+        profile.file_path = entry.path;
+        profile.description = entry.info.description;
+        profile.device_class = device_class_name(entry.info.header.device_class);
+        profile.color_space = raster::icc_color_space_name(entry.info.header.color_space);
+        profiles_[profile.name] = profile;
+    }
+    catalog_ = std::move(catalog);
+    
+    LOG_INFO("Loaded " + std::to_string(stats.files - stats.invalid) + " system color profiles (" +
+             std::to_string(stats.reused) + " from index, " + std::to_string(stats.invalid) +
+             " invalid) in " + std::to_string(elapsed.count()) + " ms");
     return true;
 }
 
+std::shared_ptr<const raster::IccProfile> ColorManager::resolve_icc(const ColorProfile& profile) {
+    if (profile.icc || profile.file_path.empty()) {
+        return profile.icc;
+    }
+    
+    std::shared_ptr<raster::IccCatalog> catalog;
+    {
+        std::lock_guard<std::mutex> lock(profiles_mutex_);
+        catalog = catalog_;
+    }
+    if (!catalog) {
+        return nullptr;
+    }
+    try {
+        return catalog->profile(profile.file_path);
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to parse color profile " + profile.file_path + ": " + e.what());
+        return nullptr;
+    }
+}
+
 std::string ColorManager::get_profiles_directory() {
     return profiles_dir_;
 }
 
 bool ColorManager::validate_profile(const std::string& file_path) {
-    // Basic validation - check file exists and has ICC extension
     if (!Utils::FileUtils::file_exists(file_path)) {
         return false;
     }
     
     std::string ext = Utils::FileUtils::get_file_extension(file_path);
-    return (ext == ".icc" || ext == ".icm");
+    if (ext != ".icc" && ext != ".icm") {
+        return false;
+    }
+    
+    // Header and tag table only; color tables are parsed when the profile is used
+    try {
+        raster::IccCatalog::inspect_file(file_path);
+    } catch (const std::exception& e) {
+        LOG_WARNING("Rejected color profile " + file_path + ": " + e.what());
+        return false;
+    }
+    return true;
 }
 
 } // namespace Color
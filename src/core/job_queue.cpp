@@ -1,12 +1,15 @@
 #include "core/job_queue.h"
 #include "utils/logger.h"
 #include "utils/file_utils.h"
+#include "utils/config.h"
 #include <algorithm>
 
 namespace AllPress {
 
 JobQueue::JobQueue(size_t max_concurrent_jobs) 
-    : max_concurrent_jobs_(max_concurrent_jobs), printer_manager_(nullptr) {
+    : max_concurrent_jobs_(max_concurrent_jobs), printer_manager_(nullptr),
+      protocol_pool_(std::make_shared<all_press::protocols::ProtocolHandlerPool>(
+          max_concurrent_jobs)) {
     LOG_INFO("JobQueue initialized with " + std::to_string(max_concurrent_jobs) + " workers");
 }
 
@@ -15,9 +18,11 @@ JobQueue::~JobQueue() {
 }
 
 int JobQueue::add_job(const PrintJob& job) {
+    PrintJob new_job = job;
+    predict_plot_time(new_job);
+    
     std::lock_guard<std::mutex> lock(queue_mutex_);
     
-    PrintJob new_job = job;
     new_job.job_id = next_job_id_++;
     new_job.created_at = std::chrono::system_clock::now();
     new_job.status = JobStatus::Pending;
@@ -178,9 +183,23 @@ size_t JobQueue::get_active_job_count() const {
 }
 
 double JobQueue::get_estimated_queue_time(const std::string& printer) {
-    // Simple estimation: 30 seconds per job
-    auto jobs = get_jobs_for_printer(printer);
-    return jobs.size() * 30.0;
+    // Previsão calibrada do que falta de cada job não concluído; 30 s para
+    // jobs sem previsão (documentos que só o dispositivo interpreta)
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    
+    double total = 0.0;
+    for (const auto& pair : jobs_map_) {
+        const PrintJob& job = *pair.second;
+        if (job.printer_name != printer ||
+            (job.status != JobStatus::Pending &&
+             job.status != JobStatus::Processing &&
+             job.status != JobStatus::Printing)) {
+            continue;
+        }
+        const double seconds = job.predicted_plot_s > 0.0 ? job.predicted_plot_s : 30.0;
+        total += seconds * (1.0 - std::min(1.0f, std::max(0.0f, job.progress)));
+    }
+    return total;
 }
 
 void JobQueue::set_job_status_callback(std::function<void(const PrintJob&)> callback) {
@@ -194,6 +213,16 @@ void JobQueue::set_progress_callback(std::function<void(int, float)> callback) {
 void JobQueue::start() {
     running_ = true;
     
+    const std::string calibration_file =
+        Utils::Config::instance().get_string("plotter.calibration_file", "");
+    if (!calibration_file.empty() && Utils::FileUtils::file_exists(calibration_file)) {
+        try {
+            plot_calibration_.load(calibration_file);
+        } catch (const std::exception& e) {
+            LOG_WARNING(std::string("Ignoring plot time calibration: ") + e.what());
+        }
+    }
+    
     for (size_t i = 0; i < max_concurrent_jobs_; ++i) {
         worker_threads_.emplace_back(&JobQueue::worker_thread, this);
     }
@@ -218,10 +247,13 @@ void JobQueue::stop() {
 void JobQueue::worker_thread() {
     while (running_) {
         std::shared_ptr<PrintJob> job;
+        const std::chrono::duration<double> poll_interval(
+            Utils::Config::instance().get_double("plotter.calibration_poll_s", 30.0));
         
         {
             std::unique_lock<std::mutex> lock(queue_mutex_);
-            queue_cv_.wait(lock, [this] { 
+            // Acorda também para buscar o tempo real dos plots já enviados
+            queue_cv_.wait_for(lock, poll_interval, [this] { 
                 return !running_ || !job_queue_.empty(); 
             });
             
@@ -233,8 +265,15 @@ void JobQueue::worker_thread() {
             }
         }
         
+        poll_plot_times();
+        
         if (job) {
-            process_job(*job);
+            auto group = collect_nest_group(job);
+            if (group.size() > 1) {
+                process_nested_jobs(group);
+            } else {
+                process_job(*job);
+            }
         }
     }
 }
@@ -244,6 +283,20 @@ void JobQueue::process_job(PrintJob& job) {
         return;
     }
     
+    // Plotters recebem a saída já no protocolo do dispositivo
+    if (printer_manager_ && printer_manager_->is_plotter(job.printer_name)) {
+        active_jobs_++;
+        job.started_at = std::chrono::system_clock::now();
+        try {
+            process_job_with_protocol(make_processing_context(job));
+        } catch (const std::exception& e) {
+            LOG_ERROR("Failed to prepare job " + std::to_string(job.job_id) + ": " + e.what());
+            update_job_status(job.job_id, JobStatus::Failed, e.what());
+        }
+        active_jobs_--;
+        return;
+    }
+    
     active_jobs_++;
     job.status = JobStatus::Processing;
     job.started_at = std::chrono::system_clock::now();
@@ -324,6 +377,9 @@ void JobQueue::update_job_status(int job_id, JobStatus status, const std::string
     auto it = jobs_map_.find(job_id);
     if (it != jobs_map_.end()) {
         it->second->status = status;
+        if (status == JobStatus::Completed) {
+            it->second->completed_at = std::chrono::system_clock::now();
+        }
         if (!error.empty()) {
             it->second->error_message = error;
         }
@@ -1,15 +1,393 @@
 #include "core/job_queue.h"
+#include "conversion/conversion_cache.h"
 #include "protocols/protocol_factory.h"
 #include "protocols/compatibility_matrix.h"
+#include "protocols/dxf_reader.h"
+#include "protocols/hpgl_interpreter.h"
+#include "protocols/svg_reader.h"
 #include "utils/logger.h"
 #include "utils/file_utils.h"
+#include "utils/config.h"
+#include "raster/image_io.h"
+#include "raster/resample.h"
+#include "raster/trim.h"
+#include "raster/nesting.h"
+#include "raster/ink_coverage.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
+#include <optional>
 #include <sstream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace AllPress {
 
 using namespace all_press::protocols;
 
+namespace {
+
+namespace raster = all_press::raster;
+
+// Dimensões da mídia em mm (retrato); CUSTOM usa o máximo do plotter
+void media_size_mm(MediaSize size, const PlotterCapabilities& caps, double& width, double& height) {
+    switch (size) {
+        case MediaSize::A0: width = 841; height = 1189; break;
+        case MediaSize::A1: width = 594; height = 841; break;
+        case MediaSize::A2: width = 420; height = 594; break;
+        case MediaSize::A3: width = 297; height = 420; break;
+        case MediaSize::A5: width = 148; height = 210; break;
+        case MediaSize::B0: width = 1000; height = 1414; break;
+        case MediaSize::B1: width = 707; height = 1000; break;
+        case MediaSize::B2: width = 500; height = 707; break;
+        case MediaSize::B3: width = 353; height = 500; break;
+        case MediaSize::B4: width = 250; height = 353; break;
+        case MediaSize::B5: width = 176; height = 250; break;
+        case MediaSize::LETTER: width = 215.9; height = 279.4; break;
+        case MediaSize::LEGAL: width = 215.9; height = 355.6; break;
+        case MediaSize::TABLOID: width = 279.4; height = 431.8; break;
+        case MediaSize::CUSTOM:
+            width = caps.max_paper_width_mm;
+            height = caps.max_paper_height_mm;
+            break;
+        case MediaSize::A4:
+        default: width = 210; height = 297; break;
+    }
+}
+
+// Resolução efetiva: a maior suportada pelo dispositivo que não passa da
+// pedida (ou a menor de todas, se nenhuma couber)
+int effective_dpi(int requested, const PlotterCapabilities& caps) {
+    if (caps.supported_resolutions.empty()) {
+        return requested;
+    }
+    int best = 0;
+    for (int dpi : caps.supported_resolutions) {
+        if (dpi <= requested) best = std::max(best, dpi);
+    }
+    if (best == 0) {
+        best = *std::min_element(caps.supported_resolutions.begin(), caps.supported_resolutions.end());
+    }
+    return best;
+}
+
+bool is_netpbm(const std::vector<uint8_t>& data) {
+    return data.size() > 2 && data[0] == 'P' && (data[1] == '5' || data[1] == '6' || data[1] == '7') &&
+           (data[2] == '\n' || data[2] == ' ' || data[2] == '\r' || data[2] == '\t');
+}
+
+// Programa HPGL/HPGL2, puro ou dentro de PCL/RTL (ESC E, ESC%)
+bool is_hpgl(const std::vector<uint8_t>& data) {
+    size_t i = 0;
+    while (i < data.size() && std::isspace(data[i])) ++i;
+    if (i + 1 >= data.size()) {
+        return false;
+    }
+    if (data[i] == 0x1B) {
+        return data[i + 1] == 'E' || data[i + 1] == '%';
+    }
+    return (data[i] == 'I' && data[i + 1] == 'N') || (data[i] == 'B' && data[i + 1] == 'P');
+}
+
+std::vector<uint8_t> read_head(const std::string& path, size_t bytes) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> head(bytes, 0);
+    file.read(reinterpret_cast<char*>(head.data()), head.size());
+    head.resize(static_cast<size_t>(std::max<std::streamsize>(0, file.gcount())));
+    return head;
+}
+
+bool speaks_hpgl(const std::string& protocol) {
+    return protocol == "HPGL" || protocol == "HPGL2";
+}
+
+std::string lower_extension(const std::string& path) {
+    std::string ext = Utils::FileUtils::get_file_extension(path);
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext;
+}
+
+bool is_dxf_file(const std::string& path) {
+    return lower_extension(path) == ".dxf";
+}
+
+bool is_svg_file(const std::string& path) {
+    return lower_extension(path) == ".svg";
+}
+
+// Display list de um DXF pelo mesmo caminho dos plotters HPGL, para PDF e
+// dispositivos raster
+HpglDisplayList dxf_display_list(const DxfDrawing& drawing) {
+    const std::vector<uint8_t> program = dxf_to_hpgl(drawing);
+    return parse_hpgl(program.data(), program.size());
+}
+
+void log_dxf_validation(int job_id, const DxfDrawing& drawing) {
+    if (drawing.unsupported > 0) {
+        LOG_WARNING("Job " + std::to_string(job_id) + " DXF has " +
+                    std::to_string(drawing.unsupported) + " entities that are not drawn");
+    }
+    if (drawing.empty()) {
+        throw std::runtime_error("DXF job draws nothing");
+    }
+}
+
+void log_svg_validation(int job_id, const HpglDisplayList& drawing) {
+    if (drawing.unsupported > 0 || drawing.unknown > 0) {
+        LOG_WARNING("Job " + std::to_string(job_id) + " SVG has " +
+                    std::to_string(drawing.unsupported) + " approximated or skipped and " +
+                    std::to_string(drawing.unknown) + " unknown elements");
+    }
+    if (drawing.empty()) {
+        throw std::runtime_error("SVG job draws nothing");
+    }
+}
+
+// Só a assinatura, sem ler o arquivo inteiro
+bool is_netpbm_file(const std::string& path) {
+    return is_netpbm(read_head(path, 3));
+}
+
+MediaSize parse_media_size(const std::string& name) {
+    if (name == "A0") return MediaSize::A0;
+    if (name == "A1") return MediaSize::A1;
+    if (name == "A2") return MediaSize::A2;
+    if (name == "A3") return MediaSize::A3;
+    return MediaSize::A4;
+}
+
+// DPI pedido pela qualidade (1-5)
+int quality_dpi(int quality) {
+    if (quality == 5) return 1200;
+    if (quality >= 3) return 600;
+    return 300;
+}
+
+// Imagem maior que o dispositivo consegue mostrar: reduzida à resolução
+// efetiva antes de codificar, o que também reduz a transmissão. Mídia girada
+// quando a imagem é paisagem.
+bool plan_media_fit(int image_w, int image_h, int width, int height, int job_id, int dpi,
+                    int& target_w, int& target_h) {
+    raster::DownsampleLimits limits;
+    limits.max_width = (image_w > image_h) == (width > height) ? width : height;
+    limits.max_height = (image_w > image_h) == (width > height) ? height : width;
+    if (!raster::plan_downsample(image_w, image_h, limits, target_w, target_h)) {
+        return false;
+    }
+    std::ostringstream oss;
+    oss << "Job " << job_id << " downsampling " << image_w << "x" << image_h
+        << " to " << target_w << "x" << target_h << " for " << dpi << " dpi";
+    LOG_INFO(oss.str());
+    return true;
+}
+
+// Página atual do leitor direto no armazenamento em tiles, já ajustada à
+// mídia: as linhas passam pela reamostragem em faixas, sem montar a página
+// inteira num buffer contíguo
+raster::TiledRaster read_page_for_media(raster::PnmPageReader& reader, int width, int height,
+                                        int job_id, int dpi) {
+    const raster::PnmHeader& header = reader.header();
+    int target_w = header.width;
+    int target_h = header.height;
+    plan_media_fit(header.width, header.height, width, height, job_id, dpi, target_w, target_h);
+
+    raster::TiledRaster page(target_w, target_h, header.format);
+    raster::TiledRasterWriter writer(page);
+    raster::Resampler(header.width, header.height, target_w, target_h, header.format)
+        .process_rows([&](uint8_t* dst, int rows) { reader.read_rows(dst, rows); },
+                      [&](const uint8_t* row) { writer.append_row(row); });
+    writer.finish();
+    return page;
+}
+
+// Saída codificada guardada para retry: o arquivo convertido fica em disco
+// até o job terminar, com este manifesto ao lado (<convertido>.bands)
+struct PlotCheckpoint {
+    std::string protocol;
+    int dpi = 0;
+    uint64_t source_size = 0;
+    int64_t source_mtime = 0;
+    uint64_t output_size = 0;
+    uint64_t acknowledged = 0;          // Bytes confirmados pelo dispositivo
+    std::vector<BandCheckpoint> bands;  // Offsets absolutos no arquivo convertido
+    
+    // Última faixa que começa no trecho já confirmado
+    const BandCheckpoint* resume_point() const {
+        const BandCheckpoint* best = nullptr;
+        for (const auto& band : bands) {
+            if (band.offset <= acknowledged) best = &band;
+        }
+        return best;
+    }
+};
+
+bool source_identity(const std::string& path, uint64_t& size, int64_t& mtime) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    mtime = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    return true;
+}
+
+// Escrito em arquivo temporário e renomeado: uma queda no meio da escrita
+// deixa o manifesto anterior, nunca um truncado
+bool save_plot_checkpoint(const std::string& converted_path, const PlotCheckpoint& checkpoint) {
+    const std::string path = converted_path + ".bands";
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        out << "all_press-bands 1\n"
+            << "protocol " << checkpoint.protocol << "\n"
+            << "dpi " << checkpoint.dpi << "\n"
+            << "source " << checkpoint.source_size << " " << checkpoint.source_mtime << "\n"
+            << "output " << checkpoint.output_size << "\n"
+            << "acknowledged " << checkpoint.acknowledged << "\n";
+        for (const auto& band : checkpoint.bands) {
+            out << "band " << band.row << " " << band.page_width << " "
+                << band.page_height << " " << band.offset << "\n";
+        }
+        if (!out.good()) {
+            return false;
+        }
+    }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// false se não houver manifesto, se ele estiver inválido ou se o documento
+// de origem ou a saída convertida tiverem mudado desde a conversão
+bool load_plot_checkpoint(const std::string& converted_path, const std::string& source_path,
+                          PlotCheckpoint& checkpoint) {
+    std::ifstream in(converted_path + ".bands");
+    if (!in.is_open()) {
+        return false;
+    }
+    
+    std::string line;
+    if (!std::getline(in, line) || line != "all_press-bands 1") {
+        return false;
+    }
+    PlotCheckpoint loaded;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        fields >> key;
+        if (key == "protocol") {
+            fields >> loaded.protocol;
+        } else if (key == "dpi") {
+            fields >> loaded.dpi;
+        } else if (key == "source") {
+            fields >> loaded.source_size >> loaded.source_mtime;
+        } else if (key == "output") {
+            fields >> loaded.output_size;
+        } else if (key == "acknowledged") {
+            fields >> loaded.acknowledged;
+        } else if (key == "band") {
+            BandCheckpoint band;
+            fields >> band.row >> band.page_width >> band.page_height >> band.offset;
+            loaded.bands.push_back(band);
+        } else {
+            continue;
+        }
+        if (fields.fail()) {
+            return false;
+        }
+    }
+    
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    if (!source_identity(source_path, size, mtime) ||
+        size != loaded.source_size || mtime != loaded.source_mtime ||
+        !Utils::FileUtils::file_exists(converted_path) ||
+        Utils::FileUtils::get_file_size(converted_path) != loaded.output_size ||
+        loaded.acknowledged > loaded.output_size) {
+        return false;
+    }
+    for (const auto& band : loaded.bands) {
+        if (band.offset > loaded.output_size) {
+            return false;
+        }
+    }
+    checkpoint = std::move(loaded);
+    return true;
+}
+
+// Resumo da codificação guardado com a saída no cache de conversão: o que
+// uma reimpressão precisa para pular a codificação
+struct EncodedSummary {
+    double model_s_per_copy = 0.0;
+    bool trimmed = false;
+    int blank_pages = 0;
+    double media_saved_mm = 0.0;
+    double plot_time_saved_s = 0.0;
+    std::vector<BandCheckpoint> bands;
+    
+    std::string serialize() const {
+        std::ostringstream out;
+        out.precision(17);
+        out << "all_press-encoded 1\n"
+            << "model_s " << model_s_per_copy << "\n";
+        if (trimmed) {
+            out << "trim " << blank_pages << " " << media_saved_mm << " " << plot_time_saved_s << "\n";
+        }
+        for (const auto& band : bands) {
+            out << "band " << band.row << " " << band.page_width << " "
+                << band.page_height << " " << band.offset << "\n";
+        }
+        return out.str();
+    }
+    
+    // false se o texto não for um resumo válido para uma saída de output_size bytes
+    bool parse(const std::string& text, uint64_t output_size) {
+        std::istringstream in(text);
+        std::string line;
+        if (!std::getline(in, line) || line != "all_press-encoded 1") {
+            return false;
+        }
+        EncodedSummary loaded;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string key;
+            fields >> key;
+            if (key == "model_s") {
+                fields >> loaded.model_s_per_copy;
+            } else if (key == "trim") {
+                loaded.trimmed = true;
+                fields >> loaded.blank_pages >> loaded.media_saved_mm >> loaded.plot_time_saved_s;
+            } else if (key == "band") {
+                BandCheckpoint band;
+                fields >> band.row >> band.page_width >> band.page_height >> band.offset;
+                if (band.offset > output_size) {
+                    return false;
+                }
+                loaded.bands.push_back(band);
+            } else {
+                continue;
+            }
+            if (fields.fail()) {
+                return false;
+            }
+        }
+        *this = std::move(loaded);
+        return true;
+    }
+};
+
+void remove_plot_checkpoint(const std::string& converted_path) {
+    std::remove(converted_path.c_str());
+    std::remove((converted_path + ".bands").c_str());
+}
+
+}  // namespace
+
 // Validar compatibilidade do job com o plotter
 bool JobQueue::validate_job_compatibility(const PrintJob& job) {
     if (!printer_manager_) {
@@ -42,6 +420,50 @@ bool JobQueue::validate_job_compatibility(const PrintJob& job) {
     return valid;
 }
 
+void JobQueue::set_printer_manager(PrinterManager* manager) {
+    printer_manager_ = manager;
+    
+    // Compartilhar o pool: handlers aquecidos na validação servem aos workers
+    if (manager) {
+        protocol_pool_ = manager->protocol_pool();
+    }
+}
+
+// Emprestar do pool o handler do plotter de destino
+JobQueue::ProcessingContext JobQueue::make_processing_context(const PrintJob& job) {
+    if (!printer_manager_) {
+        throw std::runtime_error("PrinterManager not set");
+    }
+    
+    auto plotter_info = printer_manager_->get_plotter_info(job.printer_name);
+    
+    ProcessingContext context;
+    context.job_id = job.job_id;
+    context.job = job;
+    context.target_protocol = printer_manager_->select_best_protocol(
+        job.printer_name, job.options);
+    context.protocol_handler = protocol_pool_->checkout(
+        plotter_info.vendor,
+        plotter_info.base_info.make_model,
+        context.target_protocol);
+    context.target_capabilities = context.protocol_handler->get_capabilities();
+    
+    // Modelos desconhecidos são tratados como folha: nada é cortado
+    auto compatibility = CompatibilityMatrix::find(
+        plotter_info.vendor, plotter_info.base_info.make_model);
+    context.roll_media = compatibility && compatibility->roll_media;
+    context.model_key = compatibility ? compatibility->model : plotter_info.base_info.make_model;
+    if (compatibility) {
+        context.speeds = compatibility->speeds;
+    }
+    for (const auto& [name, value] : CompatibilityMatrix::get_quirks(
+             plotter_info.vendor, plotter_info.base_info.make_model)) {
+        context.quirks += name + "=" + value + ";";
+    }
+    
+    return context;
+}
+
 // Processar job com conversão de protocolo
 void JobQueue::process_job_with_protocol(const ProcessingContext& context) {
     std::ostringstream oss;
@@ -52,23 +474,8 @@ void JobQueue::process_job_with_protocol(const ProcessingContext& context) {
     update_job_status(context.job_id, JobStatus::Processing);
     
     try {
-        // Ler arquivo original
-        std::ifstream file(context.job.file_path, std::ios::binary);
-        if (!file.is_open()) {
-            throw std::runtime_error("Failed to open file: " + context.job.file_path);
-        }
-        
-        std::vector<uint8_t> file_data(
-            (std::istreambuf_iterator<char>(file)),
-            std::istreambuf_iterator<char>());
-        file.close();
-        
         // Converter media_size para enum
-        MediaSize media_size = MediaSize::A4;
-        if (context.job.options.media_size == "A0") media_size = MediaSize::A0;
-        else if (context.job.options.media_size == "A1") media_size = MediaSize::A1;
-        else if (context.job.options.media_size == "A2") media_size = MediaSize::A2;
-        else if (context.job.options.media_size == "A3") media_size = MediaSize::A3;
+        MediaSize media_size = parse_media_size(context.job.options.media_size);
         
         // Converter color_mode para enum
         ColorMode color_mode = ColorMode::MONOCHROME;
@@ -77,10 +484,7 @@ void JobQueue::process_job_with_protocol(const ProcessingContext& context) {
         }
         
         // Calcular DPI baseado na qualidade
-        int dpi = 300;
-        if (context.job.options.quality == 5) dpi = 1200;
-        else if (context.job.options.quality == 4) dpi = 600;
-        else if (context.job.options.quality >= 3) dpi = 600;
+        int dpi = effective_dpi(quality_dpi(context.job.options.quality), context.target_capabilities);
         
         // Gerar header
         auto header = context.protocol_handler->generate_header(
@@ -89,53 +493,481 @@ void JobQueue::process_job_with_protocol(const ProcessingContext& context) {
             color_mode,
             dpi);
         
-        // Processar página (assumindo raster data)
-        // Nota: Aqui você precisaria converter o arquivo para raster se necessário
-        int width = 2480;  // A4 @ 300 DPI width
-        int height = 3508; // A4 @ 300 DPI height
+        std::string temp_file = context.job.file_path + ".converted";
+        
+        // Retry: a saída codificada da tentativa anterior é reaproveitada
+        // enquanto documento, protocolo e resolução forem os mesmos
+        PlotCheckpoint checkpoint;
+        const bool cached = load_plot_checkpoint(temp_file, context.job.file_path, checkpoint) &&
+            checkpoint.protocol == context.target_protocol && checkpoint.dpi == dpi;
+        if (!cached) {
+            checkpoint = PlotCheckpoint{};
+            checkpoint.protocol = context.target_protocol;
+            checkpoint.dpi = dpi;
+            source_identity(context.job.file_path, checkpoint.source_size, checkpoint.source_mtime);
+        }
         
-        auto page_data = context.protocol_handler->generate_page(
-            file_data, width, height, dpi);
+        // Previsão refeita sobre o que é de fato enviado (páginas cortadas,
+        // reduzidas); passthrough mantém a da submissão
+        const int copies = std::max(1, context.job.options.copies);
+        double model_s = context.job.plot_model_s;
         
-        // Gerar footer
-        auto footer = context.protocol_handler->generate_footer();
+        // Reimpressão: mesmo conteúdo já codificado para este protocolo,
+        // modelo e opções vem do cache de conversão, sem recodificar
+        ConversionCache& cache = ConversionCache::instance();
+        std::string cache_key;
+        EncodedSummary summary;
+        bool from_cache = false;
+        if (!cached && cache.enabled()) {
+            const std::string hash = cache.content_hash(context.job.file_path);
+            if (!hash.empty()) {
+                Utils::Config& config = Utils::Config::instance();
+                const bool trim = context.roll_media && context.job.options.trim_whitespace;
+                const std::string trim_part = trim
+                    ? "trim=" + std::to_string(config.get_int("plotter.trim_tolerance", raster::TrimOptions{}.tolerance)) +
+                      "/" + std::to_string(config.get_double("plotter.trim_margin_mm", 5.0)) +
+                      "/" + std::to_string(config.get_double("plotter.feed_speed_mm_s", 20.0))
+                    : "trim=off";
+                cache_key = ConversionCache::make_key({
+                    "encoded", hash, lower_extension(context.job.file_path), context.target_protocol,
+                    std::to_string(static_cast<int>(context.target_capabilities.vendor)),
+                    context.target_capabilities.model, context.model_key, "quirks=" + context.quirks,
+                    "dpi=" + std::to_string(dpi),
+                    "media=" + std::to_string(static_cast<int>(media_size)),
+                    "color=" + std::to_string(static_cast<int>(color_mode)),
+                    "quality=" + std::to_string(context.job.options.quality), trim_part});
+                std::string meta;
+                if (cache.fetch(cache_key, temp_file, &meta)) {
+                    from_cache = summary.parse(meta, Utils::FileUtils::get_file_size(temp_file));
+                    if (!from_cache) {
+                        std::remove(temp_file.c_str());
+                    }
+                }
+            }
+        }
         
-        // Combinar tudo
-        std::vector<uint8_t> final_data;
-        final_data.insert(final_data.end(), header.begin(), header.end());
-        final_data.insert(final_data.end(), page_data.begin(), page_data.end());
-        final_data.insert(final_data.end(), footer.begin(), footer.end());
+        if (from_cache) {
+            checkpoint.bands = summary.bands;
+            model_s = summary.model_s_per_copy * copies;
+            if (summary.trimmed) {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                auto it = jobs_map_.find(context.job_id);
+                if (it != jobs_map_.end()) {
+                    it->second->blank_pages_skipped = summary.blank_pages;
+                    it->second->media_saved_mm = summary.media_saved_mm;
+                    it->second->plot_time_saved_s = summary.plot_time_saved_s;
+                }
+            }
+            
+            std::ostringstream oss;
+            oss << "Job " << context.job_id << " reusing cached " << context.target_protocol
+                << " output for identical content (" << Utils::FileUtils::get_file_size(temp_file)
+                << " bytes)";
+            LOG_INFO(oss.str());
+        } else if (cached) {
+            std::ostringstream oss;
+            oss << "Job " << context.job_id << " reusing encoded output " << temp_file
+                << " (" << checkpoint.output_size << " bytes, " << checkpoint.acknowledged
+                << " acknowledged)";
+            LOG_INFO(oss.str());
+        } else if (context.protocol_handler->supports_passthrough()) {
+            // Dispositivo interpreta o documento original: sem rasterização
+            // nem re-codificação, o arquivo é copiado pelo kernel
+            int out_fd = ::open(temp_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (out_fd < 0) {
+                throw std::runtime_error("Failed to create file: " + temp_file);
+            }
+            
+            // HPGL, DXF e SVG não são PDF: viram PDF vetorial antes de seguir direto
+            std::string source = context.job.file_path;
+            const bool from_dxf = is_dxf_file(source);
+            const bool from_svg = is_svg_file(source);
+            const bool from_hpgl = from_dxf || from_svg || is_hpgl(read_head(source, 16));
+            
+            uint64_t streamed = 0;
+            try {
+                if (from_dxf) {
+                    const DxfDrawing drawing = read_dxf_file(context.job.file_path);
+                    log_dxf_validation(context.job_id, drawing);
+                    source = temp_file + ".pdf";
+                    write_hpgl_pdf(dxf_display_list(drawing), source);
+                } else if (from_svg) {
+                    const HpglDisplayList drawing = read_svg_file(context.job.file_path);
+                    log_svg_validation(context.job_id, drawing);
+                    source = temp_file + ".pdf";
+                    write_hpgl_pdf(drawing, source);
+                } else if (from_hpgl) {
+                    source = temp_file + ".pdf";
+                    write_hpgl_pdf(parse_hpgl_file(context.job.file_path), source);
+                }
+                PDFPassthroughGenerator::write_all(out_fd, header);
+                streamed = PDFPassthroughGenerator::stream_file(source, out_fd);
+                PDFPassthroughGenerator::write_all(
+                    out_fd, context.protocol_handler->generate_footer());
+            } catch (...) {
+                ::close(out_fd);
+                if (from_hpgl) {
+                    std::remove(source.c_str());
+                }
+                throw;
+            }
+            ::close(out_fd);
+            if (from_hpgl) {
+                std::remove(source.c_str());
+            }
+            
+            std::ostringstream oss;
+            oss << "Job " << context.job_id << " streamed " << streamed
+                << " bytes in passthrough mode to " << temp_file;
+            LOG_INFO(oss.str());
+        } else {
+            // Netpbm é lido página a página direto do arquivo; os demais
+            // formatos são interpretados a partir do arquivo inteiro
+            const bool netpbm = is_netpbm_file(context.job.file_path);
+            std::vector<uint8_t> file_data;
+            if (!netpbm) {
+                std::ifstream file(context.job.file_path, std::ios::binary);
+                if (!file.is_open()) {
+                    throw std::runtime_error("Failed to open file: " + context.job.file_path);
+                }
+                file_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            }
+            
+            // A saída vai direto para o arquivo, pedaço a pedaço (header,
+            // cada página, footer), com a otimização do vendor aplicada a
+            // cada pedaço; se ela mudar o tamanho de algum, os offsets das
+            // faixas deixam de valer e o retry reenvia tudo
+            std::ofstream out_file(temp_file, std::ios::binary | std::ios::trunc);
+            if (!out_file) {
+                throw std::runtime_error("Failed to create file: " + temp_file);
+            }
+            uint64_t written = 0;
+            bool offsets_valid = true;
+            auto write_chunk = [&](const std::vector<uint8_t>& chunk) {
+                const std::vector<uint8_t> optimized = context.protocol_handler->optimize_for_vendor(chunk);
+                offsets_valid = offsets_valid && optimized.size() == chunk.size();
+                out_file.write(reinterpret_cast<const char*>(optimized.data()),
+                               static_cast<std::streamsize>(optimized.size()));
+                if (!out_file) {
+                    throw std::runtime_error("Failed to write file: " + temp_file);
+                }
+                written += optimized.size();
+            };
+            write_chunk(header);
         
-        // Otimizar para vendor
-        final_data = context.protocol_handler->optimize_for_vendor(final_data);
+            const bool from_dxf = is_dxf_file(context.job.file_path);
+            const bool from_svg = is_svg_file(context.job.file_path);
+            auto* hpgl_generator = speaks_hpgl(context.target_protocol)
+                ? dynamic_cast<HPGLGenerator*>(context.protocol_handler.get()) : nullptr;
+            
+            // Área da mídia na resolução do dispositivo
+            double media_w_mm = 0.0;
+            double media_h_mm = 0.0;
+            media_size_mm(media_size, context.target_capabilities, media_w_mm, media_h_mm);
+            int width = static_cast<int>(media_w_mm / 25.4 * dpi + 0.5);
+            int height = static_cast<int>(media_h_mm / 25.4 * dpi + 0.5);
+            
+            std::vector<uint8_t> page_data;
+            if (netpbm) {
+                // Em rolo o comprimento da página é livre: páginas em branco
+                // são puladas e o branco depois da última linha com tinta é
+                // cortado (mantendo a margem), economizando mídia e avanço
+                const bool trim = context.roll_media && context.job.options.trim_whitespace;
+                Utils::Config& config = Utils::Config::instance();
+                raster::TrimOptions trim_options;
+                trim_options.tolerance = config.get_int("plotter.trim_tolerance", trim_options.tolerance);
+                trim_options.margin_rows = static_cast<int>(
+                    config.get_double("plotter.trim_margin_mm", 5.0) / 25.4 * dpi + 0.5);
+                
+                raster::PnmPageReader reader(context.job.file_path);
+                int blank_pages = 0;
+                int pages_sent = 0;
+                RasterPlotStats plot_stats;
+                const int passes = context.speeds.passes_for_quality(context.job.options.quality);
+                int64_t removed_rows = 0;
+                
+                while (reader.next_page()) {
+                    auto page = read_page_for_media(reader, width, height, context.job_id, dpi);
+                    
+                    if (trim) {
+                        const auto plan = raster::plan_trim(
+                            raster::find_ink_extent(page, trim_options.tolerance),
+                            page.height(), trim_options);
+                        removed_rows += plan.removed_rows;
+                        if (plan.blank) {
+                            ++blank_pages;
+                            continue;
+                        }
+                        if (plan.removed_rows > 0) {
+                            page = raster::crop_rows(page, plan.first_row, plan.rows);
+                        }
+                    }
+                    
+                    plot_stats += analyze_raster(page, dpi, passes, trim_options.tolerance);
+                    std::vector<BandCheckpoint> page_bands;
+                    const auto encoded = context.protocol_handler->generate_raster_page(page, dpi, page_bands);
+                    for (auto& band : page_bands) {
+                        band.offset += written;
+                        checkpoint.bands.push_back(band);
+                    }
+                    write_chunk(encoded);
+                    ++pages_sent;
+                }
+                
+                if (pages_sent == 0) {
+                    throw std::runtime_error("Job has only blank pages");
+                }
+                model_s = predict_plot_seconds(plot_stats, context.speeds) * copies;
+                
+                if (trim) {
+                    const double saved_mm = removed_rows * 25.4 / dpi;
+                    const double saved_s = saved_mm / config.get_double("plotter.feed_speed_mm_s", 20.0);
+                    {
+                        std::lock_guard<std::mutex> lock(queue_mutex_);
+                        auto it = jobs_map_.find(context.job_id);
+                        if (it != jobs_map_.end()) {
+                            it->second->blank_pages_skipped = blank_pages;
+                            it->second->media_saved_mm = saved_mm;
+                            it->second->plot_time_saved_s = saved_s;
+                        }
+                    }
+                    summary.trimmed = true;
+                    summary.blank_pages = blank_pages;
+                    summary.media_saved_mm = saved_mm;
+                    summary.plot_time_saved_s = saved_s;
+                    
+                    std::ostringstream oss;
+                    oss << "Job " << context.job_id << " trimmed " << blank_pages << " blank page(s), saving "
+                        << static_cast<int>(saved_mm + 0.5) << " mm of media and "
+                        << static_cast<int>(saved_s + 0.5) << " s of plot time";
+                    LOG_INFO(oss.str());
+                }
+            } else if (from_dxf && hpgl_generator) {
+                // DXF direto para traços HPGL, sem conversor externo nem raster
+                const DxfDrawing drawing = read_dxf(file_data.data(), file_data.size());
+                log_dxf_validation(context.job_id, drawing);
+                page_data = hpgl_generator->generate_vector_page(drawing.strokes);
+                model_s = predict_plot_seconds(
+                    analyze_hpgl(page_data.data(), page_data.size()), context.speeds) * copies;
+                
+                std::ostringstream oss;
+                oss << "Job " << context.job_id << " DXF sent as " << drawing.strokes.size()
+                    << " HPGL strokes (" << drawing.entities << " entities)";
+                LOG_INFO(oss.str());
+            } else if (from_svg && hpgl_generator) {
+                // SVG achatado em traços por pena; áreas saem como contorno
+                const HpglDisplayList drawing = read_svg(file_data.data(), file_data.size());
+                log_svg_validation(context.job_id, drawing);
+                const std::vector<Polyline> strokes = pen_strokes(drawing);
+                page_data = hpgl_generator->generate_vector_page(strokes);
+                model_s = predict_plot_seconds(
+                    analyze_hpgl(page_data.data(), page_data.size()), context.speeds) * copies;
+                
+                std::ostringstream oss;
+                oss << "Job " << context.job_id << " SVG sent as " << strokes.size()
+                    << " HPGL strokes (" << drawing.commands << " elements)";
+                LOG_INFO(oss.str());
+            } else if (from_dxf || from_svg ||
+                       (is_hpgl(file_data) && !speaks_hpgl(context.target_protocol))) {
+                // HPGL, DXF ou SVG para dispositivo sem HPGL: a display list
+                // é desenhada na resolução do dispositivo, na posição que
+                // teria no plotter, e segue como qualquer página raster
+                HpglDisplayList drawing;
+                if (from_dxf) {
+                    const DxfDrawing dxf = read_dxf(file_data.data(), file_data.size());
+                    log_dxf_validation(context.job_id, dxf);
+                    drawing = dxf_display_list(dxf);
+                } else if (from_svg) {
+                    drawing = read_svg(file_data.data(), file_data.size());
+                    log_svg_validation(context.job_id, drawing);
+                } else {
+                    drawing = parse_hpgl(file_data.data(), file_data.size());
+                }
+                if (!from_svg && (drawing.unknown > 0 || drawing.unsupported > 0)) {
+                    std::ostringstream oss;
+                    oss << "Job " << context.job_id << " HPGL has " << drawing.unknown
+                        << " unknown and " << drawing.unsupported << " approximated commands";
+                    LOG_WARNING(oss.str());
+                }
+                if (drawing.empty()) {
+                    throw std::runtime_error("HPGL job draws nothing");
+                }
+                file_data = std::vector<uint8_t>();
+                
+                HpglRenderOptions render;
+                render.dpi = dpi;
+                render.include_origin = true;
+                render.format = color_mode == ColorMode::COLOR && drawing.has_color()
+                    ? raster::PixelFormat::RGB8 : raster::PixelFormat::GRAY8;
+                const raster::TiledRaster page = render_hpgl(drawing, render);
+                if (page.width() > width) {
+                    LOG_WARNING("Job " + std::to_string(context.job_id) +
+                                " HPGL drawing is wider than the media and will be clipped");
+                }
+                
+                const int passes = context.speeds.passes_for_quality(context.job.options.quality);
+                model_s = predict_plot_seconds(analyze_raster(page, dpi, passes), context.speeds) * copies;
+                std::vector<BandCheckpoint> page_bands;
+                page_data = context.protocol_handler->generate_raster_page(page, dpi, page_bands);
+                for (auto& band : page_bands) {
+                    band.offset += written;
+                    checkpoint.bands.push_back(band);
+                }
+            } else {
+                // Dados já no formato do dispositivo
+                page_data = context.protocol_handler->generate_page(
+                    file_data, width, height, dpi);
+                if (is_hpgl(file_data)) {
+                    model_s = predict_plot_seconds(
+                        analyze_hpgl(file_data.data(), file_data.size()), context.speeds) * copies;
+                }
+            }
         
-        // Salvar arquivo temporário convertido
-        std::string temp_file = context.job.file_path + ".converted";
-        std::ofstream out_file(temp_file, std::ios::binary);
-        out_file.write(reinterpret_cast<const char*>(final_data.data()), 
-                      final_data.size());
-        out_file.close();
+            if (!page_data.empty()) {
+                write_chunk(page_data);
+                page_data = std::vector<uint8_t>();
+            }
+            write_chunk(context.protocol_handler->generate_footer());
+            out_file.close();
+            if (!out_file) {
+                throw std::runtime_error("Failed to write file: " + temp_file);
+            }
+            if (!offsets_valid) {
+                checkpoint.bands.clear();
+            }
         
-        std::ostringstream oss;
-        oss << "Job " << context.job_id << " converted to " << context.target_protocol 
-            << " protocol, saved to " << temp_file;
-        LOG_INFO(oss.str());
+            std::ostringstream oss;
+            oss << "Job " << context.job_id << " converted to " << context.target_protocol 
+                << " protocol, saved to " << temp_file;
+            LOG_INFO(oss.str());
+        }
         
-        // Aqui você enviaria o arquivo convertido para impressão
-        // Por exemplo, via CUPS ou IPP
+        if (!cached) {
+            checkpoint.output_size = Utils::FileUtils::get_file_size(temp_file);
+            if (!save_plot_checkpoint(temp_file, checkpoint)) {
+                LOG_WARNING("Job " + std::to_string(context.job_id) +
+                            " could not save band checkpoints; a retry will convert again");
+            }
+            if (!from_cache && !cache_key.empty()) {
+                summary.model_s_per_copy = model_s / copies;
+                summary.bands = checkpoint.bands;
+                cache.publish(cache_key, temp_file, summary.serialize());
+            }
+        }
+        
+        if (model_s > 0.0) {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            auto it = jobs_map_.find(context.job_id);
+            if (it != jobs_map_.end()) {
+                it->second->plot_model_s = model_s;
+                it->second->predicted_plot_s = plot_calibration_.calibrate(context.model_key, model_s);
+            }
+        }
         
         update_job_status(context.job_id, JobStatus::Printing);
         
-        // Simular progresso de impressão
-        for (int i = 0; i <= 100; i += 10) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
-            if (progress_callback_) {
-                progress_callback_(context.job_id, i / 100.0f);
+        // Transmissão raw pelo spooler: o que ele aceita vai para o
+        // manifesto. Um retry recomeça da última faixa confirmada quando o
+        // dispositivo aceita retomar; senão reenvia a saída guardada inteira.
+        uint64_t start = 0;
+        std::vector<uint8_t> resume_prefix;
+        const BandCheckpoint* resume = checkpoint.resume_point();
+        if (cached && resume && resume->offset > 0 &&
+            context.protocol_handler->supports_band_resume()) {
+            start = resume->offset;
+            resume_prefix = context.protocol_handler->generate_resume_prefix(header, *resume, dpi);
+            
+            std::ostringstream oss;
+            oss << "Job " << context.job_id << " resuming at row " << resume->row
+                << ", byte " << start << " of " << checkpoint.output_size;
+            LOG_INFO(oss.str());
+        } else if (cached && checkpoint.acknowledged > 0) {
+            LOG_INFO("Job " + std::to_string(context.job_id) +
+                     " cannot resume on this device, resending cached output");
+        }
+        checkpoint.acknowledged = start;
+        
+        // Pontos em que o manifesto é regravado: início de cada faixa e
+        // décimos do restante
+        std::vector<uint64_t> acks;
+        for (const auto& band : checkpoint.bands) {
+            if (band.offset > start) acks.push_back(band.offset);
+        }
+        for (uint64_t i = 1; i <= 10; ++i) {
+            acks.push_back(start + (checkpoint.output_size - start) * i / 10);
+        }
+        std::sort(acks.begin(), acks.end());
+        acks.erase(std::unique(acks.begin(), acks.end()), acks.end());
+        size_t next_ack = 0;
+        
+        bool cancelled = false;
+        auto on_accepted = [&](uint64_t accepted) {
+            checkpoint.acknowledged = accepted;
+            bool crossed = false;
+            while (next_ack < acks.size() && acks[next_ack] <= accepted) {
+                ++next_ack;
+                crossed = true;
+            }
+            if (crossed) {
+                save_plot_checkpoint(temp_file, checkpoint);
             }
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                auto it = jobs_map_.find(context.job_id);
+                if (it != jobs_map_.end()) {
+                    it->second->bytes_acknowledged = accepted;
+                    it->second->bytes_resumed = start;
+                    it->second->progress = checkpoint.output_size > 0
+                        ? static_cast<float>(static_cast<double>(accepted) / checkpoint.output_size) : 1.0f;
+                    cancelled = it->second->status == JobStatus::Cancelled;
+                }
+            }
+            if (progress_callback_ && checkpoint.output_size > 0) {
+                progress_callback_(context.job_id,
+                    static_cast<float>(static_cast<double>(accepted) / checkpoint.output_size));
+            }
+            return !cancelled;
+        };
+        
+        const int cups_job_id = printer_manager_->submit_raw_job(
+            context.job.printer_name, temp_file, start, resume_prefix, context.job.options, on_accepted);
+        // O que foi aceito fica no manifesto, inclusive numa falha no meio
+        save_plot_checkpoint(temp_file, checkpoint);
+        if (cups_job_id <= 0) {
+            if (cancelled) {
+                LOG_INFO("Job " + std::to_string(context.job_id) + " cancelled after " +
+                         std::to_string(checkpoint.acknowledged) + " bytes");
+                return;
+            }
+            throw std::runtime_error("Failed to submit plot job to printer " + context.job.printer_name +
+                                     " after " + std::to_string(checkpoint.acknowledged) + " of " +
+                                     std::to_string(checkpoint.output_size) + " bytes");
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex_);
+            auto it = jobs_map_.find(context.job_id);
+            if (it != jobs_map_.end()) {
+                it->second->cups_job_id = cups_job_id;
+            }
+        }
+        const uint64_t sent = resume_prefix.size() + (checkpoint.acknowledged - start);
+        
+        // O envio termina quando o spooler aceita os dados, não quando o
+        // plot acaba: a duração real vem depois, do próprio spooler
+        {
+            std::lock_guard<std::mutex> lock(plot_times_mutex_);
+            pending_plot_times_.push_back(PendingPlotTime{
+                context.job_id, cups_job_id, context.model_key, model_s,
+                std::chrono::steady_clock::now()});
         }
         
-        // Limpar arquivo temporário
-        std::remove(temp_file.c_str());
+        std::ostringstream sent_oss;
+        sent_oss << "Job " << context.job_id << " transmitted " << sent << " of "
+                 << checkpoint.output_size << " bytes as CUPS job " << cups_job_id;
+        LOG_INFO(sent_oss.str());
+        
+        // Limpar saída convertida e manifesto; em falha eles ficam para o retry
+        remove_plot_checkpoint(temp_file);
         
         update_job_status(context.job_id, JobStatus::Completed);
         std::ostringstream oss2;
@@ -150,5 +982,445 @@ void JobQueue::process_job_with_protocol(const ProcessingContext& context) {
     }
 }
 
-} // namespace AllPress
+// Grupo de nesting começando em first; só first quando o nesting está
+// desligado, o destino não é um plotter em rolo ou nada é compatível
+std::vector<std::shared_ptr<PrintJob>> JobQueue::collect_nest_group(const std::shared_ptr<PrintJob>& first) {
+    std::vector<std::shared_ptr<PrintJob>> group{first};
+    
+    Utils::Config& config = Utils::Config::instance();
+    if (!config.get_bool("plotter.nesting", false) || !printer_manager_ ||
+        first->status != JobStatus::Pending ||
+        !printer_manager_->is_plotter(first->printer_name) ||
+        !is_netpbm_file(first->file_path)) {
+        return group;
+    }
+    
+    auto plotter_info = printer_manager_->get_plotter_info(first->printer_name);
+    auto compatibility = CompatibilityMatrix::find(
+        plotter_info.vendor, plotter_info.base_info.make_model);
+    if (!compatibility || !compatibility->roll_media) {
+        return group;
+    }
+    
+    const auto window = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+        std::chrono::duration<double>(config.get_double("plotter.nest_window_s", 120.0)));
+    const size_t max_jobs = static_cast<size_t>(std::max(1, config.get_int("plotter.nest_max_jobs", 32)));
+    
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    std::queue<std::shared_ptr<PrintJob>> remaining;
+    while (!job_queue_.empty()) {
+        auto candidate = job_queue_.front();
+        job_queue_.pop();
+        
+        const auto age = candidate->created_at > first->created_at
+            ? candidate->created_at - first->created_at
+            : first->created_at - candidate->created_at;
+        const bool compatible = group.size() < max_jobs &&
+            candidate->status == JobStatus::Pending &&
+            candidate->printer_name == first->printer_name &&
+            candidate->options.color_mode == first->options.color_mode &&
+            candidate->options.quality == first->options.quality &&
+            age <= window &&
+            is_netpbm_file(candidate->file_path);
+        if (compatible) {
+            group.push_back(candidate);
+        } else {
+            remaining.push(candidate);
+        }
+    }
+    job_queue_.swap(remaining);
+    
+    return group;
+}
+
+// Plota o grupo num único rolo: cada página é reduzida à mídia do seu job,
+// encaixada por skyline na largura do rolo e marcada com cantos de corte e o
+// número do job. Jobs que não entram no rolo voltam ao caminho sequencial.
+void JobQueue::process_nested_jobs(const std::vector<std::shared_ptr<PrintJob>>& jobs) {
+    const PrintJob& first = *jobs.front();
+    std::vector<std::shared_ptr<PrintJob>> nested;
+    std::vector<std::shared_ptr<PrintJob>> sequential;
+    
+    active_jobs_++;
+    try {
+        ProcessingContext context = make_processing_context(first);
+        Utils::Config& config = Utils::Config::instance();
+        const int dpi = effective_dpi(quality_dpi(first.options.quality), context.target_capabilities);
+        const int roll_width = static_cast<int>(
+            context.target_capabilities.max_paper_width_mm / 25.4 * dpi);
+        const int gap = static_cast<int>(config.get_double("plotter.nest_gap_mm", 10.0) / 25.4 * dpi + 0.5);
+        const bool allow_rotation = config.get_bool("plotter.nest_rotation", true);
+        
+        // Páginas de todos os jobs em tiles, já na resolução do dispositivo;
+        // as cópias apontam para a mesma página
+        std::vector<std::unique_ptr<raster::TiledRaster>> pages_read;
+        std::vector<const raster::TiledRaster*> images;
+        std::vector<size_t> owner;   // Índice em nested de cada página
+        raster::PixelFormat format = raster::PixelFormat::GRAY8;
+        for (const auto& job : jobs) {
+            update_job_status(job->job_id, JobStatus::Processing);
+            
+            double media_w_mm = 0.0;
+            double media_h_mm = 0.0;
+            media_size_mm(parse_media_size(job->options.media_size), context.target_capabilities,
+                          media_w_mm, media_h_mm);
+            const int width = static_cast<int>(media_w_mm / 25.4 * dpi + 0.5);
+            const int height = static_cast<int>(media_h_mm / 25.4 * dpi + 0.5);
+            
+            std::vector<std::unique_ptr<raster::TiledRaster>> pages;
+            try {
+                raster::PnmPageReader reader(job->file_path);
+                while (reader.next_page()) {
+                    pages.push_back(std::make_unique<raster::TiledRaster>(
+                        read_page_for_media(reader, width, height, job->job_id, dpi)));
+                }
+            } catch (const std::exception&) {
+                // O caminho sequencial reporta o erro no próprio job
+                pages.clear();
+            }
+            
+            // Um único formato de pixel por rolo; páginas mais largas que o
+            // rolo (em qualquer orientação, se girar é permitido) também não
+            // podem ser encaixadas
+            if (images.empty() && !pages.empty()) {
+                format = pages.front()->format();
+            }
+            const bool fits = std::all_of(pages.begin(), pages.end(), [&](const auto& page) {
+                const int across = allow_rotation ? std::min(page->width(), page->height()) : page->width();
+                return page->format() == format && across <= roll_width - gap;
+            });
+            if (pages.empty() || !fits) {
+                sequential.push_back(job);
+                continue;
+            }
+            
+            for (int copy = 0; copy < std::max(1, job->options.copies); ++copy) {
+                for (const auto& page : pages) {
+                    images.push_back(page.get());
+                    owner.push_back(nested.size());
+                }
+            }
+            std::move(pages.begin(), pages.end(), std::back_inserter(pages_read));
+            nested.push_back(job);
+        }
+        
+        std::vector<raster::NestItem> items;
+        for (size_t i = 0; i < images.size(); ++i) {
+            items.push_back(raster::NestItem{static_cast<int>(i), images[i]->width(), images[i]->height()});
+        }
+        raster::NestOptions nest_options;
+        nest_options.gap = gap;
+        nest_options.allow_rotation = allow_rotation;
+        raster::NestLayout layout;
+        if (nested.size() >= 2) {
+            // Página recusada pelo encaixe tira o job inteiro do rolo (ele
+            // segue sozinho) e o encaixe é refeito sem as páginas dele
+            std::vector<bool> dropped(nested.size(), false);
+            layout = raster::pack_skyline(items, roll_width, nest_options);
+            while (!layout.rejected.empty()) {
+                for (int id : layout.rejected) {
+                    dropped[owner[id]] = true;
+                }
+                items.erase(std::remove_if(items.begin(), items.end(), [&](const raster::NestItem& item) {
+                    return dropped[owner[item.id]];
+                }), items.end());
+                layout = raster::pack_skyline(items, roll_width, nest_options);
+            }
+            
+            std::vector<std::shared_ptr<PrintJob>> kept;
+            std::vector<size_t> index(nested.size(), SIZE_MAX);
+            for (size_t i = 0; i < nested.size(); ++i) {
+                if (dropped[i]) {
+                    LOG_WARNING("Job " + std::to_string(nested[i]->job_id) +
+                                " has a page that does not fit the roll; plotting it on its own");
+                    sequential.push_back(nested[i]);
+                } else {
+                    index[i] = kept.size();
+                    kept.push_back(nested[i]);
+                }
+            }
+            for (auto& job_index : owner) {
+                job_index = index[job_index];
+            }
+            nested.swap(kept);
+        }
+        
+        if (nested.size() < 2) {
+            // Nada a ganhar: os jobs seguem um a um
+            sequential.insert(sequential.end(), nested.begin(), nested.end());
+            nested.clear();
+        } else {
+            std::vector<std::string> labels;
+            for (size_t i = 0; i < images.size(); ++i) {
+                labels.push_back(owner[i] < nested.size() ? "#" + std::to_string(nested[owner[i]]->job_id) : "");
+            }
+            
+            raster::NestComposeOptions compose_options;
+            compose_options.mark_length = std::max(0, gap / 2 - 1);
+            compose_options.label_scale = std::max(1, (gap - 2) / 12);
+            const auto roll = raster::compose_nest(layout, images, format, labels, compose_options);
+            images.clear();
+            pages_read.clear();
+            
+            // Header, rolo e footer vão para o arquivo pedaço a pedaço, como
+            // no caminho de um job só
+            std::string temp_file = first.file_path + ".nest.converted";
+            std::ofstream out_file(temp_file, std::ios::binary | std::ios::trunc);
+            if (!out_file) {
+                throw std::runtime_error("Failed to create file: " + temp_file);
+            }
+            uint64_t written = 0;
+            auto write_chunk = [&](const std::vector<uint8_t>& chunk) {
+                const std::vector<uint8_t> optimized = context.protocol_handler->optimize_for_vendor(chunk);
+                out_file.write(reinterpret_cast<const char*>(optimized.data()),
+                               static_cast<std::streamsize>(optimized.size()));
+                if (!out_file) {
+                    out_file.close();
+                    std::remove(temp_file.c_str());
+                    throw std::runtime_error("Failed to write file: " + temp_file);
+                }
+                written += optimized.size();
+            };
+            write_chunk(context.protocol_handler->generate_header(
+                context.target_capabilities,
+                MediaSize::CUSTOM,
+                first.options.color_mode == "color" ? ColorMode::COLOR : ColorMode::MONOCHROME,
+                dpi));
+            write_chunk(context.protocol_handler->generate_raster_page(roll, dpi));
+            write_chunk(context.protocol_handler->generate_footer());
+            out_file.close();
+            
+            // Economia contra plotar cada página na sua própria folha: mídia
+            // pelo comprimento, tempo pelo avanço mais o custo fixo por job
+            // (carga, cabeçalho, corte) de cada job além do primeiro
+            std::vector<int64_t> job_rows(nested.size(), 0);
+            int64_t sequential_rows = 0;
+            for (const auto& item : items) {
+                job_rows[owner[item.id]] += item.height;
+                sequential_rows += item.height;
+            }
+            const double mm_per_row = 25.4 / dpi;
+            const double saved_mm = (sequential_rows - layout.length) * mm_per_row;
+            const double saved_s = saved_mm / config.get_double("plotter.feed_speed_mm_s", 20.0) +
+                (nested.size() - 1) * config.get_double("plotter.job_overhead_s", 20.0);
+            
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex_);
+                for (size_t i = 0; i < nested.size(); ++i) {
+                    PrintJob& job = *nested[i];
+                    const double share = static_cast<double>(job_rows[i]) / sequential_rows;
+                    job.nest_id = first.job_id;
+                    job.media_saved_mm = saved_mm * share;
+                    job.plot_time_saved_s = saved_s * share;
+                }
+                // Posição da primeira página de cada job
+                std::vector<bool> placed(nested.size(), false);
+                for (const auto& placement : layout.placements) {
+                    const size_t index = owner[placement.id];
+                    PrintJob& job = *nested[index];
+                    if (!placed[index]) {
+                        placed[index] = true;
+                        job.nest_x_mm = placement.x * mm_per_row;
+                        job.nest_y_mm = placement.y * mm_per_row;
+                        job.nest_rotated = placement.rotated;
+                    }
+                }
+            }
+            
+            std::ostringstream oss;
+            oss << "Nested " << nested.size() << " jobs (" << items.size() << " pages) from job "
+                << first.job_id << " on " << static_cast<int>(layout.length * mm_per_row + 0.5)
+                << " mm of roll, saving " << static_cast<int>(saved_mm + 0.5) << " mm of media and "
+                << static_cast<int>(saved_s + 0.5) << " s of plot time; saved to " << temp_file;
+            LOG_INFO(oss.str());
+            
+            for (const auto& job : nested) {
+                update_job_status(job->job_id, JobStatus::Printing);
+            }
+            
+            // Um único job no spooler para o rolo; as cópias já estão nele.
+            // O envio só para se todos os jobs do rolo forem cancelados.
+            PrintOptions roll_options = first.options;
+            roll_options.copies = 1;
+            const int cups_job_id = printer_manager_->submit_raw_job(
+                first.printer_name, temp_file, 0, {}, roll_options, [&](uint64_t accepted) {
+                    const float progress = written > 0 ? static_cast<float>(static_cast<double>(accepted) / written) : 1.0f;
+                    bool any_active = false;
+                    {
+                        std::lock_guard<std::mutex> lock(queue_mutex_);
+                        for (const auto& job : nested) {
+                            job->bytes_acknowledged = accepted;
+                            job->progress = progress;
+                            any_active = any_active || job->status != JobStatus::Cancelled;
+                        }
+                    }
+                    if (progress_callback_) {
+                        for (const auto& job : nested) {
+                            progress_callback_(job->job_id, progress);
+                        }
+                    }
+                    return any_active;
+                });
+            std::remove(temp_file.c_str());
+            if (cups_job_id <= 0) {
+                throw std::runtime_error("Failed to submit nested roll to printer " + first.printer_name);
+            }
+            
+            for (const auto& job : nested) {
+                bool cancelled = false;
+                {
+                    std::lock_guard<std::mutex> lock(queue_mutex_);
+                    job->cups_job_id = cups_job_id;
+                    cancelled = job->status == JobStatus::Cancelled;
+                }
+                if (!cancelled) {
+                    update_job_status(job->job_id, JobStatus::Completed);
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::ostringstream oss;
+        oss << "Failed to nest jobs starting at " << first.job_id << ": " << e.what();
+        LOG_ERROR(oss.str());
+        for (const auto& job : nested) {
+            update_job_status(job->job_id, JobStatus::Failed, e.what());
+        }
+        if (nested.empty() && sequential.empty()) {
+            sequential = jobs;
+        }
+    }
+    active_jobs_--;
+    
+    for (const auto& job : sequential) {
+        process_job(*job);
+    }
+}
 
+// Estimativa antes da conversão: HPGL, DXF e SVG são percorridos inteiros;
+// Netpbm usa só o cabeçalho e a cobertura amostrada, supondo tinta em todo o comprimento
+void JobQueue::predict_plot_time(PrintJob& job) {
+    if (!printer_manager_ || !printer_manager_->is_plotter(job.printer_name)) {
+        return;
+    }
+    
+    try {
+        auto plotter_info = printer_manager_->get_plotter_info(job.printer_name);
+        auto compatibility = CompatibilityMatrix::find(
+            plotter_info.vendor, plotter_info.base_info.make_model);
+        const std::string model_key = compatibility ? compatibility->model : plotter_info.base_info.make_model;
+        const PlotSpeeds speeds = compatibility ? compatibility->speeds : PlotSpeeds{};
+        
+        double seconds = 0.0;
+        if (is_netpbm_file(job.file_path)) {
+            const auto header = raster::read_pnm_header(job.file_path);
+            double media_w_mm = 0.0;
+            double media_h_mm = 0.0;
+            media_size_mm(parse_media_size(job.options.media_size), PlotterCapabilities{},
+                          media_w_mm, media_h_mm);
+            if ((header.width > header.height) != (media_w_mm > media_h_mm)) {
+                std::swap(media_w_mm, media_h_mm);
+            }
+            // Nunca ampliada, reduzida para caber na mídia
+            const double mm_per_pixel = std::min({25.4 / quality_dpi(job.options.quality),
+                                                  media_w_mm / header.width,
+                                                  media_h_mm / header.height});
+            
+            RasterPlotStats stats;
+            stats.passes = speeds.passes_for_quality(job.options.quality);
+            stats.media_length_mm = header.height * mm_per_pixel;
+            stats.inked_length_mm = stats.media_length_mm;
+            const auto coverage = raster::InkCoverageAnalyzer().analyze_file(job.file_path);
+            stats.ink_area_m2 = std::min(1.0, coverage.total_coverage()) *
+                header.width * mm_per_pixel * stats.media_length_mm / 1e6;
+            seconds = predict_plot_seconds(stats, speeds);
+        } else if (is_hpgl(read_head(job.file_path, 16))) {
+            std::ifstream file(job.file_path, std::ios::binary);
+            std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                                      std::istreambuf_iterator<char>());
+            seconds = predict_plot_seconds(analyze_hpgl(data.data(), data.size()), speeds);
+        } else if (is_dxf_file(job.file_path)) {
+            // Mesmos traços que o plotter HPGL receberia
+            const std::vector<uint8_t> program = dxf_to_hpgl(read_dxf_file(job.file_path));
+            seconds = predict_plot_seconds(analyze_hpgl(program.data(), program.size()), speeds);
+        } else if (is_svg_file(job.file_path)) {
+            const std::vector<uint8_t> program =
+                HPGLGenerator(true).generate_vector_page(pen_strokes(read_svg_file(job.file_path)));
+            seconds = predict_plot_seconds(analyze_hpgl(program.data(), program.size()), speeds);
+        } else {
+            return;
+        }
+        
+        job.plot_model_s = seconds * std::max(1, job.options.copies);
+        job.predicted_plot_s = plot_calibration_.calibrate(model_key, job.plot_model_s);
+    } catch (const std::exception& e) {
+        LOG_WARNING("Plot time prediction failed for " + job.file_path + ": " + e.what());
+    }
+}
+
+// Tempo real do job: guardado nele e usado para recalibrar o modelo
+// Um worker por vez pergunta ao spooler, no máximo a cada
+// plotter.calibration_poll_s; plots sem duração depois de
+// plotter.calibration_max_wait_s deixam de ser esperados
+void JobQueue::poll_plot_times() {
+    std::unique_lock<std::mutex> lock(plot_times_mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || pending_plot_times_.empty() || !printer_manager_) {
+        return;
+    }
+    
+    Utils::Config& config = Utils::Config::instance();
+    const auto now = std::chrono::steady_clock::now();
+    if (now < next_plot_poll_) {
+        return;
+    }
+    next_plot_poll_ = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(config.get_double("plotter.calibration_poll_s", 30.0)));
+    const auto max_wait = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(config.get_double("plotter.calibration_max_wait_s", 86400.0)));
+    
+    for (auto it = pending_plot_times_.begin(); it != pending_plot_times_.end();) {
+        const auto actual_s = printer_manager_->get_job_plot_seconds(it->cups_job_id);
+        if (actual_s && *actual_s > 0.0) {
+            record_plot_time(it->job_id, it->model_key, it->model_s, *actual_s);
+            it = pending_plot_times_.erase(it);
+        } else if (now - it->submitted > max_wait) {
+            LOG_DEBUG("Job " + std::to_string(it->job_id) +
+                      ": no device-reported plot time, calibration unchanged");
+            it = pending_plot_times_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void JobQueue::record_plot_time(int job_id, const std::string& model_key, double model_s, double actual_s) {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        auto it = jobs_map_.find(job_id);
+        if (it != jobs_map_.end()) {
+            it->second->actual_plot_s = actual_s;
+        }
+    }
+    if (model_s <= 0.0) {
+        return;
+    }
+    
+    plot_calibration_.observe(model_key, model_s, actual_s);
+    
+    std::ostringstream oss;
+    oss << "Job " << job_id << " plotted in " << static_cast<int>(actual_s + 0.5)
+        << " s (model " << static_cast<int>(model_s + 0.5) << " s); " << model_key
+        << " calibration factor " << plot_calibration_.factor(model_key);
+    LOG_INFO(oss.str());
+    
+    const std::string calibration_file =
+        Utils::Config::instance().get_string("plotter.calibration_file", "");
+    if (!calibration_file.empty()) {
+        try {
+            plot_calibration_.save(calibration_file);
+        } catch (const std::exception& e) {
+            LOG_WARNING(std::string("Failed to save plot time calibration: ") + e.what());
+        }
+    }
+}
+
+} // namespace AllPress
@@ -1,6 +1,7 @@
 #include "core/printer_manager.h"
 #include "utils/logger.h"
 #include <algorithm>
+#include <fstream>
 #include <sstream>
 
 #ifdef __APPLE__
@@ -299,6 +300,100 @@ int PrinterManager::submit_print_job(const std::string& printer, const std::stri
 #endif
 }
 
+int PrinterManager::submit_raw_job(const std::string& printer, const std::string& file_path,
+                                   uint64_t offset, const std::vector<uint8_t>& prefix,
+                                   const PrintOptions& options,
+                                   const std::function<bool(uint64_t)>& progress) {
+#if defined(__APPLE__) || defined(__linux__)
+    std::ifstream in(file_path, std::ios::binary);
+    if (!in.is_open()) {
+        LOG_ERROR("Failed to open file for raw print job: " + file_path);
+        return -1;
+    }
+    in.seekg(static_cast<std::streamoff>(offset));
+    
+    int num_options = 0;
+    cups_option_t* cup_options = nullptr;
+    num_options = cupsAddOption("copies", std::to_string(options.copies).c_str(), num_options, &cup_options);
+    const int job_id = cupsCreateJob(CUPS_HTTP_DEFAULT, printer.c_str(), "AllPress Plot",
+                                     num_options, cup_options);
+    cupsFreeOptions(num_options, cup_options);
+    if (job_id <= 0) {
+        LOG_ERROR("Failed to create raw print job on " + printer + ". CUPS error: " +
+                  std::string(cupsLastErrorString()));
+        return -1;
+    }
+    
+    // Documento único, sem filtro: o spooler repassa os bytes ao backend.
+    // Cada pedaço aceito é o que a JobQueue registra como confirmado.
+    bool ok = cupsStartDocument(CUPS_HTTP_DEFAULT, printer.c_str(), job_id, "AllPress Plot",
+                                CUPS_FORMAT_RAW, 1) == HTTP_STATUS_CONTINUE;
+    if (ok && !prefix.empty()) {
+        ok = cupsWriteRequestData(CUPS_HTTP_DEFAULT, reinterpret_cast<const char*>(prefix.data()),
+                                  prefix.size()) == HTTP_STATUS_CONTINUE;
+    }
+    
+    std::vector<char> buffer(64 * 1024);
+    uint64_t accepted = offset;
+    while (ok) {
+        in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        const std::streamsize n = in.gcount();
+        if (n <= 0) {
+            break;
+        }
+        ok = cupsWriteRequestData(CUPS_HTTP_DEFAULT, buffer.data(), static_cast<size_t>(n)) ==
+             HTTP_STATUS_CONTINUE;
+        if (ok) {
+            accepted += static_cast<uint64_t>(n);
+            ok = !progress || progress(accepted);
+        }
+    }
+    ok = ok && !in.bad();
+    
+    const bool finished = cupsFinishDocument(CUPS_HTTP_DEFAULT, printer.c_str()) == IPP_STATUS_OK;
+    if (!ok || !finished) {
+        LOG_ERROR("Raw print job " + std::to_string(job_id) + " on " + printer + " failed after " +
+                  std::to_string(accepted) + " bytes. CUPS error: " + std::string(cupsLastErrorString()));
+        cupsCancelJob(printer.c_str(), job_id);
+        return -1;
+    }
+    
+    LOG_INFO("Raw print job submitted with job ID: " + std::to_string(job_id));
+    return job_id;
+#else
+    LOG_ERROR("CUPS not supported on this platform");
+    return -1;
+#endif
+}
+
+std::optional<double> PrinterManager::get_job_plot_seconds(int job_id) {
+#if defined(__APPLE__) || defined(__linux__)
+    ipp_t* request = ippNewRequest(IPP_GET_JOB_ATTRIBUTES);
+    const std::string job_uri = "ipp://localhost/jobs/" + std::to_string(job_id);
+    ippAddString(request, IPP_TAG_OPERATION, IPP_TAG_URI, "job-uri", nullptr, job_uri.c_str());
+    
+    ipp_t* response = cupsDoRequest(CUPS_HTTP_DEFAULT, request, "/");
+    if (!response) {
+        return std::nullopt;
+    }
+    
+    std::optional<double> seconds;
+    ipp_attribute_t* state = ippFindAttribute(response, "job-state", IPP_TAG_ENUM);
+    ipp_attribute_t* processing = ippFindAttribute(response, "time-at-processing", IPP_TAG_INTEGER);
+    ipp_attribute_t* completed = ippFindAttribute(response, "time-at-completed", IPP_TAG_INTEGER);
+    if (state && ippGetInteger(state, 0) == IPP_JSTATE_COMPLETED && processing && completed) {
+        const int elapsed = ippGetInteger(completed, 0) - ippGetInteger(processing, 0);
+        if (elapsed > 0) {
+            seconds = static_cast<double>(elapsed);
+        }
+    }
+    ippDelete(response);
+    return seconds;
+#else
+    return std::nullopt;
+#endif
+}
+
 bool PrinterManager::cancel_job(int job_id) {
 #if defined(__APPLE__) || defined(__linux__)
     int result = cupsCancelJob(nullptr, job_id);
@@ -348,6 +443,7 @@ void PrinterManager::update_printer_status() {
 void PrinterManager::monitor_thread_func() {
     while (monitoring_active_) {
         update_printer_status();
+        reload_plotter_specs_if_changed();
         std::this_thread::sleep_for(std::chrono::seconds(5));
     }
 }
@@ -89,8 +89,7 @@ PrinterManager::discover_plotters_advanced_async() {
                 
                 // Criar protocolo handler para obter capabilities
                 try {
-                    auto protocol = PlotterProtocolFactory::create_for_printer(
-                        adv_info.vendor, model);
+                    auto protocol = protocol_pool_->checkout(adv_info.vendor, model);
                     adv_info.capabilities = protocol->get_capabilities();
                 } catch (const std::exception& e) {
                     std::ostringstream oss;
@@ -200,7 +199,7 @@ bool PrinterManager::validate_document_for_plotter(
     
     // Criar protocolo handler
     try {
-        auto protocol = PlotterProtocolFactory::create_for_printer(
+        auto protocol = protocol_pool_->checkout(
             plotter_info.vendor, plotter_info.base_info.make_model);
         
         // Converter string de media_size para enum
@@ -262,5 +261,27 @@ bool PrinterManager::validate_document_for_plotter(
     }
 }
 
+// Recarregar a matriz de compatibilidade quando o arquivo mudar
+bool PrinterManager::reload_plotter_specs_if_changed() {
+    try {
+        if (!CompatibilityMatrix::reload_if_changed()) {
+            return false;
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR(std::string("Failed to reload plotter specs, keeping current: ") + e.what());
+        return false;
+    }
+    
+    // Protocolo recomendado e quirks podem ter mudado
+    {
+        std::lock_guard<std::mutex> lock(plotter_cache_mutex_);
+        plotter_cache_.clear();
+    }
+    protocol_pool_->clear();
+    
+    LOG_INFO("Plotter specs reloaded from " + CompatibilityMatrix::loaded_file());
+    return true;
+}
+
 } // namespace AllPress
 
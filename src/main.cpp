@@ -5,9 +5,11 @@
 #include "core/printer_manager.h"
 #include "core/job_queue.h"
 #include "core/color_manager.h"
+#include "protocols/compatibility_matrix.h"
 #include "network/ipp_client.h"
 #include "network/network_scanner.h"
 #include "conversion/file_processor.h"
+#include "conversion/converter_pool.h"
 #include "database/sqlite_manager.h"
 #include "api/rest_server.h"
 #include "api/websocket_server.h"
@@ -50,6 +52,15 @@ int main(int argc, char* argv[]) {
     int ws_port = config.get_int("server.ws_port", 8001);
     int max_workers = config.get_int("queue.max_workers", 4);
     
+    // Matriz de compatibilidade de plotters
+    std::string specs_file = config.get_string("plotters.specs_file", "config/plotter_specs.json");
+    try {
+        all_press::protocols::CompatibilityMatrix::load_from_file(specs_file);
+        LOG_INFO("Loaded plotter specs from " + specs_file);
+    } catch (const std::exception& e) {
+        LOG_WARNING(std::string("Using built-in plotter compatibility matrix: ") + e.what());
+    }
+    
     try {
         // Initialize database
         LOG_INFO("Initializing database...");
@@ -86,6 +97,11 @@ int main(int argc, char* argv[]) {
         // Initialize file processor
         LOG_INFO("Initializing file processor...");
         AllPress::FileProcessor file_processor;
+        const int prewarmed = AllPress::ConverterPool::instance().warm_up(
+            config.get_int("conversion.libreoffice.prewarm", 1));
+        if (prewarmed > 0) {
+            LOG_INFO("Started " + std::to_string(prewarmed) + " LibreOffice listener(s)");
+        }
         
         // Start printer status monitoring
         LOG_INFO("Starting printer status monitoring...");
@@ -143,6 +159,7 @@ int main(int argc, char* argv[]) {
         rest_server.stop();
         printer_manager.stop_status_monitoring();
         job_queue.stop();
+        AllPress::ConverterPool::instance().shutdown();
         
         LOG_INFO("Server stopped successfully");
         
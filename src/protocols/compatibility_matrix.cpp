@@ -1,20 +1,385 @@
 #include "protocols/compatibility_matrix.h"
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <sys/stat.h>
 
 namespace all_press {
 namespace protocols {
 
-std::string CompatibilityMatrix::get_key(PlotterVendor vendor, const std::string& model) {
-    std::string prefix;
-    if (vendor == PlotterVendor::HP) {
-        prefix = "HP_";
-    } else if (vendor == PlotterVendor::CANON) {
-        prefix = "CANON_";
-    } else if (vendor == PlotterVendor::EPSON) {
-        prefix = "EPSON_";
+namespace {
+
+constexpr size_t MAX_QUERY_TOKENS = 16;
+constexpr size_t MAX_TOKEN_LENGTH = 32;
+constexpr uint32_t NO_TOKEN = UINT32_MAX;
+constexpr size_t VENDOR_COUNT = 4;  // HP, CANON, EPSON, GENERIC
+
+// Tokens normalizados em buffers da pilha: sequências alfanuméricas em
+// minúsculas ("HP DesignJet_T1200-PS3" -> hp designjet t1200 ps3)
+struct TokenBuffer {
+    std::array<std::array<char, MAX_TOKEN_LENGTH>, MAX_QUERY_TOKENS> text;
+    std::array<size_t, MAX_QUERY_TOKENS> length;
+    size_t count = 0;
+
+    std::string_view token(size_t i) const {
+        return std::string_view(text[i].data(), length[i]);
     }
-    return prefix + model;
+};
+
+void tokenize(std::string_view input, TokenBuffer& out) {
+    out.count = 0;
+    size_t i = 0;
+    while (i < input.size() && out.count < MAX_QUERY_TOKENS) {
+        while (i < input.size() && !std::isalnum(static_cast<unsigned char>(input[i]))) {
+            ++i;
+        }
+        if (i >= input.size()) {
+            break;
+        }
+        size_t len = 0;
+        bool truncated = false;
+        while (i < input.size() && std::isalnum(static_cast<unsigned char>(input[i]))) {
+            if (len < MAX_TOKEN_LENGTH) {
+                out.text[out.count][len++] = static_cast<char>(
+                    std::tolower(static_cast<unsigned char>(input[i])));
+            } else {
+                truncated = true;
+            }
+            ++i;
+        }
+        // Token truncado nunca casa com o vocabulário
+        out.length[out.count] = truncated ? 0 : len;
+        ++out.count;
+    }
+}
+
+std::vector<std::string> tokenize(std::string_view input) {
+    TokenBuffer buffer;
+    tokenize(input, buffer);
+    std::vector<std::string> tokens;
+    for (size_t i = 0; i < buffer.count; ++i) {
+        if (buffer.length[i] == 0) {
+            throw std::runtime_error("Model name token too long: " + std::string(input));
+        }
+        tokens.emplace_back(buffer.token(i));
+    }
+    return tokens;
 }
 
+std::string quirk_value(const nlohmann::json& value) {
+    if (value.is_string()) {
+        return value.get<std::string>();
+    }
+    if (value.is_boolean()) {
+        return value.get<bool>() ? "true" : "false";
+    }
+    return value.dump();
+}
+
+PlotterVendor parse_vendor(const std::string& name) {
+    std::string lower;
+    for (unsigned char c : name) {
+        lower += static_cast<char>(std::tolower(c));
+    }
+    if (lower == "hp") return PlotterVendor::HP;
+    if (lower == "canon") return PlotterVendor::CANON;
+    if (lower == "epson") return PlotterVendor::EPSON;
+    return PlotterVendor::GENERIC;
+}
+
+std::vector<std::string> string_list(const nlohmann::json& node, const char* key) {
+    std::vector<std::string> result;
+    if (node.contains(key)) {
+        for (const auto& item : node.at(key)) {
+            result.push_back(item.get<std::string>());
+        }
+    }
+    return result;
+}
+
+// Campos presentes sobrescrevem os atuais
+void read_speeds(const nlohmann::json& node, PlotSpeeds& speeds) {
+    speeds.pen_down_mm_s = node.value("pen_down_mm_s", speeds.pen_down_mm_s);
+    speeds.pen_up_mm_s = node.value("pen_up_mm_s", speeds.pen_up_mm_s);
+    speeds.command_s = node.value("command_s", speeds.command_s);
+    speeds.pen_change_s = node.value("pen_change_s", speeds.pen_change_s);
+    speeds.print_mm_s = node.value("print_mm_s", speeds.print_mm_s);
+    speeds.feed_mm_s = node.value("feed_mm_s", speeds.feed_mm_s);
+    speeds.ink_s_per_m2 = node.value("ink_s_per_m2", speeds.ink_s_per_m2);
+    speeds.job_overhead_s = node.value("job_overhead_s", speeds.job_overhead_s);
+    if (node.contains("passes")) {
+        speeds.passes = node.at("passes").get<std::vector<int>>();
+    }
+}
+
+}  // namespace
+
+// Trie achatada sobre ids de tokens internados. Cada modelo (e alias) é
+// inserido como sequência de tokens a partir da raiz do seu vendor.
+class CompatibilityIndex {
+public:
+    struct Entry {
+        CompatibilityInfo info;
+        std::vector<std::string> aliases;
+    };
+
+    explicit CompatibilityIndex(std::vector<Entry> entries);
+
+    // Índice em entries_ do melhor casamento, ou -1
+    int find(PlotterVendor vendor, std::string_view make_model) const;
+
+    const std::vector<CompatibilityInfo>& entries() const { return entries_; }
+
+private:
+    struct Node {
+        uint32_t first_edge = 0;
+        uint32_t edge_count = 0;
+        int32_t entry = -1;
+    };
+
+    struct Edge {
+        uint32_t token;
+        uint32_t child;
+    };
+
+    uint32_t token_id(std::string_view token) const;
+    void match_from(uint32_t root, const uint32_t* tokens, size_t count,
+                    size_t& best_length, int& best_entry) const;
+
+    std::vector<CompatibilityInfo> entries_;
+    std::vector<std::string> vocabulary_;  // Ordenado: id = posição
+    std::vector<Node> nodes_;
+    std::vector<Edge> edges_;              // Arestas de cada nó, ordenadas por token
+    std::array<uint32_t, VENDOR_COUNT> roots_{};
+};
+
+CompatibilityIndex::CompatibilityIndex(std::vector<Entry> entries) {
+    // Vocabulário internado
+    std::vector<std::vector<std::vector<std::string>>> names(entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        names[i].push_back(tokenize(entries[i].info.model));
+        for (const auto& alias : entries[i].aliases) {
+            names[i].push_back(tokenize(alias));
+        }
+        for (const auto& tokens : names[i]) {
+            vocabulary_.insert(vocabulary_.end(), tokens.begin(), tokens.end());
+        }
+    }
+    std::sort(vocabulary_.begin(), vocabulary_.end());
+    vocabulary_.erase(std::unique(vocabulary_.begin(), vocabulary_.end()), vocabulary_.end());
+
+    // Trie temporária com filhos em std::map, achatada no final
+    struct BuildNode {
+        std::map<uint32_t, uint32_t> children;
+        int32_t entry = -1;
+    };
+    std::vector<BuildNode> build(VENDOR_COUNT);
+    for (size_t v = 0; v < VENDOR_COUNT; ++v) {
+        roots_[v] = static_cast<uint32_t>(v);
+    }
+
+    for (size_t i = 0; i < entries.size(); ++i) {
+        uint32_t root = roots_[static_cast<size_t>(entries[i].info.vendor)];
+        for (const auto& tokens : names[i]) {
+            if (tokens.empty()) {
+                continue;
+            }
+            uint32_t node = root;
+            for (const auto& token : tokens) {
+                uint32_t id = token_id(token);
+                auto it = build[node].children.find(id);
+                if (it == build[node].children.end()) {
+                    uint32_t child = static_cast<uint32_t>(build.size());
+                    build[node].children.emplace(id, child);
+                    build.emplace_back();
+                    node = child;
+                } else {
+                    node = it->second;
+                }
+            }
+            // Primeiro modelo declarado vence em nomes duplicados
+            if (build[node].entry < 0) {
+                build[node].entry = static_cast<int32_t>(i);
+            }
+        }
+    }
+
+    nodes_.resize(build.size());
+    for (size_t n = 0; n < build.size(); ++n) {
+        nodes_[n].first_edge = static_cast<uint32_t>(edges_.size());
+        nodes_[n].edge_count = static_cast<uint32_t>(build[n].children.size());
+        nodes_[n].entry = build[n].entry;
+        for (const auto& [token, child] : build[n].children) {
+            edges_.push_back(Edge{token, child});
+        }
+    }
+
+    entries_.reserve(entries.size());
+    for (auto& entry : entries) {
+        entries_.push_back(std::move(entry.info));
+    }
+}
+
+uint32_t CompatibilityIndex::token_id(std::string_view token) const {
+    auto it = std::lower_bound(vocabulary_.begin(), vocabulary_.end(), token,
+        [](const std::string& a, std::string_view b) { return std::string_view(a) < b; });
+    if (it == vocabulary_.end() || std::string_view(*it) != token) {
+        return NO_TOKEN;
+    }
+    return static_cast<uint32_t>(it - vocabulary_.begin());
+}
+
+void CompatibilityIndex::match_from(uint32_t root, const uint32_t* tokens, size_t count,
+                                    size_t& best_length, int& best_entry) const {
+    uint32_t node = root;
+    for (size_t i = 0; i < count; ++i) {
+        const Node& current = nodes_[node];
+        const Edge* begin = edges_.data() + current.first_edge;
+        const Edge* end = begin + current.edge_count;
+        const Edge* edge = std::lower_bound(begin, end, tokens[i],
+            [](const Edge& e, uint32_t token) { return e.token < token; });
+        if (edge == end || edge->token != tokens[i]) {
+            return;
+        }
+        node = edge->child;
+        if (nodes_[node].entry >= 0 && i + 1 > best_length) {
+            best_length = i + 1;
+            best_entry = nodes_[node].entry;
+        }
+    }
+}
+
+int CompatibilityIndex::find(PlotterVendor vendor, std::string_view make_model) const {
+    TokenBuffer buffer;
+    tokenize(make_model, buffer);
+
+    std::array<uint32_t, MAX_QUERY_TOKENS> ids;
+    for (size_t i = 0; i < buffer.count; ++i) {
+        ids[i] = buffer.length[i] ? token_id(buffer.token(i)) : NO_TOKEN;
+    }
+
+    // O modelo pode começar depois de prefixos do fabricante ("HP",
+    // "Hewlett-Packard"); o casamento mais longo vence, depois o mais à esquerda
+    size_t best_length = 0;
+    int best_entry = -1;
+    for (size_t start = 0; start < buffer.count; ++start) {
+        if (ids[start] == NO_TOKEN) {
+            continue;
+        }
+        if (vendor == PlotterVendor::GENERIC) {
+            for (uint32_t root : roots_) {
+                match_from(root, ids.data() + start, buffer.count - start,
+                           best_length, best_entry);
+            }
+        } else {
+            match_from(roots_[static_cast<size_t>(vendor)], ids.data() + start,
+                       buffer.count - start, best_length, best_entry);
+        }
+    }
+    return best_entry;
+}
+
+namespace {
+
+struct LoadedFile {
+    std::mutex mutex;
+    std::string path;
+    time_t mtime = 0;
+    off_t size = -1;
+};
+
+LoadedFile& loaded_file_state() {
+    static LoadedFile state;
+    return state;
+}
+
+std::shared_ptr<const CompatibilityIndex> parse_specs(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open plotter specs: " + path);
+    }
+
+    nlohmann::json specs;
+    try {
+        specs = nlohmann::json::parse(file, nullptr, true, true);
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error("Invalid plotter specs " + path + ": " + e.what());
+    }
+
+    std::vector<CompatibilityIndex::Entry> entries;
+    try {
+        const auto& protocol_reference = specs.contains("protocol_reference")
+            ? specs.at("protocol_reference") : nlohmann::json::object();
+        const auto& speed_reference = specs.contains("speed_reference")
+            ? specs.at("speed_reference") : nlohmann::json::object();
+
+        for (const auto& [vendor_key, vendor_node] : specs.at("plotters").items()) {
+            PlotterVendor vendor = parse_vendor(vendor_node.value("vendor", vendor_key));
+
+            for (const auto& series : vendor_node.at("series")) {
+                for (const auto& model : series.at("models")) {
+                    CompatibilityIndex::Entry entry;
+                    auto& info = entry.info;
+                    info.vendor = vendor;
+                    info.model = model.at("model").get<std::string>();
+
+                    const auto& protocols = model.at("protocols");
+                    info.primary_protocol = protocols.at("primary").get<std::string>();
+                    info.supported_protocols = string_list(protocols, "supported");
+                    info.fallback_protocols = string_list(protocols, "fallback");
+
+                    // Herdado do protocolo primário, salvo override no modelo
+                    info.requires_preprocessing = false;
+                    if (protocol_reference.contains(info.primary_protocol)) {
+                        info.requires_preprocessing = protocol_reference
+                            .at(info.primary_protocol)
+                            .value("requires_preprocessing", false);
+                    }
+                    info.requires_preprocessing =
+                        model.value("requires_preprocessing", info.requires_preprocessing);
+
+                    if (model.contains("media")) {
+                        info.roll_media = model.at("media").value("roll_support", false);
+                    }
+
+                    // Velocidades do tipo de cabeça, salvo override no modelo
+                    const std::string head = model.contains("colors")
+                        ? model.at("colors").value("type", "inkjet") : "inkjet";
+                    if (speed_reference.contains(head)) {
+                        read_speeds(speed_reference.at(head), info.speeds);
+                    }
+                    if (model.contains("speed")) {
+                        read_speeds(model.at("speed"), info.speeds);
+                    }
+
+                    if (model.contains("quirks")) {
+                        for (const auto& [key, value] : model.at("quirks").items()) {
+                            info.quirks[key] = quirk_value(value);
+                        }
+                    }
+                    entry.aliases = string_list(model, "aliases");
+
+                    entries.push_back(std::move(entry));
+                }
+            }
+        }
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error("Invalid plotter specs " + path + ": " + e.what());
+    }
+
+    if (entries.empty()) {
+        throw std::runtime_error("No plotter models in " + path);
+    }
+    return std::make_shared<const CompatibilityIndex>(std::move(entries));
+}
+
+}  // namespace
+
 // Base de dados de compatibilidade
 const std::map<std::string, CompatibilityInfo> CompatibilityMatrix::COMPATIBILITY_DB = {
     // HP PLOTTERS
@@ -44,7 +409,8 @@ const std::map<std::string, CompatibilityInfo> CompatibilityMatrix::COMPATIBILIT
             .requires_preprocessing = true,
             .quirks = {
                 {"paper_feed_delay", "300ms"},
-                {"color_calibration", "required"}
+                {"color_calibration", "required"},
+                {"hpgl_polyline_encoding", "true"}
             }
         }
     },
@@ -59,7 +425,10 @@ const std::map<std::string, CompatibilityInfo> CompatibilityMatrix::COMPATIBILIT
             .requires_preprocessing = true,
             .quirks = {
                 {"paper_feed_delay", "200ms"},
-                {"high_speed_mode", "true"}
+                {"high_speed_mode", "true"},
+                {"hpgl_polyline_encoding", "true"},
+                {"hpgl_pe_fraction_bits", "2"},
+                {"rtl_band_resume", "true"}
             }
         }
     },
@@ -159,32 +528,112 @@ const std::map<std::string, CompatibilityInfo> CompatibilityMatrix::COMPATIBILIT
     }
 };
 
+namespace {
+
+std::shared_ptr<const CompatibilityIndex> build_builtin_index(
+    const std::map<std::string, CompatibilityInfo>& db) {
+    std::vector<CompatibilityIndex::Entry> entries;
+    for (const auto& [key, info] : db) {
+        entries.push_back(CompatibilityIndex::Entry{info, {}});
+    }
+    return std::make_shared<const CompatibilityIndex>(std::move(entries));
+}
+
+std::shared_ptr<const CompatibilityIndex>& index_slot() {
+    static std::shared_ptr<const CompatibilityIndex> slot;
+    return slot;
+}
+
+}  // namespace
+
+std::shared_ptr<const CompatibilityIndex> CompatibilityMatrix::snapshot() {
+    static std::once_flag builtin_once;
+    std::call_once(builtin_once, [] {
+        if (!std::atomic_load(&index_slot())) {
+            std::atomic_store(&index_slot(), build_builtin_index(COMPATIBILITY_DB));
+        }
+    });
+    return std::atomic_load(&index_slot());
+}
+
+std::shared_ptr<const CompatibilityInfo> CompatibilityMatrix::find(
+    PlotterVendor vendor,
+    std::string_view make_model) {
+    
+    auto index = snapshot();
+    int entry = index->find(vendor, make_model);
+    if (entry < 0) {
+        return nullptr;
+    }
+    // Aliasing: mantém o índice vivo sem alocar
+    return std::shared_ptr<const CompatibilityInfo>(
+        index, &index->entries()[static_cast<size_t>(entry)]);
+}
+
+void CompatibilityMatrix::load_from_file(const std::string& path) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) {
+        throw std::runtime_error("Plotter specs not found: " + path);
+    }
+
+    auto index = parse_specs(path);
+
+    auto& state = loaded_file_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    snapshot();  // Garante que a tabela embutida não sobrescreva o arquivo
+    std::atomic_store(&index_slot(), index);
+    state.path = path;
+    state.mtime = st.st_mtime;
+    state.size = st.st_size;
+}
+
+bool CompatibilityMatrix::reload_if_changed() {
+    std::string path;
+    {
+        auto& state = loaded_file_state();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (state.path.empty()) {
+            return false;
+        }
+        struct stat st;
+        if (::stat(state.path.c_str(), &st) != 0 ||
+            (st.st_mtime == state.mtime && st.st_size == state.size)) {
+            return false;
+        }
+        path = state.path;
+    }
+    load_from_file(path);
+    return true;
+}
+
+std::string CompatibilityMatrix::loaded_file() {
+    auto& state = loaded_file_state();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.path;
+}
+
 bool CompatibilityMatrix::is_compatible(
     PlotterVendor vendor,
     const std::string& model,
     const std::string& protocol) {
     
-    std::string key = get_key(vendor, model);
-    
-    auto it = COMPATIBILITY_DB.find(key);
-    if (it == COMPATIBILITY_DB.end()) {
+    auto info = find(vendor, model);
+    if (!info) {
         return false;
     }
     
-    const auto& info = it->second;
-    return std::find(info.supported_protocols.begin(),
-                    info.supported_protocols.end(),
-                    protocol) != info.supported_protocols.end();
+    return std::find(info->supported_protocols.begin(),
+                    info->supported_protocols.end(),
+                    protocol) != info->supported_protocols.end();
 }
 
 std::string CompatibilityMatrix::get_recommended_protocol(
     PlotterVendor vendor,
     const std::string& model) {
     
-    std::string key = get_key(vendor, model);
-    auto it = COMPATIBILITY_DB.find(key);
+    auto info = find(vendor, model);
     
-    if (it == COMPATIBILITY_DB.end()) {
+    if (!info) {
         // Default fallback
         if (vendor == PlotterVendor::HP) {
             return "HPGL2";
@@ -193,43 +642,37 @@ std::string CompatibilityMatrix::get_recommended_protocol(
         }
     }
     
-    return it->second.primary_protocol;
+    return info->primary_protocol;
 }
 
 std::vector<std::string> CompatibilityMatrix::get_fallback_protocols(
     PlotterVendor vendor,
     const std::string& model) {
     
-    std::string key = get_key(vendor, model);
-    auto it = COMPATIBILITY_DB.find(key);
+    auto info = find(vendor, model);
     
-    if (it == COMPATIBILITY_DB.end()) {
+    if (!info) {
         return {"PostScript", "HPGL2", "ESC/P"};
     }
     
-    return it->second.fallback_protocols;
+    return info->fallback_protocols;
 }
 
 std::map<std::string, std::string> CompatibilityMatrix::get_quirks(
     PlotterVendor vendor,
     const std::string& model) {
     
-    std::string key = get_key(vendor, model);
-    auto it = COMPATIBILITY_DB.find(key);
+    auto info = find(vendor, model);
     
-    if (it == COMPATIBILITY_DB.end()) {
+    if (!info) {
         return {};
     }
     
-    return it->second.quirks;
+    return info->quirks;
 }
 
 std::vector<CompatibilityInfo> CompatibilityMatrix::get_all_plotters() {
-    std::vector<CompatibilityInfo> plotters;
-    for (const auto& [key, info] : COMPATIBILITY_DB) {
-        plotters.push_back(info);
-    }
-    return plotters;
+    return snapshot()->entries();
 }
 
 }  // namespace protocols
@@ -0,0 +1,1027 @@
+#include "protocols/dxf_reader.h"
+#include "protocols/hpgl_generator.h"
+#include "raster/icc_catalog.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+namespace all_press {
+namespace protocols {
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr int MAX_INSERT_DEPTH = 16;
+constexpr int MAX_ARC_SEGMENTS = 4096;
+constexpr int ACI_BYBLOCK = 0;
+constexpr int ACI_BYLAYER = 256;
+constexpr int ACI_DEFAULT = 7;
+
+struct Group {
+    int code = 0;
+    const char* value = nullptr;
+    size_t length = 0;
+
+    bool is(const char* text) const {
+        return length == std::strlen(text) && std::memcmp(value, text, length) == 0;
+    }
+    std::string text() const { return std::string(value, length); }
+
+    double number() const {
+        char buffer[64];
+        const size_t n = std::min(length, sizeof(buffer) - 1);
+        std::memcpy(buffer, value, n);
+        buffer[n] = '\0';
+        return std::strtod(buffer, nullptr);
+    }
+    int integer() const { return static_cast<int>(number()); }
+};
+
+// Lê os pares sem copiar o arquivo; linhas aceitam CRLF e espaços em volta
+class GroupReader {
+public:
+    GroupReader(const uint8_t* data, size_t begin, size_t end)
+        : data_(data), pos_(begin), end_(end) {}
+
+    size_t position() const { return pos_; }
+
+    bool next(Group& group) {
+        const char* code = nullptr;
+        size_t code_length = 0;
+        if (!line(code, code_length)) {
+            return false;
+        }
+        if (!line(group.value, group.length)) {
+            return false;
+        }
+        int value = 0;
+        bool negative = false;
+        size_t i = 0;
+        if (i < code_length && code[i] == '-') {
+            negative = true;
+            ++i;
+        }
+        if (i == code_length) {
+            throw std::runtime_error("Malformed DXF group code near byte " + std::to_string(pos_));
+        }
+        for (; i < code_length; ++i) {
+            if (code[i] < '0' || code[i] > '9') {
+                throw std::runtime_error("Malformed DXF group code near byte " + std::to_string(pos_));
+            }
+            value = value * 10 + (code[i] - '0');
+        }
+        group.code = negative ? -value : value;
+        return true;
+    }
+
+private:
+    const uint8_t* data_;
+    size_t pos_;
+    size_t end_;
+
+    bool line(const char*& text, size_t& length) {
+        if (pos_ >= end_) {
+            return false;
+        }
+        const uint8_t* start = data_ + pos_;
+        const void* newline = std::memchr(start, '\n', end_ - pos_);
+        size_t n = newline ? static_cast<size_t>(static_cast<const uint8_t*>(newline) - start) : end_ - pos_;
+        pos_ += n + (newline ? 1 : 0);
+        while (n > 0 && (start[n - 1] == '\r' || start[n - 1] == ' ' || start[n - 1] == '\t')) --n;
+        size_t skip = 0;
+        while (skip < n && (start[skip] == ' ' || start[skip] == '\t')) ++skip;
+        text = reinterpret_cast<const char*>(start + skip);
+        length = n - skip;
+        return true;
+    }
+};
+
+// Afim 2D: x' = a x + c y + e, y' = b x + d y + f
+struct Transform {
+    double a = 1, b = 0, c = 0, d = 1, e = 0, f = 0;
+
+    PlotPoint apply(const PlotPoint& p) const { return {a * p.x + c * p.y + e, b * p.x + d * p.y + f}; }
+
+    Transform operator*(const Transform& t) const {
+        return {a * t.a + c * t.b, b * t.a + d * t.b, a * t.c + c * t.d, b * t.c + d * t.d,
+                a * t.e + c * t.f + e, b * t.e + d * t.f + f};
+    }
+
+    static Transform translate(double x, double y) { return {1, 0, 0, 1, x, y}; }
+    static Transform scale(double x, double y) { return {x, 0, 0, y, 0, 0}; }
+    static Transform rotate(double degrees) {
+        const double r = degrees * PI / 180.0;
+        return {std::cos(r), std::sin(r), -std::sin(r), std::cos(r), 0, 0};
+    }
+};
+
+int arc_segments(double radius, double sweep, double tolerance) {
+    if (!(radius > tolerance)) {
+        return std::max(1, static_cast<int>(std::ceil(std::fabs(sweep) / (PI / 2))));
+    }
+    const double step = 2.0 * std::acos(1.0 - tolerance / radius);
+    const int n = static_cast<int>(std::ceil(std::fabs(sweep) / step));
+    return std::min(MAX_ARC_SEGMENTS, std::max(1, n));
+}
+
+// Arco de raio rx/ry (elipse alinhada e girada por rotation) em radianos
+void append_arc(std::vector<PlotPoint>& out, const PlotPoint& center, double rx, double ry,
+                double rotation, double start, double sweep, double tolerance) {
+    const int n = arc_segments(std::max(rx, ry), sweep, tolerance);
+    const double cr = std::cos(rotation);
+    const double sr = std::sin(rotation);
+    for (int k = out.empty() ? 0 : 1; k <= n; ++k) {
+        const double t = start + sweep * k / n;
+        const double x = rx * std::cos(t);
+        const double y = ry * std::sin(t);
+        out.push_back({center.x + x * cr - y * sr, center.y + x * sr + y * cr});
+    }
+}
+
+// Trecho p -> q de polilinha com bulge (tangente de 1/4 do ângulo do arco,
+// positivo no sentido anti-horário)
+void append_bulge(std::vector<PlotPoint>& out, const PlotPoint& p, const PlotPoint& q,
+                  double bulge, double tolerance) {
+    const double dx = q.x - p.x;
+    const double dy = q.y - p.y;
+    const double chord = std::hypot(dx, dy);
+    if (std::fabs(bulge) < 1e-9 || chord <= 0.0) {
+        out.push_back(q);
+        return;
+    }
+    const double theta = 4.0 * std::atan(bulge);
+    const double radius = chord / (2.0 * std::fabs(std::sin(theta / 2.0)));
+    const double h = (chord / 2.0) / std::tan(theta / 2.0);
+    const PlotPoint center = {(p.x + q.x) / 2.0 - dy / chord * h, (p.y + q.y) / 2.0 + dx / chord * h};
+    const double start = std::atan2(p.y - center.y, p.x - center.x);
+    append_arc(out, center, radius, radius, 0.0, start, theta, tolerance);
+    out.back() = q;  // Sem erro de arredondamento no vértice
+}
+
+// Fonte de traço: células 4 x 6 (altura de maiúscula), avanço 6. Cada glifo
+// é uma lista de traços separados por '|' com pares de dígitos x y.
+
+const char* glyph(char c) {
+    switch (c) {
+        case 'A': return "002640|1333";
+        case 'B': return "00063645443303|3342413000";
+        case 'C': return "4536160501103041";
+        case 'D': return "00062644422000";
+        case 'E': return "40000646|0333";
+        case 'F': return "000646|0333";
+        case 'G': return "45361605011030414323";
+        case 'H': return "0006|4046|0343";
+        case 'I': return "1030|2026|1636";
+        case 'J': return "4641301001";
+        case 'K': return "0006|4602|1340";
+        case 'L': return "060040";
+        case 'M': return "0006234640";
+        case 'N': return "00064046";
+        case 'O': return "100105163645413010";
+        case 'P': return "00063645443303";
+        case 'Q': return "100105163645413010|2240";
+        case 'R': return "00063645443303|2340";
+        case 'S': return "453616050413334241301001";
+        case 'T': return "0646|2026";
+        case 'U': return "060110304146";
+        case 'V': return "062046";
+        case 'W': return "0610233046";
+        case 'X': return "0046|0640";
+        case 'Y': return "062346|2320";
+        case 'Z': return "06460040";
+        case '0': return "100105163645413010|0145";
+        case '1': return "1426|2020|1030";
+        case '2': return "05163645440040";
+        case '3': return "05163645443313|334241301001";
+        case '4': return "30360242";
+        case '5': return "460604344341301001";
+        case '6': return "4536160501103041423303";
+        case '7': return "064610";
+        case '8': return "13040516364544331302011030414233";
+        case '9': return "0110304145361605041343";
+        case '.': return "2021";
+        case ',': return "2110";
+        case '-': return "1333";
+        case '+': return "1333|2224";
+        case '/': return "0046";
+        case '\\': return "0640";
+        case ':': return "2021|2425";
+        case ';': return "2110|2425";
+        case '(': return "30121436";
+        case ')': return "10323416";
+        case '[': return "30101636";
+        case ']': return "10303616";
+        case '=': return "1232|1434";
+        case '_': return "0040";
+        case '\'': return "2426";
+        case '"': return "1426|3436";
+        case '*': return "1234|1432|0343";
+        case '#': return "1115|3135|0242|0444";
+        case '%': return "0046|0506|4041";
+        case '!': return "2226|2021";
+        case '?': return "05163645442322|2021";
+        case '<': return "450341";
+        case '>': return "054301";
+        default: return nullptr;
+    }
+}
+
+// Texto de uma linha a partir de origin (canto inferior esquerdo), já no
+// sistema do desenho
+void append_text(std::vector<Polyline>& out, const std::string& text, const Transform& placement,
+                 int pen) {
+    double advance = 0.0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const unsigned char ch = static_cast<unsigned char>(text[i]);
+        if (ch >= 0x80) {
+            // Caractere UTF-8 fora da fonte: só o primeiro byte avança
+            if ((ch & 0xC0) != 0x80) advance += 6.0;
+            continue;
+        }
+        const char* strokes = glyph(static_cast<char>(std::toupper(ch)));
+        if (strokes) {
+            Polyline line;
+            line.pen = pen;
+            for (const char* s = strokes; *s; ++s) {
+                if (*s == '|') {
+                    out.push_back(std::move(line));
+                    line = Polyline{};
+                    line.pen = pen;
+                } else if (s[1] && s[1] != '|') {
+                    const PlotPoint local = {advance + (s[0] - '0'), static_cast<double>(s[1] - '0')};
+                    line.points.push_back(placement.apply(local));
+                    ++s;
+                }
+            }
+            out.push_back(std::move(line));
+        }
+        advance += 6.0;
+    }
+}
+
+double text_width(const std::string& text) {
+    size_t glyphs = 0;
+    for (unsigned char ch : text) {
+        if (ch < 0x80 || (ch & 0xC0) != 0x80) ++glyphs;
+    }
+    return glyphs == 0 ? 0.0 : glyphs * 6.0 - 2.0;
+}
+
+// Códigos de controle %%d, %%c, %%p, %%u, %%o do TEXT
+std::string plain_text(const std::string& text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '%' && i + 2 < text.size() && text[i + 1] == '%') {
+            const char code = static_cast<char>(std::tolower(static_cast<unsigned char>(text[i + 2])));
+            if (code == 'd') out += 'o';
+            else if (code == 'p') out += "+-";
+            else if (code == 'c') out += 'O';
+            else if (code == '%') out += '%';
+            i += 2;
+            continue;
+        }
+        out += text[i];
+    }
+    return out;
+}
+
+// MTEXT: \P quebra a linha; demais códigos de formatação e chaves somem
+std::vector<std::string> mtext_lines(const std::string& text) {
+    std::vector<std::string> lines(1);
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char c = text[i];
+        if (c == '{' || c == '}') {
+            continue;
+        }
+        if (c != '\\' || i + 1 >= text.size()) {
+            lines.back() += c;
+            continue;
+        }
+        const char code = text[++i];
+        if (code == 'P') {
+            lines.emplace_back();
+        } else if (code == '\\' || code == '{' || code == '}') {
+            lines.back() += code;
+        } else if (code == '~') {
+            lines.back() += ' ';
+        } else if (std::strchr("LlOoKkNn", code)) {
+            // Liga/desliga sem parâmetro
+        } else {
+            // \f, \H, \W, \C, \A, \Q, \T, \S...: parâmetro até ';'
+            const size_t end = text.find(';', i);
+            if (end == std::string::npos) break;
+            if (code == 'S') {
+                std::string stacked = text.substr(i + 1, end - i - 1);
+                std::replace(stacked.begin(), stacked.end(), '^', '/');
+                std::replace(stacked.begin(), stacked.end(), '#', '/');
+                lines.back() += stacked;
+            }
+            i = end;
+        }
+    }
+    return lines;
+}
+
+struct Layer {
+    int color = ACI_DEFAULT;
+    bool visible = true;
+};
+
+struct BlockRange {
+    std::string name;
+    PlotPoint base = {0.0, 0.0};
+    size_t begin = 0;
+    size_t end = 0;
+};
+
+struct Layout {
+    double unit_mm = 0.0;
+    std::unordered_map<std::string, Layer> layers;
+    std::vector<BlockRange> blocks;
+    std::vector<std::pair<size_t, size_t>> chunks;   // Faixas de ENTITIES
+};
+
+double insunits_mm(int units) {
+    switch (units) {
+        case 1: return 25.4;
+        case 2: return 304.8;
+        case 4: return 1.0;
+        case 5: return 10.0;
+        case 6: return 1000.0;
+        case 8: return 25.4e-6;
+        case 9: return 0.0254;
+        case 10: return 914.4;
+        case 14: return 100.0;
+        default: return 0.0;
+    }
+}
+
+// Entidades que continuam a anterior e não podem abrir uma faixa
+bool continues_entity(const Group& group) {
+    return group.is("VERTEX") || group.is("SEQEND") || group.is("ATTRIB");
+}
+
+Layout scan_layout(const uint8_t* data, size_t size, size_t chunk_entities) {
+    Layout layout;
+    GroupReader reader(data, 0, size);
+    Group group;
+    std::string section;
+    bool expect_section_name = false;
+    bool expect_insunits = false;
+
+    // Registro em curso de LAYER (TABLES) ou cabeçalho de BLOCK
+    bool in_layer = false;
+    std::string layer_name;
+    Layer layer;
+    bool in_block_header = false;
+    BlockRange block;
+
+    size_t entity_count = 0;
+    size_t chunk_begin = 0;
+
+    auto commit_layer = [&] {
+        if (in_layer && !layer_name.empty()) {
+            layout.layers[layer_name] = layer;
+        }
+        in_layer = false;
+    };
+
+    for (;;) {
+        const size_t at = reader.position();
+        if (!reader.next(group)) {
+            break;
+        }
+        if (expect_section_name) {
+            expect_section_name = false;
+            if (group.code == 2) {
+                section = group.text();
+                continue;
+            }
+        }
+        if (group.code == 0) {
+            commit_layer();
+            if (in_block_header) {
+                // Primeira entidade (ou ENDBLK) do bloco
+                in_block_header = false;
+                block.begin = at;
+            }
+            if (group.is("SECTION")) {
+                expect_section_name = true;
+                continue;
+            }
+            if (group.is("ENDSEC")) {
+                if (section == "ENTITIES" && chunk_begin != 0) {
+                    layout.chunks.emplace_back(chunk_begin, at);
+                    chunk_begin = 0;
+                }
+                section.clear();
+                continue;
+            }
+            if (group.is("EOF")) {
+                break;
+            }
+        }
+
+        if (section == "HEADER") {
+            if (group.code == 9) {
+                expect_insunits = group.is("$INSUNITS");
+            } else if (expect_insunits && group.code == 70) {
+                layout.unit_mm = insunits_mm(group.integer());
+                expect_insunits = false;
+            }
+        } else if (section == "TABLES") {
+            if (group.code == 0) {
+                in_layer = group.is("LAYER");
+                layer_name.clear();
+                layer = Layer{};
+            } else if (in_layer) {
+                if (group.code == 2) {
+                    layer_name = group.text();
+                } else if (group.code == 62) {
+                    // Cor negativa: camada desligada
+                    const int color = group.integer();
+                    layer.color = std::abs(color);
+                    layer.visible = layer.visible && color >= 0;
+                } else if (group.code == 70) {
+                    layer.visible = layer.visible && (group.integer() & 1) == 0;
+                } else if (group.code == 290 && group.integer() == 0) {
+                    layer.visible = false;   // Não plotável
+                }
+            }
+        } else if (section == "BLOCKS") {
+            if (group.code == 0 && group.is("BLOCK")) {
+                in_block_header = true;
+                block = BlockRange{};
+            } else if (group.code == 0 && group.is("ENDBLK")) {
+                block.end = at;
+                if (!block.name.empty()) {
+                    layout.blocks.push_back(block);
+                }
+            } else if (in_block_header) {
+                if (group.code == 2) block.name = group.text();
+                else if (group.code == 10) block.base.x = group.number();
+                else if (group.code == 20) block.base.y = group.number();
+            }
+        } else if (section == "ENTITIES" && group.code == 0 && !continues_entity(group)) {
+            if (entity_count % std::max<size_t>(1, chunk_entities) == 0) {
+                if (chunk_begin != 0) {
+                    layout.chunks.emplace_back(chunk_begin, at);
+                }
+                chunk_begin = at;
+            }
+            ++entity_count;
+        }
+    }
+    if (chunk_begin != 0) {
+        layout.chunks.emplace_back(chunk_begin, reader.position());   // Sem ENDSEC
+    }
+    return layout;
+}
+
+struct Insert {
+    std::string block;
+    Transform transform;   // Sem o deslocamento da base do bloco
+    int color = ACI_BYLAYER;
+};
+
+// Resultado de uma faixa: traços com pen = cor ACI (0 = BYBLOCK) em
+// unidades do desenho e INSERTs na posição em que aparecem
+struct Geometry {
+    std::vector<Polyline> strokes;
+    std::vector<std::pair<size_t, Insert>> inserts;
+    size_t entities = 0;
+    size_t skipped = 0;
+    size_t unsupported = 0;
+};
+
+struct Entity {
+    std::string type;
+    bool lightweight = false;   // LWPOLYLINE: 10/20/42 repetidos por vértice
+    bool vertex = false;
+    std::string layer = "0";
+    int color = ACI_BYLAYER;
+    bool invisible = false;
+    std::vector<PlotPoint> points;
+    std::vector<double> bulges;
+    PlotPoint p11 = {0.0, 0.0};
+    bool has_p11 = false;
+    double v40 = 0.0;
+    double v41 = 1.0;
+    double v42 = 1.0;
+    double v50 = 0.0;
+    double v51 = 360.0;
+    int flags70 = 0;
+    int h72 = 0;
+    int v73 = 0;
+    int attach71 = 1;
+    double z230 = 1.0;
+    std::string text;
+    std::string name;
+};
+
+class EntityParser {
+public:
+    EntityParser(const Layout& layout, double tolerance, Geometry& out)
+        : layout_(layout), tolerance_(tolerance), out_(out) {}
+
+    void parse(const uint8_t* data, size_t begin, size_t end) {
+        GroupReader reader(data, begin, end);
+        Group group;
+        while (reader.next(group)) {
+            if (group.code == 0) {
+                finish();
+                entity_ = Entity{};
+                entity_.type = group.text();
+                entity_.lightweight = entity_.type == "LWPOLYLINE";
+                entity_.vertex = entity_.type == "VERTEX";
+                continue;
+            }
+            add(group);
+        }
+        finish();
+        if (polyline_open_) {
+            emit_polyline();
+        }
+    }
+
+private:
+    const Layout& layout_;
+    double tolerance_;
+    Geometry& out_;
+    Entity entity_;
+
+    bool polyline_open_ = false;
+    bool polyline_skip_ = false;
+    Entity polyline_;
+
+    void add(const Group& group) {
+        Entity& e = entity_;
+        switch (group.code) {
+            case 1:   // MTEXT: os pedaços 3 vêm antes do 1 final
+            case 3: e.text += group.text(); break;
+            case 2: e.name = group.text(); break;
+            case 8: e.layer = group.text(); break;
+            case 10:
+                if (e.lightweight || e.points.empty()) {
+                    e.points.push_back({group.number(), 0.0});
+                    e.bulges.push_back(0.0);
+                } else {
+                    e.points[0].x = group.number();
+                }
+                break;
+            case 20:
+                if (!e.points.empty()) e.points.back().y = group.number();
+                break;
+            case 11: e.p11.x = group.number(); e.has_p11 = true; break;
+            case 21: e.p11.y = group.number(); break;
+            case 40: e.v40 = group.number(); break;
+            case 41: e.v41 = group.number(); break;
+            case 42:
+                if (e.lightweight || e.vertex) {
+                    if (!e.bulges.empty()) e.bulges.back() = group.number();
+                } else {
+                    e.v42 = group.number();
+                }
+                break;
+            case 50: e.v50 = group.number(); break;
+            case 51: e.v51 = group.number(); break;
+            case 60: e.invisible = group.integer() == 1; break;
+            case 62: e.color = group.integer(); break;
+            case 70: e.flags70 = group.integer(); break;
+            case 71: e.attach71 = group.integer(); break;
+            case 72: e.h72 = group.integer(); break;
+            case 73: e.v73 = group.integer(); break;
+            case 230: e.z230 = group.number(); break;
+            default: break;
+        }
+    }
+
+    // Cor ACI efetiva, ou -1 se a entidade não aparece
+    int resolve_color(const Entity& e) const {
+        const auto it = layout_.layers.find(e.layer);
+        const Layer layer = it != layout_.layers.end() ? it->second : Layer{};
+        if (!layer.visible || e.invisible || e.color < 0) {
+            return -1;
+        }
+        if (e.color == ACI_BYLAYER || e.color > ACI_BYLAYER) {
+            return layer.color;
+        }
+        return e.color;
+    }
+
+    // Extrusão (0, 0, -1): o eixo x do OCS aponta para -x do desenho
+    static void to_world(const Entity& e, std::vector<PlotPoint>& points) {
+        if (e.z230 < 0.0) {
+            for (auto& p : points) p.x = -p.x;
+        }
+    }
+
+    void add_stroke(std::vector<PlotPoint>&& points, int color) {
+        if (points.empty()) {
+            return;
+        }
+        Polyline line;
+        line.points = std::move(points);
+        line.pen = color;
+        out_.strokes.push_back(std::move(line));
+    }
+
+    void finish() {
+        Entity& e = entity_;
+        if (e.type.empty()) {
+            return;
+        }
+        if (e.type == "VERTEX") {
+            if (polyline_open_ && !e.points.empty() && (e.flags70 & 128) == 0) {
+                polyline_.points.push_back(e.points[0]);
+                polyline_.bulges.push_back(e.bulges.empty() ? 0.0 : e.bulges[0]);
+            }
+            return;
+        }
+        if (e.type == "SEQEND") {
+            if (polyline_open_) emit_polyline();
+            return;
+        }
+        if (polyline_open_) {
+            emit_polyline();   // SEQEND ausente
+        }
+        if (e.type == "POLYLINE") {
+            polyline_open_ = true;
+            polyline_ = e;
+            polyline_.points.clear();
+            polyline_.bulges.clear();
+            // Malhas 3D e polyface ficam de fora
+            polyline_skip_ = (e.flags70 & (16 | 64)) != 0;
+            return;
+        }
+        if (e.type == "ATTDEF" || e.type == "POINT" || e.type == "VIEWPORT") {
+            return;
+        }
+
+        const int color = resolve_color(e);
+        if (color < 0) {
+            ++out_.skipped;
+            return;
+        }
+
+        const PlotPoint p10 = e.points.empty() ? PlotPoint{0.0, 0.0} : e.points[0];
+        std::vector<PlotPoint> points;
+        if (e.type == "LINE") {
+            add_stroke({p10, e.p11}, color);
+        } else if (e.type == "LWPOLYLINE") {
+            polyline_points(e, points);
+            to_world(e, points);
+            add_stroke(std::move(points), color);
+        } else if (e.type == "CIRCLE") {
+            append_arc(points, p10, e.v40, e.v40, 0.0, 0.0, 2.0 * PI, tolerance_);
+            to_world(e, points);
+            add_stroke(std::move(points), color);
+        } else if (e.type == "ARC") {
+            double sweep = e.v51 - e.v50;
+            while (sweep <= 0.0) sweep += 360.0;
+            append_arc(points, p10, e.v40, e.v40, 0.0, e.v50 * PI / 180.0, sweep * PI / 180.0, tolerance_);
+            to_world(e, points);
+            add_stroke(std::move(points), color);
+        } else if (e.type == "ELLIPSE") {
+            // 11/21: extremo do eixo maior relativo ao centro; 40: razão;
+            // 41/42: parâmetros inicial e final em radianos
+            const double major = std::hypot(e.p11.x, e.p11.y);
+            double sweep = e.v42 - e.v41;
+            while (sweep <= 0.0) sweep += 2.0 * PI;
+            append_arc(points, p10, major, major * e.v40, std::atan2(e.p11.y, e.p11.x), e.v41, sweep,
+                       tolerance_);
+            add_stroke(std::move(points), color);
+        } else if (e.type == "TEXT" || e.type == "ATTRIB") {
+            if ((e.flags70 & 1) == 0 || e.type == "TEXT") {
+                text(e, color);
+            }
+        } else if (e.type == "MTEXT") {
+            mtext(e, color);
+        } else if (e.type == "INSERT") {
+            Transform placement = Transform::translate(p10.x, p10.y) * Transform::rotate(e.v50) *
+                                  Transform::scale(e.v41, e.v42);
+            if (e.z230 < 0.0) placement = Transform::scale(-1.0, 1.0) * placement;
+            out_.inserts.emplace_back(out_.strokes.size(), Insert{e.name, placement, color});
+        } else if (e.type == "DIMENSION") {
+            // Geometria já explodida no bloco anônimo, em coordenadas do desenho
+            if (!e.name.empty()) {
+                out_.inserts.emplace_back(out_.strokes.size(), Insert{e.name, Transform{}, color});
+            }
+        } else {
+            ++out_.unsupported;
+            return;
+        }
+        ++out_.entities;
+    }
+
+    void polyline_points(const Entity& e, std::vector<PlotPoint>& points) const {
+        const size_t n = e.points.size();
+        if (n == 0) {
+            return;
+        }
+        const bool closed = (e.flags70 & 1) != 0;
+        points.push_back(e.points[0]);
+        for (size_t i = 0; i + 1 < n; ++i) {
+            append_bulge(points, e.points[i], e.points[i + 1], e.bulges[i], tolerance_);
+        }
+        if (closed && n > 1) {
+            append_bulge(points, e.points[n - 1], e.points[0], e.bulges[n - 1], tolerance_);
+        }
+    }
+
+    void emit_polyline() {
+        polyline_open_ = false;
+        if (polyline_skip_) {
+            ++out_.unsupported;
+            return;
+        }
+        const int color = resolve_color(polyline_);
+        if (color < 0) {
+            ++out_.skipped;
+            return;
+        }
+        std::vector<PlotPoint> points;
+        polyline_points(polyline_, points);
+        to_world(polyline_, points);
+        add_stroke(std::move(points), color);
+        ++out_.entities;
+    }
+
+    void text(const Entity& e, int color) {
+        const std::string value = plain_text(e.text);
+        if (value.empty() || !(e.v40 > 0.0)) {
+            return;
+        }
+        const double scale = e.v40 / 6.0;
+        const double width = text_width(value) * scale * e.v41;
+        // 72: 0 esquerda, 1 centro, 2 direita, 4 meio; alinhado usa 11/21
+        PlotPoint anchor = e.points.empty() ? PlotPoint{0.0, 0.0} : e.points[0];
+        double dx = 0.0;
+        double dy = 0.0;
+        if ((e.h72 != 0 || e.v73 != 0) && e.has_p11) {
+            anchor = e.p11;
+            if (e.h72 == 1 || e.h72 == 4) dx = -width / 2.0;
+            else if (e.h72 == 2) dx = -width;
+            if (e.v73 == 2 || e.h72 == 4) dy = -e.v40 / 2.0;
+            else if (e.v73 == 3) dy = -e.v40;
+        }
+        const Transform placement = Transform::translate(anchor.x, anchor.y) * Transform::rotate(e.v50) *
+                                    Transform::translate(dx, dy) * Transform::scale(scale * e.v41, scale);
+        append_text(out_.strokes, value, placement, color);
+    }
+
+    void mtext(const Entity& e, int color) {
+        if (!(e.v40 > 0.0)) {
+            return;
+        }
+        const std::vector<std::string> lines = mtext_lines(e.text);
+        const double scale = e.v40 / 6.0;
+        const double line_height = e.v40 * 5.0 / 3.0;
+        double widest = 0.0;
+        for (const auto& line : lines) widest = std::max(widest, text_width(line) * scale);
+        const double block_height = e.v40 + line_height * (lines.size() - 1);
+
+        // 71: 1..9 = (topo, meio, base) x (esquerda, centro, direita)
+        const int attach = std::min(9, std::max(1, e.attach71));
+        const int column = (attach - 1) % 3;
+        const int row = (attach - 1) / 3;
+        const double rotation = e.has_p11 ? std::atan2(e.p11.y, e.p11.x) * 180.0 / PI : e.v50;
+        const PlotPoint anchor = e.points.empty() ? PlotPoint{0.0, 0.0} : e.points[0];
+        const double top = row == 0 ? 0.0 : row == 1 ? block_height / 2.0 : block_height;
+
+        for (size_t i = 0; i < lines.size(); ++i) {
+            const double width = text_width(lines[i]) * scale;
+            const double dx = column == 0 ? 0.0 : column == 1 ? -width / 2.0 : -width;
+            const double dy = top - e.v40 - line_height * i;
+            const Transform placement = Transform::translate(anchor.x, anchor.y) * Transform::rotate(rotation) *
+                                        Transform::translate(dx, dy) * Transform::scale(scale, scale);
+            append_text(out_.strokes, lines[i], placement, color);
+        }
+    }
+};
+
+struct Block {
+    PlotPoint base = {0.0, 0.0};
+    Geometry geometry;
+};
+
+class Expander {
+public:
+    Expander(const std::unordered_map<std::string, Block>& blocks, size_t max_points)
+        : blocks_(blocks), max_points_(max_points) {}
+
+    // Traços da faixa com os INSERTs expandidos, em unidades do desenho
+    void expand(const Geometry& geometry, const Transform& transform, int byblock_color, int depth,
+                std::vector<Polyline>& out, size_t& missing) const {
+        size_t next_insert = 0;
+        for (size_t i = 0; i <= geometry.strokes.size(); ++i) {
+            while (next_insert < geometry.inserts.size() && geometry.inserts[next_insert].first == i) {
+                insert(geometry.inserts[next_insert++].second, transform, byblock_color, depth, out, missing);
+            }
+            if (i == geometry.strokes.size()) {
+                break;
+            }
+            const Polyline& stroke = geometry.strokes[i];
+            charge(stroke.points.size());
+            Polyline placed;
+            placed.pen = stroke.pen == ACI_BYBLOCK ? byblock_color : stroke.pen;
+            placed.points.reserve(stroke.points.size());
+            for (const auto& p : stroke.points) {
+                placed.points.push_back(transform.apply(p));
+            }
+            out.push_back(std::move(placed));
+        }
+    }
+
+private:
+    const std::unordered_map<std::string, Block>& blocks_;
+    const size_t max_points_;
+    mutable std::atomic<size_t> used_{0};   // Compartilhado pelas faixas em paralelo
+
+    // Orçamento do desenho inteiro: a profundidade sozinha não limita o
+    // leque (10 INSERTs por nível em 16 níveis); INSERT conta como um ponto
+    // para blocos vazios também esgotarem o orçamento
+    void charge(size_t points) const {
+        if (used_.fetch_add(points, std::memory_order_relaxed) + points > max_points_) {
+            throw std::runtime_error("DXF block expansion exceeds " + std::to_string(max_points_) + " points");
+        }
+    }
+
+    void insert(const Insert& insert, const Transform& parent, int byblock_color, int depth,
+                std::vector<Polyline>& out, size_t& missing) const {
+        const auto it = blocks_.find(insert.block);
+        if (it == blocks_.end() || depth >= MAX_INSERT_DEPTH) {
+            ++missing;
+            return;
+        }
+        charge(1);
+        const Block& block = it->second;
+        const Transform transform = parent * insert.transform *
+                                    Transform::translate(-block.base.x, -block.base.y);
+        const int color = insert.color == ACI_BYBLOCK ? byblock_color : insert.color;
+        expand(block.geometry, transform, color, depth + 1, out, missing);
+    }
+};
+
+// ACI para a paleta padrão HPGL/2 (1 preto, 2 vermelho, 3 verde, 4 amarelo,
+// 5 azul, 6 magenta, 7 ciano); cores sem equivalente vão para a pena 1
+int pen_for_aci(int aci) {
+    switch (aci) {
+        case 1: return 2;
+        case 2: return 4;
+        case 3: return 3;
+        case 4: return 7;
+        case 5: return 5;
+        case 6: return 6;
+        default: return 1;
+    }
+}
+
+template <typename Task>
+void run_parallel(size_t tasks, unsigned threads, const Task& task) {
+    std::atomic<size_t> next{0};
+    std::exception_ptr failure;
+    std::mutex failure_mutex;
+    auto worker = [&] {
+        for (size_t i = next.fetch_add(1); i < tasks; i = next.fetch_add(1)) {
+            try {
+                task(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(failure_mutex);
+                if (!failure) failure = std::current_exception();
+            }
+        }
+    };
+    const unsigned count = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(tasks)));
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < count; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& w : workers) {
+        w.join();
+    }
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+}  // namespace
+
+DxfDrawing read_dxf(const uint8_t* data, size_t size, const DxfReadOptions& options) {
+    static const char BINARY_SENTINEL[] = "AutoCAD Binary DXF";
+    if (size >= sizeof(BINARY_SENTINEL) - 1 &&
+        std::memcmp(data, BINARY_SENTINEL, sizeof(BINARY_SENTINEL) - 1) == 0) {
+        throw std::runtime_error("Binary DXF is not supported");
+    }
+
+    const Layout layout = scan_layout(data, size, options.chunk_entities);
+    const double unit_mm = options.unit_mm > 0.0 ? options.unit_mm
+                         : layout.unit_mm > 0.0 ? layout.unit_mm : 1.0;
+    const double tolerance = options.chord_tolerance_mm / unit_mm;
+    const unsigned threads = options.threads ? options.threads
+                                             : std::max(1u, std::thread::hardware_concurrency());
+
+    // Blocos primeiro (cada um é uma tarefa), depois as faixas de ENTITIES,
+    // que já expandem os INSERTs sobre os blocos prontos
+    std::vector<Block> parsed_blocks(layout.blocks.size());
+    run_parallel(layout.blocks.size(), threads, [&](size_t i) {
+        const BlockRange& range = layout.blocks[i];
+        parsed_blocks[i].base = range.base;
+        if (range.end > range.begin) {
+            EntityParser(layout, tolerance, parsed_blocks[i].geometry).parse(data, range.begin, range.end);
+        }
+    });
+    std::unordered_map<std::string, Block> blocks;
+    for (size_t i = 0; i < layout.blocks.size(); ++i) {
+        blocks[layout.blocks[i].name] = std::move(parsed_blocks[i]);
+    }
+    const Expander expander(blocks, options.max_points);
+
+    struct ChunkResult {
+        std::vector<Polyline> strokes;
+        size_t entities = 0;
+        size_t skipped = 0;
+        size_t unsupported = 0;
+    };
+    std::vector<ChunkResult> chunks(layout.chunks.size());
+    run_parallel(layout.chunks.size(), threads, [&](size_t i) {
+        Geometry geometry;
+        EntityParser(layout, tolerance, geometry).parse(data, layout.chunks[i].first, layout.chunks[i].second);
+        size_t missing = 0;
+        expander.expand(geometry, Transform{}, ACI_DEFAULT, 0, chunks[i].strokes, missing);
+        chunks[i].entities = geometry.entities;
+        chunks[i].skipped = geometry.skipped;
+        chunks[i].unsupported = geometry.unsupported + missing;
+    });
+
+    DxfDrawing drawing;
+    double min_x = HUGE_VAL;
+    double min_y = HUGE_VAL;
+    double max_x = -HUGE_VAL;
+    double max_y = -HUGE_VAL;
+    for (auto& chunk : chunks) {
+        drawing.entities += chunk.entities;
+        drawing.skipped += chunk.skipped;
+        drawing.unsupported += chunk.unsupported;
+        for (auto& stroke : chunk.strokes) {
+            bool finite = true;
+            for (const auto& p : stroke.points) {
+                finite = finite && std::isfinite(p.x) && std::isfinite(p.y);
+            }
+            if (!finite) {
+                continue;
+            }
+            for (const auto& p : stroke.points) {
+                min_x = std::min(min_x, p.x);
+                min_y = std::min(min_y, p.y);
+                max_x = std::max(max_x, p.x);
+                max_y = std::max(max_y, p.y);
+            }
+            drawing.strokes.push_back(std::move(stroke));
+        }
+        chunk.strokes = std::vector<Polyline>();
+    }
+    if (drawing.strokes.empty()) {
+        return drawing;
+    }
+
+    const double scale = unit_mm * PLOTTER_UNITS_PER_MM;
+    for (auto& stroke : drawing.strokes) {
+        stroke.pen = pen_for_aci(stroke.pen);
+        for (auto& p : stroke.points) {
+            p.x = (p.x - min_x) * scale;
+            p.y = (p.y - min_y) * scale;
+        }
+    }
+    drawing.width_mm = (max_x - min_x) * unit_mm;
+    drawing.height_mm = (max_y - min_y) * unit_mm;
+    return drawing;
+}
+
+DxfDrawing read_dxf_file(const std::string& path, const DxfReadOptions& options) {
+    const raster::MappedFile file(path);
+    return read_dxf(file.data(), file.size(), options);
+}
+
+std::vector<uint8_t> dxf_to_hpgl(const DxfDrawing& drawing) {
+    HPGLGenerator generator(true);
+    const std::string begin = "IN;";
+    const std::string end = "PU;SP0;";
+    std::vector<uint8_t> program(begin.begin(), begin.end());
+    const std::vector<uint8_t> strokes = generator.generate_vector_page(drawing.strokes);
+    program.insert(program.end(), strokes.begin(), strokes.end());
+    program.insert(program.end(), end.begin(), end.end());
+    return program;
+}
+
+}  // namespace protocols
+}  // namespace all_press
@@ -1,10 +1,97 @@
 #include "protocols/hpgl_generator.h"
+#include <algorithm>
 #include <sstream>
 #include <cmath>
+#include <memory>
 
 namespace all_press {
 namespace protocols {
 
+namespace {
+
+long long to_fixed(double value, int fraction_bits) {
+    return std::llround(std::ldexp(value, fraction_bits));
+}
+
+// Corpo de uma instrução PE; Emitter fixa a base em tempo de compilação
+template <typename Emitter>
+void emit_polyline_encoded(std::string& out, const std::vector<Polyline>& strokes,
+                           int fraction_bits) {
+    // Posição corrente em unidades fixas, para que o arredondamento
+    // dos deltas relativos não acumule erro
+    long long cur_x = 0;
+    long long cur_y = 0;
+    int current_pen = -1;
+
+    if (fraction_bits > 0) {
+        out += '>';
+        Emitter::append(out, fraction_bits);
+    }
+    // Movimento absoluto (caneta levantada) até a origem, para que os
+    // deltas seguintes não dependam da posição deixada por outro comando
+    out += "<=";
+    Emitter::append(out, 0);
+    Emitter::append(out, 0);
+
+    for (const auto& stroke : strokes) {
+        if (stroke.points.empty()) {
+            continue;
+        }
+        if (stroke.pen != current_pen) {
+            out += ':';
+            Emitter::append(out, stroke.pen);
+            current_pen = stroke.pen;
+        }
+
+        out += '<';  // Primeiro par com a caneta levantada
+        for (const auto& point : stroke.points) {
+            long long x = to_fixed(point.x, fraction_bits);
+            long long y = to_fixed(point.y, fraction_bits);
+            Emitter::append(out, x - cur_x);
+            Emitter::append(out, y - cur_y);
+            cur_x = x;
+            cur_y = y;
+        }
+    }
+}
+
+void emit_ascii(std::string& out, const std::vector<Polyline>& strokes) {
+    int current_pen = -1;
+    for (const auto& stroke : strokes) {
+        if (stroke.points.empty()) {
+            continue;
+        }
+        if (stroke.pen != current_pen) {
+            out += "SP";
+            AsciiCoordinateEmitter::append(out, stroke.pen);
+            out += ';';
+            current_pen = stroke.pen;
+        }
+
+        const auto& start = stroke.points.front();
+        out += "PU";
+        AsciiCoordinateEmitter::append(out, std::llround(start.x));
+        out += ',';
+        AsciiCoordinateEmitter::append(out, std::llround(start.y));
+        out += ';';
+
+        if (stroke.points.size() > 1) {
+            out += "PD";
+            for (size_t i = 1; i < stroke.points.size(); ++i) {
+                if (i > 1) {
+                    out += ',';
+                }
+                AsciiCoordinateEmitter::append(out, std::llround(stroke.points[i].x));
+                out += ',';
+                AsciiCoordinateEmitter::append(out, std::llround(stroke.points[i].y));
+            }
+            out += ';';
+        }
+    }
+}
+
+}  // namespace
+
 HPGLGenerator::HPGLGenerator(bool use_hpgl2) : use_hpgl2_(use_hpgl2) {
     // Carregar capabilities de HP
     capabilities_.vendor = PlotterVendor::HP;
@@ -69,18 +156,209 @@ std::vector<uint8_t> HPGLGenerator::generate_page(
     int height,
     int dpi) {
     
+    const size_t pixels = static_cast<size_t>(std::max(width, 0)) * std::max(height, 0);
+    if (pixels == 0 ||
+        (raster_data.size() != pixels && raster_data.size() != pixels * 3)) {
+        // Não é um raster gray/RGB: dados já no formato do dispositivo
+        return raster_data;
+    }
+    
     std::vector<uint8_t> result;
+    result.reserve(raster_data.size() / 16);
+    append_rtl_raster_begin(result, width, height, dpi);
+    
+    // Raster HP RTL de 1 bit, compressão TIFF PackBits (modo 2), com meio-tom
+    const uint8_t* gray = raster_data.data();
+    if (raster_data.size() != pixels) {
+        std::vector<uint8_t>& buffer = scratch_.gray;
+        buffer.resize(pixels);
+        const size_t stride = static_cast<size_t>(width) * 3;
+        for (int y = 0; y < height; ++y) {
+            rgb_row_to_gray(raster_data.data() + static_cast<size_t>(y) * stride, width,
+                            buffer.data() + static_cast<size_t>(y) * width);
+        }
+        gray = buffer.data();
+    }
     
-    // Converter raster para comandos HPGL
-    // Aqui você processaria os dados raster e geraria
-    // comandos PA (Plot Absolute) e PU/PD (Pen Up/Down)
+    const size_t row_bytes = raster::packed_row_bytes(width);
+    halftone_rows_.resize(row_bytes * height);
+    raster::Halftoner(halftone_).process(gray, width, height, static_cast<size_t>(width),
+                                         halftone_rows_.data());
     
-    // Para simplificar, retornamos os dados brutos com header
-    result.insert(result.end(), raster_data.begin(), raster_data.end());
+    using Encoder = RasterRowEncoder<RasterProtocol::RTL, 1>;
+    Encoder encoder(width, scratch_);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* packed = halftone_rows_.data() + static_cast<size_t>(y) * row_bytes;
+        if (Encoder::packed_is_blank(packed, row_bytes)) {
+            Encoder::Traits::frame_row(result, nullptr, 0);
+            continue;
+        }
+        encoder.encode_packed_row(packed, result);
+    }
+    
+    append_rtl_raster_end(result);
+    return result;
+}
+
+std::vector<uint8_t> HPGLGenerator::generate_raster_page(
+    const raster::TiledRaster& page,
+    int dpi) {
+    
+    std::vector<BandCheckpoint> checkpoints;
+    return generate_raster_page(page, dpi, checkpoints);
+}
+
+std::vector<uint8_t> HPGLGenerator::generate_raster_page(
+    const raster::TiledRaster& page,
+    int dpi,
+    std::vector<BandCheckpoint>& checkpoints) {
+    
+    const int width = page.width();
+    const int height = page.height();
+    const int band_rows = std::max(1, page.tile_size());
+    
+    // Página retomada do início: o raster inteiro é reaberto
+    std::vector<uint8_t> result;
+    checkpoints.push_back(BandCheckpoint{0, width, height, 0});
+    append_rtl_raster_begin(result, width, height, dpi);
+    
+    // O meio-tom trabalha sobre GRAY8; RGB e CMYK são convertidos em paralelo
+    // por faixas para um raster cinza em tiles (tiles sem tinta continuam vazios)
+    const raster::TiledRaster* gray_page = &page;
+    std::unique_ptr<raster::TiledRaster> converted;
+    if (page.format() != raster::PixelFormat::GRAY8) {
+        converted = std::make_unique<raster::TiledRaster>(
+            raster::ColorConverter().convert(page, raster::PixelFormat::GRAY8));
+        gray_page = converted.get();
+    }
+    
+    using Encoder = RasterRowEncoder<RasterProtocol::RTL, 1>;
+    Encoder encoder(width, scratch_);
+    const size_t row_bytes = raster::packed_row_bytes(width);
+    
+    // Linhas sem tinta viram um único deslocamento vertical (ESC*b#Y).
+    // O ponto de retomada de uma faixa fica no próximo comando emitido; se
+    // a faixa começa no meio de um salto, ele aponta para o início do salto.
+    int pending_blank = 0;
+    bool band_open = false;
+    raster::Halftoner(halftone_).process(*gray_page, [&](int y, const uint8_t* packed) {
+        if (y > 0 && y % band_rows == 0) {
+            band_open = true;
+        }
+        if (Encoder::packed_is_blank(packed, row_bytes)) {
+            ++pending_blank;
+            return;
+        }
+        if (band_open) {
+            checkpoints.push_back(BandCheckpoint{y - pending_blank, width, height, result.size()});
+            band_open = false;
+        }
+        if (pending_blank > 0) {
+            append_rtl_skip(result, pending_blank);
+            pending_blank = 0;
+        }
+        encoder.encode_packed_row(packed, result);
+    });
+    if (pending_blank > 0) {
+        if (band_open) {
+            checkpoints.push_back(BandCheckpoint{height - pending_blank, width, height, result.size()});
+        }
+        append_rtl_skip(result, pending_blank);
+    }
+    
+    append_rtl_raster_end(result);
+    return result;
+}
+
+std::vector<uint8_t> HPGLGenerator::generate_resume_prefix(
+    const std::vector<uint8_t>& header,
+    const BandCheckpoint& checkpoint,
+    int dpi) {
     
+    // Header do job (reset, PS, PM, SP, modo HPGL/2) e, no meio da página,
+    // o raster reaberto com a altura restante; na primeira linha da página o
+    // próprio fluxo já abre o raster
+    std::vector<uint8_t> result(header);
+    if (checkpoint.row > 0) {
+        append_rtl_raster_begin(result, checkpoint.page_width,
+                                checkpoint.page_height - checkpoint.row, dpi);
+    }
     return result;
 }
 
+void HPGLGenerator::append_rtl_raster_begin(std::vector<uint8_t>& out,
+                                            int width, int height, int dpi) const {
+    std::string cmd;
+    cmd += "\x1B" "%0A";                              // HPGL/2 -> RTL
+    cmd += "\x1B*t" + std::to_string(dpi) + "R";      // Resolução
+    cmd += "\x1B*r" + std::to_string(width) + "S";    // Largura da fonte
+    cmd += "\x1B*r" + std::to_string(height) + "T";   // Altura da fonte
+    cmd += "\x1B*b2M";                                // TIFF PackBits
+    cmd += "\x1B*r1A";                                // Início do raster
+    out.insert(out.end(), cmd.begin(), cmd.end());
+}
+
+void HPGLGenerator::append_rtl_skip(std::vector<uint8_t>& out, int rows) const {
+    std::string skip = "\x1B*b" + std::to_string(rows) + "Y";
+    out.insert(out.end(), skip.begin(), skip.end());
+}
+
+void HPGLGenerator::append_rtl_raster_end(std::vector<uint8_t>& out) const {
+    std::string cmd;
+    cmd += "\x1B*rC";                                 // Fim do raster
+    if (use_hpgl2_) {
+        cmd += "\x1B" "%0B";                          // RTL -> HPGL/2
+    }
+    out.insert(out.end(), cmd.begin(), cmd.end());
+}
+
+std::vector<uint8_t> HPGLGenerator::generate_vector_page(
+    const std::vector<Polyline>& input_strokes) {
+
+    // Otimizar a ordem dos traços antes da emissão
+    std::vector<Polyline> optimized;
+    const std::vector<Polyline>* source = &input_strokes;
+    if (optimize_strokes_) {
+        optimized = input_strokes;
+        StrokeOptimizer optimizer(stroke_options_);
+        last_stroke_report_ = optimizer.optimize(optimized);
+        source = &optimized;
+    } else {
+        last_stroke_report_ = StrokeOptimizationReport{};
+    }
+    const std::vector<Polyline>& strokes = *source;
+
+    std::string out;
+
+    if (use_polyline_encoding_) {
+        out += "PE";
+        if (pe_seven_bit_) {
+            out += '7';
+            emit_polyline_encoded<PECoordinateEmitter<true>>(out, strokes, pe_fraction_bits_);
+        } else {
+            emit_polyline_encoded<PECoordinateEmitter<false>>(out, strokes, pe_fraction_bits_);
+        }
+        out += ';';
+    } else {
+        emit_ascii(out, strokes);
+    }
+
+    return std::vector<uint8_t>(out.begin(), out.end());
+}
+
+void HPGLGenerator::set_polyline_encoding(bool enabled, int fraction_bits, bool seven_bit) {
+    // PE só existe em HPGL/2
+    use_polyline_encoding_ = enabled && use_hpgl2_;
+    pe_fraction_bits_ = std::max(0, std::min(fraction_bits, 16));
+    pe_seven_bit_ = seven_bit;
+}
+
+void HPGLGenerator::set_stroke_optimization(bool enabled,
+                                            const StrokeOptimizerOptions& options) {
+    optimize_strokes_ = enabled;
+    stroke_options_ = options;
+}
+
 std::vector<uint8_t> HPGLGenerator::generate_footer() {
     std::string footer;
     
@@ -129,6 +407,54 @@ bool HPGLGenerator::needs_preprocessing() const {
     return true;  // HPGL requer conversão de raster
 }
 
+void HPGLGenerator::apply_quirks(const std::map<std::string, std::string>& quirks) {
+    // Cortadoras e alguns plotters de caneta exigem a ordem/sentido original
+    auto order_it = quirks.find("hpgl_preserve_stroke_order");
+    if (order_it != quirks.end() && order_it->second == "true") {
+        optimize_strokes_ = false;
+    }
+    auto reversal_it = quirks.find("hpgl_allow_stroke_reversal");
+    if (reversal_it != quirks.end()) {
+        stroke_options_.allow_reversal = (reversal_it->second == "true");
+    }
+
+    auto halftone_it = quirks.find("hpgl_halftone");
+    if (halftone_it != quirks.end()) {
+        try {
+            halftone_.method = raster::parse_halftone_method(halftone_it->second);
+        } catch (const std::exception&) {
+            // Método desconhecido: mantém o padrão
+        }
+    }
+
+    auto resume_it = quirks.find("rtl_band_resume");
+    band_resume_ = (resume_it != quirks.end() && resume_it->second == "true");
+
+    auto it = quirks.find("hpgl_polyline_encoding");
+    if (it == quirks.end() || it->second != "true") {
+        return;
+    }
+
+    int fraction_bits = 0;
+    auto bits_it = quirks.find("hpgl_pe_fraction_bits");
+    if (bits_it != quirks.end()) {
+        try {
+            fraction_bits = std::stoi(bits_it->second);
+        } catch (const std::exception&) {
+            fraction_bits = 0;
+        }
+    }
+
+    auto seven_bit_it = quirks.find("hpgl_pe_7bit");
+    bool seven_bit = (seven_bit_it != quirks.end() && seven_bit_it->second == "true");
+
+    set_polyline_encoding(true, fraction_bits, seven_bit);
+}
+
+void HPGLGenerator::prepare_for_reuse() {
+    last_stroke_report_ = StrokeOptimizationReport{};
+}
+
 }  // namespace protocols
 }  // namespace all_press
 
@@ -0,0 +1,828 @@
+#include "protocols/hpgl_interpreter.h"
+#include "protocols/hpgl_lexer.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace all_press {
+namespace protocols {
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr size_t READ_CHUNK = 256 * 1024;
+
+// Paleta padrão do HPGL/2: 0 branco, 1 preto, 2 vermelho, 3 verde,
+// 4 amarelo, 5 azul, 6 magenta, 7 ciano; penas acima de 7 repetem 1-7
+std::array<uint8_t, 3> default_color(int pen) {
+    static const std::array<uint8_t, 3> PALETTE[8] = {
+        {{255, 255, 255}}, {{0, 0, 0}},   {{255, 0, 0}},   {{0, 255, 0}},
+        {{255, 255, 0}},   {{0, 0, 255}}, {{255, 0, 255}}, {{0, 255, 255}}};
+    if (pen <= 0) {
+        return PALETTE[0];
+    }
+    return PALETTE[1 + (pen - 1) % 7];
+}
+
+// Mnemônicos válidos que não mudam o desenho
+bool is_ignored_mnemonic(char a, char b) {
+    static const char* const IGNORED[] = {
+        "BP", "PS", "QL", "MC", "PP", "NP", "LA", "SV", "TR", "TD", "SD", "SS", "SA", "SI",
+        "SL", "SR", "DI", "DR", "CP", "ES", "LO", "FI", "FN", "CF", "AC", "UL", "IW", "IR",
+        "NR", "PT", "VS", "TL", "XT", "YT", "AD", "SM", "CT", "MT", "RP", "SB", "BL", "CO",
+        "DV", "OP", "OE", "OI", "OS", "OH", "OW", "OA", "OC", "OD", "OF", "OG", "OO", "EC",
+        "MG", "RF", "BR", "BZ", "PG", "AF", "AH", "FR"};
+    for (const char* mnemonic : IGNORED) {
+        if (mnemonic[0] == a && mnemonic[1] == b) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::array<uint8_t, 4> device_color(const std::array<uint8_t, 3>& rgb, raster::PixelFormat format) {
+    switch (format) {
+        case raster::PixelFormat::GRAY8:
+            return {{static_cast<uint8_t>((rgb[0] * 77 + rgb[1] * 150 + rgb[2] * 29 + 128) >> 8), 0, 0, 0}};
+        case raster::PixelFormat::CMYK8: {
+            const uint8_t k = static_cast<uint8_t>(255 - std::max({rgb[0], rgb[1], rgb[2]}));
+            return {{static_cast<uint8_t>(255 - rgb[0] - k), static_cast<uint8_t>(255 - rgb[1] - k),
+                     static_cast<uint8_t>(255 - rgb[2] - k), k}};
+        }
+        case raster::PixelFormat::RGB8:
+        default:
+            return {{rgb[0], rgb[1], rgb[2], 0}};
+    }
+}
+
+// Número em texto PDF: até 3 casas, sem zeros à direita
+void append_number(std::string& out, double value) {
+    char buffer[32];
+    int n = std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+    while (n > 0 && buffer[n - 1] == '0') --n;
+    if (n > 0 && buffer[n - 1] == '.') --n;
+    if (n == 2 && buffer[0] == '-' && buffer[1] == '0') {
+        buffer[0] = '0';
+        n = 1;
+    }
+    out.append(buffer, n);
+    out += ' ';
+}
+
+void append_color(std::string& out, const std::array<uint8_t, 3>& rgb, const char* op) {
+    for (uint8_t c : rgb) {
+        append_number(out, c / 255.0);
+    }
+    out += op;
+    out += '\n';
+}
+
+}  // namespace
+
+bool HpglDisplayList::has_color() const {
+    for (const auto& shape : shapes) {
+        if (shape.rgb[0] != shape.rgb[1] || shape.rgb[1] != shape.rgb[2]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void HpglDisplayList::update_bounds() {
+    bool first = true;
+    for (const auto& shape : shapes) {
+        const double half = shape.fill ? 0.0 : shape.width_mm * PLOTTER_UNITS_PER_MM * 0.5;
+        for (const auto& path : shape.paths) {
+            for (const auto& p : path) {
+                if (first) {
+                    min_x = p.x - half;
+                    max_x = p.x + half;
+                    min_y = p.y - half;
+                    max_y = p.y + half;
+                    first = false;
+                }
+                min_x = std::min(min_x, p.x - half);
+                max_x = std::max(max_x, p.x + half);
+                min_y = std::min(min_y, p.y - half);
+                max_y = std::max(max_y, p.y + half);
+            }
+        }
+    }
+}
+
+std::vector<Polyline> pen_strokes(const HpglDisplayList& list) {
+    // Pena da paleta padrão mais próxima de cada cor; só o quase branco
+    // (papel) fica de fora, tons claros vão para a pena do matiz
+    constexpr int PAPER_LEVEL = 245;
+    auto nearest_pen = [](const std::array<uint8_t, 3>& rgb) {
+        if (rgb[0] >= PAPER_LEVEL && rgb[1] >= PAPER_LEVEL && rgb[2] >= PAPER_LEVEL) {
+            return 0;
+        }
+        int best = 1;
+        int best_distance = -1;
+        for (int pen = 1; pen <= 7; ++pen) {
+            const auto color = default_color(pen);
+            int distance = 0;
+            for (int c = 0; c < 3; ++c) {
+                const int d = static_cast<int>(rgb[c]) - color[c];
+                distance += d * d;
+            }
+            if (best_distance < 0 || distance < best_distance) {
+                best = pen;
+                best_distance = distance;
+            }
+        }
+        return best;
+    };
+
+    std::vector<Polyline> strokes;
+    for (const auto& shape : list.shapes) {
+        const int pen = nearest_pen(shape.rgb);
+        if (pen == 0) {
+            continue;
+        }
+        for (const auto& path : shape.paths) {
+            if (path.empty()) {
+                continue;
+            }
+            Polyline line;
+            line.pen = pen;
+            line.points = path;
+            if (shape.fill && path.size() > 2 &&
+                (path.front().x != path.back().x || path.front().y != path.back().y)) {
+                line.points.push_back(path.front());   // Contorno fechado
+            }
+            strokes.push_back(std::move(line));
+        }
+    }
+    return strokes;
+}
+
+HpglInterpreter::HpglInterpreter() {
+    reset();
+}
+
+void HpglInterpreter::feed(const uint8_t* data, size_t size) {
+    pending_.insert(pending_.end(), data, data + size);
+    const size_t consumed = parse(pending_.data(), pending_.size(), false);
+    pending_.erase(pending_.begin(), pending_.begin() + consumed);
+}
+
+HpglDisplayList HpglInterpreter::finish() {
+    parse(pending_.data(), pending_.size(), true);
+    pending_.clear();
+    flush_stroke();
+
+    HpglDisplayList result = std::move(list_);
+    result.update_bounds();
+
+    list_ = HpglDisplayList{};
+    label_terminator_ = hpgl::ETX;
+    pen_ = 1;
+    reset();
+    return result;
+}
+
+size_t HpglInterpreter::parse(const uint8_t* data, size_t size, bool final) {
+    size_t i = 0;
+    while (i < size) {
+        const size_t start = i;
+        const uint8_t c = data[i];
+
+        if (c == hpgl::ESC) {
+            const size_t next = hpgl::skip_escape(data, size, i);
+            if (next >= size && !final) {
+                return start;
+            }
+            i = next;
+            continue;
+        }
+        if (!std::isalpha(c)) {
+            ++i;
+            continue;
+        }
+        if (i + 1 >= size) {
+            if (!final) {
+                return start;
+            }
+            break;
+        }
+        if (!std::isalpha(data[i + 1])) {
+            ++i;
+            continue;
+        }
+
+        const char a = static_cast<char>(std::toupper(c));
+        const char b = static_cast<char>(std::toupper(data[i + 1]));
+        i += 2;
+
+        if (a == 'L' && b == 'B') {
+            // Sem fontes: o texto é pulado
+            const uint8_t* end = std::find(data + i, data + size, label_terminator_);
+            if (end == data + size && !final) {
+                return start;
+            }
+            i = static_cast<size_t>(end - data) + 1;
+            ++list_.commands;
+            ++list_.unsupported;
+            continue;
+        }
+        if (a == 'D' && b == 'T') {
+            if (i >= size && !final) {
+                return start;
+            }
+            label_terminator_ = (i < size && data[i] != ';') ? data[i++] : hpgl::ETX;
+            ++list_.commands;
+            continue;
+        }
+        if (a == 'P' && b == 'E') {
+            size_t end = i;
+            while (end < size && data[end] != ';' && data[end] != hpgl::ESC) ++end;
+            if (end >= size && !final) {
+                return start;
+            }
+            polyline_encoded(data, end, i);
+            i = end;
+            ++list_.commands;
+            continue;
+        }
+
+        size_t j = i;
+        const auto params = hpgl::parse_parameters(data, size, j);
+        if (j >= size && !final) {
+            return start;
+        }
+        i = j;
+        ++list_.commands;
+        execute(a, b, params);
+    }
+    return std::min(i, size);
+}
+
+void HpglInterpreter::execute(char a, char b, const std::vector<double>& params) {
+    const size_t pairs = params.size() / 2;
+    auto param = [&](size_t k, double fallback) { return k < params.size() ? params[k] : fallback; };
+
+    if (a == 'P' && (b == 'U' || b == 'D' || b == 'A' || b == 'R')) {
+        if (b == 'U' || b == 'D') {
+            if (b == 'U') {
+                flush_stroke();
+            }
+            pen_down_ = b == 'D';
+        } else {
+            absolute_ = b == 'A';
+        }
+        for (size_t k = 0; k < pairs; ++k) {
+            if (absolute_) {
+                const PlotPoint p = to_plotter(params[2 * k], params[2 * k + 1]);
+                move_to(p.x, p.y);
+            } else {
+                move_to(x_ + params[2 * k] * scale_x_, y_ + params[2 * k + 1] * scale_y_);
+            }
+        }
+    } else if (a == 'S' && b == 'P') {
+        flush_stroke();
+        pen_ = static_cast<int>(param(0, 0));
+    } else if (a == 'P' && b == 'W') {
+        flush_stroke();
+        double width = param(0, 0.35);
+        if (relative_width_) {
+            width = width / 100.0 * std::hypot(p2_.x - p1_.x, p2_.y - p1_.y) / PLOTTER_UNITS_PER_MM;
+        }
+        if (params.size() >= 2) {
+            pen(static_cast<int>(params[1])).width_mm = width;
+        } else {
+            default_width_mm_ = width;
+            for (auto& entry : pens_) entry.second.width_mm = width;
+        }
+    } else if (a == 'P' && b == 'C') {
+        flush_stroke();
+        if (params.empty()) {
+            for (auto& entry : pens_) entry.second.rgb = default_color(entry.first);
+        } else if (params.size() < 4) {
+            pen(static_cast<int>(params[0])).rgb = default_color(static_cast<int>(params[0]));
+        } else {
+            auto& target = pen(static_cast<int>(params[0])).rgb;
+            for (int k = 0; k < 3; ++k) {
+                const double black = color_range_[2 * k];
+                const double white = color_range_[2 * k + 1];
+                const double t = white != black ? (params[1 + k] - black) / (white - black) : 0.0;
+                target[k] = static_cast<uint8_t>(std::min(1.0, std::max(0.0, t)) * 255.0 + 0.5);
+            }
+        }
+    } else if (a == 'C' && b == 'R') {
+        if (params.size() >= 6) {
+            std::copy(params.begin(), params.begin() + 6, color_range_.begin());
+        } else {
+            color_range_ = {0, 255, 0, 255, 0, 255};
+        }
+    } else if (a == 'W' && b == 'U') {
+        relative_width_ = param(0, 0) == 1;
+    } else if (a == 'I' && b == 'N') {
+        flush_stroke();
+        reset();
+    } else if (a == 'D' && b == 'F') {
+        flush_stroke();
+        scaling_.clear();
+        update_scaling();
+        absolute_ = true;
+        polygon_mode_ = false;
+        polygon_.clear();
+        label_terminator_ = hpgl::ETX;
+    } else if (a == 'I' && b == 'P') {
+        const PlotPoint size = {p2_.x - p1_.x, p2_.y - p1_.y};
+        if (params.size() >= 4) {
+            p1_ = {params[0], params[1]};
+            p2_ = {params[2], params[3]};
+        } else if (params.size() >= 2) {
+            p1_ = {params[0], params[1]};
+            p2_ = {p1_.x + size.x, p1_.y + size.y};
+        } else {
+            p1_ = {0.0, 0.0};
+            p2_ = {10160.0, 7840.0};
+        }
+        update_scaling();
+    } else if (a == 'S' && b == 'C') {
+        scaling_ = params;
+        update_scaling();
+    } else if (a == 'C' && b == 'I' && !params.empty()) {
+        // Círculo em volta da posição atual, sempre com a caneta abaixada
+        flush_stroke();
+        auto circle = arc_points(x_, y_, std::fabs(params[0] * scale_x_), 0.0, 360.0, param(1, 5.0));
+        if (polygon_mode_) {
+            polygon_.push_back(std::move(circle));
+            polygon_.push_back({PlotPoint{x_, y_}});
+        } else {
+            add_stroke(std::move(circle));
+        }
+    } else if (a == 'A' && (b == 'A' || b == 'R') && params.size() >= 3) {
+        double cx = params[0];
+        double cy = params[1];
+        if (b == 'A') {
+            const PlotPoint center = to_plotter(cx, cy);
+            cx = center.x;
+            cy = center.y;
+        } else {
+            cx = x_ + cx * scale_x_;
+            cy = y_ + cy * scale_y_;
+        }
+        const double radius = std::hypot(x_ - cx, y_ - cy);
+        const double start = std::atan2(y_ - cy, x_ - cx) * 180.0 / PI;
+        for (const auto& p : arc_points(cx, cy, radius, start, params[2], param(3, 5.0))) {
+            move_to(p.x, p.y);
+        }
+    } else if ((a == 'E' || a == 'R') && (b == 'A' || b == 'R') && pairs >= 1) {
+        PlotPoint corner = b == 'A' ? to_plotter(params[0], params[1])
+                                    : PlotPoint{x_ + params[0] * scale_x_, y_ + params[1] * scale_y_};
+        std::vector<PlotPoint> rect = {{x_, y_}, {corner.x, y_}, {corner.x, corner.y}, {x_, corner.y}};
+        flush_stroke();
+        if (a == 'E') {
+            rect.push_back(rect.front());
+            add_stroke(std::move(rect));
+        } else {
+            add_fill({std::move(rect)}, false);
+        }
+    } else if ((a == 'E' && b == 'W') || (a == 'W' && b == 'G')) {
+        if (params.size() >= 3) {
+            flush_stroke();
+            auto wedge = arc_points(x_, y_, std::fabs(params[0] * scale_x_), params[1], params[2],
+                                    param(3, 5.0));
+            wedge.insert(wedge.begin(), PlotPoint{x_, y_});
+            if (a == 'E') {
+                wedge.push_back(wedge.front());
+                add_stroke(std::move(wedge));
+            } else {
+                add_fill({std::move(wedge)}, false);
+            }
+        }
+    } else if (a == 'P' && b == 'M') {
+        // PM0 abre o buffer de polígono, PM1 fecha o subpolígono, PM2 sai
+        flush_stroke();
+        const int mode = static_cast<int>(param(0, 0));
+        if (mode == 0) {
+            polygon_mode_ = true;
+            polygon_.assign(1, {PlotPoint{x_, y_}});
+        } else if (mode == 1 && polygon_mode_) {
+            polygon_.push_back({PlotPoint{x_, y_}});
+        } else if (mode == 2) {
+            polygon_mode_ = false;
+        }
+    } else if (a == 'F' && b == 'P') {
+        add_fill(polygon_, param(0, 0) == 0);
+    } else if (a == 'E' && b == 'P') {
+        for (auto contour : polygon_) {
+            if (contour.size() >= 2) {
+                contour.push_back(contour.front());
+                add_stroke(std::move(contour));
+            }
+        }
+    } else if (a == 'L' && b == 'T') {
+        list_.unsupported += params.empty() ? 0 : 1;       // Tracejado sai contínuo
+    } else if (a == 'F' && b == 'T') {
+        list_.unsupported += param(0, 1) > 2 ? 1 : 0;      // Hachura sai sólida
+    } else if (a == 'R' && b == 'O') {
+        list_.unsupported += param(0, 0) != 0 ? 1 : 0;
+    } else if (!is_ignored_mnemonic(a, b)) {
+        ++list_.unknown;
+    }
+}
+
+void HpglInterpreter::polyline_encoded(const uint8_t* data, size_t size, size_t i) {
+    bool seven_bit = false;
+    bool pen_up_next = false;
+    bool absolute_next = false;
+    int fraction_bits = 0;
+    bool have_x = false;
+    long long first = 0;
+
+    while (i < size) {
+        const uint8_t c = data[i];
+        long long value = 0;
+        if (c == ':' || c == '>') {
+            ++i;
+            if (!hpgl::decode_pe_number(data, size, i, seven_bit, value)) {
+                break;
+            }
+            if (c == ':') {
+                flush_stroke();
+                pen_ = static_cast<int>(value);
+            } else {
+                fraction_bits = static_cast<int>(std::max(0LL, std::min(value, 26LL)));
+            }
+        } else if (c == '<') {
+            pen_up_next = true;
+            ++i;
+        } else if (c == '=') {
+            absolute_next = true;
+            ++i;
+        } else if (c == '7') {
+            seven_bit = true;
+            ++i;
+        } else if (c >= 63) {
+            if (!hpgl::decode_pe_number(data, size, i, seven_bit, value)) {
+                break;
+            }
+            if (!have_x) {
+                first = value;
+                have_x = true;
+                continue;
+            }
+            have_x = false;
+            const double dx = std::ldexp(static_cast<double>(first), -fraction_bits);
+            const double dy = std::ldexp(static_cast<double>(value), -fraction_bits);
+            if (pen_up_next) {
+                flush_stroke();
+            }
+            pen_down_ = !pen_up_next;
+            if (absolute_next) {
+                const PlotPoint p = to_plotter(dx, dy);
+                move_to(p.x, p.y);
+            } else {
+                move_to(x_ + dx * scale_x_, y_ + dy * scale_y_);
+            }
+            pen_up_next = false;
+            absolute_next = false;
+        } else {
+            ++i;
+        }
+    }
+}
+
+void HpglInterpreter::reset() {
+    x_ = 0.0;
+    y_ = 0.0;
+    pen_down_ = false;
+    absolute_ = true;
+    pens_.clear();
+    default_width_mm_ = 0.35;
+    relative_width_ = false;
+    color_range_ = {0, 255, 0, 255, 0, 255};
+    label_terminator_ = hpgl::ETX;
+    p1_ = {0.0, 0.0};
+    p2_ = {10160.0, 7840.0};
+    scaling_.clear();
+    update_scaling();
+    stroke_.clear();
+    polygon_mode_ = false;
+    polygon_.clear();
+}
+
+// SC tipo 0 (anisotrópico), 1 (isotrópico, centralizado por left/bottom %)
+// e 2 (fator por unidade), relativos a P1/P2
+void HpglInterpreter::update_scaling() {
+    scaled_ = false;
+    scale_x_ = 1.0;
+    scale_y_ = 1.0;
+    offset_x_ = 0.0;
+    offset_y_ = 0.0;
+    if (scaling_.size() < 4) {
+        return;
+    }
+    const int type = scaling_.size() >= 5 ? static_cast<int>(scaling_[4]) : 0;
+    const double span_x = p2_.x - p1_.x;
+    const double span_y = p2_.y - p1_.y;
+
+    if (type == 2) {
+        scale_x_ = scaling_[1];
+        scale_y_ = scaling_[3];
+        offset_x_ = p1_.x - scaling_[0] * scale_x_;
+        offset_y_ = p1_.y - scaling_[2] * scale_y_;
+        scaled_ = true;
+        return;
+    }
+
+    const double user_x = scaling_[1] - scaling_[0];
+    const double user_y = scaling_[3] - scaling_[2];
+    if (user_x == 0.0 || user_y == 0.0) {
+        return;
+    }
+    scale_x_ = span_x / user_x;
+    scale_y_ = span_y / user_y;
+    offset_x_ = p1_.x - scaling_[0] * scale_x_;
+    offset_y_ = p1_.y - scaling_[2] * scale_y_;
+
+    if (type == 1) {
+        const double s = std::min(std::fabs(scale_x_), std::fabs(scale_y_));
+        const double left = scaling_.size() >= 6 ? scaling_[5] : 50.0;
+        const double bottom = scaling_.size() >= 7 ? scaling_[6] : 50.0;
+        const double sx = std::copysign(s, scale_x_);
+        const double sy = std::copysign(s, scale_y_);
+        offset_x_ = p1_.x + (span_x - user_x * sx) * left / 100.0 - scaling_[0] * sx;
+        offset_y_ = p1_.y + (span_y - user_y * sy) * bottom / 100.0 - scaling_[2] * sy;
+        scale_x_ = sx;
+        scale_y_ = sy;
+    }
+    scaled_ = true;
+}
+
+HpglInterpreter::Pen& HpglInterpreter::pen(int number) {
+    auto it = pens_.find(number);
+    if (it == pens_.end()) {
+        it = pens_.emplace(number, Pen{default_width_mm_, default_color(number)}).first;
+    }
+    return it->second;
+}
+
+PlotPoint HpglInterpreter::to_plotter(double ux, double uy) const {
+    if (!scaled_) {
+        return PlotPoint{ux, uy};
+    }
+    return PlotPoint{offset_x_ + ux * scale_x_, offset_y_ + uy * scale_y_};
+}
+
+void HpglInterpreter::move_to(double px, double py) {
+    if (polygon_mode_) {
+        // Movimentos com a caneta levantada também definem o polígono
+        polygon_.back().push_back(PlotPoint{px, py});
+    } else if (pen_down_) {
+        if (stroke_.empty()) {
+            stroke_.push_back(PlotPoint{x_, y_});
+        }
+        stroke_.push_back(PlotPoint{px, py});
+    }
+    x_ = px;
+    y_ = py;
+}
+
+void HpglInterpreter::flush_stroke() {
+    if (stroke_.size() >= 2) {
+        add_stroke(std::move(stroke_));
+    }
+    stroke_.clear();
+}
+
+// Pena 0 não tem tinta
+void HpglInterpreter::add_stroke(std::vector<PlotPoint> points) {
+    if (pen_ <= 0 || points.empty()) {
+        return;
+    }
+    const Pen& current = pen(pen_);
+    HpglShape shape;
+    shape.paths.push_back(std::move(points));
+    shape.width_mm = current.width_mm;
+    shape.rgb = current.rgb;
+    list_.shapes.push_back(std::move(shape));
+}
+
+void HpglInterpreter::add_fill(std::vector<std::vector<PlotPoint>> contours, bool even_odd) {
+    contours.erase(std::remove_if(contours.begin(), contours.end(),
+                                  [](const std::vector<PlotPoint>& c) { return c.size() < 3; }),
+                   contours.end());
+    if (pen_ <= 0 || contours.empty()) {
+        return;
+    }
+    HpglShape shape;
+    shape.fill = true;
+    shape.even_odd = even_odd;
+    shape.paths = std::move(contours);
+    shape.rgb = pen(pen_).rgb;
+    list_.shapes.push_back(std::move(shape));
+}
+
+// Pontos do arco, incluindo o inicial, com passo de no máximo chord graus
+std::vector<PlotPoint> HpglInterpreter::arc_points(double cx, double cy, double radius, double start_deg,
+                                                   double sweep_deg, double chord_deg) const {
+    const double chord = std::min(180.0, std::max(0.5, std::fabs(chord_deg)));
+    const int steps = std::max(1, static_cast<int>(std::ceil(std::fabs(sweep_deg) / chord)));
+    std::vector<PlotPoint> points;
+    points.reserve(steps + 1);
+    for (int k = 0; k <= steps; ++k) {
+        const double angle = (start_deg + sweep_deg * k / steps) * PI / 180.0;
+        points.push_back(PlotPoint{cx + radius * std::cos(angle), cy + radius * std::sin(angle)});
+    }
+    return points;
+}
+
+HpglDisplayList parse_hpgl(const uint8_t* data, size_t size) {
+    HpglInterpreter interpreter;
+    interpreter.feed(data, size);
+    return interpreter.finish();
+}
+
+HpglDisplayList parse_hpgl_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open HPGL file: " + path);
+    }
+    HpglInterpreter interpreter;
+    std::vector<uint8_t> chunk(READ_CHUNK);
+    while (file) {
+        file.read(reinterpret_cast<char*>(chunk.data()), chunk.size());
+        const std::streamsize n = file.gcount();
+        if (n <= 0) {
+            break;
+        }
+        interpreter.feed(chunk.data(), static_cast<size_t>(n));
+    }
+    return interpreter.finish();
+}
+
+raster::TiledRaster render_hpgl(const HpglDisplayList& list, const HpglRenderOptions& options) {
+    if (list.empty()) {
+        throw std::invalid_argument("HPGL drawing is empty");
+    }
+
+    const double min_x = options.include_origin ? std::min(0.0, list.min_x) : list.min_x;
+    const double min_y = options.include_origin ? std::min(0.0, list.min_y) : list.min_y;
+    const double width_mm = (list.max_x - min_x) / PLOTTER_UNITS_PER_MM + 2.0 * options.margin_mm;
+    const double height_mm = (list.max_y - min_y) / PLOTTER_UNITS_PER_MM + 2.0 * options.margin_mm;
+
+    double dpi = options.dpi;
+    if (options.fit_width > 0 && options.fit_height > 0) {
+        dpi = std::min(options.fit_width / std::max(width_mm / 25.4, 1e-6),
+                       options.fit_height / std::max(height_mm / 25.4, 1e-6));
+    }
+    if (!(dpi > 0.0)) {
+        throw std::invalid_argument("Invalid HPGL render resolution");
+    }
+    const double px_per_mm = dpi / 25.4;
+    const double scale = px_per_mm / PLOTTER_UNITS_PER_MM;
+    const double margin = options.margin_mm * px_per_mm;
+    int width = std::max(1, static_cast<int>(std::ceil(width_mm * px_per_mm)));
+    int height = std::max(1, static_cast<int>(std::ceil(height_mm * px_per_mm)));
+    if (options.fit_width > 0 && options.fit_height > 0) {
+        width = std::min(width, options.fit_width);
+        height = std::min(height, options.fit_height);
+    }
+
+    auto to_pixels = [&](const PlotPoint& p) {
+        return raster::FillPoint{(p.x - min_x) * scale + margin, (list.max_y - p.y) * scale + margin};
+    };
+
+    std::vector<raster::FillPath> paths;
+    paths.reserve(list.shapes.size());
+    std::vector<raster::FillPoint> points;
+    bool merging = false;
+    for (const auto& shape : list.shapes) {
+        const auto color = device_color(shape.rgb, options.format);
+        if (shape.fill) {
+            raster::FillPath path;
+            path.color = color;
+            path.rule = shape.even_odd ? raster::FillRule::EVEN_ODD : raster::FillRule::NON_ZERO;
+            for (const auto& contour : shape.paths) {
+                path.contours.emplace_back();
+                for (const auto& p : contour) path.contours.back().push_back(to_pixels(p));
+            }
+            paths.push_back(std::move(path));
+            merging = false;
+            continue;
+        }
+        // Traços seguidos da mesma cor viram um só path: os contornos têm a
+        // mesma orientação, então NON_ZERO dá a união e a varredura trata
+        // milhares de polilinhas como um conjunto de arestas
+        if (!merging || paths.back().color != color) {
+            raster::FillPath path;
+            path.color = color;
+            paths.push_back(std::move(path));
+            merging = true;
+        }
+        const double width_px = std::max(shape.width_mm * px_per_mm, options.min_stroke_px);
+        for (const auto& polyline : shape.paths) {
+            points.clear();
+            for (const auto& p : polyline) points.push_back(to_pixels(p));
+            raster::stroke_polyline(points, width_px, paths.back().contours);
+        }
+    }
+
+    return raster::fill_paths(paths, width, height, options.format, options.raster);
+}
+
+void write_hpgl_pdf(const HpglDisplayList& list, const std::string& path, double margin_mm) {
+    if (list.empty()) {
+        throw std::invalid_argument("HPGL drawing is empty");
+    }
+
+    // Coordenadas em unidades de plotter; a matriz cm leva a pontos
+    const double pt_per_unit = 72.0 / 25.4 / PLOTTER_UNITS_PER_MM;
+    const double margin_pt = margin_mm * 72.0 / 25.4;
+    const double page_w = (list.max_x - list.min_x) * pt_per_unit + 2.0 * margin_pt;
+    const double page_h = (list.max_y - list.min_y) * pt_per_unit + 2.0 * margin_pt;
+
+    std::string content = "q\n";
+    append_number(content, pt_per_unit);
+    content += "0 0 ";
+    append_number(content, pt_per_unit);
+    append_number(content, margin_pt - list.min_x * pt_per_unit);
+    append_number(content, margin_pt - list.min_y * pt_per_unit);
+    content += "cm\n1 J 1 j\n";
+
+    std::array<int, 3> stroke_color = {-1, -1, -1};
+    std::array<int, 3> fill_color = {-1, -1, -1};
+    double line_width = -1.0;
+    for (const auto& shape : list.shapes) {
+        const std::array<int, 3> rgb = {shape.rgb[0], shape.rgb[1], shape.rgb[2]};
+        if (shape.fill) {
+            if (rgb != fill_color) {
+                append_color(content, shape.rgb, "rg");
+                fill_color = rgb;
+            }
+        } else {
+            if (rgb != stroke_color) {
+                append_color(content, shape.rgb, "RG");
+                stroke_color = rgb;
+            }
+            const double width = shape.width_mm * PLOTTER_UNITS_PER_MM;
+            if (width != line_width) {
+                append_number(content, width);
+                content += "w\n";
+                line_width = width;
+            }
+        }
+        for (const auto& contour : shape.paths) {
+            for (size_t k = 0; k < contour.size(); ++k) {
+                append_number(content, contour[k].x);
+                append_number(content, contour[k].y);
+                content += k == 0 ? "m\n" : "l\n";
+            }
+            if (contour.size() == 1) {
+                // Ponto isolado: segmento nulo com ponta redonda
+                append_number(content, contour[0].x);
+                append_number(content, contour[0].y);
+                content += "l\n";
+            }
+            if (shape.fill) {
+                content += "h\n";
+            }
+        }
+        content += shape.fill ? (shape.even_odd ? "f*\n" : "f\n") : "S\n";
+    }
+    content += "Q\n";
+
+    std::string pdf = "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n";
+    std::vector<size_t> offsets;
+    auto object = [&](const std::string& body) {
+        offsets.push_back(pdf.size());
+        pdf += std::to_string(offsets.size()) + " 0 obj\n" + body + "\nendobj\n";
+    };
+    object("<< /Type /Catalog /Pages 2 0 R >>");
+    object("<< /Type /Pages /Kids [3 0 R] /Count 1 >>");
+    std::string media_box;
+    append_number(media_box, page_w);
+    append_number(media_box, page_h);
+    object("<< /Type /Page /Parent 2 0 R /MediaBox [0 0 " + media_box +
+           "] /Resources << >> /Contents 4 0 R >>");
+    object("<< /Length " + std::to_string(content.size()) + " >>\nstream\n" + content + "endstream");
+
+    const size_t xref = pdf.size();
+    pdf += "xref\n0 " + std::to_string(offsets.size() + 1) + "\n0000000000 65535 f \n";
+    for (size_t offset : offsets) {
+        char entry[21];
+        std::snprintf(entry, sizeof(entry), "%010zu 00000 n \n", offset);
+        pdf += entry;
+    }
+    pdf += "trailer\n<< /Size " + std::to_string(offsets.size() + 1) + " /Root 1 0 R >>\nstartxref\n" +
+           std::to_string(xref) + "\n%%EOF\n";
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(pdf.data(), static_cast<std::streamsize>(pdf.size()));
+    out.close();
+    if (!out) {
+        throw std::runtime_error("Failed to write PDF: " + path);
+    }
+}
+
+}  // namespace protocols
+}  // namespace all_press
@@ -0,0 +1,352 @@
+#include "protocols/pdf_passthrough.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+namespace all_press {
+namespace protocols {
+
+namespace {
+
+const char* const UEL = "\x1B%-12345X";  // Universal Exit Language
+
+// Destino não bloqueante cheio (EAGAIN): espera ele aceitar mais dados em
+// vez de repetir a escrita em laço
+void wait_writable(int fd) {
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    while (::poll(&pfd, 1, -1) < 0) {
+        if (errno != EINTR) {
+            throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+        }
+    }
+}
+
+// Remove caracteres que quebrariam a linha PJL
+std::string sanitize_pjl_value(const std::string& value) {
+    std::string result;
+    result.reserve(value.size());
+    for (char c : value) {
+        if (c != '\r' && c != '\n' && c != '"' && c != '\x1B') {
+            result += c;
+        }
+    }
+    return result;
+}
+
+std::string normalize_pjl_key(const std::string& key) {
+    std::string result;
+    result.reserve(key.size());
+    for (unsigned char c : key) {
+        if (std::isalnum(c) || c == '_') {
+            result += static_cast<char>(std::toupper(c));
+        }
+    }
+    return result;
+}
+
+// O cabeçalho %PDF- pode vir depois de lixo, mas dentro dos primeiros
+// 1024 bytes (PDF 1.7, anexo H)
+constexpr size_t SIGNATURE_WINDOW = 1024;
+
+bool has_pdf_signature(const uint8_t* data, size_t size) {
+    static const char signature[] = "%PDF-";
+    const uint8_t* end = data + std::min(size, SIGNATURE_WINDOW);
+    return std::search(data, end, signature, signature + 5) != end;
+}
+
+}  // namespace
+
+PDFPassthroughGenerator::PDFPassthroughGenerator(PlotterVendor vendor, bool use_pjl)
+    : target_vendor_(vendor), use_pjl_(use_pjl) {
+
+    capabilities_.vendor = vendor;
+    capabilities_.model = "PDF Direct";
+
+    capabilities_.supported_sizes = {
+        MediaSize::A0, MediaSize::A1, MediaSize::A2,
+        MediaSize::A3, MediaSize::A4, MediaSize::LETTER,
+        MediaSize::LEGAL, MediaSize::TABLOID
+    };
+
+    // O interpretador do dispositivo rasteriza; qualquer DPI é aceito
+    capabilities_.supported_resolutions = {300, 600, 720, 1200, 2400};
+
+    capabilities_.supported_colors = {
+        ColorMode::MONOCHROME, ColorMode::COLOR
+    };
+
+    capabilities_.supports_duplex = false;
+    capabilities_.supports_booklet = false;
+    capabilities_.max_paper_width_mm = 1118;
+    capabilities_.max_paper_height_mm = 1600;
+}
+
+void PDFPassthroughGenerator::set_job_ticket_attribute(
+    const std::string& key,
+    const std::string& value) {
+
+    std::string pjl_key = normalize_pjl_key(key);
+    if (pjl_key.empty()) {
+        throw std::invalid_argument("Invalid job ticket attribute: " + key);
+    }
+    job_ticket_[pjl_key] = sanitize_pjl_value(value);
+}
+
+void PDFPassthroughGenerator::clear_job_ticket() {
+    job_ticket_.clear();
+}
+
+std::vector<uint8_t> PDFPassthroughGenerator::generate_header(
+    const PlotterCapabilities& /*caps*/,
+    MediaSize media_size,
+    ColorMode color_mode,
+    int dpi) {
+
+    if (!use_pjl_) {
+        return {};
+    }
+
+    std::string header;
+    header += UEL;
+    header += "@PJL\r\n";
+    header += "@PJL JOB NAME=\"All Press\"\r\n";
+
+    // Atributos derivados das opções do job
+    std::map<std::string, std::string> attributes;
+    if (pjl_paper_map_.count(media_size) > 0) {
+        attributes["PAPER"] = pjl_paper_map_[media_size];
+    }
+    attributes["RENDERMODE"] =
+        (color_mode == ColorMode::MONOCHROME) ? "GRAYSCALE" : "COLOR";
+    attributes["RESOLUTION"] = std::to_string(dpi);
+
+    // Atributos do job ticket sobrescrevem os derivados
+    for (const auto& [key, value] : job_ticket_) {
+        attributes[key] = value;
+    }
+
+    for (const auto& [key, value] : attributes) {
+        header += "@PJL SET " + key + "=" + value + "\r\n";
+    }
+
+    header += "@PJL ENTER LANGUAGE=PDF\r\n";
+
+    return std::vector<uint8_t>(header.begin(), header.end());
+}
+
+std::vector<uint8_t> PDFPassthroughGenerator::generate_page(
+    const std::vector<uint8_t>& raster_data,
+    int /*width*/,
+    int /*height*/,
+    int /*dpi*/) {
+    if (!has_pdf_signature(raster_data.data(), raster_data.size())) {
+        throw std::invalid_argument("Passthrough data is not a PDF document");
+    }
+    // Nada a converter: o dispositivo interpreta o PDF original
+    return raster_data;
+}
+
+std::vector<uint8_t> PDFPassthroughGenerator::generate_footer() {
+    if (!use_pjl_) {
+        return {};
+    }
+
+    std::string footer;
+    footer += UEL;
+    footer += "@PJL EOJ\r\n";
+    footer += UEL;
+    return std::vector<uint8_t>(footer.begin(), footer.end());
+}
+
+bool PDFPassthroughGenerator::validate_media_size(MediaSize size) const {
+    return std::find(capabilities_.supported_sizes.begin(),
+                     capabilities_.supported_sizes.end(),
+                     size) != capabilities_.supported_sizes.end();
+}
+
+bool PDFPassthroughGenerator::validate_resolution(int dpi) const {
+    return dpi > 0;
+}
+
+bool PDFPassthroughGenerator::validate_color_mode(ColorMode mode) const {
+    return (mode == ColorMode::MONOCHROME || mode == ColorMode::COLOR);
+}
+
+std::string PDFPassthroughGenerator::get_protocol_name() const {
+    return "PDF";
+}
+
+PlotterCapabilities PDFPassthroughGenerator::get_capabilities() const {
+    return capabilities_;
+}
+
+std::vector<uint8_t> PDFPassthroughGenerator::optimize_for_vendor(
+    const std::vector<uint8_t>& data) {
+    // O documento não é re-codificado
+    return data;
+}
+
+bool PDFPassthroughGenerator::needs_preprocessing() const {
+    return false;
+}
+
+bool PDFPassthroughGenerator::supports_passthrough() const {
+    return true;
+}
+
+void PDFPassthroughGenerator::apply_quirks(const std::map<std::string, std::string>& quirks) {
+    auto it = quirks.find("pdf_pjl_wrapper");
+    if (it != quirks.end()) {
+        use_pjl_ = (it->second == "true");
+    }
+}
+
+void PDFPassthroughGenerator::prepare_for_reuse() {
+    // O job ticket pertence ao job anterior
+    clear_job_ticket();
+}
+
+uint64_t PDFPassthroughGenerator::stream_file(const std::string& path, int out_fd) {
+    int in_fd = ::open(path.c_str(), O_RDONLY);
+    if (in_fd < 0) {
+        throw std::runtime_error("Failed to open file: " + path + ": " +
+                                 std::strerror(errno));
+    }
+
+    struct stat st;
+    if (::fstat(in_fd, &st) != 0) {
+        int err = errno;
+        ::close(in_fd);
+        throw std::runtime_error("Failed to stat file: " + path + ": " +
+                                 std::strerror(err));
+    }
+
+    // O dispositivo interpretaria qualquer outra coisa como lixo
+    std::vector<uint8_t> head(SIGNATURE_WINDOW);
+    ssize_t head_size;
+    do {
+        head_size = ::pread(in_fd, head.data(), head.size(), 0);
+    } while (head_size < 0 && errno == EINTR);
+    if (head_size < 0 || !has_pdf_signature(head.data(), static_cast<size_t>(head_size))) {
+        ::close(in_fd);
+        throw std::runtime_error("Not a PDF file: " + path);
+    }
+
+    uint64_t total = static_cast<uint64_t>(st.st_size);
+    uint64_t sent = 0;
+
+#ifdef __linux__
+    // Caminho zero-copy: o kernel move as páginas direto para o destino
+    off_t offset = 0;
+    while (sent < total) {
+        size_t chunk = static_cast<size_t>(
+            std::min<uint64_t>(total - sent, 1u << 30));
+        ssize_t n = ::sendfile(out_fd, in_fd, &offset, chunk);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                try {
+                    wait_writable(out_fd);
+                } catch (...) {
+                    ::close(in_fd);
+                    throw;
+                }
+                continue;
+            }
+            if ((errno == EINVAL || errno == ENOSYS) && sent == 0) {
+                break;  // Destino não suporta sendfile, usar fallback
+            }
+            int err = errno;
+            ::close(in_fd);
+            throw std::runtime_error("sendfile failed for " + path + ": " +
+                                     std::strerror(err));
+        }
+        if (n == 0) {
+            // Arquivo truncado durante o envio: o dispositivo receberia um
+            // PDF cortado
+            ::close(in_fd);
+            throw std::runtime_error("File truncated while streaming: " + path + " (" +
+                                     std::to_string(sent) + " of " + std::to_string(total) +
+                                     " bytes sent)");
+        }
+        sent += static_cast<uint64_t>(n);
+    }
+    if (sent > 0 || total == 0) {
+        ::close(in_fd);
+        return sent;
+    }
+#endif
+
+    // Fallback: cópia em blocos
+    std::vector<uint8_t> buffer(64 * 1024);
+    while (true) {
+        ssize_t n = ::read(in_fd, buffer.data(), buffer.size());
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            int err = errno;
+            ::close(in_fd);
+            throw std::runtime_error("Failed to read file: " + path + ": " +
+                                     std::strerror(err));
+        }
+        if (n == 0) {
+            if (sent < total) {
+                ::close(in_fd);
+                throw std::runtime_error("File truncated while streaming: " + path + " (" +
+                                         std::to_string(sent) + " of " + std::to_string(total) +
+                                         " bytes sent)");
+            }
+            break;
+        }
+        buffer.resize(static_cast<size_t>(n));
+        try {
+            write_all(out_fd, buffer);
+        } catch (...) {
+            ::close(in_fd);
+            throw;
+        }
+        sent += static_cast<uint64_t>(n);
+        buffer.resize(64 * 1024);
+    }
+
+    ::close(in_fd);
+    return sent;
+}
+
+void PDFPassthroughGenerator::write_all(int out_fd, const std::vector<uint8_t>& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(out_fd, data.data() + written, data.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                wait_writable(out_fd);
+                continue;
+            }
+            throw std::runtime_error(std::string("write failed: ") +
+                                     std::strerror(errno));
+        }
+        written += static_cast<size_t>(n);
+    }
+}
+
+}  // namespace protocols
+}  // namespace all_press
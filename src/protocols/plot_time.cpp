@@ -0,0 +1,413 @@
+#include "protocols/plot_time.h"
+#include "protocols/hpgl_lexer.h"
+#include "protocols/vector_path.h"
+#include "raster/trim.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace all_press {
+namespace protocols {
+
+namespace {
+
+using hpgl::ESC;
+using hpgl::ETX;
+constexpr double PI = 3.14159265358979323846;
+
+struct HpglState {
+    double x = 0.0;
+    double y = 0.0;
+    bool pen_down = false;
+    bool absolute = true;
+    bool in_stroke = false;
+    int pen = 0;
+    HpglPlotStats stats;
+
+    void set_pen(bool down) {
+        pen_down = down;
+        if (!down) {
+            in_stroke = false;
+        }
+    }
+
+    void draw(double length_mm) {
+        stats.pen_down_mm += length_mm;
+        if (!in_stroke) {
+            ++stats.pen_lifts;
+            in_stroke = true;
+        }
+    }
+
+    void move_to(double nx, double ny) {
+        const double length = std::hypot(nx - x, ny - y) / PLOTTER_UNITS_PER_MM;
+        if (pen_down) {
+            draw(length);
+        } else {
+            stats.pen_up_mm += length;
+        }
+        x = nx;
+        y = ny;
+    }
+
+    void select_pen(int selected) {
+        if (selected > 0 && selected != pen) {
+            ++stats.pen_changes;
+        }
+        pen = selected;
+        in_stroke = false;
+    }
+
+    // Figura fechada desenhada a partir da posição atual, que não muda
+    void closed_figure(double perimeter_mm, double approach_mm) {
+        stats.pen_up_mm += 2.0 * approach_mm;
+        ++stats.pen_lifts;
+        stats.pen_down_mm += perimeter_mm;
+        in_stroke = false;
+    }
+};
+
+size_t decode_polyline_encoded(const uint8_t* data, size_t size, size_t i, HpglState& state) {
+    bool seven_bit = false;
+    bool pen_up_next = false;
+    bool absolute_next = false;
+    int fraction_bits = 0;
+    bool have_x = false;
+    long long first = 0;
+
+    while (i < size && data[i] != ';' && data[i] != ESC) {
+        const uint8_t c = data[i];
+        long long value = 0;
+        if (c == ':' || c == '>') {
+            ++i;
+            if (!hpgl::decode_pe_number(data, size, i, seven_bit, value)) {
+                break;
+            }
+            if (c == ':') {
+                state.select_pen(static_cast<int>(value));
+            } else {
+                fraction_bits = static_cast<int>(std::max(0LL, std::min(value, 26LL)));
+            }
+        } else if (c == '<') {
+            pen_up_next = true;
+            ++i;
+        } else if (c == '=') {
+            absolute_next = true;
+            ++i;
+        } else if (c == '7') {
+            seven_bit = true;
+            ++i;
+        } else if (c >= 63) {
+            if (!hpgl::decode_pe_number(data, size, i, seven_bit, value)) {
+                break;
+            }
+            if (!have_x) {
+                first = value;
+                have_x = true;
+                continue;
+            }
+            have_x = false;
+            const double dx = std::ldexp(static_cast<double>(first), -fraction_bits);
+            const double dy = std::ldexp(static_cast<double>(value), -fraction_bits);
+            state.set_pen(!pen_up_next);
+            if (absolute_next) {
+                state.move_to(dx, dy);
+            } else {
+                state.move_to(state.x + dx, state.y + dy);
+            }
+            pen_up_next = false;
+            absolute_next = false;
+        } else {
+            ++i;
+        }
+    }
+    return i;
+}
+
+void arc(HpglState& state, double cx, double cy, double degrees) {
+    const double radius = std::hypot(state.x - cx, state.y - cy);
+    const double radians = degrees * PI / 180.0;
+    const double length = radius * std::fabs(radians) / PLOTTER_UNITS_PER_MM;
+    if (state.pen_down) {
+        state.draw(length);
+    } else {
+        state.stats.pen_up_mm += length;
+    }
+    const double start = std::atan2(state.y - cy, state.x - cx);
+    state.x = cx + radius * std::cos(start + radians);
+    state.y = cy + radius * std::sin(start + radians);
+}
+
+// Pixels com tinta no trecho (algum canal fora da tolerância)
+size_t count_ink_pixels(const uint8_t* row, int pixels, int bpp, raster::PixelFormat format, int tolerance) {
+    size_t count = 0;
+    for (int x = 0; x < pixels; ++x) {
+        count += raster::row_has_ink(row + static_cast<size_t>(x) * bpp, bpp, format, tolerance);
+    }
+    return count;
+}
+
+}  // namespace
+
+int PlotSpeeds::passes_for_quality(int quality) const {
+    if (passes.empty()) {
+        return 1;
+    }
+    const int index = std::min(std::max(quality, 1), static_cast<int>(passes.size())) - 1;
+    return std::max(1, passes[index]);
+}
+
+HpglPlotStats analyze_hpgl(const uint8_t* data, size_t size) {
+    HpglState state;
+    uint8_t label_terminator = ETX;
+    size_t i = 0;
+
+    while (i < size) {
+        const uint8_t c = data[i];
+        if (c == ESC) {
+            i = hpgl::skip_escape(data, size, i);
+            continue;
+        }
+        if (!std::isalpha(c) || i + 1 >= size || !std::isalpha(data[i + 1])) {
+            ++i;
+            continue;
+        }
+
+        const char a = static_cast<char>(std::toupper(c));
+        const char b = static_cast<char>(std::toupper(data[i + 1]));
+        i += 2;
+        ++state.stats.commands;
+
+        if (a == 'L' && b == 'B') {
+            while (i < size && data[i] != label_terminator) ++i;
+            ++i;
+            continue;
+        }
+        if (a == 'D' && b == 'T') {
+            if (i < size && data[i] != ';') {
+                label_terminator = data[i++];
+            } else {
+                label_terminator = ETX;
+            }
+            continue;
+        }
+        if (a == 'P' && b == 'E') {
+            i = decode_polyline_encoded(data, size, i, state);
+            continue;
+        }
+
+        const auto params = hpgl::parse_parameters(data, size, i);
+        const size_t pairs = params.size() / 2;
+
+        if (a == 'P' && (b == 'U' || b == 'D' || b == 'A' || b == 'R')) {
+            if (b == 'U' || b == 'D') {
+                state.set_pen(b == 'D');
+            } else {
+                state.absolute = b == 'A';
+            }
+            for (size_t k = 0; k < pairs; ++k) {
+                const double px = params[2 * k];
+                const double py = params[2 * k + 1];
+                if (state.absolute) {
+                    state.move_to(px, py);
+                } else {
+                    state.move_to(state.x + px, state.y + py);
+                }
+            }
+        } else if (a == 'S' && b == 'P') {
+            state.select_pen(params.empty() ? 0 : static_cast<int>(params[0]));
+        } else if (a == 'I' && b == 'N') {
+            state.x = 0.0;
+            state.y = 0.0;
+            state.absolute = true;
+            state.set_pen(false);
+        } else if (a == 'C' && b == 'I' && !params.empty()) {
+            const double radius = std::fabs(params[0]) / PLOTTER_UNITS_PER_MM;
+            state.closed_figure(2.0 * PI * radius, radius);
+        } else if (a == 'A' && (b == 'A' || b == 'R') && params.size() >= 3) {
+            const double cx = b == 'A' ? params[0] : state.x + params[0];
+            const double cy = b == 'A' ? params[1] : state.y + params[1];
+            arc(state, cx, cy, params[2]);
+        } else if ((b == 'A' || b == 'R') && (a == 'E' || a == 'R') && pairs >= 1) {
+            const double w = b == 'A' ? params[0] - state.x : params[0];
+            const double h = b == 'A' ? params[1] - state.y : params[1];
+            state.closed_figure(2.0 * (std::fabs(w) + std::fabs(h)) / PLOTTER_UNITS_PER_MM, 0.0);
+        }
+    }
+    return state.stats;
+}
+
+RasterPlotStats analyze_raster(const raster::TiledRaster& page, int dpi, int passes, int tolerance) {
+    RasterPlotStats stats;
+    stats.passes = std::max(1, passes);
+    if (dpi <= 0) {
+        return stats;
+    }
+    const double mm_per_row = 25.4 / dpi;
+    stats.media_length_mm = page.height() * mm_per_row;
+
+    const int step = std::max(1, dpi / 100);
+    const int bpp = page.bytes_per_pixel();
+    const int tile = page.tile_size();
+    int64_t inked_rows = 0;
+    double ink_pixels = 0.0;
+    raster::RowBand band;
+
+    for (int b = 0; b < page.band_count(); ++b) {
+        bool blank = true;
+        for (int tx = 0; tx < page.tiles_x() && blank; ++tx) {
+            blank = page.tile_is_blank(tx, b);
+        }
+        if (blank) {
+            continue;
+        }
+        page.read_band(b, band);
+        for (int r = 0; r < band.rows; ++r) {
+            const uint8_t* row = band.row(r);
+            bool inked = false;
+            const bool sampled = (band.y + r) % step == 0;
+            for (int tx = 0; tx < page.tiles_x(); ++tx) {
+                if (band.tile_blank[tx]) {
+                    continue;
+                }
+                const int x0 = tx * tile;
+                const int pixels = std::min(tile, page.width() - x0);
+                const uint8_t* span = row + static_cast<size_t>(x0) * bpp;
+                if (!raster::row_has_ink(span, static_cast<size_t>(pixels) * bpp, page.format(), tolerance)) {
+                    continue;
+                }
+                inked = true;
+                if (!sampled) {
+                    break;
+                }
+                ink_pixels += static_cast<double>(
+                    count_ink_pixels(span, pixels, bpp, page.format(), tolerance)) * step;
+            }
+            inked_rows += inked;
+        }
+    }
+
+    stats.inked_length_mm = inked_rows * mm_per_row;
+    stats.ink_area_m2 = ink_pixels * (mm_per_row / 1000.0) * (mm_per_row / 1000.0);
+    return stats;
+}
+
+RasterPlotStats& operator+=(RasterPlotStats& total, const RasterPlotStats& page) {
+    total.media_length_mm += page.media_length_mm;
+    total.inked_length_mm += page.inked_length_mm;
+    total.ink_area_m2 += page.ink_area_m2;
+    total.passes = std::max(total.passes, page.passes);
+    return total;
+}
+
+double predict_plot_seconds(const HpglPlotStats& stats, const PlotSpeeds& speeds) {
+    double seconds = speeds.job_overhead_s;
+    if (speeds.pen_down_mm_s > 0.0) seconds += stats.pen_down_mm / speeds.pen_down_mm_s;
+    if (speeds.pen_up_mm_s > 0.0) seconds += stats.pen_up_mm / speeds.pen_up_mm_s;
+    seconds += stats.commands * speeds.command_s;
+    seconds += stats.pen_changes * speeds.pen_change_s;
+    return seconds;
+}
+
+double predict_plot_seconds(const RasterPlotStats& stats, const PlotSpeeds& speeds) {
+    double seconds = speeds.job_overhead_s;
+    if (speeds.print_mm_s > 0.0) {
+        seconds += stats.inked_length_mm * stats.passes / speeds.print_mm_s;
+    }
+    if (speeds.feed_mm_s > 0.0) {
+        seconds += std::max(0.0, stats.media_length_mm - stats.inked_length_mm) / speeds.feed_mm_s;
+    }
+    seconds += stats.ink_area_m2 * speeds.ink_s_per_m2;
+    return seconds;
+}
+
+PlotTimeCalibration::PlotTimeCalibration(double forgetting)
+    : forgetting_(std::min(1.0, std::max(0.0, forgetting))) {}
+
+void PlotTimeCalibration::observe(const std::string& model, double predicted_s, double actual_s) {
+    if (!(predicted_s > 0.0) || !(actual_s > 0.0)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Fit& fit = fits_[model];
+    fit.sum_xy = forgetting_ * fit.sum_xy + predicted_s * actual_s;
+    fit.sum_xx = forgetting_ * fit.sum_xx + predicted_s * predicted_s;
+    ++fit.count;
+}
+
+double PlotTimeCalibration::factor(const std::string& model) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = fits_.find(model);
+    if (it == fits_.end() || it->second.count == 0 || it->second.sum_xx <= 0.0) {
+        return 1.0;
+    }
+    return std::min(10.0, std::max(0.1, it->second.sum_xy / it->second.sum_xx));
+}
+
+double PlotTimeCalibration::calibrate(const std::string& model, double predicted_s) const {
+    return predicted_s * factor(model);
+}
+
+size_t PlotTimeCalibration::observations(const std::string& model) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = fits_.find(model);
+    return it == fits_.end() ? 0 : it->second.count;
+}
+
+void PlotTimeCalibration::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open plot time calibration: " + path);
+    }
+    std::map<std::string, Fit> fits;
+    try {
+        const auto document = nlohmann::json::parse(file);
+        for (const auto& [model, node] : document.at("models").items()) {
+            Fit fit;
+            fit.sum_xy = node.at("sum_xy").get<double>();
+            fit.sum_xx = node.at("sum_xx").get<double>();
+            fit.count = node.at("count").get<size_t>();
+            fits[model] = fit;
+        }
+    } catch (const nlohmann::json::exception& e) {
+        throw std::runtime_error("Invalid plot time calibration " + path + ": " + e.what());
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    fits_.swap(fits);
+}
+
+void PlotTimeCalibration::save(const std::string& path) const {
+    nlohmann::json document;
+    document["models"] = nlohmann::json::object();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [model, fit] : fits_) {
+            document["models"][model] = {
+                {"sum_xy", fit.sum_xy}, {"sum_xx", fit.sum_xx}, {"count", fit.count}};
+        }
+    }
+
+    // Arquivo temporário + rename: leitores nunca veem um JSON pela metade
+    const std::string temp = path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::trunc);
+        if (!file.is_open()) {
+            throw std::runtime_error("Cannot write plot time calibration: " + path);
+        }
+        file << document.dump(2) << '\n';
+        if (!file) {
+            throw std::runtime_error("Cannot write plot time calibration: " + path);
+        }
+    }
+    if (std::rename(temp.c_str(), path.c_str()) != 0) {
+        std::remove(temp.c_str());
+        throw std::runtime_error("Cannot replace plot time calibration: " + path);
+    }
+}
+
+}  // namespace protocols
+}  // namespace all_press
@@ -1,4 +1,5 @@
 #include "protocols/postscript_generator.h"
+#include <algorithm>
 #include <sstream>
 #include <ctime>
 
@@ -38,6 +39,8 @@ std::vector<uint8_t> PostScriptGenerator::generate_header(
     ColorMode color_mode,
     int dpi) {
     
+    color_mode_ = color_mode;
+    
     std::stringstream ps;
     
     // PostScript Header
@@ -87,20 +90,143 @@ std::vector<uint8_t> PostScriptGenerator::generate_page(
     int height,
     int dpi) {
     
+    const size_t pixels = static_cast<size_t>(std::max(width, 0)) * std::max(height, 0);
+    const bool is_gray = pixels > 0 && raster_data.size() == pixels;
+    const bool is_rgb = pixels > 0 && raster_data.size() == pixels * 3;
+    
     std::stringstream ps;
     
-    ps << "gsave\n";
-    ps << width << " " << height << " scale\n";
-    ps << "currentfile /DCTDecode filter\n";
-    ps << "image\n";
+    if (!is_gray && !is_rgb) {
+        // Dados já comprimidos (JPEG): enviados como estão
+        ps << "gsave\n";
+        ps << width << " " << height << " scale\n";
+        ps << "currentfile /DCTDecode filter\n";
+        ps << "image\n";
+        
+        std::string result_str = ps.str();
+        std::vector<uint8_t> result(result_str.begin(), result_str.end());
+        result.insert(result.end(), raster_data.begin(), raster_data.end());
+        return result;
+    }
     
-    std::string result_str = ps.str();
-    std::vector<uint8_t> result(result_str.begin(), result_str.end());
-    result.insert(result.end(), raster_data.begin(), raster_data.end());
+    // Raster cru: image de 8 bits com RunLengthDecode
+    const bool rgb_output = is_rgb && color_mode_ == ColorMode::COLOR;
+    
+    std::vector<uint8_t> result;
+    append_image_prologue(result, width, height, dpi, rgb_output ? 3 : 1);
+    result.reserve(result.size() + raster_data.size() / 4);
+    
+    // Especialização escolhida uma vez por página
+    if (rgb_output) {
+        encode_raster_rows<RasterProtocol::POSTSCRIPT, 24>(raster_data.data(), width, height,
+                                                           result, scratch_);
+    } else if (is_gray) {
+        encode_raster_rows<RasterProtocol::POSTSCRIPT, 8>(raster_data.data(), width, height,
+                                                          result, scratch_);
+    } else {
+        RasterRowEncoder<RasterProtocol::POSTSCRIPT, 8> encoder(width, scratch_);
+        std::vector<uint8_t>& gray = scratch_.gray;
+        gray.resize(static_cast<size_t>(width));
+        const size_t stride = static_cast<size_t>(width) * 3;
+        for (int y = 0; y < height; ++y) {
+            rgb_row_to_gray(raster_data.data() + static_cast<size_t>(y) * stride,
+                            width, gray.data());
+            encoder.encode_row(gray.data(), result);
+        }
+    }
+    
+    result.push_back(128);  // EOD do RunLengthDecode
+    result.push_back('\n');
+    return result;
+}
+
+std::vector<uint8_t> PostScriptGenerator::generate_raster_page(
+    const raster::TiledRaster& page,
+    int dpi) {
+    
+    const int width = page.width();
+    const raster::PixelFormat format = page.format();
+    const bool gray_output = format == raster::PixelFormat::GRAY8 ||
+        (format == raster::PixelFormat::RGB8 && color_mode_ != ColorMode::COLOR);
+    const int components = gray_output ? 1 : raster::bytes_per_pixel(format);
     
+    std::vector<uint8_t> result;
+    append_image_prologue(result, width, page.height(), dpi, components);
+    
+    // Especialização escolhida uma vez por página; faixas sem tinta reusam a
+    // linha em branco já codificada
+    auto encode = [&](auto& encoder, bool convert_rgb) {
+        std::vector<uint8_t> blank_row(static_cast<size_t>(width) * components,
+                                       raster::blank_byte(format));
+        std::vector<uint8_t> blank_encoded;
+        encoder.encode_row(blank_row.data(), blank_encoded);
+        
+        std::vector<uint8_t>& gray = scratch_.gray;
+        gray.resize(static_cast<size_t>(width));
+        page.for_each_band([&](const raster::RowBand& band) {
+            if (band.all_blank()) {
+                for (int r = 0; r < band.rows; ++r) {
+                    result.insert(result.end(), blank_encoded.begin(), blank_encoded.end());
+                }
+                return true;
+            }
+            for (int r = 0; r < band.rows; ++r) {
+                const uint8_t* row = band.row(r);
+                if (convert_rgb) {
+                    rgb_row_to_gray(row, width, gray.data());
+                    row = gray.data();
+                }
+                encoder.encode_row(row, result);
+            }
+            return true;
+        });
+    };
+    
+    if (components == 1) {
+        RasterRowEncoder<RasterProtocol::POSTSCRIPT, 8> encoder(width, scratch_);
+        encode(encoder, format == raster::PixelFormat::RGB8);
+    } else if (components == 3) {
+        RasterRowEncoder<RasterProtocol::POSTSCRIPT, 24> encoder(width, scratch_);
+        encode(encoder, false);
+    } else {
+        RasterRowEncoder<RasterProtocol::POSTSCRIPT, 32> encoder(width, scratch_);
+        encode(encoder, false);
+    }
+    
+    result.push_back(128);  // EOD do RunLengthDecode
+    result.push_back('\n');
     return result;
 }
 
+void PostScriptGenerator::append_image_prologue(
+    std::vector<uint8_t>& out,
+    int width,
+    int height,
+    int dpi,
+    int components) const {
+    
+    static const char* const color_spaces[] = {"", "/DeviceGray", "", "/DeviceRGB", "/DeviceCMYK"};
+    static const char* const decodes[] = {"", "[0 1]", "", "[0 1 0 1 0 1]", "[0 1 0 1 0 1 0 1]"};
+    const double scale = 72.0 / (dpi > 0 ? dpi : 72);
+    
+    std::stringstream ps;
+    ps << "gsave\n";
+    ps << (width * scale) << " " << (height * scale) << " scale\n";
+    ps << color_spaces[components] << " setcolorspace\n";
+    ps << "<<\n";
+    ps << "  /ImageType 1\n";
+    ps << "  /Width " << width << "\n";
+    ps << "  /Height " << height << "\n";
+    ps << "  /BitsPerComponent 8\n";
+    ps << "  /Decode " << decodes[components] << "\n";
+    ps << "  /ImageMatrix [" << width << " 0 0 -" << height << " 0 " << height << "]\n";
+    ps << "  /DataSource currentfile /RunLengthDecode filter\n";
+    ps << ">> image\n";
+    
+    std::string prologue = ps.str();
+    out.insert(out.end(), prologue.begin(), prologue.end());
+}
+
 std::vector<uint8_t> PostScriptGenerator::generate_footer() {
     std::string footer = "grestore\nshowpage\n%%EOF\n";
     std::vector<uint8_t> result(footer.begin(), footer.end());
@@ -145,6 +271,10 @@ bool PostScriptGenerator::needs_preprocessing() const {
     return false;  // PostScript é mais universal
 }
 
+void PostScriptGenerator::prepare_for_reuse() {
+    color_mode_ = ColorMode::MONOCHROME;
+}
+
 }  // namespace protocols
 }  // namespace all_press
 
@@ -13,6 +13,9 @@ std::unique_ptr<PlotterProtocolBase> PlotterProtocolFactory::create_protocol(
     else if (protocol_name == "PostScript") {
         return std::make_unique<PostScriptGenerator>(vendor);
     }
+    else if (protocol_name == "PDF") {
+        return std::make_unique<PDFPassthroughGenerator>(vendor);
+    }
     else if (protocol_name == "ESC/P") {
         // TODO: Implementar ESCPGenerator
         throw std::runtime_error("ESC/P not yet implemented");
@@ -30,7 +33,12 @@ std::unique_ptr<PlotterProtocolBase> PlotterProtocolFactory::create_for_printer(
     std::string protocol = CompatibilityMatrix::get_recommended_protocol(
         vendor, model);
     
-    return create_protocol(protocol, vendor);
+    auto handler = create_protocol(protocol, vendor);
+    
+    // Aplicar ajustes específicos do modelo (ex: codificação PE)
+    handler->apply_quirks(CompatibilityMatrix::get_quirks(vendor, model));
+    
+    return handler;
 }
 
 std::vector<std::string> PlotterProtocolFactory::get_available_protocols(
@@ -0,0 +1,133 @@
+#include "protocols/protocol_pool.h"
+#include "protocols/protocol_factory.h"
+
+namespace all_press {
+namespace protocols {
+
+ProtocolLease::~ProtocolLease() {
+    release();
+}
+
+ProtocolLease::ProtocolLease(ProtocolLease&& other) noexcept
+    : pool_(other.pool_), slot_(other.slot_), handler_(std::move(other.handler_)),
+      generation_(other.generation_) {
+    other.pool_ = nullptr;
+    other.slot_ = nullptr;
+}
+
+ProtocolLease& ProtocolLease::operator=(ProtocolLease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = other.pool_;
+        slot_ = other.slot_;
+        handler_ = std::move(other.handler_);
+        generation_ = other.generation_;
+        other.pool_ = nullptr;
+        other.slot_ = nullptr;
+    }
+    return *this;
+}
+
+void ProtocolLease::release() {
+    if (pool_ && handler_) {
+        pool_->give_back(slot_, std::move(handler_), generation_);
+    }
+    pool_ = nullptr;
+    slot_ = nullptr;
+    handler_.reset();
+}
+
+ProtocolHandlerPool::ProtocolHandlerPool(size_t max_idle_per_key)
+    : max_idle_per_key_(max_idle_per_key) {
+}
+
+ProtocolLease ProtocolHandlerPool::checkout(PlotterVendor vendor, std::string_view model) {
+    return checkout(vendor, model, std::string_view());
+}
+
+ProtocolLease ProtocolHandlerPool::checkout(PlotterVendor vendor,
+                                            std::string_view model,
+                                            std::string_view protocol) {
+    checkouts_.fetch_add(1, std::memory_order_relaxed);
+
+    ProtocolLease::FreeList* slot = nullptr;
+    size_t generation = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        generation = generation_;
+        auto it = free_lists_.find(KeyView{vendor, model, protocol});
+        if (it != free_lists_.end()) {
+            slot = &it->second;
+            if (!slot->empty()) {
+                auto handler = std::move(slot->back());
+                slot->pop_back();
+                reused_.fetch_add(1, std::memory_order_relaxed);
+                return ProtocolLease(this, slot, std::move(handler), generation);
+            }
+        }
+    }
+
+    // Construção fora do lock: tabelas, capabilities e quirks do modelo. Um
+    // clear() durante a construção deixa o handler com a geração antiga.
+    std::string model_str(model);
+    std::unique_ptr<PlotterProtocolBase> handler;
+    if (protocol.empty()) {
+        handler = PlotterProtocolFactory::create_for_printer(vendor, model_str);
+    } else {
+        handler = PlotterProtocolFactory::create_protocol(std::string(protocol), vendor);
+        handler->apply_quirks(CompatibilityMatrix::get_quirks(vendor, model_str));
+    }
+    created_.fetch_add(1, std::memory_order_relaxed);
+
+    if (!slot) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = free_lists_.find(KeyView{vendor, model, protocol});
+        if (it == free_lists_.end()) {
+            it = free_lists_.emplace(
+                Key{vendor, std::move(model_str), std::string(protocol)},
+                ProtocolLease::FreeList()).first;
+            it->second.reserve(max_idle_per_key_);
+        }
+        slot = &it->second;
+    }
+
+    return ProtocolLease(this, slot, std::move(handler), generation);
+}
+
+void ProtocolHandlerPool::give_back(ProtocolLease::FreeList* slot,
+                                    std::unique_ptr<PlotterProtocolBase> handler,
+                                    size_t generation) {
+    handler->prepare_for_reuse();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (generation == generation_ && slot->size() < max_idle_per_key_) {
+        slot->push_back(std::move(handler));
+    }
+    // Acima do limite ou de geração anterior a um clear() (quirks
+    // desatualizados) o handler é destruído aqui
+}
+
+void ProtocolHandlerPool::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++generation_;
+    // As listas continuam no mapa: leases ativos apontam para elas
+    for (auto& [key, slot] : free_lists_) {
+        slot.clear();
+    }
+}
+
+ProtocolPoolStats ProtocolHandlerPool::stats() const {
+    ProtocolPoolStats result;
+    result.checkouts = checkouts_.load(std::memory_order_relaxed);
+    result.reused = reused_.load(std::memory_order_relaxed);
+    result.created = created_.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [key, slot] : free_lists_) {
+        result.idle += slot.size();
+    }
+    return result;
+}
+
+}  // namespace protocols
+}  // namespace all_press
@@ -0,0 +1,454 @@
+#include "protocols/stroke_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+
+namespace all_press {
+namespace protocols {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr double ZERO_LENGTH = 1e-3;  // unidades de plotter
+constexpr uint32_t NO_POSITION = std::numeric_limits<uint32_t>::max();
+
+inline double distance(const PlotPoint& a, const PlotPoint& b) {
+    double dx = a.x - b.x;
+    double dy = a.y - b.y;
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+// Remove pontos repetidos e pontos intermediários colineares
+void clean_stroke(Polyline& stroke, double eps, double collinear_tol) {
+    if (stroke.points.size() < 2) {
+        return;
+    }
+
+    std::vector<PlotPoint> result;
+    result.reserve(stroke.points.size());
+    result.push_back(stroke.points.front());
+
+    for (size_t i = 1; i < stroke.points.size(); ++i) {
+        const PlotPoint& p = stroke.points[i];
+        if (distance(p, result.back()) <= eps) {
+            continue;  // Movimento de comprimento zero
+        }
+        if (result.size() >= 2) {
+            const PlotPoint& a = result[result.size() - 2];
+            const PlotPoint& b = result.back();
+            double chord = distance(a, p);
+            double cross = (p.x - a.x) * (b.y - a.y) - (p.y - a.y) * (b.x - a.x);
+            double dot = (b.x - a.x) * (p.x - b.x) + (b.y - a.y) * (p.y - b.y);
+            if (chord > 0.0 && std::abs(cross) / chord <= collinear_tol && dot >= 0.0) {
+                result.back() = p;  // b está sobre o segmento a->p
+                continue;
+            }
+        }
+        result.push_back(p);
+    }
+
+    // Traço de comprimento zero é um ponto desenhado (PU x,y;PD x,y): não
+    // pode virar só um movimento com a caneta levantada
+    if (result.size() == 1) {
+        result.push_back(result.front());
+    }
+
+    stroke.points.swap(result);
+}
+
+// Índice espacial das extremidades dos traços. Cada entrada codifica
+// (traço << 1) | extremidade, onde extremidade 1 = ponto final.
+// Layout CSR com remoção O(1) por troca com o fim da célula.
+class EndpointGrid {
+public:
+    explicit EndpointGrid(const std::vector<Polyline>& strokes)
+        : strokes_(strokes), position_(strokes.size() * 2, NO_POSITION) {
+    }
+
+    void build(const std::vector<uint32_t>& members, bool include_ends) {
+        const auto& strokes = strokes_;
+        double min_x = std::numeric_limits<double>::max();
+        double min_y = min_x;
+        double max_x = std::numeric_limits<double>::lowest();
+        double max_y = max_x;
+        for (uint32_t s : members) {
+            for (const PlotPoint* p : {&strokes[s].points.front(), &strokes[s].points.back()}) {
+                min_x = std::min(min_x, p->x);
+                min_y = std::min(min_y, p->y);
+                max_x = std::max(max_x, p->x);
+                max_y = std::max(max_y, p->y);
+            }
+        }
+
+        size_t entries = members.size() * (include_ends ? 2 : 1);
+        double width = std::max(max_x - min_x, 1.0);
+        double height = std::max(max_y - min_y, 1.0);
+        // ~2 entradas por célula
+        cell_ = std::max(std::sqrt(width * height * 2.0 / std::max<size_t>(entries, 1)), 1.0);
+        min_x_ = min_x;
+        min_y_ = min_y;
+        cols_ = static_cast<int>(width / cell_) + 1;
+        rows_ = static_cast<int>(height / cell_) + 1;
+
+        std::vector<uint32_t> cell_of(entries);
+        std::vector<uint32_t> entry_ids(entries);
+        cell_begin_.assign(static_cast<size_t>(cols_) * rows_ + 1, 0);
+
+        size_t k = 0;
+        for (uint32_t s : members) {
+            for (uint32_t end = 0; end < (include_ends ? 2u : 1u); ++end) {
+                const PlotPoint& p = end ? strokes[s].points.back() : strokes[s].points.front();
+                entry_ids[k] = (s << 1) | end;
+                cell_of[k] = cell_index(p);
+                cell_begin_[cell_of[k] + 1]++;
+                ++k;
+            }
+        }
+        for (size_t c = 1; c < cell_begin_.size(); ++c) {
+            cell_begin_[c] += cell_begin_[c - 1];
+        }
+
+        cell_end_.assign(cell_begin_.begin(), cell_begin_.end() - 1);
+        entries_.resize(entries);
+        for (size_t i = 0; i < entries; ++i) {
+            entries_[cell_end_[cell_of[i]]++] = entry_ids[i];
+        }
+
+        for (size_t c = 0; c + 1 < cell_begin_.size(); ++c) {
+            for (uint32_t pos = cell_begin_[c]; pos < cell_end_[c]; ++pos) {
+                position_[entries_[pos]] = pos;
+            }
+        }
+        live_ = entries;
+        built_with_ = entries;
+    }
+
+    size_t live() const { return live_; }
+    size_t built_with() const { return built_with_; }
+
+    void remove(uint32_t entry) {
+        uint32_t pos = position_[entry];
+        if (pos == NO_POSITION) {
+            return;
+        }
+        uint32_t cell = cell_index(point_of(entry));
+        uint32_t last = --cell_end_[cell];
+        uint32_t moved = entries_[last];
+        entries_[pos] = moved;
+        position_[moved] = pos;
+        position_[entry] = NO_POSITION;
+        --live_;
+    }
+
+    // Busca em anéis crescentes; retorna -1 se o índice estiver vazio
+    int64_t nearest(const PlotPoint& query) const {
+        if (live_ == 0) {
+            return -1;
+        }
+
+        int cx = clamp_col(static_cast<int>(std::floor((query.x - min_x_) / cell_)));
+        int cy = clamp_row(static_cast<int>(std::floor((query.y - min_y_) / cell_)));
+
+        int64_t best = -1;
+        double best_dist = std::numeric_limits<double>::max();
+        int max_ring = std::max(cols_, rows_);
+
+        for (int ring = 0; ring <= max_ring; ++ring) {
+            for (int y = cy - ring; y <= cy + ring; ++y) {
+                if (y < 0 || y >= rows_) {
+                    continue;
+                }
+                bool edge_row = (y == cy - ring || y == cy + ring);
+                int step = edge_row ? 1 : 2 * ring;
+                for (int x = cx - ring; x <= cx + ring; x += std::max(step, 1)) {
+                    if (x < 0 || x >= cols_) {
+                        continue;
+                    }
+                    uint32_t cell = static_cast<uint32_t>(y) * cols_ + x;
+                    for (uint32_t pos = cell_begin_[cell]; pos < cell_end_[cell]; ++pos) {
+                        uint32_t e = entries_[pos];
+                        double d = distance(point_of(e), query);
+                        if (d < best_dist) {
+                            best_dist = d;
+                            best = e;
+                        }
+                    }
+                }
+            }
+            // Nenhum ponto de anéis externos pode estar mais perto
+            if (best >= 0 && best_dist <= ring * cell_) {
+                break;
+            }
+        }
+        return best;
+    }
+
+private:
+    const PlotPoint& point_of(uint32_t entry) const {
+        const auto& pts = strokes_[entry >> 1].points;
+        return (entry & 1) ? pts.back() : pts.front();
+    }
+
+    uint32_t cell_index(const PlotPoint& p) const {
+        int x = clamp_col(static_cast<int>((p.x - min_x_) / cell_));
+        int y = clamp_row(static_cast<int>((p.y - min_y_) / cell_));
+        return static_cast<uint32_t>(y) * cols_ + x;
+    }
+    int clamp_col(int x) const { return std::max(0, std::min(x, cols_ - 1)); }
+    int clamp_row(int y) const { return std::max(0, std::min(y, rows_ - 1)); }
+
+    const std::vector<Polyline>& strokes_;
+    double min_x_ = 0.0;
+    double min_y_ = 0.0;
+    double cell_ = 1.0;
+    int cols_ = 1;
+    int rows_ = 1;
+    std::vector<uint32_t> cell_begin_;
+    std::vector<uint32_t> cell_end_;
+    std::vector<uint32_t> entries_;
+    std::vector<uint32_t> position_;  // posição de cada entrada em entries_
+    size_t live_ = 0;
+    size_t built_with_ = 0;
+};
+
+struct OrientedStroke {
+    uint32_t index;
+    bool reversed;
+};
+
+inline const PlotPoint& start_of(const std::vector<Polyline>& strokes, const OrientedStroke& o) {
+    const auto& pts = strokes[o.index].points;
+    return o.reversed ? pts.back() : pts.front();
+}
+
+inline const PlotPoint& end_of(const std::vector<Polyline>& strokes, const OrientedStroke& o) {
+    const auto& pts = strokes[o.index].points;
+    return o.reversed ? pts.front() : pts.back();
+}
+
+}  // namespace
+
+StrokeOptimizer::StrokeOptimizer(StrokeOptimizerOptions options)
+    : options_(options) {
+}
+
+double StrokeOptimizer::pen_up_distance(const std::vector<Polyline>& strokes) {
+    PlotPoint current{0.0, 0.0};
+    double total = 0.0;
+    for (const auto& stroke : strokes) {
+        if (stroke.points.empty()) {
+            continue;
+        }
+        total += distance(current, stroke.points.front());
+        current = stroke.points.back();
+    }
+    return total;
+}
+
+double StrokeOptimizer::pen_down_distance(const std::vector<Polyline>& strokes) {
+    double total = 0.0;
+    for (const auto& stroke : strokes) {
+        for (size_t i = 1; i < stroke.points.size(); ++i) {
+            total += distance(stroke.points[i - 1], stroke.points[i]);
+        }
+    }
+    return total;
+}
+
+double StrokeOptimizer::estimate_seconds(double pen_down_units, double pen_up_units,
+                                         size_t strokes) const {
+    double down_mm = pen_down_units / PLOTTER_UNITS_PER_MM;
+    double up_mm = pen_up_units / PLOTTER_UNITS_PER_MM;
+    return down_mm / options_.pen_down_speed_mm_s +
+           up_mm / options_.pen_up_speed_mm_s +
+           static_cast<double>(strokes) * 2.0 * options_.pen_lift_time_s;
+}
+
+StrokeOptimizationReport StrokeOptimizer::optimize(std::vector<Polyline>& strokes) const {
+    StrokeOptimizationReport report;
+    auto deadline = Clock::now() + options_.time_budget;
+
+    for (const auto& stroke : strokes) {
+        if (!stroke.points.empty()) {
+            report.strokes_before++;
+            report.segments_before += stroke.points.size() - 1;
+        }
+    }
+    report.pen_up_mm_before = pen_up_distance(strokes) / PLOTTER_UNITS_PER_MM;
+    report.pen_down_mm = pen_down_distance(strokes) / PLOTTER_UNITS_PER_MM;
+    report.estimated_seconds_before = estimate_seconds(
+        report.pen_down_mm * PLOTTER_UNITS_PER_MM,
+        report.pen_up_mm_before * PLOTTER_UNITS_PER_MM,
+        report.strokes_before);
+
+    // 1. Limpeza de cada traço e separação por caneta (ordem de aparição)
+    std::vector<int> pen_order;
+    std::unordered_map<int, std::vector<uint32_t>> by_pen;
+    for (uint32_t i = 0; i < strokes.size(); ++i) {
+        if (strokes[i].points.empty()) {
+            continue;
+        }
+        clean_stroke(strokes[i], ZERO_LENGTH,
+                     options_.collinear_tolerance);
+        auto& members = by_pen[strokes[i].pen];
+        if (members.empty()) {
+            pen_order.push_back(strokes[i].pen);
+        }
+        members.push_back(i);
+    }
+
+    std::vector<OrientedStroke> order;
+    order.reserve(strokes.size());
+    PlotPoint current{0.0, 0.0};
+    size_t iterations = 0;
+
+    // 2. Vizinho mais próximo por grupo de caneta
+    for (int pen : pen_order) {
+        const auto& members = by_pen[pen];
+        size_t group_begin = order.size();
+        std::vector<bool> used(strokes.size(), false);
+
+        EndpointGrid grid(strokes);
+        grid.build(members, options_.allow_reversal);
+        size_t remaining = members.size();
+
+        while (remaining > 0 && !report.time_budget_exhausted) {
+            if ((++iterations & 1023) == 0 && Clock::now() > deadline) {
+                report.time_budget_exhausted = true;
+                break;
+            }
+
+            // Reconstruir com células maiores quando o índice fica esparso,
+            // evitando varrer anéis vazios no fim do percurso
+            if (grid.live() * 4 < grid.built_with() && grid.built_with() > 64) {
+                std::vector<uint32_t> live;
+                live.reserve(remaining);
+                for (uint32_t s : members) {
+                    if (!used[s]) {
+                        live.push_back(s);
+                    }
+                }
+                grid.build(live, options_.allow_reversal);
+            }
+
+            int64_t entry = grid.nearest(current);
+            if (entry < 0) {
+                break;
+            }
+            uint32_t s = static_cast<uint32_t>(entry >> 1);
+            bool reversed = (entry & 1) != 0;
+
+            grid.remove(s << 1);
+            if (options_.allow_reversal) {
+                grid.remove((s << 1) | 1);
+            }
+            used[s] = true;
+            --remaining;
+
+            OrientedStroke chosen{s, reversed};
+            order.push_back(chosen);
+            current = end_of(strokes, chosen);
+        }
+
+        // Orçamento esgotado: manter os traços restantes na ordem original
+        for (uint32_t s : members) {
+            if (!used[s]) {
+                order.push_back({s, false});
+                current = strokes[s].points.back();
+            }
+        }
+
+        // 3. 2-opt com janela limitada: inverter o trecho [i, j] troca as
+        // arestas (a->b, c->d) por (a->c, b->d) sem mudar o desenho interno
+        if (options_.allow_reversal && !report.time_budget_exhausted) {
+            size_t n = order.size() - group_begin;
+            bool improved = true;
+            for (size_t pass = 0; pass < options_.two_opt_passes && improved &&
+                                  !report.time_budget_exhausted; ++pass) {
+                improved = false;
+                for (size_t i = 0; i < n && !report.time_budget_exhausted; ++i) {
+                    if ((++iterations & 1023) == 0 && Clock::now() > deadline) {
+                        report.time_budget_exhausted = true;
+                        break;
+                    }
+                    size_t gi = group_begin + i;
+                    PlotPoint a = (gi == 0) ? PlotPoint{0.0, 0.0}
+                                            : end_of(strokes, order[gi - 1]);
+                    size_t j_end = std::min(n, i + options_.two_opt_window);
+                    for (size_t j = i + 1; j < j_end; ++j) {
+                        size_t gj = group_begin + j;
+                        const PlotPoint& b = start_of(strokes, order[gi]);
+                        const PlotPoint& c = end_of(strokes, order[gj]);
+                        double delta = distance(a, c) - distance(a, b);
+                        if (j + 1 < n) {
+                            const PlotPoint& d = start_of(strokes, order[gj + 1]);
+                            delta += distance(b, d) - distance(c, d);
+                        }
+                        if (delta < -1e-9) {
+                            std::reverse(order.begin() + gi, order.begin() + gj + 1);
+                            for (size_t k = gi; k <= gj; ++k) {
+                                order[k].reversed = !order[k].reversed;
+                            }
+                            improved = true;
+                        }
+                    }
+                }
+            }
+            if (n > 0) {
+                current = end_of(strokes, order.back());
+            }
+        }
+    }
+
+    // 4. Montar a saída unindo traços contíguos da mesma caneta
+    std::vector<Polyline> result;
+    result.reserve(order.size());
+    for (const auto& o : order) {
+        const Polyline& src = strokes[o.index];
+        const PlotPoint& first = start_of(strokes, o);
+
+        if (!result.empty() && result.back().pen == src.pen &&
+            distance(result.back().points.back(), first) <= options_.merge_tolerance) {
+            auto& dst = result.back().points;
+            if (o.reversed) {
+                dst.insert(dst.end(), src.points.rbegin() + 1, src.points.rend());
+            } else {
+                dst.insert(dst.end(), src.points.begin() + 1, src.points.end());
+            }
+            continue;
+        }
+
+        Polyline stroke;
+        stroke.pen = src.pen;
+        if (o.reversed) {
+            stroke.points.assign(src.points.rbegin(), src.points.rend());
+        } else {
+            stroke.points = src.points;
+        }
+        result.push_back(std::move(stroke));
+    }
+
+    // Junções de traços unidos podem ter criado pontos colineares
+    for (auto& stroke : result) {
+        clean_stroke(stroke, ZERO_LENGTH, options_.collinear_tolerance);
+    }
+    strokes.swap(result);
+
+    for (const auto& stroke : strokes) {
+        report.strokes_after++;
+        report.segments_after += stroke.points.size() - 1;
+    }
+    report.pen_up_mm_after = pen_up_distance(strokes) / PLOTTER_UNITS_PER_MM;
+    report.estimated_seconds_after = estimate_seconds(
+        pen_down_distance(strokes),
+        report.pen_up_mm_after * PLOTTER_UNITS_PER_MM,
+        report.strokes_after);
+
+    return report;
+}
+
+}  // namespace protocols
+}  // namespace all_press
@@ -0,0 +1,1493 @@
+#include "protocols/svg_reader.h"
+#include "raster/icc_catalog.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+namespace all_press {
+namespace protocols {
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double PX_PER_MM = 96.0 / 25.4;
+constexpr int MAX_CURVE_SEGMENTS = 4096;
+constexpr double MIN_VISIBLE_ALPHA = 1.0 / 512.0;
+
+using Rgb = std::array<uint8_t, 3>;
+
+struct Point {
+    double x;
+    double y;
+};
+
+// x' = a x + c y + e; y' = b x + d y + f
+struct Matrix {
+    double a = 1.0;
+    double b = 0.0;
+    double c = 0.0;
+    double d = 1.0;
+    double e = 0.0;
+    double f = 0.0;
+
+    Point apply(const Point& p) const { return Point{a * p.x + c * p.y + e, b * p.x + d * p.y + f}; }
+
+    // Aplica m primeiro e depois esta matriz
+    Matrix operator*(const Matrix& m) const {
+        return Matrix{a * m.a + c * m.b, b * m.a + d * m.b, a * m.c + c * m.d,
+                      b * m.c + d * m.d, a * m.e + c * m.f + e, b * m.e + d * m.f + f};
+    }
+
+    double scale() const { return std::sqrt(std::fabs(a * d - b * c)); }
+    double max_scale() const { return std::max(std::hypot(a, b), std::hypot(c, d)); }
+};
+
+Matrix translation(double x, double y) { return Matrix{1.0, 0.0, 0.0, 1.0, x, y}; }
+Matrix scaling(double x, double y) { return Matrix{x, 0.0, 0.0, y, 0.0, 0.0}; }
+
+struct Paint {
+    enum class Kind { NONE, COLOR, CURRENT };
+    Kind kind = Kind::NONE;
+    Rgb rgb = {0, 0, 0};
+    double alpha = 1.0;
+    bool gradient = false;   // url(): desenhado em cinza
+};
+
+// Estado gráfico herdado pelos filhos
+struct State {
+    Matrix ctm;
+    Paint fill{Paint::Kind::COLOR, {0, 0, 0}, 1.0, false};
+    Paint stroke;
+    double stroke_width = 1.0;
+    bool even_odd = false;
+    double opacity = 1.0;          // Produto das opacidades dos grupos
+    double fill_opacity = 1.0;
+    double stroke_opacity = 1.0;
+    bool visible = true;
+    Rgb color = {0, 0, 0};         // currentColor
+    double viewport_w = 0.0;       // Em unidades de usuário, para porcentagens
+    double viewport_h = 0.0;
+    bool skip = false;             // Subárvore não desenhada
+};
+
+struct Subpath {
+    std::vector<Point> points;
+    bool closed = false;
+};
+
+struct Attribute {
+    std::string name;
+    std::string value;
+};
+
+struct Tag {
+    std::string raw_name;
+    std::string name;              // Sem o prefixo svg:
+    std::vector<Attribute> attributes;
+    bool closing = false;
+    bool self_closing = false;
+
+    const std::string* get(const char* key) const {
+        for (const auto& attribute : attributes) {
+            if (attribute.name == key) {
+                return &attribute.value;
+            }
+        }
+        return nullptr;
+    }
+};
+
+using Declarations = std::vector<std::pair<std::string, std::string>>;
+
+struct CssRule {
+    std::string selector;   // tag, .classe ou #id
+    Declarations declarations;
+};
+
+bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+std::string trim(const std::string& text) {
+    size_t begin = 0;
+    size_t end = text.size();
+    while (begin < end && is_space(text[begin])) {
+        ++begin;
+    }
+    while (end > begin && is_space(text[end - 1])) {
+        --end;
+    }
+    return text.substr(begin, end - begin);
+}
+
+std::string lower(std::string text) {
+    for (auto& c : text) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return text;
+}
+
+// Números de path data e listas: separadores opcionais ("1-2", "0.5.5")
+class NumberReader {
+public:
+    explicit NumberReader(const std::string& text) : text_(text) {}
+
+    bool at_end() {
+        skip_separators();
+        return pos_ >= text_.size();
+    }
+
+    char peek() {
+        skip_separators();
+        return pos_ < text_.size() ? text_[pos_] : '\0';
+    }
+
+    void advance() { ++pos_; }
+
+    bool number(double& out) {
+        skip_separators();
+        size_t i = pos_;
+        if (i < text_.size() && (text_[i] == '+' || text_[i] == '-')) {
+            ++i;
+        }
+        size_t digits = 0;
+        while (i < text_.size() && std::isdigit(static_cast<unsigned char>(text_[i]))) {
+            ++i;
+            ++digits;
+        }
+        if (i < text_.size() && text_[i] == '.') {
+            ++i;
+            while (i < text_.size() && std::isdigit(static_cast<unsigned char>(text_[i]))) {
+                ++i;
+                ++digits;
+            }
+        }
+        if (digits == 0) {
+            return false;
+        }
+        if (i < text_.size() && (text_[i] == 'e' || text_[i] == 'E')) {
+            size_t j = i + 1;
+            if (j < text_.size() && (text_[j] == '+' || text_[j] == '-')) {
+                ++j;
+            }
+            if (j < text_.size() && std::isdigit(static_cast<unsigned char>(text_[j]))) {
+                while (j < text_.size() && std::isdigit(static_cast<unsigned char>(text_[j]))) {
+                    ++j;
+                }
+                i = j;
+            }
+        }
+        char buffer[64];
+        const size_t n = std::min(i - pos_, sizeof(buffer) - 1);
+        std::memcpy(buffer, text_.data() + pos_, n);
+        buffer[n] = '\0';
+        out = std::strtod(buffer, nullptr);
+        pos_ = i;
+        return std::isfinite(out);
+    }
+
+    // Flags de arco podem vir colados: "a1 1 0 00 1 1"
+    bool flag(bool& out) {
+        skip_separators();
+        if (pos_ < text_.size() && (text_[pos_] == '0' || text_[pos_] == '1')) {
+            out = text_[pos_++] == '1';
+            return true;
+        }
+        return false;
+    }
+
+private:
+    void skip_separators() {
+        while (pos_ < text_.size() && (is_space(text_[pos_]) || text_[pos_] == ',')) {
+            ++pos_;
+        }
+    }
+
+    const std::string& text_;
+    size_t pos_ = 0;
+};
+
+// Comprimento em px; reference é a base de porcentagens
+bool parse_length(const std::string& text, double reference, double& out) {
+    const std::string value = trim(text);
+    const char* begin = value.c_str();
+    char* end = nullptr;
+    const double number = std::strtod(begin, &end);
+    if (end == begin || !std::isfinite(number)) {
+        return false;
+    }
+    const std::string unit = lower(trim(end));
+    double factor = 1.0;
+    if (unit.empty() || unit == "px") {
+        factor = 1.0;
+    } else if (unit == "mm") {
+        factor = PX_PER_MM;
+    } else if (unit == "cm") {
+        factor = PX_PER_MM * 10.0;
+    } else if (unit == "in") {
+        factor = 96.0;
+    } else if (unit == "pt") {
+        factor = 96.0 / 72.0;
+    } else if (unit == "pc") {
+        factor = 16.0;
+    } else if (unit == "em") {
+        factor = 16.0;
+    } else if (unit == "ex") {
+        factor = 8.0;
+    } else if (unit == "%") {
+        factor = reference / 100.0;
+    } else {
+        return false;
+    }
+    out = number * factor;
+    return true;
+}
+
+double length_attribute(const Tag& tag, const char* name, double reference, double fallback) {
+    const std::string* value = tag.get(name);
+    double result = fallback;
+    if (value && !parse_length(*value, reference, result)) {
+        result = fallback;
+    }
+    return result;
+}
+
+bool parse_hex_color(const std::string& hex, Rgb& rgb, double& alpha) {
+    for (char c : hex) {
+        if (!std::isxdigit(static_cast<unsigned char>(c))) {
+            return false;
+        }
+    }
+    auto digit = [&](size_t i) { return static_cast<int>(std::strtol(hex.substr(i, 1).c_str(), nullptr, 16)); };
+    auto pair = [&](size_t i) { return static_cast<int>(std::strtol(hex.substr(i, 2).c_str(), nullptr, 16)); };
+    alpha = 1.0;
+    if (hex.size() == 3 || hex.size() == 4) {
+        for (int c = 0; c < 3; ++c) {
+            rgb[c] = static_cast<uint8_t>(digit(c) * 17);
+        }
+        if (hex.size() == 4) {
+            alpha = digit(3) * 17 / 255.0;
+        }
+        return true;
+    }
+    if (hex.size() == 6 || hex.size() == 8) {
+        for (int c = 0; c < 3; ++c) {
+            rgb[c] = static_cast<uint8_t>(pair(c * 2));
+        }
+        if (hex.size() == 8) {
+            alpha = pair(6) / 255.0;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool named_color(const std::string& name, Rgb& rgb) {
+    struct Named {
+        const char* name;
+        uint32_t rgb;
+    };
+    static const Named COLORS[] = {
+        {"aliceblue", 0xf0f8ff}, {"antiquewhite", 0xfaebd7}, {"aqua", 0x00ffff},
+        {"aquamarine", 0x7fffd4}, {"azure", 0xf0ffff}, {"beige", 0xf5f5dc},
+        {"bisque", 0xffe4c4}, {"black", 0x000000}, {"blanchedalmond", 0xffebcd},
+        {"blue", 0x0000ff}, {"blueviolet", 0x8a2be2}, {"brown", 0xa52a2a},
+        {"burlywood", 0xdeb887}, {"cadetblue", 0x5f9ea0}, {"chartreuse", 0x7fff00},
+        {"chocolate", 0xd2691e}, {"coral", 0xff7f50}, {"cornflowerblue", 0x6495ed},
+        {"cornsilk", 0xfff8dc}, {"crimson", 0xdc143c}, {"cyan", 0x00ffff},
+        {"darkblue", 0x00008b}, {"darkcyan", 0x008b8b}, {"darkgoldenrod", 0xb8860b},
+        {"darkgray", 0xa9a9a9}, {"darkgreen", 0x006400}, {"darkgrey", 0xa9a9a9},
+        {"darkkhaki", 0xbdb76b}, {"darkmagenta", 0x8b008b}, {"darkolivegreen", 0x556b2f},
+        {"darkorange", 0xff8c00}, {"darkorchid", 0x9932cc}, {"darkred", 0x8b0000},
+        {"darksalmon", 0xe9967a}, {"darkseagreen", 0x8fbc8f}, {"darkslateblue", 0x483d8b},
+        {"darkslategray", 0x2f4f4f}, {"darkslategrey", 0x2f4f4f}, {"darkturquoise", 0x00ced1},
+        {"darkviolet", 0x9400d3}, {"deeppink", 0xff1493}, {"deepskyblue", 0x00bfff},
+        {"dimgray", 0x696969}, {"dimgrey", 0x696969}, {"dodgerblue", 0x1e90ff},
+        {"firebrick", 0xb22222}, {"floralwhite", 0xfffaf0}, {"forestgreen", 0x228b22},
+        {"fuchsia", 0xff00ff}, {"gainsboro", 0xdcdcdc}, {"ghostwhite", 0xf8f8ff},
+        {"gold", 0xffd700}, {"goldenrod", 0xdaa520}, {"gray", 0x808080},
+        {"green", 0x008000}, {"greenyellow", 0xadff2f}, {"grey", 0x808080},
+        {"honeydew", 0xf0fff0}, {"hotpink", 0xff69b4}, {"indianred", 0xcd5c5c},
+        {"indigo", 0x4b0082}, {"ivory", 0xfffff0}, {"khaki", 0xf0e68c},
+        {"lavender", 0xe6e6fa}, {"lavenderblush", 0xfff0f5}, {"lawngreen", 0x7cfc00},
+        {"lemonchiffon", 0xfffacd}, {"lightblue", 0xadd8e6}, {"lightcoral", 0xf08080},
+        {"lightcyan", 0xe0ffff}, {"lightgoldenrodyellow", 0xfafad2}, {"lightgray", 0xd3d3d3},
+        {"lightgreen", 0x90ee90}, {"lightgrey", 0xd3d3d3}, {"lightpink", 0xffb6c1},
+        {"lightsalmon", 0xffa07a}, {"lightseagreen", 0x20b2aa}, {"lightskyblue", 0x87cefa},
+        {"lightslategray", 0x778899}, {"lightslategrey", 0x778899}, {"lightsteelblue", 0xb0c4de},
+        {"lightyellow", 0xffffe0}, {"lime", 0x00ff00}, {"limegreen", 0x32cd32},
+        {"linen", 0xfaf0e6}, {"magenta", 0xff00ff}, {"maroon", 0x800000},
+        {"mediumaquamarine", 0x66cdaa}, {"mediumblue", 0x0000cd}, {"mediumorchid", 0xba55d3},
+        {"mediumpurple", 0x9370db}, {"mediumseagreen", 0x3cb371}, {"mediumslateblue", 0x7b68ee},
+        {"mediumspringgreen", 0x00fa9a}, {"mediumturquoise", 0x48d1cc}, {"mediumvioletred", 0xc71585},
+        {"midnightblue", 0x191970}, {"mintcream", 0xf5fffa}, {"mistyrose", 0xffe4e1},
+        {"moccasin", 0xffe4b5}, {"navajowhite", 0xffdead}, {"navy", 0x000080},
+        {"oldlace", 0xfdf5e6}, {"olive", 0x808000}, {"olivedrab", 0x6b8e23},
+        {"orange", 0xffa500}, {"orangered", 0xff4500}, {"orchid", 0xda70d6},
+        {"palegoldenrod", 0xeee8aa}, {"palegreen", 0x98fb98}, {"paleturquoise", 0xafeeee},
+        {"palevioletred", 0xdb7093}, {"papayawhip", 0xffefd5}, {"peachpuff", 0xffdab9},
+        {"peru", 0xcd853f}, {"pink", 0xffc0cb}, {"plum", 0xdda0dd},
+        {"powderblue", 0xb0e0e6}, {"purple", 0x800080}, {"rebeccapurple", 0x663399},
+        {"red", 0xff0000}, {"rosybrown", 0xbc8f8f}, {"royalblue", 0x4169e1},
+        {"saddlebrown", 0x8b4513}, {"salmon", 0xfa8072}, {"sandybrown", 0xf4a460},
+        {"seagreen", 0x2e8b57}, {"seashell", 0xfff5ee}, {"sienna", 0xa0522d},
+        {"silver", 0xc0c0c0}, {"skyblue", 0x87ceeb}, {"slateblue", 0x6a5acd},
+        {"slategray", 0x708090}, {"slategrey", 0x708090}, {"snow", 0xfffafa},
+        {"springgreen", 0x00ff7f}, {"steelblue", 0x4682b4}, {"tan", 0xd2b48c},
+        {"teal", 0x008080}, {"thistle", 0xd8bfd8}, {"tomato", 0xff6347},
+        {"turquoise", 0x40e0d0}, {"violet", 0xee82ee}, {"wheat", 0xf5deb3},
+        {"white", 0xffffff}, {"whitesmoke", 0xf5f5f5}, {"yellow", 0xffff00},
+        {"yellowgreen", 0x9acd32}};
+    for (const auto& color : COLORS) {
+        if (name == color.name) {
+            rgb = {static_cast<uint8_t>(color.rgb >> 16), static_cast<uint8_t>(color.rgb >> 8),
+                   static_cast<uint8_t>(color.rgb)};
+            return true;
+        }
+    }
+    return false;
+}
+
+// #rgb, #rrggbb (com alfa opcional), rgb()/rgba() e nomes CSS
+bool parse_color(const std::string& text, Rgb& rgb, double& alpha) {
+    const std::string value = lower(trim(text));
+    alpha = 1.0;
+    if (!value.empty() && value[0] == '#') {
+        return parse_hex_color(value.substr(1), rgb, alpha);
+    }
+    if (value.compare(0, 4, "rgb(") == 0 || value.compare(0, 5, "rgba(") == 0) {
+        const size_t open = value.find('(');
+        const size_t close = value.find(')', open);
+        if (close == std::string::npos) {
+            return false;
+        }
+        std::string body = value.substr(open + 1, close - open - 1);
+        std::replace(body.begin(), body.end(), '/', ' ');
+        double components[4] = {0.0, 0.0, 0.0, 1.0};
+        const char* p = body.c_str();
+        int count = 0;
+        while (count < 4) {
+            while (*p && (is_space(*p) || *p == ',')) {
+                ++p;
+            }
+            char* end = nullptr;
+            double v = std::strtod(p, &end);
+            if (end == p) {
+                break;
+            }
+            p = end;
+            if (*p == '%') {
+                v = count < 3 ? v * 2.55 : v / 100.0;
+                ++p;
+            }
+            components[count++] = v;
+        }
+        if (count < 3) {
+            return false;
+        }
+        for (int c = 0; c < 3; ++c) {
+            rgb[c] = static_cast<uint8_t>(std::lround(std::min(255.0, std::max(0.0, components[c]))));
+        }
+        alpha = std::min(1.0, std::max(0.0, components[3]));
+        return true;
+    }
+    return named_color(value, rgb);
+}
+
+bool parse_paint(const std::string& text, Paint& paint) {
+    const std::string value = trim(text);
+    const std::string key = lower(value);
+    if (key == "none") {
+        paint = Paint{};
+        return true;
+    }
+    if (key == "currentcolor") {
+        paint = Paint{Paint::Kind::CURRENT, {0, 0, 0}, 1.0, false};
+        return true;
+    }
+    if (key.compare(0, 4, "url(") == 0) {
+        // Cor de reserva depois do url(), se houver; senão cinza médio
+        const size_t close = value.find(')');
+        const std::string fallback = close == std::string::npos ? "" : trim(value.substr(close + 1));
+        if (!fallback.empty() && parse_paint(fallback, paint)) {
+            return true;
+        }
+        paint = Paint{Paint::Kind::COLOR, {160, 160, 160}, 1.0, true};
+        return true;
+    }
+    Rgb rgb;
+    double alpha = 1.0;
+    if (!parse_color(value, rgb, alpha)) {
+        return false;
+    }
+    paint = Paint{Paint::Kind::COLOR, rgb, alpha, false};
+    return true;
+}
+
+// Lista de transformações aplicadas da direita para a esquerda. Lista
+// malformada vale como identidade.
+Matrix parse_transform(const std::string& text) {
+    Matrix result;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        while (pos < text.size() && (is_space(text[pos]) || text[pos] == ',')) {
+            ++pos;
+        }
+        if (pos >= text.size()) {
+            break;
+        }
+        const size_t open = text.find('(', pos);
+        const size_t close = open == std::string::npos ? open : text.find(')', open);
+        if (close == std::string::npos) {
+            return Matrix{};
+        }
+        const std::string name = trim(text.substr(pos, open - pos));
+        const std::string args = text.substr(open + 1, close - open - 1);
+        NumberReader reader(args);
+        std::vector<double> values;
+        double v = 0.0;
+        while (values.size() < 6 && reader.number(v)) {
+            values.push_back(v);
+        }
+        if (!reader.at_end()) {
+            return Matrix{};
+        }
+        const size_t n = values.size();
+        Matrix m;
+        if (name == "matrix" && n == 6) {
+            m = Matrix{values[0], values[1], values[2], values[3], values[4], values[5]};
+        } else if (name == "translate" && (n == 1 || n == 2)) {
+            m = translation(values[0], n == 2 ? values[1] : 0.0);
+        } else if (name == "scale" && (n == 1 || n == 2)) {
+            m = scaling(values[0], n == 2 ? values[1] : values[0]);
+        } else if (name == "rotate" && (n == 1 || n == 3)) {
+            const double angle = values[0] * PI / 180.0;
+            const double cos_a = std::cos(angle);
+            const double sin_a = std::sin(angle);
+            m = Matrix{cos_a, sin_a, -sin_a, cos_a, 0.0, 0.0};
+            if (n == 3) {
+                m = translation(values[1], values[2]) * m * translation(-values[1], -values[2]);
+            }
+        } else if (name == "skewX" && n == 1) {
+            m = Matrix{1.0, 0.0, std::tan(values[0] * PI / 180.0), 1.0, 0.0, 0.0};
+        } else if (name == "skewY" && n == 1) {
+            m = Matrix{1.0, std::tan(values[0] * PI / 180.0), 0.0, 1.0, 0.0, 0.0};
+        } else {
+            return Matrix{};
+        }
+        result = result * m;
+        pos = close + 1;
+    }
+    return result;
+}
+
+// Mapeamento viewBox -> viewport de preserveAspectRatio (padrão xMidYMid meet)
+Matrix viewbox_transform(const double box[4], double width, double height, const std::string* aspect) {
+    if (!(width > 0.0) || !(height > 0.0)) {
+        return translation(-box[0], -box[1]);
+    }
+    double sx = width / box[2];
+    double sy = height / box[3];
+    const std::string mode = aspect ? trim(*aspect) : std::string("xMidYMid meet");
+    if (mode.compare(0, 4, "none") != 0) {
+        const double s = mode.find("slice") != std::string::npos ? std::max(sx, sy) : std::min(sx, sy);
+        sx = s;
+        sy = s;
+    }
+    double align_x = 0.5;
+    double align_y = 0.5;
+    if (mode.find("xMin") != std::string::npos) {
+        align_x = 0.0;
+    } else if (mode.find("xMax") != std::string::npos) {
+        align_x = 1.0;
+    }
+    if (mode.find("YMin") != std::string::npos) {
+        align_y = 0.0;
+    } else if (mode.find("YMax") != std::string::npos) {
+        align_y = 1.0;
+    }
+    const double tx = (width - box[2] * sx) * align_x - box[0] * sx;
+    const double ty = (height - box[3] * sy) * align_y - box[1] * sy;
+    return Matrix{sx, 0.0, 0.0, sy, tx, ty};
+}
+
+bool parse_viewbox(const Tag& tag, double box[4]) {
+    const std::string* value = tag.get("viewBox");
+    if (!value) {
+        return false;
+    }
+    NumberReader reader(*value);
+    for (int i = 0; i < 4; ++i) {
+        if (!reader.number(box[i])) {
+            return false;
+        }
+    }
+    return box[2] > 0.0 && box[3] > 0.0;
+}
+
+int curve_segments(double radius, double sweep, double tolerance) {
+    if (!(radius > tolerance)) {
+        return std::max(1, static_cast<int>(std::ceil(std::fabs(sweep) / (PI / 2.0))));
+    }
+    const double step = 2.0 * std::acos(1.0 - tolerance / radius);
+    const double n = std::ceil(std::fabs(sweep) / step);
+    return static_cast<int>(std::min<double>(MAX_CURVE_SEGMENTS, std::max(1.0, n)));
+}
+
+// Contornos em unidades de usuário; curvas e arcos viram segmentos com
+// desvio abaixo da tolerância
+class PathBuilder {
+public:
+    explicit PathBuilder(double tolerance) : tolerance_(tolerance) {}
+
+    Point current() const { return current_; }
+
+    void move_to(const Point& p) {
+        subpaths_.emplace_back();
+        subpaths_.back().points.push_back(p);
+        current_ = p;
+        start_ = p;
+        open_ = true;
+    }
+
+    void line_to(const Point& p) {
+        if (!open_) {
+            move_to(current_);   // Comando depois de Z reabre no início do anterior
+        }
+        subpaths_.back().points.push_back(p);
+        current_ = p;
+    }
+
+    void cubic_to(const Point& c1, const Point& c2, const Point& p) {
+        const Point p0 = current_;
+        const double dx = std::max(std::fabs(p0.x - 2.0 * c1.x + c2.x), std::fabs(c1.x - 2.0 * c2.x + p.x));
+        const double dy = std::max(std::fabs(p0.y - 2.0 * c1.y + c2.y), std::fabs(c1.y - 2.0 * c2.y + p.y));
+        const int n = segments_for(std::sqrt(0.75 * std::hypot(dx, dy) / tolerance_));
+        for (int k = 1; k < n; ++k) {
+            const double t = static_cast<double>(k) / n;
+            const double u = 1.0 - t;
+            const double w0 = u * u * u;
+            const double w1 = 3.0 * u * u * t;
+            const double w2 = 3.0 * u * t * t;
+            const double w3 = t * t * t;
+            line_to(Point{w0 * p0.x + w1 * c1.x + w2 * c2.x + w3 * p.x,
+                          w0 * p0.y + w1 * c1.y + w2 * c2.y + w3 * p.y});
+        }
+        line_to(p);
+    }
+
+    void quad_to(const Point& c, const Point& p) {
+        const Point p0 = current_;
+        const double d = std::hypot(p0.x - 2.0 * c.x + p.x, p0.y - 2.0 * c.y + p.y);
+        const int n = segments_for(std::sqrt(0.25 * d / tolerance_));
+        for (int k = 1; k < n; ++k) {
+            const double t = static_cast<double>(k) / n;
+            const double u = 1.0 - t;
+            line_to(Point{u * u * p0.x + 2.0 * u * t * c.x + t * t * p.x,
+                          u * u * p0.y + 2.0 * u * t * c.y + t * t * p.y});
+        }
+        line_to(p);
+    }
+
+    // Arco elíptico por extremidades (SVG 1.1, apêndice F.6)
+    void arc_to(double rx, double ry, double rotation_deg, bool large, bool sweep, const Point& p) {
+        const Point p0 = current_;
+        if (p0.x == p.x && p0.y == p.y) {
+            return;
+        }
+        rx = std::fabs(rx);
+        ry = std::fabs(ry);
+        if (rx == 0.0 || ry == 0.0) {
+            line_to(p);
+            return;
+        }
+        const double phi = rotation_deg * PI / 180.0;
+        const double cos_phi = std::cos(phi);
+        const double sin_phi = std::sin(phi);
+        const double hx = (p0.x - p.x) * 0.5;
+        const double hy = (p0.y - p.y) * 0.5;
+        const double x1 = cos_phi * hx + sin_phi * hy;
+        const double y1 = -sin_phi * hx + cos_phi * hy;
+        const double lambda = (x1 * x1) / (rx * rx) + (y1 * y1) / (ry * ry);
+        if (lambda > 1.0) {
+            rx *= std::sqrt(lambda);
+            ry *= std::sqrt(lambda);
+        }
+        const double num = rx * rx * ry * ry - rx * rx * y1 * y1 - ry * ry * x1 * x1;
+        const double den = rx * rx * y1 * y1 + ry * ry * x1 * x1;
+        const double coef = (large != sweep ? 1.0 : -1.0) * std::sqrt(std::max(0.0, num / den));
+        const double cx1 = coef * rx * y1 / ry;
+        const double cy1 = -coef * ry * x1 / rx;
+        const double cx = cos_phi * cx1 - sin_phi * cy1 + (p0.x + p.x) * 0.5;
+        const double cy = sin_phi * cx1 + cos_phi * cy1 + (p0.y + p.y) * 0.5;
+        const double theta = std::atan2((y1 - cy1) / ry, (x1 - cx1) / rx);
+        double delta = std::atan2((-y1 - cy1) / ry, (-x1 - cx1) / rx) - theta;
+        if (sweep && delta < 0.0) {
+            delta += 2.0 * PI;
+        } else if (!sweep && delta > 0.0) {
+            delta -= 2.0 * PI;
+        }
+        const int n = curve_segments(std::max(rx, ry), delta, tolerance_);
+        for (int k = 1; k < n; ++k) {
+            const double t = theta + delta * k / n;
+            const double ex = rx * std::cos(t);
+            const double ey = ry * std::sin(t);
+            line_to(Point{cx + ex * cos_phi - ey * sin_phi, cy + ex * sin_phi + ey * cos_phi});
+        }
+        line_to(p);
+    }
+
+    void ellipse(double cx, double cy, double rx, double ry) {
+        const int n = std::max(8, curve_segments(std::max(rx, ry), 2.0 * PI, tolerance_));
+        move_to(Point{cx + rx, cy});
+        for (int k = 1; k < n; ++k) {
+            const double t = 2.0 * PI * k / n;
+            line_to(Point{cx + rx * std::cos(t), cy + ry * std::sin(t)});
+        }
+        close();
+    }
+
+    void close() {
+        if (open_ && !subpaths_.empty()) {
+            subpaths_.back().closed = true;
+            current_ = start_;
+            open_ = false;
+        }
+    }
+
+    std::vector<Subpath>& subpaths() { return subpaths_; }
+
+private:
+    static int segments_for(double n) {
+        return static_cast<int>(std::min<double>(MAX_CURVE_SEGMENTS, std::max(1.0, std::ceil(n))));
+    }
+
+    std::vector<Subpath> subpaths_;
+    Point current_ = {0.0, 0.0};
+    Point start_ = {0.0, 0.0};
+    bool open_ = false;
+    double tolerance_;
+};
+
+// Path data completo; um erro encerra o path no ponto em que está, como
+// manda a especificação
+void parse_path_data(const std::string& data, PathBuilder& builder) {
+    NumberReader reader(data);
+    char command = 0;
+    char previous = 0;
+    Point control = {0.0, 0.0};   // Último controle de C/S ou Q/T
+    bool started = false;
+
+    while (!reader.at_end()) {
+        const char c = reader.peek();
+        if (std::isalpha(static_cast<unsigned char>(c))) {
+            if (!std::strchr("MmLlHhVvCcSsQqTtAaZz", c)) {
+                return;
+            }
+            command = c;
+            reader.advance();
+            if (command == 'Z' || command == 'z') {
+                builder.close();
+                previous = 'Z';
+                continue;
+            }
+        } else if (command == 0 || command == 'Z' || command == 'z') {
+            return;
+        }
+        if (!started && command != 'M' && command != 'm') {
+            return;
+        }
+
+        const bool relative = std::islower(static_cast<unsigned char>(command)) != 0;
+        const Point cur = builder.current();
+        auto point = [&](Point& p) {
+            if (!reader.number(p.x) || !reader.number(p.y)) {
+                return false;
+            }
+            if (relative) {
+                p.x += cur.x;
+                p.y += cur.y;
+            }
+            return true;
+        };
+
+        const char upper = static_cast<char>(std::toupper(static_cast<unsigned char>(command)));
+        Point p{0.0, 0.0};
+        switch (upper) {
+        case 'M':
+            if (!point(p)) {
+                return;
+            }
+            builder.move_to(p);
+            started = true;
+            command = relative ? 'l' : 'L';   // Pares seguintes são lineto
+            break;
+        case 'L':
+            if (!point(p)) {
+                return;
+            }
+            builder.line_to(p);
+            break;
+        case 'H': {
+            double x = 0.0;
+            if (!reader.number(x)) {
+                return;
+            }
+            builder.line_to(Point{relative ? cur.x + x : x, cur.y});
+            break;
+        }
+        case 'V': {
+            double y = 0.0;
+            if (!reader.number(y)) {
+                return;
+            }
+            builder.line_to(Point{cur.x, relative ? cur.y + y : y});
+            break;
+        }
+        case 'C': {
+            Point c1, c2;
+            if (!point(c1) || !point(c2) || !point(p)) {
+                return;
+            }
+            builder.cubic_to(c1, c2, p);
+            control = c2;
+            break;
+        }
+        case 'S': {
+            Point c2;
+            if (!point(c2) || !point(p)) {
+                return;
+            }
+            const Point c1 = previous == 'C' || previous == 'S'
+                ? Point{2.0 * cur.x - control.x, 2.0 * cur.y - control.y}
+                : cur;
+            builder.cubic_to(c1, c2, p);
+            control = c2;
+            break;
+        }
+        case 'Q': {
+            Point c1;
+            if (!point(c1) || !point(p)) {
+                return;
+            }
+            builder.quad_to(c1, p);
+            control = c1;
+            break;
+        }
+        case 'T': {
+            if (!point(p)) {
+                return;
+            }
+            const Point c1 = previous == 'Q' || previous == 'T'
+                ? Point{2.0 * cur.x - control.x, 2.0 * cur.y - control.y}
+                : cur;
+            builder.quad_to(c1, p);
+            control = c1;
+            break;
+        }
+        case 'A': {
+            double rx = 0.0, ry = 0.0, rotation = 0.0;
+            bool large = false, sweep = false;
+            if (!reader.number(rx) || !reader.number(ry) || !reader.number(rotation) ||
+                !reader.flag(large) || !reader.flag(sweep) || !point(p)) {
+                return;
+            }
+            builder.arc_to(rx, ry, rotation, large, sweep, p);
+            break;
+        }
+        }
+        previous = upper;
+    }
+}
+
+void parse_declarations(const std::string& text, Declarations& out) {
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find(';', pos);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        const std::string item = text.substr(pos, end - pos);
+        const size_t colon = item.find(':');
+        if (colon != std::string::npos) {
+            std::string value = trim(item.substr(colon + 1));
+            const size_t important = value.find("!important");
+            if (important != std::string::npos) {
+                value = trim(value.substr(0, important));
+            }
+            out.emplace_back(lower(trim(item.substr(0, colon))), value);
+        }
+        pos = end + 1;
+    }
+}
+
+// Folha de estilo embutida: só seletores simples (tag, .classe, #id), que
+// cobrem o que Illustrator e Inkscape exportam
+void parse_css(std::string text, std::vector<CssRule>& rules) {
+    for (size_t open = text.find("/*"); open != std::string::npos; open = text.find("/*", open)) {
+        const size_t close = text.find("*/", open + 2);
+        text.erase(open, close == std::string::npos ? std::string::npos : close + 2 - open);
+    }
+    size_t pos = 0;
+    while (pos < text.size()) {
+        const size_t open = text.find('{', pos);
+        if (open == std::string::npos) {
+            break;
+        }
+        const std::string selectors = trim(text.substr(pos, open - pos));
+        if (!selectors.empty() && selectors[0] == '@') {
+            // @media, @font-face...: pula o bloco inteiro
+            int depth = 0;
+            size_t i = open;
+            for (; i < text.size(); ++i) {
+                if (text[i] == '{') {
+                    ++depth;
+                } else if (text[i] == '}' && --depth == 0) {
+                    break;
+                }
+            }
+            pos = i + 1;
+            continue;
+        }
+        const size_t close = text.find('}', open);
+        if (close == std::string::npos) {
+            break;
+        }
+        Declarations declarations;
+        parse_declarations(text.substr(open + 1, close - open - 1), declarations);
+        size_t start = 0;
+        while (start <= selectors.size()) {
+            size_t comma = selectors.find(',', start);
+            if (comma == std::string::npos) {
+                comma = selectors.size();
+            }
+            const std::string selector = trim(selectors.substr(start, comma - start));
+            const bool simple = !selector.empty() &&
+                std::all_of(selector.begin() + ((selector[0] == '.' || selector[0] == '#') ? 1 : 0),
+                            selector.end(), [](char c) {
+                                return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_';
+                            });
+            if (simple) {
+                rules.push_back(CssRule{selector, declarations});
+            }
+            start = comma + 1;
+        }
+        pos = close + 1;
+    }
+}
+
+std::string decode_entities(const std::string& text) {
+    if (text.find('&') == std::string::npos) {
+        return text;
+    }
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        const size_t semi = text[i] == '&' ? text.find(';', i) : std::string::npos;
+        if (semi == std::string::npos || semi - i > 10) {
+            out += text[i];
+            continue;
+        }
+        const std::string entity = text.substr(i + 1, semi - i - 1);
+        long code = -1;
+        if (entity == "amp") {
+            code = '&';
+        } else if (entity == "lt") {
+            code = '<';
+        } else if (entity == "gt") {
+            code = '>';
+        } else if (entity == "quot") {
+            code = '"';
+        } else if (entity == "apos") {
+            code = '\'';
+        } else if (entity.size() > 1 && entity[0] == '#') {
+            code = entity[1] == 'x' || entity[1] == 'X'
+                ? std::strtol(entity.c_str() + 2, nullptr, 16)
+                : std::strtol(entity.c_str() + 1, nullptr, 10);
+        }
+        if (code <= 0 || code > 0x7f) {
+            out += text[i];   // Fora do ASCII não afeta atributos geométricos
+            continue;
+        }
+        out += static_cast<char>(code);
+        i = semi;
+    }
+    return out;
+}
+
+bool is_presentation_attribute(const std::string& name) {
+    static const char* const NAMES[] = {"fill", "stroke", "stroke-width", "fill-rule", "opacity",
+                                        "fill-opacity", "stroke-opacity", "visibility", "display",
+                                        "color"};
+    for (const char* known : NAMES) {
+        if (name == known) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Rgb blend_over_white(const Rgb& rgb, double alpha) {
+    Rgb out;
+    for (int c = 0; c < 3; ++c) {
+        out[c] = static_cast<uint8_t>(std::lround(255.0 - (255.0 - rgb[c]) * alpha));
+    }
+    return out;
+}
+
+class SvgParser {
+public:
+    SvgParser(const uint8_t* data, size_t size, const SvgReadOptions& options)
+        : data_(reinterpret_cast<const char*>(data)), size_(size), options_(options) {}
+
+    HpglDisplayList run() {
+        Tag tag;
+        while (next_tag(tag)) {
+            if (tag.closing) {
+                if (!stack_.empty()) {
+                    stack_.pop_back();
+                }
+                continue;
+            }
+            start_element(tag);
+        }
+        if (!found_root_) {
+            throw std::runtime_error("SVG without <svg> element");
+        }
+        list_.update_bounds();
+        return std::move(list_);
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    SvgReadOptions options_;
+    HpglDisplayList list_;
+    std::vector<State> stack_;
+    std::vector<CssRule> css_;
+    bool found_root_ = false;
+
+    bool starts_with(size_t at, const char* text) const {
+        const size_t n = std::strlen(text);
+        return at + n <= size_ && std::memcmp(data_ + at, text, n) == 0;
+    }
+
+    size_t find(size_t from, const char* text) const {
+        const size_t n = std::strlen(text);
+        for (size_t i = from; i + n <= size_; ++i) {
+            if (data_[i] == text[0] && std::memcmp(data_ + i, text, n) == 0) {
+                return i;
+            }
+        }
+        return size_;
+    }
+
+    // Próxima tag de elemento; comentários, instruções de processamento,
+    // DOCTYPE, CDATA e texto são pulados
+    bool next_tag(Tag& tag) {
+        while (pos_ < size_) {
+            const char* lt = static_cast<const char*>(std::memchr(data_ + pos_, '<', size_ - pos_));
+            if (!lt) {
+                pos_ = size_;
+                return false;
+            }
+            pos_ = static_cast<size_t>(lt - data_);
+            if (starts_with(pos_, "<!--")) {
+                pos_ = std::min(size_, find(pos_ + 4, "-->") + 3);
+                continue;
+            }
+            if (starts_with(pos_, "<![CDATA[")) {
+                pos_ = std::min(size_, find(pos_ + 9, "]]>") + 3);
+                continue;
+            }
+            if (starts_with(pos_, "<?")) {
+                pos_ = std::min(size_, find(pos_ + 2, "?>") + 2);
+                continue;
+            }
+            if (starts_with(pos_, "<!")) {
+                int depth = 0;
+                for (++pos_; pos_ < size_; ++pos_) {
+                    if (data_[pos_] == '[') {
+                        ++depth;
+                    } else if (data_[pos_] == ']') {
+                        --depth;
+                    } else if (data_[pos_] == '>' && depth <= 0) {
+                        break;
+                    }
+                }
+                ++pos_;
+                continue;
+            }
+            return read_tag(tag);
+        }
+        return false;
+    }
+
+    bool read_tag(Tag& tag) {
+        tag = Tag{};
+        ++pos_;
+        if (pos_ < size_ && data_[pos_] == '/') {
+            tag.closing = true;
+            ++pos_;
+        }
+        const size_t name_start = pos_;
+        while (pos_ < size_ && !is_space(data_[pos_]) && data_[pos_] != '>' && data_[pos_] != '/') {
+            ++pos_;
+        }
+        tag.raw_name.assign(data_ + name_start, pos_ - name_start);
+        tag.name = tag.raw_name.compare(0, 4, "svg:") == 0 ? tag.raw_name.substr(4) : tag.raw_name;
+
+        while (pos_ < size_) {
+            while (pos_ < size_ && is_space(data_[pos_])) {
+                ++pos_;
+            }
+            if (pos_ >= size_) {
+                break;
+            }
+            if (data_[pos_] == '>') {
+                ++pos_;
+                return true;
+            }
+            if (data_[pos_] == '/') {
+                tag.self_closing = true;
+                ++pos_;
+                continue;
+            }
+            const size_t attr_start = pos_;
+            while (pos_ < size_ && !is_space(data_[pos_]) && data_[pos_] != '=' && data_[pos_] != '>' &&
+                   data_[pos_] != '/') {
+                ++pos_;
+            }
+            Attribute attribute;
+            attribute.name.assign(data_ + attr_start, pos_ - attr_start);
+            while (pos_ < size_ && is_space(data_[pos_])) {
+                ++pos_;
+            }
+            if (pos_ < size_ && data_[pos_] == '=') {
+                ++pos_;
+                while (pos_ < size_ && is_space(data_[pos_])) {
+                    ++pos_;
+                }
+                if (pos_ < size_ && (data_[pos_] == '"' || data_[pos_] == '\'')) {
+                    const char quote = data_[pos_++];
+                    const char* end = static_cast<const char*>(std::memchr(data_ + pos_, quote, size_ - pos_));
+                    const size_t value_end = end ? static_cast<size_t>(end - data_) : size_;
+                    attribute.value = decode_entities(std::string(data_ + pos_, value_end - pos_));
+                    pos_ = std::min(size_, value_end + 1);
+                }
+            }
+            if (attribute.name.empty()) {
+                ++pos_;   // Caractere solto: evita laço infinito
+                continue;
+            }
+            tag.attributes.push_back(std::move(attribute));
+        }
+        return !tag.raw_name.empty();
+    }
+
+    void push(const Tag& tag, const State& state) {
+        if (!tag.self_closing) {
+            stack_.push_back(state);
+        }
+    }
+
+    void skip_subtree(const Tag& tag) {
+        State state = stack_.empty() ? State{} : stack_.back();
+        state.skip = true;
+        push(tag, state);
+    }
+
+    void read_style(const Tag& tag) {
+        if (tag.self_closing) {
+            return;
+        }
+        const std::string end_tag = "</" + tag.raw_name;
+        const size_t end = find(pos_, end_tag.c_str());
+        std::string text(data_ + pos_, end - pos_);
+        for (const char* marker : {"<![CDATA[", "]]>"}) {
+            const size_t at = text.find(marker);
+            if (at != std::string::npos) {
+                text.erase(at, std::strlen(marker));
+            }
+        }
+        parse_css(text, css_);
+        pos_ = end;
+    }
+
+    void start_element(const Tag& tag) {
+        const std::string& name = tag.name;
+        if (stack_.empty()) {
+            if (found_root_ || name != "svg") {
+                skip_subtree(tag);
+                return;
+            }
+        } else if (stack_.back().skip) {
+            if (name == "style") {
+                read_style(tag);
+            }
+            skip_subtree(tag);
+            return;
+        }
+
+        if (name == "style") {
+            read_style(tag);
+            skip_subtree(tag);
+            return;
+        }
+        if (name == "text" || name == "image" || name == "use" || name == "foreignObject") {
+            ++list_.unsupported;
+            skip_subtree(tag);
+            return;
+        }
+        static const char* const NOT_DRAWN[] = {
+            "defs", "symbol", "clipPath", "mask", "pattern", "marker", "linearGradient",
+            "radialGradient", "filter", "title", "desc", "metadata", "script", "font", "font-face"};
+        for (const char* skipped : NOT_DRAWN) {
+            if (name == skipped) {
+                skip_subtree(tag);
+                return;
+            }
+        }
+        const bool container = name == "svg" || name == "g" || name == "a" || name == "switch";
+        const bool shape = name == "path" || name == "rect" || name == "circle" || name == "ellipse" ||
+                           name == "line" || name == "polyline" || name == "polygon";
+        if (!container && !shape) {
+            if (name.find(':') == std::string::npos) {
+                ++list_.unknown;   // Prefixos de outros namespaces (inkscape:, sodipodi:) são metadados
+            }
+            skip_subtree(tag);
+            return;
+        }
+
+        State state = stack_.empty() ? State{} : stack_.back();
+        if (name == "svg") {
+            if (stack_.empty()) {
+                found_root_ = true;
+                state.ctm = root_transform(tag, state);
+            } else {
+                state.ctm = state.ctm * nested_transform(tag, state);
+            }
+        }
+        if (const std::string* transform = tag.get("transform")) {
+            state.ctm = state.ctm * parse_transform(*transform);
+        }
+        if (!apply_style(tag, state)) {
+            skip_subtree(tag);   // display:none
+            return;
+        }
+        if (tag.get("clip-path") || tag.get("mask") || tag.get("filter")) {
+            ++list_.unsupported;   // Desenhado sem o efeito
+        }
+
+        if (shape) {
+            draw_shape(tag, state);
+            state.skip = true;     // Filhos de formas (title, animate) não desenham
+        }
+        push(tag, state);
+    }
+
+    Matrix root_transform(const Tag& tag, State& state) {
+        double box[4] = {0.0, 0.0, 0.0, 0.0};
+        const bool has_box = parse_viewbox(tag, box);
+        double width = length_attribute(tag, "width", has_box ? box[2] : 0.0, has_box ? box[2] : 0.0);
+        double height = length_attribute(tag, "height", has_box ? box[3] : 0.0, has_box ? box[3] : 0.0);
+        width = std::max(0.0, width);
+        height = std::max(0.0, height);
+        state.viewport_w = has_box ? box[2] : width;
+        state.viewport_h = has_box ? box[3] : height;
+
+        // px -> mm -> plotter, com y para cima a partir da base da página
+        const Matrix to_plotter = Matrix{PLOTTER_UNITS_PER_MM, 0.0, 0.0, -PLOTTER_UNITS_PER_MM, 0.0,
+                                         PLOTTER_UNITS_PER_MM * height / PX_PER_MM} *
+                                  scaling(1.0 / PX_PER_MM, 1.0 / PX_PER_MM);
+        if (!has_box) {
+            return to_plotter;
+        }
+        return to_plotter * viewbox_transform(box, width, height, tag.get("preserveAspectRatio"));
+    }
+
+    Matrix nested_transform(const Tag& tag, State& state) {
+        const double x = length_attribute(tag, "x", state.viewport_w, 0.0);
+        const double y = length_attribute(tag, "y", state.viewport_h, 0.0);
+        const double width = length_attribute(tag, "width", state.viewport_w, state.viewport_w);
+        const double height = length_attribute(tag, "height", state.viewport_h, state.viewport_h);
+        double box[4] = {0.0, 0.0, 0.0, 0.0};
+        if (!parse_viewbox(tag, box)) {
+            state.viewport_w = width;
+            state.viewport_h = height;
+            return translation(x, y);
+        }
+        state.viewport_w = box[2];
+        state.viewport_h = box[3];
+        return translation(x, y) * viewbox_transform(box, width, height, tag.get("preserveAspectRatio"));
+    }
+
+    // Atributos de apresentação < regras CSS (tag, classe, id) < style="".
+    // Devolve false para display:none.
+    bool apply_style(const Tag& tag, State& state) {
+        std::map<std::string, std::string> properties;
+        for (const auto& attribute : tag.attributes) {
+            if (is_presentation_attribute(attribute.name)) {
+                properties[attribute.name] = trim(attribute.value);
+            }
+        }
+        if (!css_.empty()) {
+            std::vector<std::string> selectors;
+            const std::string* classes = tag.get("class");
+            const std::string* id = tag.get("id");
+            selectors.push_back(tag.name);
+            if (classes) {
+                size_t pos = 0;
+                while (pos < classes->size()) {
+                    while (pos < classes->size() && is_space((*classes)[pos])) {
+                        ++pos;
+                    }
+                    size_t end = pos;
+                    while (end < classes->size() && !is_space((*classes)[end])) {
+                        ++end;
+                    }
+                    if (end > pos) {
+                        selectors.push_back("." + classes->substr(pos, end - pos));
+                    }
+                    pos = end;
+                }
+            }
+            if (id) {
+                selectors.push_back("#" + *id);
+            }
+            for (const auto& selector : selectors) {
+                for (const auto& rule : css_) {
+                    if (rule.selector == selector) {
+                        for (const auto& declaration : rule.declarations) {
+                            properties[declaration.first] = declaration.second;
+                        }
+                    }
+                }
+            }
+        }
+        if (const std::string* style = tag.get("style")) {
+            Declarations declarations;
+            parse_declarations(*style, declarations);
+            for (const auto& declaration : declarations) {
+                properties[declaration.first] = declaration.second;
+            }
+        }
+
+        // color primeiro: currentColor nas pinturas usa o valor do próprio elemento
+        const auto color = properties.find("color");
+        if (color != properties.end()) {
+            double alpha = 1.0;
+            parse_color(color->second, state.color, alpha);
+        }
+        for (const auto& property : properties) {
+            const std::string& key = property.first;
+            const std::string& value = property.second;
+            if (value == "inherit") {
+                continue;
+            }
+            double number = 0.0;
+            if (key == "fill") {
+                parse_paint(value, state.fill);
+            } else if (key == "stroke") {
+                parse_paint(value, state.stroke);
+            } else if (key == "stroke-width") {
+                const double diagonal = std::hypot(state.viewport_w, state.viewport_h) / std::sqrt(2.0);
+                if (parse_length(value, diagonal, number) && number >= 0.0) {
+                    state.stroke_width = number;
+                }
+            } else if (key == "fill-rule") {
+                state.even_odd = value == "evenodd";
+            } else if (key == "opacity" || key == "fill-opacity" || key == "stroke-opacity") {
+                if (!parse_length(value, 1.0, number)) {
+                    continue;
+                }
+                number = std::min(1.0, std::max(0.0, number));
+                if (key == "opacity") {
+                    state.opacity *= number;
+                } else if (key == "fill-opacity") {
+                    state.fill_opacity = number;
+                } else {
+                    state.stroke_opacity = number;
+                }
+            } else if (key == "visibility") {
+                state.visible = value == "visible";
+            } else if (key == "display" && value == "none") {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void draw_shape(const Tag& tag, const State& state) {
+        const double scale = state.ctm.max_scale();
+        if (!state.visible || !(scale > 0.0) || !std::isfinite(scale)) {
+            return;
+        }
+        PathBuilder builder(options_.tolerance_mm * PLOTTER_UNITS_PER_MM / scale);
+        const double vw = state.viewport_w;
+        const double vh = state.viewport_h;
+        const double diagonal = std::hypot(vw, vh) / std::sqrt(2.0);
+        const std::string& name = tag.name;
+
+        if (name == "path") {
+            const std::string* data = tag.get("d");
+            if (data) {
+                parse_path_data(*data, builder);
+            }
+        } else if (name == "rect") {
+            const double x = length_attribute(tag, "x", vw, 0.0);
+            const double y = length_attribute(tag, "y", vh, 0.0);
+            const double w = length_attribute(tag, "width", vw, 0.0);
+            const double h = length_attribute(tag, "height", vh, 0.0);
+            if (!(w > 0.0) || !(h > 0.0)) {
+                return;
+            }
+            double rx = length_attribute(tag, "rx", vw, -1.0);
+            double ry = length_attribute(tag, "ry", vh, -1.0);
+            if (rx < 0.0) {
+                rx = ry;
+            }
+            if (ry < 0.0) {
+                ry = rx;
+            }
+            rx = std::min(std::max(rx, 0.0), w * 0.5);
+            ry = std::min(std::max(ry, 0.0), h * 0.5);
+            if (rx > 0.0 && ry > 0.0) {
+                builder.move_to(Point{x + rx, y});
+                builder.line_to(Point{x + w - rx, y});
+                builder.arc_to(rx, ry, 0.0, false, true, Point{x + w, y + ry});
+                builder.line_to(Point{x + w, y + h - ry});
+                builder.arc_to(rx, ry, 0.0, false, true, Point{x + w - rx, y + h});
+                builder.line_to(Point{x + rx, y + h});
+                builder.arc_to(rx, ry, 0.0, false, true, Point{x, y + h - ry});
+                builder.line_to(Point{x, y + ry});
+                builder.arc_to(rx, ry, 0.0, false, true, Point{x + rx, y});
+            } else {
+                builder.move_to(Point{x, y});
+                builder.line_to(Point{x + w, y});
+                builder.line_to(Point{x + w, y + h});
+                builder.line_to(Point{x, y + h});
+            }
+            builder.close();
+        } else if (name == "circle" || name == "ellipse") {
+            const double cx = length_attribute(tag, "cx", vw, 0.0);
+            const double cy = length_attribute(tag, "cy", vh, 0.0);
+            double rx = 0.0;
+            double ry = 0.0;
+            if (name == "circle") {
+                rx = ry = length_attribute(tag, "r", diagonal, 0.0);
+            } else {
+                rx = length_attribute(tag, "rx", vw, 0.0);
+                ry = length_attribute(tag, "ry", vh, 0.0);
+            }
+            if (!(rx > 0.0) || !(ry > 0.0)) {
+                return;
+            }
+            builder.ellipse(cx, cy, rx, ry);
+        } else if (name == "line") {
+            builder.move_to(Point{length_attribute(tag, "x1", vw, 0.0), length_attribute(tag, "y1", vh, 0.0)});
+            builder.line_to(Point{length_attribute(tag, "x2", vw, 0.0), length_attribute(tag, "y2", vh, 0.0)});
+        } else {
+            const std::string* points = tag.get("points");
+            if (!points) {
+                return;
+            }
+            NumberReader reader(*points);
+            Point p{0.0, 0.0};
+            bool first = true;
+            while (reader.number(p.x) && reader.number(p.y)) {
+                if (first) {
+                    builder.move_to(p);
+                    first = false;
+                } else {
+                    builder.line_to(p);
+                }
+            }
+            if (name == "polygon") {
+                builder.close();
+            }
+        }
+
+        ++list_.commands;
+        emit(builder.subpaths(), state);
+    }
+
+    bool resolve(const Paint& paint, double opacity, const State& state, Rgb& rgb) {
+        if (paint.kind == Paint::Kind::NONE) {
+            return false;
+        }
+        const double alpha = paint.alpha * opacity * state.opacity;
+        if (alpha < MIN_VISIBLE_ALPHA) {
+            return false;
+        }
+        if (paint.gradient) {
+            ++list_.unsupported;
+        }
+        rgb = blend_over_white(paint.kind == Paint::Kind::CURRENT ? state.color : paint.rgb, alpha);
+        return true;
+    }
+
+    std::vector<PlotPoint> to_plotter(const Subpath& subpath, const Matrix& ctm, bool close) const {
+        std::vector<PlotPoint> points;
+        points.reserve(subpath.points.size() + 1);
+        for (const auto& p : subpath.points) {
+            const Point q = ctm.apply(p);
+            points.push_back(PlotPoint{q.x, q.y});
+        }
+        if (close && points.size() > 1) {
+            points.push_back(points.front());
+        }
+        return points;
+    }
+
+    void emit(const std::vector<Subpath>& subpaths, const State& state) {
+        Rgb rgb;
+        if (resolve(state.fill, state.fill_opacity, state, rgb)) {
+            HpglShape shape;
+            shape.fill = true;
+            shape.even_odd = state.even_odd;
+            shape.rgb = rgb;
+            for (const auto& subpath : subpaths) {
+                if (subpath.points.size() >= 3) {
+                    shape.paths.push_back(to_plotter(subpath, state.ctm, false));
+                }
+            }
+            if (!shape.paths.empty()) {
+                list_.shapes.push_back(std::move(shape));
+            }
+        }
+        if (state.stroke_width > 0.0 && resolve(state.stroke, state.stroke_opacity, state, rgb)) {
+            const double width_mm = state.stroke_width * state.ctm.scale() / PLOTTER_UNITS_PER_MM;
+            for (const auto& subpath : subpaths) {
+                if (subpath.points.size() < 2) {
+                    continue;
+                }
+                HpglShape shape;
+                shape.width_mm = width_mm;
+                shape.rgb = rgb;
+                shape.paths.push_back(to_plotter(subpath, state.ctm, subpath.closed));
+                list_.shapes.push_back(std::move(shape));
+            }
+        }
+    }
+};
+
+}  // namespace
+
+HpglDisplayList read_svg(const uint8_t* data, size_t size, const SvgReadOptions& options) {
+    SvgParser parser(data, size, options);
+    return parser.run();
+}
+
+HpglDisplayList read_svg_file(const std::string& path, const SvgReadOptions& options) {
+    const raster::MappedFile file(path);
+    return read_svg(file.data(), file.size(), options);
+}
+
+}  // namespace protocols
+}  // namespace all_press
@@ -0,0 +1,282 @@
+#include "raster/calibration.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace all_press {
+namespace raster {
+
+namespace {
+
+const char* const CHANNEL_NAMES[TONE_CHANNELS] = {
+    "gray", "red", "green", "blue", "cyan", "magenta", "yellow", "black"
+};
+
+double evaluate(const ToneCurve& curve, double x) {
+    double y = curve.offset + curve.gain * std::pow(x, curve.gamma);
+    return std::min(1.0, std::max(0.0, y));
+}
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+
+// Tabela de 256 entradas em quatro registradores tbl de 64 bytes
+struct NeonTable {
+    uint8x16x4_t part[4];
+
+    explicit NeonTable(const uint8_t* table) {
+        for (int k = 0; k < 4; ++k) {
+            part[k] = vld1q_u8_x4(table + 64 * k);
+        }
+    }
+
+    // Índices fora de 0..63 deixam o destino intacto em tbx
+    uint8x16_t lookup(uint8x16_t v) const {
+        const uint8x16_t step = vdupq_n_u8(64);
+        uint8x16_t r = vqtbl4q_u8(part[0], v);
+        v = vsubq_u8(v, step);
+        r = vqtbx4q_u8(r, part[1], v);
+        v = vsubq_u8(v, step);
+        r = vqtbx4q_u8(r, part[2], v);
+        v = vsubq_u8(v, step);
+        return vqtbx4q_u8(r, part[3], v);
+    }
+};
+
+#endif
+
+}  // namespace
+
+const char* tone_channel_name(ToneChannel channel) {
+    return CHANNEL_NAMES[static_cast<int>(channel)];
+}
+
+ToneChannel parse_tone_channel(const std::string& name) {
+    for (int c = 0; c < TONE_CHANNELS; ++c) {
+        if (name == CHANNEL_NAMES[c]) {
+            return static_cast<ToneChannel>(c);
+        }
+    }
+    throw std::invalid_argument("Unknown tone channel: " + name);
+}
+
+int tone_channels(PixelFormat format, ToneChannel* channels) {
+    switch (format) {
+        case PixelFormat::GRAY8:
+            channels[0] = ToneChannel::GRAY;
+            return 1;
+        case PixelFormat::RGB8:
+            channels[0] = ToneChannel::RED;
+            channels[1] = ToneChannel::GREEN;
+            channels[2] = ToneChannel::BLUE;
+            return 3;
+        case PixelFormat::CMYK8:
+            channels[0] = ToneChannel::CYAN;
+            channels[1] = ToneChannel::MAGENTA;
+            channels[2] = ToneChannel::YELLOW;
+            channels[3] = ToneChannel::BLACK;
+            return 4;
+    }
+    return 0;
+}
+
+void apply_lut8(const uint8_t* table, uint8_t* data, size_t count) {
+    size_t i = 0;
+
+#if defined(__SSSE3__)
+    // Subtabela k cobre os valores 16k..16k+15: depois de subtrair 16k,
+    // a soma saturada com 0x70 liga o bit 7 (pshufb zera) fora da faixa
+#if defined(__AVX2__)
+    __m256i parts[16];
+    for (int k = 0; k < 16; ++k) {
+        parts[k] = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16 * k)));
+    }
+    const __m256i bias = _mm256_set1_epi8(0x70);
+    for (; i + 32 <= count; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i r = _mm256_setzero_si256();
+        for (int k = 0; k < 16; ++k) {
+            __m256i index = _mm256_sub_epi8(v, _mm256_set1_epi8(static_cast<char>(16 * k)));
+            index = _mm256_adds_epu8(index, bias);
+            r = _mm256_or_si256(r, _mm256_shuffle_epi8(parts[k], index));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), r);
+    }
+#endif
+    __m128i parts128[16];
+    for (int k = 0; k < 16; ++k) {
+        parts128[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(table + 16 * k));
+    }
+    const __m128i bias128 = _mm_set1_epi8(0x70);
+    for (; i + 16 <= count; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i r = _mm_setzero_si128();
+        for (int k = 0; k < 16; ++k) {
+            __m128i index = _mm_sub_epi8(v, _mm_set1_epi8(static_cast<char>(16 * k)));
+            index = _mm_adds_epu8(index, bias128);
+            r = _mm_or_si128(r, _mm_shuffle_epi8(parts128[k], index));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), r);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const NeonTable lut(table);
+    for (; i + 16 <= count; i += 16) {
+        vst1q_u8(data + i, lut.lookup(vld1q_u8(data + i)));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        data[i] = table[data[i]];
+    }
+}
+
+std::shared_ptr<const CalibrationLut> CalibrationLut::build(const ToneCurves& curves,
+                                                            uint64_t version) {
+    for (int c = 0; c < TONE_CHANNELS; ++c) {
+        const ToneCurve& curve = curves[c];
+        if (!(curve.gamma > 0.0) || !(curve.gain >= 0.0) || !std::isfinite(curve.offset)) {
+            throw std::invalid_argument(std::string("Invalid tone curve for channel ") +
+                                        CHANNEL_NAMES[c]);
+        }
+    }
+
+    std::shared_ptr<CalibrationLut> lut(new CalibrationLut());
+    lut->version_ = version;
+    lut->curves_ = curves;
+    lut->tables8_.resize(static_cast<size_t>(TONE_CHANNELS) * 256);
+    for (int c = 0; c < TONE_CHANNELS; ++c) {
+        uint8_t* table = &lut->tables8_[static_cast<size_t>(c) * 256];
+        for (int v = 0; v < 256; ++v) {
+            table[v] = static_cast<uint8_t>(std::lround(evaluate(curves[c], v / 255.0) * 255.0));
+        }
+        if (!curves[c].is_identity()) {
+            auto& wide = lut->tables16_[c];
+            wide.resize(65536);
+            for (int v = 0; v < 65536; ++v) {
+                wide[v] = static_cast<uint16_t>(std::lround(evaluate(curves[c], v / 65535.0) * 65535.0));
+            }
+        }
+    }
+    return lut;
+}
+
+const ToneCurve& CalibrationLut::curve(ToneChannel channel) const {
+    return curves_[static_cast<int>(channel)];
+}
+
+const uint8_t* CalibrationLut::table8(ToneChannel channel) const {
+    return &tables8_[static_cast<size_t>(channel) * 256];
+}
+
+const uint16_t* CalibrationLut::table16(ToneChannel channel) const {
+    const auto& wide = tables16_[static_cast<int>(channel)];
+    return wide.empty() ? nullptr : wide.data();
+}
+
+bool CalibrationLut::is_identity(PixelFormat format) const {
+    ToneChannel channels[4];
+    const int n = tone_channels(format, channels);
+    for (int c = 0; c < n; ++c) {
+        if (!curve(channels[c]).is_identity()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CalibrationLut::is_monotonic(ToneChannel channel) const {
+    const uint8_t* table = table8(channel);
+    return std::is_sorted(table, table + 256);
+}
+
+bool CalibrationLut::preserves_blank(PixelFormat format) const {
+    ToneChannel channels[4];
+    const int n = tone_channels(format, channels);
+    const uint8_t blank = blank_byte(format);
+    for (int c = 0; c < n; ++c) {
+        if (table8(channels[c])[blank] != blank) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CalibrationLut::apply(uint8_t* pixels, PixelFormat format, size_t count) const {
+    if (is_identity(format)) {
+        return;
+    }
+    ToneChannel channels[4];
+    const int n = tone_channels(format, channels);
+    const uint8_t* tables[4];
+    bool shared = true;
+    for (int c = 0; c < n; ++c) {
+        tables[c] = table8(channels[c]);
+        shared = shared && std::memcmp(tables[c], tables[0], 256) == 0;
+    }
+
+    // Mesma curva em todos os canais: uma tabela sobre todas as amostras
+    if (shared) {
+        apply_lut8(tables[0], pixels, count * n);
+        return;
+    }
+
+    size_t p = 0;
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    // Desentrelaça 16 pixels em planos e consulta a tabela de cada canal
+    if (n == 3) {
+        const NeonTable r(tables[0]), g(tables[1]), b(tables[2]);
+        for (; p + 16 <= count; p += 16) {
+            uint8x16x3_t v = vld3q_u8(pixels + p * 3);
+            v.val[0] = r.lookup(v.val[0]);
+            v.val[1] = g.lookup(v.val[1]);
+            v.val[2] = b.lookup(v.val[2]);
+            vst3q_u8(pixels + p * 3, v);
+        }
+    } else if (n == 4) {
+        const NeonTable c(tables[0]), m(tables[1]), y(tables[2]), k(tables[3]);
+        for (; p + 16 <= count; p += 16) {
+            uint8x16x4_t v = vld4q_u8(pixels + p * 4);
+            v.val[0] = c.lookup(v.val[0]);
+            v.val[1] = m.lookup(v.val[1]);
+            v.val[2] = y.lookup(v.val[2]);
+            v.val[3] = k.lookup(v.val[3]);
+            vst4q_u8(pixels + p * 4, v);
+        }
+    }
+#endif
+    // x86: pshufb não escolhe tabela por posição; consulta escalar entrelaçada
+    for (; p < count; ++p) {
+        uint8_t* px = pixels + p * n;
+        for (int c = 0; c < n; ++c) {
+            px[c] = tables[c][px[c]];
+        }
+    }
+}
+
+void CalibrationLut::apply16(uint16_t* samples, PixelFormat format, size_t count) const {
+    if (is_identity(format)) {
+        return;
+    }
+    ToneChannel channels[4];
+    const int n = tone_channels(format, channels);
+    for (int c = 0; c < n; ++c) {
+        const uint16_t* table = table16(channels[c]);
+        if (!table) {
+            continue;
+        }
+        uint16_t* s = samples + c;
+        for (size_t p = 0; p < count; ++p, s += n) {
+            *s = table[*s];
+        }
+    }
+}
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,735 @@
+#include "raster/color_convert.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace all_press {
+namespace raster {
+
+namespace {
+
+// Pesos de luminância (Rec. 601) em ponto fixo; cada conjunto soma 1.0
+constexpr int GRAY8_R = 77, GRAY8_G = 150, GRAY8_B = 29;
+constexpr uint32_t GRAY16_R = 19595, GRAY16_G = 38470, GRAY16_B = 7471;
+
+// Parâmetros da separação em inteiros: GCR em 1/256, TAC em unidades de 0..255
+struct SeparationParams {
+    int black_q8;
+    int ink_limit;
+};
+
+SeparationParams separation_params(const CmykSeparation& separation) {
+    int gcr = std::clamp(separation.black_generation, 0, 100);
+    int tac = std::clamp(separation.total_ink_limit, 100, 400);
+    return {(gcr * 256 + 50) / 100, tac * 255 / 100};
+}
+
+#if defined(__SSSE3__)
+
+// Máscaras pshufb para (des)entrelaçar pixels RGB de 8 ou 16 bits em
+// 3 registradores de 16 bytes
+struct ShuffleMask {
+    alignas(16) uint8_t bytes[16];
+};
+
+struct RgbShuffles {
+    ShuffleMask gather[3][3];   // [canal][registrador de origem]
+    ShuffleMask scatter[3][3];  // [registrador de destino][canal]
+
+    constexpr explicit RgbShuffles(int elem) : gather{}, scatter{} {
+        for (int ch = 0; ch < 3; ++ch) {
+            for (int reg = 0; reg < 3; ++reg) {
+                for (int j = 0; j < 16; ++j) {
+                    int byte = ((j / elem) * 3 + ch) * elem + j % elem;
+                    gather[ch][reg].bytes[j] = static_cast<uint8_t>(
+                        byte / 16 == reg ? byte % 16 : 0x80);
+
+                    int element = (16 * reg + j) / elem;
+                    scatter[reg][ch].bytes[j] = static_cast<uint8_t>(
+                        element % 3 == ch ? (element / 3) * elem + j % elem : 0x80);
+                }
+            }
+        }
+    }
+};
+
+constexpr RgbShuffles RGB8_SHUFFLES(1);
+constexpr RgbShuffles RGB16_SHUFFLES(2);
+
+inline __m128i mask(const ShuffleMask& m) {
+    return _mm_load_si128(reinterpret_cast<const __m128i*>(m.bytes));
+}
+
+inline void load_rgb(const uint8_t* p, const RgbShuffles& s, __m128i out[3]) {
+    const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16));
+    const __m128i a2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 32));
+    for (int ch = 0; ch < 3; ++ch) {
+        out[ch] = _mm_or_si128(
+            _mm_or_si128(_mm_shuffle_epi8(a0, mask(s.gather[ch][0])),
+                         _mm_shuffle_epi8(a1, mask(s.gather[ch][1]))),
+            _mm_shuffle_epi8(a2, mask(s.gather[ch][2])));
+    }
+}
+
+inline void store_rgb(uint8_t* p, const RgbShuffles& s, const __m128i ch[3]) {
+    for (int reg = 0; reg < 3; ++reg) {
+        __m128i v = _mm_or_si128(
+            _mm_or_si128(_mm_shuffle_epi8(ch[0], mask(s.scatter[reg][0])),
+                         _mm_shuffle_epi8(ch[1], mask(s.scatter[reg][1]))),
+            _mm_shuffle_epi8(ch[2], mask(s.scatter[reg][2])));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 16 * reg), v);
+    }
+}
+
+// x / 255 arredondado, exato para x <= 255 * 255
+inline __m128i div255_epu16(__m128i x) {
+    __m128i t = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Escala C, M e Y de 4 pixels pelo fator do limite de tinta
+inline void limit_ink4(__m128i& c, __m128i& m, __m128i& y, __m128i avail) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 sum = _mm_cvtepi32_ps(_mm_add_epi32(_mm_add_epi32(c, m), y));
+    __m128 f = _mm_min_ps(one, _mm_div_ps(_mm_cvtepi32_ps(avail), _mm_max_ps(sum, one)));
+    c = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(c), f));
+    m = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(m), f));
+    y = _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(y), f));
+}
+
+// Separação de 8 pixels em 16 bits; devolve C, M, Y e K em 16 bits
+inline void separate8(__m128i c, __m128i m, __m128i y, __m128i kf,
+                      __m128i black_q8, __m128i limit, __m128i out[4]) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i k = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(kf, black_q8),
+                                             _mm_set1_epi16(128)), 8);
+    c = _mm_sub_epi16(c, k);
+    m = _mm_sub_epi16(m, k);
+    y = _mm_sub_epi16(y, k);
+    __m128i avail = _mm_sub_epi16(limit, k);
+
+    __m128i c0 = _mm_unpacklo_epi16(c, zero), c1 = _mm_unpackhi_epi16(c, zero);
+    __m128i m0 = _mm_unpacklo_epi16(m, zero), m1 = _mm_unpackhi_epi16(m, zero);
+    __m128i y0 = _mm_unpacklo_epi16(y, zero), y1 = _mm_unpackhi_epi16(y, zero);
+    limit_ink4(c0, m0, y0, _mm_unpacklo_epi16(avail, zero));
+    limit_ink4(c1, m1, y1, _mm_unpackhi_epi16(avail, zero));
+
+    out[0] = _mm_packs_epi32(c0, c1);
+    out[1] = _mm_packs_epi32(m0, m1);
+    out[2] = _mm_packs_epi32(y0, y1);
+    out[3] = k;
+}
+
+#if defined(__AVX2__)
+
+// Variantes AVX2: cada metade de 128 bits processa um bloco independente
+// (pixels 0..15 e 16..31), então as máscaras e a ordem in-lane são as mesmas
+inline __m256i mask2(const ShuffleMask& m) {
+    return _mm256_broadcastsi128_si256(mask(m));
+}
+
+inline __m256i load2(const uint8_t* lo, const uint8_t* hi) {
+    return _mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lo))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(hi)), 1);
+}
+
+inline void store2(uint8_t* lo, uint8_t* hi, __m256i v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lo), _mm256_castsi256_si128(v));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(hi), _mm256_extracti128_si256(v, 1));
+}
+
+inline void load_rgb2(const uint8_t* p, const RgbShuffles& s, __m256i out[3]) {
+    const __m256i a0 = load2(p, p + 48);
+    const __m256i a1 = load2(p + 16, p + 64);
+    const __m256i a2 = load2(p + 32, p + 80);
+    for (int ch = 0; ch < 3; ++ch) {
+        out[ch] = _mm256_or_si256(
+            _mm256_or_si256(_mm256_shuffle_epi8(a0, mask2(s.gather[ch][0])),
+                            _mm256_shuffle_epi8(a1, mask2(s.gather[ch][1]))),
+            _mm256_shuffle_epi8(a2, mask2(s.gather[ch][2])));
+    }
+}
+
+inline void store_rgb2(uint8_t* p, const RgbShuffles& s, const __m256i ch[3]) {
+    for (int reg = 0; reg < 3; ++reg) {
+        __m256i v = _mm256_or_si256(
+            _mm256_or_si256(_mm256_shuffle_epi8(ch[0], mask2(s.scatter[reg][0])),
+                            _mm256_shuffle_epi8(ch[1], mask2(s.scatter[reg][1]))),
+            _mm256_shuffle_epi8(ch[2], mask2(s.scatter[reg][2])));
+        store2(p + 16 * reg, p + 48 + 16 * reg, v);
+    }
+}
+
+inline __m256i div255_epu16(__m256i x) {
+    __m256i t = _mm256_add_epi16(x, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+inline void limit_ink8(__m256i& c, __m256i& m, __m256i& y, __m256i avail) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 sum = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_add_epi32(c, m), y));
+    __m256 f = _mm256_min_ps(one, _mm256_div_ps(_mm256_cvtepi32_ps(avail),
+                                                _mm256_max_ps(sum, one)));
+    c = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(c), f));
+    m = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(m), f));
+    y = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(y), f));
+}
+
+inline void separate16(__m256i c, __m256i m, __m256i y, __m256i kf,
+                       __m256i black_q8, __m256i limit, __m256i out[4]) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i k = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(kf, black_q8),
+                                                   _mm256_set1_epi16(128)), 8);
+    c = _mm256_sub_epi16(c, k);
+    m = _mm256_sub_epi16(m, k);
+    y = _mm256_sub_epi16(y, k);
+    __m256i avail = _mm256_sub_epi16(limit, k);
+
+    __m256i c0 = _mm256_unpacklo_epi16(c, zero), c1 = _mm256_unpackhi_epi16(c, zero);
+    __m256i m0 = _mm256_unpacklo_epi16(m, zero), m1 = _mm256_unpackhi_epi16(m, zero);
+    __m256i y0 = _mm256_unpacklo_epi16(y, zero), y1 = _mm256_unpackhi_epi16(y, zero);
+    limit_ink8(c0, m0, y0, _mm256_unpacklo_epi16(avail, zero));
+    limit_ink8(c1, m1, y1, _mm256_unpackhi_epi16(avail, zero));
+
+    out[0] = _mm256_packs_epi32(c0, c1);
+    out[1] = _mm256_packs_epi32(m0, m1);
+    out[2] = _mm256_packs_epi32(y0, y1);
+    out[3] = k;
+}
+
+#endif
+
+#endif
+
+}  // namespace
+
+namespace reference {
+
+void rgb_to_gray8(const uint8_t* rgb, int width, uint8_t* gray) {
+    for (int x = 0; x < width; ++x) {
+        const uint8_t* p = rgb + static_cast<size_t>(x) * 3;
+        gray[x] = static_cast<uint8_t>(
+            (GRAY8_R * p[0] + GRAY8_G * p[1] + GRAY8_B * p[2] + 128) >> 8);
+    }
+}
+
+void rgb_to_gray16(const uint16_t* rgb, int width, uint16_t* gray) {
+    for (int x = 0; x < width; ++x) {
+        const uint16_t* p = rgb + static_cast<size_t>(x) * 3;
+        gray[x] = static_cast<uint16_t>(
+            (GRAY16_R * p[0] + GRAY16_G * p[1] + GRAY16_B * p[2] + 32768u) >> 16);
+    }
+}
+
+void rgb_to_cmyk8(const uint8_t* rgb, int width, uint8_t* cmyk,
+                  const CmykSeparation& separation) {
+    const SeparationParams params = separation_params(separation);
+    for (int x = 0; x < width; ++x) {
+        const uint8_t* p = rgb + static_cast<size_t>(x) * 3;
+        int c = 255 - p[0];
+        int m = 255 - p[1];
+        int y = 255 - p[2];
+
+        // GCR: parte do cinza comum vira preto
+        int k = (std::min(c, std::min(m, y)) * params.black_q8 + 128) >> 8;
+        c -= k;
+        m -= k;
+        y -= k;
+
+        // TAC: reduz C, M e Y proporcionalmente, K fica intacto
+        int sum = c + m + y;
+        int avail = params.ink_limit - k;
+        if (sum > avail) {
+            float f = static_cast<float>(avail) / static_cast<float>(sum);
+            c = static_cast<int>(static_cast<float>(c) * f);
+            m = static_cast<int>(static_cast<float>(m) * f);
+            y = static_cast<int>(static_cast<float>(y) * f);
+        }
+
+        uint8_t* o = cmyk + static_cast<size_t>(x) * 4;
+        o[0] = static_cast<uint8_t>(c);
+        o[1] = static_cast<uint8_t>(m);
+        o[2] = static_cast<uint8_t>(y);
+        o[3] = static_cast<uint8_t>(k);
+    }
+}
+
+void cmyk_to_rgb8(const uint8_t* cmyk, int width, uint8_t* rgb) {
+    auto div255 = [](int v) { return (v + 128 + ((v + 128) >> 8)) >> 8; };
+    for (int x = 0; x < width; ++x) {
+        const uint8_t* p = cmyk + static_cast<size_t>(x) * 4;
+        int white = 255 - p[3];
+        uint8_t* o = rgb + static_cast<size_t>(x) * 3;
+        o[0] = static_cast<uint8_t>(div255((255 - p[0]) * white));
+        o[1] = static_cast<uint8_t>(div255((255 - p[1]) * white));
+        o[2] = static_cast<uint8_t>(div255((255 - p[2]) * white));
+    }
+}
+
+}  // namespace reference
+
+void rgb_to_gray8(const uint8_t* rgb, int width, uint8_t* gray) {
+    int x = 0;
+#if defined(__SSSE3__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wr = _mm_set1_epi16(GRAY8_R);
+    const __m128i wg = _mm_set1_epi16(GRAY8_G);
+    const __m128i wb = _mm_set1_epi16(GRAY8_B);
+    const __m128i round = _mm_set1_epi16(128);
+#if defined(__AVX2__)
+    for (; x + 32 <= width; x += 32) {
+        __m256i ch[3];
+        load_rgb2(rgb + static_cast<size_t>(x) * 3, RGB8_SHUFFLES, ch);
+        const __m256i zero2 = _mm256_setzero_si256();
+        __m256i half[2];
+        for (int h = 0; h < 2; ++h) {
+            __m256i r = h ? _mm256_unpackhi_epi8(ch[0], zero2) : _mm256_unpacklo_epi8(ch[0], zero2);
+            __m256i g = h ? _mm256_unpackhi_epi8(ch[1], zero2) : _mm256_unpacklo_epi8(ch[1], zero2);
+            __m256i b = h ? _mm256_unpackhi_epi8(ch[2], zero2) : _mm256_unpacklo_epi8(ch[2], zero2);
+            __m256i sum = _mm256_add_epi16(
+                _mm256_add_epi16(_mm256_mullo_epi16(r, _mm256_set1_epi16(GRAY8_R)),
+                                 _mm256_mullo_epi16(g, _mm256_set1_epi16(GRAY8_G))),
+                _mm256_add_epi16(_mm256_mullo_epi16(b, _mm256_set1_epi16(GRAY8_B)),
+                                 _mm256_set1_epi16(128)));
+            half[h] = _mm256_srli_epi16(sum, 8);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(gray + x),
+                            _mm256_packus_epi16(half[0], half[1]));
+    }
+#endif
+    for (; x + 16 <= width; x += 16) {
+        __m128i ch[3];
+        load_rgb(rgb + static_cast<size_t>(x) * 3, RGB8_SHUFFLES, ch);
+        __m128i half[2];
+        for (int h = 0; h < 2; ++h) {
+            __m128i r = h ? _mm_unpackhi_epi8(ch[0], zero) : _mm_unpacklo_epi8(ch[0], zero);
+            __m128i g = h ? _mm_unpackhi_epi8(ch[1], zero) : _mm_unpacklo_epi8(ch[1], zero);
+            __m128i b = h ? _mm_unpackhi_epi8(ch[2], zero) : _mm_unpacklo_epi8(ch[2], zero);
+            __m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, wr),
+                                                      _mm_mullo_epi16(g, wg)),
+                                        _mm_add_epi16(_mm_mullo_epi16(b, wb), round));
+            half[h] = _mm_srli_epi16(sum, 8);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(gray + x),
+                         _mm_packus_epi16(half[0], half[1]));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x3_t p = vld3q_u8(rgb + static_cast<size_t>(x) * 3);
+        uint16x8_t lo = vmull_u8(vget_low_u8(p.val[0]), vdup_n_u8(GRAY8_R));
+        lo = vmlal_u8(lo, vget_low_u8(p.val[1]), vdup_n_u8(GRAY8_G));
+        lo = vmlal_u8(lo, vget_low_u8(p.val[2]), vdup_n_u8(GRAY8_B));
+        uint16x8_t hi = vmull_u8(vget_high_u8(p.val[0]), vdup_n_u8(GRAY8_R));
+        hi = vmlal_u8(hi, vget_high_u8(p.val[1]), vdup_n_u8(GRAY8_G));
+        hi = vmlal_u8(hi, vget_high_u8(p.val[2]), vdup_n_u8(GRAY8_B));
+        vst1q_u8(gray + x, vcombine_u8(vrshrn_n_u16(lo, 8), vrshrn_n_u16(hi, 8)));
+    }
+#endif
+    reference::rgb_to_gray8(rgb + static_cast<size_t>(x) * 3, width - x, gray + x);
+}
+
+void rgb_to_gray16(const uint16_t* rgb, int width, uint16_t* gray) {
+    int x = 0;
+#if defined(__SSSE3__)
+    const __m128i wr = _mm_set1_epi16(static_cast<short>(GRAY16_R));
+    const __m128i wg = _mm_set1_epi16(static_cast<short>(GRAY16_G));
+    const __m128i wb = _mm_set1_epi16(static_cast<short>(GRAY16_B));
+    const __m128i round = _mm_set1_epi32(32768);
+    const __m128i bias = _mm_set1_epi32(32768);
+    const __m128i flip = _mm_set1_epi16(static_cast<short>(0x8000));
+    for (; x + 8 <= width; x += 8) {
+        __m128i ch[3];
+        load_rgb(reinterpret_cast<const uint8_t*>(rgb + static_cast<size_t>(x) * 3),
+                 RGB16_SHUFFLES, ch);
+        // Produtos de 32 bits a partir das metades baixa/alta de 16x16
+        const __m128i w[3] = {wr, wg, wb};
+        __m128i sum_lo = round, sum_hi = round;
+        for (int c = 0; c < 3; ++c) {
+            __m128i lo = _mm_mullo_epi16(ch[c], w[c]);
+            __m128i hi = _mm_mulhi_epu16(ch[c], w[c]);
+            sum_lo = _mm_add_epi32(sum_lo, _mm_unpacklo_epi16(lo, hi));
+            sum_hi = _mm_add_epi32(sum_hi, _mm_unpackhi_epi16(lo, hi));
+        }
+        // >> 16 e empacota sem saturação com sinal (desloca para -32768..32767)
+        sum_lo = _mm_sub_epi32(_mm_srli_epi32(sum_lo, 16), bias);
+        sum_hi = _mm_sub_epi32(_mm_srli_epi32(sum_hi, 16), bias);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(gray + x),
+                         _mm_xor_si128(_mm_packs_epi32(sum_lo, sum_hi), flip));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; x + 8 <= width; x += 8) {
+        uint16x8x3_t p = vld3q_u16(rgb + static_cast<size_t>(x) * 3);
+        uint32x4_t lo = vmull_n_u16(vget_low_u16(p.val[0]), GRAY16_R);
+        lo = vmlal_n_u16(lo, vget_low_u16(p.val[1]), GRAY16_G);
+        lo = vmlal_n_u16(lo, vget_low_u16(p.val[2]), GRAY16_B);
+        uint32x4_t hi = vmull_n_u16(vget_high_u16(p.val[0]), GRAY16_R);
+        hi = vmlal_n_u16(hi, vget_high_u16(p.val[1]), GRAY16_G);
+        hi = vmlal_n_u16(hi, vget_high_u16(p.val[2]), GRAY16_B);
+        vst1q_u16(gray + x, vcombine_u16(vrshrn_n_u32(lo, 16), vrshrn_n_u32(hi, 16)));
+    }
+#endif
+    reference::rgb_to_gray16(rgb + static_cast<size_t>(x) * 3, width - x, gray + x);
+}
+
+void rgb_to_cmyk8(const uint8_t* rgb, int width, uint8_t* cmyk,
+                  const CmykSeparation& separation) {
+    int x = 0;
+#if defined(__SSSE3__)
+    const SeparationParams params = separation_params(separation);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(static_cast<char>(0xFF));
+    const __m128i black_q8 = _mm_set1_epi16(static_cast<short>(params.black_q8));
+    const __m128i limit = _mm_set1_epi16(static_cast<short>(params.ink_limit));
+#if defined(__AVX2__)
+    for (; x + 32 <= width; x += 32) {
+        const __m256i zero2 = _mm256_setzero_si256();
+        const __m256i ones2 = _mm256_set1_epi8(static_cast<char>(0xFF));
+        __m256i ch[3];
+        load_rgb2(rgb + static_cast<size_t>(x) * 3, RGB8_SHUFFLES, ch);
+        __m256i c = _mm256_xor_si256(ch[0], ones2);
+        __m256i m = _mm256_xor_si256(ch[1], ones2);
+        __m256i y = _mm256_xor_si256(ch[2], ones2);
+        __m256i kf = _mm256_min_epu8(c, _mm256_min_epu8(m, y));
+
+        const __m256i black2 = _mm256_broadcastsi128_si256(black_q8);
+        const __m256i limit2 = _mm256_broadcastsi128_si256(limit);
+        __m256i lo[4], hi[4];
+        separate16(_mm256_unpacklo_epi8(c, zero2), _mm256_unpacklo_epi8(m, zero2),
+                   _mm256_unpacklo_epi8(y, zero2), _mm256_unpacklo_epi8(kf, zero2),
+                   black2, limit2, lo);
+        separate16(_mm256_unpackhi_epi8(c, zero2), _mm256_unpackhi_epi8(m, zero2),
+                   _mm256_unpackhi_epi8(y, zero2), _mm256_unpackhi_epi8(kf, zero2),
+                   black2, limit2, hi);
+        c = _mm256_packus_epi16(lo[0], hi[0]);
+        m = _mm256_packus_epi16(lo[1], hi[1]);
+        y = _mm256_packus_epi16(lo[2], hi[2]);
+        __m256i k = _mm256_packus_epi16(lo[3], hi[3]);
+
+        __m256i cm_lo = _mm256_unpacklo_epi8(c, m), cm_hi = _mm256_unpackhi_epi8(c, m);
+        __m256i yk_lo = _mm256_unpacklo_epi8(y, k), yk_hi = _mm256_unpackhi_epi8(y, k);
+        uint8_t* out = cmyk + static_cast<size_t>(x) * 4;
+        store2(out, out + 64, _mm256_unpacklo_epi16(cm_lo, yk_lo));
+        store2(out + 16, out + 80, _mm256_unpackhi_epi16(cm_lo, yk_lo));
+        store2(out + 32, out + 96, _mm256_unpacklo_epi16(cm_hi, yk_hi));
+        store2(out + 48, out + 112, _mm256_unpackhi_epi16(cm_hi, yk_hi));
+    }
+#endif
+    for (; x + 16 <= width; x += 16) {
+        __m128i ch[3];
+        load_rgb(rgb + static_cast<size_t>(x) * 3, RGB8_SHUFFLES, ch);
+        __m128i c = _mm_xor_si128(ch[0], ones);
+        __m128i m = _mm_xor_si128(ch[1], ones);
+        __m128i y = _mm_xor_si128(ch[2], ones);
+        __m128i kf = _mm_min_epu8(c, _mm_min_epu8(m, y));
+
+        __m128i lo[4], hi[4];
+        separate8(_mm_unpacklo_epi8(c, zero), _mm_unpacklo_epi8(m, zero),
+                  _mm_unpacklo_epi8(y, zero), _mm_unpacklo_epi8(kf, zero),
+                  black_q8, limit, lo);
+        separate8(_mm_unpackhi_epi8(c, zero), _mm_unpackhi_epi8(m, zero),
+                  _mm_unpackhi_epi8(y, zero), _mm_unpackhi_epi8(kf, zero),
+                  black_q8, limit, hi);
+        c = _mm_packus_epi16(lo[0], hi[0]);
+        m = _mm_packus_epi16(lo[1], hi[1]);
+        y = _mm_packus_epi16(lo[2], hi[2]);
+        __m128i k = _mm_packus_epi16(lo[3], hi[3]);
+
+        // Entrelaça C, M, Y, K
+        __m128i cm_lo = _mm_unpacklo_epi8(c, m), cm_hi = _mm_unpackhi_epi8(c, m);
+        __m128i yk_lo = _mm_unpacklo_epi8(y, k), yk_hi = _mm_unpackhi_epi8(y, k);
+        __m128i* out = reinterpret_cast<__m128i*>(cmyk + static_cast<size_t>(x) * 4);
+        _mm_storeu_si128(out, _mm_unpacklo_epi16(cm_lo, yk_lo));
+        _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(cm_lo, yk_lo));
+        _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(cm_hi, yk_hi));
+        _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(cm_hi, yk_hi));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const SeparationParams params = separation_params(separation);
+    const uint16x8_t black_q8 = vdupq_n_u16(static_cast<uint16_t>(params.black_q8));
+    const uint16x8_t limit = vdupq_n_u16(static_cast<uint16_t>(params.ink_limit));
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    auto limit4 = [&](uint32x4_t& c, uint32x4_t& m, uint32x4_t& y, uint32x4_t avail) {
+        float32x4_t sum = vcvtq_f32_u32(vaddq_u32(vaddq_u32(c, m), y));
+        float32x4_t f = vminq_f32(one, vdivq_f32(vcvtq_f32_u32(avail), vmaxq_f32(sum, one)));
+        c = vcvtq_u32_f32(vmulq_f32(vcvtq_f32_u32(c), f));
+        m = vcvtq_u32_f32(vmulq_f32(vcvtq_f32_u32(m), f));
+        y = vcvtq_u32_f32(vmulq_f32(vcvtq_f32_u32(y), f));
+    };
+    auto separate = [&](uint8x8_t c8, uint8x8_t m8, uint8x8_t y8, uint8x8_t kf8, uint16x8_t out[4]) {
+        uint16x8_t k = vshrq_n_u16(vaddq_u16(vmulq_u16(vmovl_u8(kf8), black_q8),
+                                             vdupq_n_u16(128)), 8);
+        uint16x8_t c = vsubq_u16(vmovl_u8(c8), k);
+        uint16x8_t m = vsubq_u16(vmovl_u8(m8), k);
+        uint16x8_t y = vsubq_u16(vmovl_u8(y8), k);
+        uint16x8_t avail = vsubq_u16(limit, k);
+        uint32x4_t c0 = vmovl_u16(vget_low_u16(c)), c1 = vmovl_u16(vget_high_u16(c));
+        uint32x4_t m0 = vmovl_u16(vget_low_u16(m)), m1 = vmovl_u16(vget_high_u16(m));
+        uint32x4_t y0 = vmovl_u16(vget_low_u16(y)), y1 = vmovl_u16(vget_high_u16(y));
+        limit4(c0, m0, y0, vmovl_u16(vget_low_u16(avail)));
+        limit4(c1, m1, y1, vmovl_u16(vget_high_u16(avail)));
+        out[0] = vcombine_u16(vmovn_u32(c0), vmovn_u32(c1));
+        out[1] = vcombine_u16(vmovn_u32(m0), vmovn_u32(m1));
+        out[2] = vcombine_u16(vmovn_u32(y0), vmovn_u32(y1));
+        out[3] = k;
+    };
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x3_t p = vld3q_u8(rgb + static_cast<size_t>(x) * 3);
+        uint8x16_t c = vmvnq_u8(p.val[0]);
+        uint8x16_t m = vmvnq_u8(p.val[1]);
+        uint8x16_t y = vmvnq_u8(p.val[2]);
+        uint8x16_t kf = vminq_u8(c, vminq_u8(m, y));
+        uint16x8_t lo[4], hi[4];
+        separate(vget_low_u8(c), vget_low_u8(m), vget_low_u8(y), vget_low_u8(kf), lo);
+        separate(vget_high_u8(c), vget_high_u8(m), vget_high_u8(y), vget_high_u8(kf), hi);
+        uint8x16x4_t out;
+        for (int i = 0; i < 4; ++i) {
+            out.val[i] = vcombine_u8(vmovn_u16(lo[i]), vmovn_u16(hi[i]));
+        }
+        vst4q_u8(cmyk + static_cast<size_t>(x) * 4, out);
+    }
+#endif
+    reference::rgb_to_cmyk8(rgb + static_cast<size_t>(x) * 3, width - x,
+                            cmyk + static_cast<size_t>(x) * 4, separation);
+}
+
+void cmyk_to_rgb8(const uint8_t* cmyk, int width, uint8_t* rgb) {
+    int x = 0;
+#if defined(__SSSE3__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi8(static_cast<char>(0xFF));
+    // Cada registrador de 4 pixels vira [c0..c3 m0..m3 y0..y3 k0..k3]
+    const __m128i planar = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13,
+                                         2, 6, 10, 14, 3, 7, 11, 15);
+#if defined(__AVX2__)
+    for (; x + 32 <= width; x += 32) {
+        const __m256i zero2 = _mm256_setzero_si256();
+        const __m256i ones2 = _mm256_set1_epi8(static_cast<char>(0xFF));
+        const __m256i planar2 = _mm256_broadcastsi128_si256(planar);
+        const uint8_t* in = cmyk + static_cast<size_t>(x) * 4;
+        __m256i a = _mm256_shuffle_epi8(load2(in, in + 64), planar2);
+        __m256i b = _mm256_shuffle_epi8(load2(in + 16, in + 80), planar2);
+        __m256i c = _mm256_shuffle_epi8(load2(in + 32, in + 96), planar2);
+        __m256i d = _mm256_shuffle_epi8(load2(in + 48, in + 112), planar2);
+        __m256i t0 = _mm256_unpacklo_epi32(a, b), t1 = _mm256_unpacklo_epi32(c, d);
+        __m256i t2 = _mm256_unpackhi_epi32(a, b), t3 = _mm256_unpackhi_epi32(c, d);
+        __m256i white = _mm256_xor_si256(_mm256_unpackhi_epi64(t2, t3), ones2);
+        __m256i inv[3] = {
+            _mm256_xor_si256(_mm256_unpacklo_epi64(t0, t1), ones2),
+            _mm256_xor_si256(_mm256_unpackhi_epi64(t0, t1), ones2),
+            _mm256_xor_si256(_mm256_unpacklo_epi64(t2, t3), ones2),
+        };
+
+        __m256i white_lo = _mm256_unpacklo_epi8(white, zero2);
+        __m256i white_hi = _mm256_unpackhi_epi8(white, zero2);
+        __m256i out[3];
+        for (int ch = 0; ch < 3; ++ch) {
+            __m256i lo = div255_epu16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(inv[ch], zero2), white_lo));
+            __m256i hi = div255_epu16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(inv[ch], zero2), white_hi));
+            out[ch] = _mm256_packus_epi16(lo, hi);
+        }
+        store_rgb2(rgb + static_cast<size_t>(x) * 3, RGB8_SHUFFLES, out);
+    }
+#endif
+    for (; x + 16 <= width; x += 16) {
+        const __m128i* in = reinterpret_cast<const __m128i*>(cmyk + static_cast<size_t>(x) * 4);
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(in), planar);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(in + 1), planar);
+        __m128i c = _mm_shuffle_epi8(_mm_loadu_si128(in + 2), planar);
+        __m128i d = _mm_shuffle_epi8(_mm_loadu_si128(in + 3), planar);
+        // Transposição 4x4 de palavras de 32 bits
+        __m128i t0 = _mm_unpacklo_epi32(a, b), t1 = _mm_unpacklo_epi32(c, d);
+        __m128i t2 = _mm_unpackhi_epi32(a, b), t3 = _mm_unpackhi_epi32(c, d);
+        __m128i white = _mm_xor_si128(_mm_unpackhi_epi64(t2, t3), ones);
+        __m128i inv[3] = {
+            _mm_xor_si128(_mm_unpacklo_epi64(t0, t1), ones),
+            _mm_xor_si128(_mm_unpackhi_epi64(t0, t1), ones),
+            _mm_xor_si128(_mm_unpacklo_epi64(t2, t3), ones),
+        };
+
+        __m128i white_lo = _mm_unpacklo_epi8(white, zero);
+        __m128i white_hi = _mm_unpackhi_epi8(white, zero);
+        __m128i out[3];
+        for (int ch = 0; ch < 3; ++ch) {
+            __m128i lo = div255_epu16(_mm_mullo_epi16(_mm_unpacklo_epi8(inv[ch], zero), white_lo));
+            __m128i hi = div255_epu16(_mm_mullo_epi16(_mm_unpackhi_epi8(inv[ch], zero), white_hi));
+            out[ch] = _mm_packus_epi16(lo, hi);
+        }
+        store_rgb(rgb + static_cast<size_t>(x) * 3, RGB8_SHUFFLES, out);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    auto div255 = [](uint16x8_t v) {
+        uint16x8_t t = vaddq_u16(v, vdupq_n_u16(128));
+        return vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+    };
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t p = vld4q_u8(cmyk + static_cast<size_t>(x) * 4);
+        uint8x16_t white = vmvnq_u8(p.val[3]);
+        uint8x16x3_t out;
+        for (int ch = 0; ch < 3; ++ch) {
+            uint8x16_t inv = vmvnq_u8(p.val[ch]);
+            out.val[ch] = vcombine_u8(
+                div255(vmull_u8(vget_low_u8(inv), vget_low_u8(white))),
+                div255(vmull_u8(vget_high_u8(inv), vget_high_u8(white))));
+        }
+        vst3q_u8(rgb + static_cast<size_t>(x) * 3, out);
+    }
+#endif
+    reference::cmyk_to_rgb8(cmyk + static_cast<size_t>(x) * 4, width - x,
+                            rgb + static_cast<size_t>(x) * 3);
+}
+
+ColorConverter::ColorConverter(ColorConvertOptions options) : options_(options) {
+    if (options_.band_rows <= 0) {
+        throw std::invalid_argument("Invalid band height: " + std::to_string(options_.band_rows));
+    }
+}
+
+const CalibrationLut* ColorConverter::active_calibration(PixelFormat to) const {
+    const CalibrationLut* calibration = options_.calibration.get();
+    return (calibration && !calibration->is_identity(to)) ? calibration : nullptr;
+}
+
+unsigned ColorConverter::thread_count(int bands) const {
+    unsigned threads = options_.threads ? options_.threads
+                                        : std::max(1u, std::thread::hardware_concurrency());
+    return std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(bands)));
+}
+
+void ColorConverter::convert_row(const uint8_t* src, PixelFormat from,
+                                 uint8_t* dst, PixelFormat to, int width) const {
+    if (from == to) {
+        std::memcpy(dst, src, static_cast<size_t>(width) * bytes_per_pixel(from));
+        return;
+    }
+
+    switch (from) {
+        case PixelFormat::GRAY8:
+            if (to == PixelFormat::RGB8) {
+                for (int x = 0; x < width; ++x) {
+                    dst[x * 3] = dst[x * 3 + 1] = dst[x * 3 + 2] = src[x];
+                }
+            } else {
+                // Cinza só com K
+                for (int x = 0; x < width; ++x) {
+                    dst[x * 4] = dst[x * 4 + 1] = dst[x * 4 + 2] = 0;
+                    dst[x * 4 + 3] = static_cast<uint8_t>(255 - src[x]);
+                }
+            }
+            return;
+        case PixelFormat::RGB8:
+            if (to == PixelFormat::GRAY8) {
+                rgb_to_gray8(src, width, dst);
+            } else {
+                rgb_to_cmyk8(src, width, dst, options_.separation);
+            }
+            return;
+        case PixelFormat::CMYK8:
+            if (to == PixelFormat::RGB8) {
+                cmyk_to_rgb8(src, width, dst);
+            } else {
+                // Via RGB em blocos na pilha
+                constexpr int BLOCK = 256;
+                uint8_t rgb[BLOCK * 3];
+                for (int x = 0; x < width; x += BLOCK) {
+                    int n = std::min(BLOCK, width - x);
+                    cmyk_to_rgb8(src + static_cast<size_t>(x) * 4, n, rgb);
+                    rgb_to_gray8(rgb, n, dst + x);
+                }
+            }
+            return;
+    }
+}
+
+void ColorConverter::convert(const uint8_t* src, PixelFormat from,
+                             uint8_t* dst, PixelFormat to, int width, int height) const {
+    const size_t src_stride = static_cast<size_t>(width) * bytes_per_pixel(from);
+    const size_t dst_stride = static_cast<size_t>(width) * bytes_per_pixel(to);
+    const int bands = (height + options_.band_rows - 1) / options_.band_rows;
+    const CalibrationLut* calibration = active_calibration(to);
+
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        for (int band = next.fetch_add(1); band < bands; band = next.fetch_add(1)) {
+            const int first = band * options_.band_rows;
+            const int last = std::min(height, first + options_.band_rows);
+            for (int y = first; y < last; ++y) {
+                convert_row(src + y * src_stride, from, dst + y * dst_stride, to, width);
+                if (calibration) {
+                    calibration->apply(dst + y * dst_stride, to, width);
+                }
+            }
+        }
+    };
+
+    const unsigned threads = thread_count(bands);
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+TiledRaster ColorConverter::convert(const TiledRaster& page, PixelFormat to,
+                                    TiledRasterOptions options) const {
+    options.tile_size = page.tile_size();
+    TiledRaster result(page.width(), page.height(), to, options);
+    const PixelFormat from = page.format();
+    const int bands = page.band_count();
+    const CalibrationLut* calibration = active_calibration(to);
+    const bool keep_blank = !calibration || calibration->preserves_blank(to);
+    std::mutex write_mutex;
+
+    // Leitura e conversão em paralelo; a gravação das faixas é serializada
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        RowBand band;
+        std::vector<uint8_t> converted;
+        for (int b = next.fetch_add(1); b < bands; b = next.fetch_add(1)) {
+            page.read_band(b, band);
+            if (keep_blank && band.all_blank()) {
+                // Sem tinta continua sem tinta: o tile já nasce vazio
+                continue;
+            }
+            converted.resize(result.row_bytes() * band.rows);
+            for (int r = 0; r < band.rows; ++r) {
+                uint8_t* row = converted.data() + r * result.row_bytes();
+                convert_row(band.row(r), from, row, to, page.width());
+                if (calibration) {
+                    calibration->apply(row, to, page.width());
+                }
+            }
+            std::lock_guard<std::mutex> lock(write_mutex);
+            result.write_band(b, converted.data(), result.row_bytes());
+        }
+    };
+
+    const unsigned threads = thread_count(bands);
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& w : workers) {
+        w.join();
+    }
+    return result;
+}
+
+}  // namespace raster
+}  // namespace all_press
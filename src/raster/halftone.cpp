@@ -0,0 +1,479 @@
+#include "raster/halftone.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace all_press {
+namespace raster {
+
+namespace {
+
+constexpr int CHUNK = 256;  // Pixels por passo da frente de onda
+
+// Inversão dos bits de um byte: movemask produz LSB primeiro
+struct BitReverseTable {
+    uint8_t value[256];
+    BitReverseTable() {
+        for (int i = 0; i < 256; ++i) {
+            uint8_t r = 0;
+            for (int b = 0; b < 8; ++b) {
+                if (i & (1 << b)) {
+                    r |= static_cast<uint8_t>(0x80 >> b);
+                }
+            }
+            value[i] = r;
+        }
+    }
+};
+
+const BitReverseTable& bit_reverse() {
+    static const BitReverseTable table;
+    return table;
+}
+
+std::vector<int> bayer_matrix(int size) {
+    std::vector<int> m = {0};
+    for (int n = 1; n < size; n *= 2) {
+        std::vector<int> next(static_cast<size_t>(4 * n * n));
+        for (int y = 0; y < n; ++y) {
+            for (int x = 0; x < n; ++x) {
+                int v = 4 * m[y * n + x];
+                next[y * 2 * n + x] = v;
+                next[y * 2 * n + x + n] = v + 2;
+                next[(y + n) * 2 * n + x] = v + 3;
+                next[(y + n) * 2 * n + x + n] = v + 1;
+            }
+        }
+        m.swap(next);
+    }
+    return m;
+}
+
+// Máscara blue-noise por void-and-cluster (Ulichney), com energia
+// gaussiana toroidal. Determinística; gerada uma vez por processo.
+std::vector<int> blue_noise_matrix(int size) {
+    const int n = size * size;
+    const double sigma = 1.5;
+
+    std::vector<double> kernel(n);
+    for (int dy = 0; dy < size; ++dy) {
+        for (int dx = 0; dx < size; ++dx) {
+            int tx = std::min(dx, size - dx);
+            int ty = std::min(dy, size - dy);
+            kernel[dy * size + dx] = std::exp(-(tx * tx + ty * ty) / (2 * sigma * sigma));
+        }
+    }
+
+    std::vector<uint8_t> pattern(n, 0);
+    std::vector<double> energy(n, 0.0);
+    auto update = [&](int p, double sign) {
+        int px = p % size;
+        int py = p / size;
+        for (int y = 0; y < size; ++y) {
+            int dy = (y - py + size) % size;
+            for (int x = 0; x < size; ++x) {
+                int dx = (x - px + size) % size;
+                energy[y * size + x] += sign * kernel[dy * size + dx];
+            }
+        }
+    };
+    auto tightest_cluster = [&]() {
+        int best = -1;
+        for (int i = 0; i < n; ++i) {
+            if (pattern[i] && (best < 0 || energy[i] > energy[best])) best = i;
+        }
+        return best;
+    };
+    auto largest_void = [&]() {
+        int best = -1;
+        for (int i = 0; i < n; ++i) {
+            if (!pattern[i] && (best < 0 || energy[i] < energy[best])) best = i;
+        }
+        return best;
+    };
+
+    // Padrão inicial: 10% de pontos pseudo-aleatórios, depois relaxado
+    uint32_t seed = 0x9E3779B9u;
+    int ones = n / 10;
+    for (int placed = 0; placed < ones;) {
+        seed = seed * 1664525u + 1013904223u;
+        int p = static_cast<int>((seed >> 8) % static_cast<uint32_t>(n));
+        if (!pattern[p]) {
+            pattern[p] = 1;
+            update(p, 1.0);
+            ++placed;
+        }
+    }
+    for (int iter = 0; iter < n; ++iter) {
+        int cluster = tightest_cluster();
+        pattern[cluster] = 0;
+        update(cluster, -1.0);
+        int gap = largest_void();
+        if (gap == cluster) {
+            pattern[cluster] = 1;
+            update(cluster, 1.0);
+            break;
+        }
+        pattern[gap] = 1;
+        update(gap, 1.0);
+    }
+
+    std::vector<int> rank(n, 0);
+    std::vector<uint8_t> initial = pattern;
+    std::vector<double> initial_energy = energy;
+
+    // Fase 1: remover os clusters mais densos
+    for (int r = ones - 1; r >= 0; --r) {
+        int cluster = tightest_cluster();
+        pattern[cluster] = 0;
+        update(cluster, -1.0);
+        rank[cluster] = r;
+    }
+
+    // Fases 2 e 3: preencher os maiores vazios
+    pattern = initial;
+    energy = initial_energy;
+    for (int r = ones; r < n; ++r) {
+        int gap = largest_void();
+        pattern[gap] = 1;
+        update(gap, 1.0);
+        rank[gap] = r;
+    }
+    return rank;
+}
+
+const std::vector<int>& cached_blue_noise() {
+    static const std::vector<int> matrix = blue_noise_matrix(64);
+    return matrix;
+}
+
+}  // namespace
+
+HalftoneMethod parse_halftone_method(const std::string& name) {
+    if (name == "threshold") return HalftoneMethod::THRESHOLD;
+    if (name == "bayer") return HalftoneMethod::BAYER;
+    if (name == "blue_noise") return HalftoneMethod::BLUE_NOISE;
+    if (name == "floyd_steinberg") return HalftoneMethod::FLOYD_STEINBERG;
+    if (name == "jarvis") return HalftoneMethod::JARVIS;
+    throw std::invalid_argument("Unknown halftone method: " + name);
+}
+
+Halftoner::Halftoner(HalftoneOptions options) : options_(std::move(options)) {
+    const CalibrationLut* calibration = options_.calibration.get();
+    const bool calibrated = calibration && !calibration->is_identity(PixelFormat::GRAY8);
+    const uint8_t* tone = calibrated ? calibration->table8(ToneChannel::GRAY) : nullptr;
+    // Limiares em uint8 só expressam curvas que mantêm 255 em 255
+    const bool fold = tone && is_ordered() && calibration->is_monotonic(ToneChannel::GRAY) &&
+                      tone[255] == 255;
+    if (tone && !fold) {
+        tone_ = tone;
+    }
+
+    if (!is_ordered()) {
+        // Difusão: branco só fica sem tinta se a curva o mantiver em 255
+        blank_stays_blank_ = !tone || tone[255] == 255;
+        return;
+    }
+
+    std::vector<int> ranks;
+    if (options_.method == HalftoneMethod::BAYER) {
+        matrix_size_ = 8;
+        ranks = bayer_matrix(8);
+    } else if (options_.method == HalftoneMethod::BLUE_NOISE) {
+        matrix_size_ = 64;
+        ranks = cached_blue_noise();
+    } else {
+        matrix_size_ = 1;
+        ranks = {0};
+    }
+
+    // Limiar em 1..255: tinta se cinza < limiar, então 0 sempre marca e 255
+    // nunca marca. Cada linha é replicada até um múltiplo de 32 bytes para
+    // que o laço SIMD leia limiares contíguos.
+    const int cells = matrix_size_ * matrix_size_;
+    period_ = std::max(matrix_size_, 32);
+    thresholds_.resize(static_cast<size_t>(matrix_size_) * period_);
+    for (int y = 0; y < matrix_size_; ++y) {
+        for (int x = 0; x < period_; ++x) {
+            int r = ranks[y * matrix_size_ + (x % matrix_size_)];
+            int t = (options_.method == HalftoneMethod::THRESHOLD)
+                ? 128 : 1 + (r * 255) / cells;
+            if (fold) {
+                // tone[g] < t  <=>  g < menor g' com tone[g'] >= t
+                t = static_cast<int>(std::lower_bound(tone, tone + 256, t) - tone);
+            }
+            thresholds_[static_cast<size_t>(y) * period_ + x] = static_cast<uint8_t>(t);
+        }
+    }
+    // Limiar máximo 255 nunca marca o branco; sem dobra, depende da tabela
+    blank_stays_blank_ = !tone_ || tone_[255] >= *std::max_element(thresholds_.begin(), thresholds_.end());
+}
+
+bool Halftoner::is_ordered() const {
+    return options_.method == HalftoneMethod::THRESHOLD ||
+           options_.method == HalftoneMethod::BAYER ||
+           options_.method == HalftoneMethod::BLUE_NOISE;
+}
+
+void Halftoner::ordered_row(const uint8_t* gray, int width, int y, uint8_t* out) const {
+    const uint8_t* t = thresholds_.data() +
+        static_cast<size_t>(y & (matrix_size_ - 1)) * period_;
+    if (!tone_) {
+        ordered_span(gray, width, t, out);
+        return;
+    }
+
+    // Curva não dobrável: trechos de 256 pixels passam pela tabela (SIMD) num
+    // buffer local e seguem para o limiar. 256 é múltiplo do período e de 8.
+    constexpr int SPAN = 256;
+    uint8_t toned[SPAN];
+    for (int x = 0; x < width; x += SPAN) {
+        const int n = std::min(SPAN, width - x);
+        std::memcpy(toned, gray + x, n);
+        apply_lut8(tone_, toned, n);
+        ordered_span(toned, n, t, out + x / 8);
+    }
+}
+
+void Halftoner::ordered_span(const uint8_t* gray, int width, const uint8_t* t,
+                             uint8_t* out) const {
+    const uint8_t* rev = bit_reverse().value;
+    int x = 0;
+
+#if defined(__AVX2__)
+    for (; x + 32 <= width; x += 32) {
+        __m256i g = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(gray + x));
+        __m256i th = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(t + (x % period_)));
+        // g >= t  <=>  max(g, t) == g; tinta é o complemento
+        __m256i ge = _mm256_cmpeq_epi8(_mm256_max_epu8(g, th), g);
+        uint32_t ink = ~static_cast<uint32_t>(_mm256_movemask_epi8(ge));
+        uint8_t* o = out + x / 8;
+        o[0] = rev[ink & 0xFF];
+        o[1] = rev[(ink >> 8) & 0xFF];
+        o[2] = rev[(ink >> 16) & 0xFF];
+        o[3] = rev[ink >> 24];
+    }
+#elif defined(__SSE2__)
+    for (; x + 16 <= width; x += 16) {
+        __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(gray + x));
+        __m128i th = _mm_loadu_si128(reinterpret_cast<const __m128i*>(t + (x % period_)));
+        __m128i ge = _mm_cmpeq_epi8(_mm_max_epu8(g, th), g);
+        uint32_t ink = ~static_cast<uint32_t>(_mm_movemask_epi8(ge));
+        uint8_t* o = out + x / 8;
+        o[0] = rev[ink & 0xFF];
+        o[1] = rev[(ink >> 8) & 0xFF];
+    }
+#elif defined(__ARM_NEON)
+    static const uint8_t weights_data[16] = {
+        128, 64, 32, 16, 8, 4, 2, 1, 128, 64, 32, 16, 8, 4, 2, 1
+    };
+    const uint8x16_t weights = vld1q_u8(weights_data);
+    for (; x + 16 <= width; x += 16) {
+        uint8x16_t g = vld1q_u8(gray + x);
+        uint8x16_t th = vld1q_u8(t + (x % period_));
+        uint8x16_t bits = vandq_u8(vcltq_u8(g, th), weights);
+        uint8x8_t s = vpadd_u8(vget_low_u8(bits), vget_high_u8(bits));
+        s = vpadd_u8(s, s);
+        s = vpadd_u8(s, s);
+        out[x / 8] = vget_lane_u8(s, 0);
+        out[x / 8 + 1] = vget_lane_u8(s, 1);
+    }
+#endif
+    (void)rev;
+
+    // Restante (e caminho escalar completo sem SIMD)
+    if (x < width) {
+        std::memset(out + x / 8, 0, packed_row_bytes(width) - x / 8);
+    }
+    for (; x < width; ++x) {
+        if (gray[x] < t[x % period_]) {
+            out[x / 8] |= static_cast<uint8_t>(0x80 >> (x % 8));
+        }
+    }
+}
+
+void Halftoner::diffuse(const uint8_t* gray, int width, int rows, size_t stride,
+                        int first_row, std::vector<int32_t>& errors, int ring,
+                        uint8_t* out) const {
+    // Pesos em 1/48 (Floyd-Steinberg x3); linha atual via carry local,
+    // linhas seguintes no anel de erros (2 pixels de margem de cada lado)
+    const bool jarvis = options_.method == HalftoneMethod::JARVIS;
+    const int lag = jarvis ? 4 : 2;
+    const size_t err_stride = static_cast<size_t>(width) + 4;
+    const size_t out_stride = packed_row_bytes(width);
+
+    unsigned threads = options_.threads ? options_.threads
+                                        : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned>(threads, static_cast<unsigned>(rows));
+    threads = std::min<unsigned>(threads, static_cast<unsigned>(ring - 3));
+
+    std::vector<std::atomic<int>> progress(static_cast<size_t>(rows));
+    for (auto& p : progress) {
+        p.store(0, std::memory_order_relaxed);
+    }
+
+    auto row_error = [&](int absolute_row) {
+        return errors.data() + static_cast<size_t>(absolute_row % ring) * err_stride + 2;
+    };
+
+    static const std::array<uint8_t, 256> identity = [] {
+        std::array<uint8_t, 256> table{};
+        for (int v = 0; v < 256; ++v) table[v] = static_cast<uint8_t>(v);
+        return table;
+    }();
+    const uint8_t* tone = tone_ ? tone_ : identity.data();
+
+    auto process_row = [&](int r) {
+        const int y = first_row + r;
+        const uint8_t* src = gray + static_cast<size_t>(r) * stride;
+        uint8_t* dst = out + static_cast<size_t>(r) * out_stride;
+        std::memset(dst, 0, out_stride);
+
+        int32_t* e0 = row_error(y);
+        int32_t* e1 = row_error(y + 1);
+        int32_t* e2 = jarvis ? row_error(y + 2) : nullptr;
+        int32_t carry1 = 0;
+        int32_t carry2 = 0;
+
+        for (int x0 = 0; x0 < width; x0 += CHUNK) {
+            const int x1 = std::min(width, x0 + CHUNK);
+            if (r > 0) {
+                const int required = std::min(width, x1 + lag);
+                while (progress[r - 1].load(std::memory_order_acquire) < required) {
+                    std::this_thread::yield();
+                }
+            }
+
+            for (int x = x0; x < x1; ++x) {
+                int32_t acc = e0[x] + carry1;
+                e0[x] = 0;  // Lido e liberado para reuso do anel
+                carry1 = carry2;
+                carry2 = 0;
+
+                int32_t value = tone[src[x]] + acc / 48;
+                int32_t target = 255;
+                if (value < 128) {
+                    target = 0;
+                    dst[x / 8] |= static_cast<uint8_t>(0x80 >> (x % 8));
+                }
+                int32_t err = value - target;
+
+                if (jarvis) {
+                    carry1 += err * 7;
+                    carry2 += err * 5;
+                    e1[x - 2] += err * 3;
+                    e1[x - 1] += err * 5;
+                    e1[x] += err * 7;
+                    e1[x + 1] += err * 5;
+                    e1[x + 2] += err * 3;
+                    e2[x - 2] += err * 1;
+                    e2[x - 1] += err * 3;
+                    e2[x] += err * 5;
+                    e2[x + 1] += err * 3;
+                    e2[x + 2] += err * 1;
+                } else {
+                    carry1 += err * 21;
+                    e1[x - 1] += err * 9;
+                    e1[x] += err * 15;
+                    e1[x + 1] += err * 3;
+                }
+            }
+            progress[r].store(x1, std::memory_order_release);
+        }
+        // Margens não são lidas por ninguém
+        e0[-2] = e0[-1] = e0[width] = e0[width + 1] = 0;
+    };
+
+    if (threads <= 1) {
+        for (int r = 0; r < rows; ++r) {
+            process_row(r);
+        }
+        return;
+    }
+
+    // Frente de onda: thread t processa as linhas t, t + threads, ...
+    std::vector<std::thread> workers;
+    for (unsigned t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int r = static_cast<int>(t); r < rows; r += static_cast<int>(threads)) {
+                process_row(r);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void Halftoner::process(const uint8_t* gray, int width, int height, size_t stride,
+                        uint8_t* out) const {
+    const size_t out_stride = packed_row_bytes(width);
+
+    if (is_ordered()) {
+        for (int y = 0; y < height; ++y) {
+            ordered_row(gray + static_cast<size_t>(y) * stride, width, y,
+                        out + static_cast<size_t>(y) * out_stride);
+        }
+        return;
+    }
+
+    unsigned threads = options_.threads ? options_.threads
+                                        : std::max(1u, std::thread::hardware_concurrency());
+    const int ring = static_cast<int>(threads) + 3;
+    std::vector<int32_t> errors(static_cast<size_t>(ring) * (static_cast<size_t>(width) + 4), 0);
+    diffuse(gray, width, height, stride, 0, errors, ring, out);
+}
+
+void Halftoner::process(const TiledRaster& page, const PackedRowSink& sink) const {
+    if (page.format() != PixelFormat::GRAY8) {
+        throw std::invalid_argument("Halftoning requires a GRAY8 raster");
+    }
+
+    const int width = page.width();
+    const size_t out_stride = packed_row_bytes(width);
+    std::vector<uint8_t> packed(out_stride * page.tile_size());
+
+    unsigned threads = options_.threads ? options_.threads
+                                        : std::max(1u, std::thread::hardware_concurrency());
+    const int ring = static_cast<int>(threads) + 3;
+    std::vector<int32_t> errors;
+    if (!is_ordered()) {
+        errors.assign(static_cast<size_t>(ring) * (static_cast<size_t>(width) + 4), 0);
+    }
+
+    page.for_each_band([&](const RowBand& band) {
+        if (is_ordered()) {
+            if (blank_stays_blank_ && band.all_blank()) {
+                // Branco nunca marca com matriz ordenada
+                std::fill(packed.begin(), packed.end(), 0);
+            } else {
+                for (int r = 0; r < band.rows; ++r) {
+                    ordered_row(band.row(r), width, band.y + r,
+                                packed.data() + static_cast<size_t>(r) * out_stride);
+                }
+            }
+        } else {
+            // O erro atravessa faixas pelo anel compartilhado
+            diffuse(band.data, width, band.rows, band.stride, band.y, errors, ring,
+                    packed.data());
+        }
+
+        for (int r = 0; r < band.rows; ++r) {
+            sink(band.y + r, packed.data() + static_cast<size_t>(r) * out_stride);
+        }
+        return true;
+    });
+}
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,360 @@
+#include "raster/icc_catalog.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace all_press {
+namespace raster {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char* INDEX_MAGIC = "all_press_icc_index 1";
+
+bool is_profile_file(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".icc" || ext == ".icm";
+}
+
+// Tamanho e mtime; false se o arquivo sumiu ou não é regular
+bool file_stamp(const fs::path& path, uint64_t& size, int64_t& mtime_ns) {
+    std::error_code ec;
+    if (!fs::is_regular_file(path, ec)) {
+        return false;
+    }
+    size = fs::file_size(path, ec);
+    if (ec) {
+        return false;
+    }
+    const auto mtime = fs::last_write_time(path, ec);
+    if (ec) {
+        return false;
+    }
+    mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        mtime.time_since_epoch()).count();
+    return true;
+}
+
+std::string sanitize(std::string text) {
+    for (char& c : text) {
+        if (c == '\t' || c == '\n' || c == '\r') c = ' ';
+    }
+    return text;
+}
+
+std::vector<std::string> split_tabs(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string field;
+    std::istringstream in(line);
+    while (std::getline(in, field, '\t')) {
+        fields.push_back(field);
+    }
+    if (!line.empty() && line.back() == '\t') {
+        fields.emplace_back();
+    }
+    return fields;
+}
+
+}  // namespace
+
+MappedFile::MappedFile(const std::string& path) {
+#ifndef _WIN32
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot map empty or unreadable file: " + path);
+    }
+    void* mapped = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Cannot map file: " + path);
+    }
+    data_ = static_cast<const uint8_t*>(mapped);
+    size_ = static_cast<size_t>(st.st_size);
+#else
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open file: " + path);
+    }
+    fallback_.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data_ = fallback_.data();
+    size_ = fallback_.size();
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (data_) {
+        ::munmap(const_cast<uint8_t*>(data_), size_);
+    }
+#endif
+}
+
+IccCatalog::IccCatalog(IccCatalogOptions options) : options_(std::move(options)) {}
+
+IccCatalogEntry IccCatalog::inspect_file(const std::string& path) {
+    IccCatalogEntry entry;
+    entry.path = path;
+    entry.name = fs::path(path).stem().string();
+    if (!file_stamp(path, entry.file_size, entry.mtime_ns)) {
+        throw std::runtime_error("Not a regular file: " + path);
+    }
+    MappedFile file(path);
+    entry.info = IccProfile::inspect(file.data(), file.size());
+    return entry;
+}
+
+IccCatalogScanStats IccCatalog::scan(const std::vector<std::string>& directories) {
+    IccCatalogScanStats stats;
+
+    // Lista de arquivos na ordem dos diretórios; a leitura dos cabeçalhos é
+    // que vai para as threads
+    std::vector<std::string> paths;
+    for (const auto& directory : directories) {
+        std::error_code ec;
+        std::vector<std::string> found;
+        fs::recursive_directory_iterator it(directory, fs::directory_options::skip_permission_denied, ec);
+        for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_regular_file(ec) && is_profile_file(it->path())) {
+                found.push_back(it->path().string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        paths.insert(paths.end(), found.begin(), found.end());
+    }
+    stats.files = paths.size();
+
+    const auto index = load_index();
+    std::vector<IccCatalogEntry> scanned(paths.size());
+    std::vector<char> valid(paths.size(), 0);
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> parsed{0};
+    std::atomic<size_t> reused{0};
+
+    auto worker = [&] {
+        for (size_t i = next.fetch_add(1); i < paths.size(); i = next.fetch_add(1)) {
+            uint64_t size = 0;
+            int64_t mtime_ns = 0;
+            if (!file_stamp(paths[i], size, mtime_ns)) {
+                continue;
+            }
+            auto cached = index.find(paths[i]);
+            if (cached != index.end() && cached->second.file_size == size &&
+                cached->second.mtime_ns == mtime_ns) {
+                scanned[i] = cached->second;
+                valid[i] = 1;
+                reused.fetch_add(1);
+                continue;
+            }
+            try {
+                scanned[i] = inspect_file(paths[i]);
+                valid[i] = 1;
+                parsed.fetch_add(1);
+            } catch (const std::exception&) {
+                // Arquivo inválido ou não suportado: fica fora do catálogo
+            }
+        }
+    };
+
+    unsigned threads = options_.threads ? options_.threads
+                                        : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(paths.size())));
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& w : workers) {
+        w.join();
+    }
+
+    stats.parsed = parsed.load();
+    stats.reused = reused.load();
+    std::vector<IccCatalogEntry> entries;
+    for (size_t i = 0; i < paths.size(); ++i) {
+        if (valid[i]) {
+            entries.push_back(std::move(scanned[i]));
+        } else {
+            ++stats.invalid;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::map<std::string, std::shared_ptr<Slot>> by_path;
+        std::unordered_map<std::string, std::string> by_name;
+        for (const auto& entry : entries) {
+            // Perfis já interpretados e sem mudança continuam em cache
+            auto old = by_path_.find(entry.path);
+            if (old != by_path_.end() && old->second->entry.file_size == entry.file_size &&
+                old->second->entry.mtime_ns == entry.mtime_ns) {
+                by_path[entry.path] = old->second;
+            } else {
+                auto slot = std::make_shared<Slot>();
+                slot->entry = entry;
+                by_path[entry.path] = slot;
+            }
+            by_name.emplace(entry.name, entry.path);
+        }
+        by_path_.swap(by_path);
+        by_name_.swap(by_name);
+    }
+
+    if (stats.parsed > 0 || entries.size() != index.size()) {
+        save_index(entries);
+    }
+    return stats;
+}
+
+std::vector<IccCatalogEntry> IccCatalog::entries() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<IccCatalogEntry> result;
+    result.reserve(by_path_.size());
+    for (const auto& pair : by_path_) {
+        result.push_back(pair.second->entry);
+    }
+    return result;
+}
+
+size_t IccCatalog::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return by_path_.size();
+}
+
+std::shared_ptr<IccCatalog::Slot> IccCatalog::slot(const std::string& name) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = by_path_.find(name);
+    if (it != by_path_.end()) {
+        return it->second;
+    }
+    auto named = by_name_.find(name);
+    if (named != by_name_.end()) {
+        return by_path_.at(named->second);
+    }
+    return nullptr;
+}
+
+bool IccCatalog::find(const std::string& name, IccCatalogEntry& entry) const {
+    auto found = slot(name);
+    if (!found) {
+        return false;
+    }
+    entry = found->entry;
+    return true;
+}
+
+std::shared_ptr<const IccProfile> IccCatalog::profile(const std::string& name) const {
+    auto found = slot(name);
+    if (!found) {
+        throw std::runtime_error("ICC profile not in catalog: " + name);
+    }
+    // Interpretação completa fora do lock do catálogo, uma vez por perfil
+    std::call_once(found->parsed, [&] {
+        MappedFile file(found->entry.path);
+        found->profile = IccProfile::parse(file.data(), file.size());
+    });
+    return found->profile;
+}
+
+std::unordered_map<std::string, IccCatalogEntry> IccCatalog::load_index() const {
+    std::unordered_map<std::string, IccCatalogEntry> index;
+    if (options_.index_path.empty()) {
+        return index;
+    }
+    std::ifstream in(options_.index_path);
+    std::string line;
+    if (!in || !std::getline(in, line) || line != INDEX_MAGIC) {
+        return index;
+    }
+
+    // Linhas malformadas são ignoradas: o arquivo correspondente é relido
+    while (std::getline(in, line)) {
+        const auto fields = split_tabs(line);
+        if (fields.size() != 11) {
+            continue;
+        }
+        try {
+            IccCatalogEntry entry;
+            entry.path = fields[0];
+            entry.name = fs::path(entry.path).stem().string();
+            entry.file_size = std::stoull(fields[1]);
+            entry.mtime_ns = std::stoll(fields[2]);
+            IccHeader& h = entry.info.header;
+            h.size = static_cast<uint32_t>(entry.file_size);
+            h.version_major = std::stoi(fields[3]);
+            h.version_minor = std::stoi(fields[4]);
+            h.device_class = fields[5];
+            h.color_space = static_cast<IccColorSpace>(std::stoi(fields[6]));
+            h.pcs = static_cast<IccColorSpace>(std::stoi(fields[7]));
+            h.intent = static_cast<RenderingIntent>(std::stoi(fields[8]) & 3);
+            entry.info.tag_count = static_cast<uint32_t>(std::stoul(fields[9]));
+            entry.info.description = fields[10];
+            index[entry.path] = std::move(entry);
+        } catch (const std::exception&) {
+        }
+    }
+    return index;
+}
+
+void IccCatalog::save_index(const std::vector<IccCatalogEntry>& entries) const {
+    if (options_.index_path.empty()) {
+        return;
+    }
+    // Gravação atômica (arquivo temporário + rename). O índice é só um
+    // atalho: falhas aqui não invalidam a varredura.
+    std::error_code ec;
+    const fs::path target(options_.index_path);
+    if (target.has_parent_path()) {
+        fs::create_directories(target.parent_path(), ec);
+    }
+    const std::string temp = options_.index_path + ".tmp";
+    {
+        std::ofstream out(temp, std::ios::trunc);
+        if (!out) {
+            return;
+        }
+        out << INDEX_MAGIC << "\n";
+        for (const auto& entry : entries) {
+            if (entry.path.find_first_of("\t\n\r") != std::string::npos) {
+                continue;
+            }
+            const IccHeader& h = entry.info.header;
+            out << entry.path << '\t' << entry.file_size << '\t' << entry.mtime_ns << '\t'
+                << h.version_major << '\t' << h.version_minor << '\t' << sanitize(h.device_class) << '\t'
+                << static_cast<int>(h.color_space) << '\t' << static_cast<int>(h.pcs) << '\t'
+                << static_cast<int>(h.intent) << '\t' << entry.info.tag_count << '\t'
+                << sanitize(entry.info.description) << '\n';
+        }
+        if (!out) {
+            return;
+        }
+    }
+    fs::rename(temp, target, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+    }
+}
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,884 @@
+#include "raster/icc_profile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace all_press {
+namespace raster {
+
+namespace {
+
+constexpr double D50[3] = {0.9642, 1.0, 0.8249};
+
+uint32_t sig(const char* s) {
+    return (static_cast<uint32_t>(static_cast<uint8_t>(s[0])) << 24) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(s[1])) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(s[2])) << 8) |
+           static_cast<uint32_t>(static_cast<uint8_t>(s[3]));
+}
+
+std::string sig_string(uint32_t value) {
+    std::string s(4, ' ');
+    for (int i = 0; i < 4; ++i) {
+        s[i] = static_cast<char>((value >> (24 - 8 * i)) & 0xFF);
+    }
+    return s;
+}
+
+// Leitura big-endian com verificação de limites
+class Reader {
+public:
+    Reader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    void require(size_t offset, size_t length) const {
+        if (offset > size_ || length > size_ - offset) {
+            throw std::runtime_error("Truncated ICC profile");
+        }
+    }
+    uint8_t u8(size_t offset) const {
+        require(offset, 1);
+        return data_[offset];
+    }
+    uint16_t u16(size_t offset) const {
+        require(offset, 2);
+        return static_cast<uint16_t>((data_[offset] << 8) | data_[offset + 1]);
+    }
+    uint32_t u32(size_t offset) const {
+        require(offset, 4);
+        return (static_cast<uint32_t>(data_[offset]) << 24) |
+               (static_cast<uint32_t>(data_[offset + 1]) << 16) |
+               (static_cast<uint32_t>(data_[offset + 2]) << 8) |
+               static_cast<uint32_t>(data_[offset + 3]);
+    }
+    double s15f16(size_t offset) const {
+        return static_cast<int32_t>(u32(offset)) / 65536.0;
+    }
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+};
+
+IccColorSpace parse_color_space(uint32_t value) {
+    if (value == sig("GRAY")) return IccColorSpace::GRAY;
+    if (value == sig("RGB ")) return IccColorSpace::RGB;
+    if (value == sig("CMYK")) return IccColorSpace::CMYK;
+    if (value == sig("Lab ")) return IccColorSpace::LAB;
+    if (value == sig("XYZ ")) return IccColorSpace::XYZ;
+    return IccColorSpace::OTHER;
+}
+
+uint64_t fnv1a(const uint8_t* data, size_t size) {
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+double clamp01(double v) {
+    return std::min(1.0, std::max(0.0, v));
+}
+
+// Lab <-> XYZ relativos a D50
+double lab_f(double t) {
+    return t > 216.0 / 24389.0 ? std::cbrt(t) : (24389.0 / 27.0 * t + 16.0) / 116.0;
+}
+
+double lab_f_inv(double t) {
+    return t > 6.0 / 29.0 ? t * t * t : (116.0 * t - 16.0) * 27.0 / 24389.0;
+}
+
+void xyz_to_lab(const double* xyz, double* lab) {
+    double fx = lab_f(xyz[0] / D50[0]);
+    double fy = lab_f(xyz[1] / D50[1]);
+    double fz = lab_f(xyz[2] / D50[2]);
+    lab[0] = 116.0 * fy - 16.0;
+    lab[1] = 500.0 * (fx - fy);
+    lab[2] = 200.0 * (fy - fz);
+}
+
+void lab_to_xyz(const double* lab, double* xyz) {
+    double fy = (lab[0] + 16.0) / 116.0;
+    xyz[0] = D50[0] * lab_f_inv(fy + lab[1] / 500.0);
+    xyz[1] = D50[1] * lab_f_inv(fy);
+    xyz[2] = D50[2] * lab_f_inv(fy - lab[2] / 200.0);
+}
+
+bool invert3x3(const double* m, double* out) {
+    double det = m[0] * (m[4] * m[8] - m[5] * m[7]) -
+                 m[1] * (m[3] * m[8] - m[5] * m[6]) +
+                 m[2] * (m[3] * m[7] - m[4] * m[6]);
+    if (std::fabs(det) < 1e-12) {
+        return false;
+    }
+    out[0] = (m[4] * m[8] - m[5] * m[7]) / det;
+    out[1] = (m[2] * m[7] - m[1] * m[8]) / det;
+    out[2] = (m[1] * m[5] - m[2] * m[4]) / det;
+    out[3] = (m[5] * m[6] - m[3] * m[8]) / det;
+    out[4] = (m[0] * m[8] - m[2] * m[6]) / det;
+    out[5] = (m[2] * m[3] - m[0] * m[5]) / det;
+    out[6] = (m[3] * m[7] - m[4] * m[6]) / det;
+    out[7] = (m[1] * m[6] - m[0] * m[7]) / det;
+    out[8] = (m[0] * m[4] - m[1] * m[3]) / det;
+    return true;
+}
+
+}  // namespace
+
+int icc_channels(IccColorSpace space) {
+    switch (space) {
+        case IccColorSpace::GRAY: return 1;
+        case IccColorSpace::CMYK: return 4;
+        case IccColorSpace::RGB:
+        case IccColorSpace::LAB:
+        case IccColorSpace::XYZ: return 3;
+        case IccColorSpace::OTHER: return 0;
+    }
+    return 0;
+}
+
+const char* icc_color_space_name(IccColorSpace space) {
+    switch (space) {
+        case IccColorSpace::GRAY: return "GRAY";
+        case IccColorSpace::RGB: return "RGB";
+        case IccColorSpace::CMYK: return "CMYK";
+        case IccColorSpace::LAB: return "Lab";
+        case IccColorSpace::XYZ: return "XYZ";
+        case IccColorSpace::OTHER: return "OTHER";
+    }
+    return "OTHER";
+}
+
+// Curva de tom: 'curv' (identidade, gama ou tabela) ou 'para' (tipos 0-4)
+struct IccProfile::Curve {
+    enum class Kind { IDENTITY, GAMMA, TABLE, PARAMETRIC };
+
+    Kind kind = Kind::IDENTITY;
+    double gamma = 1.0;
+    std::vector<double> table;   // Normalizada em [0, 1]
+    int function = 0;
+    double p[7] = {1.0, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0};  // g, a, b, c, d, e, f
+
+    static Curve gamma_curve(double g) {
+        Curve curve;
+        curve.kind = Kind::GAMMA;
+        curve.gamma = g;
+        return curve;
+    }
+
+    double eval(double x) const {
+        x = clamp01(x);
+        switch (kind) {
+            case Kind::IDENTITY:
+                return x;
+            case Kind::GAMMA:
+                return std::pow(x, gamma);
+            case Kind::TABLE: {
+                if (table.size() == 1) return table[0];
+                double pos = x * (table.size() - 1);
+                size_t i = std::min(static_cast<size_t>(pos), table.size() - 2);
+                double f = pos - i;
+                return table[i] + (table[i + 1] - table[i]) * f;
+            }
+            case Kind::PARAMETRIC:
+                return clamp01(eval_parametric(x));
+        }
+        return x;
+    }
+
+    double eval_parametric(double x) const {
+        const double g = p[0], a = p[1], b = p[2], c = p[3], d = p[4], e = p[5], f = p[6];
+        auto power = [&](double v) { return v > 0.0 ? std::pow(v, g) : 0.0; };
+        switch (function) {
+            case 0: return power(x);
+            case 1: return x >= -b / a ? power(a * x + b) : 0.0;
+            case 2: return x >= -b / a ? power(a * x + b) + c : c;
+            case 3: return x >= d ? power(a * x + b) : c * x;
+            case 4: return x >= d ? power(a * x + b) + e : c * x + f;
+        }
+        return x;
+    }
+
+    // Inversa numérica (curvas monotônicas; só na compilação)
+    double inverse(double y) const {
+        if (kind == Kind::IDENTITY) return clamp01(y);
+        if (kind == Kind::GAMMA && gamma > 0.0) return std::pow(clamp01(y), 1.0 / gamma);
+
+        const bool rising = eval(1.0) >= eval(0.0);
+        double lo = 0.0, hi = 1.0;
+        for (int i = 0; i < 40; ++i) {
+            double mid = 0.5 * (lo + hi);
+            if ((eval(mid) < y) == rising) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        return 0.5 * (lo + hi);
+    }
+};
+
+// Cadeia de estágios de uma tabela AToB/BToA, em valores normalizados [0, 1]
+struct IccProfile::Pipeline {
+    enum class StageType { CURVES, MATRIX, CLUT };
+    // Codificação dos valores PCS na saída (AToB) ou entrada (BToA)
+    enum class PcsEncoding { LAB_V2_16, LAB_V2_8, LAB_V4, XYZ };
+
+    struct Stage {
+        StageType type = StageType::CURVES;
+        std::vector<Curve> curves;
+        double matrix[12] = {1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0};
+        int inputs = 0;
+        int outputs = 0;
+        std::vector<int> grid;
+        std::vector<double> clut;
+    };
+
+    int inputs = 0;
+    int outputs = 0;
+    PcsEncoding encoding = PcsEncoding::XYZ;
+    std::vector<Stage> stages;
+
+    void eval(const double* in, double* out) const {
+        double buffer[16] = {};
+        double next[16] = {};
+        std::copy(in, in + inputs, buffer);
+        int channels = inputs;
+
+        for (const auto& stage : stages) {
+            switch (stage.type) {
+                case StageType::CURVES:
+                    for (int i = 0; i < channels && i < static_cast<int>(stage.curves.size()); ++i) {
+                        buffer[i] = stage.curves[i].eval(buffer[i]);
+                    }
+                    break;
+                case StageType::MATRIX: {
+                    const double* m = stage.matrix;
+                    for (int r = 0; r < 3; ++r) {
+                        next[r] = m[r * 3] * buffer[0] + m[r * 3 + 1] * buffer[1] +
+                                  m[r * 3 + 2] * buffer[2] + m[9 + r];
+                    }
+                    for (int r = 0; r < 3; ++r) buffer[r] = clamp01(next[r]);
+                    break;
+                }
+                case StageType::CLUT:
+                    eval_clut(stage, buffer, next);
+                    channels = stage.outputs;
+                    std::copy(next, next + channels, buffer);
+                    break;
+            }
+        }
+        std::copy(buffer, buffer + outputs, out);
+    }
+
+    // Interpolação multilinear; a primeira entrada é a mais significativa
+    static void eval_clut(const Stage& stage, const double* in, double* out) {
+        const int n = stage.inputs;
+        int index[16];
+        double frac[16];
+        size_t stride[16];
+        size_t s = static_cast<size_t>(stage.outputs);
+        for (int i = n - 1; i >= 0; --i) {
+            stride[i] = s;
+            s *= static_cast<size_t>(stage.grid[i]);
+        }
+        for (int i = 0; i < n; ++i) {
+            int points = stage.grid[i];
+            double pos = clamp01(in[i]) * (points - 1);
+            index[i] = std::min(static_cast<int>(pos), std::max(points - 2, 0));
+            frac[i] = points > 1 ? pos - index[i] : 0.0;
+        }
+
+        std::fill(out, out + stage.outputs, 0.0);
+        for (int corner = 0; corner < (1 << n); ++corner) {
+            double weight = 1.0;
+            size_t offset = 0;
+            for (int i = 0; i < n; ++i) {
+                bool upper = (corner >> i) & 1;
+                if (upper && stage.grid[i] == 1) {
+                    weight = 0.0;
+                    break;
+                }
+                weight *= upper ? frac[i] : 1.0 - frac[i];
+                offset += (index[i] + (upper ? 1 : 0)) * stride[i];
+            }
+            if (weight == 0.0) continue;
+            for (int o = 0; o < stage.outputs; ++o) {
+                out[o] += weight * stage.clut[offset + o];
+            }
+        }
+    }
+};
+
+namespace {
+
+using Curve = IccProfile::Curve;
+using Pipeline = IccProfile::Pipeline;
+
+// Lê uma curva 'curv' ou 'para'; devolve o tamanho ocupado (sem alinhamento)
+size_t parse_curve(const Reader& r, size_t offset, Curve& curve) {
+    const uint32_t type = r.u32(offset);
+    if (type == sig("curv")) {
+        const uint32_t count = r.u32(offset + 8);
+        if (count == 0) {
+            curve.kind = Curve::Kind::IDENTITY;
+        } else if (count == 1) {
+            curve.kind = Curve::Kind::GAMMA;
+            curve.gamma = r.u16(offset + 12) / 256.0;
+        } else {
+            r.require(offset + 12, static_cast<size_t>(count) * 2);
+            curve.kind = Curve::Kind::TABLE;
+            curve.table.resize(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                curve.table[i] = r.u16(offset + 12 + i * 2) / 65535.0;
+            }
+        }
+        return 12 + static_cast<size_t>(count) * 2;
+    }
+    if (type == sig("para")) {
+        static const int PARAMS[] = {1, 3, 4, 5, 7};
+        const int function = r.u16(offset + 8);
+        if (function < 0 || function > 4) {
+            throw std::runtime_error("Unsupported ICC parametric curve type");
+        }
+        curve.kind = Curve::Kind::PARAMETRIC;
+        curve.function = function;
+        for (int i = 0; i < PARAMS[function]; ++i) {
+            curve.p[i] = r.s15f16(offset + 12 + i * 4);
+        }
+        return 12 + static_cast<size_t>(PARAMS[function]) * 4;
+    }
+    throw std::runtime_error("Unsupported ICC curve type '" + sig_string(type) + "'");
+}
+
+std::vector<Curve> parse_curve_set(const Reader& r, size_t offset, int count) {
+    std::vector<Curve> curves(count);
+    for (int i = 0; i < count; ++i) {
+        size_t used = parse_curve(r, offset, curves[i]);
+        offset += (used + 3) & ~static_cast<size_t>(3);
+    }
+    return curves;
+}
+
+// Tabelas de lut8/lut16: entradas igualmente espaçadas
+Curve table_curve(const Reader& r, size_t offset, size_t entries, int bytes) {
+    Curve curve;
+    curve.kind = Curve::Kind::TABLE;
+    curve.table.resize(entries);
+    for (size_t i = 0; i < entries; ++i) {
+        curve.table[i] = bytes == 1 ? r.u8(offset + i) / 255.0 : r.u16(offset + i * 2) / 65535.0;
+    }
+    return curve;
+}
+
+size_t grid_size(const std::vector<int>& grid) {
+    size_t total = 1;
+    for (int g : grid) total *= static_cast<size_t>(g);
+    return total;
+}
+
+// lut8Type ('mft1') e lut16Type ('mft2')
+std::unique_ptr<Pipeline> parse_mft(const Reader& r, size_t offset, bool sixteen,
+                                    IccColorSpace pcs, bool pcs_is_input) {
+    auto pipeline = std::make_unique<Pipeline>();
+    const int in = r.u8(offset + 8);
+    const int out = r.u8(offset + 9);
+    const int points = r.u8(offset + 10);
+    if (in < 1 || in > 15 || out < 1 || out > 15 || points < 2) {
+        throw std::runtime_error("Invalid ICC lut table");
+    }
+    pipeline->inputs = in;
+    pipeline->outputs = out;
+    pipeline->encoding = pcs == IccColorSpace::LAB
+        ? (sixteen ? Pipeline::PcsEncoding::LAB_V2_16 : Pipeline::PcsEncoding::LAB_V2_8)
+        : Pipeline::PcsEncoding::XYZ;
+
+    // A matriz só se aplica a entradas XYZ
+    if (pcs_is_input && pcs == IccColorSpace::XYZ) {
+        Pipeline::Stage matrix;
+        matrix.type = Pipeline::StageType::MATRIX;
+        for (int i = 0; i < 9; ++i) {
+            matrix.matrix[i] = r.s15f16(offset + 12 + i * 4);
+        }
+        pipeline->stages.push_back(std::move(matrix));
+    }
+
+    size_t cursor = offset + 48;
+    size_t in_entries = 256, out_entries = 256;
+    const int bytes = sixteen ? 2 : 1;
+    if (sixteen) {
+        in_entries = r.u16(offset + 48);
+        out_entries = r.u16(offset + 50);
+        cursor = offset + 52;
+        if (in_entries < 2 || out_entries < 2) {
+            throw std::runtime_error("Invalid ICC lut16 table size");
+        }
+    }
+
+    Pipeline::Stage input;
+    for (int i = 0; i < in; ++i) {
+        input.curves.push_back(table_curve(r, cursor, in_entries, bytes));
+        cursor += in_entries * bytes;
+    }
+    pipeline->stages.push_back(std::move(input));
+
+    Pipeline::Stage clut;
+    clut.type = Pipeline::StageType::CLUT;
+    clut.inputs = in;
+    clut.outputs = out;
+    clut.grid.assign(in, points);
+    const size_t values = grid_size(clut.grid) * out;
+    r.require(cursor, values * bytes);
+    clut.clut.resize(values);
+    for (size_t i = 0; i < values; ++i) {
+        clut.clut[i] = sixteen ? r.u16(cursor + i * 2) / 65535.0 : r.u8(cursor + i) / 255.0;
+    }
+    cursor += values * bytes;
+    pipeline->stages.push_back(std::move(clut));
+
+    Pipeline::Stage output;
+    for (int i = 0; i < out; ++i) {
+        output.curves.push_back(table_curve(r, cursor, out_entries, bytes));
+        cursor += out_entries * bytes;
+    }
+    pipeline->stages.push_back(std::move(output));
+    return pipeline;
+}
+
+Pipeline::Stage parse_clut_stage(const Reader& r, size_t offset, int in, int out) {
+    Pipeline::Stage clut;
+    clut.type = Pipeline::StageType::CLUT;
+    clut.inputs = in;
+    clut.outputs = out;
+    for (int i = 0; i < in; ++i) {
+        int points = r.u8(offset + i);
+        if (points < 1) {
+            throw std::runtime_error("Invalid ICC CLUT grid");
+        }
+        clut.grid.push_back(points);
+    }
+    const int precision = r.u8(offset + 16);
+    if (precision != 1 && precision != 2) {
+        throw std::runtime_error("Invalid ICC CLUT precision");
+    }
+    const size_t values = grid_size(clut.grid) * out;
+    const size_t data = offset + 20;
+    r.require(data, values * precision);
+    clut.clut.resize(values);
+    for (size_t i = 0; i < values; ++i) {
+        clut.clut[i] = precision == 1 ? r.u8(data + i) / 255.0 : r.u16(data + i * 2) / 65535.0;
+    }
+    return clut;
+}
+
+Pipeline::Stage parse_matrix_stage(const Reader& r, size_t offset) {
+    Pipeline::Stage matrix;
+    matrix.type = Pipeline::StageType::MATRIX;
+    for (int i = 0; i < 12; ++i) {
+        matrix.matrix[i] = r.s15f16(offset + i * 4);
+    }
+    return matrix;
+}
+
+Pipeline::Stage curve_stage(std::vector<Curve> curves) {
+    Pipeline::Stage stage;
+    stage.curves = std::move(curves);
+    return stage;
+}
+
+// lutAtoBType ('mAB ') e lutBtoAType ('mBA '), ICC v4
+std::unique_ptr<Pipeline> parse_mab(const Reader& r, size_t offset, bool a_to_b,
+                                    IccColorSpace pcs) {
+    auto pipeline = std::make_unique<Pipeline>();
+    const int in = r.u8(offset + 8);
+    const int out = r.u8(offset + 9);
+    if (in < 1 || in > 15 || out < 1 || out > 15) {
+        throw std::runtime_error("Invalid ICC lutAtoB/lutBtoA table");
+    }
+    pipeline->inputs = in;
+    pipeline->outputs = out;
+    pipeline->encoding = pcs == IccColorSpace::LAB ? Pipeline::PcsEncoding::LAB_V4
+                                                   : Pipeline::PcsEncoding::XYZ;
+
+    const uint32_t b_off = r.u32(offset + 12);
+    const uint32_t matrix_off = r.u32(offset + 16);
+    const uint32_t m_off = r.u32(offset + 20);
+    const uint32_t clut_off = r.u32(offset + 24);
+    const uint32_t a_off = r.u32(offset + 28);
+
+    if (a_to_b) {
+        // A -> CLUT -> M -> Matriz -> B
+        if (clut_off) {
+            if (a_off) pipeline->stages.push_back(curve_stage(parse_curve_set(r, offset + a_off, in)));
+            pipeline->stages.push_back(parse_clut_stage(r, offset + clut_off, in, out));
+        }
+        if (matrix_off) {
+            if (m_off) pipeline->stages.push_back(curve_stage(parse_curve_set(r, offset + m_off, 3)));
+            pipeline->stages.push_back(parse_matrix_stage(r, offset + matrix_off));
+        }
+        if (b_off) pipeline->stages.push_back(curve_stage(parse_curve_set(r, offset + b_off, out)));
+    } else {
+        // B -> Matriz -> M -> CLUT -> A
+        if (b_off) pipeline->stages.push_back(curve_stage(parse_curve_set(r, offset + b_off, in)));
+        if (matrix_off) {
+            pipeline->stages.push_back(parse_matrix_stage(r, offset + matrix_off));
+            if (m_off) pipeline->stages.push_back(curve_stage(parse_curve_set(r, offset + m_off, 3)));
+        }
+        if (clut_off) {
+            pipeline->stages.push_back(parse_clut_stage(r, offset + clut_off, in, out));
+            if (a_off) pipeline->stages.push_back(curve_stage(parse_curve_set(r, offset + a_off, out)));
+        }
+    }
+    return pipeline;
+}
+
+std::unique_ptr<Pipeline> parse_lut(const Reader& r, size_t offset, bool a_to_b,
+                                    IccColorSpace pcs) {
+    const uint32_t type = r.u32(offset);
+    if (type == sig("mft1")) return parse_mft(r, offset, false, pcs, !a_to_b);
+    if (type == sig("mft2")) return parse_mft(r, offset, true, pcs, !a_to_b);
+    if (type == sig("mAB ") && a_to_b) return parse_mab(r, offset, true, pcs);
+    if (type == sig("mBA ") && !a_to_b) return parse_mab(r, offset, false, pcs);
+    throw std::runtime_error("Unsupported ICC lut type '" + sig_string(type) + "'");
+}
+
+// Valores PCS normalizados de uma tabela <-> XYZ
+void decode_pcs(Pipeline::PcsEncoding encoding, const double* n, double* xyz) {
+    double lab[3];
+    switch (encoding) {
+        case Pipeline::PcsEncoding::XYZ:
+            for (int i = 0; i < 3; ++i) xyz[i] = n[i] * 65535.0 / 32768.0;
+            return;
+        case Pipeline::PcsEncoding::LAB_V2_16:
+            lab[0] = n[0] * 65535.0 / 65280.0 * 100.0;
+            lab[1] = n[1] * 65535.0 / 256.0 - 128.0;
+            lab[2] = n[2] * 65535.0 / 256.0 - 128.0;
+            break;
+        case Pipeline::PcsEncoding::LAB_V2_8:
+        case Pipeline::PcsEncoding::LAB_V4:
+            lab[0] = n[0] * 100.0;
+            lab[1] = n[1] * 255.0 - 128.0;
+            lab[2] = n[2] * 255.0 - 128.0;
+            break;
+        default:
+            throw std::runtime_error("Unknown ICC PCS encoding");
+    }
+    lab_to_xyz(lab, xyz);
+}
+
+void encode_pcs(Pipeline::PcsEncoding encoding, const double* xyz, double* n) {
+    if (encoding == Pipeline::PcsEncoding::XYZ) {
+        for (int i = 0; i < 3; ++i) n[i] = clamp01(xyz[i] * 32768.0 / 65535.0);
+        return;
+    }
+    double lab[3];
+    xyz_to_lab(xyz, lab);
+    if (encoding == Pipeline::PcsEncoding::LAB_V2_16) {
+        n[0] = lab[0] / 100.0 * 65280.0 / 65535.0;
+        n[1] = (lab[1] + 128.0) * 256.0 / 65535.0;
+        n[2] = (lab[2] + 128.0) * 256.0 / 65535.0;
+    } else {
+        n[0] = lab[0] / 100.0;
+        n[1] = (lab[1] + 128.0) / 255.0;
+        n[2] = (lab[2] + 128.0) / 255.0;
+    }
+    for (int i = 0; i < 3; ++i) n[i] = clamp01(n[i]);
+}
+
+std::string parse_description(const Reader& r, size_t offset, size_t size) {
+    const uint32_t type = r.u32(offset);
+    if (type == sig("desc")) {
+        uint32_t count = r.u32(offset + 8);
+        count = static_cast<uint32_t>(std::min<size_t>(count, size > 12 ? size - 12 : 0));
+        r.require(offset + 12, count);
+        std::string text(reinterpret_cast<const char*>(r.data() + offset + 12), count);
+        return text.substr(0, text.find('\0'));
+    }
+    if (type == sig("mluc")) {
+        const uint32_t records = r.u32(offset + 8);
+        if (records == 0) return "";
+        const uint32_t length = r.u32(offset + 20);
+        const uint32_t start = r.u32(offset + 24);
+        r.require(offset + start, length);
+        // UTF-16BE; caracteres fora de ASCII viram '?'
+        std::string text;
+        for (uint32_t i = 0; i + 1 < length; i += 2) {
+            uint16_t ch = r.u16(offset + start + i);
+            text += ch < 0x80 ? static_cast<char>(ch) : '?';
+        }
+        return text;
+    }
+    return "";
+}
+
+}  // namespace
+
+IccProfile::IccProfile() = default;
+IccProfile::~IccProfile() = default;
+
+IccProfileInfo IccProfile::inspect(const uint8_t* data, size_t size) {
+    const Reader r(data, size);
+    if (size < 132 || r.u32(36) != sig("acsp")) {
+        throw std::runtime_error("Not an ICC profile");
+    }
+
+    IccProfileInfo info;
+    IccHeader& h = info.header;
+    h.size = r.u32(0);
+    h.version_major = r.u8(8);
+    h.version_minor = r.u8(9) >> 4;
+    h.device_class = sig_string(r.u32(12));
+    h.color_space = parse_color_space(r.u32(16));
+    h.pcs = parse_color_space(r.u32(20));
+    h.intent = static_cast<RenderingIntent>(r.u32(64) & 3);
+
+    if (h.size > size) {
+        throw std::runtime_error("Truncated ICC profile");
+    }
+    if (h.version_major < 2 || h.version_major > 4) {
+        throw std::runtime_error("Unsupported ICC version " + std::to_string(h.version_major));
+    }
+    if (h.pcs != IccColorSpace::XYZ && h.pcs != IccColorSpace::LAB) {
+        throw std::runtime_error("Unsupported ICC connection space");
+    }
+    if (h.device_class == "link" || h.device_class == "abst" || h.device_class == "nmcl") {
+        throw std::runtime_error("Unsupported ICC device class '" + h.device_class + "'");
+    }
+    if (h.color_space != IccColorSpace::GRAY && h.color_space != IccColorSpace::RGB &&
+        h.color_space != IccColorSpace::CMYK) {
+        throw std::runtime_error("Unsupported ICC data color space");
+    }
+
+    // Tabela de tags: todas as entradas precisam caber no arquivo
+    info.tag_count = r.u32(128);
+    r.require(132, static_cast<size_t>(info.tag_count) * 12);
+    for (uint32_t i = 0; i < info.tag_count; ++i) {
+        const size_t entry = 132 + static_cast<size_t>(i) * 12;
+        const uint32_t offset = r.u32(entry + 4);
+        const uint32_t length = r.u32(entry + 8);
+        r.require(offset, length);
+        if (r.u32(entry) == sig("desc")) {
+            info.description = parse_description(r, offset, length);
+        }
+    }
+    return info;
+}
+
+std::shared_ptr<const IccProfile> IccProfile::parse(const uint8_t* data, size_t size) {
+    IccProfileInfo info = inspect(data, size);
+
+    std::shared_ptr<IccProfile> profile(new IccProfile());
+    profile->header_ = std::move(info.header);
+    profile->description_ = std::move(info.description);
+    profile->id_ = fnv1a(data, size);
+    profile->parse_tags(data, size);
+    return profile;
+}
+
+std::shared_ptr<const IccProfile> IccProfile::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open ICC profile: " + path);
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)),
+                              std::istreambuf_iterator<char>());
+    return parse(data.data(), data.size());
+}
+
+void IccProfile::parse_tags(const uint8_t* data, size_t size) {
+    const Reader r(data, size);
+    const uint32_t count = r.u32(128);
+
+    // Limites já validados por inspect()
+    constexpr int TAGS = 14;
+    static const char* const names[TAGS] = {
+        "rXYZ", "gXYZ", "bXYZ", "rTRC", "gTRC", "bTRC", "kTRC", "wtpt",
+        "A2B0", "A2B1", "A2B2", "B2A0", "B2A1", "B2A2"
+    };
+    size_t tag_offset[TAGS] = {};
+    for (uint32_t i = 0; i < count; ++i) {
+        const size_t entry = 132 + static_cast<size_t>(i) * 12;
+        const uint32_t tag = r.u32(entry);
+        for (int n = 0; n < TAGS; ++n) {
+            if (tag == sig(names[n])) {
+                tag_offset[n] = r.u32(entry + 4);
+            }
+        }
+    }
+    auto xyz = [&](int n, double* out) {
+        if (r.u32(tag_offset[n]) != sig("XYZ ")) {
+            throw std::runtime_error("Invalid ICC XYZ tag");
+        }
+        for (int i = 0; i < 3; ++i) out[i] = r.s15f16(tag_offset[n] + 8 + i * 4);
+    };
+
+    if (tag_offset[7]) {
+        xyz(7, white_point_);
+    }
+
+    const IccColorSpace pcs = header_.pcs;
+    for (int i = 0; i < 3; ++i) {
+        if (tag_offset[8 + i]) a2b_[i] = parse_lut(r, tag_offset[8 + i], true, pcs);
+        if (tag_offset[11 + i]) b2a_[i] = parse_lut(r, tag_offset[11 + i], false, pcs);
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (a2b_[i] && (a2b_[i]->inputs != channels() || a2b_[i]->outputs != 3)) {
+            throw std::runtime_error("ICC AToB table does not match the color space");
+        }
+        if (b2a_[i] && (b2a_[i]->inputs != 3 || b2a_[i]->outputs != channels())) {
+            throw std::runtime_error("ICC BToA table does not match the color space");
+        }
+    }
+
+    if (header_.color_space == IccColorSpace::RGB && tag_offset[0] && tag_offset[1] &&
+        tag_offset[2] && tag_offset[3] && tag_offset[4] && tag_offset[5]) {
+        double column[3];
+        for (int c = 0; c < 3; ++c) {
+            xyz(c, column);
+            for (int row = 0; row < 3; ++row) matrix_[row * 3 + c] = column[row];
+        }
+        for (int c = 0; c < 3; ++c) {
+            Curve curve;
+            parse_curve(r, tag_offset[3 + c], curve);
+            trc_.push_back(std::move(curve));
+        }
+        finish_matrix();
+    } else if (header_.color_space == IccColorSpace::GRAY && tag_offset[6]) {
+        Curve curve;
+        parse_curve(r, tag_offset[6], curve);
+        trc_.push_back(std::move(curve));
+    }
+
+    if (!a2b_[0] && trc_.empty()) {
+        throw std::runtime_error("ICC profile has no usable transform");
+    }
+}
+
+void IccProfile::finish_matrix() {
+    if (!invert3x3(matrix_, inverse_)) {
+        throw std::runtime_error("Singular ICC colorant matrix");
+    }
+}
+
+std::shared_ptr<const IccProfile> IccProfile::srgb() {
+    static const std::shared_ptr<const IccProfile> profile = [] {
+        std::shared_ptr<IccProfile> p(new IccProfile());
+        p->header_.version_major = 2;
+        p->header_.version_minor = 1;
+        p->header_.device_class = "mntr";
+        p->header_.color_space = IccColorSpace::RGB;
+        p->header_.pcs = IccColorSpace::XYZ;
+        p->description_ = "sRGB IEC61966-2.1";
+        p->id_ = 0x7352474200000001ull;
+
+        // Primárias adaptadas a D50 (Bradford), colunas r, g, b
+        const double m[9] = {
+            0.4360747, 0.3850649, 0.1430804,
+            0.2225045, 0.7168786, 0.0606169,
+            0.0139322, 0.0971045, 0.7141733
+        };
+        std::copy(m, m + 9, p->matrix_);
+        Curve trc;
+        trc.kind = Curve::Kind::PARAMETRIC;
+        trc.function = 3;
+        const double params[5] = {2.4, 1.0 / 1.055, 0.055 / 1.055, 1.0 / 12.92, 0.04045};
+        std::copy(params, params + 5, trc.p);
+        p->trc_.assign(3, trc);
+        p->finish_matrix();
+        return p;
+    }();
+    return profile;
+}
+
+std::shared_ptr<const IccProfile> IccProfile::gray(double gamma) {
+    std::shared_ptr<IccProfile> p(new IccProfile());
+    p->header_.version_major = 2;
+    p->header_.version_minor = 1;
+    p->header_.device_class = "mntr";
+    p->header_.color_space = IccColorSpace::GRAY;
+    p->header_.pcs = IccColorSpace::XYZ;
+    p->description_ = "Gray gamma " + std::to_string(gamma);
+    uint64_t bits;
+    std::memcpy(&bits, &gamma, sizeof(bits));
+    p->id_ = 0x4752415900000000ull ^ bits;
+    p->trc_.push_back(Curve::gamma_curve(gamma));
+    return p;
+}
+
+bool IccProfile::can_output() const {
+    return b2a_[0] != nullptr || !trc_.empty();
+}
+
+const IccProfile::Pipeline* IccProfile::select(const std::unique_ptr<Pipeline> (&tables)[3],
+                                               RenderingIntent intent) const {
+    int index = 0;
+    switch (intent) {
+        case RenderingIntent::PERCEPTUAL: index = 0; break;
+        case RenderingIntent::RELATIVE_COLORIMETRIC:
+        case RenderingIntent::ABSOLUTE_COLORIMETRIC: index = 1; break;
+        case RenderingIntent::SATURATION: index = 2; break;
+    }
+    if (tables[index]) return tables[index].get();
+    return tables[0].get();
+}
+
+void IccProfile::to_pcs(const double* device, double* xyz, RenderingIntent intent) const {
+    const Pipeline* table = select(a2b_, intent);
+    if (table) {
+        double in[16];
+        for (int i = 0; i < table->inputs; ++i) in[i] = clamp01(device[i]);
+        double pcs[3];
+        table->eval(in, pcs);
+        decode_pcs(table->encoding, pcs, xyz);
+    } else if (header_.color_space == IccColorSpace::GRAY) {
+        double y = trc_[0].eval(device[0]);
+        for (int i = 0; i < 3; ++i) xyz[i] = D50[i] * y;
+    } else {
+        double linear[3];
+        for (int i = 0; i < 3; ++i) linear[i] = trc_[i].eval(device[i]);
+        for (int r = 0; r < 3; ++r) {
+            xyz[r] = matrix_[r * 3] * linear[0] + matrix_[r * 3 + 1] * linear[1] +
+                     matrix_[r * 3 + 2] * linear[2];
+        }
+    }
+
+    // Absoluta: escala pelo branco da mídia (XYZ relativo -> absoluto)
+    if (intent == RenderingIntent::ABSOLUTE_COLORIMETRIC) {
+        for (int i = 0; i < 3; ++i) xyz[i] *= white_point_[i] / D50[i];
+    }
+}
+
+void IccProfile::from_pcs(const double* xyz_in, double* device, RenderingIntent intent) const {
+    double xyz[3] = {xyz_in[0], xyz_in[1], xyz_in[2]};
+    if (intent == RenderingIntent::ABSOLUTE_COLORIMETRIC) {
+        for (int i = 0; i < 3; ++i) xyz[i] *= D50[i] / white_point_[i];
+    }
+
+    const Pipeline* table = select(b2a_, intent);
+    if (table) {
+        double pcs[3];
+        encode_pcs(table->encoding, xyz, pcs);
+        table->eval(pcs, device);
+        for (int i = 0; i < table->outputs; ++i) device[i] = clamp01(device[i]);
+    } else if (header_.color_space == IccColorSpace::GRAY && !trc_.empty()) {
+        device[0] = trc_[0].inverse(clamp01(xyz[1]));
+    } else if (trc_.size() == 3) {
+        for (int r = 0; r < 3; ++r) {
+            double linear = inverse_[r * 3] * xyz[0] + inverse_[r * 3 + 1] * xyz[1] +
+                            inverse_[r * 3 + 2] * xyz[2];
+            device[r] = trc_[r].inverse(clamp01(linear));
+        }
+    } else {
+        throw std::runtime_error("ICC profile cannot be used as a conversion target");
+    }
+}
+
+}  // namespace raster
+}  // namespace all_press
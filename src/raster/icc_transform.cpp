@@ -0,0 +1,352 @@
+#include "raster/icc_transform.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace all_press {
+namespace raster {
+
+namespace {
+
+constexpr int CMYK_MAX_GRID = 17;
+
+// Soma ponderada de N nós (4 floats cada), arredondada e saturada em 0..255
+template <int N>
+inline void blend(const float* const* node, const float* weight, uint8_t* out, int channels) {
+#if defined(__SSE2__)
+    __m128 acc = _mm_mul_ps(_mm_loadu_ps(node[0]), _mm_set1_ps(weight[0]));
+    for (int i = 1; i < N; ++i) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(node[i]), _mm_set1_ps(weight[i])));
+    }
+    __m128i q = _mm_cvtps_epi32(acc);
+    q = _mm_packs_epi32(q, q);
+    q = _mm_packus_epi16(q, q);
+    const uint32_t packed = static_cast<uint32_t>(_mm_cvtsi128_si32(q));
+    std::memcpy(out, &packed, channels);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    float32x4_t acc = vmulq_n_f32(vld1q_f32(node[0]), weight[0]);
+    for (int i = 1; i < N; ++i) {
+        acc = vfmaq_n_f32(acc, vld1q_f32(node[i]), weight[i]);
+    }
+    const uint16x4_t half = vqmovun_s32(vcvtnq_s32_f32(acc));
+    const uint8x8_t bytes = vqmovn_u16(vcombine_u16(half, half));
+    const uint32_t packed = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+    std::memcpy(out, &packed, channels);
+#else
+    for (int c = 0; c < channels; ++c) {
+        float acc = 0.0f;
+        for (int i = 0; i < N; ++i) {
+            acc += node[i][c] * weight[i];
+        }
+        out[c] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, std::nearbyint(acc))));
+    }
+#endif
+}
+
+// Escolhe o tetraedro do cubo (seis casos, como no lcms): devolve os deslocamentos
+// dos dois vértices intermediários e os pesos de c000, v1, v2 e c111
+inline void tetrahedron(float fx, float fy, float fz, size_t sx, size_t sy, size_t sz,
+                        size_t& v1, size_t& v2, float* w) {
+    float a, b, c;
+    if (fx >= fy) {
+        if (fy >= fz) {
+            v1 = sx; v2 = sx + sy; a = fx; b = fy; c = fz;
+        } else if (fx >= fz) {
+            v1 = sx; v2 = sx + sz; a = fx; b = fz; c = fy;
+        } else {
+            v1 = sz; v2 = sx + sz; a = fz; b = fx; c = fy;
+        }
+    } else {
+        if (fx >= fz) {
+            v1 = sy; v2 = sx + sy; a = fy; b = fx; c = fz;
+        } else if (fy >= fz) {
+            v1 = sy; v2 = sy + sz; a = fy; b = fz; c = fx;
+        } else {
+            v1 = sz; v2 = sy + sz; a = fz; b = fy; c = fx;
+        }
+    }
+    w[0] = 1.0f - a;
+    w[1] = a - b;
+    w[2] = b - c;
+    w[3] = c;
+}
+
+template <typename Worker>
+void run_parallel(unsigned threads, Worker worker) {
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+}  // namespace
+
+std::shared_ptr<const IccTransform> IccTransform::build(const IccProfile& source,
+                                                        const IccProfile& target,
+                                                        RenderingIntent intent,
+                                                        IccTransformOptions options) {
+    const int inputs = source.channels();
+    const int outputs = target.channels();
+    if (inputs != 1 && inputs != 3 && inputs != 4) {
+        throw std::invalid_argument("Unsupported ICC source color space");
+    }
+    if (outputs != 1 && outputs != 3 && outputs != 4) {
+        throw std::invalid_argument("Unsupported ICC target color space");
+    }
+    if (!target.can_output()) {
+        throw std::invalid_argument("ICC target profile has no output transform");
+    }
+    if (options.grid_points < 2 || options.grid_points > 256) {
+        throw std::invalid_argument("Invalid ICC grid size: " + std::to_string(options.grid_points));
+    }
+    if (options.band_rows <= 0) {
+        throw std::invalid_argument("Invalid band height: " + std::to_string(options.band_rows));
+    }
+
+    std::shared_ptr<IccTransform> transform(new IccTransform());
+    transform->inputs_ = inputs;
+    transform->outputs_ = outputs;
+    transform->options_ = options;
+
+    auto evaluate = [&](const double* device, double* result) {
+        double xyz[3];
+        source.to_pcs(device, xyz, intent);
+        target.from_pcs(xyz, result, intent);
+    };
+
+    if (inputs == 1) {
+        transform->table_.resize(256 * static_cast<size_t>(outputs));
+        for (int v = 0; v < 256; ++v) {
+            const double device = v / 255.0;
+            double result[4];
+            evaluate(&device, result);
+            for (int c = 0; c < outputs; ++c) {
+                transform->table_[v * outputs + c] =
+                    static_cast<uint8_t>(std::lround(std::min(1.0, std::max(0.0, result[c])) * 255.0));
+            }
+        }
+        return transform;
+    }
+
+    const int grid = inputs == 4 ? std::min(options.grid_points, CMYK_MAX_GRID) : options.grid_points;
+    transform->grid_ = grid;
+    for (int v = 0; v < 256; ++v) {
+        const float pos = v * (grid - 1) / 255.0f;
+        const int index = std::min(static_cast<int>(pos), grid - 2);
+        transform->index_[v] = index;
+        transform->fraction_[v] = pos - index;
+    }
+
+    // Grade: o primeiro canal é o mais significativo; em CMYK o K vem antes,
+    // para que cada fatia de K seja uma grade 3D contígua
+    size_t nodes = 1;
+    for (int i = 0; i < inputs; ++i) {
+        nodes *= static_cast<size_t>(grid);
+    }
+    transform->nodes_.assign(nodes * 4, 0.0f);
+
+    const size_t slab = nodes / grid;
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        for (int outer = next.fetch_add(1); outer < grid; outer = next.fetch_add(1)) {
+            for (size_t n = 0; n < slab; ++n) {
+                const size_t node = static_cast<size_t>(outer) * slab + n;
+                int coord[4];
+                size_t rest = node;
+                for (int i = inputs - 1; i >= 0; --i) {
+                    coord[i] = static_cast<int>(rest % grid);
+                    rest /= grid;
+                }
+                double device[4];
+                if (inputs == 4) {
+                    // coord = (K, C, M, Y)
+                    for (int i = 0; i < 3; ++i) device[i] = coord[i + 1] / double(grid - 1);
+                    device[3] = coord[0] / double(grid - 1);
+                } else {
+                    for (int i = 0; i < 3; ++i) device[i] = coord[i] / double(grid - 1);
+                }
+                double result[4];
+                evaluate(device, result);
+                float* out = &transform->nodes_[node * 4];
+                for (int c = 0; c < outputs; ++c) {
+                    out[c] = static_cast<float>(std::min(1.0, std::max(0.0, result[c])) * 255.0);
+                }
+            }
+        }
+    };
+    run_parallel(transform->thread_count(grid), worker);
+    return transform;
+}
+
+unsigned IccTransform::thread_count(int jobs) const {
+    unsigned threads = options_.threads ? options_.threads
+                                        : std::max(1u, std::thread::hardware_concurrency());
+    return std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(std::max(jobs, 1))));
+}
+
+void IccTransform::apply3(const uint8_t* in, uint8_t* out, size_t pixels) const {
+    const size_t sz = 4;
+    const size_t sy = sz * grid_;
+    const size_t sx = sy * grid_;
+    const float* base = nodes_.data();
+
+    for (size_t p = 0; p < pixels; ++p, in += 3, out += outputs_) {
+        const uint8_t r = in[0], g = in[1], b = in[2];
+        const float* c0 = base + index_[r] * sx + index_[g] * sy + index_[b] * sz;
+        size_t v1, v2;
+        float w[4];
+        tetrahedron(fraction_[r], fraction_[g], fraction_[b], sx, sy, sz, v1, v2, w);
+        const float* node[4] = {c0, c0 + v1, c0 + v2, c0 + sx + sy + sz};
+        blend<4>(node, w, out, outputs_);
+    }
+}
+
+void IccTransform::apply4(const uint8_t* in, uint8_t* out, size_t pixels) const {
+    const size_t sz = 4;
+    const size_t sy = sz * grid_;
+    const size_t sx = sy * grid_;
+    const size_t sk = sx * grid_;
+    const float* base = nodes_.data();
+
+    for (size_t p = 0; p < pixels; ++p, in += 4, out += outputs_) {
+        const uint8_t c = in[0], m = in[1], y = in[2], k = in[3];
+        const float* c0 = base + index_[k] * sk + index_[c] * sx + index_[m] * sy + index_[y] * sz;
+        size_t v1, v2;
+        float w[4];
+        tetrahedron(fraction_[c], fraction_[m], fraction_[y], sx, sy, sz, v1, v2, w);
+
+        // Mesmo tetraedro nas duas fatias de K, combinadas linearmente
+        const float fk = fraction_[k];
+        const float* node[8] = {c0, c0 + v1, c0 + v2, c0 + sx + sy + sz,
+                                c0 + sk, c0 + sk + v1, c0 + sk + v2, c0 + sk + sx + sy + sz};
+        float weight[8];
+        for (int i = 0; i < 4; ++i) {
+            weight[i] = w[i] * (1.0f - fk);
+            weight[i + 4] = w[i] * fk;
+        }
+        blend<8>(node, weight, out, outputs_);
+    }
+}
+
+void IccTransform::apply(const uint8_t* in, uint8_t* out, size_t pixels) const {
+    switch (inputs_) {
+        case 1:
+            for (size_t p = 0; p < pixels; ++p, out += outputs_) {
+                std::memcpy(out, &table_[in[p] * static_cast<size_t>(outputs_)], outputs_);
+            }
+            return;
+        case 3:
+            apply3(in, out, pixels);
+            return;
+        case 4:
+            apply4(in, out, pixels);
+            return;
+    }
+}
+
+void IccTransform::apply(const uint8_t* in, uint8_t* out, int width, int height,
+                         const CalibrationLut* calibration) const {
+    const size_t in_stride = static_cast<size_t>(width) * inputs_;
+    const size_t out_stride = static_cast<size_t>(width) * outputs_;
+    const int bands = (height + options_.band_rows - 1) / options_.band_rows;
+    const PixelFormat format = outputs_ == 1 ? PixelFormat::GRAY8
+                             : outputs_ == 4 ? PixelFormat::CMYK8 : PixelFormat::RGB8;
+    if (calibration && calibration->is_identity(format)) {
+        calibration = nullptr;
+    }
+
+    std::atomic<int> next{0};
+    auto worker = [&] {
+        for (int band = next.fetch_add(1); band < bands; band = next.fetch_add(1)) {
+            const int first = band * options_.band_rows;
+            const int last = std::min(height, first + options_.band_rows);
+            if (!calibration) {
+                apply(in + first * in_stride, out + first * out_stride,
+                      static_cast<size_t>(last - first) * width);
+                continue;
+            }
+            for (int y = first; y < last; ++y) {
+                apply(in + y * in_stride, out + y * out_stride, static_cast<size_t>(width));
+                calibration->apply(out + y * out_stride, format, static_cast<size_t>(width));
+            }
+        }
+    };
+    run_parallel(thread_count(bands), worker);
+}
+
+IccTransformCache::IccTransformCache(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {}
+
+IccTransformCache& IccTransformCache::instance() {
+    static IccTransformCache cache;
+    return cache;
+}
+
+std::shared_ptr<const IccTransform> IccTransformCache::get(const IccProfile& source,
+                                                           const IccProfile& target,
+                                                           RenderingIntent intent,
+                                                           IccTransformOptions options) {
+    const Key key{source.id(), target.id(), static_cast<int>(intent), options.grid_points};
+    std::shared_ptr<Entry> entry;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            ++stats_.hits;
+            lru_.splice(lru_.begin(), lru_, it->second);
+            entry = *it->second;
+        } else {
+            ++stats_.misses;
+            entry = std::make_shared<Entry>();
+            entry->key = key;
+            lru_.push_front(entry);
+            index_[key] = lru_.begin();
+            if (lru_.size() > capacity_) {
+                // Quem ainda usa a entrada removida mantém a própria referência
+                index_.erase(lru_.back()->key);
+                lru_.pop_back();
+            }
+        }
+    }
+
+    // Falha na compilação propaga a exceção e deixa a próxima chamada tentar de novo
+    std::call_once(entry->built, [&] {
+        entry->transform = IccTransform::build(source, target, intent, options);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.builds;
+    });
+    return entry->transform;
+}
+
+IccTransformCache::Stats IccTransformCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+size_t IccTransformCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return lru_.size();
+}
+
+void IccTransformCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    stats_ = Stats{};
+}
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,276 @@
+#include "raster/image_io.h"
+#include <cctype>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace all_press {
+namespace raster {
+
+namespace {
+
+// Próximo token do cabeçalho, ignorando comentários '#'
+std::string next_token(std::istream& in) {
+    std::string token;
+    int ch;
+    while ((ch = in.get()) != EOF) {
+        if (ch == '#') {
+            in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            continue;
+        }
+        if (std::isspace(ch)) {
+            if (!token.empty()) {
+                break;
+            }
+            continue;
+        }
+        token += static_cast<char>(ch);
+    }
+    return token;
+}
+
+int parse_int(const std::string& token, const std::string& path) {
+    try {
+        size_t used = 0;
+        int value = std::stoi(token, &used);
+        if (used == token.size()) {
+            return value;
+        }
+    } catch (const std::exception&) {
+    }
+    throw std::runtime_error("Invalid PNM header in " + path);
+}
+
+bool little_endian() {
+    const uint16_t probe = 1;
+    return *reinterpret_cast<const uint8_t*>(&probe) == 1;
+}
+
+// PNM guarda 16 bits em big-endian
+void swap_samples16(std::vector<uint8_t>& data) {
+    if (!little_endian()) {
+        return;
+    }
+    for (size_t i = 0; i + 1 < data.size(); i += 2) {
+        std::swap(data[i], data[i + 1]);
+    }
+}
+
+PnmHeader read_header(std::istream& in, const std::string& path) {
+    PnmHeader header;
+    int maxval = 0;
+    const std::string magic = next_token(in);
+
+    if (magic == "P5" || magic == "P6") {
+        header.format = (magic == "P5") ? PixelFormat::GRAY8 : PixelFormat::RGB8;
+        header.width = parse_int(next_token(in), path);
+        header.height = parse_int(next_token(in), path);
+        maxval = parse_int(next_token(in), path);
+    } else if (magic == "P7") {
+        int depth = 0;
+        std::string tupltype;
+        for (std::string key = next_token(in); key != "ENDHDR"; key = next_token(in)) {
+            if (key.empty()) {
+                throw std::runtime_error("Truncated PAM header in " + path);
+            }
+            if (key == "WIDTH") header.width = parse_int(next_token(in), path);
+            else if (key == "HEIGHT") header.height = parse_int(next_token(in), path);
+            else if (key == "DEPTH") depth = parse_int(next_token(in), path);
+            else if (key == "MAXVAL") maxval = parse_int(next_token(in), path);
+            else if (key == "TUPLTYPE") tupltype = next_token(in);
+        }
+        if (tupltype == "GRAYSCALE" && depth == 1) {
+            header.format = PixelFormat::GRAY8;
+        } else if (tupltype == "RGB" && depth == 3) {
+            header.format = PixelFormat::RGB8;
+        } else if (tupltype == "CMYK" && depth == 4) {
+            header.format = PixelFormat::CMYK8;
+        } else {
+            throw std::runtime_error("Unsupported PAM tuple type '" + tupltype + "' in " + path);
+        }
+    } else {
+        throw std::runtime_error("Unsupported image format: " + path);
+    }
+
+    if (header.width <= 0 || header.height <= 0) {
+        throw std::runtime_error("Invalid image size in " + path);
+    }
+    if (maxval != 255 && maxval != 65535) {
+        throw std::runtime_error("Unsupported PNM maxval " + std::to_string(maxval) + " in " + path);
+    }
+    header.bit_depth = (maxval == 255) ? 8 : 16;
+    header.data_offset = static_cast<size_t>(in.tellg());
+    return header;
+}
+
+Image read_image(std::istream& in, const std::string& path) {
+    const PnmHeader header = read_header(in, path);
+    Image image;
+    image.width = header.width;
+    image.height = header.height;
+    image.format = header.format;
+    image.bit_depth = header.bit_depth;
+
+    image.data.resize(image.row_bytes() * image.height);
+    in.read(reinterpret_cast<char*>(image.data.data()),
+            static_cast<std::streamsize>(image.data.size()));
+    if (in.gcount() != static_cast<std::streamsize>(image.data.size())) {
+        throw std::runtime_error("Truncated image data in " + path);
+    }
+    if (image.bit_depth == 16) {
+        swap_samples16(image.data);
+    }
+    return image;
+}
+
+}  // namespace
+
+PnmHeader read_pnm_header(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open image: " + path);
+    }
+    return read_header(in, path);
+}
+
+Image read_pnm(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open image: " + path);
+    }
+    return read_image(in, path);
+}
+
+std::vector<Image> read_pnm_pages(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Cannot open image: " + path);
+    }
+    std::vector<Image> pages;
+    do {
+        pages.push_back(read_image(in, path));
+        while (std::isspace(in.peek())) {
+            in.get();
+        }
+    } while (in.peek() != EOF);
+    return pages;
+}
+
+PnmPageReader::PnmPageReader(const std::string& path)
+    : path_(path), in_(path, std::ios::binary) {
+    if (!in_) {
+        throw std::runtime_error("Cannot open image: " + path);
+    }
+}
+
+bool PnmPageReader::next_page() {
+    if (in_page_ && rows_read_ < header_.height) {
+        const size_t row = static_cast<size_t>(header_.width) * bytes_per_pixel(header_.format) *
+                           (header_.bit_depth / 8);
+        in_.seekg(static_cast<std::streamoff>(row * (header_.height - rows_read_)), std::ios::cur);
+    }
+    in_page_ = false;
+    while (std::isspace(in_.peek())) {
+        in_.get();
+    }
+    if (in_.peek() == EOF) {
+        return false;
+    }
+    header_ = read_header(in_, path_);
+    rows_read_ = 0;
+    in_page_ = true;
+    return true;
+}
+
+void PnmPageReader::read_rows(uint8_t* dst, int rows) {
+    if (!in_page_ || rows < 0 || rows > header_.height - rows_read_) {
+        throw std::out_of_range("PNM rows past the end of the page in " + path_);
+    }
+    const size_t bytes = static_cast<size_t>(header_.width) * bytes_per_pixel(header_.format) * rows;
+    uint8_t* target = dst;
+    if (header_.bit_depth == 16) {
+        wide_.resize(bytes * 2);
+        target = wide_.data();
+    }
+    const std::streamsize wanted = static_cast<std::streamsize>(bytes * (header_.bit_depth / 8));
+    in_.read(reinterpret_cast<char*>(target), wanted);
+    if (in_.gcount() != wanted) {
+        throw std::runtime_error("Truncated image data in " + path_);
+    }
+    if (header_.bit_depth == 16) {
+        // Big-endian: o byte mais significativo vem primeiro
+        for (size_t i = 0; i < bytes; ++i) {
+            dst[i] = wide_[i * 2];
+        }
+    }
+    rows_read_ += rows;
+}
+
+Image PnmPageReader::read_page() {
+    Image image;
+    image.width = header_.width;
+    image.height = header_.height - rows_read_;
+    image.format = header_.format;
+    image.data.resize(image.row_bytes() * image.height);
+    read_rows(image.data.data(), image.height);
+    return image;
+}
+
+Image to_8bit(const Image& image) {
+    if (image.bit_depth == 8) {
+        return image;
+    }
+    Image out;
+    out.width = image.width;
+    out.height = image.height;
+    out.format = image.format;
+    out.bit_depth = 8;
+    out.data.resize(out.row_bytes() * out.height);
+    const uint16_t* samples = image.samples16();
+    for (size_t i = 0; i < out.data.size(); ++i) {
+        out.data[i] = static_cast<uint8_t>(samples[i] >> 8);
+    }
+    return out;
+}
+
+void write_pnm(const std::string& path, const Image& image) {
+    std::ostringstream header;
+    const int maxval = (image.bit_depth == 16) ? 65535 : 255;
+    switch (image.format) {
+        case PixelFormat::GRAY8:
+            header << "P5\n" << image.width << " " << image.height << "\n" << maxval << "\n";
+            break;
+        case PixelFormat::RGB8:
+            header << "P6\n" << image.width << " " << image.height << "\n" << maxval << "\n";
+            break;
+        case PixelFormat::CMYK8:
+            header << "P7\nWIDTH " << image.width << "\nHEIGHT " << image.height
+                   << "\nDEPTH 4\nMAXVAL " << maxval << "\nTUPLTYPE CMYK\nENDHDR\n";
+            break;
+    }
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Cannot write image: " + path);
+    }
+    const std::string text = header.str();
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+
+    if (image.bit_depth == 16 && little_endian()) {
+        std::vector<uint8_t> swapped(image.data);
+        swap_samples16(swapped);
+        out.write(reinterpret_cast<const char*>(swapped.data()),
+                  static_cast<std::streamsize>(swapped.size()));
+    } else {
+        out.write(reinterpret_cast<const char*>(image.data.data()),
+                  static_cast<std::streamsize>(image.data.size()));
+    }
+    if (!out) {
+        throw std::runtime_error("Failed writing image: " + path);
+    }
+}
+
+}  // namespace raster
+}  // namespace all_press
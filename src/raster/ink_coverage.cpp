@@ -0,0 +1,325 @@
+#include "raster/ink_coverage.h"
+#include "raster/icc_catalog.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace all_press {
+namespace raster {
+
+namespace {
+
+using Histograms = std::array<std::array<uint64_t, 256>, 4>;
+
+uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniforme em [0, 1)
+double unit(uint64_t& state) {
+    return static_cast<double>(splitmix64(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+bool little_endian() {
+    const uint16_t probe = 1;
+    return *reinterpret_cast<const uint8_t*>(&probe) == 1;
+}
+
+// Pixels de 4 bytes: quantos têm max - min dos três primeiros bytes acima
+// do limiar
+uint64_t count_chromatic(const uint8_t* px, size_t count, int threshold) {
+    uint64_t colored = 0;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i low = _mm_set1_epi32(0xFF);
+    const __m128i limit = _mm_set1_epi32(threshold);
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 4 <= count; i += 4) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(px + i * 4));
+        const __m128i b = _mm_srli_epi32(a, 8);
+        const __m128i c = _mm_srli_epi32(a, 16);
+        const __m128i hi = _mm_max_epu8(a, _mm_max_epu8(b, c));
+        const __m128i lo = _mm_min_epu8(a, _mm_min_epu8(b, c));
+        const __m128i chroma = _mm_and_si128(_mm_subs_epu8(hi, lo), low);
+        // Comparação dá -1 nas posições coloridas
+        acc = _mm_sub_epi32(acc, _mm_cmpgt_epi32(chroma, limit));
+    }
+    alignas(16) uint32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    colored = static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t limit = vdupq_n_u8(static_cast<uint8_t>(threshold));
+    uint32x4_t acc = vdupq_n_u32(0);
+    for (; i + 16 <= count; i += 16) {
+        const uint8x16x4_t v = vld4q_u8(px + i * 4);
+        const uint8x16_t hi = vmaxq_u8(v.val[0], vmaxq_u8(v.val[1], v.val[2]));
+        const uint8x16_t lo = vminq_u8(v.val[0], vminq_u8(v.val[1], v.val[2]));
+        const uint8x16_t hit = vshrq_n_u8(vcgtq_u8(vsubq_u8(hi, lo), limit), 7);
+        acc = vpadalq_u16(acc, vpaddlq_u8(hit));
+    }
+    colored = vaddvq_u32(acc);
+#endif
+
+    for (; i < count; ++i) {
+        const uint8_t* p = px + i * 4;
+        const int hi = std::max(p[0], std::max(p[1], p[2]));
+        const int lo = std::min(p[0], std::min(p[1], p[2]));
+        colored += (hi - lo > threshold) ? 1 : 0;
+    }
+    return colored;
+}
+
+// Duas tabelas por canal, alternadas entre pixels pares e ímpares, para que
+// incrementos seguidos no mesmo valor (áreas chapadas) não esperem um pelo
+// outro
+void histogram_cmyk(const uint8_t* px, size_t count, Histograms& out) {
+    std::vector<uint32_t> table(2 * 4 * 256, 0);
+    uint32_t* even = table.data();
+    uint32_t* odd = table.data() + 4 * 256;
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const uint8_t* a = px + i * 4;
+        const uint8_t* b = a + 4;
+        ++even[a[0]];
+        ++even[256 + a[1]];
+        ++even[512 + a[2]];
+        ++even[768 + a[3]];
+        ++odd[b[0]];
+        ++odd[256 + b[1]];
+        ++odd[512 + b[2]];
+        ++odd[768 + b[3]];
+    }
+    for (; i < count; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            ++even[256 * c + px[i * 4 + c]];
+        }
+    }
+    for (int c = 0; c < 4; ++c) {
+        for (int v = 0; v < 256; ++v) {
+            out[c][v] += even[256 * c + v] + odd[256 * c + v];
+        }
+    }
+}
+
+// Cinza: só tinta preta, K = 255 - valor
+void histogram_gray(const uint8_t* px, size_t count, Histograms& out) {
+    uint32_t even[256] = {};
+    uint32_t odd[256] = {};
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        ++even[px[i]];
+        ++odd[px[i + 1]];
+    }
+    for (; i < count; ++i) {
+        ++even[px[i]];
+    }
+    for (int v = 0; v < 256; ++v) {
+        out[3][255 - v] += even[v] + odd[v];
+    }
+}
+
+}  // namespace
+
+InkCoverageAnalyzer::InkCoverageAnalyzer(InkCoverageOptions options) : options_(options) {
+    if (!(options_.max_error > 0.0 && options_.max_error < 1.0)) {
+        throw std::invalid_argument("Ink coverage max_error must be in (0, 1)");
+    }
+    if (!(options_.confidence > 0.0 && options_.confidence < 1.0)) {
+        throw std::invalid_argument("Ink coverage confidence must be in (0, 1)");
+    }
+    options_.chroma_threshold = std::min(255, std::max(0, options_.chroma_threshold));
+    const double n = std::log(2.0 / (1.0 - options_.confidence)) /
+                     (2.0 * options_.max_error * options_.max_error);
+    sample_size_ = static_cast<uint64_t>(std::ceil(n));
+}
+
+InkCoverage InkCoverageAnalyzer::analyze(const uint8_t* data, int width, int height,
+                                         size_t stride, PixelFormat format) const {
+    return sample(width, height, format, 1, 0, data, stride);
+}
+
+InkCoverage InkCoverageAnalyzer::analyze(const Image& image) const {
+    const int msb = (image.bit_depth == 16 && little_endian()) ? 1 : 0;
+    return sample(image.width, image.height, image.format, image.bit_depth / 8, msb,
+                  image.data.data(), image.row_bytes());
+}
+
+InkCoverage InkCoverageAnalyzer::analyze_file(const std::string& path) const {
+    const PnmHeader header = read_pnm_header(path);
+    MappedFile file(path);
+    const int sample_bytes = header.bit_depth / 8;
+    const size_t stride = static_cast<size_t>(header.width) * bytes_per_pixel(header.format) *
+                          sample_bytes;
+    if (file.size() < header.data_offset + stride * header.height) {
+        throw std::runtime_error("Truncated image data in " + path);
+    }
+    // PNM de 16 bits é big-endian: o byte mais significativo vem primeiro
+    return sample(header.width, header.height, header.format, sample_bytes, 0,
+                  file.data() + header.data_offset, stride);
+}
+
+InkCoverage InkCoverageAnalyzer::sample(int width, int height, PixelFormat format,
+                                        int sample_bytes, int msb, const uint8_t* base,
+                                        size_t stride) const {
+    if (width <= 0 || height <= 0 || !base) {
+        throw std::invalid_argument("Invalid image for ink coverage");
+    }
+
+    InkCoverage result;
+    result.format = format;
+    result.width = width;
+    result.height = height;
+    result.confidence = options_.confidence;
+
+    const int channels = bytes_per_pixel(format);
+    const size_t pixel_bytes = static_cast<size_t>(channels) * sample_bytes;
+    std::vector<uint8_t> gathered;
+    auto take = [&](int x, int y) {
+        const uint8_t* p = base + static_cast<size_t>(y) * stride + static_cast<size_t>(x) * pixel_bytes;
+        for (int c = 0; c < channels; ++c) {
+            gathered.push_back(p[c * sample_bytes + msb]);
+        }
+    };
+
+    if (result.pixels() <= sample_size_) {
+        gathered.reserve(result.pixels() * channels);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                take(x, y);
+            }
+        }
+        result.exhaustive = true;
+    } else {
+        // Grade gx x gy de células com proporção próxima à da imagem; cada
+        // célula sorteia um ponto contínuo e amostra o pixel que o contém,
+        // então todo pixel tem a mesma chance de ser escolhido
+        const uint64_t n = sample_size_;
+        uint64_t gy = static_cast<uint64_t>(std::llround(
+            std::sqrt(static_cast<double>(n) * height / width)));
+        gy = std::min<uint64_t>(std::max<uint64_t>(gy, 1), height);
+        uint64_t gx = (n + gy - 1) / gy;
+        if (gx > static_cast<uint64_t>(width)) {
+            gx = width;
+            gy = std::min<uint64_t>((n + gx - 1) / gx, height);
+        }
+        const double cell_w = static_cast<double>(width) / gx;
+        const double cell_h = static_cast<double>(height) / gy;
+
+        gathered.reserve(gx * gy * channels);
+        uint64_t state = options_.seed;
+        for (uint64_t j = 0; j < gy; ++j) {
+            for (uint64_t i = 0; i < gx; ++i) {
+                const int x = std::min(width - 1, static_cast<int>((i + unit(state)) * cell_w));
+                const int y = std::min(height - 1, static_cast<int>((j + unit(state)) * cell_h));
+                take(x, y);
+            }
+        }
+    }
+
+    const size_t count = gathered.size() / channels;
+    result.samples = count;
+
+    uint64_t colored = 0;
+    switch (format) {
+        case PixelFormat::GRAY8:
+            histogram_gray(gathered.data(), count, result.histogram);
+            break;
+        case PixelFormat::RGB8: {
+            // Cor medida no RGB original; tinta depois da separação
+            std::vector<uint8_t> quad(count * 4, 0);
+            for (size_t p = 0; p < count; ++p) {
+                quad[p * 4] = gathered[p * 3];
+                quad[p * 4 + 1] = gathered[p * 3 + 1];
+                quad[p * 4 + 2] = gathered[p * 3 + 2];
+            }
+            colored = count_chromatic(quad.data(), count, options_.chroma_threshold);
+            rgb_to_cmyk8(gathered.data(), static_cast<int>(count), quad.data(), options_.separation);
+            histogram_cmyk(quad.data(), count, result.histogram);
+            break;
+        }
+        case PixelFormat::CMYK8:
+            colored = count_chromatic(gathered.data(), count, options_.chroma_threshold);
+            histogram_cmyk(gathered.data(), count, result.histogram);
+            break;
+    }
+
+    for (int c = 0; c < 4; ++c) {
+        uint64_t ink = 0;
+        for (int v = 1; v < 256; ++v) {
+            ink += static_cast<uint64_t>(v) * result.histogram[c][v];
+        }
+        result.coverage[c] = static_cast<double>(ink) / (255.0 * count);
+    }
+    result.color_fraction = static_cast<double>(colored) / count;
+    result.has_color = colored > 0 && result.color_fraction >= options_.min_color_fraction;
+    result.error_bound = result.exhaustive
+        ? 0.0
+        : std::sqrt(std::log(2.0 / (1.0 - options_.confidence)) / (2.0 * count));
+    return result;
+}
+
+InkCoverage merge_coverage(const std::vector<InkCoverage>& pages) {
+    InkCoverage merged;
+    if (pages.empty()) {
+        return merged;
+    }
+
+    merged.format = pages.front().format;
+    merged.width = pages.front().width;
+    merged.height = pages.front().height;
+    merged.exhaustive = true;
+    double total_pixels = 0.0;
+    for (const auto& page : pages) {
+        total_pixels += static_cast<double>(page.pixels());
+    }
+
+    // Pela união dos eventos, todas as páginas ficam dentro do erro com
+    // probabilidade de pelo menos 1 - soma das falhas
+    double failure = 0.0;
+    for (const auto& page : pages) {
+        const double weight = total_pixels > 0.0 ? page.pixels() / total_pixels : 0.0;
+        for (int c = 0; c < 4; ++c) {
+            merged.coverage[c] += weight * page.coverage[c];
+            for (int v = 0; v < 256; ++v) {
+                merged.histogram[c][v] += page.histogram[c][v];
+            }
+        }
+        merged.color_fraction += weight * page.color_fraction;
+        merged.has_color = merged.has_color || page.has_color;
+        merged.samples += page.samples;
+        merged.error_bound = std::max(merged.error_bound, page.error_bound);
+        if (!page.exhaustive) {
+            merged.exhaustive = false;
+            failure += 1.0 - page.confidence;
+        }
+    }
+    merged.confidence = std::max(0.0, 1.0 - failure);
+    return merged;
+}
+
+InkCostEstimate estimate_ink_cost(const InkCoverage& coverage, double area_m2, int copies,
+                                  const InkCostModel& model) {
+    InkCostEstimate estimate;
+    const double area = std::max(0.0, area_m2) * std::max(1, copies);
+    for (int c = 0; c < 4; ++c) {
+        estimate.ink_ml[c] = coverage.coverage[c] * model.ml_per_m2[c] * area;
+        estimate.ink_cost += estimate.ink_ml[c] * model.price_per_ml[c];
+        estimate.margin += coverage.error_bound * model.ml_per_m2[c] * area * model.price_per_ml[c];
+    }
+    estimate.media_cost = area * model.media_price_per_m2;
+    estimate.total = estimate.ink_cost + estimate.media_cost;
+    return estimate;
+}
+
+}  // namespace raster
+}  // namespace all_press
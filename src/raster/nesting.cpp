@@ -0,0 +1,416 @@
+#include "raster/nesting.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+
+namespace all_press {
+namespace raster {
+
+namespace {
+
+// Trecho do horizonte: [x, x + width) ocupado até a linha y
+struct Segment {
+    int x;
+    int y;
+    int width;
+};
+
+// Linha onde uma página de largura width apoiaria a partir do segmento i;
+// -1 se passar da borda do rolo
+int skyline_fit(const std::vector<Segment>& skyline, size_t i, int width, int roll_width) {
+    if (skyline[i].x + width > roll_width) {
+        return -1;
+    }
+    int y = 0;
+    int remaining = width;
+    for (size_t j = i; remaining > 0; ++j) {
+        y = std::max(y, skyline[j].y);
+        remaining -= skyline[j].width;
+    }
+    return y;
+}
+
+void skyline_place(std::vector<Segment>& skyline, size_t i, int width, int top) {
+    const int x = skyline[i].x;
+    const int end = x + width;
+    skyline.insert(skyline.begin() + i, Segment{x, top, width});
+
+    size_t j = i + 1;
+    while (j < skyline.size() && skyline[j].x < end) {
+        const int segment_end = skyline[j].x + skyline[j].width;
+        if (segment_end <= end) {
+            skyline.erase(skyline.begin() + j);
+        } else {
+            skyline[j].width = segment_end - end;
+            skyline[j].x = end;
+            break;
+        }
+    }
+
+    for (size_t k = 0; k + 1 < skyline.size();) {
+        if (skyline[k].y == skyline[k + 1].y) {
+            skyline[k].width += skyline[k + 1].width;
+            skyline.erase(skyline.begin() + k + 1);
+        } else {
+            ++k;
+        }
+    }
+}
+
+Image rotate_clockwise(const Image& src) {
+    const int bpp = bytes_per_pixel(src.format);
+    Image dst;
+    dst.width = src.height;
+    dst.height = src.width;
+    dst.format = src.format;
+    dst.data.resize(dst.row_bytes() * dst.height);
+    const size_t src_row = src.row_bytes();
+    for (int v = 0; v < dst.height; ++v) {
+        uint8_t* out = dst.data.data() + static_cast<size_t>(v) * dst.row_bytes();
+        for (int u = 0; u < dst.width; ++u) {
+            const uint8_t* in = src.data.data() + static_cast<size_t>(src.height - 1 - u) * src_row +
+                                static_cast<size_t>(v) * bpp;
+            std::memcpy(out + static_cast<size_t>(u) * bpp, in, bpp);
+        }
+    }
+    return dst;
+}
+
+// Fonte 3x5 para os rótulos: linhas de 3 bits, bit 2 = coluna da esquerda
+const uint8_t* glyph(char c) {
+    static const uint8_t DIGITS[10][5] = {
+        {7, 5, 5, 5, 7}, {2, 6, 2, 2, 7}, {7, 1, 7, 4, 7}, {7, 1, 7, 1, 7}, {5, 5, 7, 1, 1},
+        {7, 4, 7, 1, 7}, {7, 4, 7, 5, 7}, {7, 1, 1, 1, 1}, {7, 5, 7, 5, 7}, {7, 5, 7, 1, 7}};
+    static const uint8_t HASH[5] = {5, 7, 5, 7, 5};
+    static const uint8_t DASH[5] = {0, 0, 7, 0, 0};
+    if (c >= '0' && c <= '9') return DIGITS[c - '0'];
+    if (c == '#') return HASH;
+    if (c == '-') return DASH;
+    return nullptr;
+}
+
+struct Rect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+
+// Linhas de uma página ativa no rolo, já na orientação colocada, pedidas em
+// ordem crescente
+class PageRows {
+public:
+    virtual ~PageRows() = default;
+    virtual const uint8_t* row(int y) = 0;
+};
+
+class ImageRows : public PageRows {
+public:
+    explicit ImageRows(const Image& image) : image_(&image) {}
+    explicit ImageRows(Image&& owned) : owned_(std::move(owned)), image_(&owned_) {}
+
+    const uint8_t* row(int y) override {
+        return image_->data.data() + static_cast<size_t>(y) * image_->row_bytes();
+    }
+
+private:
+    Image owned_;
+    const Image* image_;
+};
+
+// Página em tiles lida uma faixa por vez
+class BandRows : public PageRows {
+public:
+    explicit BandRows(const TiledRaster& raster) : raster_(raster) {}
+
+    const uint8_t* row(int y) override {
+        if (band_.rows == 0 || y >= band_.y + band_.rows) {
+            raster_.read_band(y / raster_.tile_size(), band_);
+        }
+        return band_.row(y - band_.y);
+    }
+
+private:
+    const TiledRaster& raster_;
+    RowBand band_;
+};
+
+// Giro de uma página em tiles: cada faixa da origem vira colunas do
+// destino, que precisa ser contíguo
+Image rotate_clockwise(const TiledRaster& src) {
+    const int bpp = src.bytes_per_pixel();
+    Image dst;
+    dst.width = src.height();
+    dst.height = src.width();
+    dst.format = src.format();
+    dst.data.resize(dst.row_bytes() * dst.height);
+    src.for_each_band([&](const RowBand& band) {
+        for (int r = 0; r < band.rows; ++r) {
+            const int u = src.height() - 1 - (band.y + r);
+            const uint8_t* in = band.row(r);
+            for (int v = 0; v < dst.height; ++v) {
+                std::memcpy(dst.data.data() + static_cast<size_t>(v) * dst.row_bytes() +
+                                static_cast<size_t>(u) * bpp,
+                            in + static_cast<size_t>(v) * bpp, bpp);
+            }
+        }
+        return true;
+    });
+    return dst;
+}
+
+void check_placement(const NestLayout& layout, const NestPlacement& p, int width, int height,
+                     PixelFormat page_format, PixelFormat format) {
+    const int w = p.rotated ? height : width;
+    const int h = p.rotated ? width : height;
+    if (page_format != format || w != p.width || h != p.height ||
+        p.x < 0 || p.y < 0 || p.x + p.width > layout.roll_width || p.y + p.height > layout.length) {
+        throw std::invalid_argument("Nest placement does not match its image");
+    }
+}
+
+// Monta o rolo; open devolve as linhas da página de uma posição quando ela
+// entra na linha atual, liberadas quando ela sai
+TiledRaster compose_rows(const NestLayout& layout, PixelFormat format,
+                         const std::vector<std::string>& labels, const NestComposeOptions& options,
+                         const std::function<std::unique_ptr<PageRows>(const NestPlacement&)>& open) {
+    const int bpp = bytes_per_pixel(format);
+    TiledRaster roll(layout.roll_width, std::max(1, layout.length), format, options.raster);
+    uint8_t ink[4] = {0, 0, 0, 0};
+    if (format == PixelFormat::CMYK8) {
+        ink[3] = 255;
+    }
+
+    // Marcas de corte a 1 pixel de cada canto, para fora da página, e
+    // rótulos na calha de baixo, à direita da marca
+    std::vector<Rect> marks;
+    const int length = options.mark_length;
+    const int scale = options.label_scale;
+    for (const auto& p : layout.placements) {
+        const int x0 = p.x;
+        const int y0 = p.y;
+        const int x1 = p.x + p.width - 1;
+        const int y1 = p.y + p.height - 1;
+        if (length > 0) {
+            for (int y : {y0, y1}) {
+                marks.push_back(Rect{x0 - 1 - length, y, length, 1});
+                marks.push_back(Rect{x1 + 2, y, length, 1});
+            }
+            for (int x : {x0, x1}) {
+                marks.push_back(Rect{x, y0 - 1 - length, 1, length});
+                marks.push_back(Rect{x, y1 + 2, 1, length});
+            }
+        }
+        if (scale > 0 && static_cast<size_t>(p.id) < labels.size()) {
+            const int left = x0 + 2 * scale;
+            const int top = y1 + 1 + scale;
+            const std::string& text = labels[p.id];
+            for (size_t c = 0; c < text.size(); ++c) {
+                const uint8_t* bits = glyph(text[c]);
+                if (!bits) continue;
+                for (int row = 0; row < 5; ++row) {
+                    for (int col = 0; col < 3; ++col) {
+                        if (bits[row] & (4 >> col)) {
+                            marks.push_back(Rect{left + (static_cast<int>(c) * 4 + col) * scale,
+                                                 top + row * scale, scale, scale});
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Recorte no rolo
+    std::vector<Rect> clipped;
+    for (const auto& r : marks) {
+        const int x = std::max(0, r.x);
+        const int y = std::max(0, r.y);
+        const int right = std::min(layout.roll_width, r.x + r.width);
+        const int bottom = std::min(layout.length, r.y + r.height);
+        if (right > x && bottom > y) {
+            clipped.push_back(Rect{x, y, right - x, bottom - y});
+        }
+    }
+    std::sort(clipped.begin(), clipped.end(), [](const Rect& a, const Rect& b) { return a.y < b.y; });
+
+    std::vector<size_t> order(layout.placements.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return layout.placements[a].y < layout.placements[b].y;
+    });
+
+    // Páginas ativas na linha atual
+    struct Active {
+        const NestPlacement* placement;
+        std::unique_ptr<PageRows> rows;
+    };
+    std::vector<Active> active;
+    std::vector<Rect> active_marks;
+    size_t next_page = 0;
+    size_t next_mark = 0;
+
+    TiledRasterWriter writer(roll);
+    std::vector<uint8_t> row(roll.row_bytes());
+    for (int y = 0; y < layout.length; ++y) {
+        std::memset(row.data(), blank_byte(format), row.size());
+
+        while (next_page < order.size() && layout.placements[order[next_page]].y <= y) {
+            const NestPlacement& p = layout.placements[order[next_page++]];
+            active.push_back(Active{&p, open(p)});
+        }
+        for (size_t i = 0; i < active.size();) {
+            const NestPlacement& p = *active[i].placement;
+            if (y >= p.y + p.height) {
+                active.erase(active.begin() + i);
+                continue;
+            }
+            std::memcpy(row.data() + static_cast<size_t>(p.x) * bpp, active[i].rows->row(y - p.y),
+                        static_cast<size_t>(p.width) * bpp);
+            ++i;
+        }
+
+        while (next_mark < clipped.size() && clipped[next_mark].y <= y) {
+            active_marks.push_back(clipped[next_mark++]);
+        }
+        for (size_t i = 0; i < active_marks.size();) {
+            const Rect& r = active_marks[i];
+            if (y >= r.y + r.height) {
+                active_marks.erase(active_marks.begin() + i);
+                continue;
+            }
+            for (int x = r.x; x < r.x + r.width; ++x) {
+                std::memcpy(row.data() + static_cast<size_t>(x) * bpp, ink, bpp);
+            }
+            ++i;
+        }
+
+        writer.append_row(row.data());
+    }
+    writer.finish();
+    return roll;
+}
+
+}  // namespace
+
+NestLayout pack_skyline(const std::vector<NestItem>& items, int roll_width, const NestOptions& options) {
+    NestLayout layout;
+    layout.roll_width = roll_width;
+    const int gap = std::max(0, options.gap);
+    // Calha também antes da primeira coluna e da primeira fileira, para as
+    // marcas de corte ficarem inteiras
+    const int usable = roll_width - gap;
+
+    std::vector<NestItem> order(items);
+    std::stable_sort(order.begin(), order.end(), [](const NestItem& a, const NestItem& b) {
+        const int side_a = std::max(a.width, a.height);
+        const int side_b = std::max(b.width, b.height);
+        if (side_a != side_b) return side_a > side_b;
+        return static_cast<int64_t>(a.width) * a.height > static_cast<int64_t>(b.width) * b.height;
+    });
+
+    std::vector<Segment> skyline;
+    if (usable > 0) {
+        skyline.push_back(Segment{0, 0, usable});
+    }
+
+    int bottom = 0;
+    for (const auto& item : order) {
+        if (item.width <= 0 || item.height <= 0) {
+            throw std::invalid_argument("Nest item with invalid size");
+        }
+
+        int best_top = -1;
+        int best_x = 0;
+        size_t best_segment = 0;
+        bool best_rotated = false;
+        for (int turn = 0; turn < (options.allow_rotation && item.width != item.height ? 2 : 1); ++turn) {
+            const int w = turn ? item.height : item.width;
+            const int h = turn ? item.width : item.height;
+            for (size_t i = 0; i < skyline.size(); ++i) {
+                const int y = skyline_fit(skyline, i, w, usable);
+                if (y < 0) {
+                    continue;
+                }
+                const int top = y + h;
+                if (best_top < 0 || top < best_top || (top == best_top && skyline[i].x < best_x)) {
+                    best_top = top;
+                    best_x = skyline[i].x;
+                    best_segment = i;
+                    best_rotated = turn == 1;
+                }
+            }
+        }
+
+        if (best_top < 0) {
+            layout.rejected.push_back(item.id);
+            continue;
+        }
+
+        NestPlacement placement;
+        placement.id = item.id;
+        placement.rotated = best_rotated;
+        placement.width = best_rotated ? item.height : item.width;
+        placement.height = best_rotated ? item.width : item.height;
+        placement.x = best_x + gap;
+        placement.y = best_top - placement.height + gap;
+        layout.placements.push_back(placement);
+
+        // A calha à direita pode ser cortada pela borda do rolo
+        const int footprint = std::min(placement.width + gap, usable - best_x);
+        skyline_place(skyline, best_segment, footprint, best_top + gap);
+        bottom = std::max(bottom, best_top + gap);
+    }
+
+    layout.length = layout.placements.empty() ? 0 : bottom + gap;
+    return layout;
+}
+
+TiledRaster compose_nest(const NestLayout& layout, const std::vector<const Image*>& images,
+                         PixelFormat format, const std::vector<std::string>& labels,
+                         const NestComposeOptions& options) {
+    for (const auto& p : layout.placements) {
+        if (p.id < 0 || static_cast<size_t>(p.id) >= images.size() || !images[p.id]) {
+            throw std::invalid_argument("Nest placement without image");
+        }
+        const Image& image = *images[p.id];
+        if (image.bit_depth != 8) {
+            throw std::invalid_argument("Nest placement does not match its image");
+        }
+        check_placement(layout, p, image.width, image.height, image.format, format);
+    }
+
+    // As giradas são giradas uma vez, ao entrar, e liberadas ao sair
+    return compose_rows(layout, format, labels, options,
+                        [&](const NestPlacement& p) -> std::unique_ptr<PageRows> {
+        if (p.rotated) {
+            return std::make_unique<ImageRows>(rotate_clockwise(*images[p.id]));
+        }
+        return std::make_unique<ImageRows>(*images[p.id]);
+    });
+}
+
+TiledRaster compose_nest(const NestLayout& layout, const std::vector<const TiledRaster*>& pages,
+                         PixelFormat format, const std::vector<std::string>& labels,
+                         const NestComposeOptions& options) {
+    for (const auto& p : layout.placements) {
+        if (p.id < 0 || static_cast<size_t>(p.id) >= pages.size() || !pages[p.id]) {
+            throw std::invalid_argument("Nest placement without image");
+        }
+        const TiledRaster& page = *pages[p.id];
+        check_placement(layout, p, page.width(), page.height(), page.format(), format);
+    }
+
+    return compose_rows(layout, format, labels, options,
+                        [&](const NestPlacement& p) -> std::unique_ptr<PageRows> {
+        if (p.rotated) {
+            return std::make_unique<ImageRows>(rotate_clockwise(*pages[p.id]));
+        }
+        return std::make_unique<BandRows>(*pages[p.id]);
+    });
+}
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,319 @@
+#include "raster/path_fill.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace all_press {
+namespace raster {
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+
+// Aresta não horizontal com y0 < y1; dir é o sentido original (+1 descendo)
+struct Edge {
+    double x0;
+    double y0;
+    double y1;
+    double dxdy;
+    int dir;
+};
+
+struct Crossing {
+    double x;
+    int dir;
+};
+
+struct PreparedPath {
+    std::vector<Edge> edges;      // Ordenadas por y0
+    double y_min = 0.0;
+    double y_max = 0.0;
+    FillRule rule = FillRule::NON_ZERO;
+    const uint8_t* color = nullptr;
+    size_t next_edge = 0;
+    std::vector<size_t> active;   // Arestas que cruzam a sub-linha atual
+};
+
+double signed_area(const std::vector<FillPoint>& contour) {
+    double area = 0.0;
+    for (size_t i = 0, j = contour.size() - 1; i < contour.size(); j = i++) {
+        area += contour[j].x * contour[i].y - contour[i].x * contour[j].y;
+    }
+    return area * 0.5;
+}
+
+void add_oriented(std::vector<FillPoint>&& contour, std::vector<std::vector<FillPoint>>& contours) {
+    if (signed_area(contour) < 0.0) {
+        std::reverse(contour.begin(), contour.end());
+    }
+    contours.push_back(std::move(contour));
+}
+
+void add_disc(const FillPoint& center, double radius, int sides,
+              std::vector<std::vector<FillPoint>>& contours) {
+    std::vector<FillPoint> disc(sides);
+    for (int k = 0; k < sides; ++k) {
+        const double angle = 2.0 * PI * k / sides;
+        disc[k] = FillPoint{center.x + radius * std::cos(angle), center.y + radius * std::sin(angle)};
+    }
+    add_oriented(std::move(disc), contours);
+}
+
+PreparedPath prepare(const FillPath& path) {
+    PreparedPath prepared;
+    prepared.rule = path.rule;
+    prepared.color = path.color.data();
+    prepared.y_min = HUGE_VAL;
+    prepared.y_max = -HUGE_VAL;
+    for (const auto& contour : path.contours) {
+        const size_t n = contour.size();
+        if (n < 2) {
+            continue;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            const FillPoint& p = contour[i];
+            const FillPoint& q = contour[(i + 1) % n];
+            if (!(p.y != q.y) || !std::isfinite(p.x) || !std::isfinite(q.x)) {
+                continue;  // Horizontais não cruzam sub-linhas; NaN descartado
+            }
+            const bool down = q.y > p.y;
+            const FillPoint& a = down ? p : q;
+            const FillPoint& b = down ? q : p;
+            prepared.edges.push_back(Edge{a.x, a.y, b.y, (b.x - a.x) / (b.y - a.y), down ? 1 : -1});
+            prepared.y_min = std::min(prepared.y_min, a.y);
+            prepared.y_max = std::max(prepared.y_max, b.y);
+        }
+    }
+    std::sort(prepared.edges.begin(), prepared.edges.end(),
+              [](const Edge& a, const Edge& b) { return a.y0 < b.y0; });
+    return prepared;
+}
+
+// Cobertura de uma linha de pixels: a parte fracionária das pontas de cada
+// trecho vai para partial e o miolo para delta (+w no início, -w no fim),
+// somado na composição. Só o intervalo tocado [lo, hi] é percorrido.
+class RowCoverage {
+public:
+    explicit RowCoverage(int width)
+        : width_(width), partial_(width + 1, 0.0f), delta_(width + 1, 0.0f) {}
+
+    void add_span(double xa, double xb, float weight) {
+        xa = std::max(xa, 0.0);
+        xb = std::min(xb, static_cast<double>(width_));
+        if (!(xb > xa)) {
+            return;
+        }
+        const int ia = static_cast<int>(xa);
+        const int ib = static_cast<int>(xb);
+        lo_ = std::min(lo_, ia);
+        hi_ = std::max(hi_, ib);
+        if (ia == ib) {
+            partial_[ia] += static_cast<float>(xb - xa) * weight;
+            return;
+        }
+        partial_[ia] += static_cast<float>(ia + 1 - xa) * weight;
+        delta_[ia + 1] += weight;
+        delta_[ib] -= weight;
+        partial_[ib] += static_cast<float>(xb - ib) * weight;
+    }
+
+    // Mistura a cor na linha pela cobertura e zera o acumulado
+    void composite(uint8_t* row, int bpp, const uint8_t* color) {
+        if (lo_ > hi_) {
+            return;
+        }
+        float running = 0.0f;
+        const int last = std::min(hi_, width_ - 1);
+        for (int x = lo_; x <= last; ++x) {
+            running += delta_[x];
+            const float alpha = std::min(1.0f, running + partial_[x]);
+            delta_[x] = 0.0f;
+            partial_[x] = 0.0f;
+            if (alpha <= 1e-6f) {
+                continue;
+            }
+            uint8_t* pixel = row + static_cast<size_t>(x) * bpp;
+            for (int c = 0; c < bpp; ++c) {
+                pixel[c] = static_cast<uint8_t>(pixel[c] + (color[c] - pixel[c]) * alpha + 0.5f);
+            }
+        }
+        delta_[width_] = 0.0f;
+        partial_[width_] = 0.0f;
+        lo_ = width_;
+        hi_ = -1;
+    }
+
+private:
+    int width_;
+    std::vector<float> partial_;
+    std::vector<float> delta_;
+    int lo_ = width_;
+    int hi_ = -1;
+};
+
+// Cruzamentos de um path com a sub-linha sy, convertidos em trechos. Os
+// cruzamentos ficam da sub-linha anterior quase em ordem, então a ordenação
+// por inserção custa perto de O(n) em vez de um sort a cada sub-linha.
+void scan_subline(PreparedPath& path, double sy, float weight,
+                  std::vector<Crossing>& crossings, RowCoverage& coverage) {
+    while (path.next_edge < path.edges.size() && path.edges[path.next_edge].y0 <= sy) {
+        path.active.push_back(path.next_edge++);
+    }
+    crossings.clear();
+    size_t kept = 0;
+    for (size_t k = 0; k < path.active.size(); ++k) {
+        const size_t index = path.active[k];
+        const Edge& edge = path.edges[index];
+        if (edge.y1 <= sy) {
+            continue;
+        }
+        const Crossing crossing{edge.x0 + (sy - edge.y0) * edge.dxdy, edge.dir};
+        size_t j = kept++;
+        crossings.push_back(crossing);
+        while (j > 0 && crossings[j - 1].x > crossing.x) {
+            crossings[j] = crossings[j - 1];
+            path.active[j] = path.active[j - 1];
+            --j;
+        }
+        crossings[j] = crossing;
+        path.active[j] = index;
+    }
+    path.active.resize(kept);
+    if (crossings.size() < 2) {
+        return;
+    }
+
+    int winding = 0;
+    double span_start = 0.0;
+    for (const auto& crossing : crossings) {
+        const bool was_inside = path.rule == FillRule::NON_ZERO ? winding != 0 : (winding & 1) != 0;
+        winding += path.rule == FillRule::NON_ZERO ? crossing.dir : 1;
+        const bool inside = path.rule == FillRule::NON_ZERO ? winding != 0 : (winding & 1) != 0;
+        if (!was_inside && inside) {
+            span_start = crossing.x;
+        } else if (was_inside && !inside) {
+            coverage.add_span(span_start, crossing.x, weight);
+        }
+    }
+}
+
+}  // namespace
+
+void stroke_polyline(const std::vector<FillPoint>& input, double width,
+                     std::vector<std::vector<FillPoint>>& contours) {
+    const double radius = width * 0.5;
+    if (!(radius > 0.0) || input.empty()) {
+        return;
+    }
+
+    // Pontos repetidos não formam segmento
+    std::vector<FillPoint> points;
+    points.reserve(input.size());
+    for (const auto& p : input) {
+        if (points.empty() || p.x != points.back().x || p.y != points.back().y) {
+            points.push_back(p);
+        }
+    }
+
+    // Lados suficientes para o disco desviar menos de 1/8 de pixel
+    const int sides = radius <= 0.125
+        ? 8
+        : std::min(256, std::max(8, static_cast<int>(std::ceil(PI / std::acos(1.0 - 0.125 / radius)))));
+
+    if (points.size() == 1) {
+        add_disc(points[0], radius, sides, contours);
+        return;
+    }
+
+    for (size_t i = 0; i < points.size(); ++i) {
+        // Juntas quase retas: a fresta entre os retângulos fica abaixo de
+        // 1/10 de pixel e o disco é dispensado
+        if (i > 0 && i + 1 < points.size()) {
+            const double ax = points[i].x - points[i - 1].x;
+            const double ay = points[i].y - points[i - 1].y;
+            const double bx = points[i + 1].x - points[i].x;
+            const double by = points[i + 1].y - points[i].y;
+            const double turn = std::fabs(std::atan2(ax * by - ay * bx, ax * bx + ay * by));
+            if (radius * turn < 0.1) {
+                continue;
+            }
+        }
+        add_disc(points[i], radius, sides, contours);
+    }
+
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+        const FillPoint& p = points[i];
+        const FillPoint& q = points[i + 1];
+        const double length = std::hypot(q.x - p.x, q.y - p.y);
+        const double nx = -(q.y - p.y) / length * radius;
+        const double ny = (q.x - p.x) / length * radius;
+        add_oriented({FillPoint{p.x + nx, p.y + ny}, FillPoint{q.x + nx, q.y + ny},
+                      FillPoint{q.x - nx, q.y - ny}, FillPoint{p.x - nx, p.y - ny}},
+                     contours);
+    }
+}
+
+TiledRaster fill_paths(const std::vector<FillPath>& paths, int width, int height,
+                       PixelFormat format, const PathRasterOptions& options) {
+    if (width <= 0 || height <= 0) {
+        throw std::invalid_argument("Invalid raster size for path fill");
+    }
+    const int subsamples = std::max(1, options.subsamples);
+    const float weight = 1.0f / subsamples;
+    const int bpp = bytes_per_pixel(format);
+
+    std::vector<PreparedPath> prepared;
+    prepared.reserve(paths.size());
+    for (const auto& path : paths) {
+        prepared.push_back(prepare(path));
+    }
+
+    // Paths entram na varredura por y_min; os ativos ficam em ordem de
+    // desenho para a sobreposição respeitar a display list
+    std::vector<size_t> by_top;
+    for (size_t i = 0; i < prepared.size(); ++i) {
+        if (!prepared[i].edges.empty() && prepared[i].y_max > 0.0 && prepared[i].y_min < height) {
+            by_top.push_back(i);
+        }
+    }
+    std::sort(by_top.begin(), by_top.end(),
+              [&](size_t a, size_t b) { return prepared[a].y_min < prepared[b].y_min; });
+
+    TiledRaster page(width, height, format, options.raster);
+    TiledRasterWriter writer(page);
+    std::vector<uint8_t> row(page.row_bytes());
+    RowCoverage coverage(width);
+    std::vector<Crossing> crossings;
+    std::vector<size_t> active;
+    size_t next_path = 0;
+
+    for (int y = 0; y < height; ++y) {
+        std::fill(row.begin(), row.end(), blank_byte(format));
+
+        while (next_path < by_top.size() && prepared[by_top[next_path]].y_min < y + 1) {
+            const size_t index = by_top[next_path++];
+            active.insert(std::lower_bound(active.begin(), active.end(), index), index);
+        }
+        for (size_t k = 0; k < active.size();) {
+            PreparedPath& path = prepared[active[k]];
+            if (path.y_max <= y) {
+                path.edges = std::vector<Edge>();
+                path.active = std::vector<size_t>();
+                active.erase(active.begin() + k);
+                continue;
+            }
+            for (int s = 0; s < subsamples; ++s) {
+                scan_subline(path, y + (s + 0.5) / subsamples, weight, crossings, coverage);
+            }
+            coverage.composite(row.data(), bpp, path.color);
+            ++k;
+        }
+
+        writer.append_row(row.data());
+    }
+    writer.finish();
+    return page;
+}
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,463 @@
+#include "raster/resample.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace all_press {
+namespace raster {
+
+namespace {
+
+constexpr int WEIGHT_BITS = 14;
+constexpr int WEIGHT_ONE = 1 << WEIGHT_BITS;
+constexpr int WEIGHT_ROUND = 1 << (WEIGHT_BITS - 1);
+constexpr double PI = 3.14159265358979323846;
+
+double lanczos3(double x) {
+    x = std::fabs(x);
+    if (x < 1e-9) {
+        return 1.0;
+    }
+    if (x >= 3.0) {
+        return 0.0;
+    }
+    const double px = PI * x;
+    return 3.0 * std::sin(px) * std::sin(px / 3.0) / (px * px);
+}
+
+inline uint8_t clamp_weighted(int32_t sum) {
+    const int32_t v = (sum + WEIGHT_ROUND) >> WEIGHT_BITS;
+    return static_cast<uint8_t>(std::min(255, std::max(0, v)));
+}
+
+inline uint32_t load_u32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+#if defined(__SSE2__)
+// Dois pesos int16 no par (baixo, alto) de cada lane de 32 bits, para madd
+inline __m128i weight_pair(int16_t first, int16_t second) {
+    return _mm_set1_epi32(static_cast<int>(static_cast<uint16_t>(first) |
+                                           (static_cast<uint32_t>(static_cast<uint16_t>(second)) << 16)));
+}
+#endif
+
+// Pesos de um eixo. A janela de cada saída cobre toda a região onde o
+// filtro não é zero e é deslocada para dentro da origem nas bordas, onde os
+// pixels inexistentes simplesmente ficam fora da normalização.
+Resampler::Axis make_axis(int src, int dst, ResampleFilter filter) {
+    Resampler::Axis axis;
+    const double scale = static_cast<double>(src) / dst;
+    const double support = std::max(scale, 1.0);
+    const double radius = (filter == ResampleFilter::BOX) ? 0.5 * support : 3.0 * support;
+    axis.taps = std::min(src, static_cast<int>(std::ceil(2.0 * radius)) + 1);
+    axis.start.resize(dst);
+    axis.weights.assign(static_cast<size_t>(dst) * axis.taps, 0);
+
+    std::vector<double> weight(axis.taps);
+    for (int i = 0; i < dst; ++i) {
+        const double center = (i + 0.5) * scale;
+        int first = static_cast<int>(std::floor(center - radius));
+        first = std::max(0, std::min(first, src - axis.taps));
+        axis.start[i] = first;
+
+        double total = 0.0;
+        for (int k = 0; k < axis.taps; ++k) {
+            const double j = first + k;
+            double w;
+            if (filter == ResampleFilter::BOX) {
+                // Área de [j, j + 1) dentro da pegada da saída
+                w = std::max(0.0, std::min(j + 1.0, center + radius) - std::max(j, center - radius));
+            } else {
+                w = lanczos3((j + 0.5 - center) / support);
+            }
+            weight[k] = w;
+            total += w;
+        }
+
+        int16_t* out = &axis.weights[static_cast<size_t>(i) * axis.taps];
+        int sum = 0;
+        int largest = 0;
+        for (int k = 0; k < axis.taps; ++k) {
+            out[k] = static_cast<int16_t>(std::lround(weight[k] / total * WEIGHT_ONE));
+            sum += out[k];
+            if (std::abs(out[k]) > std::abs(out[largest])) {
+                largest = k;
+            }
+        }
+        // O arredondamento não pode mudar o brilho de áreas chapadas
+        out[largest] = static_cast<int16_t>(out[largest] + WEIGHT_ONE - sum);
+    }
+    return axis;
+}
+
+}  // namespace
+
+Resampler::Resampler(int src_width, int src_height, int dst_width, int dst_height,
+                     PixelFormat format, ResampleOptions options)
+    : src_width_(src_width), src_height_(src_height),
+      dst_width_(dst_width), dst_height_(dst_height),
+      format_(format), options_(options) {
+    if (src_width <= 0 || src_height <= 0 || dst_width <= 0 || dst_height <= 0) {
+        throw std::invalid_argument("Invalid resample size");
+    }
+    horizontal_ = make_axis(src_width, dst_width, options.filter);
+    vertical_ = make_axis(src_height, dst_height, options.filter);
+}
+
+void Resampler::horizontal_row(const uint8_t* src, uint8_t* dst,
+                               std::vector<uint8_t>& scratch) const {
+    const int channels = bytes_per_pixel(format_);
+    const int taps = horizontal_.taps;
+
+    if (channels == 1) {
+        for (int x = 0; x < dst_width_; ++x) {
+            const uint8_t* p = src + horizontal_.start[x];
+            const int16_t* w = &horizontal_.weights[static_cast<size_t>(x) * taps];
+            int32_t sum = 0;
+            int k = 0;
+#if defined(__SSE2__)
+            const __m128i zero = _mm_setzero_si128();
+            __m128i acc = _mm_setzero_si128();
+            for (; k + 8 <= taps; k += 8) {
+                const __m128i px = _mm_unpacklo_epi8(
+                    _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + k)), zero);
+                acc = _mm_add_epi32(acc, _mm_madd_epi16(
+                    px, _mm_loadu_si128(reinterpret_cast<const __m128i*>(w + k))));
+            }
+            acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+            acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+            sum = _mm_cvtsi128_si32(acc);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+            int32x4_t acc = vdupq_n_s32(0);
+            for (; k + 8 <= taps; k += 8) {
+                const int16x8_t px = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(p + k)));
+                const int16x8_t wv = vld1q_s16(w + k);
+                acc = vmlal_s16(acc, vget_low_s16(px), vget_low_s16(wv));
+                acc = vmlal_high_s16(acc, px, wv);
+            }
+            sum = vaddvq_s32(acc);
+#endif
+            for (; k < taps; ++k) {
+                sum += p[k] * w[k];
+            }
+            dst[x] = clamp_weighted(sum);
+        }
+        return;
+    }
+
+    // RGB vira 4 bytes por pixel para que cada pixel caiba numa lane de 32 bits
+    const uint8_t* quad = src;
+    if (channels == 3) {
+        scratch.resize(static_cast<size_t>(src_width_) * 4);
+        for (int x = 0; x < src_width_; ++x) {
+            scratch[x * 4] = src[x * 3];
+            scratch[x * 4 + 1] = src[x * 3 + 1];
+            scratch[x * 4 + 2] = src[x * 3 + 2];
+            scratch[x * 4 + 3] = 0;
+        }
+        quad = scratch.data();
+    }
+
+    for (int x = 0; x < dst_width_; ++x) {
+        const uint8_t* p = quad + static_cast<size_t>(horizontal_.start[x]) * 4;
+        const int16_t* w = &horizontal_.weights[static_cast<size_t>(x) * taps];
+        uint8_t* out = dst + static_cast<size_t>(x) * channels;
+#if defined(__SSE2__)
+        // Dois pixels entrelaçados por canal (p0c, p1c) multiplicados pelo
+        // par de pesos em madd: uma soma de 32 bits por canal
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc = _mm_set1_epi32(WEIGHT_ROUND);
+        int k = 0;
+        for (; k + 2 <= taps; k += 2) {
+            const __m128i a = _mm_cvtsi32_si128(static_cast<int>(load_u32(p + k * 4)));
+            const __m128i b = _mm_cvtsi32_si128(static_cast<int>(load_u32(p + k * 4 + 4)));
+            const __m128i px = _mm_unpacklo_epi8(_mm_unpacklo_epi8(a, b), zero);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(px, weight_pair(w[k], w[k + 1])));
+        }
+        if (k < taps) {
+            const __m128i a = _mm_cvtsi32_si128(static_cast<int>(load_u32(p + k * 4)));
+            const __m128i px = _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, zero), zero);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(px, weight_pair(w[k], 0)));
+        }
+        acc = _mm_srai_epi32(acc, WEIGHT_BITS);
+        const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(acc, acc), zero);
+        const uint32_t pixel = static_cast<uint32_t>(_mm_cvtsi128_si32(packed));
+        std::memcpy(out, &pixel, channels);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        int32x4_t acc = vdupq_n_s32(WEIGHT_ROUND);
+        for (int k = 0; k < taps; ++k) {
+            const uint8x8_t v = vreinterpret_u8_u32(vdup_n_u32(load_u32(p + k * 4)));
+            acc = vmlal_n_s16(acc, vget_low_s16(vreinterpretq_s16_u16(vmovl_u8(v))), w[k]);
+        }
+        const int16x4_t narrow = vqmovn_s32(vshrq_n_s32(acc, WEIGHT_BITS));
+        const uint8x8_t packed = vqmovun_s16(vcombine_s16(narrow, narrow));
+        const uint32_t pixel = vget_lane_u32(vreinterpret_u32_u8(packed), 0);
+        std::memcpy(out, &pixel, channels);
+#else
+        for (int c = 0; c < channels; ++c) {
+            int32_t sum = 0;
+            for (int k = 0; k < taps; ++k) {
+                sum += p[k * 4 + c] * w[k];
+            }
+            out[c] = clamp_weighted(sum);
+        }
+#endif
+    }
+}
+
+void Resampler::vertical_row(const uint8_t* rows, size_t row_bytes, int first,
+                             uint8_t* dst, int y) const {
+    const int taps = vertical_.taps;
+    const int16_t* w = &vertical_.weights[static_cast<size_t>(y) * taps];
+    const uint8_t* base = rows + static_cast<size_t>(vertical_.start[y] - first) * row_bytes;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= row_bytes; i += 16) {
+        __m128i acc[4];
+        for (auto& a : acc) a = _mm_set1_epi32(WEIGHT_ROUND);
+        for (int k = 0; k < taps; k += 2) {
+            const __m128i a = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(base + static_cast<size_t>(k) * row_bytes + i));
+            const bool pair = k + 1 < taps;
+            const __m128i b = pair
+                ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                      base + static_cast<size_t>(k + 1) * row_bytes + i))
+                : zero;
+            const __m128i ww = weight_pair(w[k], pair ? w[k + 1] : 0);
+            const __m128i lo = _mm_unpacklo_epi8(a, b);
+            const __m128i hi = _mm_unpackhi_epi8(a, b);
+            acc[0] = _mm_add_epi32(acc[0], _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), ww));
+            acc[1] = _mm_add_epi32(acc[1], _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), ww));
+            acc[2] = _mm_add_epi32(acc[2], _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), ww));
+            acc[3] = _mm_add_epi32(acc[3], _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), ww));
+        }
+        const __m128i low = _mm_packs_epi32(_mm_srai_epi32(acc[0], WEIGHT_BITS),
+                                            _mm_srai_epi32(acc[1], WEIGHT_BITS));
+        const __m128i high = _mm_packs_epi32(_mm_srai_epi32(acc[2], WEIGHT_BITS),
+                                             _mm_srai_epi32(acc[3], WEIGHT_BITS));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 16 <= row_bytes; i += 16) {
+        int32x4_t acc[4];
+        for (auto& a : acc) a = vdupq_n_s32(WEIGHT_ROUND);
+        for (int k = 0; k < taps; ++k) {
+            const uint8x16_t v = vld1q_u8(base + static_cast<size_t>(k) * row_bytes + i);
+            const int16x8_t lo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(v)));
+            const int16x8_t hi = vreinterpretq_s16_u16(vmovl_high_u8(v));
+            acc[0] = vmlal_n_s16(acc[0], vget_low_s16(lo), w[k]);
+            acc[1] = vmlal_high_n_s16(acc[1], lo, w[k]);
+            acc[2] = vmlal_n_s16(acc[2], vget_low_s16(hi), w[k]);
+            acc[3] = vmlal_high_n_s16(acc[3], hi, w[k]);
+        }
+        const int16x8_t low = vcombine_s16(vqmovn_s32(vshrq_n_s32(acc[0], WEIGHT_BITS)),
+                                           vqmovn_s32(vshrq_n_s32(acc[1], WEIGHT_BITS)));
+        const int16x8_t high = vcombine_s16(vqmovn_s32(vshrq_n_s32(acc[2], WEIGHT_BITS)),
+                                            vqmovn_s32(vshrq_n_s32(acc[3], WEIGHT_BITS)));
+        vst1q_u8(dst + i, vcombine_u8(vqmovun_s16(low), vqmovun_s16(high)));
+    }
+#endif
+
+    for (; i < row_bytes; ++i) {
+        int32_t sum = 0;
+        for (int k = 0; k < taps; ++k) {
+            sum += base[static_cast<size_t>(k) * row_bytes + i] * w[k];
+        }
+        dst[i] = clamp_weighted(sum);
+    }
+}
+
+void Resampler::process(const uint8_t* src, size_t src_stride,
+                        uint8_t* dst, size_t dst_stride) const {
+    const size_t dst_row = static_cast<size_t>(dst_width_) * bytes_per_pixel(format_);
+    if (src_width_ == dst_width_ && src_height_ == dst_height_) {
+        for (int y = 0; y < dst_height_; ++y) {
+            std::memcpy(dst + y * dst_stride, src + y * src_stride, dst_row);
+        }
+        return;
+    }
+
+    const int band_rows = std::max(1, options_.band_rows);
+    const int bands = (dst_height_ + band_rows - 1) / band_rows;
+    std::atomic<int> next{0};
+
+    // Cada faixa refaz a passada horizontal só das linhas de origem que usa;
+    // a sobreposição entre faixas vizinhas é o raio do filtro
+    auto worker = [&] {
+        std::vector<uint8_t> rows;
+        std::vector<uint8_t> scratch;
+        for (int band = next.fetch_add(1); band < bands; band = next.fetch_add(1)) {
+            const int y0 = band * band_rows;
+            const int y1 = std::min(dst_height_, y0 + band_rows);
+            const int first = vertical_.start[y0];
+            const int last = vertical_.start[y1 - 1] + vertical_.taps;
+            rows.resize(static_cast<size_t>(last - first) * dst_row);
+            for (int r = first; r < last; ++r) {
+                horizontal_row(src + static_cast<size_t>(r) * src_stride,
+                               rows.data() + static_cast<size_t>(r - first) * dst_row, scratch);
+            }
+            for (int y = y0; y < y1; ++y) {
+                vertical_row(rows.data(), dst_row, first, dst + static_cast<size_t>(y) * dst_stride, y);
+            }
+        }
+    };
+
+    unsigned threads = options_.threads ? options_.threads
+                                        : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max(1u, std::min<unsigned>(threads, static_cast<unsigned>(bands)));
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threads; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& w : workers) {
+        w.join();
+    }
+}
+
+void Resampler::process_rows(const RowReader& read, const RowSink& emit) const {
+    const int channels = bytes_per_pixel(format_);
+    const size_t src_row = static_cast<size_t>(src_width_) * channels;
+    const size_t dst_row = static_cast<size_t>(dst_width_) * channels;
+    const int band_rows = std::max(1, options_.band_rows);
+    std::vector<uint8_t> source;
+
+    if (src_width_ == dst_width_ && src_height_ == dst_height_) {
+        for (int y = 0; y < src_height_; y += band_rows) {
+            const int count = std::min(band_rows, src_height_ - y);
+            source.resize(static_cast<size_t>(count) * src_row);
+            read(source.data(), count);
+            for (int r = 0; r < count; ++r) {
+                emit(source.data() + static_cast<size_t>(r) * src_row);
+            }
+        }
+        return;
+    }
+
+    unsigned threads = options_.threads ? options_.threads
+                                        : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max(1u, threads);
+    std::vector<std::vector<uint8_t>> scratch(threads);
+    // Divide [0, count) entre as threads; cada uma com seu scratch
+    auto parallel = [&](int count, const std::function<void(int, std::vector<uint8_t>&)>& fn) {
+        std::atomic<int> next{0};
+        auto worker = [&](unsigned t) {
+            for (int i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+                fn(i, scratch[t]);
+            }
+        };
+        const unsigned used = std::min<unsigned>(threads, static_cast<unsigned>(std::max(1, count)));
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < used; ++t) {
+            workers.emplace_back(worker, t);
+        }
+        worker(0);
+        for (auto& w : workers) {
+            w.join();
+        }
+    };
+
+    // Janela de linhas já reamostradas na horizontal: [window_first, window_end)
+    std::vector<uint8_t> window;
+    std::vector<uint8_t> band;
+    int window_first = 0;
+    int window_end = 0;
+    for (int y0 = 0; y0 < dst_height_; y0 += band_rows) {
+        const int y1 = std::min(dst_height_, y0 + band_rows);
+        const int first = vertical_.start[y0];
+        const int last = vertical_.start[y1 - 1] + vertical_.taps;
+
+        // Descarta o que ficou para trás; start é monótono em y
+        if (first >= window_end) {
+            window.clear();
+            if (first > window_end) {
+                const int skip = first - window_end;
+                source.resize(static_cast<size_t>(skip) * src_row);
+                read(source.data(), skip);
+            }
+            window_end = first;
+        } else if (first > window_first) {
+            window.erase(window.begin(),
+                         window.begin() + static_cast<std::ptrdiff_t>((first - window_first) * dst_row));
+        }
+        window_first = first;
+
+        const int fresh = last - window_end;
+        if (fresh > 0) {
+            source.resize(static_cast<size_t>(fresh) * src_row);
+            read(source.data(), fresh);
+            const size_t kept = window.size();
+            window.resize(kept + static_cast<size_t>(fresh) * dst_row);
+            parallel(fresh, [&](int r, std::vector<uint8_t>& local) {
+                horizontal_row(source.data() + static_cast<size_t>(r) * src_row,
+                               window.data() + kept + static_cast<size_t>(r) * dst_row, local);
+            });
+            window_end = last;
+        }
+
+        band.resize(static_cast<size_t>(y1 - y0) * dst_row);
+        parallel(y1 - y0, [&](int r, std::vector<uint8_t>&) {
+            vertical_row(window.data(), dst_row, window_first,
+                         band.data() + static_cast<size_t>(r) * dst_row, y0 + r);
+        });
+        for (int y = y0; y < y1; ++y) {
+            emit(band.data() + static_cast<size_t>(y - y0) * dst_row);
+        }
+    }
+}
+
+Image resample(const Image& image, int width, int height, ResampleOptions options) {
+    if (image.bit_depth != 8) {
+        throw std::invalid_argument("Resampling requires 8-bit samples");
+    }
+    Image out;
+    out.width = width;
+    out.height = height;
+    out.format = image.format;
+    out.bit_depth = 8;
+    out.data.resize(out.row_bytes() * height);
+    Resampler(image.width, image.height, width, height, image.format, options)
+        .process(image.data.data(), image.row_bytes(), out.data.data(), out.row_bytes());
+    return out;
+}
+
+bool plan_downsample(int width, int height, const DownsampleLimits& limits,
+                     int& out_width, int& out_height) {
+    out_width = width;
+    out_height = height;
+    double factor = 1.0;
+    if (limits.max_width > 0) {
+        factor = std::max(factor, static_cast<double>(width) / limits.max_width);
+    }
+    if (limits.max_height > 0) {
+        factor = std::max(factor, static_cast<double>(height) / limits.max_height);
+    }
+    if (factor <= 1.0 || factor < limits.min_factor) {
+        return false;
+    }
+
+    out_width = std::max(1, static_cast<int>(std::lround(width / factor)));
+    out_height = std::max(1, static_cast<int>(std::lround(height / factor)));
+    if (limits.max_width > 0) out_width = std::min(out_width, limits.max_width);
+    if (limits.max_height > 0) out_height = std::min(out_height, limits.max_height);
+    return true;
+}
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,276 @@
+#include "raster/tiled_raster.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#ifdef ALL_PRESS_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace all_press {
+namespace raster {
+
+bool RowBand::all_blank() const {
+    return std::all_of(tile_blank.begin(), tile_blank.end(), [](bool b) { return b; });
+}
+
+TiledRaster::TiledRaster(int width, int height, PixelFormat format,
+                         TiledRasterOptions options)
+    : width_(width), height_(height), format_(format),
+      bpp_(raster::bytes_per_pixel(format)), options_(options) {
+
+    if (width <= 0 || height <= 0) {
+        throw std::invalid_argument("Invalid raster size: " + std::to_string(width) +
+                                    "x" + std::to_string(height));
+    }
+    if (options_.tile_size <= 0) {
+        throw std::invalid_argument("Invalid tile size: " + std::to_string(options_.tile_size));
+    }
+#ifndef ALL_PRESS_HAVE_ZLIB
+    options_.compression = TileCompression::NONE;
+#endif
+
+    tiles_x_ = (width + options_.tile_size - 1) / options_.tile_size;
+    tiles_y_ = (height + options_.tile_size - 1) / options_.tile_size;
+    tiles_.resize(static_cast<size_t>(tiles_x_) * tiles_y_);
+    blank_row_.assign(static_cast<size_t>(options_.tile_size) * bpp_, blank_byte(format));
+}
+
+bool TiledRaster::compression_available() {
+#ifdef ALL_PRESS_HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+TiledRaster TiledRaster::from_buffer(const uint8_t* data, int width, int height,
+                                     PixelFormat format, TiledRasterOptions options) {
+    TiledRaster raster(width, height, format, options);
+    const size_t stride = raster.row_bytes();
+    for (int band = 0; band < raster.band_count(); ++band) {
+        raster.write_band(band, data + static_cast<size_t>(band) * raster.tile_size() * stride,
+                          stride);
+    }
+    return raster;
+}
+
+int TiledRaster::band_height(int band) const {
+    return std::min(options_.tile_size, height_ - band * options_.tile_size);
+}
+
+int TiledRaster::tile_width(int tx) const {
+    return std::min(options_.tile_size, width_ - tx * options_.tile_size);
+}
+
+void TiledRaster::write_band(int band, const uint8_t* data, size_t stride) {
+    if (band < 0 || band >= tiles_y_) {
+        throw std::out_of_range("Band out of range: " + std::to_string(band));
+    }
+
+    const int rows = band_height(band);
+    const bool compress = options_.compression != TileCompression::NONE &&
+                          raw_bytes_ >= options_.hot_bytes_budget;
+
+    for (int tx = 0; tx < tiles_x_; ++tx) {
+        Tile& tile = tiles_[static_cast<size_t>(band) * tiles_x_ + tx];
+        if (tile.state == TileState::RAW) {
+            raw_bytes_ -= tile.data.size();
+        }
+        tile.state = TileState::BLANK;
+        tile.data = std::vector<uint8_t>();
+
+        const size_t span = static_cast<size_t>(tile_width(tx)) * bpp_;
+        const uint8_t* origin = data + static_cast<size_t>(tx) * options_.tile_size * bpp_;
+
+        // Elisão: tile sem tinta não é armazenado
+        bool blank = true;
+        for (int r = 0; r < rows && blank; ++r) {
+            blank = std::memcmp(origin + r * stride, blank_row_.data(), span) == 0;
+        }
+        if (blank) {
+            continue;
+        }
+
+        std::vector<uint8_t> pixels(span * rows);
+        for (int r = 0; r < rows; ++r) {
+            std::memcpy(pixels.data() + r * span, origin + r * stride, span);
+        }
+        store_tile(tile, std::move(pixels), compress);
+    }
+}
+
+void TiledRaster::store_tile(Tile& tile, std::vector<uint8_t>&& pixels, bool compress) {
+#ifdef ALL_PRESS_HAVE_ZLIB
+    if (compress) {
+        uLongf size = compressBound(static_cast<uLong>(pixels.size()));
+        std::vector<uint8_t> packed(size);
+        if (compress2(packed.data(), &size, pixels.data(), static_cast<uLong>(pixels.size()),
+                      options_.compression_level) == Z_OK && size < pixels.size()) {
+            packed.resize(size);
+            packed.shrink_to_fit();
+            tile.data = std::move(packed);
+            tile.state = TileState::COMPRESSED;
+            return;
+        }
+    }
+#else
+    (void)compress;
+#endif
+    raw_bytes_ += pixels.size();
+    tile.data = std::move(pixels);
+    tile.state = TileState::RAW;
+}
+
+void TiledRaster::decode_tile(const Tile& tile, size_t expected, uint8_t* out) const {
+    if (tile.state == TileState::RAW) {
+        std::memcpy(out, tile.data.data(), expected);
+        return;
+    }
+#ifdef ALL_PRESS_HAVE_ZLIB
+    uLongf size = static_cast<uLongf>(expected);
+    if (uncompress(out, &size, tile.data.data(), static_cast<uLong>(tile.data.size())) != Z_OK ||
+        size != expected) {
+        throw std::runtime_error("Corrupted raster tile");
+    }
+#else
+    (void)out;
+    throw std::runtime_error("Compressed raster tile without zlib support");
+#endif
+}
+
+void TiledRaster::read_band(int band, RowBand& out) const {
+    if (band < 0 || band >= tiles_y_) {
+        throw std::out_of_range("Band out of range: " + std::to_string(band));
+    }
+
+    const int rows = band_height(band);
+    out.index = band;
+    out.y = band * options_.tile_size;
+    out.rows = rows;
+    out.width = width_;
+    out.stride = row_bytes();
+    out.storage.resize(out.stride * rows);
+    out.tile_blank.assign(tiles_x_, true);
+
+    std::vector<uint8_t> scratch;
+    for (int tx = 0; tx < tiles_x_; ++tx) {
+        const Tile& tile = tiles_[static_cast<size_t>(band) * tiles_x_ + tx];
+        const size_t span = static_cast<size_t>(tile_width(tx)) * bpp_;
+        uint8_t* origin = out.storage.data() + static_cast<size_t>(tx) * options_.tile_size * bpp_;
+
+        if (tile.state == TileState::BLANK) {
+            for (int r = 0; r < rows; ++r) {
+                std::memcpy(origin + r * out.stride, blank_row_.data(), span);
+            }
+            continue;
+        }
+
+        out.tile_blank[tx] = false;
+        const uint8_t* pixels = tile.data.data();
+        if (tile.state == TileState::COMPRESSED) {
+            scratch.resize(span * rows);
+            decode_tile(tile, scratch.size(), scratch.data());
+            pixels = scratch.data();
+        }
+        for (int r = 0; r < rows; ++r) {
+            std::memcpy(origin + r * out.stride, pixels + r * span, span);
+        }
+    }
+    out.data = out.storage.data();
+}
+
+void TiledRaster::for_each_band(const std::function<bool(const RowBand&)>& fn) const {
+    RowBand band;
+    for (int b = 0; b < tiles_y_; ++b) {
+        read_band(b, band);
+        if (!fn(band)) {
+            break;
+        }
+    }
+}
+
+void TiledRaster::read_rows(int y, int rows, uint8_t* out) const {
+    if (y < 0 || rows < 0 || y + rows > height_) {
+        throw std::out_of_range("Rows out of range");
+    }
+
+    RowBand band;
+    int row = y;
+    while (row < y + rows) {
+        int b = row / options_.tile_size;
+        read_band(b, band);
+        int first = row - band.y;
+        int count = std::min(band.rows - first, y + rows - row);
+        std::memcpy(out + static_cast<size_t>(row - y) * band.stride,
+                    band.row(first), band.stride * count);
+        row += count;
+    }
+}
+
+bool TiledRaster::tile_is_blank(int tx, int ty) const {
+    return tiles_[static_cast<size_t>(ty) * tiles_x_ + tx].state == TileState::BLANK;
+}
+
+std::vector<uint8_t> TiledRaster::to_buffer() const {
+    std::vector<uint8_t> buffer(row_bytes() * height_);
+    read_rows(0, height_, buffer.data());
+    return buffer;
+}
+
+TiledRasterStats TiledRaster::stats() const {
+    TiledRasterStats result;
+    result.tiles = tiles_.size();
+    for (const auto& tile : tiles_) {
+        switch (tile.state) {
+            case TileState::BLANK:
+                result.blank_tiles++;
+                break;
+            case TileState::RAW:
+                result.raw_tiles++;
+                result.raw_bytes += tile.data.size();
+                break;
+            case TileState::COMPRESSED:
+                result.compressed_tiles++;
+                result.compressed_bytes += tile.data.size();
+                break;
+        }
+    }
+    return result;
+}
+
+TiledRasterWriter::TiledRasterWriter(TiledRaster& raster)
+    : raster_(raster),
+      band_(raster.row_bytes() * raster.tile_size()) {
+}
+
+void TiledRasterWriter::append_row(const uint8_t* row) {
+    if (next_row_ >= raster_.height()) {
+        throw std::out_of_range("Too many rows for raster");
+    }
+    std::memcpy(band_.data() + static_cast<size_t>(band_rows_) * raster_.row_bytes(),
+                row, raster_.row_bytes());
+    ++band_rows_;
+    ++next_row_;
+
+    int band = (next_row_ - 1) / raster_.tile_size();
+    if (band_rows_ == raster_.band_height(band)) {
+        raster_.write_band(band, band_.data(), raster_.row_bytes());
+        band_rows_ = 0;
+    }
+}
+
+void TiledRasterWriter::finish() {
+    if (band_rows_ == 0) {
+        return;
+    }
+    int band = (next_row_ - 1) / raster_.tile_size();
+    std::fill(band_.begin() + static_cast<size_t>(band_rows_) * raster_.row_bytes(),
+              band_.end(), blank_byte(raster_.format()));
+    raster_.write_band(band, band_.data(), raster_.row_bytes());
+    band_rows_ = 0;
+}
+
+}  // namespace raster
+}  // namespace all_press
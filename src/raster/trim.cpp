@@ -0,0 +1,194 @@
+#include "raster/trim.h"
+#include <algorithm>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace all_press {
+namespace raster {
+
+namespace {
+
+// Trecho de uma linha de faixa, só nos tiles que não estão em branco
+bool band_row_has_ink(const TiledRaster& page, const RowBand& band, int row, int tolerance) {
+    const size_t tile_bytes = static_cast<size_t>(page.tile_size()) * page.bytes_per_pixel();
+    const uint8_t* data = band.row(row);
+    for (int tx = 0; tx < page.tiles_x(); ++tx) {
+        if (band.tile_blank[tx]) {
+            continue;
+        }
+        const size_t begin = tx * tile_bytes;
+        const size_t end = std::min(band.stride, begin + tile_bytes);
+        if (row_has_ink(data + begin, end - begin, page.format(), tolerance)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool band_is_blank(const TiledRaster& page, int band) {
+    for (int tx = 0; tx < page.tiles_x(); ++tx) {
+        if (!page.tile_is_blank(tx, band)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+bool row_has_ink(const uint8_t* row, size_t bytes, PixelFormat format, int tolerance) {
+    tolerance = std::min(255, std::max(0, tolerance));
+    // Papel branco (cinza/RGB): tinta abaixo de 255 - tolerance.
+    // CMYK: tinta acima de tolerance.
+    const bool white_paper = blank_byte(format) == 0xFF;
+    const uint8_t limit = static_cast<uint8_t>(white_paper ? 255 - tolerance : tolerance);
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i threshold = _mm_set1_epi8(static_cast<char>(limit));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 64 <= bytes; i += 64) {
+        __m128i any = zero;
+        for (int k = 0; k < 4; ++k) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i + 16 * k));
+            any = _mm_or_si128(any, white_paper ? _mm_subs_epu8(threshold, v)
+                                                : _mm_subs_epu8(v, threshold));
+        }
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(any, zero)) != 0xFFFF) {
+            return true;
+        }
+    }
+    for (; i + 16 <= bytes; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        const __m128i ink = white_paper ? _mm_subs_epu8(threshold, v) : _mm_subs_epu8(v, threshold);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(ink, zero)) != 0xFFFF) {
+            return true;
+        }
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t threshold = vdupq_n_u8(limit);
+    for (; i + 64 <= bytes; i += 64) {
+        uint8x16_t any = vdupq_n_u8(0);
+        for (int k = 0; k < 4; ++k) {
+            const uint8x16_t v = vld1q_u8(row + i + 16 * k);
+            any = vorrq_u8(any, white_paper ? vqsubq_u8(threshold, v) : vqsubq_u8(v, threshold));
+        }
+        if (vmaxvq_u8(any) != 0) {
+            return true;
+        }
+    }
+#endif
+
+    for (; i < bytes; ++i) {
+        if (white_paper ? row[i] < limit : row[i] > limit) {
+            return true;
+        }
+    }
+    return false;
+}
+
+InkExtent find_ink_extent(const uint8_t* data, int width, int height, size_t stride,
+                          PixelFormat format, int tolerance) {
+    InkExtent extent;
+    const size_t bytes = static_cast<size_t>(width) * bytes_per_pixel(format);
+    int y = 0;
+    while (y < height && !row_has_ink(data + static_cast<size_t>(y) * stride, bytes, format, tolerance)) {
+        ++y;
+    }
+    if (y == height) {
+        return extent;
+    }
+    extent.blank = false;
+    extent.first_row = y;
+    int last = height - 1;
+    while (last > y && !row_has_ink(data + static_cast<size_t>(last) * stride, bytes, format, tolerance)) {
+        --last;
+    }
+    extent.last_row = last;
+    return extent;
+}
+
+InkExtent find_ink_extent(const TiledRaster& page, int tolerance) {
+    InkExtent extent;
+    RowBand band;
+
+    int first_band = 0;
+    for (; first_band < page.band_count(); ++first_band) {
+        if (band_is_blank(page, first_band)) {
+            continue;
+        }
+        page.read_band(first_band, band);
+        for (int r = 0; r < band.rows; ++r) {
+            if (band_row_has_ink(page, band, r, tolerance)) {
+                extent.blank = false;
+                extent.first_row = band.y + r;
+                break;
+            }
+        }
+        if (!extent.blank) {
+            break;
+        }
+    }
+    if (extent.blank) {
+        return extent;
+    }
+
+    for (int b = page.band_count() - 1; b >= first_band; --b) {
+        if (band_is_blank(page, b)) {
+            continue;
+        }
+        page.read_band(b, band);
+        for (int r = band.rows - 1; r >= 0; --r) {
+            if (band_row_has_ink(page, band, r, tolerance)) {
+                extent.last_row = band.y + r;
+                return extent;
+            }
+        }
+    }
+    extent.last_row = extent.first_row;
+    return extent;
+}
+
+TrimPlan plan_trim(const InkExtent& extent, int height, const TrimOptions& options) {
+    TrimPlan plan;
+    if (extent.blank) {
+        plan.blank = true;
+        plan.removed_rows = height;
+        return plan;
+    }
+    const int margin = std::max(0, options.margin_rows);
+    const int first = options.trim_leading ? std::max(0, extent.first_row - margin) : 0;
+    const int last = std::min(height - 1, extent.last_row + margin);
+    plan.first_row = first;
+    plan.rows = last - first + 1;
+    plan.removed_rows = height - plan.rows;
+    return plan;
+}
+
+TiledRaster crop_rows(const TiledRaster& page, int first_row, int rows) {
+    if (first_row < 0 || rows <= 0 || first_row + rows > page.height()) {
+        throw std::out_of_range("Crop rows out of range");
+    }
+    TiledRasterOptions options;
+    options.tile_size = page.tile_size();
+    TiledRaster cropped(page.width(), rows, page.format(), options);
+    TiledRasterWriter writer(cropped);
+    RowBand band;
+    int y = first_row;
+    while (y < first_row + rows) {
+        page.read_band(y / page.tile_size(), band);
+        for (int r = y - band.y; r < band.rows && y < first_row + rows; ++r, ++y) {
+            writer.append_row(band.row(r));
+        }
+    }
+    writer.finish();
+    return cropped;
+}
+
+}  // namespace raster
+}  // namespace all_press
@@ -0,0 +1,450 @@
+#include "utils/subprocess.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace AllPress {
+namespace Utils {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t IO_CHUNK = 64 * 1024;
+constexpr int POLL_CAP_MS = 50;
+constexpr auto EXIT_POLL = std::chrono::milliseconds(10);
+constexpr auto DRAIN_AFTER_EXIT = std::chrono::seconds(1);
+
+// Descritores do lado do filho: stdin, stdout e stderr
+struct ChildStdio {
+    int in = -1;
+    int out = -1;
+    int err = -1;
+};
+
+void close_fd(int& fd) {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+int open_null(int flags) {
+    return ::open("/dev/null", flags | O_CLOEXEC);
+}
+
+void set_nonblocking(int fd) {
+    const int flags = ::fcntl(fd, F_GETFL);
+    ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Dentro do filho de vfork: só chamadas async-signal-safe
+void child_dup(int fd, int target) {
+    if (fd == target) {
+        ::fcntl(fd, F_SETFD, 0);
+    } else {
+        ::dup2(fd, target);
+    }
+}
+
+// Tudo que o filho usa depois do vfork, montado antes e nunca alterado:
+// nada disso pode viver só em registrador entre o vfork e o retorno do filho
+struct ChildPlan {
+    const char* path;
+    char* const* argv;
+    const char* cwd;          // nullptr = diretório atual
+    struct rlimit cpu_limit;
+    struct rlimit memory_limit;
+};
+
+struct rlimit make_cpu_limit(int seconds) {
+    struct rlimit limit = {};
+    if (seconds > 0) {
+        // O limite rígido um segundo acima: SIGXCPU primeiro, SIGKILL depois
+        limit.rlim_cur = static_cast<rlim_t>(seconds);
+        limit.rlim_max = static_cast<rlim_t>(seconds) + 1;
+    }
+    return limit;
+}
+
+struct rlimit make_memory_limit(size_t megabytes) {
+    struct rlimit limit = {};
+    if (megabytes > 0) {
+        limit.rlim_cur = limit.rlim_max = static_cast<rlim_t>(megabytes) * 1024 * 1024;
+    }
+    return limit;
+}
+
+// Tudo que o filho precisa é montado antes do vfork: o filho compartilha a
+// memória do pai e não pode alocar
+pid_t spawn_child(const std::vector<std::string>& args, const SubprocessOptions& options,
+                  const ChildStdio& stdio, int& spawn_error) {
+    spawn_error = 0;
+    if (args.empty()) {
+        spawn_error = EINVAL;
+        return -1;
+    }
+    const std::string path = args[0].find('/') == std::string::npos
+                                 ? Subprocess::find_executable(args[0])
+                                 : args[0];
+    if (path.empty()) {
+        spawn_error = ENOENT;
+        return -1;
+    }
+    std::vector<char*> argv;
+    argv.reserve(args.size() + 1);
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    const ChildPlan plan = {
+        path.c_str(),
+        argv.data(),
+        options.working_dir.empty() ? nullptr : options.working_dir.c_str(),
+        make_cpu_limit(options.cpu_limit_s),
+        make_memory_limit(options.memory_limit_mb),
+    };
+
+    // Sinais bloqueados até o exec: um handler do servidor não pode rodar no
+    // filho, que usa a pilha do pai
+    sigset_t all;
+    sigset_t previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &previous);
+
+    volatile int child_errno = 0;
+    const pid_t pid = ::vfork();
+    if (pid == 0) {
+        for (int sig = 1; sig < NSIG; ++sig) {
+            struct sigaction action;
+            if (::sigaction(sig, nullptr, &action) != 0) {
+                continue;
+            }
+            if (action.sa_handler != SIG_DFL && (action.sa_handler != SIG_IGN || sig == SIGPIPE)) {
+                struct sigaction reset = {};
+                reset.sa_handler = SIG_DFL;
+                ::sigaction(sig, &reset, nullptr);
+            }
+        }
+        ::setpgid(0, 0);
+        child_dup(stdio.in, STDIN_FILENO);
+        child_dup(stdio.out, STDOUT_FILENO);
+        child_dup(stdio.err, STDERR_FILENO);
+        if ((plan.cwd && ::chdir(plan.cwd) != 0) ||
+            (plan.cpu_limit.rlim_max > 0 && ::setrlimit(RLIMIT_CPU, &plan.cpu_limit) != 0) ||
+            (plan.memory_limit.rlim_max > 0 && ::setrlimit(RLIMIT_AS, &plan.memory_limit) != 0)) {
+            child_errno = errno;
+            ::_exit(127);
+        }
+        sigset_t none;
+        sigemptyset(&none);
+        ::sigprocmask(SIG_SETMASK, &none, nullptr);
+        ::execve(plan.path, plan.argv, environ);
+        child_errno = errno;
+        ::_exit(127);
+    }
+    const int vfork_errno = errno;
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+    if (pid < 0) {
+        spawn_error = vfork_errno;
+        return -1;
+    }
+    if (child_errno != 0) {
+        spawn_error = child_errno;
+        ::waitpid(pid, nullptr, 0);
+        return -1;
+    }
+    return pid;
+}
+
+// Saída do líder sem recolhê-lo: enquanto é zumbi o id do grupo não pode
+// ser reutilizado, e o grupo ainda pode receber kill
+bool leader_exited(pid_t pid) {
+    siginfo_t info = {};
+    return ::waitid(P_PID, static_cast<id_t>(pid), &info, WEXITED | WNOHANG | WNOWAIT) == 0 &&
+           info.si_pid == pid;
+}
+
+double seconds(const struct timeval& tv) {
+    return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6;
+}
+
+}  // namespace
+
+std::string SubprocessResult::describe() const {
+    std::string text;
+    if (spawn_error != 0) {
+        text = std::string("could not start: ") + std::strerror(spawn_error);
+    } else if (timed_out) {
+        text = "timed out after " + std::to_string(static_cast<int>(wall_seconds)) + " s";
+    } else if (cpu_limit_hit) {
+        text = "exceeded CPU limit";
+    } else if (term_signal != 0) {
+        text = std::string("killed by signal ") + std::to_string(term_signal) + " (" +
+               strsignal(term_signal) + ")";
+    } else {
+        text = "exit code " + std::to_string(exit_code);
+    }
+    // Última linha não vazia do stderr
+    size_t end = error_output.find_last_not_of(" \r\n\t");
+    if (end != std::string::npos) {
+        const size_t start = error_output.rfind('\n', end);
+        text += ": " + error_output.substr(start == std::string::npos ? 0 : start + 1,
+                                           end - (start == std::string::npos ? 0 : start + 1) + 1);
+    }
+    return text;
+}
+
+SubprocessResult Subprocess::run(const std::vector<std::string>& argv,
+                                 const SubprocessOptions& options,
+                                 const Source& input, const Sink& output) {
+    SubprocessResult result;
+    const auto started = Clock::now();
+
+    int in_pipe[2] = {-1, -1};
+    int out_pipe[2] = {-1, -1};
+    int err_pipe[2] = {-1, -1};
+    ChildStdio stdio;
+    bool pipes_ok = ::pipe2(err_pipe, O_CLOEXEC) == 0;
+    if (pipes_ok && input) {
+        pipes_ok = ::pipe2(in_pipe, O_CLOEXEC) == 0;
+    }
+    if (pipes_ok && output) {
+        pipes_ok = ::pipe2(out_pipe, O_CLOEXEC) == 0;
+    }
+    stdio.in = input ? in_pipe[0] : open_null(O_RDONLY);
+    stdio.out = output ? out_pipe[1] : open_null(O_WRONLY);
+    stdio.err = err_pipe[1];
+
+    pid_t pid = -1;
+    if (!pipes_ok || stdio.in < 0 || stdio.out < 0) {
+        result.spawn_error = errno;
+    } else {
+        pid = spawn_child(argv, options, stdio, result.spawn_error);
+    }
+    // Só o filho fica com os lados dele: EOF chega quando ele sai
+    if (input) {
+        close_fd(in_pipe[0]);
+    } else {
+        close_fd(stdio.in);
+    }
+    if (output) {
+        close_fd(out_pipe[1]);
+    } else {
+        close_fd(stdio.out);
+    }
+    close_fd(err_pipe[1]);
+    if (pid < 0) {
+        close_fd(in_pipe[1]);
+        close_fd(out_pipe[0]);
+        close_fd(err_pipe[0]);
+        return result;
+    }
+
+    int in_fd = in_pipe[1];
+    int out_fd = out_pipe[0];
+    int err_fd = err_pipe[0];
+    for (int fd : {in_fd, out_fd, err_fd}) {
+        if (fd >= 0) {
+            set_nonblocking(fd);
+        }
+    }
+
+    // Escrita num stdin fechado vira EPIPE em vez de derrubar o servidor
+    sigset_t pipe_set;
+    sigset_t previous_mask;
+    sigemptyset(&pipe_set);
+    sigaddset(&pipe_set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipe_set, &previous_mask);
+
+    std::vector<char> in_buffer(input ? IO_CHUNK : 0);
+    size_t in_pos = 0;
+    size_t in_len = 0;
+    std::vector<char> read_buffer(IO_CHUNK);
+
+    const bool has_deadline = options.timeout.count() > 0;
+    const auto deadline = started + options.timeout;
+    Clock::time_point kill_at;
+    Clock::time_point drain_until;
+    bool exited = false;
+    bool killed = false;
+
+    while (!exited || in_fd >= 0 || out_fd >= 0 || err_fd >= 0) {
+        const auto now = Clock::now();
+        if (has_deadline && !exited && now >= deadline) {
+            if (!result.timed_out) {
+                result.timed_out = true;
+                ::kill(-pid, SIGTERM);
+                kill_at = now + options.kill_grace;
+            } else if (!killed && now >= kill_at) {
+                ::kill(-pid, SIGKILL);
+                killed = true;
+            }
+        }
+        if (!exited && leader_exited(pid)) {
+            // Descendentes órfãos não seguram os pipes nem sobrevivem ao job
+            exited = true;
+            ::kill(-pid, SIGKILL);
+            drain_until = Clock::now() + DRAIN_AFTER_EXIT;
+        }
+        if (exited && Clock::now() >= drain_until) {
+            break;
+        }
+
+        struct pollfd fds[3];
+        nfds_t count = 0;
+        if (in_fd >= 0) {
+            fds[count++] = {in_fd, POLLOUT, 0};
+        }
+        if (out_fd >= 0) {
+            fds[count++] = {out_fd, POLLIN, 0};
+        }
+        if (err_fd >= 0) {
+            fds[count++] = {err_fd, POLLIN, 0};
+        }
+        int wait_ms = count > 0 ? POLL_CAP_MS : static_cast<int>(EXIT_POLL.count());
+        if (has_deadline && !exited && !killed) {
+            const auto target = result.timed_out ? kill_at : deadline;
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(target - now);
+            wait_ms = std::max(0, std::min<int>(wait_ms, static_cast<int>(remaining.count()) + 1));
+        }
+        if (::poll(count > 0 ? fds : nullptr, count, wait_ms) < 0 && errno != EINTR) {
+            break;
+        }
+
+        for (nfds_t i = 0; i < count; ++i) {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            const int fd = fds[i].fd;
+            if (fd == in_fd) {
+                if (in_pos == in_len) {
+                    in_len = input(in_buffer.data(), in_buffer.size());
+                    in_pos = 0;
+                    if (in_len == 0) {
+                        close_fd(in_fd);
+                        continue;
+                    }
+                }
+                const ssize_t n = ::write(in_fd, in_buffer.data() + in_pos, in_len - in_pos);
+                if (n > 0) {
+                    in_pos += static_cast<size_t>(n);
+                } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                    close_fd(in_fd);   // EPIPE: o filho parou de ler
+                }
+                continue;
+            }
+            const ssize_t n = ::read(fd, read_buffer.data(), read_buffer.size());
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+                close_fd(fd == out_fd ? out_fd : err_fd);
+            } else if (n > 0 && fd == out_fd) {
+                if (!output(read_buffer.data(), static_cast<size_t>(n))) {
+                    close_fd(out_fd);
+                }
+            } else if (n > 0) {
+                result.error_output.append(read_buffer.data(), static_cast<size_t>(n));
+                if (result.error_output.size() > options.error_tail_bytes) {
+                    result.error_output.erase(0, result.error_output.size() - options.error_tail_bytes);
+                }
+            }
+        }
+    }
+    close_fd(in_fd);
+    close_fd(out_fd);
+    close_fd(err_fd);
+
+    // SIGPIPE pendente das escritas é descartado antes de restaurar a máscara
+    const struct timespec zero = {0, 0};
+    while (sigtimedwait(&pipe_set, nullptr, &zero) > 0) {
+    }
+    pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+
+    int status = 0;
+    struct rusage usage = {};
+    while (::wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {
+    }
+    result.wall_seconds = std::chrono::duration<double>(Clock::now() - started).count();
+    result.cpu_seconds = seconds(usage.ru_utime) + seconds(usage.ru_stime);
+    if (WIFEXITED(status)) {
+        result.exit_code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        result.term_signal = WTERMSIG(status);
+        result.cpu_limit_hit = options.cpu_limit_s > 0 && !result.timed_out &&
+                               (result.term_signal == SIGXCPU ||
+                                (result.term_signal == SIGKILL && result.cpu_seconds >= options.cpu_limit_s));
+    }
+    return result;
+}
+
+pid_t Subprocess::spawn_background(const std::vector<std::string>& argv,
+                                   const SubprocessOptions& options) {
+    ChildStdio stdio;
+    stdio.in = open_null(O_RDONLY);
+    stdio.out = open_null(O_WRONLY);
+    stdio.err = stdio.out;
+    int spawn_error = 0;
+    pid_t pid = -1;
+    if (stdio.in >= 0 && stdio.out >= 0) {
+        pid = spawn_child(argv, options, stdio, spawn_error);
+    } else {
+        spawn_error = errno;
+    }
+    close_fd(stdio.in);
+    close_fd(stdio.out);
+    if (pid < 0) {
+        errno = spawn_error;
+    }
+    return pid;
+}
+
+void Subprocess::terminate_group(pid_t pid, std::chrono::milliseconds grace) {
+    if (pid <= 0) {
+        return;
+    }
+    ::kill(-pid, SIGTERM);
+    const auto deadline = Clock::now() + grace;
+    while (!leader_exited(pid) && Clock::now() < deadline) {
+        std::this_thread::sleep_for(EXIT_POLL);
+    }
+    ::kill(-pid, SIGKILL);   // Líder ainda vivo ou filhos que sobreviveram a ele
+    while (::waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {
+    }
+}
+
+std::string Subprocess::find_executable(const std::string& name) {
+    const char* path = std::getenv("PATH");
+    if (!path || name.empty()) {
+        return "";
+    }
+    const std::string dirs = path;
+    size_t start = 0;
+    while (start <= dirs.size()) {
+        size_t end = dirs.find(':', start);
+        if (end == std::string::npos) {
+            end = dirs.size();
+        }
+        const std::string candidate = dirs.substr(start, end - start) + "/" + name;
+        if (end > start && ::access(candidate.c_str(), X_OK) == 0) {
+            return candidate;
+        }
+        start = end + 1;
+    }
+    return "";
+}
+
+} // namespace Utils
+} // namespace AllPress
@@ -1,11 +1,49 @@
 #include <gtest/gtest.h>
 #include "conversion/file_processor.h"
+#include "conversion/conversion_cache.h"
+#include "conversion/converter_pool.h"
+#include "conversion/pdf_processor.h"
+#include "utils/subprocess.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <map>
+#include <thread>
+#include <vector>
 
 namespace fs = std::filesystem;
 using namespace AllPress;
 
+namespace {
+
+// PDF montado em memória com xref clássica; objetos escritos em ordem
+struct PdfBuilder {
+    std::map<int, std::string> objects;
+
+    std::string build(int root) const {
+        std::string pdf = "%PDF-1.7\n%\xe2\xe3\xcf\xd3\n";
+        std::vector<size_t> offsets;
+        for (const auto& object : objects) {
+            offsets.push_back(pdf.size());
+            pdf += std::to_string(object.first) + " 0 obj\n" + object.second + "\nendobj\n";
+        }
+        const size_t xref = pdf.size();
+        pdf += "xref\n0 " + std::to_string(objects.size() + 1) + "\n0000000000 65535 f\r\n";
+        for (size_t offset : offsets) {
+            char entry[21];
+            std::snprintf(entry, sizeof(entry), "%010zu 00000 n\r\n", offset);
+            pdf += entry;
+        }
+        pdf += "trailer\n<< /Size " + std::to_string(objects.size() + 1) + " /Root " + std::to_string(root) +
+               " 0 R >>\nstartxref\n" + std::to_string(xref) + "\n%%EOF\n";
+        return pdf;
+    }
+};
+
+}  // namespace
+
 class FileProcessorTest : public ::testing::Test {
 protected:
     void SetUp() override {
@@ -63,6 +101,251 @@ TEST_F(FileProcessorTest, HandlesNonExistentFile) {
     EXPECT_EQ(result, FileType::Unknown);
 }
 
+TEST_F(FileProcessorTest, ConverterPoolLimitsConcurrentLeases) {
+    ConverterPool pool((test_dir / "workers").string());
+    ConverterLimits limits;
+    limits.max_workers = 2;
+    pool.configure(ConverterTool::ImageMagick, limits);
+
+    std::atomic<int> active{0};
+    std::atomic<int> peak{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 6; ++i) {
+        threads.emplace_back([&]() {
+            ConverterLease lease = pool.checkout(ConverterTool::ImageMagick);
+            ASSERT_TRUE(lease);
+            EXPECT_TRUE(fs::is_directory(lease.work_dir()));
+            EXPECT_TRUE(fs::is_empty(lease.work_dir()));
+            std::ofstream(lease.work_dir() + "/out.pdf") << "x";
+            const int now = ++active;
+            int seen = peak.load();
+            while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            --active;
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_LE(peak.load(), 2);
+    ConverterPoolStats stats = pool.stats(ConverterTool::ImageMagick);
+    EXPECT_EQ(stats.conversions, 6u);
+    EXPECT_EQ(stats.workers, 2);
+    EXPECT_EQ(stats.busy, 0);
+    EXPECT_GT(stats.waits, 0u);
+    EXPECT_EQ(stats.warm, 0u);
+}
+
+TEST_F(FileProcessorTest, SubprocessStreamsPipesAndEnforcesTimeout) {
+    // Argumentos chegam intactos, sem shell no meio
+    const std::string weird = "a b'c;$(x)";
+    std::string output;
+    auto sink = [&](const char* data, size_t size) {
+        output.append(data, size);
+        return true;
+    };
+    Utils::SubprocessResult result = Utils::Subprocess::run({"printf", "%s", weird}, {}, nullptr, sink);
+    EXPECT_TRUE(result.ok());
+    EXPECT_EQ(output, weird);
+
+    // stdin e stdout por pipe, maiores que o buffer do kernel
+    const std::string payload(1 << 20, 'x');
+    size_t fed = 0;
+    output.clear();
+    result = Utils::Subprocess::run({"cat"}, {},
+                                    [&](char* buffer, size_t size) {
+                                        const size_t n = std::min(size, payload.size() - fed);
+                                        std::copy_n(payload.data() + fed, n, buffer);
+                                        fed += n;
+                                        return n;
+                                    },
+                                    sink);
+    EXPECT_TRUE(result.ok());
+    EXPECT_EQ(output.size(), payload.size());
+
+    // Timeout derruba o grupo inteiro, inclusive quem ignora SIGTERM
+    Utils::SubprocessOptions options;
+    options.timeout = std::chrono::milliseconds(200);
+    options.kill_grace = std::chrono::milliseconds(200);
+    result = Utils::Subprocess::run({"sh", "-c", "trap '' TERM; sleep 30 & sleep 30"}, options);
+    EXPECT_TRUE(result.timed_out);
+    EXPECT_FALSE(result.ok());
+    EXPECT_LT(result.wall_seconds, 5.0);
+
+    result = Utils::Subprocess::run({"all_press_no_such_tool"});
+    EXPECT_NE(result.spawn_error, 0);
+}
+
+TEST_F(FileProcessorTest, ConversionCacheEvictsLeastRecentlyUsed) {
+    const std::string root = (test_dir / "cache").string();
+    auto write = [&](const std::string& name, size_t size, char fill) {
+        const std::string path = (test_dir / name).string();
+        std::ofstream(path, std::ios::binary) << std::string(size, fill);
+        return path;
+    };
+    auto read = [](const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    };
+
+    {
+        ConversionCache cache(root, 3000);
+        const std::string a = write("a.bin", 1000, 'a');
+        const std::string hash = cache.content_hash(a);
+        EXPECT_EQ(hash.size(), 64u);
+        EXPECT_EQ(cache.content_hash(write("a_copy.bin", 1000, 'a')), hash);
+
+        const std::string key_a = ConversionCache::make_key({"pdf", hash, "dpi=300"});
+        EXPECT_NE(key_a, ConversionCache::make_key({"pdf", hash, "dpi=600"}));
+        EXPECT_NE(ConversionCache::make_key({"ab", "c"}), ConversionCache::make_key({"a", "bc"}));
+
+        const std::string out = (test_dir / "out.bin").string();
+        EXPECT_FALSE(cache.fetch(key_a, out));
+        ASSERT_TRUE(cache.publish(key_a, a, "model_s 1"));
+        std::string meta;
+        ASSERT_TRUE(cache.fetch(key_a, out, &meta));
+        EXPECT_EQ(read(out), std::string(1000, 'a'));
+        EXPECT_EQ(meta, "model_s 1");
+
+        // A cópia do chamador pode mudar sem afetar a entrada
+        write("out.bin", 10, 'x');
+        ASSERT_TRUE(cache.fetch(key_a, out));
+        EXPECT_EQ(read(out).size(), 1000u);
+
+        ASSERT_TRUE(cache.publish("b1", write("b.bin", 1000, 'b')));
+        ASSERT_TRUE(cache.fetch(key_a, out));   // a passa a ser a mais recente
+        ASSERT_TRUE(cache.publish("c1", write("c.bin", 1200, 'c')));
+        EXPECT_FALSE(cache.fetch("b1", out));
+        EXPECT_TRUE(cache.fetch(key_a, out));
+        EXPECT_FALSE(cache.publish("d1", write("d.bin", 4000, 'd')));
+
+        const ConversionCacheStats stats = cache.stats();
+        EXPECT_EQ(stats.entries, 2u);
+        EXPECT_EQ(stats.evictions, 1u);
+        EXPECT_LE(stats.bytes, 3000u);
+    }
+
+    // Entradas sobrevivem a um novo processo
+    ConversionCache reopened(root, 3000);
+    EXPECT_EQ(reopened.stats().entries, 2u);
+    EXPECT_TRUE(reopened.fetch("c1", (test_dir / "c_out.bin").string()));
+}
+
+TEST_F(FileProcessorTest, ReadsPdfStructureWithoutRendering) {
+    // 2000 páginas em 20 nós intermediários; MediaBox e recursos herdados,
+    // uma página colorida com tamanho próprio e um nó girado
+    PdfBuilder builder;
+    builder.objects[1] = "<< /Type /Catalog /Pages 2 0 R >>";
+    builder.objects[3] = "<< /ColorSpace << /CS0 [/ICCBased 4 0 R] /CS1 [/Separation /Black /DeviceCMYK 5 0 R] >> >>";
+    builder.objects[4] = "<< /N 1 /Length 0 >>\nstream\n\nendstream";
+    builder.objects[5] = "<< /FunctionType 2 /Domain [0 1] /C0 [0 0 0 0] /C1 [0 0 0 1] /N 1 >>";
+    builder.objects[6] = "<< /XObject << /Im0 7 0 R >> >>";
+    builder.objects[7] = "<< /Type /XObject /Subtype /Image /Width 1 /Height 1 /BitsPerComponent 8 "
+                         "/ColorSpace [/Indexed /DeviceRGB 1 <000000FF0000>] /Length 1 >>\nstream\n\x01\nendstream";
+    std::string root_kids;
+    int next = 10;
+    for (int node = 0; node < 20; ++node) {
+        const int node_num = next++;
+        std::string kids;
+        for (int i = 0; i < 100; ++i) {
+            const int page_num = next++;
+            const int index = node * 100 + i;
+            kids += std::to_string(page_num) + " 0 R ";
+            builder.objects[page_num] = index == 1500
+                ? "<< /Type /Page /Parent " + std::to_string(node_num) +
+                  " 0 R /MediaBox [0 0 842 1191] /Resources 6 0 R >>"
+                : "<< /Type /Page /Parent " + std::to_string(node_num) + " 0 R >>";
+        }
+        builder.objects[node_num] = "<< /Type /Pages /Parent 2 0 R /Count 100 /Kids [" + kids + "]" +
+                                    (node == 3 ? " /Rotate 90" : "") + " >>";
+        root_kids += std::to_string(node_num) + " 0 R ";
+    }
+    builder.objects[2] = "<< /Type /Pages /Count 2000 /MediaBox [0 0 595 842] /Resources 3 0 R /Kids [" +
+                         root_kids + "] >>";
+    const std::string path = (test_dir / "book.pdf").string();
+    std::ofstream(path, std::ios::binary) << builder.build(1);
+
+    PdfStructure structure;
+    std::string error;
+    const auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(read_pdf_structure(path, structure, &error)) << error;
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    EXPECT_LT(elapsed, 0.5);
+
+    EXPECT_EQ(structure.version, "1.7");
+    EXPECT_FALSE(structure.repaired);
+    ASSERT_EQ(structure.page_count, 2000);
+    EXPECT_DOUBLE_EQ(structure.pages[0].width_pt, 595.0);
+    EXPECT_DOUBLE_EQ(structure.pages[0].height_pt, 842.0);
+    EXPECT_EQ(structure.pages[350].rotate, 90);
+    EXPECT_EQ(structure.pages[450].rotate, 0);
+    EXPECT_DOUBLE_EQ(structure.pages[1500].width_pt, 842.0);
+    EXPECT_TRUE(structure.uses_color);
+    EXPECT_EQ(std::count_if(structure.pages.begin(), structure.pages.end(),
+                            [](const PdfPageInfo& page) { return page.color; }),
+              1);
+    EXPECT_TRUE(structure.pages[1500].color);
+
+    // xref inválida: objetos achados pela varredura do arquivo
+    std::string broken = builder.build(1);
+    broken.replace(broken.rfind("startxref\n") + 10, 1, "9");
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << broken;
+    ASSERT_TRUE(read_pdf_structure(path, structure, &error)) << error;
+    EXPECT_TRUE(structure.repaired);
+    EXPECT_EQ(structure.page_count, 2000);
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a pdf";
+    EXPECT_FALSE(read_pdf_structure(path, structure, &error));
+    EXPECT_FALSE(error.empty());
+}
+
+TEST_F(FileProcessorTest, ReadsPdfXrefStreamAndObjectStreams) {
+    // Catálogo e páginas dentro de um object stream, listados por um xref
+    // stream (PDF 1.5+); página monocromática
+    const std::string objects =
+        "<< /Type /Catalog /Pages 2 0 R >>\n"
+        "<< /Type /Pages /Count 2 /Kids [3 0 R 3 0 R] >>\n"
+        "<< /Type /Page /MediaBox [0 0 1224 792] /UserUnit 2 /Resources << /ColorSpace << /C /DeviceGray >> >> >>\n";
+    const size_t second = objects.find('\n') + 1;
+    const size_t third = objects.find('\n', second) + 1;
+    const std::string header = "1 0 2 " + std::to_string(second) + " 3 " + std::to_string(third) + " ";
+    std::string pdf = "%PDF-1.5\n";
+    const size_t objstm_offset = pdf.size();
+    pdf += "4 0 obj\n<< /Type /ObjStm /N 3 /First " + std::to_string(header.size()) + " /Length " +
+           std::to_string(header.size() + objects.size()) + " >>\nstream\n" + header + objects + "\nendstream\nendobj\n";
+
+    // W [1 4 2]: tipo, offset ou stream, geração ou índice
+    auto row = [](int type, uint32_t field1, uint16_t field2) {
+        std::string bytes(7, '\0');
+        bytes[0] = static_cast<char>(type);
+        for (int i = 0; i < 4; ++i) bytes[1 + i] = static_cast<char>(field1 >> (24 - 8 * i));
+        bytes[5] = static_cast<char>(field2 >> 8);
+        bytes[6] = static_cast<char>(field2);
+        return bytes;
+    };
+    const size_t xref_offset = pdf.size();
+    const std::string rows = row(0, 0, 0xffff) + row(2, 4, 0) + row(2, 4, 1) + row(2, 4, 2) +
+                             row(1, static_cast<uint32_t>(objstm_offset), 0) +
+                             row(1, static_cast<uint32_t>(xref_offset), 0);
+    pdf += "5 0 obj\n<< /Type /XRef /Size 6 /W [1 4 2] /Root 1 0 R /Length " + std::to_string(rows.size()) +
+           " >>\nstream\n" + rows + "\nendstream\nendobj\nstartxref\n" + std::to_string(xref_offset) + "\n%%EOF\n";
+    const std::string path = (test_dir / "compressed.pdf").string();
+    std::ofstream(path, std::ios::binary) << pdf;
+
+    PdfStructure structure;
+    std::string error;
+    ASSERT_TRUE(read_pdf_structure(path, structure, &error)) << error;
+    EXPECT_EQ(structure.version, "1.5");
+    // A mesma página listada duas vezes conta uma vez
+    ASSERT_EQ(structure.page_count, 1);
+    EXPECT_DOUBLE_EQ(structure.pages[0].width_pt, 2448.0);
+    EXPECT_DOUBLE_EQ(structure.pages[0].height_pt, 1584.0);
+    EXPECT_FALSE(structure.uses_color);
+    ASSERT_EQ(structure.color_spaces.size(), 1u);
+    EXPECT_EQ(structure.color_spaces[0], "DeviceGray");
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
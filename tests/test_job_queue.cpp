@@ -1,7 +1,14 @@
 #include <gtest/gtest.h>
 #include "core/job_queue.h"
+#include "conversion/conversion_cache.h"
+#include "utils/config.h"
 #include <thread>
 #include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <unistd.h>
 
 using namespace AllPress;
 
@@ -96,6 +103,314 @@ TEST_F(JobQueueTest, GetsPrinterStatistics) {
     EXPECT_TRUE(retrieved.has_value());
 }
 
+// Spooler falso: todo destino é um plotter HP e a saída raw fica em memória
+class FakePlotterManager : public PrinterManager {
+public:
+    std::string model = "DesignJet T3500";
+    std::string protocol = "PDF";
+    // Bytes aceitos antes de o envio falhar (uma vez)
+    uint64_t fail_after = std::numeric_limits<uint64_t>::max();
+    
+    std::mutex mutex;
+    std::vector<uint8_t> received;  // Último envio: prefixo + arquivo
+    uint64_t received_offset = 0;
+    int submissions = 0;
+    std::optional<double> plot_seconds;  // Duração informada pelo spooler
+    
+    bool is_plotter(const std::string&) override { return true; }
+    
+    PrinterAdvancedInfo get_plotter_info(const std::string& printer) override {
+        PrinterAdvancedInfo info;
+        info.base_info.name = printer;
+        info.base_info.make_model = model;
+        info.vendor = all_press::protocols::PlotterVendor::HP;
+        return info;
+    }
+    
+    std::string select_best_protocol(const std::string&, const PrintOptions&) override {
+        return protocol;
+    }
+    
+    int submit_raw_job(const std::string&, const std::string& file_path, uint64_t offset,
+                       const std::vector<uint8_t>& prefix, const PrintOptions&,
+                       const std::function<bool(uint64_t)>& progress) override {
+        std::ifstream in(file_path, std::ios::binary);
+        in.seekg(static_cast<std::streamoff>(offset));
+        std::vector<uint8_t> data(prefix);
+        data.insert(data.end(), std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        ++submissions;
+        received_offset = offset;
+        received.assign(data.begin(), data.begin() + static_cast<std::ptrdiff_t>(prefix.size()));
+        uint64_t accepted = offset;
+        for (size_t pos = prefix.size(); pos < data.size(); pos += 4096) {
+            const size_t end = std::min(data.size(), pos + 4096);
+            if (accepted - offset + (end - pos) > fail_after) {
+                fail_after = std::numeric_limits<uint64_t>::max();
+                return -1;
+            }
+            received.insert(received.end(), data.begin() + static_cast<std::ptrdiff_t>(pos),
+                            data.begin() + static_cast<std::ptrdiff_t>(end));
+            accepted += end - pos;
+            if (!progress(accepted)) {
+                return -1;
+            }
+        }
+        return 100 + submissions;
+    }
+    
+    std::optional<double> get_job_plot_seconds(int) override {
+        std::lock_guard<std::mutex> lock(mutex);
+        return plot_seconds;
+    }
+};
+
+class PlotterQueueTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        dir = std::filesystem::temp_directory_path() /
+              ("all_press_jq_" + std::to_string(::getpid()) + "_" +
+               ::testing::UnitTest::GetInstance()->current_test_info()->name());
+        std::filesystem::create_directories(dir);
+        queue = std::make_unique<JobQueue>(1);
+        queue->set_printer_manager(&manager);
+    }
+    
+    void TearDown() override {
+        queue.reset();
+        Utils::Config::instance().set_bool("plotter.nesting", false);
+        Utils::Config::instance().set_double("plotter.calibration_poll_s", 30.0);
+        std::filesystem::remove_all(dir);
+    }
+    
+    std::string write_file(const std::string& name, const std::string& content) {
+        const std::string path = (dir / name).string();
+        std::ofstream(path, std::ios::binary) << content;
+        return path;
+    }
+    
+    // PGM de uma página, branco com uma faixa de tinta no topo; gray > 0
+    // pinta a página toda com esse cinza (meio-tom que quase não comprime)
+    static std::string pgm(int width, int height, int gray = 0) {
+        std::string data = "P5\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+        for (int y = 0; y < height; ++y) {
+            const char value = gray > 0 ? static_cast<char>(gray) : (y < height / 4 ? '\0' : '\xff');
+            data.append(static_cast<size_t>(width), value);
+        }
+        return data;
+    }
+    
+    int submit(const std::string& path, int quality = 3) {
+        PrintJob job;
+        job.options.quality = quality;
+        job.printer_name = "plotter";
+        job.file_path = path;
+        job.original_filename = std::filesystem::path(path).filename().string();
+        return queue->add_job(job);
+    }
+    
+    // Espera o job sair de Pending/Processing/Printing
+    PrintJob wait_for(int job_id) {
+        for (int i = 0; i < 1000; ++i) {
+            auto job = queue->get_job(job_id);
+            if (job && (job->status == JobStatus::Completed || job->status == JobStatus::Failed ||
+                        job->status == JobStatus::Cancelled)) {
+                return *job;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        ADD_FAILURE() << "job " << job_id << " did not finish";
+        return queue->get_job(job_id).value_or(PrintJob{});
+    }
+    
+    std::filesystem::path dir;
+    FakePlotterManager manager;
+    std::unique_ptr<JobQueue> queue;
+};
+
+TEST_F(PlotterQueueTest, StreamsPdfInPassthroughToSpooler) {
+    const std::string pdf = "%PDF-1.4\n1 0 obj << /Type /Catalog >> endobj\ntrailer << /Root 1 0 R >>\n%%EOF\n";
+    const int job_id = submit(write_file("drawing.pdf", pdf));
+    queue->start();
+    
+    const PrintJob job = wait_for(job_id);
+    ASSERT_EQ(job.status, JobStatus::Completed) << job.error_message;
+    EXPECT_GT(job.cups_job_id, 0);
+    
+    std::lock_guard<std::mutex> lock(manager.mutex);
+    EXPECT_EQ(manager.submissions, 1);
+    const std::string sent(manager.received.begin(), manager.received.end());
+    EXPECT_NE(sent.find(pdf), std::string::npos);
+    EXPECT_EQ(job.bytes_acknowledged, manager.received.size());
+}
+
+TEST_F(PlotterQueueTest, FailsWhenSpoolerRejectsOutput) {
+    manager.fail_after = 0;
+    const int job_id = submit(write_file("drawing.pdf", "%PDF-1.4\n%%EOF\n"));
+    queue->start();
+    
+    const PrintJob job = wait_for(job_id);
+    EXPECT_EQ(job.status, JobStatus::Failed);
+}
+
+TEST_F(PlotterQueueTest, ReprintReusesCachedEncodedOutput) {
+    ConversionCache& cache = ConversionCache::instance();
+    if (!cache.enabled()) {
+        GTEST_SKIP() << "conversion cache disabled";
+    }
+    // Conteúdo único por execução: o cache do processo fica em disco
+    const std::string pdf = "%PDF-1.4\n% " + std::to_string(::getpid()) + "-" +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + "\n%%EOF\n";
+    queue->start();
+    
+    const size_t hits = cache.stats().hits;
+    ASSERT_EQ(wait_for(submit(write_file("a.pdf", pdf))).status, JobStatus::Completed);
+    std::vector<uint8_t> first_output;
+    {
+        std::lock_guard<std::mutex> lock(manager.mutex);
+        first_output = manager.received;
+    }
+    EXPECT_EQ(cache.stats().hits, hits);
+    
+    // Mesmo conteúdo em outro arquivo: saída vem do cache, idêntica
+    ASSERT_EQ(wait_for(submit(write_file("b.pdf", pdf))).status, JobStatus::Completed);
+    EXPECT_EQ(cache.stats().hits, hits + 1);
+    {
+        std::lock_guard<std::mutex> lock(manager.mutex);
+        EXPECT_EQ(manager.received, first_output);
+    }
+    
+    // Outro modelo (outros quirks) não reaproveita a saída
+    manager.model = "DesignJet T2300";
+    ASSERT_EQ(wait_for(submit(write_file("c.pdf", pdf))).status, JobStatus::Completed);
+    EXPECT_EQ(cache.stats().hits, hits + 1);
+}
+
+TEST_F(PlotterQueueTest, TrimsBlankRollPagesBeforeSubmitting) {
+    manager.protocol = "HPGL2";
+    // Página em branco e página com tinta só no primeiro quarto
+    const std::string blank = "P5\n200 400\n255\n" + std::string(200 * 400, '\xff');
+    const int job_id = submit(write_file("sheets.pgm", blank + pgm(200, 2000)));
+    queue->start();
+    
+    const PrintJob job = wait_for(job_id);
+    ASSERT_EQ(job.status, JobStatus::Completed) << job.error_message;
+    EXPECT_EQ(job.blank_pages_skipped, 1);
+    EXPECT_GT(job.media_saved_mm, 0.0);
+    EXPECT_GT(job.plot_time_saved_s, 0.0);
+    
+    std::lock_guard<std::mutex> lock(manager.mutex);
+    EXPECT_EQ(job.bytes_acknowledged, manager.received.size());
+}
+
+TEST_F(PlotterQueueTest, DownsamplesImageLargerThanMedia) {
+    manager.protocol = "HPGL2";
+    // A4 a 300 dpi tem 3508 pixels no lado maior
+    const int job_id = submit(write_file("wide.pgm", pgm(5000, 300)), 1);
+    queue->start();
+    
+    const PrintJob job = wait_for(job_id);
+    ASSERT_EQ(job.status, JobStatus::Completed) << job.error_message;
+    
+    std::lock_guard<std::mutex> lock(manager.mutex);
+    const std::string sent(manager.received.begin(), manager.received.end());
+    const size_t width_at = sent.find("\x1B*r");
+    ASSERT_NE(width_at, std::string::npos);
+    const int width = std::stoi(sent.substr(width_at + 3));
+    EXPECT_LE(width, 3508);
+    EXPECT_GT(width, 3000);
+}
+
+TEST_F(PlotterQueueTest, CalibratesFromSpoolerPlotTime) {
+    Utils::Config::instance().set_double("plotter.calibration_poll_s", 0.01);
+    manager.protocol = "HPGL2";
+    const int job_id = submit(write_file("sheet.pgm", pgm(200, 400)));
+    queue->start();
+    
+    PrintJob job = wait_for(job_id);
+    ASSERT_EQ(job.status, JobStatus::Completed) << job.error_message;
+    EXPECT_GT(job.plot_model_s, 0.0);
+    EXPECT_EQ(job.actual_plot_s, 0.0);
+    
+    // Dispositivo termina depois do envio; o worker busca a duração
+    {
+        std::lock_guard<std::mutex> lock(manager.mutex);
+        manager.plot_seconds = 42.0;
+    }
+    for (int i = 0; i < 500 && job.actual_plot_s == 0.0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        job = queue->get_job(job_id).value();
+    }
+    EXPECT_DOUBLE_EQ(job.actual_plot_s, 42.0);
+}
+
+TEST_F(PlotterQueueTest, RetryResumesFromLastConfirmedBand) {
+    // DesignJet T3500 retoma o raster RTL por faixa
+    manager.protocol = "HPGL2";
+    manager.fail_after = 30000;
+    const std::string path = write_file("tall.pgm", pgm(400, 1200, 128));
+    const int job_id = submit(path);
+    queue->start();
+    
+    const PrintJob failed = wait_for(job_id);
+    ASSERT_EQ(failed.status, JobStatus::Failed);
+    EXPECT_GT(failed.bytes_acknowledged, 0u);
+    EXPECT_LE(failed.bytes_acknowledged, 30000u);
+    ASSERT_TRUE(std::filesystem::exists(path + ".converted.bands"));
+    const uint64_t output_size = std::filesystem::file_size(path + ".converted");
+    
+    ASSERT_TRUE(queue->retry_job(job_id));
+    const PrintJob job = wait_for(job_id);
+    ASSERT_EQ(job.status, JobStatus::Completed) << job.error_message;
+    
+    // Recomeça no início da última faixa confirmada, com o raster reaberto
+    EXPECT_GT(job.bytes_resumed, 0u);
+    EXPECT_LE(job.bytes_resumed, failed.bytes_acknowledged);
+    EXPECT_EQ(job.bytes_acknowledged, output_size);
+    std::lock_guard<std::mutex> lock(manager.mutex);
+    EXPECT_EQ(manager.submissions, 2);
+    EXPECT_EQ(manager.received_offset, job.bytes_resumed);
+    const std::string sent(manager.received.begin(), manager.received.end());
+    EXPECT_NE(sent.find("\x1B*r1A"), std::string::npos);
+    EXPECT_LT(manager.received.size(), output_size);
+    EXPECT_FALSE(std::filesystem::exists(path + ".converted.bands"));
+}
+
+TEST_F(PlotterQueueTest, SubmitsNestedRollAsOneSpoolerJob) {
+    Utils::Config::instance().set_bool("plotter.nesting", true);
+    manager.protocol = "HPGL2";
+    const int first = submit(write_file("a.pgm", pgm(120, 80)));
+    const int second = submit(write_file("b.pgm", pgm(90, 60)));
+    queue->start();
+    
+    const PrintJob a = wait_for(first);
+    const PrintJob b = wait_for(second);
+    ASSERT_EQ(a.status, JobStatus::Completed) << a.error_message;
+    ASSERT_EQ(b.status, JobStatus::Completed) << b.error_message;
+    EXPECT_EQ(a.nest_id, first);
+    EXPECT_EQ(b.nest_id, first);
+    EXPECT_GT(a.cups_job_id, 0);
+    EXPECT_EQ(a.cups_job_id, b.cups_job_id);
+    
+    std::lock_guard<std::mutex> lock(manager.mutex);
+    EXPECT_EQ(manager.submissions, 1);
+    EXPECT_FALSE(manager.received.empty());
+    EXPECT_FALSE(std::filesystem::exists(dir / "a.pgm.nest.converted"));
+}
+
+TEST_F(PlotterQueueTest, FailsNestedJobsWhenSpoolerRejectsRoll) {
+    Utils::Config::instance().set_bool("plotter.nesting", true);
+    manager.protocol = "HPGL2";
+    manager.fail_after = 0;
+    const int first = submit(write_file("a.pgm", pgm(120, 80)));
+    const int second = submit(write_file("b.pgm", pgm(90, 60)));
+    queue->start();
+    
+    EXPECT_EQ(wait_for(first).status, JobStatus::Failed);
+    EXPECT_EQ(wait_for(second).status, JobStatus::Failed);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
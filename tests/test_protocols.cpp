@@ -0,0 +1,990 @@
+#include <gtest/gtest.h>
+#include "protocols/protocol_factory.h"
+#include "protocols/encoder_kernels.h"
+#include "protocols/protocol_pool.h"
+#include "protocols/plot_time.h"
+#include "protocols/dxf_reader.h"
+#include "protocols/hpgl_interpreter.h"
+#include "protocols/svg_reader.h"
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+using namespace all_press::protocols;
+
+class ProtocolsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        test_dir = fs::temp_directory_path() / "all_press_protocols_test";
+        fs::create_directories(test_dir);
+    }
+
+    void TearDown() override {
+        if (fs::exists(test_dir)) {
+            fs::remove_all(test_dir);
+        }
+    }
+
+    fs::path test_dir;
+};
+
+// PDF é listado na matriz de compatibilidade e deve ter um handler
+TEST_F(ProtocolsTest, FactoryCreatesPDFHandler) {
+    auto protocol = PlotterProtocolFactory::create_protocol("PDF", PlotterVendor::HP);
+    ASSERT_NE(protocol, nullptr);
+    EXPECT_EQ(protocol->get_protocol_name(), "PDF");
+    EXPECT_TRUE(protocol->supports_passthrough());
+    EXPECT_FALSE(protocol->needs_preprocessing());
+}
+
+TEST_F(ProtocolsTest, PDFHeaderCarriesJobTicket) {
+    PDFPassthroughGenerator generator(PlotterVendor::CANON);
+    generator.set_job_ticket_attribute("copies", "2");
+
+    auto header = generator.generate_header(
+        generator.get_capabilities(), MediaSize::A1, ColorMode::MONOCHROME, 600);
+    std::string text(header.begin(), header.end());
+
+    EXPECT_EQ(text.rfind("\x1B%-12345X@PJL", 0), 0u);
+    EXPECT_NE(text.find("@PJL SET PAPER=A1\r\n"), std::string::npos);
+    EXPECT_NE(text.find("@PJL SET RENDERMODE=GRAYSCALE\r\n"), std::string::npos);
+    EXPECT_NE(text.find("@PJL SET COPIES=2\r\n"), std::string::npos);
+    EXPECT_NE(text.find("@PJL ENTER LANGUAGE=PDF\r\n"), std::string::npos);
+}
+
+TEST_F(ProtocolsTest, PDFWithoutPJLIsUntouched) {
+    PDFPassthroughGenerator generator(PlotterVendor::GENERIC, false);
+    std::vector<uint8_t> document = {'%', 'P', 'D', 'F', '-', '1', '.', '7'};
+
+    EXPECT_TRUE(generator.generate_header(
+        generator.get_capabilities(), MediaSize::A4, ColorMode::COLOR, 300).empty());
+    EXPECT_EQ(generator.generate_page(document, 0, 0, 300), document);
+    EXPECT_TRUE(generator.generate_footer().empty());
+}
+
+TEST_F(ProtocolsTest, StreamsFileUnchanged) {
+    auto input = test_dir / "input.pdf";
+    auto output = test_dir / "output.prn";
+
+    std::string content = "%PDF-1.7\n";
+    for (int i = 0; i < 100000; ++i) {
+        content += static_cast<char>(i % 251);
+    }
+    std::ofstream(input, std::ios::binary) << content;
+
+    int fd = ::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    uint64_t sent = PDFPassthroughGenerator::stream_file(input.string(), fd);
+    ::close(fd);
+
+    EXPECT_EQ(sent, content.size());
+    std::ifstream in(output, std::ios::binary);
+    std::string copied((std::istreambuf_iterator<char>(in)),
+                       std::istreambuf_iterator<char>());
+    EXPECT_EQ(copied, content);
+}
+
+TEST_F(ProtocolsTest, StreamsToNonBlockingPipe) {
+    auto input = test_dir / "large.pdf";
+    std::string content = "%PDF-1.7\n";
+    for (int i = 0; i < 1 << 20; ++i) {
+        content += static_cast<char>(i % 253);
+    }
+    std::ofstream(input, std::ios::binary) << content;
+
+    // Pipe bem menor que o arquivo: o envio bate em EAGAIN e espera o leitor
+    int fds[2];
+    ASSERT_EQ(::pipe(fds), 0);
+    ::fcntl(fds[1], F_SETFL, ::fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    std::string copied;
+    std::thread reader([&] {
+        char buffer[4096];
+        ssize_t n;
+        while ((n = ::read(fds[0], buffer, sizeof(buffer))) > 0) {
+            copied.append(buffer, static_cast<size_t>(n));
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    });
+    uint64_t sent = 0;
+    EXPECT_NO_THROW(sent = PDFPassthroughGenerator::stream_file(input.string(), fds[1]));
+    ::close(fds[1]);
+    reader.join();
+    ::close(fds[0]);
+
+    EXPECT_EQ(sent, content.size());
+    EXPECT_EQ(copied, content);
+}
+
+TEST_F(ProtocolsTest, StreamMissingFileThrows) {
+    EXPECT_THROW(PDFPassthroughGenerator::stream_file(
+        (test_dir / "missing.pdf").string(), STDOUT_FILENO), std::runtime_error);
+}
+
+TEST_F(ProtocolsTest, PassthroughRejectsNonPDF) {
+    auto input = test_dir / "photo.pdf";
+    std::ofstream(input, std::ios::binary) << "P5\n2 2\n255\n\x01\x02\x03\x04";
+    int fd = ::open((test_dir / "output.prn").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT_GE(fd, 0);
+    EXPECT_THROW(PDFPassthroughGenerator::stream_file(input.string(), fd), std::runtime_error);
+    ::close(fd);
+    EXPECT_EQ(std::filesystem::file_size(test_dir / "output.prn"), 0u);
+
+    PDFPassthroughGenerator generator(PlotterVendor::GENERIC, false);
+    std::vector<uint8_t> gray(64, 0x80);
+    EXPECT_THROW(generator.generate_page(gray, 8, 8, 300), std::invalid_argument);
+}
+
+TEST_F(ProtocolsTest, HPGLPolylineEncodingDigits) {
+    HPGLGenerator generator(true);
+    generator.set_polyline_encoding(true);
+
+    Polyline stroke;
+    stroke.pen = 1;
+    stroke.points = {{0, 0}, {1, -1}, {101, 99}};
+    auto data = generator.generate_vector_page({stroke});
+
+    // PE <= 0 0 :1 < 0 0  1 -1  100 100 ;
+    std::string expected = "PE<=";
+    expected += static_cast<char>(191);  // 0
+    expected += static_cast<char>(191);
+    expected += ':';
+    expected += static_cast<char>(193);  // pen 1 -> 2
+    expected += '<';
+    expected += static_cast<char>(191);
+    expected += static_cast<char>(191);
+    expected += static_cast<char>(193);  // +1 -> 2
+    expected += static_cast<char>(194);  // -1 -> 3
+    expected += static_cast<char>(63 + 8);   // +100 -> 200 = 8 + 3*64
+    expected += static_cast<char>(191 + 3);
+    expected += static_cast<char>(63 + 8);
+    expected += static_cast<char>(191 + 3);
+    expected += ';';
+
+    EXPECT_EQ(std::string(data.begin(), data.end()), expected);
+}
+
+TEST_F(ProtocolsTest, HPGLPolylineEncodingIsCompact) {
+    HPGLGenerator ascii(true);
+    HPGLGenerator encoded(true);
+    encoded.set_polyline_encoding(true);
+
+    // Folha CAD densa: muitos segmentos curtos longe da origem
+    std::vector<Polyline> strokes;
+    for (int row = 0; row < 200; ++row) {
+        Polyline stroke;
+        for (int i = 0; i < 50; ++i) {
+            stroke.points.push_back({20000.0 + i * 12, 15000.0 + row * 40 + (i % 3)});
+        }
+        strokes.push_back(stroke);
+    }
+
+    auto ascii_size = ascii.generate_vector_page(strokes).size();
+    auto encoded_size = encoded.generate_vector_page(strokes).size();
+    EXPECT_GT(ascii_size, encoded_size * 3);
+}
+
+TEST_F(ProtocolsTest, FactoryAppliesModelQuirks) {
+    auto protocol = PlotterProtocolFactory::create_for_printer(
+        PlotterVendor::HP, "DesignJet_T2300");
+    auto* hpgl = dynamic_cast<HPGLGenerator*>(protocol.get());
+    ASSERT_NE(hpgl, nullptr);
+    EXPECT_TRUE(hpgl->polyline_encoding_enabled());
+
+    auto plain = PlotterProtocolFactory::create_for_printer(
+        PlotterVendor::HP, "DesignJet_T1200");
+    auto* plain_hpgl = dynamic_cast<HPGLGenerator*>(plain.get());
+    ASSERT_NE(plain_hpgl, nullptr);
+    EXPECT_FALSE(plain_hpgl->polyline_encoding_enabled());
+}
+
+TEST_F(ProtocolsTest, StrokeOptimizerReducesPenUpTravel) {
+    // Traços horizontais intercalados entre duas regiões distantes
+    std::vector<Polyline> strokes;
+    for (int i = 0; i < 500; ++i) {
+        double base_x = (i % 2 == 0) ? 0.0 : 40000.0;
+        double y = (i / 2) * 40.0;
+        Polyline stroke;
+        stroke.points = {{base_x, y}, {base_x + 400.0, y}};
+        strokes.push_back(stroke);
+    }
+    double pen_down = StrokeOptimizer::pen_down_distance(strokes);
+
+    StrokeOptimizer optimizer;
+    auto report = optimizer.optimize(strokes);
+
+    EXPECT_LT(report.pen_up_mm_after, report.pen_up_mm_before / 10.0);
+    EXPECT_LT(report.estimated_seconds_after, report.estimated_seconds_before);
+    EXPECT_NEAR(StrokeOptimizer::pen_down_distance(strokes), pen_down, 1e-6);
+    EXPECT_EQ(report.strokes_after, 500u);
+    EXPECT_FALSE(report.time_budget_exhausted);
+}
+
+TEST_F(ProtocolsTest, StrokeOptimizerMergesContiguousAndCollinear) {
+    Polyline a;
+    a.points = {{0, 0}, {100, 0}, {100, 0}, {200, 0}};  // colinear + repetido
+    Polyline b;
+    b.points = {{300, 0}, {200, 0}};                    // contíguo, invertido
+    Polyline c;
+    c.points = {{300, 0}, {300, 100}};
+    std::vector<Polyline> strokes = {c, a, b};
+
+    StrokeOptimizer optimizer;
+    auto report = optimizer.optimize(strokes);
+
+    ASSERT_EQ(strokes.size(), 1u);
+    ASSERT_EQ(strokes[0].points.size(), 3u);
+    EXPECT_DOUBLE_EQ(strokes[0].points[0].x, 0.0);
+    EXPECT_DOUBLE_EQ(strokes[0].points[1].x, 300.0);
+    EXPECT_DOUBLE_EQ(strokes[0].points[2].y, 100.0);
+    EXPECT_EQ(report.segments_before, 5u);
+    EXPECT_EQ(report.segments_after, 2u);
+    EXPECT_DOUBLE_EQ(report.pen_up_mm_after, 0.0);
+}
+
+TEST_F(ProtocolsTest, StrokeOptimizerKeepsDots) {
+    Polyline dot;
+    dot.points = {{500, 500}, {500, 500}, {500, 500}};
+    Polyline line;
+    line.points = {{0, 0}, {100, 0}};
+    std::vector<Polyline> strokes = {line, dot};
+
+    StrokeOptimizer optimizer;
+    optimizer.optimize(strokes);
+
+    ASSERT_EQ(strokes.size(), 2u);
+    const auto& kept = strokes[0].points.front().x == 500 ? strokes[0] : strokes[1];
+    ASSERT_EQ(kept.points.size(), 2u);
+    EXPECT_DOUBLE_EQ(kept.points[1].x, 500.0);
+    EXPECT_DOUBLE_EQ(kept.points[1].y, 500.0);
+}
+
+TEST_F(ProtocolsTest, StrokeOptimizerKeepsPenGroupsAndDirection) {
+    Polyline p1;
+    p1.pen = 1;
+    p1.points = {{1000, 0}, {0, 0}};
+    Polyline p2;
+    p2.pen = 2;
+    p2.points = {{0, 10}, {1000, 10}};
+    std::vector<Polyline> strokes = {p1, p2};
+
+    StrokeOptimizerOptions options;
+    options.allow_reversal = false;
+    StrokeOptimizer optimizer(options);
+    optimizer.optimize(strokes);
+
+    ASSERT_EQ(strokes.size(), 2u);
+    EXPECT_EQ(strokes[0].pen, 1);
+    EXPECT_DOUBLE_EQ(strokes[0].points[0].x, 1000.0);
+    EXPECT_EQ(strokes[1].pen, 2);
+}
+
+namespace {
+
+std::vector<uint8_t> packbits_decode(const uint8_t* data, size_t size) {
+    std::vector<uint8_t> out;
+    size_t i = 0;
+    while (i < size) {
+        uint8_t n = data[i++];
+        if (n < 128) {
+            out.insert(out.end(), data + i, data + i + n + 1);
+            i += n + 1;
+        } else if (n > 128) {
+            out.insert(out.end(), 257 - n, data[i++]);
+        }
+    }
+    return out;
+}
+
+}  // namespace
+
+TEST_F(ProtocolsTest, PackBitsRoundTrip) {
+    std::vector<uint8_t> row;
+    for (int i = 0; i < 300; ++i) row.push_back(0xAA);            // repetição longa
+    for (int i = 0; i < 200; ++i) row.push_back(static_cast<uint8_t>(i * 7));
+    row.push_back(1); row.push_back(1); row.push_back(2);
+
+    std::vector<uint8_t> encoded(packbits_bound(row.size()));
+    size_t n = packbits_encode(row.data(), row.size(), encoded.data());
+
+    EXPECT_LT(n, row.size());
+    EXPECT_EQ(packbits_decode(encoded.data(), n), row);
+}
+
+TEST_F(ProtocolsTest, HPGLRasterPageEmitsPackedRTLRows) {
+    const int width = 20;
+    const int height = 2;
+    std::vector<uint8_t> gray(width * height, 0xFF);  // linha 0 em branco
+    for (int x = 0; x < 10; ++x) {
+        gray[width + x] = 0;                           // linha 1: 10 pixels pretos
+    }
+
+    HPGLGenerator generator;
+    auto page = generator.generate_page(gray, width, height, 300);
+    std::string text(page.begin(), page.end());
+
+    EXPECT_NE(text.find("\x1B*b2M"), std::string::npos);
+    EXPECT_NE(text.find("\x1B*r1A"), std::string::npos);
+    EXPECT_NE(text.find("\x1B*b0W"), std::string::npos);
+    EXPECT_NE(text.find("\x1B*rC"), std::string::npos);
+
+    // Linha 1: 3 bytes (FF C0 00) com bit 1 = tinta
+    size_t pos = text.find("\x1B*b", text.find("\x1B*b0W") + 1);
+    ASSERT_NE(pos, std::string::npos);
+    size_t w = text.find('W', pos);
+    size_t len = std::stoul(text.substr(pos + 3, w - pos - 3));
+    auto row = packbits_decode(page.data() + w + 1, len);
+    EXPECT_EQ(row, (std::vector<uint8_t>{0xFF, 0xC0, 0x00}));
+}
+
+// Linhas de um fluxo RTL a partir de pos: ESC*b#W decodificado, ESC*b#Y
+// como linhas em branco; para em ESC*rC
+static std::vector<std::vector<uint8_t>> decode_rtl_rows(const std::vector<uint8_t>& data,
+                                                         size_t pos, size_t row_bytes) {
+    std::vector<std::vector<uint8_t>> rows;
+    while (pos < data.size()) {
+        if (data[pos] != 0x1B) {
+            ++pos;
+            continue;
+        }
+        size_t end = pos + 1;
+        while (end < data.size() && !(data[end] >= 'A' && data[end] <= 'Z')) ++end;
+        std::string command(data.begin() + pos + 1, data.begin() + end + 1);
+        pos = end + 1;
+        if (command == "*rC") {
+            break;
+        }
+        if (command.rfind("*b", 0) == 0 && (command.back() == 'W' || command.back() == 'Y')) {
+            const size_t n = std::stoul(command.substr(2));
+            if (command.back() == 'Y') {
+                rows.insert(rows.end(), n, std::vector<uint8_t>(row_bytes, 0));
+            } else {
+                auto row = packbits_decode(data.data() + pos, n);
+                row.resize(row_bytes, 0);
+                rows.push_back(row);
+                pos += n;
+            }
+        }
+    }
+    return rows;
+}
+
+TEST_F(ProtocolsTest, HPGLRasterBandsResumeMidPage) {
+    const int width = 40;
+    const int height = 100;
+    std::vector<uint8_t> gray(width * height, 0xFF);
+    for (int y = 0; y < height; ++y) {
+        if (y % 7 == 0 || (y >= 14 && y < 40)) continue;     // trechos em branco cruzando faixas
+        for (int x = y % 13; x < width; x += 3) gray[y * width + x] = 0;
+    }
+    all_press::raster::TiledRasterOptions options;
+    options.tile_size = 16;
+    auto page = all_press::raster::TiledRaster::from_buffer(
+        gray.data(), width, height, all_press::raster::PixelFormat::GRAY8, options);
+
+    HPGLGenerator generator;
+    std::vector<BandCheckpoint> bands;
+    auto stream = generator.generate_raster_page(page, 300, bands);
+    EXPECT_EQ(stream, generator.generate_raster_page(page, 300));
+
+    // O salto de 14 a 39 cobre duas fronteiras: um ponto só, no início dele;
+    // a faixa 64 começa no salto da linha 63
+    const std::vector<int> expected_rows = {0, 14, 48, 63, 80, 96};
+    ASSERT_EQ(bands.size(), expected_rows.size());
+    for (size_t i = 0; i < bands.size(); ++i) {
+        EXPECT_EQ(bands[i].row, expected_rows[i]);
+        EXPECT_EQ(bands[i].page_height, height);
+        if (i > 0) {
+            EXPECT_GT(bands[i].offset, bands[i - 1].offset);
+            EXPECT_EQ(stream[bands[i].offset], 0x1B);   // Faixa começa num comando
+        }
+    }
+
+    const size_t row_bytes = (width + 7) / 8;
+    auto all_rows = decode_rtl_rows(stream, 0, row_bytes);
+    ASSERT_EQ(all_rows.size(), static_cast<size_t>(height));
+
+    // Prefixo + bytes a partir de uma faixa reproduzem o resto da página;
+    // o prefixo sempre reenvia o header do job (dispositivo reiniciado)
+    PlotterCapabilities caps;
+    const auto header = generator.generate_header(caps, MediaSize::A1, ColorMode::MONOCHROME, 300);
+    for (size_t i : {size_t(1), size_t(3), size_t(5)}) {
+        auto resumed = generator.generate_resume_prefix(header, bands[i], 300);
+        ASSERT_GE(resumed.size(), header.size());
+        EXPECT_TRUE(std::equal(header.begin(), header.end(), resumed.begin()));
+        std::string prefix(resumed.begin() + header.size(), resumed.end());
+        EXPECT_EQ(prefix.rfind("\x1B%0A", 0), 0u);
+        EXPECT_NE(prefix.find("\x1B*r" + std::to_string(height - bands[i].row) + "T"),
+                  std::string::npos);
+        resumed.insert(resumed.end(), stream.begin() + bands[i].offset, stream.end());
+        auto rows = decode_rtl_rows(resumed, 0, row_bytes);
+        ASSERT_EQ(rows.size(), static_cast<size_t>(height - bands[i].row));
+        EXPECT_TRUE(std::equal(rows.begin(), rows.end(), all_rows.begin() + bands[i].row));
+    }
+    EXPECT_EQ(generator.generate_resume_prefix(header, bands[0], 300), header);
+
+    // Retomada é por modelo
+    EXPECT_FALSE(generator.supports_band_resume());
+    auto t3500 = PlotterProtocolFactory::create_for_printer(PlotterVendor::HP, "DesignJet_T3500");
+    EXPECT_TRUE(t3500->supports_band_resume());
+}
+
+TEST_F(ProtocolsTest, PostScriptRasterPageUsesRunLengthDecode) {
+    const int width = 64;
+    const int height = 4;
+    std::vector<uint8_t> rgb(width * height * 3, 0x40);
+
+    PostScriptGenerator generator(PlotterVendor::CANON);
+    PlotterCapabilities caps;
+    generator.generate_header(caps, MediaSize::A4, ColorMode::COLOR, 300);
+    auto page = generator.generate_page(rgb, width, height, 300);
+    std::string text(page.begin(), page.end());
+
+    EXPECT_NE(text.find("/RunLengthDecode filter"), std::string::npos);
+    EXPECT_NE(text.find("/DeviceRGB"), std::string::npos);
+    EXPECT_EQ(text.find("DCTDecode"), std::string::npos);
+
+    size_t data_start = text.find(">> image\n") + 9;
+    ASSERT_GE(page.size(), data_start + 2);
+    EXPECT_EQ(page[page.size() - 2], 128);  // EOD
+    auto decoded = packbits_decode(page.data() + data_start, page.size() - 2 - data_start);
+    EXPECT_EQ(decoded, rgb);
+}
+
+TEST_F(ProtocolsTest, PostScriptKeepsCompressedPagesAsIs) {
+    std::vector<uint8_t> jpeg = {0xFF, 0xD8, 0xFF, 0xE0, 0x00};
+    PostScriptGenerator generator(PlotterVendor::EPSON);
+    auto page = generator.generate_page(jpeg, 100, 100, 300);
+    std::string text(page.begin(), page.end());
+    EXPECT_NE(text.find("DCTDecode"), std::string::npos);
+}
+
+TEST_F(ProtocolsTest, ProtocolPoolReusesHandlersPerKey) {
+    ProtocolHandlerPool pool;
+    PlotterProtocolBase* first = nullptr;
+    {
+        auto lease = pool.checkout(PlotterVendor::HP, "DesignJet_T2300");
+        ASSERT_TRUE(lease);
+        first = lease.get();
+        // Quirk do modelo aplicado na construção
+        auto* hpgl = dynamic_cast<HPGLGenerator*>(lease.get());
+        ASSERT_NE(hpgl, nullptr);
+        EXPECT_TRUE(hpgl->polyline_encoding_enabled());
+    }
+
+    auto again = pool.checkout(PlotterVendor::HP, "DesignJet_T2300");
+    EXPECT_EQ(again.get(), first);
+
+    // Chave diferente (protocolo explícito) não compartilha a instância
+    auto other = pool.checkout(PlotterVendor::HP, "DesignJet_T2300", "PostScript");
+    EXPECT_NE(other.get(), first);
+    EXPECT_EQ(other->get_protocol_name(), "PostScript");
+
+    auto stats = pool.stats();
+    EXPECT_EQ(stats.checkouts, 3u);
+    EXPECT_EQ(stats.reused, 1u);
+    EXPECT_EQ(stats.created, 2u);
+}
+
+TEST_F(ProtocolsTest, ProtocolPoolDropsHandlersLeasedBeforeClear) {
+    ProtocolHandlerPool pool;
+    auto stale = pool.checkout(PlotterVendor::HP, "DesignJet_T2300");
+    pool.clear();
+    stale.release();
+    EXPECT_EQ(pool.stats().idle, 0u);
+
+    // Emprestado depois do clear: volta normalmente para o pool
+    auto fresh = pool.checkout(PlotterVendor::HP, "DesignJet_T2300");
+    PlotterProtocolBase* handler = fresh.get();
+    fresh.release();
+    EXPECT_EQ(pool.stats().idle, 1u);
+    EXPECT_EQ(pool.checkout(PlotterVendor::HP, "DesignJet_T2300").get(), handler);
+}
+
+TEST_F(ProtocolsTest, ProtocolPoolResetsJobStateOnReturn) {
+    ProtocolHandlerPool pool;
+    {
+        auto lease = pool.checkout(PlotterVendor::HP, "PageWide XL 5000", "PDF");
+        auto* pdf = dynamic_cast<PDFPassthroughGenerator*>(lease.get());
+        ASSERT_NE(pdf, nullptr);
+        pdf->set_job_ticket_attribute("COPIES", "3");
+    }
+
+    auto lease = pool.checkout(PlotterVendor::HP, "PageWide XL 5000", "PDF");
+    PlotterCapabilities caps;
+    auto header = lease->generate_header(caps, MediaSize::A1, ColorMode::COLOR, 600);
+    std::string text(header.begin(), header.end());
+    EXPECT_EQ(text.find("COPIES"), std::string::npos);
+}
+
+TEST_F(ProtocolsTest, ProtocolPoolIsThreadSafe) {
+    ProtocolHandlerPool pool(4);
+    std::vector<std::thread> threads;
+    std::atomic<int> failures{0};
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&pool, &failures] {
+            for (int i = 0; i < 200; ++i) {
+                auto lease = pool.checkout(PlotterVendor::CANON, "imagePROGRAF_TX-3000");
+                std::vector<uint8_t> gray(64 * 8, 0x80);
+                if (lease->generate_page(gray, 64, 8, 300).empty()) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto stats = pool.stats();
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_EQ(stats.checkouts, 1600u);
+    EXPECT_LE(stats.created, 8u);
+    EXPECT_LE(stats.idle, 4u);
+}
+
+TEST_F(ProtocolsTest, CompatibilityMatchesCupsMakeModel) {
+    auto info = CompatibilityMatrix::find(PlotterVendor::HP, "HP DesignJet T1200 PS3");
+    ASSERT_NE(info, nullptr);
+    EXPECT_EQ(info->model, "DesignJet T1200");
+
+    // Separadores e caixa não importam; vendor GENERIC busca em todos
+    info = CompatibilityMatrix::find(PlotterVendor::GENERIC, "canon IMAGEPROGRAF tx_3000");
+    ASSERT_NE(info, nullptr);
+    EXPECT_EQ(info->vendor, PlotterVendor::CANON);
+
+    EXPECT_EQ(CompatibilityMatrix::find(PlotterVendor::HP, "HP DesignJet"), nullptr);
+    EXPECT_EQ(CompatibilityMatrix::find(PlotterVendor::EPSON, "HP DesignJet T1200"), nullptr);
+    EXPECT_EQ(CompatibilityMatrix::get_recommended_protocol(
+        PlotterVendor::HP, "HP DesignJet T2300 PostScript"), "HPGL2");
+}
+
+TEST_F(ProtocolsTest, CompatibilityLoadsSpecsAndReloads) {
+    fs::path specs = fs::path(__FILE__).parent_path().parent_path() / "config" / "plotter_specs.json";
+    CompatibilityMatrix::load_from_file(specs.string());
+
+    // Alias declarado no JSON
+    auto info = CompatibilityMatrix::find(PlotterVendor::EPSON, "EPSON SC-T7200 Series");
+    ASSERT_NE(info, nullptr);
+    EXPECT_EQ(info->model, "SureColor T7200");
+    EXPECT_EQ(info->quirks.at("ultrachrome_xd2"), "true");
+    auto t3500 = CompatibilityMatrix::find(PlotterVendor::HP, "HP DesignJet T3500");
+    ASSERT_NE(t3500, nullptr);
+    EXPECT_EQ(t3500->quirks.at("hpgl_pe_fraction_bits"), "2");
+
+    // Arquivo inválido não derruba o índice atual
+    fs::path broken = test_dir / "broken.json";
+    std::ofstream(broken) << "{ \"plotters\": ";
+    EXPECT_THROW(CompatibilityMatrix::load_from_file(broken.string()), std::runtime_error);
+    EXPECT_NE(CompatibilityMatrix::find(PlotterVendor::EPSON, "SC-T7200"), nullptr);
+
+    // Hot reload de uma cópia editada
+    fs::path copy = test_dir / "plotter_specs.json";
+    fs::copy_file(specs, copy);
+    CompatibilityMatrix::load_from_file(copy.string());
+    EXPECT_FALSE(CompatibilityMatrix::reload_if_changed());
+
+    std::ofstream(copy) << R"({"plotters": {"hp": {"vendor": "HP", "series": [{"models": [
+        {"model": "DesignJet Z9", "protocols": {"primary": "PDF", "supported": ["PDF"]}}
+    ]}]}}})";
+    EXPECT_TRUE(CompatibilityMatrix::reload_if_changed());
+    info = CompatibilityMatrix::find(PlotterVendor::HP, "HP DesignJet Z9 PostScript");
+    ASSERT_NE(info, nullptr);
+    EXPECT_EQ(info->primary_protocol, "PDF");
+    EXPECT_EQ(CompatibilityMatrix::find(PlotterVendor::HP, "DesignJet T1200"), nullptr);
+
+    // Restaurar a base completa para os demais testes
+    CompatibilityMatrix::load_from_file(specs.string());
+}
+
+TEST_F(ProtocolsTest, PlotTimePredictorMeasuresHpglAndRaster) {
+    // 2 traços de 10 mm, círculo de raio 1 mm, 14,14 mm com caneta levantada;
+    // texto de LB e dados binários de RTL não contam como comandos
+    std::string program = "IN;SP1;PU0,0;PD400,0,400,400;PU;PA800,0;LBPD999,999\x03;SP2;CI40;";
+    program += "\x1b*b4WPD9,";
+    program += "PU;";
+    auto stats = analyze_hpgl(reinterpret_cast<const uint8_t*>(program.data()), program.size());
+    EXPECT_EQ(stats.commands, 10u);
+    EXPECT_EQ(stats.pen_changes, 2u);
+    EXPECT_EQ(stats.pen_lifts, 2u);
+    EXPECT_NEAR(stats.pen_down_mm, 20.0 + 2.0 * 3.14159265, 1e-6);
+    EXPECT_NEAR(stats.pen_up_mm, std::sqrt(2.0) * 10.0 + 2.0, 1e-6);
+
+    // PE (base 64 e 32, com frações) percorre o mesmo caminho que PU/PD
+    std::vector<Polyline> strokes;
+    for (int i = 0; i < 20; ++i) {
+        Polyline stroke;
+        stroke.pen = 1 + i % 2;
+        stroke.points = {{1000.0 * i, 500.0}, {1000.0 * i + 333.25, 2500.5}, {1000.0 * i, 4000.0}};
+        strokes.push_back(stroke);
+    }
+    HPGLGenerator ascii(true);
+    const auto plain = ascii.generate_vector_page(strokes);
+    const auto reference = analyze_hpgl(plain.data(), plain.size());
+    EXPECT_NEAR(reference.pen_down_mm, StrokeOptimizer::pen_down_distance(strokes) / PLOTTER_UNITS_PER_MM, 0.1);
+    for (bool seven_bit : {false, true}) {
+        HPGLGenerator encoded(true);
+        encoded.set_polyline_encoding(true, 2, seven_bit);
+        const auto data = encoded.generate_vector_page(strokes);
+        const auto pe = analyze_hpgl(data.data(), data.size());
+        EXPECT_NEAR(pe.pen_down_mm, reference.pen_down_mm, 0.1);
+        EXPECT_NEAR(pe.pen_up_mm, reference.pen_up_mm, 0.1);
+        EXPECT_EQ(pe.pen_changes, reference.pen_changes);
+        EXPECT_EQ(pe.pen_lifts, 20u);
+    }
+
+    // Raster a 100 dpi: 100 das 300 linhas com tinta, 50 pixels cada
+    std::vector<uint8_t> pixels(400 * 300, 0xFF);
+    for (int y = 100; y < 200; ++y) {
+        std::fill_n(pixels.begin() + y * 400 + 300, 50, 0);
+    }
+    const auto page = all_press::raster::TiledRaster::from_buffer(
+        pixels.data(), 400, 300, all_press::raster::PixelFormat::GRAY8);
+    const auto raster_stats = analyze_raster(page, 100, 4);
+    EXPECT_NEAR(raster_stats.media_length_mm, 76.2, 1e-9);
+    EXPECT_NEAR(raster_stats.inked_length_mm, 25.4, 1e-9);
+    EXPECT_NEAR(raster_stats.ink_area_m2, 5000 * 0.254 * 0.254 / 1e6, 1e-9);
+
+    PlotSpeeds speeds;
+    speeds.job_overhead_s = 10.0;
+    speeds.print_mm_s = 25.4;
+    speeds.feed_mm_s = 50.8;
+    speeds.ink_s_per_m2 = 0.0;
+    EXPECT_NEAR(predict_plot_seconds(raster_stats, speeds), 10.0 + 4.0 + 1.0, 1e-9);
+    EXPECT_EQ(speeds.passes_for_quality(9), 8);
+    EXPECT_EQ(speeds.passes_for_quality(0), 1);
+
+    // Velocidades vêm do speed_reference e do override do modelo
+    fs::path specs = fs::path(__FILE__).parent_path().parent_path() / "config" / "plotter_specs.json";
+    CompatibilityMatrix::load_from_file(specs.string());
+    auto t3500 = CompatibilityMatrix::find(PlotterVendor::HP, "HP DesignJet T3500");
+    ASSERT_NE(t3500, nullptr);
+    EXPECT_EQ(t3500->speeds.print_mm_s, 35.0);
+    EXPECT_EQ(t3500->speeds.feed_mm_s, 120.0);
+    EXPECT_TRUE(t3500->roll_media);
+}
+
+TEST_F(ProtocolsTest, PlotTimeCalibrationLearnsAndPersists) {
+    PlotTimeCalibration calibration;
+    EXPECT_EQ(calibration.factor("T1200"), 1.0);
+    for (int i = 0; i < 20; ++i) {
+        const double predicted = 60.0 + i * 10.0;
+        calibration.observe("T1200", predicted, predicted * 1.5);
+    }
+    calibration.observe("T1200", 0.0, 30.0);   // Ignorado
+    EXPECT_NEAR(calibration.factor("T1200"), 1.5, 1e-9);
+    EXPECT_NEAR(calibration.calibrate("T1200", 100.0), 150.0, 1e-6);
+    EXPECT_EQ(calibration.observations("T1200"), 20u);
+    EXPECT_EQ(calibration.factor("T7200"), 1.0);
+
+    // Deriva: observações recentes pesam mais
+    for (int i = 0; i < 60; ++i) calibration.observe("T1200", 100.0, 120.0);
+    EXPECT_GT(calibration.factor("T1200"), 1.2);
+    EXPECT_LT(calibration.factor("T1200"), 1.25);
+
+    const std::string path = (test_dir / "calibration.json").string();
+    calibration.save(path);
+    PlotTimeCalibration loaded;
+    loaded.load(path);
+    EXPECT_NEAR(loaded.factor("T1200"), calibration.factor("T1200"), 1e-12);
+    EXPECT_EQ(loaded.observations("T1200"), 80u);
+    EXPECT_THROW(loaded.load((test_dir / "missing.json").string()), std::runtime_error);
+}
+
+TEST_F(ProtocolsTest, HpglInterpreterBuildsDisplayListInStreams) {
+    const std::string program =
+        "IN;SP1;PW0.5;PA0,0;PD4000,0,4000,4000;PU;"
+        "SP2;PA8000,2000;CI1000;"                          // Círculo vermelho
+        "SP3;PA0,6000;RR2000,2000;"                         // Retângulo verde cheio
+        "SP1;PA6000,6000;PM0;PD8000,6000,8000,8000,6000,8000,6000,6000;PM2;FP;"
+        "LBTexto\x03"
+        "\x1B%0A\x1B*b3W\x01\x02\x03\x1B%0B"              // RTL embutido é ignorado
+        "SC0,100,0,100;IP0,0,4000,4000;PU0,0;PD100,100;PU;"
+        "ZZ1;";
+
+    HpglDisplayList whole = parse_hpgl(reinterpret_cast<const uint8_t*>(program.data()), program.size());
+    ASSERT_EQ(whole.shapes.size(), 5u);
+    EXPECT_FALSE(whole.shapes[0].fill);
+    EXPECT_DOUBLE_EQ(whole.shapes[0].width_mm, 0.5);
+    EXPECT_EQ(whole.shapes[0].paths[0].size(), 3u);
+    EXPECT_EQ(whole.shapes[1].rgb, (std::array<uint8_t, 3>{255, 0, 0}));
+    EXPECT_TRUE(whole.shapes[2].fill);
+    EXPECT_TRUE(whole.shapes[3].fill);
+    EXPECT_TRUE(whole.shapes[3].even_odd);
+    // SC/IP: 100 unidades de usuário = 4000 unidades de plotter
+    EXPECT_DOUBLE_EQ(whole.shapes[4].paths[0].back().x, 4000.0);
+    EXPECT_EQ(whole.unknown, 1u);
+    EXPECT_EQ(whole.unsupported, 1u);
+    EXPECT_TRUE(whole.has_color());
+    EXPECT_NEAR(whole.min_x, -10.0, 1e-9);             // Meia pena de 0.5 mm
+    EXPECT_NEAR(whole.max_x, 9000.0 + 10.0, 1.0);
+
+    // Em pedaços de 1 e 7 bytes o resultado é o mesmo
+    for (size_t chunk : {size_t(1), size_t(7)}) {
+        HpglInterpreter interpreter;
+        for (size_t i = 0; i < program.size(); i += chunk) {
+            interpreter.feed(reinterpret_cast<const uint8_t*>(program.data()) + i,
+                             std::min(chunk, program.size() - i));
+        }
+        HpglDisplayList streamed = interpreter.finish();
+        ASSERT_EQ(streamed.shapes.size(), whole.shapes.size());
+        for (size_t k = 0; k < whole.shapes.size(); ++k) {
+            ASSERT_EQ(streamed.shapes[k].paths.size(), whole.shapes[k].paths.size());
+            EXPECT_EQ(streamed.shapes[k].paths[0].size(), whole.shapes[k].paths[0].size());
+        }
+        EXPECT_EQ(streamed.commands, whole.commands);
+    }
+
+    // PE: o mesmo traço que o gerador codifica
+    HPGLGenerator generator;
+    generator.set_polyline_encoding(true);
+    generator.set_stroke_optimization(false);
+    Polyline line;
+    line.points = {{100, 100}, {900, 100}, {900, 700}};
+    auto encoded = generator.generate_vector_page({line});
+    HpglDisplayList pe = parse_hpgl(encoded.data(), encoded.size());
+    ASSERT_EQ(pe.shapes.size(), 1u);
+    ASSERT_EQ(pe.shapes[0].paths[0].size(), 3u);
+    EXPECT_DOUBLE_EQ(pe.shapes[0].paths[0][2].x, 900.0);
+    EXPECT_DOUBLE_EQ(pe.shapes[0].paths[0][2].y, 700.0);
+}
+
+TEST_F(ProtocolsTest, HpglRendersPreviewAndVectorPdf) {
+    const std::string program = "IN;SP1;PW1;PA0,0;PD4000,0;PU;SP2;PA0,4000;RR4000,-2000;";
+    HpglDisplayList list = parse_hpgl(reinterpret_cast<const uint8_t*>(program.data()), program.size());
+
+    // 101 x 100.5 mm (meia pena de 0.5 mm nas bordas) a 254 dpi: 10 pixels por mm
+    HpglRenderOptions options;
+    options.dpi = 254;
+    auto page = render_hpgl(list, options);
+    EXPECT_EQ(page.width(), 1010);
+    EXPECT_EQ(page.height(), 1005);
+    auto pixels = page.to_buffer();
+    auto pixel = [&](int x, int y) { return &pixels[(static_cast<size_t>(y) * page.width() + x) * 3]; };
+    const int bottom = page.height() - 5;                 // Linha preta no y = 0
+    EXPECT_EQ(pixel(500, bottom)[0], 0);
+    EXPECT_EQ(pixel(500, bottom)[2], 0);
+    EXPECT_EQ(pixel(500, 100)[0], 255);                   // Retângulo vermelho no topo
+    EXPECT_EQ(pixel(500, 100)[1], 0);
+    EXPECT_EQ(pixel(500, 700)[1], 255);                   // Meio em branco
+
+    HpglRenderOptions preview;
+    preview.fit_width = 64;
+    preview.fit_height = 32;
+    auto small = render_hpgl(list, preview);
+    EXPECT_LE(small.width(), 64);
+    EXPECT_EQ(small.height(), 32);
+
+    const std::string pdf_path = (test_dir / "drawing.pdf").string();
+    write_hpgl_pdf(list, pdf_path, 5.0);
+    std::ifstream in(pdf_path, std::ios::binary);
+    std::string pdf((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    EXPECT_EQ(pdf.compare(0, 8, "%PDF-1.4"), 0);
+    EXPECT_NE(pdf.find(" RG\n"), std::string::npos);
+    EXPECT_NE(pdf.find("\nf\n"), std::string::npos);      // RR: não-zero
+    // xref aponta para os objetos
+    const size_t startxref = std::stoul(pdf.substr(pdf.rfind("startxref") + 10));
+    EXPECT_EQ(pdf.compare(startxref, 4, "xref"), 0);
+    const size_t first = std::stoul(pdf.substr(startxref + 29, 10));
+    EXPECT_EQ(pdf.compare(first, 7, "1 0 obj"), 0);
+
+    EXPECT_THROW(render_hpgl(HpglDisplayList{}), std::invalid_argument);
+}
+
+TEST_F(ProtocolsTest, DxfReaderEmitsStrokesPerLayerAndBlock) {
+    // Pares código/valor; unidades em mm
+    const std::vector<std::pair<int, std::string>> groups = {
+        {0, "SECTION"}, {2, "HEADER"}, {9, "$INSUNITS"}, {70, "4"}, {0, "ENDSEC"},
+        {0, "SECTION"}, {2, "TABLES"}, {0, "TABLE"}, {2, "LAYER"},
+        {0, "LAYER"}, {2, "0"}, {62, "7"}, {70, "0"},
+        {0, "LAYER"}, {2, "RED"}, {62, "1"}, {70, "0"},
+        {0, "LAYER"}, {2, "HIDDEN"}, {62, "-3"}, {70, "0"},
+        {0, "ENDTAB"}, {0, "ENDSEC"},
+        {0, "SECTION"}, {2, "BLOCKS"},
+        {0, "BLOCK"}, {2, "TICK"}, {10, "5"}, {20, "5"},
+        {0, "LINE"}, {8, "0"}, {62, "0"}, {10, "5"}, {20, "5"}, {11, "6"}, {21, "5"},
+        {0, "ENDBLK"}, {0, "ENDSEC"},
+        {0, "SECTION"}, {2, "ENTITIES"},
+        {0, "LINE"}, {8, "0"}, {10, "0"}, {20, "0"}, {11, "100"}, {21, "0"},
+        {0, "LWPOLYLINE"}, {8, "RED"}, {90, "2"}, {70, "0"},
+        {10, "0"}, {20, "50"}, {42, "1"}, {10, "20"}, {20, "50"},
+        {0, "CIRCLE"}, {8, "0"}, {62, "5"}, {10, "50"}, {20, "20"}, {40, "10"},
+        {0, "INSERT"}, {8, "RED"}, {2, "TICK"}, {10, "100"}, {20, "100"}, {41, "2"}, {42, "2"}, {50, "90"},
+        {0, "LINE"}, {8, "HIDDEN"}, {10, "0"}, {20, "0"}, {11, "500"}, {21, "500"},
+        {0, "HATCH"}, {8, "0"},
+        {0, "TEXT"}, {8, "0"}, {10, "0"}, {20, "110"}, {40, "6"}, {1, "HI"},
+        {0, "ENDSEC"}, {0, "EOF"}};
+    std::string dxf;
+    for (const auto& group : groups) {
+        dxf += "  " + std::to_string(group.first) + "\r\n" + group.second + "\r\n";
+    }
+    const auto* data = reinterpret_cast<const uint8_t*>(dxf.data());
+
+    DxfReadOptions sequential;
+    sequential.threads = 1;
+    const DxfDrawing drawing = read_dxf(data, dxf.size(), sequential);
+    EXPECT_EQ(drawing.entities, 5u);
+    EXPECT_EQ(drawing.skipped, 1u);      // Camada desligada
+    EXPECT_EQ(drawing.unsupported, 1u);  // HATCH
+    EXPECT_NEAR(drawing.width_mm, 100.0, 1e-6);
+    EXPECT_NEAR(drawing.height_mm, 116.0, 1e-6);
+    ASSERT_EQ(drawing.strokes.size(), 10u);  // LINE, arco, círculo, bloco e 6 traços de "HI"
+
+    const auto& line = drawing.strokes[0];
+    EXPECT_EQ(line.pen, 1);
+    ASSERT_EQ(line.points.size(), 2u);
+    EXPECT_NEAR(line.points[1].x, 4000.0, 1e-6);
+
+    // Bulge 1: meia volta anti-horária por baixo, de (0, 50) a (20, 50)
+    const auto& arc = drawing.strokes[1];
+    EXPECT_EQ(arc.pen, 2);
+    double lowest = 1e9;
+    for (const auto& p : arc.points) lowest = std::min(lowest, p.y);
+    EXPECT_NEAR(lowest, 40.0 * PLOTTER_UNITS_PER_MM, 1.0);
+    EXPECT_NEAR(arc.points.back().x, 20.0 * PLOTTER_UNITS_PER_MM, 1e-6);
+
+    const auto& circle = drawing.strokes[2];
+    EXPECT_EQ(circle.pen, 5);
+    EXPECT_GT(circle.points.size(), 32u);
+    EXPECT_NEAR(circle.points.front().x, circle.points.back().x, 1e-6);
+
+    // Bloco escalado 2x e girado 90 graus; BYBLOCK herda o vermelho da camada
+    const auto& tick = drawing.strokes[3];
+    EXPECT_EQ(tick.pen, 2);
+    EXPECT_NEAR(tick.points[0].x, 4000.0, 1e-6);
+    EXPECT_NEAR(tick.points[1].x, 4000.0, 1e-6);
+    EXPECT_NEAR(tick.points[1].y - tick.points[0].y, 80.0, 1e-6);
+
+    // Faixas de uma entidade em 4 threads dão o mesmo desenho
+    DxfReadOptions parallel;
+    parallel.threads = 4;
+    parallel.chunk_entities = 1;
+    const DxfDrawing split = read_dxf(data, dxf.size(), parallel);
+    ASSERT_EQ(split.strokes.size(), drawing.strokes.size());
+    for (size_t i = 0; i < split.strokes.size(); ++i) {
+        EXPECT_EQ(split.strokes[i].pen, drawing.strokes[i].pen);
+        ASSERT_EQ(split.strokes[i].points.size(), drawing.strokes[i].points.size());
+        EXPECT_EQ(split.strokes[i].points.back().y, drawing.strokes[i].points.back().y);
+    }
+
+    // HPGL gerado volta pelo interpretador com a mesma extensão
+    const std::vector<uint8_t> hpgl = dxf_to_hpgl(drawing);
+    const HpglDisplayList list = parse_hpgl(hpgl.data(), hpgl.size());
+    EXPECT_EQ(list.unknown, 0u);
+    EXPECT_TRUE(list.has_color());
+    EXPECT_NEAR(list.width_mm(), 100.0, 0.5);
+
+    const std::string binary = std::string("AutoCAD Binary DXF\r\n\x1a") + std::string(8, '\0');
+    EXPECT_THROW(read_dxf(reinterpret_cast<const uint8_t*>(binary.data()), binary.size()),
+                 std::runtime_error);
+}
+
+TEST_F(ProtocolsTest, DxfReaderBoundsNestedBlockExpansion) {
+    // Cada bloco insere o seguinte 10 vezes; o último tem uma linha
+    auto chain = [](int levels) {
+        std::string dxf = "0\nSECTION\n2\nBLOCKS\n";
+        for (int level = 0; level < levels; ++level) {
+            dxf += "0\nBLOCK\n2\nB" + std::to_string(level) + "\n10\n0\n20\n0\n";
+            if (level == levels - 1) {
+                dxf += "0\nLINE\n8\n0\n10\n0\n20\n0\n11\n1\n21\n1\n";
+            } else {
+                for (int i = 0; i < 10; ++i) {
+                    dxf += "0\nINSERT\n8\n0\n2\nB" + std::to_string(level + 1) + "\n10\n" +
+                           std::to_string(i) + "\n20\n0\n";
+                }
+            }
+            dxf += "0\nENDBLK\n";
+        }
+        return dxf + "0\nENDSEC\n0\nSECTION\n2\nENTITIES\n0\nINSERT\n8\n0\n2\nB0\n10\n0\n20\n0\n"
+                     "0\nENDSEC\n0\nEOF\n";
+    };
+    DxfReadOptions options;
+    options.max_points = 100000;
+
+    // 10^14 linhas em poucos KB: o orçamento interrompe a expansão
+    const std::string bomb = chain(15);
+    EXPECT_LT(bomb.size(), 8192u);
+    EXPECT_THROW(read_dxf(reinterpret_cast<const uint8_t*>(bomb.data()), bomb.size(), options),
+                 std::runtime_error);
+
+    const std::string shallow = chain(3);
+    const DxfDrawing drawing =
+        read_dxf(reinterpret_cast<const uint8_t*>(shallow.data()), shallow.size(), options);
+    EXPECT_EQ(drawing.strokes.size(), 100u);
+}
+
+TEST_F(ProtocolsTest, SvgReaderFlattensPathsShapesAndTransforms) {
+    // Página de 100 x 50 mm com viewBox em mm; y do SVG cresce para baixo
+    const std::string svg = R"svg(<?xml version="1.0"?>
+<!DOCTYPE svg PUBLIC "-//W3C//DTD SVG 1.1//EN" "http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd">
+<svg xmlns="http://www.w3.org/2000/svg" width="100mm" height="50mm" viewBox="0 0 100 50">
+  <!-- comentário com <rect> dentro -->
+  <defs><style><![CDATA[ .st0 { fill: #0000ff; stroke: none } ]]></style>
+    <linearGradient id="grad"/></defs>
+  <rect x="10" y="10" width="20" height="10" fill="red"/>
+  <path d="M0,0 C10,20 20,20 30,0 a5 5 0 01 10 0" fill="none" stroke="blue" stroke-width="0.5"/>
+  <g transform="translate(50,0) scale(2)" style="opacity:0.5">
+    <circle cx="5" cy="5" r="5" fill="#00ff00"/>
+  </g>
+  <polygon class="st0" points="60,40 70,40 70,45" fill="red"/>
+  <g display="none"><rect width="100" height="50"/></g>
+  <text x="0" y="45">ignorado</text>
+  <blink/>
+</svg>)svg";
+    const HpglDisplayList list = read_svg(reinterpret_cast<const uint8_t*>(svg.data()), svg.size());
+    EXPECT_EQ(list.commands, 4u);
+    EXPECT_EQ(list.unsupported, 1u);  // text
+    EXPECT_EQ(list.unknown, 1u);      // blink
+    ASSERT_EQ(list.shapes.size(), 4u);
+
+    const auto& rect = list.shapes[0];
+    EXPECT_TRUE(rect.fill);
+    EXPECT_FALSE(rect.even_odd);      // nonzero é o padrão do SVG
+    EXPECT_EQ(rect.rgb[0], 255);
+    ASSERT_EQ(rect.paths.size(), 1u);
+    ASSERT_EQ(rect.paths[0].size(), 4u);
+    EXPECT_NEAR(rect.paths[0][0].x, 10.0 * PLOTTER_UNITS_PER_MM, 1e-6);
+    EXPECT_NEAR(rect.paths[0][0].y, 40.0 * PLOTTER_UNITS_PER_MM, 1e-6);
+    EXPECT_NEAR(rect.paths[0][2].y, 30.0 * PLOTTER_UNITS_PER_MM, 1e-6);
+
+    // Curva e arco achatados num único traço que termina em (40, 0)
+    const auto& curve = list.shapes[1];
+    EXPECT_FALSE(curve.fill);
+    EXPECT_NEAR(curve.width_mm, 0.5, 1e-9);
+    EXPECT_GT(curve.paths[0].size(), 20u);
+    EXPECT_NEAR(curve.paths[0].back().x, 40.0 * PLOTTER_UNITS_PER_MM, 1e-6);
+    EXPECT_NEAR(curve.paths[0].back().y, 50.0 * PLOTTER_UNITS_PER_MM, 1e-6);
+    double lowest = 1e9;
+    for (const auto& p : curve.paths[0]) lowest = std::min(lowest, p.y);
+    EXPECT_NEAR(lowest, 35.0 * PLOTTER_UNITS_PER_MM, 0.05 * PLOTTER_UNITS_PER_MM);  // Bézier: y máximo 15
+
+    // Círculo no grupo transformado, verde a 50% sobre branco
+    const auto& circle = list.shapes[2];
+    EXPECT_EQ(circle.rgb[0], 128);
+    EXPECT_EQ(circle.rgb[1], 255);
+    double left = 1e9, right = -1e9;
+    for (const auto& p : circle.paths[0]) {
+        left = std::min(left, p.x);
+        right = std::max(right, p.x);
+    }
+    EXPECT_NEAR(left, 50.0 * PLOTTER_UNITS_PER_MM, 1.0);
+    EXPECT_NEAR(right, 70.0 * PLOTTER_UNITS_PER_MM, 1e-6);
+
+    // Regra CSS de classe vence o atributo fill
+    EXPECT_EQ(list.shapes[3].rgb[2], 255);
+    EXPECT_EQ(list.shapes[3].rgb[0], 0);
+
+    EXPECT_NEAR(list.max_x, 70.0 * PLOTTER_UNITS_PER_MM, 1e-6);
+
+    // Traços para o plotter: pena pela cor, áreas como contorno fechado
+    const std::vector<Polyline> strokes = pen_strokes(list);
+    ASSERT_EQ(strokes.size(), 4u);
+    EXPECT_EQ(strokes[0].pen, 2);
+    EXPECT_EQ(strokes[1].pen, 5);
+    EXPECT_NEAR(strokes[0].points.front().x, strokes[0].points.back().x, 1e-9);
+
+    const std::string html = "<html><body/></html>";
+    EXPECT_THROW(read_svg(reinterpret_cast<const uint8_t*>(html.data()), html.size()), std::runtime_error);
+}
@@ -0,0 +1,1190 @@
+#include <gtest/gtest.h>
+#include "raster/tiled_raster.h"
+#include "raster/halftone.h"
+#include "raster/color_convert.h"
+#include "raster/image_io.h"
+#include "raster/icc_transform.h"
+#include "raster/icc_catalog.h"
+#include "raster/ink_coverage.h"
+#include "raster/resample.h"
+#include "raster/trim.h"
+#include "raster/nesting.h"
+#include "raster/path_fill.h"
+#include "protocols/protocol_factory.h"
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+using namespace all_press::raster;
+using namespace all_press::protocols;
+
+class RasterTest : public ::testing::Test {
+protected:
+    // Folha CAD sintética: fundo branco com uma moldura e um bloco de texto
+    std::vector<uint8_t> make_sheet(int width, int height, int channels) {
+        std::vector<uint8_t> data(static_cast<size_t>(width) * height * channels, 0xFF);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                bool frame = x < 4 || y < 4 || x >= width - 4 || y >= height - 4;
+                bool block = x > width - 300 && y > height - 120 && (x + y) % 3 == 0;
+                if (frame || block) {
+                    std::memset(&data[(static_cast<size_t>(y) * width + x) * channels],
+                                (x * 7 + y) & 0x7F, channels);
+                }
+            }
+        }
+        return data;
+    }
+
+    static void put32(std::vector<uint8_t>& out, uint32_t value) {
+        for (int shift = 24; shift >= 0; shift -= 8) out.push_back(static_cast<uint8_t>(value >> shift));
+    }
+    static void put16(std::vector<uint8_t>& out, uint16_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+    static void put_sig(std::vector<uint8_t>& out, const char* sig) {
+        out.insert(out.end(), sig, sig + 4);
+    }
+    static std::vector<uint8_t> xyz_tag(double x, double y, double z) {
+        std::vector<uint8_t> tag;
+        put_sig(tag, "XYZ ");
+        put32(tag, 0);
+        for (double v : {x, y, z}) put32(tag, static_cast<uint32_t>(std::lround(v * 65536.0)));
+        return tag;
+    }
+
+    // Perfil ICC v2 montado byte a byte: cabeçalho, tabela de tags e dados
+    static std::vector<uint8_t> icc_profile(const char* space, const char* pcs,
+            const std::vector<std::pair<const char*, std::vector<uint8_t>>>& tags) {
+        std::vector<uint8_t> header(128, 0);
+        header[8] = 2;
+        header[9] = 0x10;
+        std::memcpy(&header[12], "prtr", 4);
+        std::memcpy(&header[16], space, 4);
+        std::memcpy(&header[20], pcs, 4);
+        std::memcpy(&header[36], "acsp", 4);
+
+        std::vector<uint8_t> table;
+        std::vector<uint8_t> data;
+        size_t offset = 128 + 4 + tags.size() * 12;
+        put32(table, static_cast<uint32_t>(tags.size()));
+        for (const auto& tag : tags) {
+            put_sig(table, tag.first);
+            put32(table, static_cast<uint32_t>(offset + data.size()));
+            put32(table, static_cast<uint32_t>(tag.second.size()));
+            data.insert(data.end(), tag.second.begin(), tag.second.end());
+            while (data.size() % 4) data.push_back(0);
+        }
+        std::vector<uint8_t> profile = header;
+        profile.insert(profile.end(), table.begin(), table.end());
+        profile.insert(profile.end(), data.begin(), data.end());
+        const uint32_t size = static_cast<uint32_t>(profile.size());
+        for (int i = 0; i < 4; ++i) profile[i] = static_cast<uint8_t>(size >> (24 - 8 * i));
+        return profile;
+    }
+
+    // RGB matriz/TRC com primárias sRGB e gama 2.2
+    static std::vector<uint8_t> matrix_trc_profile() {
+        std::vector<uint8_t> trc;
+        put_sig(trc, "curv");
+        put32(trc, 0);
+        put32(trc, 1);
+        put16(trc, 563);
+        std::vector<uint8_t> desc;
+        put_sig(desc, "desc");
+        put32(desc, 0);
+        put32(desc, 11);
+        const char text[] = "Test RGB 22";
+        desc.insert(desc.end(), text, text + 11);
+        return icc_profile("RGB ", "XYZ ", {
+            {"desc", desc},
+            {"rXYZ", xyz_tag(0.4360747, 0.2225045, 0.0139322)},
+            {"gXYZ", xyz_tag(0.3850649, 0.7168786, 0.0971045)},
+            {"bXYZ", xyz_tag(0.1430804, 0.0606169, 0.7141733)},
+            {"rTRC", trc}, {"gTRC", trc}, {"bTRC", trc},
+            {"wtpt", xyz_tag(0.9642, 1.0, 0.8249)},
+        });
+    }
+
+    // CMYK com AToB0 lut16 (grade 3, PCS Lab) de um modelo simples de tinta
+    static std::vector<uint8_t> cmyk_lut_profile() {
+        std::vector<uint8_t> lut;
+        put_sig(lut, "mft2");
+        put32(lut, 0);
+        lut.push_back(4);
+        lut.push_back(3);
+        lut.push_back(3);
+        lut.push_back(0);
+        for (int i = 0; i < 9; ++i) put32(lut, i % 4 == 0 ? 65536 : 0);
+        put16(lut, 2);
+        put16(lut, 2);
+        for (int i = 0; i < 4; ++i) { put16(lut, 0); put16(lut, 65535); }
+        for (int node = 0; node < 81; ++node) {
+            const double c = (node / 27) / 2.0, m = (node / 9 % 3) / 2.0;
+            const double y = (node / 3 % 3) / 2.0, k = (node % 3) / 2.0;
+            const double lightness = 100.0 * (1.0 - k) * (1.0 - 0.3 * c - 0.4 * m - 0.1 * y);
+            const double a = 30.0 * m - 15.0 * c;
+            const double b = 35.0 * y - 20.0 * c;
+            put16(lut, static_cast<uint16_t>(std::lround(lightness * 652.8)));
+            put16(lut, static_cast<uint16_t>(std::lround((a + 128.0) * 256.0)));
+            put16(lut, static_cast<uint16_t>(std::lround((b + 128.0) * 256.0)));
+        }
+        for (int i = 0; i < 3; ++i) { put16(lut, 0); put16(lut, 65535); }
+        return icc_profile("CMYK", "Lab ", {{"A2B0", lut}, {"wtpt", xyz_tag(0.9642, 1.0, 0.8249)}});
+    }
+
+    // Maior diferença entre a transformação compilada e a avaliação em double
+    static int max_transform_error(const IccProfile& source, const IccProfile& target,
+                                   RenderingIntent intent, int samples) {
+        auto transform = IccTransform::build(source, target, intent);
+        const int in = source.channels();
+        const int out = target.channels();
+        std::mt19937 rng(7);
+        std::vector<uint8_t> pixels(static_cast<size_t>(samples) * in);
+        for (auto& v : pixels) v = static_cast<uint8_t>(rng());
+        std::vector<uint8_t> result(static_cast<size_t>(samples) * out);
+        transform->apply(pixels.data(), result.data(), static_cast<size_t>(samples));
+
+        int worst = 0;
+        for (int p = 0; p < samples; ++p) {
+            double device[4], xyz[3], expected[4];
+            for (int c = 0; c < in; ++c) device[c] = pixels[p * in + c] / 255.0;
+            source.to_pcs(device, xyz, intent);
+            target.from_pcs(xyz, expected, intent);
+            for (int c = 0; c < out; ++c) {
+                int diff = std::abs(result[p * out + c] - static_cast<int>(std::lround(expected[c] * 255.0)));
+                worst = std::max(worst, diff);
+            }
+        }
+        return worst;
+    }
+};
+
+TEST_F(RasterTest, RoundTripWithBlankElision) {
+    const int width = 2000;
+    const int height = 1500;
+    auto sheet = make_sheet(width, height, 3);
+
+    TiledRasterOptions options;
+    options.compression = TileCompression::NONE;
+    auto raster = TiledRaster::from_buffer(sheet.data(), width, height, PixelFormat::RGB8, options);
+
+    EXPECT_EQ(raster.to_buffer(), sheet);
+
+    auto stats = raster.stats();
+    EXPECT_EQ(stats.tiles, 8u * 6u);
+    EXPECT_GE(stats.blank_tiles, stats.tiles / 2);
+    EXPECT_LT(stats.stored_bytes(), sheet.size() / 2);
+    EXPECT_TRUE(raster.tile_is_blank(3, 2));
+}
+
+TEST_F(RasterTest, ColdTilesAreCompressed) {
+    const int width = 1024;
+    const int height = 1024;
+    auto sheet = make_sheet(width, height, 1);
+
+    TiledRasterOptions options;
+    options.hot_bytes_budget = 0;  // Toda faixa gravada já é fria
+    auto raster = TiledRaster::from_buffer(sheet.data(), width, height, PixelFormat::GRAY8, options);
+
+    auto stats = raster.stats();
+    if (TiledRaster::compression_available()) {
+        EXPECT_GT(stats.compressed_tiles, 0u);
+    } else {
+        EXPECT_EQ(stats.compressed_tiles, 0u);
+    }
+    EXPECT_EQ(raster.to_buffer(), sheet);
+
+    // Leitura parcial atravessando faixas
+    std::vector<uint8_t> rows(static_cast<size_t>(width) * 300);
+    raster.read_rows(200, 300, rows.data());
+    EXPECT_EQ(0, std::memcmp(rows.data(), sheet.data() + 200 * width, rows.size()));
+}
+
+TEST_F(RasterTest, WriterStreamsRows) {
+    const int width = 300;
+    const int height = 700;
+    auto sheet = make_sheet(width, height, 4);
+    for (auto& b : sheet) b = static_cast<uint8_t>(0xFF - b);  // CMYK: 0 = sem tinta
+
+    TiledRaster raster(width, height, PixelFormat::CMYK8);
+    TiledRasterWriter writer(raster);
+    for (int y = 0; y < height; ++y) {
+        writer.append_row(sheet.data() + static_cast<size_t>(y) * width * 4);
+    }
+    writer.finish();
+
+    EXPECT_EQ(writer.rows_written(), height);
+    EXPECT_EQ(raster.to_buffer(), sheet);
+
+    int bands = 0;
+    raster.for_each_band([&](const RowBand& band) {
+        EXPECT_EQ(band.y, bands * 256);
+        ++bands;
+        return true;
+    });
+    EXPECT_EQ(bands, 3);
+}
+
+TEST_F(RasterTest, GeneratorsConsumeTiledPages) {
+    const int width = 1200;
+    const int height = 900;
+    auto sheet = make_sheet(width, height, 1);
+    auto raster = TiledRaster::from_buffer(sheet.data(), width, height, PixelFormat::GRAY8);
+
+    // HP RTL: 600 linhas vazias viram um único deslocamento vertical
+    std::vector<uint8_t> lower(static_cast<size_t>(width) * height, 0xFF);
+    std::memset(&lower[static_cast<size_t>(600) * width], 0, static_cast<size_t>(width) * 100);
+    auto lower_raster = TiledRaster::from_buffer(lower.data(), width, height, PixelFormat::GRAY8);
+
+    HPGLGenerator hpgl;
+    auto tiled = hpgl.generate_raster_page(lower_raster, 300);
+    auto flat = hpgl.generate_page(lower, width, height, 300);
+    std::string text(tiled.begin(), tiled.end());
+    EXPECT_NE(text.find("\x1B*r1A\x1B*b600Y"), std::string::npos);
+    EXPECT_NE(text.find("\x1B*b200Y\x1B*rC"), std::string::npos);
+    EXPECT_LT(tiled.size(), flat.size());
+
+    // PostScript produz os mesmos dados pelos dois caminhos
+    PostScriptGenerator ps(PlotterVendor::CANON);
+    EXPECT_EQ(ps.generate_raster_page(raster, 300), ps.generate_page(sheet, width, height, 300));
+}
+
+TEST_F(RasterTest, OrderedHalftoneMatchesGrayLevel) {
+    const int width = 1021;  // Não múltiplo de 8: bits de preenchimento
+    const int height = 64;
+    const size_t row_bytes = packed_row_bytes(width);
+
+    for (auto method : {HalftoneMethod::BAYER, HalftoneMethod::BLUE_NOISE}) {
+        HalftoneOptions options;
+        options.method = method;
+        Halftoner halftoner(options);
+
+        for (int level : {0, 64, 128, 192, 255}) {
+            std::vector<uint8_t> gray(static_cast<size_t>(width) * height,
+                                      static_cast<uint8_t>(level));
+            std::vector<uint8_t> packed(row_bytes * height);
+            halftoner.process(gray.data(), width, height, width, packed.data());
+
+            size_t ink = 0;
+            for (int y = 0; y < height; ++y) {
+                const uint8_t* row = packed.data() + y * row_bytes;
+                for (int x = 0; x < width; ++x) {
+                    ink += (row[x / 8] >> (7 - x % 8)) & 1;
+                }
+                EXPECT_EQ(row[row_bytes - 1] & 0x07, 0);
+            }
+            double coverage = static_cast<double>(ink) / (static_cast<double>(width) * height);
+            EXPECT_NEAR(coverage, 1.0 - level / 255.0, 0.02);
+        }
+    }
+}
+
+TEST_F(RasterTest, ErrorDiffusionIsThreadInvariant) {
+    const int width = 777;
+    const int height = 300;
+    auto sheet = make_sheet(width, height, 1);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            sheet[static_cast<size_t>(y) * width + x] ^= static_cast<uint8_t>((x ^ y) & 0xF0);
+        }
+    }
+    const size_t row_bytes = packed_row_bytes(width);
+
+    for (auto method : {HalftoneMethod::FLOYD_STEINBERG, HalftoneMethod::JARVIS}) {
+        HalftoneOptions serial;
+        serial.method = method;
+        serial.threads = 1;
+        std::vector<uint8_t> expected(row_bytes * height);
+        Halftoner(serial).process(sheet.data(), width, height, width, expected.data());
+
+        HalftoneOptions parallel = serial;
+        parallel.threads = 4;
+        std::vector<uint8_t> actual(row_bytes * height);
+        Halftoner(parallel).process(sheet.data(), width, height, width, actual.data());
+        EXPECT_EQ(actual, expected);
+
+        // Mesmo resultado consumindo a página em faixas de tiles
+        TiledRasterOptions tiles;
+        tiles.tile_size = 64;
+        auto raster = TiledRaster::from_buffer(sheet.data(), width, height,
+                                               PixelFormat::GRAY8, tiles);
+        std::vector<uint8_t> banded(row_bytes * height);
+        int next_y = 0;
+        Halftoner(parallel).process(raster, [&](int y, const uint8_t* packed) {
+            EXPECT_EQ(y, next_y++);
+            std::memcpy(banded.data() + y * row_bytes, packed, row_bytes);
+        });
+        EXPECT_EQ(banded, expected);
+    }
+}
+
+TEST_F(RasterTest, HalftoneRejectsUnknownInput) {
+    EXPECT_EQ(parse_halftone_method("jarvis"), HalftoneMethod::JARVIS);
+    EXPECT_THROW(parse_halftone_method("stochastic"), std::invalid_argument);
+
+    TiledRaster rgb(16, 16, PixelFormat::RGB8);
+    EXPECT_THROW(Halftoner().process(rgb, [](int, const uint8_t*) {}), std::invalid_argument);
+}
+
+TEST_F(RasterTest, ColorKernelsMatchScalarReference) {
+    std::mt19937 rng(7);
+    for (int width : {1, 15, 16, 17, 63, 1000}) {
+        std::vector<uint8_t> rgb(static_cast<size_t>(width) * 3);
+        std::vector<uint8_t> cmyk(static_cast<size_t>(width) * 4);
+        std::vector<uint16_t> rgb16(static_cast<size_t>(width) * 3);
+        for (auto& v : rgb) v = static_cast<uint8_t>(rng());
+        for (auto& v : cmyk) v = static_cast<uint8_t>(rng());
+        for (auto& v : rgb16) v = static_cast<uint16_t>(rng());
+
+        std::vector<uint8_t> gray(width), gray_ref(width);
+        rgb_to_gray8(rgb.data(), width, gray.data());
+        reference::rgb_to_gray8(rgb.data(), width, gray_ref.data());
+        EXPECT_EQ(gray, gray_ref);
+
+        std::vector<uint16_t> gray16(width), gray16_ref(width);
+        rgb_to_gray16(rgb16.data(), width, gray16.data());
+        reference::rgb_to_gray16(rgb16.data(), width, gray16_ref.data());
+        EXPECT_EQ(gray16, gray16_ref);
+
+        std::vector<uint8_t> preview(rgb.size()), preview_ref(rgb.size());
+        cmyk_to_rgb8(cmyk.data(), width, preview.data());
+        reference::cmyk_to_rgb8(cmyk.data(), width, preview_ref.data());
+        EXPECT_EQ(preview, preview_ref);
+
+        for (int gcr : {0, 60, 100}) {
+            for (int tac : {100, 240, 400}) {
+                CmykSeparation separation{gcr, tac};
+                std::vector<uint8_t> out(cmyk.size()), out_ref(cmyk.size());
+                rgb_to_cmyk8(rgb.data(), width, out.data(), separation);
+                reference::rgb_to_cmyk8(rgb.data(), width, out_ref.data(), separation);
+                EXPECT_EQ(out, out_ref) << "gcr " << gcr << " tac " << tac;
+                for (int x = 0; x < width; ++x) {
+                    int total = out[x * 4] + out[x * 4 + 1] + out[x * 4 + 2] + out[x * 4 + 3];
+                    EXPECT_LE(total, tac * 255 / 100);
+                }
+            }
+        }
+    }
+
+    // Cinza neutro com GCR total vira só K
+    const uint8_t mid[3] = {128, 128, 128};
+    uint8_t k_only[4];
+    rgb_to_cmyk8(mid, 1, k_only);
+    EXPECT_EQ(k_only[0], 0);
+    EXPECT_EQ(k_only[1], 0);
+    EXPECT_EQ(k_only[2], 0);
+    EXPECT_EQ(k_only[3], 127);
+}
+
+TEST_F(RasterTest, ColorConverterRunsBandsInParallel) {
+    const int width = 1500;
+    const int height = 700;
+    auto sheet = make_sheet(width, height, 3);
+    for (size_t i = 0; i < sheet.size(); i += 5) {
+        sheet[i] = static_cast<uint8_t>(i * 31);
+    }
+
+    ColorConvertOptions options;
+    options.threads = 4;
+    options.band_rows = 32;
+    ColorConverter converter(options);
+
+    std::vector<uint8_t> expected(static_cast<size_t>(width) * height * 4);
+    for (int y = 0; y < height; ++y) {
+        reference::rgb_to_cmyk8(sheet.data() + static_cast<size_t>(y) * width * 3, width,
+                                expected.data() + static_cast<size_t>(y) * width * 4);
+    }
+    std::vector<uint8_t> cmyk(expected.size());
+    converter.convert(sheet.data(), PixelFormat::RGB8, cmyk.data(), PixelFormat::CMYK8,
+                      width, height);
+    EXPECT_EQ(cmyk, expected);
+
+    // Página em tiles: mesmo resultado e tiles em branco preservados
+    auto page = TiledRaster::from_buffer(sheet.data(), width, height, PixelFormat::RGB8);
+    auto separated = converter.convert(page, PixelFormat::CMYK8);
+    EXPECT_EQ(separated.format(), PixelFormat::CMYK8);
+    EXPECT_EQ(separated.to_buffer(), expected);
+    EXPECT_EQ(separated.stats().blank_tiles, page.stats().blank_tiles);
+}
+
+TEST_F(RasterTest, PnmRoundTrip) {
+    const std::string path = "/tmp/all_press_test_image.pam";
+
+    Image cmyk;
+    cmyk.width = 5;
+    cmyk.height = 3;
+    cmyk.format = PixelFormat::CMYK8;
+    cmyk.data.resize(cmyk.row_bytes() * cmyk.height);
+    for (size_t i = 0; i < cmyk.data.size(); ++i) cmyk.data[i] = static_cast<uint8_t>(i * 13);
+    write_pnm(path, cmyk);
+    Image loaded = read_pnm(path);
+    EXPECT_EQ(loaded.format, PixelFormat::CMYK8);
+    EXPECT_EQ(loaded.data, cmyk.data);
+
+    Image deep;
+    deep.width = 4;
+    deep.height = 2;
+    deep.format = PixelFormat::RGB8;
+    deep.bit_depth = 16;
+    deep.data.resize(deep.row_bytes() * deep.height);
+    for (int i = 0; i < 24; ++i) deep.samples16()[i] = static_cast<uint16_t>(i * 2741);
+    write_pnm(path, deep);
+    loaded = read_pnm(path);
+    EXPECT_EQ(loaded.bit_depth, 16);
+    EXPECT_EQ(loaded.data, deep.data);
+
+    std::remove(path.c_str());
+    EXPECT_THROW(read_pnm(path), std::runtime_error);
+}
+
+TEST_F(RasterTest, IccProfileParsesMatrixAndLutProfiles) {
+    const auto bytes = matrix_trc_profile();
+    auto rgb = IccProfile::parse(bytes.data(), bytes.size());
+    EXPECT_EQ(rgb->color_space(), IccColorSpace::RGB);
+    EXPECT_EQ(rgb->header().device_class, "prtr");
+    EXPECT_TRUE(rgb->is_matrix_trc());
+    EXPECT_EQ(rgb->description(), "Test RGB 22");
+
+    const double white[3] = {1.0, 1.0, 1.0};
+    double xyz[3];
+    rgb->to_pcs(white, xyz, RenderingIntent::PERCEPTUAL);
+    EXPECT_NEAR(xyz[0], 0.9642, 1e-3);
+    EXPECT_NEAR(xyz[1], 1.0, 1e-3);
+    EXPECT_NEAR(xyz[2], 0.8249, 1e-3);
+
+    const auto lut = cmyk_lut_profile();
+    auto cmyk = IccProfile::parse(lut.data(), lut.size());
+    EXPECT_EQ(cmyk->channels(), 4);
+    EXPECT_FALSE(cmyk->can_output());
+    const double paper[4] = {0.0, 0.0, 0.0, 0.0};
+    cmyk->to_pcs(paper, xyz, RenderingIntent::RELATIVE_COLORIMETRIC);
+    EXPECT_NEAR(xyz[1], 1.0, 1e-3);
+    EXPECT_NE(cmyk->id(), rgb->id());
+
+    const std::vector<uint8_t> garbage(256, 0x41);
+    EXPECT_THROW(IccProfile::parse(garbage.data(), garbage.size()), std::runtime_error);
+    EXPECT_THROW(IccProfile::parse(bytes.data(), bytes.size() - 20), std::runtime_error);
+    EXPECT_THROW(IccTransform::build(*IccProfile::srgb(), *cmyk, RenderingIntent::PERCEPTUAL),
+                 std::invalid_argument);
+}
+
+TEST_F(RasterTest, IccTransformMatchesDirectEvaluation) {
+    const auto bytes = matrix_trc_profile();
+    const auto lut = cmyk_lut_profile();
+    auto rgb = IccProfile::parse(bytes.data(), bytes.size());
+    auto cmyk = IccProfile::parse(lut.data(), lut.size());
+    auto srgb = IccProfile::srgb();
+    auto gray = IccProfile::gray();
+
+    EXPECT_LE(max_transform_error(*rgb, *srgb, RenderingIntent::PERCEPTUAL, 20000), 2);
+    // Grade 17 em 4D: o erro maior fica nas sombras, onde a curva sRGB é íngreme
+    EXPECT_LE(max_transform_error(*cmyk, *srgb, RenderingIntent::RELATIVE_COLORIMETRIC, 20000), 6);
+    EXPECT_LE(max_transform_error(*srgb, *gray, RenderingIntent::PERCEPTUAL, 5000), 2);
+    EXPECT_LE(max_transform_error(*gray, *srgb, RenderingIntent::PERCEPTUAL, 256), 1);
+
+    // sRGB -> sRGB é a identidade, em paralelo por faixas
+    IccTransformOptions options;
+    options.threads = 3;
+    options.band_rows = 7;
+    auto identity = IccTransform::build(*srgb, *srgb, RenderingIntent::PERCEPTUAL, options);
+    const int width = 300, height = 50;
+    std::vector<uint8_t> image(static_cast<size_t>(width) * height * 3);
+    for (size_t i = 0; i < image.size(); ++i) image[i] = static_cast<uint8_t>(i * 37 + i / 3);
+    std::vector<uint8_t> result(image.size());
+    identity->apply(image.data(), result.data(), width, height);
+    for (size_t i = 0; i < image.size(); ++i) {
+        ASSERT_LE(std::abs(result[i] - image[i]), 1) << "sample " << i;
+    }
+}
+
+TEST_F(RasterTest, IccTransformCacheBuildsOnce) {
+    IccTransformCache cache(2);
+    auto srgb = IccProfile::srgb();
+    auto gray = IccProfile::gray();
+
+    auto first = cache.get(*srgb, *gray, RenderingIntent::PERCEPTUAL);
+    auto second = cache.get(*srgb, *gray, RenderingIntent::PERCEPTUAL);
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_EQ(cache.stats().builds, 1u);
+    EXPECT_EQ(cache.stats().hits, 1u);
+
+    // Outra intenção é outra entrada; a terceira chave expulsa a menos recente
+    cache.get(*srgb, *gray, RenderingIntent::SATURATION);
+    cache.get(*gray, *srgb, RenderingIntent::PERCEPTUAL);
+    EXPECT_EQ(cache.size(), 2u);
+    auto rebuilt = cache.get(*srgb, *gray, RenderingIntent::PERCEPTUAL);
+    EXPECT_NE(rebuilt.get(), first.get());
+    EXPECT_EQ(cache.stats().builds, 4u);
+}
+
+TEST_F(RasterTest, IccCatalogScansAndReusesIndex) {
+    namespace fs = std::filesystem;
+    const fs::path dir = fs::temp_directory_path() / "all_press_icc_catalog_test";
+    fs::remove_all(dir);
+    fs::create_directories(dir / "vendor");
+    auto write = [](const fs::path& path, const std::vector<uint8_t>& bytes) {
+        std::ofstream(path, std::ios::binary).write(reinterpret_cast<const char*>(bytes.data()),
+                                                    static_cast<std::streamsize>(bytes.size()));
+    };
+    write(dir / "rgb22.icc", matrix_trc_profile());
+    write(dir / "vendor" / "press.ICM", cmyk_lut_profile());
+    write(dir / "broken.icc", std::vector<uint8_t>(300, 0x20));
+    write(dir / "readme.txt", std::vector<uint8_t>(10, 0x41));
+
+    IccCatalogOptions options;
+    options.index_path = (dir / "index" / "icc.tsv").string();
+    options.threads = 3;
+    IccCatalog catalog(options);
+    auto stats = catalog.scan({dir.string()});
+    EXPECT_EQ(stats.files, 3u);
+    EXPECT_EQ(stats.parsed, 2u);
+    EXPECT_EQ(stats.invalid, 1u);
+    EXPECT_EQ(catalog.size(), 2u);
+
+    IccCatalogEntry entry;
+    ASSERT_TRUE(catalog.find("rgb22", entry));
+    EXPECT_EQ(entry.info.description, "Test RGB 22");
+    EXPECT_EQ(entry.info.header.color_space, IccColorSpace::RGB);
+    ASSERT_TRUE(catalog.find("press", entry));
+    EXPECT_EQ(entry.info.header.pcs, IccColorSpace::LAB);
+
+    // Tabelas só na primeira consulta, depois do cache
+    auto profile = catalog.profile("press");
+    EXPECT_EQ(profile->channels(), 4);
+    EXPECT_EQ(catalog.profile(entry.path).get(), profile.get());
+    EXPECT_THROW(catalog.profile("missing"), std::runtime_error);
+
+    // Nova instância: tudo vem do índice, exceto o arquivo alterado
+    IccCatalog restarted(options);
+    stats = restarted.scan({dir.string()});
+    EXPECT_EQ(stats.parsed, 0u);
+    EXPECT_EQ(stats.reused, 2u);
+    ASSERT_TRUE(restarted.find("rgb22", entry));
+    EXPECT_EQ(entry.info.description, "Test RGB 22");
+
+    auto changed = matrix_trc_profile();
+    changed.resize(changed.size() + 16, 0);
+    changed[3] = static_cast<uint8_t>(changed[3] + 16);
+    write(dir / "rgb22.icc", changed);
+    stats = restarted.scan({dir.string()});
+    EXPECT_EQ(stats.parsed, 1u);
+    EXPECT_EQ(stats.reused, 1u);
+
+    EXPECT_THROW(IccCatalog::inspect_file((dir / "broken.icc").string()), std::runtime_error);
+    fs::remove_all(dir);
+}
+
+TEST_F(RasterTest, CalibrationLutMatchesScalarTables) {
+    ToneCurves curves;
+    curves[static_cast<int>(ToneChannel::GRAY)].gamma = 1.8;
+    curves[static_cast<int>(ToneChannel::RED)].gain = 0.9;
+    curves[static_cast<int>(ToneChannel::BLUE)].offset = 0.05;
+    curves[static_cast<int>(ToneChannel::BLACK)].gamma = 0.8;
+    auto lut = CalibrationLut::build(curves, 7);
+    EXPECT_EQ(lut->version(), 7u);
+    EXPECT_TRUE(lut->is_identity(PixelFormat::GRAY8) == false);
+    EXPECT_TRUE(lut->is_monotonic(ToneChannel::GRAY));
+    EXPECT_TRUE(lut->preserves_blank(PixelFormat::GRAY8));
+    EXPECT_FALSE(lut->preserves_blank(PixelFormat::RGB8));
+    EXPECT_TRUE(lut->preserves_blank(PixelFormat::CMYK8));
+    EXPECT_EQ(lut->table16(ToneChannel::GREEN), nullptr);
+
+    std::mt19937 rng(11);
+    std::vector<uint8_t> data(1001);
+    for (auto& v : data) v = static_cast<uint8_t>(rng());
+
+    // Kernel SIMD de uma tabela contra a consulta escalar
+    const uint8_t* gray = lut->table8(ToneChannel::GRAY);
+    std::vector<uint8_t> expected(data.size());
+    for (size_t i = 0; i < data.size(); ++i) expected[i] = gray[data[i]];
+    std::vector<uint8_t> toned = data;
+    apply_lut8(gray, toned.data(), toned.size());
+    EXPECT_EQ(toned, expected);
+
+    // Canais entrelaçados com tabelas diferentes
+    std::vector<uint8_t> rgb(data.begin(), data.begin() + 999);
+    std::vector<uint8_t> rgb_expected(rgb.size());
+    for (size_t i = 0; i < rgb.size(); ++i) {
+        rgb_expected[i] = lut->table8(static_cast<ToneChannel>(1 + i % 3))[rgb[i]];
+    }
+    lut->apply(rgb.data(), PixelFormat::RGB8, rgb.size() / 3);
+    EXPECT_EQ(rgb, rgb_expected);
+
+    std::vector<uint16_t> deep = {0, 1000, 32768, 65535};
+    lut->apply16(deep.data(), PixelFormat::GRAY8, deep.size());
+    EXPECT_EQ(deep[0], 0);
+    EXPECT_EQ(deep[3], 65535);
+    EXPECT_NEAR(deep[2], std::pow(32768.0 / 65535.0, 1.8) * 65535.0, 0.5);
+
+    curves[0].gamma = 0.0;
+    EXPECT_THROW(CalibrationLut::build(curves), std::invalid_argument);
+    EXPECT_THROW(parse_tone_channel("orange"), std::invalid_argument);
+}
+
+TEST_F(RasterTest, CalibrationIsFusedIntoConversionAndHalftone) {
+    const int width = 700;
+    const int height = 90;
+    auto sheet = make_sheet(width, height, 3);
+    for (size_t i = 0; i < sheet.size(); i += 7) sheet[i] = static_cast<uint8_t>(i * 13);
+
+    ToneCurves curves;
+    curves[static_cast<int>(ToneChannel::GRAY)].gamma = 1.6;
+    curves[static_cast<int>(ToneChannel::CYAN)].gain = 0.85;
+    curves[static_cast<int>(ToneChannel::BLACK)].gamma = 1.2;
+    auto lut = CalibrationLut::build(curves, 1);
+
+    // Conversão com calibração = conversão seguida da tabela
+    ColorConvertOptions options;
+    options.calibration = lut;
+    options.band_rows = 16;
+    std::vector<uint8_t> fused(static_cast<size_t>(width) * height * 4);
+    ColorConverter(options).convert(sheet.data(), PixelFormat::RGB8, fused.data(),
+                                    PixelFormat::CMYK8, width, height);
+    std::vector<uint8_t> separate(fused.size());
+    ColorConverter().convert(sheet.data(), PixelFormat::RGB8, separate.data(),
+                             PixelFormat::CMYK8, width, height);
+    lut->apply(separate.data(), PixelFormat::CMYK8, static_cast<size_t>(width) * height);
+    EXPECT_EQ(fused, separate);
+
+    std::vector<uint8_t> gray(static_cast<size_t>(width) * height);
+    ColorConverter().convert(sheet.data(), PixelFormat::RGB8, gray.data(), PixelFormat::GRAY8,
+                             width, height);
+    std::vector<uint8_t> toned = gray;
+    lut->apply(toned.data(), PixelFormat::GRAY8, toned.size());
+
+    // Meio-tom: curva dobrada nos limiares (monotônica), curva consultada por
+    // pixel (não preserva o branco) e difusão de erro dão o mesmo que
+    // aplicar a tabela antes
+    ToneCurves lighter = curves;
+    lighter[static_cast<int>(ToneChannel::GRAY)].gain = 0.9;
+    auto unfoldable = CalibrationLut::build(lighter, 2);
+    std::vector<uint8_t> toned_unfoldable = gray;
+    unfoldable->apply(toned_unfoldable.data(), PixelFormat::GRAY8, gray.size());
+
+    const size_t packed = packed_row_bytes(width) * height;
+    for (HalftoneMethod method : {HalftoneMethod::BLUE_NOISE, HalftoneMethod::BAYER,
+                                  HalftoneMethod::FLOYD_STEINBERG}) {
+        for (const auto& pair : {std::make_pair(lut, &toned),
+                                 std::make_pair(unfoldable, &toned_unfoldable)}) {
+            HalftoneOptions plain;
+            plain.method = method;
+            plain.threads = 2;
+            HalftoneOptions calibrated = plain;
+            calibrated.calibration = pair.first;
+
+            std::vector<uint8_t> expected(packed), result(packed);
+            Halftoner(plain).process(pair.second->data(), width, height, width, expected.data());
+            Halftoner(calibrated).process(gray.data(), width, height, width, result.data());
+            EXPECT_EQ(result, expected) << "method " << static_cast<int>(method)
+                                        << " version " << pair.first->version();
+        }
+    }
+}
+
+TEST_F(RasterTest, InkCoverageSamplingStaysWithinBound) {
+    // Folha RGB com degradê, faixa vermelha e linhas pretas finas
+    Image sheet;
+    sheet.width = 3000;
+    sheet.height = 2000;
+    sheet.format = PixelFormat::RGB8;
+    sheet.data.assign(sheet.row_bytes() * sheet.height, 255);
+    for (int y = 0; y < sheet.height; ++y) {
+        uint8_t* row = sheet.data.data() + sheet.row_bytes() * y;
+        for (int x = 0; x < sheet.width; ++x) {
+            uint8_t* px = row + x * 3;
+            if (x % 40 == 0) {
+                px[0] = px[1] = px[2] = 0;
+            } else if (y > 1500) {
+                px[0] = 230; px[1] = 20; px[2] = 30;
+            } else {
+                px[0] = px[1] = px[2] = static_cast<uint8_t>(x * 255 / sheet.width);
+            }
+        }
+    }
+
+    // Referência exata: erro pequeno o bastante para ler todos os pixels
+    InkCoverageOptions exact_options;
+    exact_options.max_error = 0.0005;
+    InkCoverageAnalyzer exact_analyzer(exact_options);
+    ASSERT_GE(exact_analyzer.sample_size(), sheet.width * static_cast<uint64_t>(sheet.height));
+    const InkCoverage exact = exact_analyzer.analyze(sheet);
+    EXPECT_TRUE(exact.exhaustive);
+    EXPECT_EQ(exact.error_bound, 0.0);
+
+    InkCoverageAnalyzer analyzer;
+    const InkCoverage estimate = analyzer.analyze(sheet);
+    EXPECT_FALSE(estimate.exhaustive);
+    EXPECT_LT(estimate.samples, 40000u);
+    EXPECT_LE(estimate.error_bound, 0.01);
+    for (int c = 0; c < 4; ++c) {
+        EXPECT_NEAR(estimate.coverage[c], exact.coverage[c], estimate.error_bound) << "channel " << c;
+    }
+    EXPECT_TRUE(estimate.has_color);
+    EXPECT_NEAR(estimate.color_fraction, exact.color_fraction, estimate.error_bound);
+
+    // Mesma amostragem direto do arquivo mapeado (PPM de 8 e PAM de 16 bits)
+    const std::string ppm = "/tmp/all_press_test_coverage.ppm";
+    write_pnm(ppm, sheet);
+    const InkCoverage from_file = analyzer.analyze_file(ppm);
+    EXPECT_EQ(from_file.histogram, estimate.histogram);
+
+    Image wide = sheet;
+    wide.bit_depth = 16;
+    wide.data.resize(sheet.data.size() * 2);
+    for (size_t i = 0; i < sheet.data.size(); ++i) {
+        wide.samples16()[i] = static_cast<uint16_t>(sheet.data[i] * 257);
+    }
+    const std::string pam = "/tmp/all_press_test_coverage16.ppm";
+    write_pnm(pam, wide);
+    EXPECT_EQ(analyzer.analyze_file(pam).histogram, estimate.histogram);
+    EXPECT_EQ(analyzer.analyze(wide).histogram, estimate.histogram);
+    std::remove(ppm.c_str());
+    std::remove(pam.c_str());
+
+    // Cinza e CMYK só com preto: monocromático
+    std::vector<uint8_t> gray(static_cast<size_t>(sheet.width) * sheet.height);
+    rgb_to_gray8(sheet.data.data(), sheet.width * sheet.height, gray.data());
+    const InkCoverage mono = analyzer.analyze(gray.data(), sheet.width, sheet.height,
+                                              sheet.width, PixelFormat::GRAY8);
+    EXPECT_FALSE(mono.has_color);
+    EXPECT_EQ(mono.coverage[0] + mono.coverage[1] + mono.coverage[2], 0.0);
+    EXPECT_GT(mono.coverage[3], 0.0);
+
+    std::vector<uint8_t> black_only(static_cast<size_t>(150) * 100 * 4, 0);
+    for (size_t i = 3; i < black_only.size(); i += 8) black_only[i] = 255;
+    const InkCoverage cmyk = analyzer.analyze(black_only.data(), 150, 100, 150 * 4, PixelFormat::CMYK8);
+    EXPECT_TRUE(cmyk.exhaustive);
+    EXPECT_FALSE(cmyk.has_color);
+    EXPECT_NEAR(cmyk.coverage[3], 0.5, 1e-12);
+
+    // Documento: média ponderada pela área, cor se alguma página tiver
+    const InkCoverage document = merge_coverage({mono, cmyk, estimate});
+    EXPECT_TRUE(document.has_color);
+    const double pixels = 2.0 * sheet.width * sheet.height + 150.0 * 100;
+    EXPECT_NEAR(document.coverage[3],
+                (mono.coverage[3] * mono.pixels() + 0.5 * 15000 + estimate.coverage[3] * estimate.pixels()) / pixels,
+                1e-9);
+    EXPECT_NEAR(document.confidence, 1.0 - 2 * (1.0 - analyzer.options().confidence), 1e-12);
+
+    InkCostModel model;
+    const InkCostEstimate cost = estimate_ink_cost(cmyk, 2.0, 3, model);
+    EXPECT_NEAR(cost.ink_ml[3], 0.5 * model.ml_per_m2[3] * 6.0, 1e-9);
+    EXPECT_NEAR(cost.total, cost.ink_ml[3] * model.price_per_ml[3] + 6.0 * model.media_price_per_m2, 1e-9);
+    EXPECT_EQ(cost.margin, 0.0);
+}
+
+namespace {
+
+// Referência direta em double, com a mesma saturação em 8 bits entre as
+// passadas horizontal e vertical
+std::vector<uint8_t> reference_resample(const std::vector<uint8_t>& src, int sw, int sh,
+                                        int channels, int dw, int dh, ResampleFilter filter) {
+    auto weights = [filter](int s, int d, int i, std::vector<std::pair<int, double>>& out) {
+        const double scale = static_cast<double>(s) / d;
+        const double support = std::max(scale, 1.0);
+        const double radius = filter == ResampleFilter::BOX ? 0.5 * support : 3.0 * support;
+        const double center = (i + 0.5) * scale;
+        out.clear();
+        double total = 0.0;
+        for (int j = 0; j < s; ++j) {
+            double w;
+            if (filter == ResampleFilter::BOX) {
+                w = std::max(0.0, std::min(j + 1.0, center + radius) - std::max<double>(j, center - radius));
+            } else {
+                const double x = std::fabs((j + 0.5 - center) / support);
+                const double px = 3.14159265358979323846 * x;
+                w = x < 1e-9 ? 1.0 : (x >= 3.0 ? 0.0 : 3.0 * std::sin(px) * std::sin(px / 3.0) / (px * px));
+            }
+            if (w != 0.0) {
+                out.emplace_back(j, w);
+                total += w;
+            }
+        }
+        for (auto& p : out) p.second /= total;
+    };
+    auto clamp8 = [](double v) { return static_cast<uint8_t>(std::min(255.0, std::max(0.0, std::round(v)))); };
+
+    std::vector<uint8_t> mid(static_cast<size_t>(sh) * dw * channels);
+    std::vector<std::pair<int, double>> w;
+    for (int x = 0; x < dw; ++x) {
+        weights(sw, dw, x, w);
+        for (int y = 0; y < sh; ++y) {
+            for (int c = 0; c < channels; ++c) {
+                double sum = 0.0;
+                for (const auto& p : w) sum += p.second * src[(static_cast<size_t>(y) * sw + p.first) * channels + c];
+                mid[(static_cast<size_t>(y) * dw + x) * channels + c] = clamp8(sum);
+            }
+        }
+    }
+    std::vector<uint8_t> out(static_cast<size_t>(dh) * dw * channels);
+    for (int y = 0; y < dh; ++y) {
+        weights(sh, dh, y, w);
+        for (size_t i = 0; i < static_cast<size_t>(dw) * channels; ++i) {
+            double sum = 0.0;
+            for (const auto& p : w) sum += p.second * mid[static_cast<size_t>(p.first) * dw * channels + i];
+            out[static_cast<size_t>(y) * dw * channels + i] = clamp8(sum);
+        }
+    }
+    return out;
+}
+
+}  // namespace
+
+TEST_F(RasterTest, ResamplerMatchesReferenceAndIsThreadInvariant) {
+    std::mt19937 rng(7);
+    const int sw = 331;
+    const int sh = 157;
+    for (PixelFormat format : {PixelFormat::GRAY8, PixelFormat::RGB8, PixelFormat::CMYK8}) {
+        const int channels = bytes_per_pixel(format);
+        // Degradê suave com ruído: testa nitidez e bordas sem saturar tudo
+        std::vector<uint8_t> src(static_cast<size_t>(sw) * sh * channels);
+        for (int y = 0; y < sh; ++y) {
+            for (int x = 0; x < sw; ++x) {
+                for (int c = 0; c < channels; ++c) {
+                    const int v = (x * 255 / sw + y * (c + 1)) / 2 + static_cast<int>(rng() % 64);
+                    src[(static_cast<size_t>(y) * sw + x) * channels + c] = static_cast<uint8_t>(std::min(v, 255));
+                }
+            }
+        }
+
+        for (ResampleFilter filter : {ResampleFilter::BOX, ResampleFilter::LANCZOS3}) {
+            for (auto size : {std::make_pair(97, 61), std::make_pair(165, 78), std::make_pair(400, 200)}) {
+                const int dw = size.first;
+                const int dh = size.second;
+                const auto expected = reference_resample(src, sw, sh, channels, dw, dh, filter);
+
+                ResampleOptions options;
+                options.filter = filter;
+                options.threads = 1;
+                options.band_rows = 7;
+                std::vector<uint8_t> serial(expected.size());
+                Resampler(sw, sh, dw, dh, format, options)
+                    .process(src.data(), static_cast<size_t>(sw) * channels, serial.data(),
+                             static_cast<size_t>(dw) * channels);
+                int worst = 0;
+                for (size_t i = 0; i < expected.size(); ++i) {
+                    worst = std::max(worst, std::abs(serial[i] - expected[i]));
+                }
+                // Pesos em ponto fixo de 14 bits: no máximo 1 nível nas duas passadas
+                EXPECT_LE(worst, 2) << "format " << channels << " filter " << static_cast<int>(filter)
+                                    << " size " << dw << "x" << dh;
+
+                options.threads = 4;
+                options.band_rows = 16;
+                std::vector<uint8_t> parallel(expected.size());
+                Resampler(sw, sh, dw, dh, format, options)
+                    .process(src.data(), static_cast<size_t>(sw) * channels, parallel.data(),
+                             static_cast<size_t>(dw) * channels);
+                EXPECT_EQ(parallel, serial);
+
+                // Em fluxo: mesmas linhas, lidas e entregues em ordem
+                options.band_rows = 5;
+                std::vector<uint8_t> streamed;
+                int read_rows = 0;
+                Resampler(sw, sh, dw, dh, format, options)
+                    .process_rows(
+                        [&](uint8_t* dst, int rows) {
+                            ASSERT_LE(read_rows + rows, sh);
+                            std::memcpy(dst, src.data() + static_cast<size_t>(read_rows) * sw * channels,
+                                        static_cast<size_t>(rows) * sw * channels);
+                            read_rows += rows;
+                        },
+                        [&](const uint8_t* row) {
+                            streamed.insert(streamed.end(), row, row + static_cast<size_t>(dw) * channels);
+                        });
+                EXPECT_EQ(streamed, serial);
+            }
+        }
+    }
+
+    // Áreas chapadas continuam exatamente iguais
+    Image flat;
+    flat.width = 640;
+    flat.height = 480;
+    flat.format = PixelFormat::RGB8;
+    flat.data.assign(flat.row_bytes() * flat.height, 0);
+    for (size_t i = 0; i < flat.data.size(); i += 3) {
+        flat.data[i] = 200;
+        flat.data[i + 1] = 17;
+        flat.data[i + 2] = 255;
+    }
+    const Image small = resample(flat, 213, 160);
+    for (size_t i = 0; i < small.data.size(); i += 3) {
+        ASSERT_EQ(small.data[i], 200);
+        ASSERT_EQ(small.data[i + 1], 17);
+        ASSERT_EQ(small.data[i + 2], 255);
+    }
+
+    int w = 0;
+    int h = 0;
+    DownsampleLimits limits;
+    limits.max_width = 2000;
+    limits.max_height = 2000;
+    EXPECT_FALSE(plan_downsample(1800, 1200, limits, w, h));   // Já cabe
+    EXPECT_EQ(w, 1800);
+    EXPECT_FALSE(plan_downsample(2300, 1000, limits, w, h));   // Só 1.15x
+    EXPECT_TRUE(plan_downsample(8000, 6000, limits, w, h));
+    EXPECT_EQ(w, 2000);
+    EXPECT_EQ(h, 1500);
+    limits.min_factor = 1.0;                                    // Limite rígido
+    EXPECT_TRUE(plan_downsample(2300, 1000, limits, w, h));
+    EXPECT_EQ(w, 2000);
+    EXPECT_EQ(h, 870);
+}
+
+TEST_F(RasterTest, TrimFindsInkExtentAndDropsBlankPages) {
+    // Tolerância nos dois sentidos do branco, em todos os restos do laço SIMD
+    for (size_t bytes : {1u, 15u, 16u, 63u, 64u, 100u}) {
+        std::vector<uint8_t> row(bytes, 0xFF);
+        row.back() = 255 - 8;
+        EXPECT_FALSE(row_has_ink(row.data(), bytes, PixelFormat::RGB8, 8));
+        EXPECT_TRUE(row_has_ink(row.data(), bytes, PixelFormat::RGB8, 7));
+        std::vector<uint8_t> cmyk(bytes, 0);
+        cmyk.front() = 8;
+        EXPECT_FALSE(row_has_ink(cmyk.data(), bytes, PixelFormat::CMYK8, 8));
+        EXPECT_TRUE(row_has_ink(cmyk.data(), bytes, PixelFormat::CMYK8, 0));
+    }
+
+    // Folha com tinta só nas linhas 300..420, num tile do meio
+    const int width = 700;
+    const int height = 1000;
+    std::vector<uint8_t> data(static_cast<size_t>(width) * height, 0xFF);
+    for (int y = 300; y <= 420; ++y) data[static_cast<size_t>(y) * width + 400] = 0;
+    data[static_cast<size_t>(900) * width + 10] = 250;   // Sujeira abaixo da tolerância
+
+    InkExtent buffer_extent = find_ink_extent(data.data(), width, height, width, PixelFormat::GRAY8, 8);
+    TiledRasterOptions options;
+    options.tile_size = 128;
+    const auto page = TiledRaster::from_buffer(data.data(), width, height, PixelFormat::GRAY8, options);
+    InkExtent tiled_extent = find_ink_extent(page, 8);
+    for (const auto& extent : {buffer_extent, tiled_extent}) {
+        EXPECT_FALSE(extent.blank);
+        EXPECT_EQ(extent.first_row, 300);
+        EXPECT_EQ(extent.last_row, 420);
+    }
+    EXPECT_EQ(find_ink_extent(page, 0).last_row, 900);
+
+    TrimOptions trim;
+    trim.margin_rows = 20;
+    TrimPlan plan = plan_trim(tiled_extent, height, trim);
+    EXPECT_EQ(plan.first_row, 0);
+    EXPECT_EQ(plan.rows, 441);
+    EXPECT_EQ(plan.removed_rows, 559);
+    trim.trim_leading = true;
+    plan = plan_trim(tiled_extent, height, trim);
+    EXPECT_EQ(plan.first_row, 280);
+    EXPECT_EQ(plan.rows, 161);
+
+    const auto cropped = crop_rows(page, plan.first_row, plan.rows);
+    EXPECT_EQ(cropped.height(), 161);
+    EXPECT_EQ(cropped.tile_size(), 128);
+    std::vector<uint8_t> expected(data.begin() + static_cast<size_t>(280) * width,
+                                  data.begin() + static_cast<size_t>(441) * width);
+    EXPECT_EQ(cropped.to_buffer(), expected);
+    EXPECT_THROW(crop_rows(page, 900, 200), std::out_of_range);
+
+    // Arquivo com várias páginas: a do meio em branco
+    const std::string path = "/tmp/all_press_test_pages.pgm";
+    const std::string part = "/tmp/all_press_test_part.pgm";
+    Image sheet;
+    sheet.width = width;
+    sheet.height = height;
+    sheet.data = data;
+    Image blank = sheet;
+    std::fill(blank.data.begin(), blank.data.end(), 0xFF);
+    {
+        std::ofstream out(path, std::ios::binary);
+        for (const Image* image : {&sheet, &blank, &sheet}) {
+            write_pnm(part, *image);
+            std::ifstream in(part, std::ios::binary);
+            out << in.rdbuf();
+        }
+    }
+    const auto pages = read_pnm_pages(path);
+    ASSERT_EQ(pages.size(), 3u);
+    int blank_pages = 0;
+    for (const auto& image : pages) {
+        const auto tiled = TiledRaster::from_buffer(image.data.data(), image.width, image.height,
+                                                    image.format, options);
+        blank_pages += find_ink_extent(tiled, 8).blank;
+    }
+    EXPECT_EQ(blank_pages, 1);
+
+    // Leitura em sequência: página lida em partes, página pulada
+    PnmPageReader reader(path);
+    ASSERT_TRUE(reader.next_page());
+    std::vector<uint8_t> rows(static_cast<size_t>(width) * 10);
+    reader.read_rows(rows.data(), 10);
+    EXPECT_TRUE(std::equal(rows.begin(), rows.end(), data.begin()));
+    const Image rest = reader.read_page();
+    EXPECT_EQ(rest.height, height - 10);
+    EXPECT_TRUE(std::equal(rest.data.begin(), rest.data.end(), data.begin() + rows.size()));
+    ASSERT_TRUE(reader.next_page());
+    ASSERT_TRUE(reader.next_page());
+    EXPECT_EQ(reader.read_page().data, data);
+    EXPECT_FALSE(reader.next_page());
+    EXPECT_THROW(reader.read_rows(rows.data(), 1), std::out_of_range);
+
+    // 16 bits sai pelo byte mais significativo
+    Image deep;
+    deep.width = 3;
+    deep.height = 2;
+    deep.format = PixelFormat::RGB8;
+    deep.bit_depth = 16;
+    deep.data.resize(deep.row_bytes() * deep.height);
+    for (int i = 0; i < 18; ++i) deep.samples16()[i] = static_cast<uint16_t>(i * 3001);
+    write_pnm(part, deep);
+    PnmPageReader deep_reader(part);
+    ASSERT_TRUE(deep_reader.next_page());
+    EXPECT_EQ(deep_reader.read_page().data, to_8bit(deep).data);
+
+    std::remove(part.c_str());
+    std::remove(path.c_str());
+}
+
+TEST_F(RasterTest, SkylineNestingPacksWithoutOverlap) {
+    std::mt19937 rng(41);
+    std::uniform_int_distribution<int> side(40, 300);
+    std::vector<NestItem> items;
+    int64_t area = 0;
+    for (int i = 0; i < 40; ++i) {
+        items.push_back(NestItem{i, side(rng), side(rng)});
+        area += static_cast<int64_t>(items.back().width) * items.back().height;
+    }
+    items.push_back(NestItem{40, 1200, 100});   // Só cabe girada
+    items.push_back(NestItem{41, 1200, 1100});  // Não cabe
+    NestOptions options;
+    options.gap = 12;
+    const int roll = 1000;
+    const NestLayout layout = pack_skyline(items, roll, options);
+
+    ASSERT_EQ(layout.rejected, std::vector<int>{41});
+    ASSERT_EQ(layout.placements.size(), 41u);
+    for (size_t i = 0; i < layout.placements.size(); ++i) {
+        const auto& a = layout.placements[i];
+        EXPECT_GE(a.x, options.gap);
+        EXPECT_GE(a.y, options.gap);
+        EXPECT_LE(a.x + a.width, roll);
+        EXPECT_LE(a.y + a.height + options.gap, layout.length);
+        const auto& item = items[a.id];
+        EXPECT_EQ(a.rotated ? item.height : item.width, a.width);
+        if (a.id == 40) {
+            EXPECT_TRUE(a.rotated);
+        }
+        for (size_t j = i + 1; j < layout.placements.size(); ++j) {
+            const auto& b = layout.placements[j];
+            const bool apart = a.x + a.width + options.gap <= b.x || b.x + b.width + options.gap <= a.x ||
+                               a.y + a.height + options.gap <= b.y || b.y + b.height + options.gap <= a.y;
+            EXPECT_TRUE(apart) << a.id << " overlaps " << b.id;
+        }
+    }
+    // Ocupação razoável do rolo, mesmo com calhas
+    EXPECT_GT(static_cast<double>(area + 1200 * 100) / (static_cast<double>(roll) * layout.length), 0.6);
+
+    // Composição: página girada no lugar certo, marcas e rótulos na calha
+    Image a;
+    a.width = 30;
+    a.height = 20;
+    a.format = PixelFormat::GRAY8;
+    a.data.resize(a.row_bytes() * a.height);
+    for (size_t i = 0; i < a.data.size(); ++i) a.data[i] = static_cast<uint8_t>(i % 200);
+    Image b = a;
+    b.width = 20;
+    b.height = 30;
+    NestLayout two = pack_skyline({{0, 30, 20}, {1, 20, 30}}, 60, options);
+    ASSERT_EQ(two.placements.size(), 2u);
+    NestComposeOptions compose;
+    compose.mark_length = 5;
+    compose.label_scale = 1;
+    const std::vector<const Image*> images{&a, &b};
+    const auto sheet = compose_nest(two, images, PixelFormat::GRAY8, {"#7", "#8"}, compose);
+    EXPECT_EQ(sheet.width(), 60);
+    EXPECT_EQ(sheet.height(), two.length);
+    const auto pixels = sheet.to_buffer();
+    auto at = [&](int x, int y) { return pixels[static_cast<size_t>(y) * 60 + x]; };
+    for (const auto& p : two.placements) {
+        const Image& src = p.id == 0 ? a : b;
+        for (int v = 0; v < p.height; ++v) {
+            for (int u = 0; u < p.width; ++u) {
+                const int sx = p.rotated ? v : u;
+                const int sy = p.rotated ? src.height - 1 - u : v;
+                ASSERT_EQ(at(p.x + u, p.y + v), src.data[static_cast<size_t>(sy) * src.width + sx]);
+            }
+        }
+        EXPECT_EQ(at(p.x - 2, p.y), 0);                   // Marca horizontal
+        EXPECT_EQ(at(p.x, p.y - 2), 0);                   // Marca vertical
+        EXPECT_EQ(at(p.x - 1, p.y - 1), 0xFF);            // Canto livre
+        int label = 0;
+        for (int y = p.y + p.height + 1; y < p.y + p.height + 7; ++y) {
+            for (int x = p.x + 2; x < p.x + 10; ++x) label += at(x, y) == 0;
+        }
+        EXPECT_GT(label, 10);
+    }
+
+    // Páginas em tiles dão o mesmo rolo, lidas faixa a faixa
+    TiledRasterOptions small;
+    small.tile_size = 8;
+    const auto ta = TiledRaster::from_buffer(a.data.data(), a.width, a.height, a.format, small);
+    const auto tb = TiledRaster::from_buffer(b.data.data(), b.width, b.height, b.format, small);
+    const std::vector<const TiledRaster*> tiled{&ta, &tb};
+    EXPECT_EQ(compose_nest(two, tiled, PixelFormat::GRAY8, {"#7", "#8"}, compose).to_buffer(), pixels);
+
+    EXPECT_THROW(compose_nest(two, std::vector<const Image*>{&a, &a}, PixelFormat::GRAY8),
+                 std::invalid_argument);
+    EXPECT_THROW(compose_nest(two, std::vector<const TiledRaster*>{&ta, &ta}, PixelFormat::GRAY8),
+                 std::invalid_argument);
+}
+
+TEST_F(RasterTest, PathFillCoverageIsAntiAliased) {
+    // Retângulo com bordas em meio pixel e um furo par-ímpar
+    FillPath square;
+    square.rule = FillRule::EVEN_ODD;
+    square.contours = {{{2.5, 2.0}, {12.5, 2.0}, {12.5, 12.0}, {2.5, 12.0}},
+                       {{5.0, 5.0}, {9.0, 5.0}, {9.0, 9.0}, {5.0, 9.0}}};
+    square.color = {0, 0, 0, 0};
+    auto page = fill_paths({square}, 16, 16, PixelFormat::GRAY8);
+    auto pixels = page.to_buffer();
+    auto at = [&](int x, int y) { return static_cast<int>(pixels[static_cast<size_t>(y) * 16 + x]); };
+
+    EXPECT_EQ(at(0, 0), 255);
+    EXPECT_EQ(at(3, 3), 0);
+    EXPECT_NEAR(at(2, 3), 128, 1);    // Meia cobertura nas bordas verticais
+    EXPECT_NEAR(at(12, 3), 128, 1);
+    EXPECT_EQ(at(6, 6), 255);         // Furo
+    EXPECT_EQ(at(13, 13), 255);
+
+    // Mesmo contorno interno com NON_ZERO e orientação igual: sem furo
+    square.rule = FillRule::NON_ZERO;
+    pixels = fill_paths({square}, 16, 16, PixelFormat::GRAY8).to_buffer();
+    EXPECT_EQ(at(6, 6), 0);
+
+    // Traço: juntas e pontas redondas com a largura pedida; a soma da
+    // cobertura é a área do traço
+    FillPath stroke;
+    stroke.color = {0, 0, 0, 0};
+    stroke_polyline({{10.0, 10.0}, {50.0, 10.0}, {50.0, 40.0}}, 4.0, stroke.contours);
+    pixels = fill_paths({stroke}, 64, 64, PixelFormat::GRAY8).to_buffer();
+    double ink = 0.0;
+    for (uint8_t v : pixels) ink += (255 - v) / 255.0;
+    const double expected = 276.0 + 5.0 * 3.14159265;   // Retângulos, duas meias pontas e 1/4 de junta
+    EXPECT_NEAR(ink, expected, expected * 0.02);
+    EXPECT_EQ(pixels[static_cast<size_t>(10) * 64 + 30], 0);
+    EXPECT_EQ(pixels[static_cast<size_t>(14) * 64 + 30], 255);
+
+    // Ordem de desenho: o segundo path cobre o primeiro
+    FillPath red;
+    red.contours = {{{0, 0}, {8, 0}, {8, 8}, {0, 8}}};
+    red.color = {255, 0, 0, 0};
+    FillPath blue = red;
+    blue.contours = {{{4, 4}, {8, 4}, {8, 8}, {4, 8}}};
+    blue.color = {0, 0, 255, 0};
+    auto rgb = fill_paths({red, blue}, 8, 8, PixelFormat::RGB8).to_buffer();
+    EXPECT_EQ(rgb[(1 * 8 + 1) * 3 + 0], 255);
+    EXPECT_EQ(rgb[(6 * 8 + 6) * 3 + 0], 0);
+    EXPECT_EQ(rgb[(6 * 8 + 6) * 3 + 2], 255);
+}